@@ -0,0 +1,369 @@
+#include "bin_manifest.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+/**
+ * magic at the beginning of binary manifest
+ */
+static const char BIN_MANIFEST_MAGIC[8] = "CABXMNF";
+
+/**
+ * byte order mark
+ */
+#define BIN_MANIFEST_BYTE_ORDER 0x01020304
+
+/**
+ * alignment of the record array
+ */
+#define BIN_MANIFEST_ALIGNMENT 8
+
+/**
+ * writer of binary manifest
+ */
+struct _bin_manifest_writer {
+    /**
+     * output stream
+     */
+    FILE* stream;
+
+    /**
+     * records written at finish
+     */
+    bin_manifest_record* records;
+
+    /**
+     * count of records
+     */
+    size_t record_count;
+
+    /**
+     * capacity of records
+     */
+    size_t record_capacity;
+
+    /**
+     * size of strings written
+     */
+    uint64_t strings_size;
+
+    /**
+     * not zero if any data could not be written
+     */
+    int failed;
+};
+
+/**
+ * write zero terminated string into the string table.
+ * offset gets the offset of the string in the table.
+ */
+static int
+bin_manifest_writer_add_str(
+    bin_manifest_writer* obj,
+    const char* str,
+    uint64_t* offset);
+
+/**
+ * allocate memory
+ */
+static void*
+bin_manifest_mem_alloc(
+    size_t size);
+
+/**
+ * free memory
+ */
+static void
+bin_manifest_mem_free(
+    void* heap_obj);
+
+/**
+ * you get non zero if the data begins with the magic of binary manifest
+ */
+int
+bin_manifest_is_manifest(
+    const void* data,
+    size_t size)
+{
+    int result;
+    if (data) {
+        result = size >= sizeof(BIN_MANIFEST_MAGIC)
+            && memcmp(data, BIN_MANIFEST_MAGIC,
+                sizeof(BIN_MANIFEST_MAGIC)) == 0;
+    } else {
+        errno = EINVAL;
+        result = 0;
+    }
+    return result;
+}
+
+/**
+ * get view of binary manifest in memory.
+ */
+int
+bin_manifest_open(
+    const void* data,
+    size_t size,
+    bin_manifest* manifest)
+{
+    int result;
+    const bin_manifest_header* header;
+    header = (const bin_manifest_header*)data;
+    if (data && manifest && size >= sizeof(bin_manifest_header)
+        && bin_manifest_is_manifest(data, size)) {
+        result = 0;
+    } else {
+        errno = EINVAL;
+        result = -1;
+    }
+    if (result == 0) {
+        /* every check is written not to overflow */
+        if (header->byte_order != BIN_MANIFEST_BYTE_ORDER
+            || header->version != BIN_MANIFEST_VERSION
+            || header->record_size != sizeof(bin_manifest_record)
+            || header->records_offset % BIN_MANIFEST_ALIGNMENT
+            || header->records_offset > size
+            || header->record_count > (size - header->records_offset)
+                / sizeof(bin_manifest_record)
+            || header->strings_offset > size
+            || header->strings_size > size - header->strings_offset
+            || (header->strings_size
+                && ((const char*)data)[header->strings_offset
+                    + header->strings_size - 1])) {
+            errno = EINVAL;
+            result = -1;
+        }
+    }
+    if (result == 0) {
+        manifest->records = (const bin_manifest_record*)(
+            (const char*)data + header->records_offset);
+        manifest->record_count = (size_t)header->record_count;
+        manifest->strings = (const char*)data + header->strings_offset;
+        manifest->strings_size = (size_t)header->strings_size;
+    }
+    return result;
+}
+
+/**
+ * get zero terminated string at the offset in the string table.
+ */
+const char*
+bin_manifest_get_str(
+    const bin_manifest* manifest,
+    uint64_t offset)
+{
+    const char* result;
+    result = NULL;
+    /* the last byte of the table is zero, so that the string ends in it */
+    if (manifest && offset < manifest->strings_size) {
+        result = manifest->strings + offset;
+    } else {
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * create writer of binary manifest into the stream.
+ */
+bin_manifest_writer*
+bin_manifest_writer_create(
+    FILE* stream)
+{
+    bin_manifest_writer* result;
+    result = NULL;
+    if (stream) {
+        result = (bin_manifest_writer*)bin_manifest_mem_alloc(
+            sizeof(bin_manifest_writer));
+    } else {
+        errno = EINVAL;
+    }
+    if (result) {
+        bin_manifest_header header;
+        memset(result, 0, sizeof(*result));
+        result->stream = stream;
+        /* the header is written again when the writer is finished */
+        memset(&header, 0, sizeof(header));
+        if (fwrite(&header, sizeof(header), 1, stream) != 1) {
+            bin_manifest_mem_free(result);
+            result = NULL;
+        }
+    }
+    return result;
+}
+
+/**
+ * add a record
+ */
+int
+bin_manifest_writer_add(
+    bin_manifest_writer* obj,
+    const char* source_path,
+    const char* entry_name,
+    int compression,
+    int attribute,
+    int execute,
+    int flush_folder,
+    int flush_cabinet)
+{
+    int result;
+    bin_manifest_record record;
+    memset(&record, 0, sizeof(record));
+    if (obj && source_path && entry_name) {
+        result = 0;
+    } else {
+        errno = EINVAL;
+        result = -1;
+    }
+    if (result == 0 && obj->record_count == obj->record_capacity) {
+        bin_manifest_record* new_records;
+        size_t new_capacity;
+        new_capacity = obj->record_capacity ?
+            obj->record_capacity * 2 : 0x400;
+        new_records = (bin_manifest_record*)bin_manifest_mem_alloc(
+            sizeof(bin_manifest_record) * new_capacity);
+        result = new_records ? 0 : -1;
+        if (result == 0) {
+            if (obj->records) {
+                memcpy(new_records, obj->records,
+                    sizeof(bin_manifest_record) * obj->record_count);
+                bin_manifest_mem_free(obj->records);
+            }
+            obj->records = new_records;
+            obj->record_capacity = new_capacity;
+        }
+    }
+    if (result == 0) {
+        result = bin_manifest_writer_add_str(obj, source_path,
+            &record.source_offset);
+    }
+    if (result == 0) {
+        result = bin_manifest_writer_add_str(obj, entry_name,
+            &record.name_offset);
+    }
+    if (result == 0) {
+        record.compression = (int32_t)compression;
+        record.attribute = (int32_t)attribute;
+        record.execute = execute ? 1 : 0;
+        record.flush_folder = flush_folder ? 1 : 0;
+        record.flush_cabinet = flush_cabinet ? 1 : 0;
+        obj->records[obj->record_count++] = record;
+    }
+    return result;
+}
+
+/**
+ * write the records and the header into the stream
+ */
+int
+bin_manifest_writer_finish(
+    bin_manifest_writer* obj)
+{
+    int result;
+    bin_manifest_header header;
+    if (obj) {
+        result = obj->failed ? -1 : 0;
+    } else {
+        errno = EINVAL;
+        result = -1;
+    }
+    if (result == 0) {
+        static const char padding[BIN_MANIFEST_ALIGNMENT] = { 0 };
+        size_t padding_size;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, BIN_MANIFEST_MAGIC, sizeof(header.magic));
+        header.byte_order = BIN_MANIFEST_BYTE_ORDER;
+        header.version = BIN_MANIFEST_VERSION;
+        header.record_size = sizeof(bin_manifest_record);
+        header.record_count = obj->record_count;
+        header.strings_offset = sizeof(header);
+        header.strings_size = obj->strings_size;
+        header.records_offset = header.strings_offset + header.strings_size;
+        padding_size = (size_t)((BIN_MANIFEST_ALIGNMENT
+            - header.records_offset % BIN_MANIFEST_ALIGNMENT)
+            % BIN_MANIFEST_ALIGNMENT);
+        header.records_offset += padding_size;
+        if (padding_size
+            && fwrite(padding, padding_size, 1, obj->stream) != 1) {
+            result = -1;
+        }
+    }
+    if (result == 0 && obj->record_count
+        && fwrite(obj->records, sizeof(bin_manifest_record),
+            obj->record_count, obj->stream) != obj->record_count) {
+        result = -1;
+    }
+    if (result == 0) {
+        result = fseek(obj->stream, 0, SEEK_SET);
+    }
+    if (result == 0
+        && fwrite(&header, sizeof(header), 1, obj->stream) != 1) {
+        result = -1;
+    }
+    if (result == 0) {
+        result = fflush(obj->stream) == 0 ? 0 : -1;
+    }
+    if (result && obj) {
+        obj->failed = 1;
+    }
+    return result;
+}
+
+/**
+ * free the writer. The stream is not closed.
+ */
+void
+bin_manifest_writer_free(
+    bin_manifest_writer* obj)
+{
+    if (obj) {
+        if (obj->records) {
+            bin_manifest_mem_free(obj->records);
+        }
+        bin_manifest_mem_free(obj);
+    }
+}
+
+/**
+ * write zero terminated string into the string table.
+ */
+static int
+bin_manifest_writer_add_str(
+    bin_manifest_writer* obj,
+    const char* str,
+    uint64_t* offset)
+{
+    int result;
+    size_t size;
+    size = strlen(str) + 1;
+    result = fwrite(str, size, 1, obj->stream) == 1 ? 0 : -1;
+    if (result == 0) {
+        *offset = obj->strings_size;
+        obj->strings_size += size;
+    } else {
+        obj->failed = 1;
+    }
+    return result;
+}
+
+/**
+ * allocate memory
+ */
+static void*
+bin_manifest_mem_alloc(
+    size_t size)
+{
+    return malloc(size);
+}
+
+/**
+ * free memory
+ */
+static void
+bin_manifest_mem_free(
+    void* heap_obj)
+{
+    free(heap_obj);
+}
+
+/* vi: se ts=4 sw=4 et: */
@@ -0,0 +1,238 @@
+#ifndef __BIN_MANIFEST_H__
+#define __BIN_MANIFEST_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+#define _BIN_MANIFEST_ITFC_BEGIN extern "C" {
+#define _BIN_MANIFEST_ITFC_END }
+#else
+#define _BIN_MANIFEST_ITFC_BEGIN
+#define _BIN_MANIFEST_ITFC_END
+#endif
+
+_BIN_MANIFEST_ITFC_BEGIN
+
+/**
+ * format version of binary manifest. The version is incremented whenever
+ * the layout or the meaning of compression codes is changed.
+ */
+#define BIN_MANIFEST_VERSION 1
+
+/**
+ * header at the beginning of binary manifest.
+ * Binary manifest is composed of the header, the string table and the
+ * record array. All numbers are in the byte order of the host which wrote
+ * the manifest, so that the manifest is used from mapped memory as it is.
+ */
+typedef struct _bin_manifest_header bin_manifest_header;
+
+/**
+ * header at the beginning of binary manifest
+ */
+struct _bin_manifest_header {
+    /**
+     * "CABXMNF" with terminating zero
+     */
+    char magic[8];
+
+    /**
+     * 0x01020304 written in the byte order of the host
+     */
+    uint32_t byte_order;
+
+    /**
+     * BIN_MANIFEST_VERSION
+     */
+    uint32_t version;
+
+    /**
+     * size of a record
+     */
+    uint32_t record_size;
+
+    /**
+     * reserved. always zero.
+     */
+    uint32_t reserved;
+
+    /**
+     * count of records
+     */
+    uint64_t record_count;
+
+    /**
+     * offset of the record array from the beginning of manifest.
+     * The offset is aligned to 8 bytes.
+     */
+    uint64_t records_offset;
+
+    /**
+     * offset of the string table from the beginning of manifest
+     */
+    uint64_t strings_offset;
+
+    /**
+     * size of the string table
+     */
+    uint64_t strings_size;
+};
+
+/**
+ * entry in binary manifest
+ */
+typedef struct _bin_manifest_record bin_manifest_record;
+
+/**
+ * entry in binary manifest
+ */
+struct _bin_manifest_record {
+    /**
+     * offset of zero terminated source path in the string table
+     */
+    uint64_t source_offset;
+
+    /**
+     * offset of zero terminated entry name in the string table
+     */
+    uint64_t name_offset;
+
+    /**
+     * compression code of name_compression
+     */
+    int32_t compression;
+
+    /**
+     * attribute
+     */
+    int32_t attribute;
+
+    /**
+     * execute flag
+     */
+    uint8_t execute;
+
+    /**
+     * flush folder after the entry
+     */
+    uint8_t flush_folder;
+
+    /**
+     * flush cabinet after the entry
+     */
+    uint8_t flush_cabinet;
+
+    /**
+     * reserved. always zero.
+     */
+    uint8_t reserved[5];
+};
+
+/**
+ * view of binary manifest in memory
+ */
+typedef struct _bin_manifest bin_manifest;
+
+/**
+ * view of binary manifest in memory
+ */
+struct _bin_manifest {
+    /**
+     * records
+     */
+    const bin_manifest_record* records;
+
+    /**
+     * count of records
+     */
+    size_t record_count;
+
+    /**
+     * string table
+     */
+    const char* strings;
+
+    /**
+     * size of string table
+     */
+    size_t strings_size;
+};
+
+/**
+ * writer of binary manifest
+ */
+typedef struct _bin_manifest_writer bin_manifest_writer;
+
+/**
+ * you get non zero if the data begins with the magic of binary manifest
+ */
+int
+bin_manifest_is_manifest(
+    const void* data,
+    size_t size);
+
+/**
+ * get view of binary manifest in memory.
+ * Only the header is checked, so that you get the view in constant time.
+ * The offsets in records are checked when the strings are taken by
+ * bin_manifest_get_str. The data has to be aligned to 8 bytes, like
+ * mapped memory.
+ */
+int
+bin_manifest_open(
+    const void* data,
+    size_t size,
+    bin_manifest* manifest);
+
+/**
+ * get zero terminated string at the offset in the string table.
+ * You get NULL if the offset is out of the string table.
+ */
+const char*
+bin_manifest_get_str(
+    const bin_manifest* manifest,
+    uint64_t offset);
+
+/**
+ * create writer of binary manifest into the stream.
+ * Strings are written into the stream as records are added, and the
+ * records are kept in memory until the writer is finished.
+ */
+bin_manifest_writer*
+bin_manifest_writer_create(
+    FILE* stream);
+
+/**
+ * add a record
+ */
+int
+bin_manifest_writer_add(
+    bin_manifest_writer* obj,
+    const char* source_path,
+    const char* entry_name,
+    int compression,
+    int attribute,
+    int execute,
+    int flush_folder,
+    int flush_cabinet);
+
+/**
+ * write the records and the header into the stream
+ */
+int
+bin_manifest_writer_finish(
+    bin_manifest_writer* obj);
+
+/**
+ * free the writer. The stream is not closed.
+ */
+void
+bin_manifest_writer_free(
+    bin_manifest_writer* obj);
+
+_BIN_MANIFEST_ITFC_END
+
+/* vi: se ts=4 sw=4 et: */
+#endif
@@ -0,0 +1,253 @@
+#include "bounded_queue.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "thread_i.h"
+
+/**
+ * fixed capacity queue
+ */
+struct _bounded_queue {
+    /**
+     * lock for items
+     */
+    thread_i_mutex* lock;
+
+    /**
+     * signaled when an item is put or the queue is closed
+     */
+    thread_i_cond* not_empty;
+
+    /**
+     * signaled when an item is taken or the queue is closed
+     */
+    thread_i_cond* not_full;
+
+    /**
+     * ring buffer of items
+     */
+    void** items;
+
+    /**
+     * capacity of items
+     */
+    size_t capacity;
+
+    /**
+     * index of the first item
+     */
+    size_t head;
+
+    /**
+     * count of items
+     */
+    size_t count;
+
+    /**
+     * not zero if the queue does not accept items anymore
+     */
+    int closed;
+};
+
+/**
+ * allocate memory
+ */
+static void*
+bounded_queue_mem_alloc(
+    size_t size);
+
+/**
+ * free memory
+ */
+static void
+bounded_queue_mem_free(
+    void* heap_obj);
+
+/**
+ * create queue which holds items at most the capacity
+ */
+bounded_queue*
+bounded_queue_create(
+    size_t capacity)
+{
+    bounded_queue* result;
+    result = NULL;
+    if (capacity) {
+        result = (bounded_queue*)bounded_queue_mem_alloc(
+            sizeof(bounded_queue));
+    } else {
+        errno = EINVAL;
+    }
+    if (result) {
+        memset(result, 0, sizeof(*result));
+        result->capacity = capacity;
+        result->lock = thread_i_mutex_create();
+        result->not_empty = thread_i_cond_create();
+        result->not_full = thread_i_cond_create();
+        result->items = (void**)bounded_queue_mem_alloc(
+            sizeof(void*) * capacity);
+        if (!result->lock || !result->not_empty || !result->not_full
+            || !result->items) {
+            bounded_queue_free(result, NULL);
+            result = NULL;
+        }
+    }
+    return result;
+}
+
+/**
+ * free queue.
+ */
+void
+bounded_queue_free(
+    bounded_queue* obj,
+    void (*free_item)(void*))
+{
+    if (obj) {
+        if (obj->items) {
+            if (free_item) {
+                while (obj->count) {
+                    free_item(obj->items[obj->head]);
+                    obj->head = (obj->head + 1) % obj->capacity;
+                    obj->count--;
+                }
+            }
+            bounded_queue_mem_free(obj->items);
+        }
+        thread_i_cond_free(obj->not_full);
+        thread_i_cond_free(obj->not_empty);
+        thread_i_mutex_free(obj->lock);
+        bounded_queue_mem_free(obj);
+    }
+}
+
+/**
+ * put an item at the tail. This blocks while the queue is full.
+ */
+int
+bounded_queue_push(
+    bounded_queue* obj,
+    void* item)
+{
+    int result;
+    if (obj) {
+        thread_i_mutex_lock(obj->lock);
+        while (obj->count == obj->capacity && !obj->closed) {
+            thread_i_cond_wait(obj->not_full, obj->lock);
+        }
+        if (!obj->closed) {
+            obj->items[(obj->head + obj->count) % obj->capacity] = item;
+            obj->count++;
+            thread_i_cond_signal(obj->not_empty);
+            result = 0;
+        } else {
+            result = -1;
+            errno = EPIPE;
+        }
+        thread_i_mutex_unlock(obj->lock);
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * take an item from the head. This blocks while the queue is empty.
+ */
+int
+bounded_queue_pop(
+    bounded_queue* obj,
+    void** item)
+{
+    int result;
+    if (obj && item) {
+        thread_i_mutex_lock(obj->lock);
+        while (!obj->count && !obj->closed) {
+            thread_i_cond_wait(obj->not_empty, obj->lock);
+        }
+        if (obj->count) {
+            *item = obj->items[obj->head];
+            obj->head = (obj->head + 1) % obj->capacity;
+            obj->count--;
+            thread_i_cond_signal(obj->not_full);
+            result = 1;
+        } else {
+            result = 0;
+        }
+        thread_i_mutex_unlock(obj->lock);
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * wait for an item to be put or the queue to be closed at most the
+ * milliseconds.
+ */
+int
+bounded_queue_wait(
+    bounded_queue* obj,
+    unsigned int millisec)
+{
+    int result;
+    if (obj) {
+        thread_i_mutex_lock(obj->lock);
+        if (!obj->count && !obj->closed) {
+            thread_i_cond_timed_wait(obj->not_empty, obj->lock, millisec);
+        }
+        if (obj->count) {
+            result = 1;
+        } else if (obj->closed) {
+            result = 0;
+        } else {
+            result = -1;
+            errno = ETIMEDOUT;
+        }
+        thread_i_mutex_unlock(obj->lock);
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * close queue.
+ */
+void
+bounded_queue_close(
+    bounded_queue* obj)
+{
+    if (obj) {
+        thread_i_mutex_lock(obj->lock);
+        obj->closed = 1;
+        thread_i_cond_broadcast(obj->not_empty);
+        thread_i_cond_broadcast(obj->not_full);
+        thread_i_mutex_unlock(obj->lock);
+    }
+}
+
+/**
+ * allocate memory
+ */
+static void*
+bounded_queue_mem_alloc(
+    size_t size)
+{
+    return malloc(size);
+}
+
+/**
+ * free memory
+ */
+static void
+bounded_queue_mem_free(
+    void* heap_obj)
+{
+    free(heap_obj);
+}
+
+/* vi: se ts=4 sw=4 et: */
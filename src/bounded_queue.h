@@ -0,0 +1,76 @@
+#ifndef __BOUNDED_QUEUE_H__
+#define __BOUNDED_QUEUE_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+#define _BOUNDED_QUEUE_ITFC_BEGIN extern "C" {
+#define _BOUNDED_QUEUE_ITFC_END }
+#else
+#define _BOUNDED_QUEUE_ITFC_BEGIN
+#define _BOUNDED_QUEUE_ITFC_END
+#endif
+
+_BOUNDED_QUEUE_ITFC_BEGIN
+
+/**
+ * fixed capacity queue passing items from a producer thread to a consumer
+ * thread.
+ */
+typedef struct _bounded_queue bounded_queue;
+
+/**
+ * create queue which holds items at most the capacity
+ */
+bounded_queue*
+bounded_queue_create(
+    size_t capacity);
+
+/**
+ * free queue. The items left in queue are freed with free_item if it is
+ * not NULL.
+ */
+void
+bounded_queue_free(
+    bounded_queue* obj,
+    void (*free_item)(void*));
+
+/**
+ * put an item at the tail. This blocks while the queue is full.
+ * You get -1 and errno is EPIPE if the queue was closed.
+ */
+int
+bounded_queue_push(
+    bounded_queue* obj,
+    void* item);
+
+/**
+ * take an item from the head. This blocks while the queue is empty.
+ * You get 1 if an item is taken or 0 if the queue was closed and empty.
+ */
+int
+bounded_queue_pop(
+    bounded_queue* obj,
+    void** item);
+
+/**
+ * wait for an item to be put or the queue to be closed at most the
+ * milliseconds. You get 1 if an item is in queue, 0 if the queue was closed
+ * and empty or -1 if the time passed.
+ */
+int
+bounded_queue_wait(
+    bounded_queue* obj,
+    unsigned int millisec);
+
+/**
+ * close queue. The items in queue can be taken after closing.
+ */
+void
+bounded_queue_close(
+    bounded_queue* obj);
+
+_BOUNDED_QUEUE_ITFC_END
+
+/* vi: se ts=4 sw=4 et: */
+#endif
@@ -0,0 +1,583 @@
+#include "buffered_writer.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include "thread_i.h"
+#include "io_ring.h"
+
+/**
+ * alignment of buffers
+ */
+#define BUFFERED_WRITER_ALIGNMENT 0x1000
+
+/**
+ * count of buffers written through io ring in parallel
+ */
+#define BUFFERED_WRITER_RING_DEPTH 4
+
+/**
+ * buffered writer
+ */
+struct _buffered_writer {
+    /**
+     * stream to write data
+     */
+    FILE* stream;
+
+    /**
+     * pool to write buffers in background. NULL if the buffers are written
+     * in calling thread.
+     */
+    worker_pool* pool;
+
+    /**
+     * memory for buffers
+     */
+    void* memory;
+
+    /**
+     * buffers. the second buffer is used only with pool, and the rest are
+     * used only with io ring.
+     */
+    unsigned char* buffers[BUFFERED_WRITER_RING_DEPTH];
+
+    /**
+     * count of buffers
+     */
+    unsigned int buffer_count;
+
+    /**
+     * size of each buffer
+     */
+    size_t buffer_size;
+
+    /**
+     * index of buffer to be filled
+     */
+    unsigned int active_index;
+
+    /**
+     * filled size of active buffer
+     */
+    size_t fill_size;
+
+    /**
+     * lock for pending write
+     */
+    thread_i_mutex* lock;
+
+    /**
+     * signaled when pending write is completed
+     */
+    thread_i_cond* written;
+
+    /**
+     * not zero while a buffer is written in background
+     */
+    int pending;
+
+    /**
+     * index of buffer written in background
+     */
+    unsigned int pending_index;
+
+    /**
+     * size of data written in background
+     */
+    size_t pending_size;
+
+    /**
+     * error number of the first failed write
+     */
+    int error;
+
+    /**
+     * io ring to write buffers at offsets of file. NULL if buffers are
+     * written into stream.
+     */
+    io_ring* ring;
+
+    /**
+     * file descriptor of stream written through io ring
+     */
+    int fd;
+
+    /**
+     * offset of file where the active buffer is written through io ring
+     */
+    unsigned long long offset;
+
+    /**
+     * not zero if offset is taken from stream position. The stream position
+     * is moved to offset when the writer is flushed.
+     */
+    int offset_valid;
+
+    /**
+     * offset of file where each buffer in flight is written
+     */
+    unsigned long long ring_offsets[BUFFERED_WRITER_RING_DEPTH];
+
+    /**
+     * size of data in each buffer in flight. 0 if the buffer is not in
+     * flight.
+     */
+    size_t ring_sizes[BUFFERED_WRITER_RING_DEPTH];
+
+    /**
+     * size written from each buffer in flight
+     */
+    size_t ring_written[BUFFERED_WRITER_RING_DEPTH];
+};
+
+/**
+ * allocate buffered writer with buffers
+ */
+static buffered_writer*
+buffered_writer_alloc(
+    FILE* stream,
+    size_t buffer_size,
+    unsigned int buffer_count);
+
+/**
+ * write the active buffer into stream
+ */
+static int
+buffered_writer_write_active(
+    buffered_writer* obj);
+
+/**
+ * wait for pending write to be completed
+ */
+static void
+buffered_writer_wait(
+    buffered_writer* obj);
+
+/**
+ * write pending buffer in background
+ */
+static void
+buffered_writer_run(
+    void* arg);
+
+/**
+ * write the active buffer through io ring and make the next buffer active
+ */
+static void
+buffered_writer_submit(
+    buffered_writer* obj);
+
+/**
+ * wait a buffer written through io ring to be completed
+ */
+static int
+buffered_writer_reap(
+    buffered_writer* obj);
+
+/**
+ * allocate memory
+ */
+static void*
+buffered_writer_mem_alloc(
+    size_t size);
+
+/**
+ * free memory
+ */
+static void
+buffered_writer_mem_free(
+    void* heap_obj);
+
+/**
+ * create buffered writer for the stream.
+ */
+buffered_writer*
+buffered_writer_create(
+    FILE* stream,
+    size_t buffer_size,
+    worker_pool* pool)
+{
+    buffered_writer* result;
+    result = buffered_writer_alloc(stream, buffer_size, pool ? 2 : 1);
+    if (result) {
+        result->pool = pool;
+        if (pool) {
+            result->lock = thread_i_mutex_create();
+            result->written = thread_i_cond_create();
+        }
+        if (pool && (!result->lock || !result->written)) {
+            buffered_writer_free(result);
+            result = NULL;
+        }
+    }
+    return result;
+}
+
+/**
+ * create buffered writer writing filled buffers through io ring.
+ */
+buffered_writer*
+buffered_writer_create_1(
+    FILE* stream,
+    size_t buffer_size)
+{
+    buffered_writer* result;
+    result = buffered_writer_alloc(stream, buffer_size,
+        BUFFERED_WRITER_RING_DEPTH);
+    if (result) {
+        result->fd = fileno(stream);
+        result->ring = io_ring_create(BUFFERED_WRITER_RING_DEPTH);
+        if (result->ring) {
+            /* the buffers are written without registration if it fails */
+            io_ring_register_buffers(result->ring,
+                (void* const*)result->buffers, buffer_size,
+                result->buffer_count);
+        } else {
+            buffered_writer_free(result);
+            result = NULL;
+        }
+    }
+    return result;
+}
+
+/**
+ * write data into buffer
+ */
+int
+buffered_writer_write(
+    buffered_writer* obj,
+    const void* data,
+    size_t size)
+{
+    int result;
+    const unsigned char* src;
+    src = (const unsigned char*)data;
+    if (obj && (data || !size)) {
+        result = 0;
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    while (result == 0 && size) {
+        size_t copy_size;
+        if (!obj->pool && !obj->ring && !obj->fill_size
+            && size >= obj->buffer_size) {
+            copy_size = size - size % obj->buffer_size;
+            if (fwrite(src, 1, copy_size, obj->stream) != copy_size) {
+                if (!obj->error) {
+                    obj->error = errno ? errno : EIO;
+                }
+                errno = obj->error;
+                result = -1;
+            }
+        } else {
+            copy_size = obj->buffer_size - obj->fill_size;
+            if (copy_size > size) {
+                copy_size = size;
+            }
+            memcpy(obj->buffers[obj->active_index] + obj->fill_size,
+                src, copy_size);
+            obj->fill_size += copy_size;
+            if (obj->fill_size == obj->buffer_size) {
+                result = buffered_writer_write_active(obj);
+            }
+        }
+        src += copy_size;
+        size -= copy_size;
+    }
+    return result;
+}
+
+/**
+ * write all buffered data into stream.
+ */
+int
+buffered_writer_flush(
+    buffered_writer* obj)
+{
+    int result;
+    if (obj) {
+        result = 0;
+        if (obj->fill_size) {
+            result = buffered_writer_write_active(obj);
+        }
+        if (obj->pool) {
+            buffered_writer_wait(obj);
+        }
+        while (obj->ring && io_ring_get_in_flight(obj->ring)
+            && buffered_writer_reap(obj) == 0) {
+        }
+        if (obj->ring && obj->offset_valid) {
+            /* the stream is used from the end of written data */
+            if (fseek(obj->stream, (long)obj->offset, SEEK_SET)
+                && !obj->error) {
+                obj->error = errno ? errno : EIO;
+            }
+            obj->offset_valid = 0;
+        }
+        if (obj->error) {
+            errno = obj->error;
+            result = -1;
+        }
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * flush and free buffered writer. The stream is not closed.
+ */
+int
+buffered_writer_free(
+    buffered_writer* obj)
+{
+    int result;
+    if (obj) {
+        result = 0;
+        if (obj->memory && (!obj->pool || (obj->lock && obj->written))) {
+            result = buffered_writer_flush(obj);
+        }
+        if (obj->ring) {
+            io_ring_free(obj->ring);
+        }
+        thread_i_cond_free(obj->written);
+        thread_i_mutex_free(obj->lock);
+        if (obj->memory) {
+            buffered_writer_mem_free(obj->memory);
+        }
+        buffered_writer_mem_free(obj);
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * allocate buffered writer with buffers
+ */
+static buffered_writer*
+buffered_writer_alloc(
+    FILE* stream,
+    size_t buffer_size,
+    unsigned int buffer_count)
+{
+    buffered_writer* result;
+    result = NULL;
+    if (stream && buffer_size) {
+        result = (buffered_writer*)buffered_writer_mem_alloc(
+            sizeof(buffered_writer));
+    } else {
+        errno = EINVAL;
+    }
+    if (result) {
+        memset(result, 0, sizeof(*result));
+        result->stream = stream;
+        result->buffer_size = buffer_size;
+        result->buffer_count = buffer_count;
+        result->fd = -1;
+        result->memory = buffered_writer_mem_alloc(
+            buffer_size * buffer_count + BUFFERED_WRITER_ALIGNMENT);
+        if (result->memory) {
+            uintptr_t addr;
+            unsigned int idx;
+            addr = (uintptr_t)result->memory;
+            addr = (addr + BUFFERED_WRITER_ALIGNMENT - 1)
+                & ~(uintptr_t)(BUFFERED_WRITER_ALIGNMENT - 1);
+            for (idx = 0; idx < buffer_count; idx++) {
+                result->buffers[idx] = (unsigned char*)addr
+                    + buffer_size * idx;
+            }
+        } else {
+            buffered_writer_mem_free(result);
+            result = NULL;
+        }
+    }
+    return result;
+}
+
+/**
+ * write the active buffer into stream
+ */
+static int
+buffered_writer_write_active(
+    buffered_writer* obj)
+{
+    int result;
+    int error;
+    result = 0;
+    if (obj->pool) {
+        buffered_writer_wait(obj);
+        thread_i_mutex_lock(obj->lock);
+        error = obj->error;
+        obj->pending = 1;
+        obj->pending_index = obj->active_index;
+        obj->pending_size = obj->fill_size;
+        thread_i_mutex_unlock(obj->lock);
+        if (worker_pool_submit(obj->pool, buffered_writer_run, obj)) {
+            buffered_writer_run(obj);
+        }
+        obj->active_index ^= 1;
+    } else if (obj->ring) {
+        buffered_writer_submit(obj);
+        error = obj->error;
+    } else {
+        if (fwrite(obj->buffers[0], 1, obj->fill_size, obj->stream)
+            != obj->fill_size && !obj->error) {
+            obj->error = errno ? errno : EIO;
+        }
+        error = obj->error;
+    }
+    obj->fill_size = 0;
+    if (error) {
+        errno = error;
+        result = -1;
+    }
+    return result;
+}
+
+/**
+ * wait for pending write to be completed
+ */
+static void
+buffered_writer_wait(
+    buffered_writer* obj)
+{
+    thread_i_mutex_lock(obj->lock);
+    while (obj->pending) {
+        thread_i_cond_wait(obj->written, obj->lock);
+    }
+    thread_i_mutex_unlock(obj->lock);
+}
+
+/**
+ * write pending buffer in background
+ */
+static void
+buffered_writer_run(
+    void* arg)
+{
+    buffered_writer* obj;
+    int error;
+    obj = (buffered_writer*)arg;
+    error = 0;
+    if (fwrite(obj->buffers[obj->pending_index], 1, obj->pending_size,
+        obj->stream) != obj->pending_size) {
+        error = errno ? errno : EIO;
+    }
+    thread_i_mutex_lock(obj->lock);
+    if (error && !obj->error) {
+        obj->error = error;
+    }
+    obj->pending = 0;
+    thread_i_cond_broadcast(obj->written);
+    thread_i_mutex_unlock(obj->lock);
+}
+
+/**
+ * write the active buffer through io ring and make the next buffer active
+ */
+static void
+buffered_writer_submit(
+    buffered_writer* obj)
+{
+    unsigned int idx;
+    idx = obj->active_index;
+    if (!obj->offset_valid) {
+        long offset;
+        offset = ftell(obj->stream);
+        if (offset >= 0) {
+            obj->offset = (unsigned long long)offset;
+            obj->offset_valid = 1;
+        } else if (!obj->error) {
+            obj->error = errno ? errno : EIO;
+        }
+    }
+    if (obj->offset_valid) {
+        obj->ring_offsets[idx] = obj->offset;
+        obj->ring_sizes[idx] = obj->fill_size;
+        obj->ring_written[idx] = 0;
+        if (io_ring_write(obj->ring, obj->fd, obj->buffers[idx],
+            obj->fill_size, obj->offset, (int)idx, (void*)(uintptr_t)idx)
+            == 0) {
+            io_ring_submit(obj->ring);
+        } else {
+            obj->ring_sizes[idx] = 0;
+            if (!obj->error) {
+                obj->error = errno ? errno : EIO;
+            }
+        }
+        obj->offset += obj->fill_size;
+    }
+    obj->active_index = (idx + 1) % obj->buffer_count;
+    while (obj->ring_sizes[obj->active_index]
+        && buffered_writer_reap(obj) == 0) {
+    }
+}
+
+/**
+ * wait a buffer written through io ring to be completed
+ */
+static int
+buffered_writer_reap(
+    buffered_writer* obj)
+{
+    int result;
+    void* user_data;
+    long result_size;
+    result = io_ring_wait(obj->ring, &user_data, &result_size);
+    if (result == 0) {
+        unsigned int idx;
+        idx = (unsigned int)(uintptr_t)user_data;
+        if (result_size > 0) {
+            obj->ring_written[idx] += (size_t)result_size;
+        } else if (!obj->error) {
+            obj->error = result_size < 0 ? (int)-result_size : EIO;
+        }
+        if (result_size > 0
+            && obj->ring_written[idx] < obj->ring_sizes[idx]) {
+            /* the rest of short write is written again */
+            size_t written;
+            written = obj->ring_written[idx];
+            if (io_ring_write(obj->ring, obj->fd,
+                obj->buffers[idx] + written,
+                obj->ring_sizes[idx] - written,
+                obj->ring_offsets[idx] + written, (int)idx, user_data)) {
+                obj->ring_sizes[idx] = 0;
+                if (!obj->error) {
+                    obj->error = errno ? errno : EIO;
+                }
+            }
+        } else {
+            obj->ring_sizes[idx] = 0;
+        }
+    } else if (!obj->error) {
+        obj->error = errno ? errno : EIO;
+    }
+    return result;
+}
+
+/**
+ * allocate memory
+ */
+static void*
+buffered_writer_mem_alloc(
+    size_t size)
+{
+    return malloc(size);
+}
+
+/**
+ * free memory
+ */
+static void
+buffered_writer_mem_free(
+    void* heap_obj)
+{
+    free(heap_obj);
+}
+
+/* vi: se ts=4 sw=4 et: */
@@ -0,0 +1,75 @@
+#ifndef __BUFFERED_WRITER_H__
+#define __BUFFERED_WRITER_H__
+
+#include <stddef.h>
+#include <stdio.h>
+#include "worker_pool.h"
+
+#ifdef __cplusplus
+#define _BUFFERED_WRITER_ITFC_BEGIN extern "C" {
+#define _BUFFERED_WRITER_ITFC_END }
+#else
+#define _BUFFERED_WRITER_ITFC_BEGIN
+#define _BUFFERED_WRITER_ITFC_END
+#endif
+
+_BUFFERED_WRITER_ITFC_BEGIN
+
+/**
+ * writer which keeps data in large buffers and writes them into stream
+ * when a buffer is filled or flushed.
+ */
+typedef struct _buffered_writer buffered_writer;
+
+/**
+ * create buffered writer for the stream.
+ * If you specify worker pool, filled buffers are written into the stream
+ * in a thread of the pool while the other buffer is filled.
+ */
+buffered_writer*
+buffered_writer_create(
+    FILE* stream,
+    size_t buffer_size,
+    worker_pool* pool);
+
+/**
+ * create buffered writer writing filled buffers through io ring.
+ * A few filled buffers are written at the offsets of file in parallel while
+ * the other buffer is filled. The stream has to be unbuffered, and it must
+ * not be used until the writer is flushed. The stream position is moved to
+ * the end of written data when the writer is flushed.
+ */
+buffered_writer*
+buffered_writer_create_1(
+    FILE* stream,
+    size_t buffer_size);
+
+/**
+ * write data into buffer
+ */
+int
+buffered_writer_write(
+    buffered_writer* obj,
+    const void* data,
+    size_t size);
+
+/**
+ * write all buffered data into stream.
+ * You get non zero if any data could not be written since the writer was
+ * created.
+ */
+int
+buffered_writer_flush(
+    buffered_writer* obj);
+
+/**
+ * flush and free buffered writer. The stream is not closed.
+ */
+int
+buffered_writer_free(
+    buffered_writer* obj);
+
+_BUFFERED_WRITER_ITFC_END
+
+/* vi: se ts=4 sw=4 et: */
+#endif
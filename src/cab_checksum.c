@@ -0,0 +1,296 @@
+#include "cab_checksum.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) \
+    && (defined(__x86_64__) || defined(__i386__))
+#define CAB_CHECKSUM_X86 1
+#include <immintrin.h>
+#endif
+
+/**
+ * calculate cabinet checksum one word at a time
+ */
+static uint32_t
+cab_checksum_compute_scalar(
+    const void* data,
+    size_t size,
+    uint32_t seed);
+
+#ifdef CAB_CHECKSUM_X86
+/**
+ * calculate cabinet checksum with sse2 instructions
+ */
+static uint32_t
+cab_checksum_compute_sse2(
+    const void* data,
+    size_t size,
+    uint32_t seed);
+
+/**
+ * calculate cabinet checksum with avx2 instructions
+ */
+static uint32_t
+cab_checksum_compute_avx2(
+    const void* data,
+    size_t size,
+    uint32_t seed);
+#endif
+
+/**
+ * calculate cabinet checksum
+ */
+uint32_t
+cab_checksum_compute(
+    const void* data,
+    size_t size,
+    uint32_t seed)
+{
+    return cab_checksum_compute_kernel(cab_checksum_get_kernel(),
+        data, size, seed);
+}
+
+/**
+ * calculate checksum for a CFDATA block
+ */
+uint32_t
+cab_checksum_cfdata(
+    const void* data,
+    unsigned int compressed_size,
+    unsigned int uncompressed_size)
+{
+    uint32_t result;
+    uint8_t size_fields[4];
+    result = cab_checksum_compute(data, compressed_size, 0);
+    size_fields[0] = (uint8_t)compressed_size;
+    size_fields[1] = (uint8_t)(compressed_size >> 8);
+    size_fields[2] = (uint8_t)uncompressed_size;
+    size_fields[3] = (uint8_t)(uncompressed_size >> 8);
+    result = cab_checksum_compute(size_fields, sizeof(size_fields), result);
+    return result;
+}
+
+/**
+ * get the fastest kernel supported by the processor
+ */
+unsigned int
+cab_checksum_get_kernel()
+{
+    unsigned int result;
+    if (cab_checksum_is_supported(CAB_CHECKSUM_KERNEL_AVX2)) {
+        result = CAB_CHECKSUM_KERNEL_AVX2;
+    } else if (cab_checksum_is_supported(CAB_CHECKSUM_KERNEL_SSE2)) {
+        result = CAB_CHECKSUM_KERNEL_SSE2;
+    } else {
+        result = CAB_CHECKSUM_KERNEL_SCALAR;
+    }
+    return result;
+}
+
+/**
+ * you get non zero if the processor supports the kernel
+ */
+int
+cab_checksum_is_supported(
+    unsigned int kernel)
+{
+    int result;
+    switch (kernel) {
+    case CAB_CHECKSUM_KERNEL_SCALAR:
+        result = 1;
+        break;
+#ifdef CAB_CHECKSUM_X86
+    case CAB_CHECKSUM_KERNEL_SSE2:
+        result = __builtin_cpu_supports("sse2");
+        break;
+    case CAB_CHECKSUM_KERNEL_AVX2:
+        result = __builtin_cpu_supports("avx2");
+        break;
+#endif
+    default:
+        result = 0;
+        break;
+    }
+    return result;
+}
+
+/**
+ * get kernel name
+ */
+const char*
+cab_checksum_get_kernel_name(
+    unsigned int kernel)
+{
+    const char* result;
+    switch (kernel) {
+    case CAB_CHECKSUM_KERNEL_SCALAR:
+        result = "scalar";
+        break;
+    case CAB_CHECKSUM_KERNEL_SSE2:
+        result = "sse2";
+        break;
+    case CAB_CHECKSUM_KERNEL_AVX2:
+        result = "avx2";
+        break;
+    default:
+        result = NULL;
+        break;
+    }
+    return result;
+}
+
+/**
+ * calculate cabinet checksum with the kernel.
+ */
+uint32_t
+cab_checksum_compute_kernel(
+    unsigned int kernel,
+    const void* data,
+    size_t size,
+    uint32_t seed)
+{
+    uint32_t result;
+    switch (kernel) {
+#ifdef CAB_CHECKSUM_X86
+    case CAB_CHECKSUM_KERNEL_SSE2:
+        result = cab_checksum_compute_sse2(data, size, seed);
+        break;
+    case CAB_CHECKSUM_KERNEL_AVX2:
+        result = cab_checksum_compute_avx2(data, size, seed);
+        break;
+#endif
+    default:
+        result = cab_checksum_compute_scalar(data, size, seed);
+        break;
+    }
+    return result;
+}
+
+/**
+ * calculate cabinet checksum one word at a time
+ */
+static uint32_t
+cab_checksum_compute_scalar(
+    const void* data,
+    size_t size,
+    uint32_t seed)
+{
+    uint32_t result;
+    const uint8_t* ptr;
+    size_t count;
+    uint32_t value;
+    result = seed;
+    ptr = (const uint8_t*)data;
+    for (count = size / 4; count > 0; count--) {
+        value = ptr[0];
+        value |= (uint32_t)ptr[1] << 8;
+        value |= (uint32_t)ptr[2] << 16;
+        value |= (uint32_t)ptr[3] << 24;
+        result ^= value;
+        ptr += 4;
+    }
+    value = 0;
+    switch (size % 4) {
+    case 3:
+        value |= (uint32_t)*ptr++ << 16;
+        /* fall through */
+    case 2:
+        value |= (uint32_t)*ptr++ << 8;
+        /* fall through */
+    case 1:
+        value |= *ptr++;
+        /* fall through */
+    default:
+        break;
+    }
+    result ^= value;
+    return result;
+}
+
+#ifdef CAB_CHECKSUM_X86
+/**
+ * calculate cabinet checksum with sse2 instructions.
+ * Each 32 bit lane keeps the same position in 4 bytes word, so the lanes are
+ * folded into the checksum at the end.
+ */
+__attribute__((target("sse2")))
+static uint32_t
+cab_checksum_compute_sse2(
+    const void* data,
+    size_t size,
+    uint32_t seed)
+{
+    const uint8_t* ptr;
+    __m128i acc_0;
+    __m128i acc_1;
+    size_t count;
+    ptr = (const uint8_t*)data;
+    acc_0 = _mm_setzero_si128();
+    acc_1 = _mm_setzero_si128();
+    for (count = size / 32; count > 0; count--) {
+        acc_0 = _mm_xor_si128(acc_0,
+            _mm_loadu_si128((const __m128i*)ptr));
+        acc_1 = _mm_xor_si128(acc_1,
+            _mm_loadu_si128((const __m128i*)(ptr + 16)));
+        ptr += 32;
+    }
+    if (size & 16) {
+        acc_0 = _mm_xor_si128(acc_0,
+            _mm_loadu_si128((const __m128i*)ptr));
+        ptr += 16;
+    }
+    acc_0 = _mm_xor_si128(acc_0, acc_1);
+    acc_0 = _mm_xor_si128(acc_0, _mm_srli_si128(acc_0, 8));
+    acc_0 = _mm_xor_si128(acc_0, _mm_srli_si128(acc_0, 4));
+    seed ^= (uint32_t)_mm_cvtsi128_si32(acc_0);
+    return cab_checksum_compute_scalar(ptr, size % 16, seed);
+}
+
+/**
+ * calculate cabinet checksum with avx2 instructions
+ */
+__attribute__((target("avx2")))
+static uint32_t
+cab_checksum_compute_avx2(
+    const void* data,
+    size_t size,
+    uint32_t seed)
+{
+    const uint8_t* ptr;
+    __m256i acc_0;
+    __m256i acc_1;
+    __m256i acc_2;
+    __m256i acc_3;
+    __m128i acc;
+    size_t count;
+    ptr = (const uint8_t*)data;
+    acc_0 = _mm256_setzero_si256();
+    acc_1 = _mm256_setzero_si256();
+    acc_2 = _mm256_setzero_si256();
+    acc_3 = _mm256_setzero_si256();
+    for (count = size / 128; count > 0; count--) {
+        acc_0 = _mm256_xor_si256(acc_0,
+            _mm256_loadu_si256((const __m256i*)ptr));
+        acc_1 = _mm256_xor_si256(acc_1,
+            _mm256_loadu_si256((const __m256i*)(ptr + 32)));
+        acc_2 = _mm256_xor_si256(acc_2,
+            _mm256_loadu_si256((const __m256i*)(ptr + 64)));
+        acc_3 = _mm256_xor_si256(acc_3,
+            _mm256_loadu_si256((const __m256i*)(ptr + 96)));
+        ptr += 128;
+    }
+    for (count = size % 128 / 32; count > 0; count--) {
+        acc_0 = _mm256_xor_si256(acc_0,
+            _mm256_loadu_si256((const __m256i*)ptr));
+        ptr += 32;
+    }
+    acc_0 = _mm256_xor_si256(_mm256_xor_si256(acc_0, acc_1),
+        _mm256_xor_si256(acc_2, acc_3));
+    acc = _mm_xor_si128(_mm256_castsi256_si128(acc_0),
+        _mm256_extracti128_si256(acc_0, 1));
+    acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 8));
+    acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 4));
+    seed ^= (uint32_t)_mm_cvtsi128_si32(acc);
+    return cab_checksum_compute_sse2(ptr, size % 32, seed);
+}
+#endif
+
+/* vi: se ts=4 sw=4 et: */
@@ -0,0 +1,89 @@
+#ifndef __CAB_CHECKSUM_H__
+#define __CAB_CHECKSUM_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+#define _CAB_CHECKSUM_ITFC_BEGIN extern "C" {
+#define _CAB_CHECKSUM_ITFC_END }
+#else
+#define _CAB_CHECKSUM_ITFC_BEGIN 
+#define _CAB_CHECKSUM_ITFC_END 
+#endif
+
+_CAB_CHECKSUM_ITFC_BEGIN 
+
+/**
+ * checksum kernel processing a word at a time
+ */
+#define CAB_CHECKSUM_KERNEL_SCALAR 0
+
+/**
+ * checksum kernel with sse2 instructions
+ */
+#define CAB_CHECKSUM_KERNEL_SSE2 1
+
+/**
+ * checksum kernel with avx2 instructions
+ */
+#define CAB_CHECKSUM_KERNEL_AVX2 2
+
+/**
+ * count of checksum kernels
+ */
+#define CAB_CHECKSUM_KERNEL_COUNT 3
+
+/**
+ * calculate cabinet checksum with the fastest kernel
+ */
+uint32_t
+cab_checksum_compute(
+    const void* data,
+    size_t size,
+    uint32_t seed);
+
+/**
+ * calculate checksum for a CFDATA block
+ */
+uint32_t
+cab_checksum_cfdata(
+    const void* data,
+    unsigned int compressed_size,
+    unsigned int uncompressed_size);
+
+/**
+ * get the fastest kernel supported by the processor
+ */
+unsigned int
+cab_checksum_get_kernel();
+
+/**
+ * you get non zero if the processor supports the kernel
+ */
+int
+cab_checksum_is_supported(
+    unsigned int kernel);
+
+/**
+ * get kernel name. You get NULL for unknown kernel.
+ */
+const char*
+cab_checksum_get_kernel_name(
+    unsigned int kernel);
+
+/**
+ * calculate cabinet checksum with the kernel.
+ * The kernel has to be supported by the processor.
+ */
+uint32_t
+cab_checksum_compute_kernel(
+    unsigned int kernel,
+    const void* data,
+    size_t size,
+    uint32_t seed);
+
+_CAB_CHECKSUM_ITFC_END 
+
+/* vi: se ts=4 sw=4 et: */
+#endif
@@ -0,0 +1,429 @@
+#include "cab_compressor.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "fci_compat.h"
+#include "cab_mszip.h"
+#include "cab_lzx.h"
+
+/**
+ * folder data compressor
+ */
+struct _cab_compressor {
+
+    /**
+     * compression type
+     */
+    unsigned int type_compress;
+
+    /**
+     * compressor specific context
+     */
+    void* context;
+
+    /**
+     * reset context to begin new folder
+     */
+    int (*reset)(void*);
+
+    /**
+     * compress a data block
+     */
+    int (*compress)(void*, const void*, unsigned int, void*, unsigned int*);
+
+    /**
+     * free context
+     */
+    void (*free)(void*);
+};
+
+/**
+ * reset no compression context
+ */
+static int
+cab_compressor_none_reset(
+    void* context);
+
+/**
+ * store a data block
+ */
+static int
+cab_compressor_none_compress(
+    void* context,
+    const void* src,
+    unsigned int src_size,
+    void* dst,
+    unsigned int* dst_size);
+
+/**
+ * free no compression context
+ */
+static void
+cab_compressor_none_free(
+    void* context);
+
+/**
+ * reset mszip context
+ */
+static int
+cab_compressor_mszip_reset(
+    void* context);
+
+/**
+ * compress a data block with mszip
+ */
+static int
+cab_compressor_mszip_compress(
+    void* context,
+    const void* src,
+    unsigned int src_size,
+    void* dst,
+    unsigned int* dst_size);
+
+/**
+ * free mszip context
+ */
+static void
+cab_compressor_mszip_free(
+    void* context);
+
+/**
+ * reset lzx context
+ */
+static int
+cab_compressor_lzx_reset(
+    void* context);
+
+/**
+ * compress a data block with lzx
+ */
+static int
+cab_compressor_lzx_compress(
+    void* context,
+    const void* src,
+    unsigned int src_size,
+    void* dst,
+    unsigned int* dst_size);
+
+/**
+ * free lzx context
+ */
+static void
+cab_compressor_lzx_free(
+    void* context);
+
+/**
+ * get lzx window bits from compression type
+ */
+static unsigned int
+cab_compressor_get_lzx_window(
+    unsigned int type_compress);
+
+/**
+ * allocate memory
+ */
+static void*
+cab_compressor_mem_alloc(
+    size_t size);
+
+/**
+ * free memory
+ */
+static void
+cab_compressor_mem_free(
+    void* heap_obj);
+
+/**
+ * create compressor for compression type.
+ * You get NULL and errno is set ENOTSUP if the type is not supported.
+ */
+cab_compressor*
+cab_compressor_create(
+    unsigned int type_compress)
+{
+    cab_compressor* result;
+    result = NULL;
+    switch (CompressionTypeFromTCOMP(type_compress)) {
+    case tcompTYPE_NONE:
+        result = (cab_compressor*)cab_compressor_mem_alloc(
+            sizeof(cab_compressor));
+        if (result) {
+            result->type_compress = type_compress;
+            result->context = NULL;
+            result->reset = cab_compressor_none_reset;
+            result->compress = cab_compressor_none_compress;
+            result->free = cab_compressor_none_free;
+        }
+        break;
+    case tcompTYPE_MSZIP:
+        result = (cab_compressor*)cab_compressor_mem_alloc(
+            sizeof(cab_compressor));
+        if (result) {
+            result->type_compress = type_compress;
+            result->context = cab_mszip_create(
+                CAB_COMPRESSOR_PRESET_FROM_TYPE(type_compress));
+            result->reset = cab_compressor_mszip_reset;
+            result->compress = cab_compressor_mszip_compress;
+            result->free = cab_compressor_mszip_free;
+            if (!result->context) {
+                cab_compressor_mem_free(result);
+                result = NULL;
+            }
+        }
+        break;
+    case tcompTYPE_LZX:
+        result = (cab_compressor*)cab_compressor_mem_alloc(
+            sizeof(cab_compressor));
+        if (result) {
+            result->type_compress = type_compress;
+            result->context = cab_lzx_create(
+                cab_compressor_get_lzx_window(type_compress),
+                CAB_COMPRESSOR_PRESET_FROM_TYPE(type_compress),
+                (type_compress & CAB_COMPRESSOR_LZX_MATCH_FINDER_MASK)
+                    >> CAB_COMPRESSOR_LZX_MATCH_FINDER_SHIFT,
+                type_compress & CAB_COMPRESSOR_LZX_VERBATIM ?
+                    CAB_LZX_BLOCK_VERBATIM : CAB_LZX_BLOCK_AUTO);
+            result->reset = cab_compressor_lzx_reset;
+            result->compress = cab_compressor_lzx_compress;
+            result->free = cab_compressor_lzx_free;
+            if (!result->context) {
+                cab_compressor_mem_free(result);
+                result = NULL;
+            }
+        }
+        break;
+    default:
+        errno = ENOTSUP;
+        break;
+    }
+    return result;
+}
+
+/**
+ * get compression type to be written in folder entry.
+ */
+unsigned int
+cab_compressor_get_folder_type(
+    unsigned int type_compress)
+{
+    unsigned int result;
+    switch (CompressionTypeFromTCOMP(type_compress)) {
+    case tcompTYPE_LZX:
+        result = TCOMPfromLZXWindow(
+            cab_compressor_get_lzx_window(type_compress));
+        break;
+    case tcompTYPE_QUANTUM:
+        result = type_compress;
+        break;
+    default:
+        result = CompressionTypeFromTCOMP(type_compress);
+        break;
+    }
+    return result;
+}
+
+/**
+ * free compressor
+ */
+void
+cab_compressor_free(
+    cab_compressor* obj)
+{
+    if (obj) {
+        obj->free(obj->context);
+        cab_compressor_mem_free(obj);
+    }
+}
+
+/**
+ * get compression type
+ */
+unsigned int
+cab_compressor_get_type(
+    cab_compressor* obj)
+{
+    return obj->type_compress;
+}
+
+/**
+ * reset compressor state to begin new folder
+ */
+int
+cab_compressor_reset(
+    cab_compressor* obj)
+{
+    int result;
+    if (obj) {
+        result = obj->reset(obj->context);
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * compress a data block.
+ */
+int
+cab_compressor_compress(
+    cab_compressor* obj,
+    const void* src,
+    unsigned int src_size,
+    void* dst,
+    unsigned int* dst_size)
+{
+    int result;
+    if (obj && dst && dst_size && src_size <= CAB_COMPRESSOR_BLOCK_SIZE) {
+        result = obj->compress(obj->context, src, src_size, dst, dst_size);
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * reset no compression context
+ */
+static int
+cab_compressor_none_reset(
+    void* context)
+{
+    (void)context;
+    return 0;
+}
+
+/**
+ * store a data block
+ */
+static int
+cab_compressor_none_compress(
+    void* context,
+    const void* src,
+    unsigned int src_size,
+    void* dst,
+    unsigned int* dst_size)
+{
+    (void)context;
+    memcpy(dst, src, src_size);
+    *dst_size = src_size;
+    return 0;
+}
+
+/**
+ * free no compression context
+ */
+static void
+cab_compressor_none_free(
+    void* context)
+{
+    (void)context;
+}
+
+/**
+ * reset mszip context
+ */
+static int
+cab_compressor_mszip_reset(
+    void* context)
+{
+    return cab_mszip_reset((cab_mszip*)context);
+}
+
+/**
+ * compress a data block with mszip
+ */
+static int
+cab_compressor_mszip_compress(
+    void* context,
+    const void* src,
+    unsigned int src_size,
+    void* dst,
+    unsigned int* dst_size)
+{
+    return cab_mszip_compress((cab_mszip*)context,
+        src, src_size, dst, dst_size);
+}
+
+/**
+ * free mszip context
+ */
+static void
+cab_compressor_mszip_free(
+    void* context)
+{
+    cab_mszip_free((cab_mszip*)context);
+}
+
+/**
+ * reset lzx context
+ */
+static int
+cab_compressor_lzx_reset(
+    void* context)
+{
+    return cab_lzx_reset((cab_lzx*)context);
+}
+
+/**
+ * compress a data block with lzx
+ */
+static int
+cab_compressor_lzx_compress(
+    void* context,
+    const void* src,
+    unsigned int src_size,
+    void* dst,
+    unsigned int* dst_size)
+{
+    return cab_lzx_compress((cab_lzx*)context,
+        src, src_size, dst, dst_size);
+}
+
+/**
+ * free lzx context
+ */
+static void
+cab_compressor_lzx_free(
+    void* context)
+{
+    cab_lzx_free((cab_lzx*)context);
+}
+
+/**
+ * get lzx window bits from compression type
+ */
+static unsigned int
+cab_compressor_get_lzx_window(
+    unsigned int type_compress)
+{
+    unsigned int result;
+    result = LZXCompressionWindowFromTCOMP(type_compress);
+    if (!result) {
+        result = CAB_COMPRESSOR_LZX_WINDOW_DEF;
+    }
+    return result;
+}
+
+/**
+ * allocate memory
+ */
+static void*
+cab_compressor_mem_alloc(
+    size_t size)
+{
+    return malloc(size);
+}
+
+/**
+ * free memory
+ */
+static void
+cab_compressor_mem_free(
+    void* heap_obj)
+{
+    free(heap_obj);
+}
+
+/* vi: se ts=4 sw=4 et: */
@@ -0,0 +1,162 @@
+#ifndef __CAB_COMPRESSOR_H__
+#define __CAB_COMPRESSOR_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+#define _CAB_COMPRESSOR_ITFC_BEGIN extern "C" {
+#define _CAB_COMPRESSOR_ITFC_END }
+#else
+#define _CAB_COMPRESSOR_ITFC_BEGIN 
+#define _CAB_COMPRESSOR_ITFC_END 
+#endif
+
+_CAB_COMPRESSOR_ITFC_BEGIN 
+
+/**
+ * maximum uncompressed size of a data block
+ */
+#define CAB_COMPRESSOR_BLOCK_SIZE 32768U
+
+/**
+ * maximum compressed size of a data block
+ */
+#define CAB_COMPRESSOR_MAX_COMPRESSED_SIZE (32768U + 6144U)
+
+/**
+ * mask for compression preset in compression type.
+ * The preset is kept in the bits which fci uses for quantum level, and
+ * it is stripped before the type is written into cabinet.
+ */
+#define CAB_COMPRESSOR_PRESET_MASK 0x00F0U
+
+/**
+ * shift for compression preset in compression type
+ */
+#define CAB_COMPRESSOR_PRESET_SHIFT 4
+
+/**
+ * compressor default preset
+ */
+#define CAB_COMPRESSOR_PRESET_DEFAULT 0
+
+/**
+ * fastest compression
+ */
+#define CAB_COMPRESSOR_PRESET_FAST 1
+
+/**
+ * balanced compression
+ */
+#define CAB_COMPRESSOR_PRESET_NORMAL 2
+
+/**
+ * higher compression ratio with deeper match search
+ */
+#define CAB_COMPRESSOR_PRESET_HIGH 3
+
+/**
+ * best compression ratio with optimal parsing
+ */
+#define CAB_COMPRESSOR_PRESET_MAX 4
+
+/**
+ * get compression preset from compression type
+ */
+#define CAB_COMPRESSOR_PRESET_FROM_TYPE(type) \
+    (((type) & CAB_COMPRESSOR_PRESET_MASK) >> CAB_COMPRESSOR_PRESET_SHIFT)
+
+/**
+ * compression type with compression preset
+ */
+#define CAB_COMPRESSOR_TYPE_WITH_PRESET(type, preset) \
+    (((type) & ~CAB_COMPRESSOR_PRESET_MASK) \
+    | ((preset) << CAB_COMPRESSOR_PRESET_SHIFT))
+
+/**
+ * mask for lzx match finder in compression type.
+ * The value is one of CAB_LZX_MATCH_FINDER_XXX in cab_lzx.h.
+ */
+#define CAB_COMPRESSOR_LZX_MATCH_FINDER_MASK 0x6000U
+
+/**
+ * shift for lzx match finder in compression type
+ */
+#define CAB_COMPRESSOR_LZX_MATCH_FINDER_SHIFT 13
+
+/**
+ * lzx compressor uses verbatim blocks only
+ */
+#define CAB_COMPRESSOR_LZX_VERBATIM 0x8000U
+
+/**
+ * lzx window bits if compression type does not have window bits
+ */
+#define CAB_COMPRESSOR_LZX_WINDOW_DEF 21
+
+/**
+ * compression is chosen from probed contents of the source file.
+ * The flag is out of the bits which fci uses for compression type, and it
+ * is resolved into the type or none before the type reaches the backend.
+ */
+#define CAB_COMPRESSOR_AUTO 0x10000U
+
+/**
+ * folder data compressor
+ */
+typedef struct _cab_compressor cab_compressor;
+
+/**
+ * get compression type to be written in folder entry.
+ * The compressor specific bits like preset are removed.
+ */
+unsigned int
+cab_compressor_get_folder_type(
+    unsigned int type_compress);
+
+/**
+ * create compressor for compression type.
+ * You get NULL and errno is set ENOTSUP if the type is not supported.
+ */
+cab_compressor*
+cab_compressor_create(
+    unsigned int type_compress);
+
+/**
+ * free compressor
+ */
+void
+cab_compressor_free(
+    cab_compressor* obj);
+
+/**
+ * get compression type
+ */
+unsigned int
+cab_compressor_get_type(
+    cab_compressor* obj);
+
+/**
+ * reset compressor state to begin new folder
+ */
+int
+cab_compressor_reset(
+    cab_compressor* obj);
+
+/**
+ * compress a data block.
+ * src_size must not be greater than CAB_COMPRESSOR_BLOCK_SIZE and
+ * dst must have CAB_COMPRESSOR_MAX_COMPRESSED_SIZE bytes at least.
+ */
+int
+cab_compressor_compress(
+    cab_compressor* obj,
+    const void* src,
+    unsigned int src_size,
+    void* dst,
+    unsigned int* dst_size);
+
+_CAB_COMPRESSOR_ITFC_END 
+
+/* vi: se ts=4 sw=4 et: */
+#endif
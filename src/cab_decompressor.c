@@ -0,0 +1,368 @@
+#include "cab_decompressor.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "fci_compat.h"
+#include "cab_compressor.h"
+#include "cab_mszip_decoder.h"
+#include "cab_lzx_decoder.h"
+
+/**
+ * folder data decompressor
+ */
+struct _cab_decompressor {
+
+    /**
+     * decompressor specific context
+     */
+    void* context;
+
+    /**
+     * reset context to begin new folder
+     */
+    int (*reset)(void*);
+
+    /**
+     * decompress a data block
+     */
+    int (*decompress)(void*, const void*, unsigned int, void*, unsigned int);
+
+    /**
+     * free context
+     */
+    void (*free)(void*);
+};
+
+/**
+ * reset no compression context
+ */
+static int
+cab_decompressor_none_reset(
+    void* context);
+
+/**
+ * copy a stored data block
+ */
+static int
+cab_decompressor_none_decompress(
+    void* context,
+    const void* src,
+    unsigned int src_size,
+    void* dst,
+    unsigned int dst_size);
+
+/**
+ * free no compression context
+ */
+static void
+cab_decompressor_none_free(
+    void* context);
+
+/**
+ * reset mszip context
+ */
+static int
+cab_decompressor_mszip_reset(
+    void* context);
+
+/**
+ * decompress a mszip data block
+ */
+static int
+cab_decompressor_mszip_decompress(
+    void* context,
+    const void* src,
+    unsigned int src_size,
+    void* dst,
+    unsigned int dst_size);
+
+/**
+ * free mszip context
+ */
+static void
+cab_decompressor_mszip_free(
+    void* context);
+
+/**
+ * reset lzx context
+ */
+static int
+cab_decompressor_lzx_reset(
+    void* context);
+
+/**
+ * decompress a lzx data block
+ */
+static int
+cab_decompressor_lzx_decompress(
+    void* context,
+    const void* src,
+    unsigned int src_size,
+    void* dst,
+    unsigned int dst_size);
+
+/**
+ * free lzx context
+ */
+static void
+cab_decompressor_lzx_free(
+    void* context);
+
+/**
+ * allocate memory
+ */
+static void*
+cab_decompressor_mem_alloc(
+    size_t size);
+
+/**
+ * free memory
+ */
+static void
+cab_decompressor_mem_free(
+    void* heap_obj);
+
+/**
+ * create decompressor for compression type in folder entry.
+ * You get NULL and errno is set ENOTSUP if the type is not supported.
+ */
+cab_decompressor*
+cab_decompressor_create(
+    unsigned int type_compress)
+{
+    cab_decompressor* result;
+    result = NULL;
+    switch (CompressionTypeFromTCOMP(type_compress)) {
+    case tcompTYPE_NONE:
+        result = (cab_decompressor*)cab_decompressor_mem_alloc(
+            sizeof(cab_decompressor));
+        if (result) {
+            result->context = NULL;
+            result->reset = cab_decompressor_none_reset;
+            result->decompress = cab_decompressor_none_decompress;
+            result->free = cab_decompressor_none_free;
+        }
+        break;
+    case tcompTYPE_MSZIP:
+        result = (cab_decompressor*)cab_decompressor_mem_alloc(
+            sizeof(cab_decompressor));
+        if (result) {
+            result->context = cab_mszip_decoder_create();
+            result->reset = cab_decompressor_mszip_reset;
+            result->decompress = cab_decompressor_mszip_decompress;
+            result->free = cab_decompressor_mszip_free;
+            if (!result->context) {
+                cab_decompressor_mem_free(result);
+                result = NULL;
+            }
+        }
+        break;
+    case tcompTYPE_LZX:
+        result = (cab_decompressor*)cab_decompressor_mem_alloc(
+            sizeof(cab_decompressor));
+        if (result) {
+            result->context = cab_lzx_decoder_create(
+                LZXCompressionWindowFromTCOMP(type_compress));
+            result->reset = cab_decompressor_lzx_reset;
+            result->decompress = cab_decompressor_lzx_decompress;
+            result->free = cab_decompressor_lzx_free;
+            if (!result->context) {
+                cab_decompressor_mem_free(result);
+                result = NULL;
+            }
+        }
+        break;
+    default:
+        errno = ENOTSUP;
+        break;
+    }
+    return result;
+}
+
+/**
+ * free decompressor
+ */
+void
+cab_decompressor_free(
+    cab_decompressor* obj)
+{
+    if (obj) {
+        obj->free(obj->context);
+        cab_decompressor_mem_free(obj);
+    }
+}
+
+/**
+ * reset decompressor state to begin new folder
+ */
+int
+cab_decompressor_reset(
+    cab_decompressor* obj)
+{
+    int result;
+    if (obj) {
+        result = obj->reset(obj->context);
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * decompress a data block.
+ */
+int
+cab_decompressor_decompress(
+    cab_decompressor* obj,
+    const void* src,
+    unsigned int src_size,
+    void* dst,
+    unsigned int dst_size)
+{
+    int result;
+    if (obj && (src || !src_size) && dst
+        && dst_size <= CAB_COMPRESSOR_BLOCK_SIZE) {
+        result = obj->decompress(obj->context, src, src_size, dst, dst_size);
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * reset no compression context
+ */
+static int
+cab_decompressor_none_reset(
+    void* context)
+{
+    (void)context;
+    return 0;
+}
+
+/**
+ * copy a stored data block
+ */
+static int
+cab_decompressor_none_decompress(
+    void* context,
+    const void* src,
+    unsigned int src_size,
+    void* dst,
+    unsigned int dst_size)
+{
+    int result;
+    (void)context;
+    if (src_size == dst_size) {
+        memcpy(dst, src, src_size);
+        result = 0;
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * free no compression context
+ */
+static void
+cab_decompressor_none_free(
+    void* context)
+{
+    (void)context;
+}
+
+/**
+ * reset mszip context
+ */
+static int
+cab_decompressor_mszip_reset(
+    void* context)
+{
+    return cab_mszip_decoder_reset((cab_mszip_decoder*)context);
+}
+
+/**
+ * decompress a mszip data block
+ */
+static int
+cab_decompressor_mszip_decompress(
+    void* context,
+    const void* src,
+    unsigned int src_size,
+    void* dst,
+    unsigned int dst_size)
+{
+    return cab_mszip_decoder_decompress((cab_mszip_decoder*)context,
+        src, src_size, dst, dst_size);
+}
+
+/**
+ * free mszip context
+ */
+static void
+cab_decompressor_mszip_free(
+    void* context)
+{
+    cab_mszip_decoder_free((cab_mszip_decoder*)context);
+}
+
+/**
+ * reset lzx context
+ */
+static int
+cab_decompressor_lzx_reset(
+    void* context)
+{
+    return cab_lzx_decoder_reset((cab_lzx_decoder*)context);
+}
+
+/**
+ * decompress a lzx data block
+ */
+static int
+cab_decompressor_lzx_decompress(
+    void* context,
+    const void* src,
+    unsigned int src_size,
+    void* dst,
+    unsigned int dst_size)
+{
+    return cab_lzx_decoder_decompress((cab_lzx_decoder*)context,
+        src, src_size, dst, dst_size);
+}
+
+/**
+ * free lzx context
+ */
+static void
+cab_decompressor_lzx_free(
+    void* context)
+{
+    cab_lzx_decoder_free((cab_lzx_decoder*)context);
+}
+
+/**
+ * allocate memory
+ */
+static void*
+cab_decompressor_mem_alloc(
+    size_t size)
+{
+    return malloc(size);
+}
+
+/**
+ * free memory
+ */
+static void
+cab_decompressor_mem_free(
+    void* heap_obj)
+{
+    free(heap_obj);
+}
+
+/* vi: se ts=4 sw=4 et: */
@@ -0,0 +1,59 @@
+#ifndef __CAB_DECOMPRESSOR_H__
+#define __CAB_DECOMPRESSOR_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+#define _CAB_DECOMPRESSOR_ITFC_BEGIN extern "C" {
+#define _CAB_DECOMPRESSOR_ITFC_END }
+#else
+#define _CAB_DECOMPRESSOR_ITFC_BEGIN 
+#define _CAB_DECOMPRESSOR_ITFC_END 
+#endif
+
+_CAB_DECOMPRESSOR_ITFC_BEGIN 
+
+/**
+ * folder data decompressor
+ */
+typedef struct _cab_decompressor cab_decompressor;
+
+/**
+ * create decompressor for compression type in folder entry.
+ * You get NULL and errno is set ENOTSUP if the type is not supported.
+ */
+cab_decompressor*
+cab_decompressor_create(
+    unsigned int type_compress);
+
+/**
+ * free decompressor
+ */
+void
+cab_decompressor_free(
+    cab_decompressor* obj);
+
+/**
+ * reset decompressor state to begin new folder
+ */
+int
+cab_decompressor_reset(
+    cab_decompressor* obj);
+
+/**
+ * decompress a data block.
+ * dst_size is the uncompressed size in the data block. It must not be
+ * greater than CAB_COMPRESSOR_BLOCK_SIZE.
+ */
+int
+cab_decompressor_decompress(
+    cab_decompressor* obj,
+    const void* src,
+    unsigned int src_size,
+    void* dst,
+    unsigned int dst_size);
+
+_CAB_DECOMPRESSOR_ITFC_END 
+
+/* vi: se ts=4 sw=4 et: */
+#endif
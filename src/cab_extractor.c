@@ -0,0 +1,1110 @@
+#include "cab_extractor.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include "cab_decompressor.h"
+#include "cab_compressor.h"
+#include "file_i.h"
+#include "path.h"
+#include "thread_i.h"
+#include "buffered_writer.h"
+
+/**
+ * maximum count of cabinets in a set
+ */
+#define CAB_EXTRACTOR_MAX_CABINETS 0x10000
+
+/**
+ * maximum size of buffer to write a file
+ */
+#define CAB_EXTRACTOR_WRITE_BUFFER_SIZE 0x100000
+
+/**
+ * job extracting files in a folder
+ */
+typedef struct _cab_extractor_job cab_extractor_job;
+
+/**
+ * folder joined across cabinets
+ */
+typedef struct _cab_extractor_folder cab_extractor_folder;
+
+/**
+ * file to be extracted
+ */
+typedef struct _cab_extractor_file cab_extractor_file;
+
+/**
+ * folder joined across cabinets
+ */
+struct _cab_extractor_folder {
+    /**
+     * compression type
+     */
+    unsigned int type_compress;
+
+    /**
+     * data blocks in all cabinets
+     */
+    const cab_reader_block** blocks;
+
+    /**
+     * count of data blocks
+     */
+    size_t block_count;
+};
+
+/**
+ * file to be extracted
+ */
+struct _cab_extractor_file {
+    /**
+     * file entry in cabinet
+     */
+    const cab_reader_file* entry;
+
+    /**
+     * index of joined folder
+     */
+    size_t folder_index;
+
+    /**
+     * path to extract into. NULL if the file is not extracted.
+     */
+    char* path;
+
+    /**
+     * output stream while the file is written
+     */
+    FILE* stream;
+
+    /**
+     * writer into the stream
+     */
+    buffered_writer* writer;
+
+    /**
+     * size written into file
+     */
+    unsigned long written;
+};
+
+/**
+ * files extractor for a cabinet set
+ */
+struct _cab_extractor {
+    /**
+     * cabinets in set order
+     */
+    cab_reader** cabinets;
+
+    /**
+     * count of cabinets
+     */
+    size_t cabinet_count;
+
+    /**
+     * folders joined across cabinets
+     */
+    cab_extractor_folder* folders;
+
+    /**
+     * count of folders
+     */
+    size_t folder_count;
+
+    /**
+     * data blocks referred by folders
+     */
+    const cab_reader_block** blocks;
+
+    /**
+     * files
+     */
+    cab_extractor_file* files;
+
+    /**
+     * count of files
+     */
+    size_t file_count;
+
+    /**
+     * threads to extract folders. NULL if folders are extracted in calling
+     * thread.
+     */
+    worker_pool* pool;
+
+    /**
+     * threads to write files in background. NULL if files are written in
+     * extracting thread.
+     */
+    worker_pool* write_pool;
+
+    /**
+     * lock for running jobs
+     */
+    thread_i_mutex* lock;
+
+    /**
+     * signaled when a job is completed
+     */
+    thread_i_cond* job_done;
+
+    /**
+     * count of running jobs
+     */
+    size_t job_running_count;
+};
+
+/**
+ * job extracting files in a folder
+ */
+struct _cab_extractor_job {
+    /**
+     * extractor
+     */
+    cab_extractor* extractor;
+
+    /**
+     * folder to decompress
+     */
+    cab_extractor_folder* folder;
+
+    /**
+     * files in the folder sorted by offset
+     */
+    cab_extractor_file** files;
+
+    /**
+     * count of files
+     */
+    size_t file_count;
+
+    /**
+     * uncompressed size needed to extract files
+     */
+    unsigned long size;
+
+    /**
+     * result of job
+     */
+    int result;
+
+    /**
+     * error number if the job failed
+     */
+    int error;
+};
+
+/**
+ * open cabinets in the set from the first to the last
+ */
+static int
+cab_extractor_open_cabinets(
+    cab_extractor* obj,
+    const char* cab_path);
+
+/**
+ * open the cabinet named in the other cabinet
+ */
+static cab_reader*
+cab_extractor_open_sibling(
+    const char* dir_path,
+    const char* cab_name,
+    cab_reader* origin);
+
+/**
+ * join folders and collect files in cabinets
+ */
+static int
+cab_extractor_build(
+    cab_extractor* obj);
+
+/**
+ * you get non zero if the first folder in the cabinet continues from the
+ * last folder in the previous cabinet
+ */
+static int
+cab_extractor_is_continued(
+    cab_reader* prev_cab,
+    cab_reader* cab);
+
+/**
+ * run job extracting files in a folder
+ */
+static void
+cab_extractor_job_run(
+    void* arg);
+
+/**
+ * extract files in a folder
+ */
+static int
+cab_extractor_extract_folder(
+    cab_extractor_job* job,
+    unsigned char* buffer,
+    unsigned char* join_buffer);
+
+/**
+ * close file and the writer
+ */
+static int
+cab_extractor_close_file(
+    cab_extractor_file* file);
+
+/**
+ * write decompressed data into the files overlapping it
+ */
+static int
+cab_extractor_write_files(
+    cab_extractor_job* job,
+    size_t* first_file,
+    unsigned long offset,
+    const unsigned char* data,
+    unsigned int size);
+
+/**
+ * compare files by folder and offset
+ */
+static int
+cab_extractor_compare_file(
+    const void* lhs,
+    const void* rhs);
+
+/**
+ * compare jobs by size in descending order
+ */
+static int
+cab_extractor_compare_job(
+    const void* lhs,
+    const void* rhs);
+
+/**
+ * allocate memory
+ */
+static void*
+cab_extractor_mem_alloc(
+    size_t size);
+
+/**
+ * free memory
+ */
+static void
+cab_extractor_mem_free(
+    void* heap_obj);
+
+/**
+ * open the cabinet set including the cabinet file.
+ */
+cab_extractor*
+cab_extractor_open(
+    const char* cab_path)
+{
+    cab_extractor* result;
+    result = NULL;
+    if (cab_path) {
+        result = (cab_extractor*)cab_extractor_mem_alloc(
+            sizeof(cab_extractor));
+    } else {
+        errno = EINVAL;
+    }
+    if (result) {
+        memset(result, 0, sizeof(*result));
+        if (cab_extractor_open_cabinets(result, cab_path)
+            || cab_extractor_build(result)) {
+            int err;
+            err = errno;
+            cab_extractor_close(result);
+            result = NULL;
+            errno = err;
+        }
+    }
+    return result;
+}
+
+/**
+ * close the cabinet set
+ */
+void
+cab_extractor_close(
+    cab_extractor* obj)
+{
+    if (obj) {
+        size_t idx;
+        worker_pool_free(obj->pool);
+        thread_i_cond_free(obj->job_done);
+        thread_i_mutex_free(obj->lock);
+        for (idx = 0; idx < obj->file_count; idx++) {
+            cab_extractor_close_file(&obj->files[idx]);
+            if (obj->files[idx].path) {
+                cab_extractor_mem_free(obj->files[idx].path);
+            }
+        }
+        for (idx = 0; idx < obj->cabinet_count; idx++) {
+            cab_reader_close(obj->cabinets[idx]);
+        }
+        if (obj->cabinets) {
+            cab_extractor_mem_free(obj->cabinets);
+        }
+        if (obj->folders) {
+            cab_extractor_mem_free(obj->folders);
+        }
+        if (obj->blocks) {
+            cab_extractor_mem_free((void*)obj->blocks);
+        }
+        if (obj->files) {
+            cab_extractor_mem_free(obj->files);
+        }
+        cab_extractor_mem_free(obj);
+    }
+}
+
+/**
+ * get count of files in the cabinet set.
+ */
+size_t
+cab_extractor_get_file_count(
+    cab_extractor* obj)
+{
+    return obj->file_count;
+}
+
+/**
+ * get file entry
+ */
+const cab_reader_file*
+cab_extractor_get_file(
+    cab_extractor* obj,
+    size_t index)
+{
+    const cab_reader_file* result;
+    if (index < obj->file_count) {
+        result = obj->files[index].entry;
+    } else {
+        result = NULL;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * set path where the file is extracted into.
+ */
+int
+cab_extractor_set_file_path(
+    cab_extractor* obj,
+    size_t index,
+    const char* file_path)
+{
+    int result;
+    char* path;
+    path = NULL;
+    if (obj && index < obj->file_count) {
+        result = 0;
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    if (result == 0 && file_path) {
+        size_t path_size;
+        path_size = strlen(file_path) + 1;
+        path = (char*)cab_extractor_mem_alloc(path_size);
+        if (path) {
+            memcpy(path, file_path, path_size);
+        } else {
+            result = -1;
+        }
+    }
+    if (result == 0) {
+        if (obj->files[index].path) {
+            cab_extractor_mem_free(obj->files[index].path);
+        }
+        obj->files[index].path = path;
+    }
+    return result;
+}
+
+/**
+ * set count of threads extracting folders
+ */
+int
+cab_extractor_set_jobs(
+    cab_extractor* obj,
+    unsigned int jobs)
+{
+    int result;
+    if (obj && !obj->pool) {
+        result = 0;
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    if (result == 0 && jobs > 1) {
+        obj->lock = thread_i_mutex_create();
+        obj->job_done = thread_i_cond_create();
+        if (obj->lock && obj->job_done) {
+            obj->pool = worker_pool_create(jobs);
+        }
+        if (!obj->pool) {
+            thread_i_cond_free(obj->job_done);
+            thread_i_mutex_free(obj->lock);
+            obj->job_done = NULL;
+            obj->lock = NULL;
+            result = -1;
+        }
+    }
+    return result;
+}
+
+/**
+ * set threads writing files in background
+ */
+int
+cab_extractor_set_write_pool(
+    cab_extractor* obj,
+    worker_pool* pool)
+{
+    int result;
+    if (obj) {
+        obj->write_pool = pool;
+        result = 0;
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * extract the files which have paths
+ */
+int
+cab_extractor_extract(
+    cab_extractor* obj)
+{
+    int result;
+    cab_extractor_file** files;
+    cab_extractor_job* jobs;
+    size_t file_count;
+    size_t job_count;
+    files = NULL;
+    jobs = NULL;
+    file_count = 0;
+    job_count = 0;
+    result = obj ? 0 : -1;
+    if (result == 0) {
+        files = (cab_extractor_file**)cab_extractor_mem_alloc(
+            sizeof(cab_extractor_file*) * (obj->file_count + 1));
+        jobs = (cab_extractor_job*)cab_extractor_mem_alloc(
+            sizeof(cab_extractor_job) * (obj->folder_count + 1));
+        result = files && jobs ? 0 : -1;
+    } else {
+        errno = EINVAL;
+    }
+    if (result == 0) {
+        size_t idx;
+        for (idx = 0; idx < obj->file_count; idx++) {
+            if (obj->files[idx].path) {
+                files[file_count++] = &obj->files[idx];
+            }
+        }
+        qsort(files, file_count, sizeof(files[0]),
+            cab_extractor_compare_file);
+    }
+    if (result == 0) {
+        size_t start;
+        start = 0;
+        while (start < file_count) {
+            cab_extractor_job* job;
+            size_t end;
+            job = &jobs[job_count++];
+            memset(job, 0, sizeof(*job));
+            job->extractor = obj;
+            job->folder = &obj->folders[files[start]->folder_index];
+            job->files = files + start;
+            end = start;
+            while (end < file_count
+                && files[end]->folder_index == files[start]->folder_index) {
+                const cab_reader_file* entry;
+                entry = files[end]->entry;
+                if (job->size < entry->offset + entry->size) {
+                    job->size = entry->offset + entry->size;
+                }
+                end++;
+            }
+            job->file_count = end - start;
+            start = end;
+        }
+    }
+    if (result == 0) {
+        size_t idx;
+        if (obj->pool) {
+            /* start large folders first not to wait for them at the end */
+            qsort(jobs, job_count, sizeof(jobs[0]),
+                cab_extractor_compare_job);
+        }
+        for (idx = 0; idx < job_count; idx++) {
+            if (obj->pool) {
+                thread_i_mutex_lock(obj->lock);
+                obj->job_running_count++;
+                thread_i_mutex_unlock(obj->lock);
+                if (worker_pool_submit(obj->pool, cab_extractor_job_run,
+                    &jobs[idx])) {
+                    cab_extractor_job_run(&jobs[idx]);
+                }
+            } else {
+                cab_extractor_job_run(&jobs[idx]);
+                if (jobs[idx].result) {
+                    break;
+                }
+            }
+        }
+        if (obj->pool) {
+            thread_i_mutex_lock(obj->lock);
+            while (obj->job_running_count) {
+                thread_i_cond_wait(obj->job_done, obj->lock);
+            }
+            thread_i_mutex_unlock(obj->lock);
+        }
+        for (idx = 0; idx < job_count; idx++) {
+            if (jobs[idx].result) {
+                result = -1;
+                errno = jobs[idx].error;
+                break;
+            }
+        }
+    }
+    if (result && obj) {
+        size_t idx;
+        for (idx = 0; idx < obj->file_count; idx++) {
+            cab_extractor_close_file(&obj->files[idx]);
+        }
+    }
+    if (files) {
+        cab_extractor_mem_free(files);
+    }
+    if (jobs) {
+        cab_extractor_mem_free(jobs);
+    }
+    return result;
+}
+
+/**
+ * open cabinets in the set from the first to the last
+ */
+static int
+cab_extractor_open_cabinets(
+    cab_extractor* obj,
+    const char* cab_path)
+{
+    int result;
+    char* dir_path;
+    cab_reader* cab;
+    dir_path = NULL;
+    obj->cabinets = (cab_reader**)cab_extractor_mem_alloc(
+        sizeof(cab_reader*) * CAB_EXTRACTOR_MAX_CABINETS);
+    result = obj->cabinets ? 0 : -1;
+    if (result == 0) {
+        result = path_remove_file_spec(cab_path, &dir_path,
+            cab_extractor_mem_alloc, cab_extractor_mem_free);
+    }
+    cab = NULL;
+    if (result == 0) {
+        cab = cab_reader_open(cab_path);
+        result = cab ? 0 : -1;
+    }
+    if (result == 0) {
+        obj->cabinets[obj->cabinet_count++] = cab;
+    }
+    /* the given cabinet may be in the middle of the set */
+    while (result == 0 && cab_reader_get_prev_cabinet(obj->cabinets[0])) {
+        if (obj->cabinet_count == CAB_EXTRACTOR_MAX_CABINETS) {
+            result = -1;
+            errno = EINVAL;
+            break;
+        }
+        cab = cab_extractor_open_sibling(dir_path,
+            cab_reader_get_prev_cabinet(obj->cabinets[0]),
+            obj->cabinets[0]);
+        if (cab) {
+            memmove(obj->cabinets + 1, obj->cabinets,
+                sizeof(cab_reader*) * obj->cabinet_count);
+            obj->cabinets[0] = cab;
+            obj->cabinet_count++;
+        } else {
+            result = -1;
+        }
+    }
+    while (result == 0 && cab_reader_get_next_cabinet(
+        obj->cabinets[obj->cabinet_count - 1])) {
+        cab_reader* last_cab;
+        if (obj->cabinet_count == CAB_EXTRACTOR_MAX_CABINETS) {
+            result = -1;
+            errno = EINVAL;
+            break;
+        }
+        last_cab = obj->cabinets[obj->cabinet_count - 1];
+        cab = cab_extractor_open_sibling(dir_path,
+            cab_reader_get_next_cabinet(last_cab), last_cab);
+        if (cab) {
+            obj->cabinets[obj->cabinet_count++] = cab;
+        } else {
+            result = -1;
+        }
+    }
+    if (dir_path) {
+        cab_extractor_mem_free(dir_path);
+    }
+    return result;
+}
+
+/**
+ * open the cabinet named in the other cabinet
+ */
+static cab_reader*
+cab_extractor_open_sibling(
+    const char* dir_path,
+    const char* cab_name,
+    cab_reader* origin)
+{
+    cab_reader* result;
+    char* cab_path;
+    result = NULL;
+    cab_path = NULL;
+    if (dir_path[0]) {
+        path_join(dir_path, cab_name, &cab_path,
+            cab_extractor_mem_alloc, cab_extractor_mem_free);
+    } else {
+        size_t path_size;
+        path_size = strlen(cab_name) + 1;
+        cab_path = (char*)cab_extractor_mem_alloc(path_size);
+        if (cab_path) {
+            memcpy(cab_path, cab_name, path_size);
+        }
+    }
+    if (cab_path) {
+        result = cab_reader_open(cab_path);
+        cab_extractor_mem_free(cab_path);
+    }
+    if (result && cab_reader_get_set_id(result)
+        != cab_reader_get_set_id(origin)) {
+        cab_reader_close(result);
+        result = NULL;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * join folders and collect files in cabinets
+ */
+static int
+cab_extractor_build(
+    cab_extractor* obj)
+{
+    size_t folder_count;
+    size_t block_count;
+    size_t file_count;
+    size_t block_used;
+    size_t idx;
+    int result;
+    folder_count = 0;
+    block_count = 0;
+    file_count = 0;
+    for (idx = 0; idx < obj->cabinet_count; idx++) {
+        size_t folder_idx;
+        folder_count += cab_reader_get_folder_count(obj->cabinets[idx]);
+        file_count += cab_reader_get_file_count(obj->cabinets[idx]);
+        for (folder_idx = 0;
+            folder_idx < cab_reader_get_folder_count(obj->cabinets[idx]);
+            folder_idx++) {
+            block_count += cab_reader_get_folder(obj->cabinets[idx],
+                folder_idx)->block_count;
+        }
+    }
+    obj->folders = (cab_extractor_folder*)cab_extractor_mem_alloc(
+        sizeof(cab_extractor_folder) * (folder_count + 1));
+    obj->blocks = (const cab_reader_block**)cab_extractor_mem_alloc(
+        sizeof(cab_reader_block*) * (block_count + 1));
+    obj->files = (cab_extractor_file*)cab_extractor_mem_alloc(
+        sizeof(cab_extractor_file) * (file_count + 1));
+    result = obj->folders && obj->blocks && obj->files ? 0 : -1;
+    block_used = 0;
+    for (idx = 0; result == 0 && idx < obj->cabinet_count; idx++) {
+        cab_reader* cab;
+        size_t cab_folder_count;
+        size_t base;
+        size_t folder_idx;
+        int continued;
+        cab = obj->cabinets[idx];
+        cab_folder_count = cab_reader_get_folder_count(cab);
+        continued = idx && obj->folder_count && cab_folder_count
+            && cab_extractor_is_continued(obj->cabinets[idx - 1], cab);
+        base = continued ? obj->folder_count - 1 : obj->folder_count;
+        for (folder_idx = 0; folder_idx < cab_folder_count; folder_idx++) {
+            const cab_reader_folder* cab_folder;
+            cab_extractor_folder* folder;
+            unsigned int block_idx;
+            cab_folder = cab_reader_get_folder(cab, folder_idx);
+            if (folder_idx == 0 && continued) {
+                folder = &obj->folders[base];
+                if (folder->type_compress != cab_folder->type_compress) {
+                    result = -1;
+                    errno = EINVAL;
+                    break;
+                }
+            } else {
+                folder = &obj->folders[obj->folder_count++];
+                folder->type_compress = cab_folder->type_compress;
+                folder->blocks = obj->blocks + block_used;
+                folder->block_count = 0;
+            }
+            for (block_idx = 0; block_idx < cab_folder->block_count;
+                block_idx++) {
+                folder->blocks[folder->block_count++] =
+                    &cab_folder->blocks[block_idx];
+                block_used++;
+            }
+        }
+        for (folder_idx = 0; result == 0
+            && folder_idx < cab_reader_get_file_count(cab); folder_idx++) {
+            const cab_reader_file* entry;
+            cab_extractor_file* file;
+            entry = cab_reader_get_file(cab, folder_idx);
+            if (entry->folder_index == CAB_READER_IFOLD_CONTINUED_FROM_PREV
+                || entry->folder_index
+                    == CAB_READER_IFOLD_CONTINUED_PREV_AND_NEXT) {
+                /* the file is listed in the previous cabinet */
+                continue;
+            }
+            file = &obj->files[obj->file_count++];
+            memset(file, 0, sizeof(*file));
+            file->entry = entry;
+            if (entry->folder_index == CAB_READER_IFOLD_CONTINUED_TO_NEXT) {
+                file->folder_index = base + cab_folder_count - 1;
+            } else {
+                file->folder_index = base + entry->folder_index;
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ * you get non zero if the first folder in the cabinet continues from the
+ * last folder in the previous cabinet
+ */
+static int
+cab_extractor_is_continued(
+    cab_reader* prev_cab,
+    cab_reader* cab)
+{
+    int result;
+    size_t idx;
+    result = 0;
+    for (idx = 0; !result && idx < cab_reader_get_file_count(prev_cab);
+        idx++) {
+        unsigned int folder_index;
+        folder_index = cab_reader_get_file(prev_cab, idx)->folder_index;
+        result = folder_index == CAB_READER_IFOLD_CONTINUED_TO_NEXT
+            || folder_index == CAB_READER_IFOLD_CONTINUED_PREV_AND_NEXT;
+    }
+    for (idx = 0; !result && idx < cab_reader_get_file_count(cab); idx++) {
+        unsigned int folder_index;
+        folder_index = cab_reader_get_file(cab, idx)->folder_index;
+        result = folder_index == CAB_READER_IFOLD_CONTINUED_FROM_PREV
+            || folder_index == CAB_READER_IFOLD_CONTINUED_PREV_AND_NEXT;
+    }
+    return result;
+}
+
+/**
+ * run job extracting files in a folder
+ */
+static void
+cab_extractor_job_run(
+    void* arg)
+{
+    cab_extractor_job* job;
+    cab_extractor* obj;
+    unsigned char* buffer;
+    unsigned char* join_buffer;
+    int result;
+    job = (cab_extractor_job*)arg;
+    obj = job->extractor;
+    buffer = (unsigned char*)cab_extractor_mem_alloc(
+        CAB_COMPRESSOR_BLOCK_SIZE);
+    join_buffer = (unsigned char*)cab_extractor_mem_alloc(
+        CAB_COMPRESSOR_MAX_COMPRESSED_SIZE);
+    result = buffer && join_buffer ? 0 : -1;
+    if (result == 0) {
+        result = cab_extractor_extract_folder(job, buffer, join_buffer);
+    }
+    if (result) {
+        job->result = result;
+        job->error = errno ? errno : EIO;
+    }
+    if (buffer) {
+        cab_extractor_mem_free(buffer);
+    }
+    if (join_buffer) {
+        cab_extractor_mem_free(join_buffer);
+    }
+    if (obj->pool) {
+        thread_i_mutex_lock(obj->lock);
+        obj->job_running_count--;
+        thread_i_cond_broadcast(obj->job_done);
+        thread_i_mutex_unlock(obj->lock);
+    }
+}
+
+/**
+ * extract files in a folder
+ */
+static int
+cab_extractor_extract_folder(
+    cab_extractor_job* job,
+    unsigned char* buffer,
+    unsigned char* join_buffer)
+{
+    int result;
+    unsigned long offset;
+    size_t first_file;
+    size_t idx;
+    cab_extractor_folder* folder;
+    cab_decompressor* decompressor;
+    folder = job->folder;
+    decompressor = NULL;
+    result = 0;
+    for (idx = 0; idx < job->file_count; idx++) {
+        if (!job->files[idx]->entry->size) {
+            /* empty file does not need data */
+            FILE* stream;
+            stream = file_i_fopen(job->files[idx]->path, "wb");
+            result = stream && fclose(stream) == 0 ? 0 : -1;
+            if (result) {
+                break;
+            }
+        }
+    }
+    if (result == 0 && job->size) {
+        decompressor = cab_decompressor_create(folder->type_compress);
+        result = decompressor ? 0 : -1;
+    }
+    offset = 0;
+    first_file = 0;
+    if (result == 0 && job->size) {
+        unsigned int join_size;
+        join_size = 0;
+        for (idx = 0; idx < folder->block_count && offset < job->size;
+            idx++) {
+            const cab_reader_block* block;
+            const unsigned char* src;
+            unsigned int src_size;
+            block = folder->blocks[idx];
+            result = cab_reader_verify_block(block);
+            if (result) {
+                break;
+            }
+            src = block->data;
+            src_size = block->compressed_size;
+            if (join_size || (!block->uncompressed_size
+                && idx + 1 < folder->block_count)) {
+                /* the block is split into cabinets */
+                if (join_size + src_size
+                    > CAB_COMPRESSOR_MAX_COMPRESSED_SIZE) {
+                    result = -1;
+                    errno = EINVAL;
+                    break;
+                }
+                memcpy(join_buffer + join_size, src, src_size);
+                join_size += src_size;
+                if (!block->uncompressed_size) {
+                    continue;
+                }
+                src = join_buffer;
+                src_size = join_size;
+                join_size = 0;
+            }
+            result = cab_decompressor_decompress(decompressor,
+                src, src_size, buffer, block->uncompressed_size);
+            if (result == 0) {
+                result = cab_extractor_write_files(job, &first_file,
+                    offset, buffer, block->uncompressed_size);
+            }
+            if (result) {
+                break;
+            }
+            offset += block->uncompressed_size;
+        }
+    }
+    if (result == 0 && offset < job->size) {
+        result = -1;
+        errno = EINVAL;
+    }
+    if (decompressor) {
+        cab_decompressor_free(decompressor);
+    }
+    return result;
+}
+
+/**
+ * close file and the writer
+ */
+static int
+cab_extractor_close_file(
+    cab_extractor_file* file)
+{
+    int result;
+    result = 0;
+    if (file->writer) {
+        result = buffered_writer_free(file->writer);
+        file->writer = NULL;
+    }
+    if (file->stream) {
+        int state;
+        state = fclose(file->stream);
+        file->stream = NULL;
+        if (result == 0) {
+            result = state;
+        }
+    }
+    return result;
+}
+
+/**
+ * write decompressed data into the files overlapping it
+ */
+static int
+cab_extractor_write_files(
+    cab_extractor_job* job,
+    size_t* first_file,
+    unsigned long offset,
+    const unsigned char* data,
+    unsigned int size)
+{
+    int result;
+    size_t idx;
+    unsigned long data_end;
+    cab_extractor_file** files;
+    result = 0;
+    files = job->files;
+    data_end = offset + size;
+    for (idx = *first_file; idx < job->file_count
+        && files[idx]->entry->offset < data_end; idx++) {
+        cab_extractor_file* file;
+        unsigned long write_start;
+        unsigned long write_end;
+        file = files[idx];
+        write_start = file->entry->offset + file->written;
+        write_end = file->entry->offset + file->entry->size;
+        if (write_start >= write_end || write_start < offset) {
+            continue;
+        }
+        if (write_end > data_end) {
+            write_end = data_end;
+        }
+        if (!file->stream) {
+            size_t buffer_size;
+            buffer_size = file->entry->size < CAB_EXTRACTOR_WRITE_BUFFER_SIZE
+                ? (size_t)file->entry->size : CAB_EXTRACTOR_WRITE_BUFFER_SIZE;
+            file->stream = file_i_fopen(file->path, "wb");
+            if (file->stream) {
+                file->writer = buffered_writer_create(file->stream,
+                    buffer_size, job->extractor->write_pool);
+            }
+            if (!file->writer) {
+                result = -1;
+                break;
+            }
+        }
+        result = buffered_writer_write(file->writer,
+            data + (write_start - offset), write_end - write_start);
+        if (result) {
+            break;
+        }
+        file->written += write_end - write_start;
+        if (file->written == file->entry->size) {
+            result = cab_extractor_close_file(file);
+            if (result) {
+                break;
+            }
+        }
+    }
+    while (*first_file < job->file_count && files[*first_file]->written
+        == files[*first_file]->entry->size) {
+        (*first_file)++;
+    }
+    return result;
+}
+
+/**
+ * compare files by folder and offset
+ */
+static int
+cab_extractor_compare_file(
+    const void* lhs,
+    const void* rhs)
+{
+    const cab_extractor_file* file_l;
+    const cab_extractor_file* file_r;
+    int result;
+    file_l = *(const cab_extractor_file* const*)lhs;
+    file_r = *(const cab_extractor_file* const*)rhs;
+    if (file_l->folder_index != file_r->folder_index) {
+        result = file_l->folder_index < file_r->folder_index ? -1 : 1;
+    } else if (file_l->entry->offset != file_r->entry->offset) {
+        result = file_l->entry->offset < file_r->entry->offset ? -1 : 1;
+    } else if (file_l != file_r) {
+        result = file_l < file_r ? -1 : 1;
+    } else {
+        result = 0;
+    }
+    return result;
+}
+
+/**
+ * compare jobs by size in descending order
+ */
+static int
+cab_extractor_compare_job(
+    const void* lhs,
+    const void* rhs)
+{
+    const cab_extractor_job* job_l;
+    const cab_extractor_job* job_r;
+    int result;
+    job_l = (const cab_extractor_job*)lhs;
+    job_r = (const cab_extractor_job*)rhs;
+    if (job_l->size != job_r->size) {
+        result = job_l->size > job_r->size ? -1 : 1;
+    } else if (job_l->files != job_r->files) {
+        result = job_l->files < job_r->files ? -1 : 1;
+    } else {
+        result = 0;
+    }
+    return result;
+}
+
+/**
+ * allocate memory
+ */
+static void*
+cab_extractor_mem_alloc(
+    size_t size)
+{
+    return malloc(size);
+}
+
+/**
+ * free memory
+ */
+static void
+cab_extractor_mem_free(
+    void* heap_obj)
+{
+    free(heap_obj);
+}
+
+/* vi: se ts=4 sw=4 et: */
@@ -0,0 +1,96 @@
+#ifndef __CAB_EXTRACTOR_H__
+#define __CAB_EXTRACTOR_H__
+
+#include <stddef.h>
+#include "cab_reader.h"
+#include "worker_pool.h"
+
+#ifdef __cplusplus
+#define _CAB_EXTRACTOR_ITFC_BEGIN extern "C" {
+#define _CAB_EXTRACTOR_ITFC_END }
+#else
+#define _CAB_EXTRACTOR_ITFC_BEGIN
+#define _CAB_EXTRACTOR_ITFC_END
+#endif
+
+_CAB_EXTRACTOR_ITFC_BEGIN
+
+/**
+ * files extractor for a cabinet set.
+ * The cabinets are read from mapped memory and the folders continued into
+ * the next cabinet are joined.
+ */
+typedef struct _cab_extractor cab_extractor;
+
+/**
+ * open the cabinet set including the cabinet file.
+ * The previous and the next cabinets are searched in the same directory.
+ */
+cab_extractor*
+cab_extractor_open(
+    const char* cab_path);
+
+/**
+ * close the cabinet set
+ */
+void
+cab_extractor_close(
+    cab_extractor* obj);
+
+/**
+ * get count of files in the cabinet set.
+ * A file continued across cabinets is counted once.
+ */
+size_t
+cab_extractor_get_file_count(
+    cab_extractor* obj);
+
+/**
+ * get file entry
+ */
+const cab_reader_file*
+cab_extractor_get_file(
+    cab_extractor* obj,
+    size_t index);
+
+/**
+ * set path where the file is extracted into.
+ * The file is not extracted if the path is not set. The parent directory
+ * has to exist when you extract files.
+ */
+int
+cab_extractor_set_file_path(
+    cab_extractor* obj,
+    size_t index,
+    const char* file_path);
+
+/**
+ * set count of threads extracting folders.
+ * Each folder is decompressed in a thread while the other folders are
+ * decompressed in the other threads.
+ */
+int
+cab_extractor_set_jobs(
+    cab_extractor* obj,
+    unsigned int jobs);
+
+/**
+ * set threads writing files in background while the data following them is
+ * decompressed. The pool has to be alive until the files are extracted.
+ */
+int
+cab_extractor_set_write_pool(
+    cab_extractor* obj,
+    worker_pool* pool);
+
+/**
+ * extract the files which have paths
+ */
+int
+cab_extractor_extract(
+    cab_extractor* obj);
+
+_CAB_EXTRACTOR_ITFC_END
+
+/* vi: se ts=4 sw=4 et: */
+#endif
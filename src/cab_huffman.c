@@ -0,0 +1,260 @@
+#include "cab_huffman.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+/**
+ * maximum code length to be handled while length limiting
+ */
+#define CAB_HUFFMAN_MAX_DEPTH 32
+
+/**
+ * symbol and frequency
+ */
+typedef struct _cab_huffman_symbol cab_huffman_symbol;
+
+/**
+ * symbol and frequency
+ */
+struct _cab_huffman_symbol {
+    /**
+     * frequency, and code length after calculation
+     */
+    unsigned int value;
+
+    /**
+     * symbol
+     */
+    unsigned int symbol;
+};
+
+/**
+ * compare symbols by frequency
+ */
+static int
+cab_huffman_compare_symbol(
+    const void* lhs,
+    const void* rhs);
+
+/**
+ * calculate minimum redundancy code lengths in place.
+ * symbols have to be sorted by frequency in ascending order.
+ */
+static void
+cab_huffman_calculate_lengths(
+    cab_huffman_symbol* symbols,
+    unsigned int count);
+
+/**
+ * limit code lengths and keep the code complete
+ */
+static void
+cab_huffman_limit_lengths(
+    unsigned int* length_counts,
+    unsigned int max_length);
+
+/**
+ * calculate length limited code lengths from symbol frequencies.
+ */
+int
+cab_huffman_build_lengths(
+    const unsigned int* frequencies,
+    unsigned int count,
+    unsigned int max_length,
+    uint8_t* lengths)
+{
+    int result;
+    result = 0;
+    if (frequencies && lengths && count <= CAB_HUFFMAN_MAX_SYMBOLS
+        && max_length > 0 && max_length < CAB_HUFFMAN_MAX_DEPTH
+        && count <= (1U << max_length)) {
+        cab_huffman_symbol symbols[CAB_HUFFMAN_MAX_SYMBOLS];
+        unsigned int length_counts[CAB_HUFFMAN_MAX_DEPTH + 1];
+        unsigned int used_count;
+        unsigned int idx;
+        used_count = 0;
+        memset(lengths, 0, count);
+        for (idx = 0; idx < count; idx++) {
+            if (frequencies[idx]) {
+                symbols[used_count].value = frequencies[idx];
+                symbols[used_count].symbol = idx;
+                used_count++;
+            }
+        }
+        if (used_count == 1 && count > 1) {
+            lengths[symbols[0].symbol] = 1;
+            lengths[symbols[0].symbol ? 0 : 1] = 1;
+        } else if (used_count > 1) {
+            unsigned int length;
+            unsigned int sym_idx;
+            qsort(symbols, used_count, sizeof(symbols[0]),
+                cab_huffman_compare_symbol);
+            cab_huffman_calculate_lengths(symbols, used_count);
+            memset(length_counts, 0, sizeof(length_counts));
+            for (idx = 0; idx < used_count; idx++) {
+                length = symbols[idx].value;
+                if (length > CAB_HUFFMAN_MAX_DEPTH) {
+                    length = CAB_HUFFMAN_MAX_DEPTH;
+                }
+                length_counts[length]++;
+            }
+            cab_huffman_limit_lengths(length_counts, max_length);
+            sym_idx = used_count;
+            for (length = 1; length <= max_length; length++) {
+                for (idx = 0; idx < length_counts[length]; idx++) {
+                    sym_idx--;
+                    lengths[symbols[sym_idx].symbol] = (uint8_t)length;
+                }
+            }
+        }
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * calculate canonical codes from code lengths.
+ */
+void
+cab_huffman_build_codes(
+    const uint8_t* lengths,
+    unsigned int count,
+    uint16_t* codes)
+{
+    unsigned int length_counts[CAB_HUFFMAN_MAX_DEPTH + 1];
+    unsigned int next_codes[CAB_HUFFMAN_MAX_DEPTH + 1];
+    unsigned int code;
+    unsigned int idx;
+    memset(length_counts, 0, sizeof(length_counts));
+    for (idx = 0; idx < count; idx++) {
+        length_counts[lengths[idx]]++;
+    }
+    length_counts[0] = 0;
+    code = 0;
+    for (idx = 1; idx <= CAB_HUFFMAN_MAX_DEPTH; idx++) {
+        code = (code + length_counts[idx - 1]) << 1;
+        next_codes[idx] = code;
+    }
+    for (idx = 0; idx < count; idx++) {
+        if (lengths[idx]) {
+            codes[idx] = (uint16_t)next_codes[lengths[idx]]++;
+        } else {
+            codes[idx] = 0;
+        }
+    }
+}
+
+/**
+ * compare symbols by frequency
+ */
+static int
+cab_huffman_compare_symbol(
+    const void* lhs,
+    const void* rhs)
+{
+    const cab_huffman_symbol* sym_l;
+    const cab_huffman_symbol* sym_r;
+    int result;
+    sym_l = (const cab_huffman_symbol*)lhs;
+    sym_r = (const cab_huffman_symbol*)rhs;
+    if (sym_l->value != sym_r->value) {
+        result = sym_l->value < sym_r->value ? -1 : 1;
+    } else {
+        result = sym_l->symbol < sym_r->symbol ? -1 : 1;
+    }
+    return result;
+}
+
+/**
+ * calculate minimum redundancy code lengths in place.
+ * This is the algorithm by Moffat and Katajainen.
+ */
+static void
+cab_huffman_calculate_lengths(
+    cab_huffman_symbol* symbols,
+    unsigned int count)
+{
+    int root;
+    int leaf;
+    int next;
+    int available;
+    int used;
+    int depth;
+    int size;
+    size = (int)count;
+    symbols[0].value += symbols[1].value;
+    root = 0;
+    leaf = 2;
+    for (next = 1; next < size - 1; next++) {
+        if (leaf >= size || symbols[root].value < symbols[leaf].value) {
+            symbols[next].value = symbols[root].value;
+            symbols[root++].value = (unsigned int)next;
+        } else {
+            symbols[next].value = symbols[leaf++].value;
+        }
+        if (leaf >= size || (root < next
+            && symbols[root].value < symbols[leaf].value)) {
+            symbols[next].value += symbols[root].value;
+            symbols[root++].value = (unsigned int)next;
+        } else {
+            symbols[next].value += symbols[leaf++].value;
+        }
+    }
+    symbols[size - 2].value = 0;
+    for (next = size - 3; next >= 0; next--) {
+        symbols[next].value = symbols[symbols[next].value].value + 1;
+    }
+    available = 1;
+    used = 0;
+    depth = 0;
+    root = size - 2;
+    next = size - 1;
+    while (available > 0) {
+        while (root >= 0 && (int)symbols[root].value == depth) {
+            used++;
+            root--;
+        }
+        while (available > used) {
+            symbols[next--].value = (unsigned int)depth;
+            available--;
+        }
+        available = 2 * used;
+        depth++;
+        used = 0;
+    }
+}
+
+/**
+ * limit code lengths and keep the code complete
+ */
+static void
+cab_huffman_limit_lengths(
+    unsigned int* length_counts,
+    unsigned int max_length)
+{
+    unsigned int idx;
+    unsigned long total;
+    for (idx = max_length + 1; idx <= CAB_HUFFMAN_MAX_DEPTH; idx++) {
+        length_counts[max_length] += length_counts[idx];
+        length_counts[idx] = 0;
+    }
+    total = 0;
+    for (idx = max_length; idx > 0; idx--) {
+        total += (unsigned long)length_counts[idx] << (max_length - idx);
+    }
+    while (total != (1UL << max_length)) {
+        length_counts[max_length]--;
+        for (idx = max_length - 1; idx > 0; idx--) {
+            if (length_counts[idx]) {
+                length_counts[idx]--;
+                length_counts[idx + 1] += 2;
+                break;
+            }
+        }
+        total--;
+    }
+}
+
+/* vi: se ts=4 sw=4 et: */
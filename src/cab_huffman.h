@@ -0,0 +1,48 @@
+#ifndef __CAB_HUFFMAN_H__
+#define __CAB_HUFFMAN_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+#define _CAB_HUFFMAN_ITFC_BEGIN extern "C" {
+#define _CAB_HUFFMAN_ITFC_END }
+#else
+#define _CAB_HUFFMAN_ITFC_BEGIN 
+#define _CAB_HUFFMAN_ITFC_END 
+#endif
+
+_CAB_HUFFMAN_ITFC_BEGIN 
+
+/**
+ * maximum count of symbols in a huffman tree
+ */
+#define CAB_HUFFMAN_MAX_SYMBOLS 768
+
+/**
+ * calculate length limited code lengths from symbol frequencies.
+ * The resulting code is complete. If only a symbol is used, an other
+ * symbol gets a code, so that decoders can build complete table.
+ * You get all zero lengths if no symbol is used.
+ */
+int
+cab_huffman_build_lengths(
+    const unsigned int* frequencies,
+    unsigned int count,
+    unsigned int max_length,
+    uint8_t* lengths);
+
+/**
+ * calculate canonical codes from code lengths.
+ * The codes are stored with most significant bit first.
+ */
+void
+cab_huffman_build_codes(
+    const uint8_t* lengths,
+    unsigned int count,
+    uint16_t* codes);
+
+_CAB_HUFFMAN_ITFC_END 
+
+/* vi: se ts=4 sw=4 et: */
+#endif
@@ -0,0 +1,1632 @@
+#include "cab_lzx.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include "cab_compressor.h"
+#include "cab_huffman.h"
+#include "cab_match_finder.h"
+
+/**
+ * minimum match length
+ */
+#define CAB_LZX_MIN_MATCH 2
+
+/**
+ * maximum match length
+ */
+#define CAB_LZX_MAX_MATCH 257
+
+/**
+ * count of literal symbols
+ */
+#define CAB_LZX_NUM_CHARS 256
+
+/**
+ * count of match lengths encoded in main symbol
+ */
+#define CAB_LZX_PRIMARY_LENGTHS 7
+
+/**
+ * count of length tree symbols
+ */
+#define CAB_LZX_SECONDARY_LENGTHS 249
+
+/**
+ * count of aligned offset tree symbols
+ */
+#define CAB_LZX_ALIGNED_SYMBOLS 8
+
+/**
+ * count of pretree symbols
+ */
+#define CAB_LZX_PRETREE_SYMBOLS 20
+
+/**
+ * maximum count of position slots
+ */
+#define CAB_LZX_MAX_POSITION_SLOTS 50
+
+/**
+ * maximum count of main tree symbols
+ */
+#define CAB_LZX_MAIN_MAX_SYMBOLS \
+    (CAB_LZX_NUM_CHARS + CAB_LZX_MAX_POSITION_SLOTS * 8)
+
+/**
+ * maximum code length for main and length tree
+ */
+#define CAB_LZX_MAX_CODE_LENGTH 16
+
+/**
+ * maximum code length for pretree
+ */
+#define CAB_LZX_PRETREE_MAX_LENGTH 15
+
+/**
+ * maximum code length for aligned offset tree
+ */
+#define CAB_LZX_ALIGNED_MAX_LENGTH 7
+
+/**
+ * verbatim block type
+ */
+#define CAB_LZX_BLOCKTYPE_VERBATIM 1
+
+/**
+ * aligned offset block type
+ */
+#define CAB_LZX_BLOCKTYPE_ALIGNED 2
+
+/**
+ * uncompressed block type
+ */
+#define CAB_LZX_BLOCKTYPE_UNCOMPRESSED 3
+
+/**
+ * no length tree symbol
+ */
+#define CAB_LZX_NO_LENGTH_SYMBOL 0xFFFF
+
+/**
+ * minimum length matches farther than this distance are ignored
+ */
+#define CAB_LZX_TOO_FAR 16384
+
+/**
+ * maximum matches to be kept for a position on optimal parsing
+ */
+#define CAB_LZX_OPTIMAL_MATCHES 8
+
+/**
+ * cost for unreachable position
+ */
+#define CAB_LZX_COST_INFINITE 0xFFFFFFFFU
+
+/**
+ * parsing strategy
+ */
+typedef enum {
+    /**
+     * take the longest match at each position
+     */
+    CAB_LZX_PARSE_GREEDY,
+    /**
+     * defer a match when the next position has longer match
+     */
+    CAB_LZX_PARSE_LAZY,
+    /**
+     * minimize estimated bit cost over a block
+     */
+    CAB_LZX_PARSE_OPTIMAL
+} cab_lzx_parse;
+
+/**
+ * compression parameters
+ */
+typedef struct _cab_lzx_params cab_lzx_params;
+
+/**
+ * encoded symbol
+ */
+typedef struct _cab_lzx_item cab_lzx_item;
+
+/**
+ * match candidate
+ */
+typedef struct _cab_lzx_candidate cab_lzx_candidate;
+
+/**
+ * bit writer
+ */
+typedef struct _cab_lzx_bit_writer cab_lzx_bit_writer;
+
+/**
+ * compression parameters
+ */
+struct _cab_lzx_params {
+    /**
+     * parsing strategy
+     */
+    cab_lzx_parse parse;
+
+    /**
+     * maximum count of candidates to be examined
+     */
+    unsigned int max_chain;
+
+    /**
+     * stop searching when a match reaches this length
+     */
+    unsigned int nice_length;
+
+    /**
+     * do not defer a match equal or longer than this length
+     */
+    unsigned int lazy_length;
+
+    /**
+     * count of cost estimation passes on optimal parsing
+     */
+    unsigned int iterations;
+
+    /**
+     * match finder mode
+     */
+    unsigned int match_finder;
+};
+
+/**
+ * encoded symbol
+ */
+struct _cab_lzx_item {
+    /**
+     * main tree symbol
+     */
+    uint16_t main_symbol;
+
+    /**
+     * length tree symbol or CAB_LZX_NO_LENGTH_SYMBOL
+     */
+    uint16_t length_symbol;
+
+    /**
+     * position footer
+     */
+    uint32_t extra_value;
+
+    /**
+     * bit count of position footer
+     */
+    uint8_t extra_bits;
+};
+
+/**
+ * match candidate
+ */
+struct _cab_lzx_candidate {
+    /**
+     * match length or zero
+     */
+    unsigned int length;
+
+    /**
+     * match distance
+     */
+    unsigned int distance;
+};
+
+/**
+ * bit writer.
+ * lzx stream consists of 16 bit little endian words, and bits are
+ * stored from most significant bit in a word.
+ */
+struct _cab_lzx_bit_writer {
+    /**
+     * output buffer
+     */
+    uint8_t* data;
+
+    /**
+     * output buffer size
+     */
+    unsigned int capacity;
+
+    /**
+     * written size
+     */
+    unsigned int size;
+
+    /**
+     * pending bits
+     */
+    uint32_t bits;
+
+    /**
+     * count of pending bits
+     */
+    unsigned int bit_count;
+
+    /**
+     * not zero if output buffer is overflowed
+     */
+    int overflow;
+};
+
+/**
+ * lzx compressor
+ */
+struct _cab_lzx {
+    /**
+     * compression parameters
+     */
+    const cab_lzx_params* params;
+
+    /**
+     * window size
+     */
+    unsigned int window_size;
+
+    /**
+     * count of main tree symbols
+     */
+    unsigned int main_symbols;
+
+    /**
+     * CAB_LZX_BLOCK_AUTO or CAB_LZX_BLOCK_VERBATIM
+     */
+    unsigned int block_type;
+
+    /**
+     * match finder
+     */
+    cab_match_finder* finder;
+
+    /**
+     * count of bytes compressed in current folder
+     */
+    uint32_t stream_position;
+
+    /**
+     * not zero if stream header was written
+     */
+    int header_written;
+
+    /**
+     * repeated offsets at block start
+     */
+    uint32_t repeats[3];
+
+    /**
+     * repeated offsets while parsing a block
+     */
+    uint32_t block_repeats[3];
+
+    /**
+     * main tree lengths of the last compressed block
+     */
+    uint8_t main_lengths[CAB_LZX_MAIN_MAX_SYMBOLS];
+
+    /**
+     * length tree lengths of the last compressed block
+     */
+    uint8_t length_lengths[CAB_LZX_SECONDARY_LENGTHS];
+
+    /**
+     * encoded symbols in a block
+     */
+    cab_lzx_item* items;
+
+    /**
+     * count of encoded symbols
+     */
+    unsigned int item_count;
+
+    /**
+     * matches for each position on optimal parsing
+     */
+    cab_match* matches;
+
+    /**
+     * count of matches for each position on optimal parsing
+     */
+    uint8_t* match_counts;
+
+    /**
+     * cost to reach each position on optimal parsing
+     */
+    uint32_t* costs;
+
+    /**
+     * selected length to reach each position on optimal parsing
+     */
+    uint16_t* choice_lengths;
+
+    /**
+     * selected distance to reach each position on optimal parsing
+     */
+    uint32_t* choice_distances;
+
+    /**
+     * repeated offsets after reaching each position on optimal parsing
+     */
+    uint32_t* choice_repeats;
+};
+
+/**
+ * compression parameters for presets
+ */
+static const cab_lzx_params CAB_LZX_PRESETS[] = {
+    {
+        CAB_LZX_PARSE_LAZY, 32, 64, 32, 0,
+        CAB_MATCH_FINDER_HASH_CHAIN
+    },
+    {
+        CAB_LZX_PARSE_GREEDY, 8, 32, 0, 0,
+        CAB_MATCH_FINDER_HASH_CHAIN
+    },
+    {
+        CAB_LZX_PARSE_LAZY, 32, 64, 32, 0,
+        CAB_MATCH_FINDER_HASH_CHAIN
+    },
+    {
+        CAB_LZX_PARSE_LAZY, 128, 257, 257, 0,
+        CAB_MATCH_FINDER_BINARY_TREE
+    },
+    {
+        CAB_LZX_PARSE_OPTIMAL, 256, 257, 257, 2,
+        CAB_MATCH_FINDER_BINARY_TREE
+    }
+};
+
+/**
+ * count of position slots for window bits from 15 to 21
+ */
+static const uint8_t CAB_LZX_POSITION_SLOTS[] = {
+    30, 32, 34, 36, 38, 42, 50
+};
+
+/**
+ * base formatted offset for position slots
+ */
+static const uint32_t CAB_LZX_POSITION_BASE[] = {
+    0, 1, 2, 3, 4, 6, 8, 12, 16, 24, 32, 48, 64, 96, 128, 192,
+    256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096, 6144, 8192, 12288,
+    16384, 24576, 32768, 49152, 65536, 98304, 131072, 196608, 262144,
+    393216, 524288, 655360, 786432, 917504, 1048576, 1179648, 1310720,
+    1441792, 1572864, 1703936, 1835008, 1966080
+};
+
+/**
+ * extra bits for position slots
+ */
+static const uint8_t CAB_LZX_EXTRA_BITS[] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13, 14, 14,
+    15, 15, 16, 16, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17,
+    17, 17
+};
+
+/**
+ * get position slot for formatted offset
+ */
+static unsigned int
+cab_lzx_position_slot(
+    uint32_t formatted_offset);
+
+/**
+ * get match length at the distance
+ */
+static unsigned int
+cab_lzx_match_length(
+    const uint8_t* current,
+    unsigned int distance,
+    unsigned int max_length);
+
+/**
+ * find the best candidate at current position
+ */
+static void
+cab_lzx_find_candidate(
+    cab_lzx* obj,
+    const uint8_t* current,
+    uint32_t position,
+    unsigned int max_length,
+    cab_lzx_candidate* candidate);
+
+/**
+ * parse a block with greedy or lazy matching
+ */
+static void
+cab_lzx_parse_lazy(
+    cab_lzx* obj,
+    const uint8_t* src,
+    unsigned int src_size);
+
+/**
+ * parse a block with optimal parsing.
+ * The block is read from the window of the match finder.
+ */
+static void
+cab_lzx_parse_optimal(
+    cab_lzx* obj,
+    unsigned int src_size);
+
+/**
+ * find the cheapest path with the costs
+ */
+static void
+cab_lzx_find_cheapest(
+    cab_lzx* obj,
+    const uint8_t* data,
+    unsigned int src_size,
+    const uint32_t* main_costs,
+    const uint32_t* length_costs);
+
+/**
+ * calculate bit costs from code lengths
+ */
+static void
+cab_lzx_lengths_to_costs(
+    cab_lzx* obj,
+    const uint8_t* main_lengths,
+    const uint8_t* length_lengths,
+    uint32_t* main_costs,
+    uint32_t* length_costs);
+
+/**
+ * append a literal symbol
+ */
+static void
+cab_lzx_add_literal(
+    cab_lzx* obj,
+    unsigned int literal);
+
+/**
+ * append a match symbol and update repeated offsets
+ */
+static void
+cab_lzx_add_match(
+    cab_lzx* obj,
+    unsigned int length,
+    unsigned int distance);
+
+/**
+ * count symbol frequencies
+ */
+static void
+cab_lzx_count_frequencies(
+    cab_lzx* obj,
+    unsigned int* main_freqs,
+    unsigned int* length_freqs,
+    unsigned int* aligned_freqs);
+
+/**
+ * build main and length tree code lengths for current symbols
+ */
+static void
+cab_lzx_build_lengths(
+    cab_lzx* obj,
+    const unsigned int* main_freqs,
+    const unsigned int* length_freqs,
+    uint8_t* main_lengths,
+    uint8_t* length_lengths);
+
+/**
+ * write a compressed block
+ */
+static void
+cab_lzx_write_compressed_block(
+    cab_lzx* obj,
+    unsigned int block_size,
+    cab_lzx_bit_writer* writer,
+    uint8_t* main_lengths,
+    uint8_t* length_lengths);
+
+/**
+ * write an uncompressed block
+ */
+static void
+cab_lzx_write_uncompressed_block(
+    cab_lzx* obj,
+    const uint8_t* src,
+    unsigned int src_size,
+    cab_lzx_bit_writer* writer);
+
+/**
+ * write code lengths delta encoded with pretree
+ */
+static void
+cab_lzx_write_lengths(
+    cab_lzx_bit_writer* writer,
+    const uint8_t* prev_lengths,
+    const uint8_t* lengths,
+    unsigned int count);
+
+/**
+ * get bit size of uncompressed block
+ */
+static unsigned long
+cab_lzx_uncompressed_bit_size(
+    const cab_lzx_bit_writer* writer,
+    unsigned int src_size);
+
+/**
+ * get written bit size
+ */
+static unsigned long
+cab_lzx_bit_size(
+    const cab_lzx_bit_writer* writer);
+
+/**
+ * write bits
+ */
+static void
+cab_lzx_put_bits(
+    cab_lzx_bit_writer* writer,
+    uint32_t value,
+    unsigned int count);
+
+/**
+ * write bytes at 16 bit boundary
+ */
+static void
+cab_lzx_put_bytes(
+    cab_lzx_bit_writer* writer,
+    const void* data,
+    unsigned int size);
+
+/**
+ * write pending bits with padding to 16 bit boundary
+ */
+static void
+cab_lzx_align_bits(
+    cab_lzx_bit_writer* writer);
+
+/**
+ * allocate memory
+ */
+static void*
+cab_lzx_mem_alloc(
+    size_t size);
+
+/**
+ * free memory
+ */
+static void
+cab_lzx_mem_free(
+    void* heap_obj);
+
+/**
+ * create lzx compressor.
+ */
+cab_lzx*
+cab_lzx_create(
+    unsigned int window_bits,
+    unsigned int preset,
+    unsigned int match_finder,
+    unsigned int block_type)
+{
+    cab_lzx* result;
+    result = NULL;
+    if (window_bits >= CAB_LZX_WINDOW_BITS_MIN
+        && window_bits <= CAB_LZX_WINDOW_BITS_MAX
+        && preset < sizeof(CAB_LZX_PRESETS) / sizeof(CAB_LZX_PRESETS[0])
+        && match_finder <= CAB_LZX_MATCH_FINDER_BINARY_TREE
+        && block_type <= CAB_LZX_BLOCK_VERBATIM) {
+        result = (cab_lzx*)cab_lzx_mem_alloc(sizeof(cab_lzx));
+    } else {
+        errno = EINVAL;
+    }
+    if (result) {
+        int state;
+        unsigned int finder_mode;
+        memset(result, 0, sizeof(*result));
+        result->params = &CAB_LZX_PRESETS[preset];
+        result->window_size = 1U << window_bits;
+        result->main_symbols = CAB_LZX_NUM_CHARS
+            + CAB_LZX_POSITION_SLOTS[window_bits - CAB_LZX_WINDOW_BITS_MIN]
+            * 8;
+        result->block_type = block_type;
+        switch (match_finder) {
+        case CAB_LZX_MATCH_FINDER_HASH_CHAIN:
+            finder_mode = CAB_MATCH_FINDER_HASH_CHAIN;
+            break;
+        case CAB_LZX_MATCH_FINDER_BINARY_TREE:
+            finder_mode = CAB_MATCH_FINDER_BINARY_TREE;
+            break;
+        default:
+            finder_mode = result->params->match_finder;
+            break;
+        }
+        result->finder = cab_match_finder_create(result->window_size,
+            finder_mode, result->params->max_chain,
+            result->params->nice_length);
+        result->items = (cab_lzx_item*)cab_lzx_mem_alloc(
+            sizeof(cab_lzx_item) * CAB_COMPRESSOR_BLOCK_SIZE);
+        state = result->finder && result->items ? 0 : -1;
+        if (state == 0 && result->params->parse == CAB_LZX_PARSE_OPTIMAL) {
+            result->matches = (cab_match*)cab_lzx_mem_alloc(
+                sizeof(cab_match) * CAB_LZX_OPTIMAL_MATCHES
+                * CAB_COMPRESSOR_BLOCK_SIZE);
+            result->match_counts = (uint8_t*)cab_lzx_mem_alloc(
+                CAB_COMPRESSOR_BLOCK_SIZE);
+            result->costs = (uint32_t*)cab_lzx_mem_alloc(
+                sizeof(uint32_t) * (CAB_COMPRESSOR_BLOCK_SIZE + 1));
+            result->choice_lengths = (uint16_t*)cab_lzx_mem_alloc(
+                sizeof(uint16_t) * (CAB_COMPRESSOR_BLOCK_SIZE + 1));
+            result->choice_distances = (uint32_t*)cab_lzx_mem_alloc(
+                sizeof(uint32_t) * (CAB_COMPRESSOR_BLOCK_SIZE + 1));
+            result->choice_repeats = (uint32_t*)cab_lzx_mem_alloc(
+                sizeof(uint32_t) * 3 * (CAB_COMPRESSOR_BLOCK_SIZE + 1));
+            state = result->matches && result->match_counts
+                && result->costs && result->choice_lengths
+                && result->choice_distances && result->choice_repeats ?
+                0 : -1;
+        }
+        if (state == 0) {
+            cab_lzx_reset(result);
+        } else {
+            cab_lzx_free(result);
+            result = NULL;
+        }
+    }
+    return result;
+}
+
+/**
+ * free lzx compressor
+ */
+void
+cab_lzx_free(
+    cab_lzx* obj)
+{
+    if (obj) {
+        if (obj->finder) {
+            cab_match_finder_free(obj->finder);
+        }
+        if (obj->items) {
+            cab_lzx_mem_free(obj->items);
+        }
+        if (obj->matches) {
+            cab_lzx_mem_free(obj->matches);
+        }
+        if (obj->match_counts) {
+            cab_lzx_mem_free(obj->match_counts);
+        }
+        if (obj->costs) {
+            cab_lzx_mem_free(obj->costs);
+        }
+        if (obj->choice_lengths) {
+            cab_lzx_mem_free(obj->choice_lengths);
+        }
+        if (obj->choice_distances) {
+            cab_lzx_mem_free(obj->choice_distances);
+        }
+        if (obj->choice_repeats) {
+            cab_lzx_mem_free(obj->choice_repeats);
+        }
+        cab_lzx_mem_free(obj);
+    }
+}
+
+/**
+ * reset compressor to begin new folder
+ */
+int
+cab_lzx_reset(
+    cab_lzx* obj)
+{
+    int result;
+    if (obj) {
+        result = 0;
+        cab_match_finder_reset(obj->finder);
+        obj->stream_position = 0;
+        obj->header_written = 0;
+        obj->repeats[0] = 1;
+        obj->repeats[1] = 1;
+        obj->repeats[2] = 1;
+        memset(obj->main_lengths, 0, sizeof(obj->main_lengths));
+        memset(obj->length_lengths, 0, sizeof(obj->length_lengths));
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * compress a data block into a lzx frame.
+ * A frame has a block which covers the whole data block, and it is padded
+ * to 16 bit boundary.
+ */
+int
+cab_lzx_compress(
+    cab_lzx* obj,
+    const void* src,
+    unsigned int src_size,
+    void* dst,
+    unsigned int* dst_size)
+{
+    int result;
+    if (obj && src && dst && dst_size && src_size
+        && src_size <= CAB_COMPRESSOR_BLOCK_SIZE) {
+        result = cab_match_finder_append(obj->finder, src, src_size);
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    if (result == 0) {
+        cab_lzx_bit_writer writer;
+        cab_lzx_bit_writer block_start;
+        uint8_t main_lengths[CAB_LZX_MAIN_MAX_SYMBOLS];
+        uint8_t length_lengths[CAB_LZX_SECONDARY_LENGTHS];
+        memset(&writer, 0, sizeof(writer));
+        writer.data = (uint8_t*)dst;
+        writer.capacity = CAB_COMPRESSOR_MAX_COMPRESSED_SIZE;
+        if (!obj->header_written) {
+            /* no intel e8 call translation */
+            cab_lzx_put_bits(&writer, 0, 1);
+        }
+        obj->item_count = 0;
+        memcpy(obj->block_repeats, obj->repeats, sizeof(obj->repeats));
+        if (obj->params->parse == CAB_LZX_PARSE_OPTIMAL) {
+            cab_lzx_parse_optimal(obj, src_size);
+        } else {
+            cab_lzx_parse_lazy(obj, (const uint8_t*)src, src_size);
+        }
+        block_start = writer;
+        cab_lzx_write_compressed_block(obj, src_size, &writer,
+            main_lengths, length_lengths);
+        if (writer.overflow
+            || cab_lzx_bit_size(&writer) - cab_lzx_bit_size(&block_start)
+                > cab_lzx_uncompressed_bit_size(&block_start, src_size)) {
+            writer = block_start;
+            cab_lzx_write_uncompressed_block(obj,
+                (const uint8_t*)src, src_size, &writer);
+        } else {
+            memcpy(obj->repeats, obj->block_repeats, sizeof(obj->repeats));
+            memcpy(obj->main_lengths, main_lengths, obj->main_symbols);
+            memcpy(obj->length_lengths, length_lengths,
+                sizeof(obj->length_lengths));
+        }
+        cab_lzx_align_bits(&writer);
+        if (writer.overflow) {
+            result = -1;
+            errno = ENOBUFS;
+        } else {
+            obj->header_written = 1;
+            obj->stream_position += src_size;
+            *dst_size = writer.size;
+        }
+    }
+    return result;
+}
+
+/**
+ * get position slot for formatted offset
+ */
+static unsigned int
+cab_lzx_position_slot(
+    uint32_t formatted_offset)
+{
+    unsigned int result;
+    if (formatted_offset < 4) {
+        result = formatted_offset;
+    } else if (formatted_offset < CAB_LZX_POSITION_BASE[36]) {
+        unsigned int bits;
+        bits = 0;
+        while ((formatted_offset >> (bits + 1)) != 0) {
+            bits++;
+        }
+        result = bits * 2 + ((formatted_offset >> (bits - 1)) & 1);
+    } else {
+        result = 36 + ((formatted_offset - CAB_LZX_POSITION_BASE[36]) >> 17);
+    }
+    return result;
+}
+
+/**
+ * get match length at the distance
+ */
+static unsigned int
+cab_lzx_match_length(
+    const uint8_t* current,
+    unsigned int distance,
+    unsigned int max_length)
+{
+    unsigned int result;
+    const uint8_t* reference;
+    reference = current - distance;
+    result = 0;
+    while (result < max_length && reference[result] == current[result]) {
+        result++;
+    }
+    return result;
+}
+
+/**
+ * find the best candidate at current position.
+ * A repeated offset match is preferred when it is almost as long as the
+ * longest match, because it has no position footer.
+ */
+static void
+cab_lzx_find_candidate(
+    cab_lzx* obj,
+    const uint8_t* current,
+    uint32_t position,
+    unsigned int max_length,
+    cab_lzx_candidate* candidate)
+{
+    cab_match matches[CAB_MATCH_FINDER_MAX_MATCHES];
+    unsigned int count;
+    unsigned int match_length;
+    unsigned int match_distance;
+    unsigned int repeat_length;
+    unsigned int repeat_distance;
+    unsigned int idx;
+    count = cab_match_finder_find(obj->finder, max_length, matches);
+    while (count && matches[count - 1].distance > obj->window_size - 3) {
+        count--;
+    }
+    match_length = 0;
+    match_distance = 0;
+    if (count) {
+        match_length = matches[count - 1].length;
+        match_distance = matches[count - 1].distance;
+        if (match_length == CAB_MATCH_FINDER_MIN_MATCH
+            && match_distance > CAB_LZX_TOO_FAR) {
+            match_length = 0;
+        }
+    }
+    repeat_length = 0;
+    repeat_distance = 0;
+    for (idx = 0; idx < 3; idx++) {
+        if (obj->block_repeats[idx] <= position) {
+            unsigned int length;
+            length = cab_lzx_match_length(current,
+                obj->block_repeats[idx], max_length);
+            if (length > repeat_length) {
+                repeat_length = length;
+                repeat_distance = obj->block_repeats[idx];
+            }
+        }
+    }
+    if (repeat_length >= CAB_LZX_MIN_MATCH
+        && repeat_length + 1 >= match_length) {
+        candidate->length = repeat_length;
+        candidate->distance = repeat_distance;
+    } else {
+        candidate->length = match_length;
+        candidate->distance = match_distance;
+    }
+}
+
+/**
+ * parse a block with greedy or lazy matching
+ */
+static void
+cab_lzx_parse_lazy(
+    cab_lzx* obj,
+    const uint8_t* src,
+    unsigned int src_size)
+{
+    unsigned int position;
+    cab_lzx_candidate prev;
+    int prev_available;
+    const uint8_t* data;
+    /* the window data before the block is referred by repeated offsets */
+    data = cab_match_finder_get_current(obj->finder);
+    position = 0;
+    prev.length = 0;
+    prev.distance = 0;
+    prev_available = 0;
+    while (position < src_size) {
+        cab_lzx_candidate candidate;
+        unsigned int max_length;
+        max_length = src_size - position;
+        if (max_length > CAB_LZX_MAX_MATCH) {
+            max_length = CAB_LZX_MAX_MATCH;
+        }
+        cab_lzx_find_candidate(obj, data + position,
+            obj->stream_position + position, max_length, &candidate);
+        if (prev.length >= CAB_LZX_MIN_MATCH
+            && candidate.length <= prev.length) {
+            cab_lzx_add_match(obj, prev.length, prev.distance);
+            cab_match_finder_skip(obj->finder, prev.length - 2);
+            position += prev.length - 1;
+            prev.length = 0;
+            prev_available = 0;
+        } else {
+            if (prev_available) {
+                cab_lzx_add_literal(obj, src[position - 1]);
+            }
+            if (candidate.length >= CAB_LZX_MIN_MATCH
+                && candidate.length >= obj->params->lazy_length) {
+                cab_lzx_add_match(obj, candidate.length, candidate.distance);
+                cab_match_finder_skip(obj->finder, candidate.length - 1);
+                position += candidate.length;
+                prev.length = 0;
+                prev_available = 0;
+            } else {
+                prev = candidate;
+                prev_available = 1;
+                position++;
+            }
+        }
+    }
+    if (prev_available) {
+        cab_lzx_add_literal(obj, src[src_size - 1]);
+    }
+}
+
+/**
+ * parse a block with optimal parsing
+ */
+static void
+cab_lzx_parse_optimal(
+    cab_lzx* obj,
+    unsigned int src_size)
+{
+    unsigned int position;
+    unsigned int iteration;
+    uint8_t main_lengths[CAB_LZX_MAIN_MAX_SYMBOLS];
+    uint8_t length_lengths[CAB_LZX_SECONDARY_LENGTHS];
+    uint32_t main_costs[CAB_LZX_MAIN_MAX_SYMBOLS];
+    uint32_t length_costs[CAB_LZX_SECONDARY_LENGTHS];
+    const uint8_t* data;
+    /* the window data before the block is referred by repeated offsets */
+    data = cab_match_finder_get_current(obj->finder);
+    for (position = 0; position < src_size; position++) {
+        cab_match matches[CAB_MATCH_FINDER_MAX_MATCHES];
+        unsigned int count;
+        unsigned int max_length;
+        unsigned int first;
+        max_length = src_size - position;
+        if (max_length > CAB_LZX_MAX_MATCH) {
+            max_length = CAB_LZX_MAX_MATCH;
+        }
+        count = cab_match_finder_find(obj->finder, max_length, matches);
+        while (count && matches[count - 1].distance > obj->window_size - 3) {
+            count--;
+        }
+        first = count > CAB_LZX_OPTIMAL_MATCHES ?
+            count - CAB_LZX_OPTIMAL_MATCHES : 0;
+        memcpy(obj->matches + position * CAB_LZX_OPTIMAL_MATCHES,
+            matches + first, sizeof(cab_match) * (count - first));
+        obj->match_counts[position] = (uint8_t)(count - first);
+    }
+    memcpy(main_lengths, obj->main_lengths, sizeof(main_lengths));
+    memcpy(length_lengths, obj->length_lengths, sizeof(length_lengths));
+    for (iteration = 0; iteration < obj->params->iterations; iteration++) {
+        cab_lzx_lengths_to_costs(obj, main_lengths, length_lengths,
+            main_costs, length_costs);
+        obj->item_count = 0;
+        memcpy(obj->block_repeats, obj->repeats, sizeof(obj->repeats));
+        cab_lzx_find_cheapest(obj, data, src_size,
+            main_costs, length_costs);
+        if (iteration + 1 < obj->params->iterations) {
+            unsigned int main_freqs[CAB_LZX_MAIN_MAX_SYMBOLS];
+            unsigned int length_freqs[CAB_LZX_SECONDARY_LENGTHS];
+            unsigned int aligned_freqs[CAB_LZX_ALIGNED_SYMBOLS];
+            cab_lzx_count_frequencies(obj,
+                main_freqs, length_freqs, aligned_freqs);
+            cab_lzx_build_lengths(obj, main_freqs, length_freqs,
+                main_lengths, length_lengths);
+        }
+    }
+}
+
+/**
+ * find the cheapest path with the costs.
+ * Each position keeps the repeated offsets of the cheapest arrival.
+ */
+static void
+cab_lzx_find_cheapest(
+    cab_lzx* obj,
+    const uint8_t* data,
+    unsigned int src_size,
+    const uint32_t* main_costs,
+    const uint32_t* length_costs)
+{
+    unsigned int position;
+    uint32_t* costs;
+    costs = obj->costs;
+    costs[0] = 0;
+    memcpy(obj->choice_repeats, obj->repeats, sizeof(obj->repeats));
+    for (position = 1; position <= src_size; position++) {
+        costs[position] = CAB_LZX_COST_INFINITE;
+    }
+    for (position = 0; position < src_size; position++) {
+        const uint32_t* repeats;
+        const cab_match* matches;
+        unsigned int count;
+        unsigned int max_length;
+        unsigned int idx;
+        unsigned int length;
+        uint32_t stream_position;
+        uint32_t cost;
+        repeats = obj->choice_repeats + position * 3;
+        stream_position = obj->stream_position + position;
+        max_length = src_size - position;
+        if (max_length > CAB_LZX_MAX_MATCH) {
+            max_length = CAB_LZX_MAX_MATCH;
+        }
+        cost = costs[position] + main_costs[data[position]];
+        if (cost < costs[position + 1]) {
+            costs[position + 1] = cost;
+            obj->choice_lengths[position + 1] = 1;
+            obj->choice_distances[position + 1] = 0;
+            memcpy(obj->choice_repeats + (position + 1) * 3, repeats,
+                sizeof(uint32_t) * 3);
+        }
+        for (idx = 0; idx < 3; idx++) {
+            unsigned int repeat_length;
+            if (repeats[idx] > stream_position) {
+                continue;
+            }
+            repeat_length = cab_lzx_match_length(data + position,
+                repeats[idx], max_length);
+            for (length = CAB_LZX_MIN_MATCH; length <= repeat_length;
+                length++) {
+                unsigned int header;
+                header = length - CAB_LZX_MIN_MATCH;
+                if (header >= CAB_LZX_PRIMARY_LENGTHS) {
+                    cost = length_costs[header - CAB_LZX_PRIMARY_LENGTHS];
+                    header = CAB_LZX_PRIMARY_LENGTHS;
+                } else {
+                    cost = 0;
+                }
+                cost += costs[position]
+                    + main_costs[CAB_LZX_NUM_CHARS + idx * 8 + header];
+                if (cost < costs[position + length]) {
+                    uint32_t* next_repeats;
+                    costs[position + length] = cost;
+                    obj->choice_lengths[position + length] = (uint16_t)length;
+                    obj->choice_distances[position + length] = repeats[idx];
+                    next_repeats = obj->choice_repeats
+                        + (position + length) * 3;
+                    memcpy(next_repeats, repeats, sizeof(uint32_t) * 3);
+                    next_repeats[0] = repeats[idx];
+                    next_repeats[idx] = repeats[0];
+                }
+            }
+        }
+        matches = obj->matches + position * CAB_LZX_OPTIMAL_MATCHES;
+        count = obj->match_counts[position];
+        length = CAB_MATCH_FINDER_MIN_MATCH;
+        for (idx = 0; idx < count; idx++) {
+            unsigned int slot;
+            uint32_t distance;
+            uint32_t match_cost;
+            distance = matches[idx].distance;
+            if (distance == repeats[0] || distance == repeats[1]
+                || distance == repeats[2]) {
+                length = matches[idx].length + 1;
+                continue;
+            }
+            slot = cab_lzx_position_slot(distance + 2);
+            match_cost = costs[position] + CAB_LZX_EXTRA_BITS[slot];
+            for (; length <= matches[idx].length; length++) {
+                unsigned int header;
+                header = length - CAB_LZX_MIN_MATCH;
+                if (header >= CAB_LZX_PRIMARY_LENGTHS) {
+                    cost = length_costs[header - CAB_LZX_PRIMARY_LENGTHS];
+                    header = CAB_LZX_PRIMARY_LENGTHS;
+                } else {
+                    cost = 0;
+                }
+                cost += match_cost
+                    + main_costs[CAB_LZX_NUM_CHARS + slot * 8 + header];
+                if (cost < costs[position + length]) {
+                    uint32_t* next_repeats;
+                    costs[position + length] = cost;
+                    obj->choice_lengths[position + length] = (uint16_t)length;
+                    obj->choice_distances[position + length] = distance;
+                    next_repeats = obj->choice_repeats
+                        + (position + length) * 3;
+                    next_repeats[0] = distance;
+                    next_repeats[1] = repeats[0];
+                    next_repeats[2] = repeats[1];
+                }
+            }
+        }
+    }
+    /* link each step to the next step in costs which are no longer used */
+    position = src_size;
+    while (position > 0) {
+        unsigned int prev_position;
+        prev_position = position - obj->choice_lengths[position];
+        costs[prev_position] = position;
+        position = prev_position;
+    }
+    position = 0;
+    while (position < src_size) {
+        unsigned int next_position;
+        next_position = costs[position];
+        if (next_position - position == 1) {
+            cab_lzx_add_literal(obj, data[position]);
+        } else {
+            cab_lzx_add_match(obj, next_position - position,
+                obj->choice_distances[next_position]);
+        }
+        position = next_position;
+    }
+}
+
+/**
+ * calculate bit costs from code lengths.
+ * The symbols without code are estimated as the longest code.
+ */
+static void
+cab_lzx_lengths_to_costs(
+    cab_lzx* obj,
+    const uint8_t* main_lengths,
+    const uint8_t* length_lengths,
+    uint32_t* main_costs,
+    uint32_t* length_costs)
+{
+    unsigned int idx;
+    int has_lengths;
+    has_lengths = 0;
+    for (idx = 0; idx < obj->main_symbols; idx++) {
+        if (main_lengths[idx]) {
+            has_lengths = 1;
+            break;
+        }
+    }
+    for (idx = 0; idx < obj->main_symbols; idx++) {
+        if (has_lengths) {
+            main_costs[idx] = main_lengths[idx] ?
+                main_lengths[idx] : CAB_LZX_MAX_CODE_LENGTH;
+        } else {
+            main_costs[idx] = idx < CAB_LZX_NUM_CHARS ? 8 : 10;
+        }
+    }
+    for (idx = 0; idx < CAB_LZX_SECONDARY_LENGTHS; idx++) {
+        if (has_lengths) {
+            length_costs[idx] = length_lengths[idx] ?
+                length_lengths[idx] : CAB_LZX_MAX_CODE_LENGTH;
+        } else {
+            length_costs[idx] = 8;
+        }
+    }
+}
+
+/**
+ * append a literal symbol
+ */
+static void
+cab_lzx_add_literal(
+    cab_lzx* obj,
+    unsigned int literal)
+{
+    cab_lzx_item* item;
+    item = &obj->items[obj->item_count++];
+    item->main_symbol = (uint16_t)literal;
+    item->length_symbol = CAB_LZX_NO_LENGTH_SYMBOL;
+    item->extra_value = 0;
+    item->extra_bits = 0;
+}
+
+/**
+ * append a match symbol and update repeated offsets
+ */
+static void
+cab_lzx_add_match(
+    cab_lzx* obj,
+    unsigned int length,
+    unsigned int distance)
+{
+    cab_lzx_item* item;
+    uint32_t* repeats;
+    unsigned int slot;
+    unsigned int header;
+    item = &obj->items[obj->item_count++];
+    repeats = obj->block_repeats;
+    item->extra_value = 0;
+    item->extra_bits = 0;
+    if (distance == repeats[0]) {
+        slot = 0;
+    } else if (distance == repeats[1]) {
+        slot = 1;
+        repeats[1] = repeats[0];
+        repeats[0] = distance;
+    } else if (distance == repeats[2]) {
+        slot = 2;
+        repeats[2] = repeats[0];
+        repeats[0] = distance;
+    } else {
+        uint32_t formatted_offset;
+        formatted_offset = distance + 2;
+        slot = cab_lzx_position_slot(formatted_offset);
+        item->extra_value = formatted_offset - CAB_LZX_POSITION_BASE[slot];
+        item->extra_bits = CAB_LZX_EXTRA_BITS[slot];
+        repeats[2] = repeats[1];
+        repeats[1] = repeats[0];
+        repeats[0] = distance;
+    }
+    header = length - CAB_LZX_MIN_MATCH;
+    if (header >= CAB_LZX_PRIMARY_LENGTHS) {
+        item->length_symbol = (uint16_t)(header - CAB_LZX_PRIMARY_LENGTHS);
+        header = CAB_LZX_PRIMARY_LENGTHS;
+    } else {
+        item->length_symbol = CAB_LZX_NO_LENGTH_SYMBOL;
+    }
+    item->main_symbol = (uint16_t)(CAB_LZX_NUM_CHARS + slot * 8 + header);
+}
+
+/**
+ * count symbol frequencies
+ */
+static void
+cab_lzx_count_frequencies(
+    cab_lzx* obj,
+    unsigned int* main_freqs,
+    unsigned int* length_freqs,
+    unsigned int* aligned_freqs)
+{
+    unsigned int idx;
+    memset(main_freqs, 0, sizeof(unsigned int) * CAB_LZX_MAIN_MAX_SYMBOLS);
+    memset(length_freqs, 0,
+        sizeof(unsigned int) * CAB_LZX_SECONDARY_LENGTHS);
+    memset(aligned_freqs, 0, sizeof(unsigned int) * CAB_LZX_ALIGNED_SYMBOLS);
+    for (idx = 0; idx < obj->item_count; idx++) {
+        const cab_lzx_item* item;
+        item = &obj->items[idx];
+        main_freqs[item->main_symbol]++;
+        if (item->length_symbol != CAB_LZX_NO_LENGTH_SYMBOL) {
+            length_freqs[item->length_symbol]++;
+        }
+        if (item->extra_bits >= 3) {
+            aligned_freqs[item->extra_value & 7]++;
+        }
+    }
+}
+
+/**
+ * build main and length tree code lengths for current symbols.
+ * The length tree gets a complete code even if no symbol is used.
+ */
+static void
+cab_lzx_build_lengths(
+    cab_lzx* obj,
+    const unsigned int* main_freqs,
+    const unsigned int* length_freqs,
+    uint8_t* main_lengths,
+    uint8_t* length_lengths)
+{
+    unsigned int idx;
+    memset(main_lengths, 0, CAB_LZX_MAIN_MAX_SYMBOLS);
+    cab_huffman_build_lengths(main_freqs, obj->main_symbols,
+        CAB_LZX_MAX_CODE_LENGTH, main_lengths);
+    cab_huffman_build_lengths(length_freqs, CAB_LZX_SECONDARY_LENGTHS,
+        CAB_LZX_MAX_CODE_LENGTH, length_lengths);
+    for (idx = 0; idx < CAB_LZX_SECONDARY_LENGTHS; idx++) {
+        if (length_lengths[idx]) {
+            break;
+        }
+    }
+    if (idx == CAB_LZX_SECONDARY_LENGTHS) {
+        length_lengths[0] = 1;
+        length_lengths[1] = 1;
+    }
+}
+
+/**
+ * write a compressed block.
+ * An aligned offset block is used if it is smaller than verbatim block.
+ */
+static void
+cab_lzx_write_compressed_block(
+    cab_lzx* obj,
+    unsigned int block_size,
+    cab_lzx_bit_writer* writer,
+    uint8_t* main_lengths,
+    uint8_t* length_lengths)
+{
+    unsigned int main_freqs[CAB_LZX_MAIN_MAX_SYMBOLS];
+    unsigned int length_freqs[CAB_LZX_SECONDARY_LENGTHS];
+    unsigned int aligned_freqs[CAB_LZX_ALIGNED_SYMBOLS];
+    uint8_t aligned_lengths[CAB_LZX_ALIGNED_SYMBOLS];
+    uint16_t main_codes[CAB_LZX_MAIN_MAX_SYMBOLS];
+    uint16_t length_codes[CAB_LZX_SECONDARY_LENGTHS];
+    uint16_t aligned_codes[CAB_LZX_ALIGNED_SYMBOLS];
+    unsigned int block_type;
+    unsigned int idx;
+
+    cab_lzx_count_frequencies(obj, main_freqs, length_freqs, aligned_freqs);
+    cab_lzx_build_lengths(obj, main_freqs, length_freqs,
+        main_lengths, length_lengths);
+    cab_huffman_build_codes(main_lengths, obj->main_symbols, main_codes);
+    cab_huffman_build_codes(length_lengths, CAB_LZX_SECONDARY_LENGTHS,
+        length_codes);
+
+    block_type = CAB_LZX_BLOCKTYPE_VERBATIM;
+    if (obj->block_type == CAB_LZX_BLOCK_AUTO) {
+        long aligned_gain;
+        cab_huffman_build_lengths(aligned_freqs, CAB_LZX_ALIGNED_SYMBOLS,
+            CAB_LZX_ALIGNED_MAX_LENGTH, aligned_lengths);
+        aligned_gain = -3L * CAB_LZX_ALIGNED_SYMBOLS;
+        for (idx = 0; idx < CAB_LZX_ALIGNED_SYMBOLS; idx++) {
+            aligned_gain += (3L - aligned_lengths[idx])
+                * (long)aligned_freqs[idx];
+        }
+        if (aligned_gain > 0) {
+            block_type = CAB_LZX_BLOCKTYPE_ALIGNED;
+            cab_huffman_build_codes(aligned_lengths,
+                CAB_LZX_ALIGNED_SYMBOLS, aligned_codes);
+        }
+    }
+
+    cab_lzx_put_bits(writer, block_type, 3);
+    cab_lzx_put_bits(writer, block_size, 24);
+    if (block_type == CAB_LZX_BLOCKTYPE_ALIGNED) {
+        for (idx = 0; idx < CAB_LZX_ALIGNED_SYMBOLS; idx++) {
+            cab_lzx_put_bits(writer, aligned_lengths[idx], 3);
+        }
+    }
+    cab_lzx_write_lengths(writer, obj->main_lengths, main_lengths,
+        CAB_LZX_NUM_CHARS);
+    cab_lzx_write_lengths(writer, obj->main_lengths + CAB_LZX_NUM_CHARS,
+        main_lengths + CAB_LZX_NUM_CHARS,
+        obj->main_symbols - CAB_LZX_NUM_CHARS);
+    cab_lzx_write_lengths(writer, obj->length_lengths, length_lengths,
+        CAB_LZX_SECONDARY_LENGTHS);
+
+    for (idx = 0; idx < obj->item_count && !writer->overflow; idx++) {
+        const cab_lzx_item* item;
+        item = &obj->items[idx];
+        cab_lzx_put_bits(writer, main_codes[item->main_symbol],
+            main_lengths[item->main_symbol]);
+        if (item->length_symbol != CAB_LZX_NO_LENGTH_SYMBOL) {
+            cab_lzx_put_bits(writer, length_codes[item->length_symbol],
+                length_lengths[item->length_symbol]);
+        }
+        if (block_type == CAB_LZX_BLOCKTYPE_ALIGNED
+            && item->extra_bits >= 3) {
+            cab_lzx_put_bits(writer, item->extra_value >> 3,
+                item->extra_bits - 3);
+            cab_lzx_put_bits(writer, aligned_codes[item->extra_value & 7],
+                aligned_lengths[item->extra_value & 7]);
+        } else {
+            cab_lzx_put_bits(writer, item->extra_value, item->extra_bits);
+        }
+    }
+}
+
+/**
+ * write an uncompressed block.
+ * The repeated offsets at the block start are stored in the block header.
+ */
+static void
+cab_lzx_write_uncompressed_block(
+    cab_lzx* obj,
+    const uint8_t* src,
+    unsigned int src_size,
+    cab_lzx_bit_writer* writer)
+{
+    uint8_t repeats[12];
+    unsigned int idx;
+    cab_lzx_put_bits(writer, CAB_LZX_BLOCKTYPE_UNCOMPRESSED, 3);
+    cab_lzx_put_bits(writer, src_size, 24);
+    /* decoders skip 1 to 16 bits to align the stream */
+    cab_lzx_put_bits(writer, 0, 16 - writer->bit_count);
+    for (idx = 0; idx < 3; idx++) {
+        repeats[idx * 4] = (uint8_t)obj->repeats[idx];
+        repeats[idx * 4 + 1] = (uint8_t)(obj->repeats[idx] >> 8);
+        repeats[idx * 4 + 2] = (uint8_t)(obj->repeats[idx] >> 16);
+        repeats[idx * 4 + 3] = (uint8_t)(obj->repeats[idx] >> 24);
+    }
+    cab_lzx_put_bytes(writer, repeats, sizeof(repeats));
+    cab_lzx_put_bytes(writer, src, src_size);
+    if (src_size & 1) {
+        cab_lzx_put_bytes(writer, "", 1);
+    }
+}
+
+/**
+ * write code lengths delta encoded with pretree
+ */
+static void
+cab_lzx_write_lengths(
+    cab_lzx_bit_writer* writer,
+    const uint8_t* prev_lengths,
+    const uint8_t* lengths,
+    unsigned int count)
+{
+    uint8_t symbols[CAB_LZX_MAIN_MAX_SYMBOLS];
+    uint8_t extras[CAB_LZX_MAIN_MAX_SYMBOLS];
+    uint8_t deltas[CAB_LZX_MAIN_MAX_SYMBOLS];
+    unsigned int freqs[CAB_LZX_PRETREE_SYMBOLS];
+    uint8_t pretree_lengths[CAB_LZX_PRETREE_SYMBOLS];
+    uint16_t pretree_codes[CAB_LZX_PRETREE_SYMBOLS];
+    unsigned int symbol_count;
+    unsigned int idx;
+
+    symbol_count = 0;
+    idx = 0;
+    while (idx < count) {
+        unsigned int run;
+        run = 1;
+        while (idx + run < count && lengths[idx + run] == lengths[idx]) {
+            run++;
+        }
+        if (lengths[idx] == 0 && run >= 4) {
+            while (run >= 20) {
+                unsigned int repeat;
+                repeat = run < 51 ? run : 51;
+                symbols[symbol_count] = 18;
+                extras[symbol_count++] = (uint8_t)(repeat - 20);
+                idx += repeat;
+                run -= repeat;
+            }
+            if (run >= 4) {
+                symbols[symbol_count] = 17;
+                extras[symbol_count++] = (uint8_t)(run - 4);
+                idx += run;
+                run = 0;
+            }
+        } else {
+            while (run >= 4) {
+                unsigned int repeat;
+                repeat = run < 5 ? run : 5;
+                symbols[symbol_count] = 19;
+                extras[symbol_count] = (uint8_t)(repeat - 4);
+                deltas[symbol_count++] =
+                    (uint8_t)((prev_lengths[idx] + 17 - lengths[idx]) % 17);
+                idx += repeat;
+                run -= repeat;
+            }
+        }
+        while (run > 0) {
+            symbols[symbol_count++] =
+                (uint8_t)((prev_lengths[idx] + 17 - lengths[idx]) % 17);
+            idx++;
+            run--;
+        }
+    }
+
+    memset(freqs, 0, sizeof(freqs));
+    for (idx = 0; idx < symbol_count; idx++) {
+        freqs[symbols[idx]]++;
+        if (symbols[idx] == 19) {
+            freqs[deltas[idx]]++;
+        }
+    }
+    cab_huffman_build_lengths(freqs, CAB_LZX_PRETREE_SYMBOLS,
+        CAB_LZX_PRETREE_MAX_LENGTH, pretree_lengths);
+    cab_huffman_build_codes(pretree_lengths, CAB_LZX_PRETREE_SYMBOLS,
+        pretree_codes);
+    for (idx = 0; idx < CAB_LZX_PRETREE_SYMBOLS; idx++) {
+        cab_lzx_put_bits(writer, pretree_lengths[idx], 4);
+    }
+    for (idx = 0; idx < symbol_count; idx++) {
+        cab_lzx_put_bits(writer, pretree_codes[symbols[idx]],
+            pretree_lengths[symbols[idx]]);
+        switch (symbols[idx]) {
+        case 17:
+            cab_lzx_put_bits(writer, extras[idx], 4);
+            break;
+        case 18:
+            cab_lzx_put_bits(writer, extras[idx], 5);
+            break;
+        case 19:
+            cab_lzx_put_bits(writer, extras[idx], 1);
+            cab_lzx_put_bits(writer, pretree_codes[deltas[idx]],
+                pretree_lengths[deltas[idx]]);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+/**
+ * get bit size of uncompressed block
+ */
+static unsigned long
+cab_lzx_uncompressed_bit_size(
+    const cab_lzx_bit_writer* writer,
+    unsigned int src_size)
+{
+    unsigned int header_bits;
+    header_bits = 3 + 24;
+    header_bits += 16 - (writer->bit_count + header_bits) % 16;
+    return header_bits + 12 * 8 + 8UL * (src_size + (src_size & 1));
+}
+
+/**
+ * get written bit size
+ */
+static unsigned long
+cab_lzx_bit_size(
+    const cab_lzx_bit_writer* writer)
+{
+    return 8UL * writer->size + writer->bit_count;
+}
+
+/**
+ * write bits
+ */
+static void
+cab_lzx_put_bits(
+    cab_lzx_bit_writer* writer,
+    uint32_t value,
+    unsigned int count)
+{
+    if (count > 16) {
+        cab_lzx_put_bits(writer, value >> 16, count - 16);
+        value &= 0xFFFF;
+        count = 16;
+    }
+    if (count) {
+        writer->bits = (writer->bits << count)
+            | (value & ((1U << count) - 1));
+        writer->bit_count += count;
+        if (writer->bit_count >= 16) {
+            uint32_t word;
+            writer->bit_count -= 16;
+            word = writer->bits >> writer->bit_count;
+            if (writer->size + 2 <= writer->capacity) {
+                writer->data[writer->size] = (uint8_t)word;
+                writer->data[writer->size + 1] = (uint8_t)(word >> 8);
+                writer->size += 2;
+            } else {
+                writer->overflow = 1;
+            }
+            writer->bits &= (1U << writer->bit_count) - 1;
+        }
+    }
+}
+
+/**
+ * write bytes at 16 bit boundary
+ */
+static void
+cab_lzx_put_bytes(
+    cab_lzx_bit_writer* writer,
+    const void* data,
+    unsigned int size)
+{
+    if (writer->size + size <= writer->capacity) {
+        memcpy(writer->data + writer->size, data, size);
+        writer->size += size;
+    } else {
+        writer->overflow = 1;
+    }
+}
+
+/**
+ * write pending bits with padding to 16 bit boundary
+ */
+static void
+cab_lzx_align_bits(
+    cab_lzx_bit_writer* writer)
+{
+    if (writer->bit_count) {
+        cab_lzx_put_bits(writer, 0, 16 - writer->bit_count);
+    }
+}
+
+/**
+ * allocate memory
+ */
+static void*
+cab_lzx_mem_alloc(
+    size_t size)
+{
+    return malloc(size);
+}
+
+/**
+ * free memory
+ */
+static void
+cab_lzx_mem_free(
+    void* heap_obj)
+{
+    free(heap_obj);
+}
+
+/* vi: se ts=4 sw=4 et: */
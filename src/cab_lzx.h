@@ -0,0 +1,96 @@
+#ifndef __CAB_LZX_H__
+#define __CAB_LZX_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+#define _CAB_LZX_ITFC_BEGIN extern "C" {
+#define _CAB_LZX_ITFC_END }
+#else
+#define _CAB_LZX_ITFC_BEGIN 
+#define _CAB_LZX_ITFC_END 
+#endif
+
+_CAB_LZX_ITFC_BEGIN 
+
+/**
+ * lzx compressor
+ */
+typedef struct _cab_lzx cab_lzx;
+
+/**
+ * minimum window bits
+ */
+#define CAB_LZX_WINDOW_BITS_MIN 15
+
+/**
+ * maximum window bits
+ */
+#define CAB_LZX_WINDOW_BITS_MAX 21
+
+/**
+ * select match finder by compression preset
+ */
+#define CAB_LZX_MATCH_FINDER_DEFAULT 0
+
+/**
+ * use hash chain match finder
+ */
+#define CAB_LZX_MATCH_FINDER_HASH_CHAIN 1
+
+/**
+ * use binary tree match finder
+ */
+#define CAB_LZX_MATCH_FINDER_BINARY_TREE 2
+
+/**
+ * use verbatim or aligned offset block whichever is smaller
+ */
+#define CAB_LZX_BLOCK_AUTO 0
+
+/**
+ * use verbatim block only
+ */
+#define CAB_LZX_BLOCK_VERBATIM 1
+
+/**
+ * create lzx compressor.
+ * window_bits is from CAB_LZX_WINDOW_BITS_MIN to CAB_LZX_WINDOW_BITS_MAX.
+ * preset is one of CAB_COMPRESSOR_PRESET_XXX.
+ */
+cab_lzx*
+cab_lzx_create(
+    unsigned int window_bits,
+    unsigned int preset,
+    unsigned int match_finder,
+    unsigned int block_type);
+
+/**
+ * free lzx compressor
+ */
+void
+cab_lzx_free(
+    cab_lzx* obj);
+
+/**
+ * reset compressor to begin new folder
+ */
+int
+cab_lzx_reset(
+    cab_lzx* obj);
+
+/**
+ * compress a data block into a lzx frame.
+ */
+int
+cab_lzx_compress(
+    cab_lzx* obj,
+    const void* src,
+    unsigned int src_size,
+    void* dst,
+    unsigned int* dst_size);
+
+_CAB_LZX_ITFC_END 
+
+/* vi: se ts=4 sw=4 et: */
+#endif
@@ -0,0 +1,976 @@
+#include "cab_lzx_decoder.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include "cab_lzx.h"
+#include "cab_compressor.h"
+
+/**
+ * minimum match length
+ */
+#define CAB_LZX_DECODER_MIN_MATCH 2
+
+/**
+ * literal symbols count
+ */
+#define CAB_LZX_DECODER_NUM_CHARS 256
+
+/**
+ * match lengths coded in main symbol
+ */
+#define CAB_LZX_DECODER_PRIMARY_LENGTHS 7
+
+/**
+ * length symbols count
+ */
+#define CAB_LZX_DECODER_SECONDARY_LENGTHS 249
+
+/**
+ * aligned offset symbols count
+ */
+#define CAB_LZX_DECODER_ALIGNED_SYMBOLS 8
+
+/**
+ * pretree symbols count
+ */
+#define CAB_LZX_DECODER_PRETREE_SYMBOLS 20
+
+/**
+ * maximum count of position slots
+ */
+#define CAB_LZX_DECODER_MAX_POSITION_SLOTS 50
+
+/**
+ * maximum main symbols count
+ */
+#define CAB_LZX_DECODER_MAIN_MAX_SYMBOLS \
+    (CAB_LZX_DECODER_NUM_CHARS + CAB_LZX_DECODER_MAX_POSITION_SLOTS * 8)
+
+/**
+ * maximum code length
+ */
+#define CAB_LZX_DECODER_MAX_BITS 16
+
+/**
+ * bits indexing fast decoding table
+ */
+#define CAB_LZX_DECODER_FAST_BITS 12
+
+/**
+ * verbatim block
+ */
+#define CAB_LZX_DECODER_BLOCKTYPE_VERBATIM 1
+
+/**
+ * aligned offset block
+ */
+#define CAB_LZX_DECODER_BLOCKTYPE_ALIGNED 2
+
+/**
+ * uncompressed block
+ */
+#define CAB_LZX_DECODER_BLOCKTYPE_UNCOMPRESSED 3
+
+/**
+ * frames which intel e8 call translation is applied to
+ */
+#define CAB_LZX_DECODER_E8_MAX_FRAMES 32768
+
+/**
+ * huffman decoding table
+ */
+typedef struct _cab_lzx_decoder_table cab_lzx_decoder_table;
+
+/**
+ * huffman decoding table
+ */
+struct _cab_lzx_decoder_table {
+    /**
+     * symbol and code length indexed by the next bits.
+     * The entry is symbol shifted by 4 and ored with code length. It is
+     * zero if the code is longer than CAB_LZX_DECODER_FAST_BITS.
+     */
+    uint16_t fast[1 << CAB_LZX_DECODER_FAST_BITS];
+
+    /**
+     * count of codes for each length
+     */
+    uint16_t counts[CAB_LZX_DECODER_MAX_BITS + 1];
+
+    /**
+     * symbols sorted by code
+     */
+    uint16_t symbols[CAB_LZX_DECODER_MAIN_MAX_SYMBOLS];
+};
+
+/**
+ * lzx decompressor
+ */
+struct _cab_lzx_decoder {
+    /**
+     * window size
+     */
+    uint32_t window_size;
+
+    /**
+     * sliding window
+     */
+    uint8_t* window;
+
+    /**
+     * position in window where the next frame is decompressed
+     */
+    uint32_t window_position;
+
+    /**
+     * size of decompressed data in window
+     */
+    uint32_t window_fill;
+
+    /**
+     * main symbols count for window size
+     */
+    unsigned int main_symbols;
+
+    /**
+     * not zero if the stream header is read
+     */
+    int header_read;
+
+    /**
+     * file size for intel e8 call translation. zero if it is not applied.
+     */
+    uint32_t intel_file_size;
+
+    /**
+     * not zero if a block may have e8 bytes translated
+     */
+    int intel_started;
+
+    /**
+     * uncompressed position of the current frame in the folder
+     */
+    uint32_t intel_position;
+
+    /**
+     * count of frames decompressed in the folder
+     */
+    uint32_t frame_count;
+
+    /**
+     * current block type
+     */
+    unsigned int block_type;
+
+    /**
+     * size of current block
+     */
+    uint32_t block_length;
+
+    /**
+     * uncompressed bytes left in current block
+     */
+    uint32_t block_remaining;
+
+    /**
+     * repeated offsets R0, R1 and R2
+     */
+    uint32_t repeats[3];
+
+    /**
+     * main tree code lengths. The next tree is coded as delta of this.
+     */
+    uint8_t main_lengths[CAB_LZX_DECODER_MAIN_MAX_SYMBOLS];
+
+    /**
+     * length tree code lengths. The next tree is coded as delta of this.
+     */
+    uint8_t length_lengths[CAB_LZX_DECODER_SECONDARY_LENGTHS];
+
+    /**
+     * main tree
+     */
+    cab_lzx_decoder_table main_table;
+
+    /**
+     * length tree
+     */
+    cab_lzx_decoder_table length_table;
+
+    /**
+     * aligned offset tree
+     */
+    cab_lzx_decoder_table aligned_table;
+
+    /**
+     * pretree coding code lengths of the other trees
+     */
+    cab_lzx_decoder_table pretree_table;
+
+    /**
+     * compressed frame
+     */
+    const uint8_t* src;
+
+    /**
+     * size of compressed frame
+     */
+    size_t src_size;
+
+    /**
+     * read position in compressed frame
+     */
+    size_t position;
+
+    /**
+     * bits read from compressed frame. The next bit is most significant.
+     */
+    uint32_t bit_buffer;
+
+    /**
+     * count of bits in bit_buffer
+     */
+    unsigned int bit_count;
+};
+
+/**
+ * count of position slots for window bits from 15 to 21
+ */
+static const uint8_t CAB_LZX_DECODER_POSITION_SLOTS[] = {
+    30, 32, 34, 36, 38, 42, 50
+};
+
+/**
+ * base formatted offset for position slots
+ */
+static const uint32_t CAB_LZX_DECODER_POSITION_BASE[] = {
+    0, 1, 2, 3, 4, 6, 8, 12, 16, 24, 32, 48, 64, 96, 128, 192,
+    256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096, 6144, 8192, 12288,
+    16384, 24576, 32768, 49152, 65536, 98304, 131072, 196608, 262144,
+    393216, 524288, 655360, 786432, 917504, 1048576, 1179648, 1310720,
+    1441792, 1572864, 1703936, 1835008, 1966080
+};
+
+/**
+ * extra bits for position slots
+ */
+static const uint8_t CAB_LZX_DECODER_EXTRA_BITS[] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13, 14, 14,
+    15, 15, 16, 16, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17,
+    17, 17
+};
+
+/**
+ * build decoding table from code lengths.
+ * Incomplete code is accepted but over subscribed code is not.
+ */
+static int
+cab_lzx_decoder_build_table(
+    cab_lzx_decoder_table* table,
+    const uint8_t* lengths,
+    unsigned int count);
+
+/**
+ * fill bit buffer to have count bits at least.
+ * Zero bits are filled after the end of data.
+ */
+static void
+cab_lzx_decoder_fill_bits(
+    cab_lzx_decoder* obj,
+    unsigned int count);
+
+/**
+ * read bits. count must not be greater than 17.
+ */
+static uint32_t
+cab_lzx_decoder_read_bits(
+    cab_lzx_decoder* obj,
+    unsigned int count);
+
+/**
+ * read a symbol with decoding table.
+ * You get -1 if the bits do not make a code.
+ */
+static int
+cab_lzx_decoder_read_symbol(
+    cab_lzx_decoder* obj,
+    const cab_lzx_decoder_table* table);
+
+/**
+ * read code lengths coded with pretree as delta of the previous lengths
+ */
+static int
+cab_lzx_decoder_read_lengths(
+    cab_lzx_decoder* obj,
+    uint8_t* lengths,
+    unsigned int first,
+    unsigned int last);
+
+/**
+ * read block header and trees
+ */
+static int
+cab_lzx_decoder_read_block_header(
+    cab_lzx_decoder* obj);
+
+/**
+ * decompress verbatim or aligned offset block data into window
+ */
+static int
+cab_lzx_decoder_decode_run(
+    cab_lzx_decoder* obj,
+    uint32_t frame_start,
+    uint32_t run_size);
+
+/**
+ * apply intel e8 call translation to decompressed frame
+ */
+static void
+cab_lzx_decoder_translate_e8(
+    cab_lzx_decoder* obj,
+    uint8_t* data,
+    unsigned int size);
+
+/**
+ * allocate memory
+ */
+static void*
+cab_lzx_decoder_mem_alloc(
+    size_t size);
+
+/**
+ * free memory
+ */
+static void
+cab_lzx_decoder_mem_free(
+    void* heap_obj);
+
+/**
+ * create lzx decompressor.
+ */
+cab_lzx_decoder*
+cab_lzx_decoder_create(
+    unsigned int window_bits)
+{
+    cab_lzx_decoder* result;
+    result = NULL;
+    if (window_bits >= CAB_LZX_WINDOW_BITS_MIN
+        && window_bits <= CAB_LZX_WINDOW_BITS_MAX) {
+        result = (cab_lzx_decoder*)cab_lzx_decoder_mem_alloc(
+            sizeof(cab_lzx_decoder));
+    } else {
+        errno = EINVAL;
+    }
+    if (result) {
+        memset(result, 0, sizeof(*result));
+        result->window_size = 1U << window_bits;
+        result->main_symbols = CAB_LZX_DECODER_NUM_CHARS
+            + CAB_LZX_DECODER_POSITION_SLOTS[
+                window_bits - CAB_LZX_WINDOW_BITS_MIN] * 8;
+        result->window = (uint8_t*)cab_lzx_decoder_mem_alloc(
+            result->window_size);
+        if (result->window) {
+            cab_lzx_decoder_reset(result);
+        } else {
+            cab_lzx_decoder_free(result);
+            result = NULL;
+        }
+    }
+    return result;
+}
+
+/**
+ * free lzx decompressor
+ */
+void
+cab_lzx_decoder_free(
+    cab_lzx_decoder* obj)
+{
+    if (obj) {
+        if (obj->window) {
+            cab_lzx_decoder_mem_free(obj->window);
+        }
+        cab_lzx_decoder_mem_free(obj);
+    }
+}
+
+/**
+ * reset decompressor to begin new folder
+ */
+int
+cab_lzx_decoder_reset(
+    cab_lzx_decoder* obj)
+{
+    int result;
+    if (obj) {
+        obj->window_position = 0;
+        obj->window_fill = 0;
+        obj->header_read = 0;
+        obj->intel_file_size = 0;
+        obj->intel_started = 0;
+        obj->intel_position = 0;
+        obj->frame_count = 0;
+        obj->block_type = 0;
+        obj->block_length = 0;
+        obj->block_remaining = 0;
+        obj->repeats[0] = 1;
+        obj->repeats[1] = 1;
+        obj->repeats[2] = 1;
+        memset(obj->main_lengths, 0, sizeof(obj->main_lengths));
+        memset(obj->length_lengths, 0, sizeof(obj->length_lengths));
+        result = 0;
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * decompress a lzx frame in a data block.
+ * The bit stream of each frame starts at the beginning of the block, and
+ * blocks in the stream may continue into the next frame.
+ */
+int
+cab_lzx_decoder_decompress(
+    cab_lzx_decoder* obj,
+    const void* src,
+    unsigned int src_size,
+    void* dst,
+    unsigned int dst_size)
+{
+    int result;
+    uint32_t frame_start;
+    uint32_t remaining;
+    if (obj && src && dst && dst_size
+        && dst_size <= CAB_COMPRESSOR_BLOCK_SIZE
+        && obj->window_position + dst_size <= obj->window_size) {
+        result = 0;
+    } else {
+        result = -1;
+    }
+    frame_start = 0;
+    remaining = 0;
+    if (result == 0) {
+        obj->src = (const uint8_t*)src;
+        obj->src_size = src_size;
+        obj->position = 0;
+        obj->bit_buffer = 0;
+        obj->bit_count = 0;
+        frame_start = obj->window_position;
+        remaining = dst_size;
+        if (!obj->header_read) {
+            if (cab_lzx_decoder_read_bits(obj, 1)) {
+                uint32_t high;
+                high = cab_lzx_decoder_read_bits(obj, 16);
+                obj->intel_file_size = (high << 16)
+                    | cab_lzx_decoder_read_bits(obj, 16);
+            }
+            obj->header_read = 1;
+        }
+    }
+    while (result == 0 && remaining) {
+        uint32_t run_size;
+        if (!obj->block_remaining) {
+            result = cab_lzx_decoder_read_block_header(obj);
+            if (result) {
+                break;
+            }
+        }
+        run_size = obj->block_remaining < remaining ?
+            obj->block_remaining : remaining;
+        if (obj->block_type == CAB_LZX_DECODER_BLOCKTYPE_UNCOMPRESSED) {
+            if (obj->position + run_size <= obj->src_size) {
+                memcpy(obj->window + obj->window_position,
+                    obj->src + obj->position, run_size);
+                obj->position += run_size;
+                obj->window_position += run_size;
+            } else {
+                result = -1;
+            }
+        } else {
+            result = cab_lzx_decoder_decode_run(obj, frame_start, run_size);
+        }
+        obj->block_remaining -= run_size;
+        remaining -= run_size;
+        if (result == 0 && !obj->block_remaining
+            && obj->block_type == CAB_LZX_DECODER_BLOCKTYPE_UNCOMPRESSED
+            && (obj->block_length & 1)) {
+            /* padding byte after odd sized block */
+            obj->position++;
+        }
+    }
+    /* the frame must not be read over the end */
+    if (result == 0 && obj->position * 8 - obj->bit_count
+        > (size_t)obj->src_size * 8) {
+        result = -1;
+    }
+    if (result == 0) {
+        memcpy(dst, obj->window + frame_start, dst_size);
+        cab_lzx_decoder_translate_e8(obj, (uint8_t*)dst, dst_size);
+        if (obj->window_position == obj->window_size) {
+            obj->window_position = 0;
+        }
+        obj->window_fill = obj->window_size - obj->window_fill > dst_size ?
+            obj->window_fill + dst_size : obj->window_size;
+        obj->intel_position += dst_size;
+        obj->frame_count++;
+    } else {
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * build decoding table from code lengths.
+ */
+static int
+cab_lzx_decoder_build_table(
+    cab_lzx_decoder_table* table,
+    const uint8_t* lengths,
+    unsigned int count)
+{
+    uint16_t offsets[CAB_LZX_DECODER_MAX_BITS + 2];
+    unsigned int next_codes[CAB_LZX_DECODER_MAX_BITS + 1];
+    unsigned int idx;
+    unsigned int code;
+    int left;
+    int result;
+    memset(table->counts, 0, sizeof(table->counts));
+    memset(table->fast, 0, sizeof(table->fast));
+    for (idx = 0; idx < count; idx++) {
+        table->counts[lengths[idx]]++;
+    }
+    table->counts[0] = 0;
+    left = 1;
+    result = 0;
+    for (idx = 1; idx <= CAB_LZX_DECODER_MAX_BITS; idx++) {
+        left <<= 1;
+        left -= table->counts[idx];
+        if (left < 0) {
+            result = -1;
+            break;
+        }
+    }
+    if (result == 0) {
+        offsets[1] = 0;
+        code = 0;
+        for (idx = 1; idx <= CAB_LZX_DECODER_MAX_BITS; idx++) {
+            offsets[idx + 1] = offsets[idx] + table->counts[idx];
+            next_codes[idx] = code;
+            code = (code + table->counts[idx]) << 1;
+        }
+        for (idx = 0; idx < count; idx++) {
+            unsigned int length;
+            length = lengths[idx];
+            if (!length) {
+                continue;
+            }
+            table->symbols[offsets[length]++] = (uint16_t)idx;
+            code = next_codes[length]++;
+            if (length <= CAB_LZX_DECODER_FAST_BITS) {
+                unsigned int fill_idx;
+                unsigned int fill_end;
+                fill_idx = code << (CAB_LZX_DECODER_FAST_BITS - length);
+                fill_end = fill_idx
+                    + (1U << (CAB_LZX_DECODER_FAST_BITS - length));
+                for (; fill_idx < fill_end; fill_idx++) {
+                    table->fast[fill_idx] = (uint16_t)((idx << 4) | length);
+                }
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ * fill bit buffer to have count bits at least.
+ */
+static void
+cab_lzx_decoder_fill_bits(
+    cab_lzx_decoder* obj,
+    unsigned int count)
+{
+    while (obj->bit_count < count) {
+        uint32_t word;
+        word = 0;
+        if (obj->position + 1 < obj->src_size) {
+            word = obj->src[obj->position]
+                | ((uint32_t)obj->src[obj->position + 1] << 8);
+        } else if (obj->position < obj->src_size) {
+            word = obj->src[obj->position];
+        }
+        obj->position += 2;
+        obj->bit_buffer |= word << (16 - obj->bit_count);
+        obj->bit_count += 16;
+    }
+}
+
+/**
+ * read bits. count must not be greater than 17.
+ */
+static uint32_t
+cab_lzx_decoder_read_bits(
+    cab_lzx_decoder* obj,
+    unsigned int count)
+{
+    uint32_t result;
+    if (count) {
+        cab_lzx_decoder_fill_bits(obj, count);
+        result = obj->bit_buffer >> (32 - count);
+        obj->bit_buffer <<= count;
+        obj->bit_count -= count;
+    } else {
+        result = 0;
+    }
+    return result;
+}
+
+/**
+ * read a symbol with decoding table.
+ */
+static int
+cab_lzx_decoder_read_symbol(
+    cab_lzx_decoder* obj,
+    const cab_lzx_decoder_table* table)
+{
+    unsigned int entry;
+    int result;
+    cab_lzx_decoder_fill_bits(obj, CAB_LZX_DECODER_MAX_BITS);
+    entry = table->fast[obj->bit_buffer >> (32 - CAB_LZX_DECODER_FAST_BITS)];
+    if (entry) {
+        obj->bit_buffer <<= entry & 0xf;
+        obj->bit_count -= entry & 0xf;
+        result = (int)(entry >> 4);
+    } else {
+        unsigned int length;
+        int code;
+        int first;
+        int index;
+        result = -1;
+        code = 0;
+        first = 0;
+        index = 0;
+        for (length = 1; length <= CAB_LZX_DECODER_MAX_BITS; length++) {
+            int count;
+            code |= (int)((obj->bit_buffer >> (32 - length)) & 1);
+            count = table->counts[length];
+            if (code - first < count) {
+                obj->bit_buffer <<= length;
+                obj->bit_count -= length;
+                result = table->symbols[index + code - first];
+                break;
+            }
+            index += count;
+            first += count;
+            first <<= 1;
+            code <<= 1;
+        }
+    }
+    return result;
+}
+
+/**
+ * read code lengths coded with pretree as delta of the previous lengths
+ */
+static int
+cab_lzx_decoder_read_lengths(
+    cab_lzx_decoder* obj,
+    uint8_t* lengths,
+    unsigned int first,
+    unsigned int last)
+{
+    uint8_t pretree_lengths[CAB_LZX_DECODER_PRETREE_SYMBOLS];
+    unsigned int idx;
+    int result;
+    for (idx = 0; idx < CAB_LZX_DECODER_PRETREE_SYMBOLS; idx++) {
+        pretree_lengths[idx] = (uint8_t)cab_lzx_decoder_read_bits(obj, 4);
+    }
+    result = cab_lzx_decoder_build_table(&obj->pretree_table,
+        pretree_lengths, CAB_LZX_DECODER_PRETREE_SYMBOLS);
+    idx = first;
+    while (result == 0 && idx < last) {
+        int symbol;
+        unsigned int repeat;
+        symbol = cab_lzx_decoder_read_symbol(obj, &obj->pretree_table);
+        if (symbol < 0) {
+            result = -1;
+        } else if (symbol < 17) {
+            lengths[idx] = (uint8_t)((lengths[idx] + 17 - symbol) % 17);
+            idx++;
+        } else if (symbol == 19) {
+            repeat = 4 + cab_lzx_decoder_read_bits(obj, 1);
+            symbol = cab_lzx_decoder_read_symbol(obj, &obj->pretree_table);
+            if (symbol >= 0 && symbol < 17 && idx + repeat <= last) {
+                memset(lengths + idx,
+                    (lengths[idx] + 17 - symbol) % 17, repeat);
+                idx += repeat;
+            } else {
+                result = -1;
+            }
+        } else {
+            if (symbol == 17) {
+                repeat = 4 + cab_lzx_decoder_read_bits(obj, 4);
+            } else {
+                repeat = 20 + cab_lzx_decoder_read_bits(obj, 5);
+            }
+            if (idx + repeat <= last) {
+                memset(lengths + idx, 0, repeat);
+                idx += repeat;
+            } else {
+                result = -1;
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ * read block header and trees
+ */
+static int
+cab_lzx_decoder_read_block_header(
+    cab_lzx_decoder* obj)
+{
+    uint32_t block_length;
+    int result;
+    obj->block_type = cab_lzx_decoder_read_bits(obj, 3);
+    block_length = cab_lzx_decoder_read_bits(obj, 16) << 8;
+    block_length |= cab_lzx_decoder_read_bits(obj, 8);
+    result = 0;
+    switch (obj->block_type) {
+    case CAB_LZX_DECODER_BLOCKTYPE_ALIGNED:
+        {
+            uint8_t aligned_lengths[CAB_LZX_DECODER_ALIGNED_SYMBOLS];
+            unsigned int idx;
+            for (idx = 0; idx < CAB_LZX_DECODER_ALIGNED_SYMBOLS; idx++) {
+                aligned_lengths[idx] =
+                    (uint8_t)cab_lzx_decoder_read_bits(obj, 3);
+            }
+            result = cab_lzx_decoder_build_table(&obj->aligned_table,
+                aligned_lengths, CAB_LZX_DECODER_ALIGNED_SYMBOLS);
+        }
+        /* fall through */
+    case CAB_LZX_DECODER_BLOCKTYPE_VERBATIM:
+        if (result == 0) {
+            result = cab_lzx_decoder_read_lengths(obj, obj->main_lengths,
+                0, CAB_LZX_DECODER_NUM_CHARS);
+        }
+        if (result == 0) {
+            result = cab_lzx_decoder_read_lengths(obj, obj->main_lengths,
+                CAB_LZX_DECODER_NUM_CHARS, obj->main_symbols);
+        }
+        if (result == 0) {
+            result = cab_lzx_decoder_build_table(&obj->main_table,
+                obj->main_lengths, obj->main_symbols);
+        }
+        if (result == 0) {
+            if (obj->main_lengths[0xE8]) {
+                obj->intel_started = 1;
+            }
+            result = cab_lzx_decoder_read_lengths(obj, obj->length_lengths,
+                0, CAB_LZX_DECODER_SECONDARY_LENGTHS);
+        }
+        if (result == 0) {
+            result = cab_lzx_decoder_build_table(&obj->length_table,
+                obj->length_lengths, CAB_LZX_DECODER_SECONDARY_LENGTHS);
+        }
+        break;
+    case CAB_LZX_DECODER_BLOCKTYPE_UNCOMPRESSED:
+        {
+            size_t bit_position;
+            obj->intel_started = 1;
+            /* 1 to 16 padding bits align the stream to 16 bits */
+            bit_position = obj->position * 8 - obj->bit_count;
+            obj->position = (bit_position / 16 + 1) * 2;
+            obj->bit_buffer = 0;
+            obj->bit_count = 0;
+            if (obj->position + 12 <= obj->src_size) {
+                unsigned int idx;
+                for (idx = 0; idx < 3; idx++) {
+                    const uint8_t* ptr;
+                    ptr = obj->src + obj->position + idx * 4;
+                    obj->repeats[idx] = ptr[0] | ((uint32_t)ptr[1] << 8)
+                        | ((uint32_t)ptr[2] << 16) | ((uint32_t)ptr[3] << 24);
+                }
+                obj->position += 12;
+            } else {
+                result = -1;
+            }
+        }
+        break;
+    default:
+        result = -1;
+        break;
+    }
+    if (result == 0) {
+        obj->block_length = block_length;
+        obj->block_remaining = block_length;
+    }
+    return result;
+}
+
+/**
+ * decompress verbatim or aligned offset block data into window
+ */
+static int
+cab_lzx_decoder_decode_run(
+    cab_lzx_decoder* obj,
+    uint32_t frame_start,
+    uint32_t run_size)
+{
+    uint8_t* window;
+    uint32_t window_mask;
+    uint32_t position;
+    uint32_t end;
+    int aligned;
+    int result;
+    window = obj->window;
+    window_mask = obj->window_size - 1;
+    position = obj->window_position;
+    end = position + run_size;
+    aligned = obj->block_type == CAB_LZX_DECODER_BLOCKTYPE_ALIGNED;
+    result = 0;
+    while (position < end) {
+        int symbol;
+        uint32_t length;
+        uint32_t offset;
+        uint32_t slot;
+        uint32_t available;
+        symbol = cab_lzx_decoder_read_symbol(obj, &obj->main_table);
+        if (symbol < CAB_LZX_DECODER_NUM_CHARS) {
+            if (symbol < 0) {
+                result = -1;
+                break;
+            }
+            window[position++] = (uint8_t)symbol;
+            continue;
+        }
+        symbol -= CAB_LZX_DECODER_NUM_CHARS;
+        length = symbol & 7;
+        if (length == CAB_LZX_DECODER_PRIMARY_LENGTHS) {
+            int length_symbol;
+            length_symbol = cab_lzx_decoder_read_symbol(obj,
+                &obj->length_table);
+            if (length_symbol < 0) {
+                result = -1;
+                break;
+            }
+            length += length_symbol;
+        }
+        length += CAB_LZX_DECODER_MIN_MATCH;
+        slot = (uint32_t)symbol >> 3;
+        if (slot == 0) {
+            offset = obj->repeats[0];
+        } else if (slot < 3) {
+            offset = obj->repeats[slot];
+            obj->repeats[slot] = obj->repeats[0];
+            obj->repeats[0] = offset;
+        } else {
+            unsigned int extra_bits;
+            extra_bits = CAB_LZX_DECODER_EXTRA_BITS[slot];
+            offset = CAB_LZX_DECODER_POSITION_BASE[slot] - 2;
+            if (aligned && extra_bits >= 3) {
+                int aligned_symbol;
+                offset += cab_lzx_decoder_read_bits(obj, extra_bits - 3) << 3;
+                aligned_symbol = cab_lzx_decoder_read_symbol(obj,
+                    &obj->aligned_table);
+                if (aligned_symbol < 0) {
+                    result = -1;
+                    break;
+                }
+                offset += (uint32_t)aligned_symbol;
+            } else {
+                offset += cab_lzx_decoder_read_bits(obj, extra_bits);
+            }
+            obj->repeats[2] = obj->repeats[1];
+            obj->repeats[1] = obj->repeats[0];
+            obj->repeats[0] = offset;
+        }
+        available = obj->window_fill + (position - frame_start);
+        if (available > obj->window_size) {
+            available = obj->window_size;
+        }
+        if (!offset || offset > available || length > end - position) {
+            result = -1;
+            break;
+        }
+        if (offset >= length && offset <= position) {
+            memcpy(window + position, window + position - offset, length);
+            position += length;
+        } else {
+            uint32_t src_position;
+            src_position = (position - offset) & window_mask;
+            while (length--) {
+                window[position++] = window[src_position];
+                src_position = (src_position + 1) & window_mask;
+            }
+        }
+    }
+    obj->window_position = position;
+    return result;
+}
+
+/**
+ * apply intel e8 call translation to decompressed frame
+ */
+static void
+cab_lzx_decoder_translate_e8(
+    cab_lzx_decoder* obj,
+    uint8_t* data,
+    unsigned int size)
+{
+    if (obj->intel_started && obj->intel_file_size
+        && obj->frame_count < CAB_LZX_DECODER_E8_MAX_FRAMES && size > 10) {
+        uint8_t* data_end;
+        int32_t current;
+        int32_t file_size;
+        data_end = data + size - 10;
+        current = (int32_t)obj->intel_position;
+        file_size = (int32_t)obj->intel_file_size;
+        while (data < data_end) {
+            int32_t absolute;
+            if (*data++ != 0xE8) {
+                current++;
+                continue;
+            }
+            absolute = (int32_t)(data[0] | ((uint32_t)data[1] << 8)
+                | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24));
+            if (absolute >= -current && absolute < file_size) {
+                uint32_t relative;
+                relative = (uint32_t)(absolute >= 0 ?
+                    absolute - current : absolute + file_size);
+                data[0] = (uint8_t)relative;
+                data[1] = (uint8_t)(relative >> 8);
+                data[2] = (uint8_t)(relative >> 16);
+                data[3] = (uint8_t)(relative >> 24);
+            }
+            data += 4;
+            current += 5;
+        }
+    }
+}
+
+/**
+ * allocate memory
+ */
+static void*
+cab_lzx_decoder_mem_alloc(
+    size_t size)
+{
+    return malloc(size);
+}
+
+/**
+ * free memory
+ */
+static void
+cab_lzx_decoder_mem_free(
+    void* heap_obj)
+{
+    free(heap_obj);
+}
+
+/* vi: se ts=4 sw=4 et: */
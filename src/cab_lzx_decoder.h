@@ -0,0 +1,58 @@
+#ifndef __CAB_LZX_DECODER_H__
+#define __CAB_LZX_DECODER_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+#define _CAB_LZX_DECODER_ITFC_BEGIN extern "C" {
+#define _CAB_LZX_DECODER_ITFC_END }
+#else
+#define _CAB_LZX_DECODER_ITFC_BEGIN
+#define _CAB_LZX_DECODER_ITFC_END
+#endif
+
+_CAB_LZX_DECODER_ITFC_BEGIN
+
+/**
+ * lzx decompressor
+ */
+typedef struct _cab_lzx_decoder cab_lzx_decoder;
+
+/**
+ * create lzx decompressor.
+ * window_bits is from CAB_LZX_WINDOW_BITS_MIN to CAB_LZX_WINDOW_BITS_MAX.
+ */
+cab_lzx_decoder*
+cab_lzx_decoder_create(
+    unsigned int window_bits);
+
+/**
+ * free lzx decompressor
+ */
+void
+cab_lzx_decoder_free(
+    cab_lzx_decoder* obj);
+
+/**
+ * reset decompressor to begin new folder
+ */
+int
+cab_lzx_decoder_reset(
+    cab_lzx_decoder* obj);
+
+/**
+ * decompress a lzx frame in a data block.
+ * The frame has to be decompressed into dst_size bytes exactly.
+ */
+int
+cab_lzx_decoder_decompress(
+    cab_lzx_decoder* obj,
+    const void* src,
+    unsigned int src_size,
+    void* dst,
+    unsigned int dst_size);
+
+_CAB_LZX_DECODER_ITFC_END
+
+/* vi: se ts=4 sw=4 et: */
+#endif
@@ -0,0 +1,539 @@
+#include "cab_match_finder.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "cab_compressor.h"
+
+/**
+ * bits of hash table index
+ */
+#define CAB_MATCH_FINDER_HASH_BITS 16
+
+/**
+ * hash table size
+ */
+#define CAB_MATCH_FINDER_HASH_SIZE (1U << CAB_MATCH_FINDER_HASH_BITS)
+
+/**
+ * lz77 match finder over a sliding window
+ */
+struct _cab_match_finder {
+    /**
+     * maximum match distance
+     */
+    unsigned int window_size;
+
+    /**
+     * CAB_MATCH_FINDER_HASH_CHAIN or CAB_MATCH_FINDER_BINARY_TREE
+     */
+    unsigned int mode;
+
+    /**
+     * maximum count of candidates to be examined
+     */
+    unsigned int max_chain;
+
+    /**
+     * stop searching when a match reaches this length
+     */
+    unsigned int nice_length;
+
+    /**
+     * window data
+     */
+    uint8_t* buffer;
+
+    /**
+     * window buffer size
+     */
+    unsigned int buffer_size;
+
+    /**
+     * stream position of buffer head
+     */
+    uint32_t base;
+
+    /**
+     * stream position of data end
+     */
+    uint32_t end;
+
+    /**
+     * current stream position
+     */
+    uint32_t position;
+
+    /**
+     * hash to the latest stream position plus one
+     */
+    uint32_t* head;
+
+    /**
+     * links between stream positions plus one.
+     * It has the previous position which has same hash on hash chain, or
+     * the pair of smaller and greater children on binary tree.
+     */
+    uint32_t* links;
+
+    /**
+     * count of links
+     */
+    unsigned int link_count;
+};
+
+/**
+ * calculate hash at the buffer
+ */
+static unsigned int
+cab_match_finder_hash(
+    const uint8_t* data);
+
+/**
+ * insert current position into hash chain
+ */
+static void
+cab_match_finder_insert(
+    cab_match_finder* obj);
+
+/**
+ * find matches on hash chain
+ */
+static unsigned int
+cab_match_finder_find_hash_chain(
+    cab_match_finder* obj,
+    unsigned int max_length,
+    cab_match* matches);
+
+/**
+ * insert current position into binary tree and find matches.
+ * matches may be NULL to insert only.
+ */
+static unsigned int
+cab_match_finder_update_binary_tree(
+    cab_match_finder* obj,
+    unsigned int max_length,
+    cab_match* matches);
+
+/**
+ * allocate memory
+ */
+static void*
+cab_match_finder_mem_alloc(
+    size_t size);
+
+/**
+ * free memory
+ */
+static void
+cab_match_finder_mem_free(
+    void* heap_obj);
+
+/**
+ * create match finder.
+ */
+cab_match_finder*
+cab_match_finder_create(
+    unsigned int window_size,
+    unsigned int mode,
+    unsigned int max_chain,
+    unsigned int nice_length)
+{
+    cab_match_finder* result;
+    result = NULL;
+    if (window_size && (window_size & (window_size - 1)) == 0
+        && (mode == CAB_MATCH_FINDER_HASH_CHAIN
+            || mode == CAB_MATCH_FINDER_BINARY_TREE)) {
+        result = (cab_match_finder*)cab_match_finder_mem_alloc(
+            sizeof(cab_match_finder));
+    } else {
+        errno = EINVAL;
+    }
+    if (result) {
+        memset(result, 0, sizeof(*result));
+        result->window_size = window_size;
+        result->mode = mode;
+        result->max_chain = max_chain ? max_chain : 1;
+        result->nice_length = nice_length;
+        result->buffer_size = window_size * 2;
+        if (result->buffer_size < window_size + CAB_COMPRESSOR_BLOCK_SIZE) {
+            result->buffer_size = window_size + CAB_COMPRESSOR_BLOCK_SIZE;
+        }
+        result->buffer = (uint8_t*)cab_match_finder_mem_alloc(
+            result->buffer_size);
+        result->head = (uint32_t*)cab_match_finder_mem_alloc(
+            sizeof(uint32_t) * CAB_MATCH_FINDER_HASH_SIZE);
+        result->link_count = mode == CAB_MATCH_FINDER_BINARY_TREE ?
+            window_size * 2 : window_size;
+        result->links = (uint32_t*)cab_match_finder_mem_alloc(
+            sizeof(uint32_t) * result->link_count);
+        if (result->buffer && result->head && result->links) {
+            cab_match_finder_reset(result);
+        } else {
+            cab_match_finder_free(result);
+            result = NULL;
+        }
+    }
+    return result;
+}
+
+/**
+ * free match finder
+ */
+void
+cab_match_finder_free(
+    cab_match_finder* obj)
+{
+    if (obj) {
+        if (obj->buffer) {
+            cab_match_finder_mem_free(obj->buffer);
+        }
+        if (obj->head) {
+            cab_match_finder_mem_free(obj->head);
+        }
+        if (obj->links) {
+            cab_match_finder_mem_free(obj->links);
+        }
+        cab_match_finder_mem_free(obj);
+    }
+}
+
+/**
+ * discard all data to start new stream
+ */
+void
+cab_match_finder_reset(
+    cab_match_finder* obj)
+{
+    obj->base = 0;
+    obj->end = 0;
+    obj->position = 0;
+    memset(obj->head, 0, sizeof(uint32_t) * CAB_MATCH_FINDER_HASH_SIZE);
+    memset(obj->links, 0, sizeof(uint32_t) * obj->link_count);
+}
+
+/**
+ * append data into the window.
+ */
+int
+cab_match_finder_append(
+    cab_match_finder* obj,
+    const void* data,
+    unsigned int size)
+{
+    int result;
+    result = 0;
+    if (obj->end - obj->base + size > obj->buffer_size) {
+        uint32_t new_base;
+        if (obj->position - obj->base > obj->window_size) {
+            new_base = obj->position - obj->window_size;
+        } else {
+            new_base = obj->base;
+        }
+        memmove(obj->buffer, obj->buffer + (new_base - obj->base),
+            obj->end - new_base);
+        obj->base = new_base;
+    }
+    if (obj->end - obj->base + size <= obj->buffer_size) {
+        memcpy(obj->buffer + (obj->end - obj->base), data, size);
+        obj->end += size;
+    } else {
+        result = -1;
+        errno = ENOBUFS;
+    }
+    return result;
+}
+
+/**
+ * get data at current position
+ */
+const uint8_t*
+cab_match_finder_get_current(
+    cab_match_finder* obj)
+{
+    return obj->buffer + (obj->position - obj->base);
+}
+
+/**
+ * get count of bytes from current position to the end of data
+ */
+unsigned int
+cab_match_finder_get_available(
+    cab_match_finder* obj)
+{
+    return obj->end - obj->position;
+}
+
+/**
+ * find matches at current position and advance the position.
+ */
+unsigned int
+cab_match_finder_find(
+    cab_match_finder* obj,
+    unsigned int max_length,
+    cab_match* matches)
+{
+    unsigned int result;
+    if (obj->mode == CAB_MATCH_FINDER_BINARY_TREE) {
+        result = cab_match_finder_update_binary_tree(obj,
+            max_length, matches);
+    } else {
+        result = cab_match_finder_find_hash_chain(obj, max_length, matches);
+        cab_match_finder_insert(obj);
+    }
+    obj->position++;
+    return result;
+}
+
+/**
+ * advance current position without finding matches
+ */
+void
+cab_match_finder_skip(
+    cab_match_finder* obj,
+    unsigned int count)
+{
+    while (count-- && obj->position < obj->end) {
+        if (obj->mode == CAB_MATCH_FINDER_BINARY_TREE) {
+            cab_match_finder_update_binary_tree(obj, 0, NULL);
+        } else {
+            cab_match_finder_insert(obj);
+        }
+        obj->position++;
+    }
+}
+
+/**
+ * find matches on hash chain
+ */
+static unsigned int
+cab_match_finder_find_hash_chain(
+    cab_match_finder* obj,
+    unsigned int max_length,
+    cab_match* matches)
+{
+    unsigned int result;
+    unsigned int available;
+    result = 0;
+    available = obj->end - obj->position;
+    if (max_length > available) {
+        max_length = available;
+    }
+    if (max_length >= CAB_MATCH_FINDER_MIN_MATCH) {
+        const uint8_t* current;
+        uint32_t candidate;
+        unsigned int chain;
+        unsigned int best_length;
+        unsigned int nice_length;
+        current = obj->buffer + (obj->position - obj->base);
+        candidate = obj->head[cab_match_finder_hash(current)];
+        chain = obj->max_chain;
+        best_length = CAB_MATCH_FINDER_MIN_MATCH - 1;
+        nice_length = obj->nice_length < max_length ?
+            obj->nice_length : max_length;
+        while (candidate && chain--) {
+            uint32_t candidate_position;
+            unsigned int distance;
+            candidate_position = candidate - 1;
+            if (candidate_position < obj->base
+                || candidate_position >= obj->position) {
+                break;
+            }
+            distance = obj->position - candidate_position;
+            if (distance > obj->window_size) {
+                break;
+            }
+            {
+                const uint8_t* candidate_data;
+                candidate_data = obj->buffer
+                    + (candidate_position - obj->base);
+                if (candidate_data[best_length] == current[best_length]
+                    && candidate_data[0] == current[0]) {
+                    unsigned int length;
+                    length = 1;
+                    while (length < max_length
+                        && candidate_data[length] == current[length]) {
+                        length++;
+                    }
+                    if (length > best_length) {
+                        best_length = length;
+                        if (result == CAB_MATCH_FINDER_MAX_MATCHES) {
+                            memmove(matches, matches + 1,
+                                sizeof(cab_match) * (result - 1));
+                            result--;
+                        }
+                        matches[result].length = length;
+                        matches[result].distance = distance;
+                        result++;
+                        if (length >= nice_length) {
+                            break;
+                        }
+                    }
+                }
+            }
+            candidate = obj->links[candidate_position
+                & (obj->window_size - 1)];
+        }
+    }
+    return result;
+}
+
+/**
+ * insert current position into binary tree and find matches.
+ */
+static unsigned int
+cab_match_finder_update_binary_tree(
+    cab_match_finder* obj,
+    unsigned int max_length,
+    cab_match* matches)
+{
+    unsigned int result;
+    unsigned int limit;
+    result = 0;
+    limit = obj->end - obj->position;
+    if (limit > obj->nice_length) {
+        limit = obj->nice_length;
+    }
+    if (limit >= CAB_MATCH_FINDER_MIN_MATCH) {
+        const uint8_t* current;
+        unsigned int hash;
+        unsigned int mask;
+        uint32_t candidate;
+        uint32_t* smaller_link;
+        uint32_t* greater_link;
+        unsigned int smaller_length;
+        unsigned int greater_length;
+        unsigned int chain;
+        unsigned int best_length;
+        current = obj->buffer + (obj->position - obj->base);
+        hash = cab_match_finder_hash(current);
+        candidate = obj->head[hash];
+        obj->head[hash] = obj->position + 1;
+        mask = obj->window_size - 1;
+        smaller_link = obj->links + ((obj->position & mask) << 1);
+        greater_link = smaller_link + 1;
+        smaller_length = 0;
+        greater_length = 0;
+        chain = obj->max_chain;
+        best_length = CAB_MATCH_FINDER_MIN_MATCH - 1;
+        while (1) {
+            uint32_t candidate_position;
+            uint32_t* pair;
+            const uint8_t* candidate_data;
+            unsigned int length;
+            candidate_position = candidate - 1;
+            if (!candidate || !chain--
+                || candidate_position < obj->base
+                || candidate_position >= obj->position
+                || obj->position - candidate_position >= obj->window_size) {
+                *smaller_link = 0;
+                *greater_link = 0;
+                break;
+            }
+            pair = obj->links + ((candidate_position & mask) << 1);
+            candidate_data = obj->buffer + (candidate_position - obj->base);
+            length = smaller_length < greater_length ?
+                smaller_length : greater_length;
+            while (length < limit
+                && candidate_data[length] == current[length]) {
+                length++;
+            }
+            if (matches) {
+                unsigned int match_length;
+                match_length = length < max_length ? length : max_length;
+                if (match_length > best_length) {
+                    best_length = match_length;
+                    if (result == CAB_MATCH_FINDER_MAX_MATCHES) {
+                        memmove(matches, matches + 1,
+                            sizeof(cab_match) * (result - 1));
+                        result--;
+                    }
+                    matches[result].length = match_length;
+                    matches[result].distance =
+                        obj->position - candidate_position;
+                    result++;
+                }
+            }
+            if (length >= limit) {
+                if (limit == obj->nice_length) {
+                    /* the candidate is replaced with current position */
+                    *smaller_link = pair[0];
+                    *greater_link = pair[1];
+                } else {
+                    /*
+                     * the data ends before nice length, so that the order
+                     * of the candidate and its children is unknown.
+                     * they are left out of the tree.
+                     */
+                    *smaller_link = 0;
+                    *greater_link = 0;
+                }
+                break;
+            }
+            if (candidate_data[length] < current[length]) {
+                *smaller_link = candidate;
+                smaller_link = pair + 1;
+                candidate = *smaller_link;
+                smaller_length = length;
+            } else {
+                *greater_link = candidate;
+                greater_link = pair;
+                candidate = *greater_link;
+                greater_length = length;
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ * calculate hash at the buffer
+ */
+static unsigned int
+cab_match_finder_hash(
+    const uint8_t* data)
+{
+    uint32_t value;
+    value = (uint32_t)data[0] | ((uint32_t)data[1] << 8)
+        | ((uint32_t)data[2] << 16);
+    return (unsigned int)((value * 2654435761U)
+        >> (32 - CAB_MATCH_FINDER_HASH_BITS));
+}
+
+/**
+ * insert current position into hash chain
+ */
+static void
+cab_match_finder_insert(
+    cab_match_finder* obj)
+{
+    if (obj->end - obj->position >= CAB_MATCH_FINDER_MIN_MATCH) {
+        unsigned int hash;
+        hash = cab_match_finder_hash(
+            obj->buffer + (obj->position - obj->base));
+        obj->links[obj->position & (obj->window_size - 1)] =
+            obj->head[hash];
+        obj->head[hash] = obj->position + 1;
+    }
+}
+
+/**
+ * allocate memory
+ */
+static void*
+cab_match_finder_mem_alloc(
+    size_t size)
+{
+    return malloc(size);
+}
+
+/**
+ * free memory
+ */
+static void
+cab_match_finder_mem_free(
+    void* heap_obj)
+{
+    free(heap_obj);
+}
+
+/* vi: se ts=4 sw=4 et: */
@@ -0,0 +1,136 @@
+#ifndef __CAB_MATCH_FINDER_H__
+#define __CAB_MATCH_FINDER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+#define _CAB_MATCH_FINDER_ITFC_BEGIN extern "C" {
+#define _CAB_MATCH_FINDER_ITFC_END }
+#else
+#define _CAB_MATCH_FINDER_ITFC_BEGIN 
+#define _CAB_MATCH_FINDER_ITFC_END 
+#endif
+
+_CAB_MATCH_FINDER_ITFC_BEGIN 
+
+/**
+ * minimum match length the finder can find
+ */
+#define CAB_MATCH_FINDER_MIN_MATCH 3
+
+/**
+ * maximum count of matches found at a position
+ */
+#define CAB_MATCH_FINDER_MAX_MATCHES 32
+
+/**
+ * find matches by hash chains
+ */
+#define CAB_MATCH_FINDER_HASH_CHAIN 0
+
+/**
+ * find matches by binary trees.
+ * It finds longer matches with the same search depth, and uses twice as
+ * much memory for links as hash chains.
+ */
+#define CAB_MATCH_FINDER_BINARY_TREE 1
+
+/**
+ * lz77 match finder over a sliding window
+ */
+typedef struct _cab_match_finder cab_match_finder;
+
+/**
+ * a match
+ */
+typedef struct _cab_match cab_match;
+
+/**
+ * a match
+ */
+struct _cab_match {
+    /**
+     * match length
+     */
+    unsigned int length;
+
+    /**
+     * distance from current position
+     */
+    unsigned int distance;
+};
+
+/**
+ * create match finder.
+ * window_size is the maximum distance of a match and has to be power of 2.
+ * mode is CAB_MATCH_FINDER_HASH_CHAIN or CAB_MATCH_FINDER_BINARY_TREE.
+ */
+cab_match_finder*
+cab_match_finder_create(
+    unsigned int window_size,
+    unsigned int mode,
+    unsigned int max_chain,
+    unsigned int nice_length);
+
+/**
+ * free match finder
+ */
+void
+cab_match_finder_free(
+    cab_match_finder* obj);
+
+/**
+ * discard all data to start new stream
+ */
+void
+cab_match_finder_reset(
+    cab_match_finder* obj);
+
+/**
+ * append data into the window.
+ * You have to consume all appended data before appending new data.
+ */
+int
+cab_match_finder_append(
+    cab_match_finder* obj,
+    const void* data,
+    unsigned int size);
+
+/**
+ * get data at current position
+ */
+const uint8_t*
+cab_match_finder_get_current(
+    cab_match_finder* obj);
+
+/**
+ * get count of bytes from current position to the end of data
+ */
+unsigned int
+cab_match_finder_get_available(
+    cab_match_finder* obj);
+
+/**
+ * find matches at current position and advance the position.
+ * Matches are stored in length ascending order and a longer match has
+ * longer or same distance. You get the count of matches.
+ */
+unsigned int
+cab_match_finder_find(
+    cab_match_finder* obj,
+    unsigned int max_length,
+    cab_match* matches);
+
+/**
+ * advance current position without finding matches
+ */
+void
+cab_match_finder_skip(
+    cab_match_finder* obj,
+    unsigned int count);
+
+_CAB_MATCH_FINDER_ITFC_END 
+
+/* vi: se ts=4 sw=4 et: */
+#endif
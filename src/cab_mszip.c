@@ -0,0 +1,1330 @@
+#include "cab_mszip.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include "cab_compressor.h"
+#include "cab_huffman.h"
+#include "cab_match_finder.h"
+
+/**
+ * deflate window size
+ */
+#define CAB_MSZIP_WINDOW_SIZE 32768U
+
+/**
+ * minimum match length
+ */
+#define CAB_MSZIP_MIN_MATCH 3
+
+/**
+ * maximum match length
+ */
+#define CAB_MSZIP_MAX_MATCH 258
+
+/**
+ * literal and length symbols count
+ */
+#define CAB_MSZIP_LITLEN_SYMBOLS 286
+
+/**
+ * literal and length symbols count for fixed huffman code
+ */
+#define CAB_MSZIP_FIXED_LITLEN_SYMBOLS 288
+
+/**
+ * distance symbols count
+ */
+#define CAB_MSZIP_DIST_SYMBOLS 30
+
+/**
+ * code length symbols count
+ */
+#define CAB_MSZIP_CODELEN_SYMBOLS 19
+
+/**
+ * end of block symbol
+ */
+#define CAB_MSZIP_END_OF_BLOCK 256
+
+/**
+ * maximum code length for literal, length and distance
+ */
+#define CAB_MSZIP_MAX_CODE_LENGTH 15
+
+/**
+ * maximum code length for code length alphabet
+ */
+#define CAB_MSZIP_MAX_CODELEN_LENGTH 7
+
+/**
+ * minimum length matches farther than this distance are ignored
+ */
+#define CAB_MSZIP_TOO_FAR 4096
+
+/**
+ * maximum matches to be kept for a position on optimal parsing
+ */
+#define CAB_MSZIP_OPTIMAL_MATCHES 8
+
+/**
+ * cost for unreachable position
+ */
+#define CAB_MSZIP_COST_INFINITE 0xFFFFFFFFU
+
+/**
+ * parsing strategy
+ */
+typedef enum {
+    /**
+     * take the longest match at each position
+     */
+    CAB_MSZIP_PARSE_GREEDY,
+    /**
+     * defer a match when the next position has longer match
+     */
+    CAB_MSZIP_PARSE_LAZY,
+    /**
+     * minimize estimated bit cost over a block
+     */
+    CAB_MSZIP_PARSE_OPTIMAL
+} cab_mszip_parse;
+
+/**
+ * compression parameters
+ */
+typedef struct _cab_mszip_params cab_mszip_params;
+
+/**
+ * bit writer
+ */
+typedef struct _cab_mszip_bit_writer cab_mszip_bit_writer;
+
+/**
+ * huffman codes for a block
+ */
+typedef struct _cab_mszip_codes cab_mszip_codes;
+
+/**
+ * compression parameters
+ */
+struct _cab_mszip_params {
+    /**
+     * parsing strategy
+     */
+    cab_mszip_parse parse;
+
+    /**
+     * maximum count of candidates to be examined
+     */
+    unsigned int max_chain;
+
+    /**
+     * stop searching when a match reaches this length
+     */
+    unsigned int nice_length;
+
+    /**
+     * do not defer a match equal or longer than this length
+     */
+    unsigned int lazy_length;
+
+    /**
+     * count of cost estimation passes on optimal parsing
+     */
+    unsigned int iterations;
+};
+
+/**
+ * bit writer
+ */
+struct _cab_mszip_bit_writer {
+    /**
+     * output buffer
+     */
+    uint8_t* data;
+
+    /**
+     * output buffer size
+     */
+    unsigned int capacity;
+
+    /**
+     * written size
+     */
+    unsigned int size;
+
+    /**
+     * pending bits
+     */
+    uint32_t bits;
+
+    /**
+     * count of pending bits
+     */
+    unsigned int bit_count;
+
+    /**
+     * not zero if output buffer is overflowed
+     */
+    int overflow;
+};
+
+/**
+ * huffman codes for a block
+ */
+struct _cab_mszip_codes {
+    /**
+     * literal and length code lengths
+     */
+    uint8_t litlen_lengths[CAB_MSZIP_FIXED_LITLEN_SYMBOLS];
+
+    /**
+     * literal and length codes in bit reversed order
+     */
+    uint16_t litlen_codes[CAB_MSZIP_FIXED_LITLEN_SYMBOLS];
+
+    /**
+     * distance code lengths
+     */
+    uint8_t dist_lengths[CAB_MSZIP_DIST_SYMBOLS + 2];
+
+    /**
+     * distance codes in bit reversed order
+     */
+    uint16_t dist_codes[CAB_MSZIP_DIST_SYMBOLS + 2];
+};
+
+/**
+ * mszip compressor
+ */
+struct _cab_mszip {
+    /**
+     * compression parameters
+     */
+    const cab_mszip_params* params;
+
+    /**
+     * match finder
+     */
+    cab_match_finder* finder;
+
+    /**
+     * literal (0-255) or match length plus 256
+     */
+    uint16_t* symbols;
+
+    /**
+     * match distance, or zero for literal
+     */
+    uint16_t* distances;
+
+    /**
+     * count of symbols
+     */
+    unsigned int symbol_count;
+
+    /**
+     * length to length code index
+     */
+    uint8_t length_codes[CAB_MSZIP_MAX_MATCH + 1];
+
+    /**
+     * matches for each position on optimal parsing
+     */
+    cab_match* matches;
+
+    /**
+     * count of matches for each position on optimal parsing
+     */
+    uint8_t* match_counts;
+
+    /**
+     * cost to reach each position on optimal parsing
+     */
+    uint32_t* costs;
+
+    /**
+     * selected length to reach each position on optimal parsing
+     */
+    uint16_t* choice_lengths;
+
+    /**
+     * selected distance to reach each position on optimal parsing
+     */
+    uint16_t* choice_distances;
+};
+
+/**
+ * compression parameters for presets
+ */
+static const cab_mszip_params CAB_MSZIP_PRESETS[] = {
+    { CAB_MSZIP_PARSE_LAZY, 64, 128, 32, 0 },
+    { CAB_MSZIP_PARSE_GREEDY, 8, 32, 0, 0 },
+    { CAB_MSZIP_PARSE_LAZY, 64, 128, 32, 0 },
+    { CAB_MSZIP_PARSE_LAZY, 1024, 258, 258, 0 },
+    { CAB_MSZIP_PARSE_OPTIMAL, 1024, 258, 258, 3 }
+};
+
+/**
+ * base length for length codes
+ */
+static const uint16_t CAB_MSZIP_LENGTH_BASE[] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+/**
+ * extra bits for length codes
+ */
+static const uint8_t CAB_MSZIP_LENGTH_EXTRA[] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+/**
+ * base distance for distance codes
+ */
+static const uint16_t CAB_MSZIP_DIST_BASE[] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+    8193, 12289, 16385, 24577
+};
+
+/**
+ * extra bits for distance codes
+ */
+static const uint8_t CAB_MSZIP_DIST_EXTRA[] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+/**
+ * order of code length codes in block header
+ */
+static const uint8_t CAB_MSZIP_CODELEN_ORDER[] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+/**
+ * get distance code index
+ */
+static unsigned int
+cab_mszip_dist_code(
+    unsigned int distance);
+
+/**
+ * parse a block with greedy or lazy matching
+ */
+static void
+cab_mszip_parse_lazy(
+    cab_mszip* obj,
+    const uint8_t* src,
+    unsigned int src_size);
+
+/**
+ * parse a block with optimal parsing
+ */
+static void
+cab_mszip_parse_optimal(
+    cab_mszip* obj,
+    const uint8_t* src,
+    unsigned int src_size);
+
+/**
+ * find the cheapest path with the costs
+ */
+static void
+cab_mszip_find_cheapest(
+    cab_mszip* obj,
+    const uint8_t* src,
+    unsigned int src_size,
+    const uint32_t* litlen_costs,
+    const uint32_t* dist_costs);
+
+/**
+ * append a literal symbol
+ */
+static void
+cab_mszip_add_literal(
+    cab_mszip* obj,
+    unsigned int literal);
+
+/**
+ * append a match symbol
+ */
+static void
+cab_mszip_add_match(
+    cab_mszip* obj,
+    unsigned int length,
+    unsigned int distance);
+
+/**
+ * count symbol frequencies
+ */
+static void
+cab_mszip_count_frequencies(
+    cab_mszip* obj,
+    unsigned int* litlen_freqs,
+    unsigned int* dist_freqs);
+
+/**
+ * calculate bit costs from code lengths
+ */
+static void
+cab_mszip_lengths_to_costs(
+    const uint8_t* litlen_lengths,
+    const uint8_t* dist_lengths,
+    uint32_t* litlen_costs,
+    uint32_t* dist_costs);
+
+/**
+ * build dynamic huffman code lengths for current symbols
+ */
+static void
+cab_mszip_build_dynamic_lengths(
+    cab_mszip* obj,
+    uint8_t* litlen_lengths,
+    uint8_t* dist_lengths);
+
+/**
+ * set fixed huffman code lengths
+ */
+static void
+cab_mszip_fixed_lengths(
+    uint8_t* litlen_lengths,
+    uint8_t* dist_lengths);
+
+/**
+ * build bit reversed codes from code lengths
+ */
+static void
+cab_mszip_build_codes(
+    cab_mszip_codes* codes);
+
+/**
+ * calculate bit size of symbols with the codes
+ */
+static unsigned long
+cab_mszip_symbols_bit_size(
+    cab_mszip* obj,
+    const cab_mszip_codes* codes);
+
+/**
+ * run length encode code lengths for dynamic block header
+ */
+static unsigned int
+cab_mszip_encode_code_lengths(
+    const uint8_t* lengths,
+    unsigned int count,
+    uint8_t* rle_symbols,
+    uint8_t* rle_extras);
+
+/**
+ * write symbols with the codes
+ */
+static void
+cab_mszip_write_symbols(
+    cab_mszip* obj,
+    cab_mszip_bit_writer* writer,
+    const cab_mszip_codes* codes);
+
+/**
+ * write a block
+ */
+static void
+cab_mszip_write_block(
+    cab_mszip* obj,
+    const uint8_t* src,
+    unsigned int src_size,
+    cab_mszip_bit_writer* writer);
+
+/**
+ * write bits
+ */
+static void
+cab_mszip_put_bits(
+    cab_mszip_bit_writer* writer,
+    uint32_t value,
+    unsigned int count);
+
+/**
+ * write pending bits with padding
+ */
+static void
+cab_mszip_flush_bits(
+    cab_mszip_bit_writer* writer);
+
+/**
+ * reverse bits
+ */
+static uint16_t
+cab_mszip_reverse_bits(
+    unsigned int code,
+    unsigned int length);
+
+/**
+ * allocate memory
+ */
+static void*
+cab_mszip_mem_alloc(
+    size_t size);
+
+/**
+ * free memory
+ */
+static void
+cab_mszip_mem_free(
+    void* heap_obj);
+
+/**
+ * create mszip compressor with compression preset
+ */
+cab_mszip*
+cab_mszip_create(
+    unsigned int preset)
+{
+    cab_mszip* result;
+    result = NULL;
+    if (preset < sizeof(CAB_MSZIP_PRESETS) / sizeof(CAB_MSZIP_PRESETS[0])) {
+        result = (cab_mszip*)cab_mszip_mem_alloc(sizeof(cab_mszip));
+    } else {
+        errno = EINVAL;
+    }
+    if (result) {
+        int state;
+        unsigned int idx;
+        memset(result, 0, sizeof(*result));
+        result->params = &CAB_MSZIP_PRESETS[preset];
+        for (idx = 0; idx < sizeof(CAB_MSZIP_LENGTH_BASE)
+            / sizeof(CAB_MSZIP_LENGTH_BASE[0]); idx++) {
+            unsigned int length;
+            for (length = CAB_MSZIP_LENGTH_BASE[idx];
+                length < CAB_MSZIP_LENGTH_BASE[idx]
+                    + (1U << CAB_MSZIP_LENGTH_EXTRA[idx])
+                && length <= CAB_MSZIP_MAX_MATCH; length++) {
+                result->length_codes[length] = (uint8_t)idx;
+            }
+        }
+        result->finder = cab_match_finder_create(CAB_MSZIP_WINDOW_SIZE,
+            CAB_MATCH_FINDER_HASH_CHAIN, result->params->max_chain,
+            result->params->nice_length);
+        result->symbols = (uint16_t*)cab_mszip_mem_alloc(
+            sizeof(uint16_t) * (CAB_COMPRESSOR_BLOCK_SIZE + 1));
+        result->distances = (uint16_t*)cab_mszip_mem_alloc(
+            sizeof(uint16_t) * (CAB_COMPRESSOR_BLOCK_SIZE + 1));
+        state = result->finder && result->symbols && result->distances ?
+            0 : -1;
+        if (state == 0
+            && result->params->parse == CAB_MSZIP_PARSE_OPTIMAL) {
+            result->matches = (cab_match*)cab_mszip_mem_alloc(
+                sizeof(cab_match) * CAB_MSZIP_OPTIMAL_MATCHES
+                * CAB_COMPRESSOR_BLOCK_SIZE);
+            result->match_counts = (uint8_t*)cab_mszip_mem_alloc(
+                CAB_COMPRESSOR_BLOCK_SIZE);
+            result->costs = (uint32_t*)cab_mszip_mem_alloc(
+                sizeof(uint32_t) * (CAB_COMPRESSOR_BLOCK_SIZE + 1));
+            result->choice_lengths = (uint16_t*)cab_mszip_mem_alloc(
+                sizeof(uint16_t) * (CAB_COMPRESSOR_BLOCK_SIZE + 1));
+            result->choice_distances = (uint16_t*)cab_mszip_mem_alloc(
+                sizeof(uint16_t) * (CAB_COMPRESSOR_BLOCK_SIZE + 1));
+            state = result->matches && result->match_counts
+                && result->costs && result->choice_lengths
+                && result->choice_distances ? 0 : -1;
+        }
+        if (state) {
+            cab_mszip_free(result);
+            result = NULL;
+        }
+    }
+    return result;
+}
+
+/**
+ * free mszip compressor
+ */
+void
+cab_mszip_free(
+    cab_mszip* obj)
+{
+    if (obj) {
+        if (obj->finder) {
+            cab_match_finder_free(obj->finder);
+        }
+        if (obj->symbols) {
+            cab_mszip_mem_free(obj->symbols);
+        }
+        if (obj->distances) {
+            cab_mszip_mem_free(obj->distances);
+        }
+        if (obj->matches) {
+            cab_mszip_mem_free(obj->matches);
+        }
+        if (obj->match_counts) {
+            cab_mszip_mem_free(obj->match_counts);
+        }
+        if (obj->costs) {
+            cab_mszip_mem_free(obj->costs);
+        }
+        if (obj->choice_lengths) {
+            cab_mszip_mem_free(obj->choice_lengths);
+        }
+        if (obj->choice_distances) {
+            cab_mszip_mem_free(obj->choice_distances);
+        }
+        cab_mszip_mem_free(obj);
+    }
+}
+
+/**
+ * reset compressor to begin new folder
+ */
+int
+cab_mszip_reset(
+    cab_mszip* obj)
+{
+    int result;
+    if (obj) {
+        result = 0;
+        cab_match_finder_reset(obj->finder);
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * compress a data block into "CK" signature and a deflate stream.
+ */
+int
+cab_mszip_compress(
+    cab_mszip* obj,
+    const void* src,
+    unsigned int src_size,
+    void* dst,
+    unsigned int* dst_size)
+{
+    int result;
+    if (obj && src && dst && dst_size && src_size
+        && src_size <= CAB_COMPRESSOR_BLOCK_SIZE) {
+        result = cab_match_finder_append(obj->finder, src, src_size);
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    if (result == 0) {
+        cab_mszip_bit_writer writer;
+        uint8_t* dst_bytes;
+        dst_bytes = (uint8_t*)dst;
+        dst_bytes[0] = 'C';
+        dst_bytes[1] = 'K';
+        memset(&writer, 0, sizeof(writer));
+        writer.data = dst_bytes + 2;
+        writer.capacity = CAB_COMPRESSOR_MAX_COMPRESSED_SIZE - 2;
+        obj->symbol_count = 0;
+        if (obj->params->parse == CAB_MSZIP_PARSE_OPTIMAL) {
+            cab_mszip_parse_optimal(obj, (const uint8_t*)src, src_size);
+        } else {
+            cab_mszip_parse_lazy(obj, (const uint8_t*)src, src_size);
+        }
+        cab_mszip_write_block(obj, (const uint8_t*)src, src_size, &writer);
+        if (writer.overflow) {
+            result = -1;
+            errno = ENOBUFS;
+        } else {
+            *dst_size = writer.size + 2;
+        }
+    }
+    return result;
+}
+
+/**
+ * get distance code index
+ */
+static unsigned int
+cab_mszip_dist_code(
+    unsigned int distance)
+{
+    unsigned int result;
+    if (distance <= 4) {
+        result = distance - 1;
+    } else {
+        unsigned int value;
+        unsigned int bits;
+        value = distance - 1;
+        bits = 0;
+        while ((value >> (bits + 1)) != 0) {
+            bits++;
+        }
+        result = bits * 2 + ((value >> (bits - 1)) & 1);
+    }
+    return result;
+}
+
+/**
+ * parse a block with greedy or lazy matching
+ */
+static void
+cab_mszip_parse_lazy(
+    cab_mszip* obj,
+    const uint8_t* src,
+    unsigned int src_size)
+{
+    unsigned int position;
+    unsigned int prev_length;
+    unsigned int prev_distance;
+    int prev_available;
+    cab_match matches[CAB_MATCH_FINDER_MAX_MATCHES];
+    position = 0;
+    prev_length = 0;
+    prev_distance = 0;
+    prev_available = 0;
+    while (position < src_size) {
+        unsigned int count;
+        unsigned int length;
+        unsigned int distance;
+        unsigned int max_length;
+        max_length = src_size - position;
+        if (max_length > CAB_MSZIP_MAX_MATCH) {
+            max_length = CAB_MSZIP_MAX_MATCH;
+        }
+        count = cab_match_finder_find(obj->finder, max_length, matches);
+        length = 0;
+        distance = 0;
+        if (count) {
+            length = matches[count - 1].length;
+            distance = matches[count - 1].distance;
+            if (length == CAB_MSZIP_MIN_MATCH
+                && distance > CAB_MSZIP_TOO_FAR) {
+                length = 0;
+            }
+        }
+        if (prev_length >= CAB_MSZIP_MIN_MATCH && length <= prev_length) {
+            cab_mszip_add_match(obj, prev_length, prev_distance);
+            cab_match_finder_skip(obj->finder, prev_length - 2);
+            position += prev_length - 1;
+            prev_length = 0;
+            prev_available = 0;
+        } else {
+            if (prev_available) {
+                cab_mszip_add_literal(obj, src[position - 1]);
+            }
+            if (length >= CAB_MSZIP_MIN_MATCH
+                && length >= obj->params->lazy_length) {
+                cab_mszip_add_match(obj, length, distance);
+                cab_match_finder_skip(obj->finder, length - 1);
+                position += length;
+                prev_length = 0;
+                prev_available = 0;
+            } else {
+                prev_length = length;
+                prev_distance = distance;
+                prev_available = 1;
+                position++;
+            }
+        }
+    }
+    if (prev_available) {
+        cab_mszip_add_literal(obj, src[src_size - 1]);
+    }
+}
+
+/**
+ * parse a block with optimal parsing
+ */
+static void
+cab_mszip_parse_optimal(
+    cab_mszip* obj,
+    const uint8_t* src,
+    unsigned int src_size)
+{
+    unsigned int position;
+    unsigned int iteration;
+    uint8_t litlen_lengths[CAB_MSZIP_FIXED_LITLEN_SYMBOLS];
+    uint8_t dist_lengths[CAB_MSZIP_DIST_SYMBOLS + 2];
+    uint32_t litlen_costs[CAB_MSZIP_FIXED_LITLEN_SYMBOLS];
+    uint32_t dist_costs[CAB_MSZIP_DIST_SYMBOLS + 2];
+    for (position = 0; position < src_size; position++) {
+        cab_match matches[CAB_MATCH_FINDER_MAX_MATCHES];
+        unsigned int count;
+        unsigned int max_length;
+        unsigned int first;
+        max_length = src_size - position;
+        if (max_length > CAB_MSZIP_MAX_MATCH) {
+            max_length = CAB_MSZIP_MAX_MATCH;
+        }
+        count = cab_match_finder_find(obj->finder, max_length, matches);
+        first = count > CAB_MSZIP_OPTIMAL_MATCHES ?
+            count - CAB_MSZIP_OPTIMAL_MATCHES : 0;
+        memcpy(obj->matches + position * CAB_MSZIP_OPTIMAL_MATCHES,
+            matches + first, sizeof(cab_match) * (count - first));
+        obj->match_counts[position] = (uint8_t)(count - first);
+    }
+    cab_mszip_fixed_lengths(litlen_lengths, dist_lengths);
+    for (iteration = 0; iteration < obj->params->iterations; iteration++) {
+        cab_mszip_lengths_to_costs(litlen_lengths, dist_lengths,
+            litlen_costs, dist_costs);
+        cab_mszip_find_cheapest(obj, src, src_size,
+            litlen_costs, dist_costs);
+        if (iteration + 1 < obj->params->iterations) {
+            cab_mszip_build_dynamic_lengths(obj,
+                litlen_lengths, dist_lengths);
+        }
+    }
+}
+
+/**
+ * find the cheapest path with the costs
+ */
+static void
+cab_mszip_find_cheapest(
+    cab_mszip* obj,
+    const uint8_t* src,
+    unsigned int src_size,
+    const uint32_t* litlen_costs,
+    const uint32_t* dist_costs)
+{
+    unsigned int position;
+    uint32_t* costs;
+    costs = obj->costs;
+    costs[0] = 0;
+    for (position = 1; position <= src_size; position++) {
+        costs[position] = CAB_MSZIP_COST_INFINITE;
+    }
+    for (position = 0; position < src_size; position++) {
+        uint32_t cost;
+        const cab_match* matches;
+        unsigned int count;
+        unsigned int idx;
+        unsigned int length;
+        cost = costs[position] + litlen_costs[src[position]];
+        if (cost < costs[position + 1]) {
+            costs[position + 1] = cost;
+            obj->choice_lengths[position + 1] = 1;
+            obj->choice_distances[position + 1] = 0;
+        }
+        matches = obj->matches + position * CAB_MSZIP_OPTIMAL_MATCHES;
+        count = obj->match_counts[position];
+        length = CAB_MSZIP_MIN_MATCH;
+        for (idx = 0; idx < count; idx++) {
+            uint32_t dist_cost;
+            dist_cost = costs[position]
+                + dist_costs[cab_mszip_dist_code(matches[idx].distance)];
+            for (; length <= matches[idx].length; length++) {
+                cost = dist_cost + litlen_costs[257
+                    + obj->length_codes[length]]
+                    + CAB_MSZIP_LENGTH_EXTRA[obj->length_codes[length]];
+                if (cost < costs[position + length]) {
+                    costs[position + length] = cost;
+                    obj->choice_lengths[position + length] =
+                        (uint16_t)length;
+                    obj->choice_distances[position + length] =
+                        (uint16_t)matches[idx].distance;
+                }
+            }
+        }
+    }
+    {
+        unsigned int count;
+        unsigned int idx;
+        count = 0;
+        position = src_size;
+        while (position > 0) {
+            position -= obj->choice_lengths[position];
+            count++;
+        }
+        obj->symbol_count = count;
+        position = src_size;
+        idx = count;
+        while (position > 0) {
+            unsigned int length;
+            idx--;
+            length = obj->choice_lengths[position];
+            if (length == 1) {
+                obj->symbols[idx] = src[position - 1];
+                obj->distances[idx] = 0;
+            } else {
+                obj->symbols[idx] = (uint16_t)(256 + length);
+                obj->distances[idx] = obj->choice_distances[position];
+            }
+            position -= length;
+        }
+    }
+}
+
+/**
+ * append a literal symbol
+ */
+static void
+cab_mszip_add_literal(
+    cab_mszip* obj,
+    unsigned int literal)
+{
+    obj->symbols[obj->symbol_count] = (uint16_t)literal;
+    obj->distances[obj->symbol_count] = 0;
+    obj->symbol_count++;
+}
+
+/**
+ * append a match symbol
+ */
+static void
+cab_mszip_add_match(
+    cab_mszip* obj,
+    unsigned int length,
+    unsigned int distance)
+{
+    obj->symbols[obj->symbol_count] = (uint16_t)(256 + length);
+    obj->distances[obj->symbol_count] = (uint16_t)distance;
+    obj->symbol_count++;
+}
+
+/**
+ * count symbol frequencies
+ */
+static void
+cab_mszip_count_frequencies(
+    cab_mszip* obj,
+    unsigned int* litlen_freqs,
+    unsigned int* dist_freqs)
+{
+    unsigned int idx;
+    memset(litlen_freqs, 0,
+        sizeof(unsigned int) * CAB_MSZIP_FIXED_LITLEN_SYMBOLS);
+    memset(dist_freqs, 0, sizeof(unsigned int) * (CAB_MSZIP_DIST_SYMBOLS + 2));
+    for (idx = 0; idx < obj->symbol_count; idx++) {
+        if (obj->distances[idx]) {
+            litlen_freqs[257
+                + obj->length_codes[obj->symbols[idx] - 256]]++;
+            dist_freqs[cab_mszip_dist_code(obj->distances[idx])]++;
+        } else {
+            litlen_freqs[obj->symbols[idx]]++;
+        }
+    }
+    litlen_freqs[CAB_MSZIP_END_OF_BLOCK]++;
+}
+
+/**
+ * calculate bit costs from code lengths
+ */
+static void
+cab_mszip_lengths_to_costs(
+    const uint8_t* litlen_lengths,
+    const uint8_t* dist_lengths,
+    uint32_t* litlen_costs,
+    uint32_t* dist_costs)
+{
+    unsigned int idx;
+    for (idx = 0; idx < CAB_MSZIP_FIXED_LITLEN_SYMBOLS; idx++) {
+        litlen_costs[idx] = litlen_lengths[idx] ?
+            litlen_lengths[idx] : CAB_MSZIP_MAX_CODE_LENGTH;
+    }
+    for (idx = 0; idx < CAB_MSZIP_DIST_SYMBOLS; idx++) {
+        dist_costs[idx] = (dist_lengths[idx] ?
+            dist_lengths[idx] : CAB_MSZIP_MAX_CODE_LENGTH)
+            + CAB_MSZIP_DIST_EXTRA[idx];
+    }
+}
+
+/**
+ * build dynamic huffman code lengths for current symbols
+ */
+static void
+cab_mszip_build_dynamic_lengths(
+    cab_mszip* obj,
+    uint8_t* litlen_lengths,
+    uint8_t* dist_lengths)
+{
+    unsigned int litlen_freqs[CAB_MSZIP_FIXED_LITLEN_SYMBOLS];
+    unsigned int dist_freqs[CAB_MSZIP_DIST_SYMBOLS + 2];
+    cab_mszip_count_frequencies(obj, litlen_freqs, dist_freqs);
+    memset(litlen_lengths, 0, CAB_MSZIP_FIXED_LITLEN_SYMBOLS);
+    memset(dist_lengths, 0, CAB_MSZIP_DIST_SYMBOLS + 2);
+    cab_huffman_build_lengths(litlen_freqs, CAB_MSZIP_LITLEN_SYMBOLS,
+        CAB_MSZIP_MAX_CODE_LENGTH, litlen_lengths);
+    cab_huffman_build_lengths(dist_freqs, CAB_MSZIP_DIST_SYMBOLS,
+        CAB_MSZIP_MAX_CODE_LENGTH, dist_lengths);
+    if (!dist_lengths[0] && !dist_lengths[1]) {
+        unsigned int idx;
+        for (idx = 0; idx < CAB_MSZIP_DIST_SYMBOLS; idx++) {
+            if (dist_lengths[idx]) {
+                break;
+            }
+        }
+        if (idx == CAB_MSZIP_DIST_SYMBOLS) {
+            dist_lengths[0] = 1;
+            dist_lengths[1] = 1;
+        }
+    }
+}
+
+/**
+ * set fixed huffman code lengths
+ */
+static void
+cab_mszip_fixed_lengths(
+    uint8_t* litlen_lengths,
+    uint8_t* dist_lengths)
+{
+    unsigned int idx;
+    for (idx = 0; idx < CAB_MSZIP_FIXED_LITLEN_SYMBOLS; idx++) {
+        if (idx < 144) {
+            litlen_lengths[idx] = 8;
+        } else if (idx < 256) {
+            litlen_lengths[idx] = 9;
+        } else if (idx < 280) {
+            litlen_lengths[idx] = 7;
+        } else {
+            litlen_lengths[idx] = 8;
+        }
+    }
+    for (idx = 0; idx < CAB_MSZIP_DIST_SYMBOLS + 2; idx++) {
+        dist_lengths[idx] = 5;
+    }
+}
+
+/**
+ * build bit reversed codes from code lengths
+ */
+static void
+cab_mszip_build_codes(
+    cab_mszip_codes* codes)
+{
+    unsigned int idx;
+    cab_huffman_build_codes(codes->litlen_lengths,
+        CAB_MSZIP_FIXED_LITLEN_SYMBOLS, codes->litlen_codes);
+    cab_huffman_build_codes(codes->dist_lengths,
+        CAB_MSZIP_DIST_SYMBOLS + 2, codes->dist_codes);
+    for (idx = 0; idx < CAB_MSZIP_FIXED_LITLEN_SYMBOLS; idx++) {
+        codes->litlen_codes[idx] = cab_mszip_reverse_bits(
+            codes->litlen_codes[idx], codes->litlen_lengths[idx]);
+    }
+    for (idx = 0; idx < CAB_MSZIP_DIST_SYMBOLS + 2; idx++) {
+        codes->dist_codes[idx] = cab_mszip_reverse_bits(
+            codes->dist_codes[idx], codes->dist_lengths[idx]);
+    }
+}
+
+/**
+ * calculate bit size of symbols with the codes
+ */
+static unsigned long
+cab_mszip_symbols_bit_size(
+    cab_mszip* obj,
+    const cab_mszip_codes* codes)
+{
+    unsigned long result;
+    unsigned int idx;
+    result = codes->litlen_lengths[CAB_MSZIP_END_OF_BLOCK];
+    for (idx = 0; idx < obj->symbol_count; idx++) {
+        if (obj->distances[idx]) {
+            unsigned int length_code;
+            unsigned int dist_code;
+            length_code = obj->length_codes[obj->symbols[idx] - 256];
+            dist_code = cab_mszip_dist_code(obj->distances[idx]);
+            result += codes->litlen_lengths[257 + length_code]
+                + CAB_MSZIP_LENGTH_EXTRA[length_code]
+                + codes->dist_lengths[dist_code]
+                + CAB_MSZIP_DIST_EXTRA[dist_code];
+        } else {
+            result += codes->litlen_lengths[obj->symbols[idx]];
+        }
+    }
+    return result;
+}
+
+/**
+ * run length encode code lengths for dynamic block header
+ */
+static unsigned int
+cab_mszip_encode_code_lengths(
+    const uint8_t* lengths,
+    unsigned int count,
+    uint8_t* rle_symbols,
+    uint8_t* rle_extras)
+{
+    unsigned int result;
+    unsigned int idx;
+    result = 0;
+    idx = 0;
+    while (idx < count) {
+        unsigned int run;
+        unsigned int remaining;
+        run = 1;
+        while (idx + run < count && lengths[idx + run] == lengths[idx]) {
+            run++;
+        }
+        remaining = run;
+        if (lengths[idx] == 0) {
+            while (remaining >= 11) {
+                unsigned int repeat;
+                repeat = remaining < 138 ? remaining : 138;
+                rle_symbols[result] = 18;
+                rle_extras[result++] = (uint8_t)(repeat - 11);
+                remaining -= repeat;
+            }
+            if (remaining >= 3) {
+                rle_symbols[result] = 17;
+                rle_extras[result++] = (uint8_t)(remaining - 3);
+                remaining = 0;
+            }
+        } else {
+            rle_symbols[result] = lengths[idx];
+            rle_extras[result++] = 0;
+            remaining--;
+            while (remaining >= 3) {
+                unsigned int repeat;
+                repeat = remaining < 6 ? remaining : 6;
+                rle_symbols[result] = 16;
+                rle_extras[result++] = (uint8_t)(repeat - 3);
+                remaining -= repeat;
+            }
+        }
+        while (remaining > 0) {
+            rle_symbols[result] = lengths[idx];
+            rle_extras[result++] = 0;
+            remaining--;
+        }
+        idx += run;
+    }
+    return result;
+}
+
+/**
+ * write symbols with the codes
+ */
+static void
+cab_mszip_write_symbols(
+    cab_mszip* obj,
+    cab_mszip_bit_writer* writer,
+    const cab_mszip_codes* codes)
+{
+    unsigned int idx;
+    for (idx = 0; idx < obj->symbol_count; idx++) {
+        if (obj->distances[idx]) {
+            unsigned int length;
+            unsigned int distance;
+            unsigned int length_code;
+            unsigned int dist_code;
+            length = obj->symbols[idx] - 256;
+            distance = obj->distances[idx];
+            length_code = obj->length_codes[length];
+            dist_code = cab_mszip_dist_code(distance);
+            cab_mszip_put_bits(writer, codes->litlen_codes[257 + length_code],
+                codes->litlen_lengths[257 + length_code]);
+            cab_mszip_put_bits(writer,
+                length - CAB_MSZIP_LENGTH_BASE[length_code],
+                CAB_MSZIP_LENGTH_EXTRA[length_code]);
+            cab_mszip_put_bits(writer, codes->dist_codes[dist_code],
+                codes->dist_lengths[dist_code]);
+            cab_mszip_put_bits(writer,
+                distance - CAB_MSZIP_DIST_BASE[dist_code],
+                CAB_MSZIP_DIST_EXTRA[dist_code]);
+        } else {
+            cab_mszip_put_bits(writer, codes->litlen_codes[obj->symbols[idx]],
+                codes->litlen_lengths[obj->symbols[idx]]);
+        }
+    }
+    cab_mszip_put_bits(writer, codes->litlen_codes[CAB_MSZIP_END_OF_BLOCK],
+        codes->litlen_lengths[CAB_MSZIP_END_OF_BLOCK]);
+}
+
+/**
+ * write a block.
+ * The smallest block type among stored, fixed and dynamic is chosen.
+ */
+static void
+cab_mszip_write_block(
+    cab_mszip* obj,
+    const uint8_t* src,
+    unsigned int src_size,
+    cab_mszip_bit_writer* writer)
+{
+    cab_mszip_codes dynamic_codes;
+    cab_mszip_codes fixed_codes;
+    uint8_t all_lengths[CAB_MSZIP_LITLEN_SYMBOLS + CAB_MSZIP_DIST_SYMBOLS];
+    uint8_t rle_symbols[CAB_MSZIP_LITLEN_SYMBOLS + CAB_MSZIP_DIST_SYMBOLS];
+    uint8_t rle_extras[CAB_MSZIP_LITLEN_SYMBOLS + CAB_MSZIP_DIST_SYMBOLS];
+    unsigned int codelen_freqs[CAB_MSZIP_CODELEN_SYMBOLS];
+    uint8_t codelen_lengths[CAB_MSZIP_CODELEN_SYMBOLS];
+    uint16_t codelen_codes[CAB_MSZIP_CODELEN_SYMBOLS];
+    unsigned int litlen_count;
+    unsigned int dist_count;
+    unsigned int codelen_count;
+    unsigned int rle_count;
+    unsigned long dynamic_size;
+    unsigned long fixed_size;
+    unsigned long stored_size;
+    unsigned int idx;
+
+    memset(&dynamic_codes, 0, sizeof(dynamic_codes));
+    cab_mszip_build_dynamic_lengths(obj,
+        dynamic_codes.litlen_lengths, dynamic_codes.dist_lengths);
+    cab_mszip_build_codes(&dynamic_codes);
+    cab_mszip_fixed_lengths(fixed_codes.litlen_lengths,
+        fixed_codes.dist_lengths);
+    cab_mszip_build_codes(&fixed_codes);
+
+    litlen_count = CAB_MSZIP_LITLEN_SYMBOLS;
+    while (litlen_count > 257
+        && !dynamic_codes.litlen_lengths[litlen_count - 1]) {
+        litlen_count--;
+    }
+    dist_count = CAB_MSZIP_DIST_SYMBOLS;
+    while (dist_count > 1 && !dynamic_codes.dist_lengths[dist_count - 1]) {
+        dist_count--;
+    }
+    memcpy(all_lengths, dynamic_codes.litlen_lengths, litlen_count);
+    memcpy(all_lengths + litlen_count, dynamic_codes.dist_lengths,
+        dist_count);
+    rle_count = cab_mszip_encode_code_lengths(all_lengths,
+        litlen_count + dist_count, rle_symbols, rle_extras);
+    memset(codelen_freqs, 0, sizeof(codelen_freqs));
+    for (idx = 0; idx < rle_count; idx++) {
+        codelen_freqs[rle_symbols[idx]]++;
+    }
+    cab_huffman_build_lengths(codelen_freqs, CAB_MSZIP_CODELEN_SYMBOLS,
+        CAB_MSZIP_MAX_CODELEN_LENGTH, codelen_lengths);
+    cab_huffman_build_codes(codelen_lengths, CAB_MSZIP_CODELEN_SYMBOLS,
+        codelen_codes);
+    for (idx = 0; idx < CAB_MSZIP_CODELEN_SYMBOLS; idx++) {
+        codelen_codes[idx] = cab_mszip_reverse_bits(codelen_codes[idx],
+            codelen_lengths[idx]);
+    }
+    codelen_count = CAB_MSZIP_CODELEN_SYMBOLS;
+    while (codelen_count > 4
+        && !codelen_lengths[CAB_MSZIP_CODELEN_ORDER[codelen_count - 1]]) {
+        codelen_count--;
+    }
+
+    dynamic_size = 3 + 5 + 5 + 4 + 3 * codelen_count;
+    for (idx = 0; idx < rle_count; idx++) {
+        dynamic_size += codelen_lengths[rle_symbols[idx]];
+        if (rle_symbols[idx] == 16) {
+            dynamic_size += 2;
+        } else if (rle_symbols[idx] == 17) {
+            dynamic_size += 3;
+        } else if (rle_symbols[idx] == 18) {
+            dynamic_size += 7;
+        }
+    }
+    dynamic_size += cab_mszip_symbols_bit_size(obj, &dynamic_codes);
+    fixed_size = 3 + cab_mszip_symbols_bit_size(obj, &fixed_codes);
+    stored_size = 3 + ((8 - (writer->bit_count + 3) % 8) % 8)
+        + 32 + 8UL * src_size;
+
+    if (stored_size <= fixed_size && stored_size <= dynamic_size) {
+        cab_mszip_put_bits(writer, 1, 1);
+        cab_mszip_put_bits(writer, 0, 2);
+        cab_mszip_flush_bits(writer);
+        cab_mszip_put_bits(writer, src_size, 16);
+        cab_mszip_put_bits(writer, ~src_size & 0xFFFF, 16);
+        if (writer->size + src_size <= writer->capacity) {
+            memcpy(writer->data + writer->size, src, src_size);
+            writer->size += src_size;
+        } else {
+            writer->overflow = 1;
+        }
+    } else if (fixed_size <= dynamic_size) {
+        cab_mszip_put_bits(writer, 1, 1);
+        cab_mszip_put_bits(writer, 1, 2);
+        cab_mszip_write_symbols(obj, writer, &fixed_codes);
+    } else {
+        cab_mszip_put_bits(writer, 1, 1);
+        cab_mszip_put_bits(writer, 2, 2);
+        cab_mszip_put_bits(writer, litlen_count - 257, 5);
+        cab_mszip_put_bits(writer, dist_count - 1, 5);
+        cab_mszip_put_bits(writer, codelen_count - 4, 4);
+        for (idx = 0; idx < codelen_count; idx++) {
+            cab_mszip_put_bits(writer,
+                codelen_lengths[CAB_MSZIP_CODELEN_ORDER[idx]], 3);
+        }
+        for (idx = 0; idx < rle_count; idx++) {
+            cab_mszip_put_bits(writer, codelen_codes[rle_symbols[idx]],
+                codelen_lengths[rle_symbols[idx]]);
+            if (rle_symbols[idx] == 16) {
+                cab_mszip_put_bits(writer, rle_extras[idx], 2);
+            } else if (rle_symbols[idx] == 17) {
+                cab_mszip_put_bits(writer, rle_extras[idx], 3);
+            } else if (rle_symbols[idx] == 18) {
+                cab_mszip_put_bits(writer, rle_extras[idx], 7);
+            }
+        }
+        cab_mszip_write_symbols(obj, writer, &dynamic_codes);
+    }
+    cab_mszip_flush_bits(writer);
+}
+
+/**
+ * write bits
+ */
+static void
+cab_mszip_put_bits(
+    cab_mszip_bit_writer* writer,
+    uint32_t value,
+    unsigned int count)
+{
+    writer->bits |= value << writer->bit_count;
+    writer->bit_count += count;
+    while (writer->bit_count >= 8) {
+        if (writer->size < writer->capacity) {
+            writer->data[writer->size++] = (uint8_t)writer->bits;
+        } else {
+            writer->overflow = 1;
+        }
+        writer->bits >>= 8;
+        writer->bit_count -= 8;
+    }
+}
+
+/**
+ * write pending bits with padding
+ */
+static void
+cab_mszip_flush_bits(
+    cab_mszip_bit_writer* writer)
+{
+    if (writer->bit_count) {
+        cab_mszip_put_bits(writer, 0, 8 - writer->bit_count);
+    }
+}
+
+/**
+ * reverse bits
+ */
+static uint16_t
+cab_mszip_reverse_bits(
+    unsigned int code,
+    unsigned int length)
+{
+    unsigned int result;
+    result = 0;
+    while (length--) {
+        result = (result << 1) | (code & 1);
+        code >>= 1;
+    }
+    return (uint16_t)result;
+}
+
+/**
+ * allocate memory
+ */
+static void*
+cab_mszip_mem_alloc(
+    size_t size)
+{
+    return malloc(size);
+}
+
+/**
+ * free memory
+ */
+static void
+cab_mszip_mem_free(
+    void* heap_obj)
+{
+    free(heap_obj);
+}
+
+/* vi: se ts=4 sw=4 et: */
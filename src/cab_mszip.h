@@ -0,0 +1,56 @@
+#ifndef __CAB_MSZIP_H__
+#define __CAB_MSZIP_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+#define _CAB_MSZIP_ITFC_BEGIN extern "C" {
+#define _CAB_MSZIP_ITFC_END }
+#else
+#define _CAB_MSZIP_ITFC_BEGIN 
+#define _CAB_MSZIP_ITFC_END 
+#endif
+
+_CAB_MSZIP_ITFC_BEGIN 
+
+/**
+ * mszip compressor
+ */
+typedef struct _cab_mszip cab_mszip;
+
+/**
+ * create mszip compressor with compression preset
+ */
+cab_mszip*
+cab_mszip_create(
+    unsigned int preset);
+
+/**
+ * free mszip compressor
+ */
+void
+cab_mszip_free(
+    cab_mszip* obj);
+
+/**
+ * reset compressor to begin new folder
+ */
+int
+cab_mszip_reset(
+    cab_mszip* obj);
+
+/**
+ * compress a data block into "CK" signature and a deflate stream.
+ */
+int
+cab_mszip_compress(
+    cab_mszip* obj,
+    const void* src,
+    unsigned int src_size,
+    void* dst,
+    unsigned int* dst_size);
+
+_CAB_MSZIP_ITFC_END 
+
+/* vi: se ts=4 sw=4 et: */
+#endif
@@ -0,0 +1,735 @@
+#include "cab_mszip_decoder.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+
+/**
+ * deflate window size
+ */
+#define CAB_MSZIP_DECODER_WINDOW_SIZE 32768U
+
+/**
+ * maximum code length
+ */
+#define CAB_MSZIP_DECODER_MAX_BITS 15
+
+/**
+ * bits indexing fast decoding table
+ */
+#define CAB_MSZIP_DECODER_FAST_BITS 10
+
+/**
+ * literal and length symbols count
+ */
+#define CAB_MSZIP_DECODER_LITLEN_SYMBOLS 288
+
+/**
+ * distance symbols count
+ */
+#define CAB_MSZIP_DECODER_DIST_SYMBOLS 32
+
+/**
+ * code length symbols count
+ */
+#define CAB_MSZIP_DECODER_CODELEN_SYMBOLS 19
+
+/**
+ * end of block symbol
+ */
+#define CAB_MSZIP_DECODER_END_OF_BLOCK 256
+
+/**
+ * huffman decoding table
+ */
+typedef struct _cab_mszip_decoder_table cab_mszip_decoder_table;
+
+/**
+ * huffman decoding table
+ */
+struct _cab_mszip_decoder_table {
+    /**
+     * symbol and code length indexed by the next bits.
+     * The entry is symbol shifted by 4 and ored with code length. It is
+     * zero if the code is longer than CAB_MSZIP_DECODER_FAST_BITS.
+     */
+    uint16_t fast[1 << CAB_MSZIP_DECODER_FAST_BITS];
+
+    /**
+     * count of codes for each length
+     */
+    uint16_t counts[CAB_MSZIP_DECODER_MAX_BITS + 1];
+
+    /**
+     * symbols sorted by code
+     */
+    uint16_t symbols[CAB_MSZIP_DECODER_LITLEN_SYMBOLS];
+};
+
+/**
+ * mszip decompressor
+ */
+struct _cab_mszip_decoder {
+    /**
+     * the last decompressed data followed by data being decompressed
+     */
+    uint8_t window[CAB_MSZIP_DECODER_WINDOW_SIZE * 2];
+
+    /**
+     * size of the last decompressed data in window
+     */
+    unsigned int history_size;
+
+    /**
+     * fixed literal and length table
+     */
+    cab_mszip_decoder_table fixed_litlen;
+
+    /**
+     * fixed distance table
+     */
+    cab_mszip_decoder_table fixed_dist;
+
+    /**
+     * dynamic literal and length table
+     */
+    cab_mszip_decoder_table litlen;
+
+    /**
+     * dynamic distance table
+     */
+    cab_mszip_decoder_table dist;
+
+    /**
+     * code length table
+     */
+    cab_mszip_decoder_table codelen;
+
+    /**
+     * compressed data
+     */
+    const uint8_t* src;
+
+    /**
+     * size of compressed data
+     */
+    size_t src_size;
+
+    /**
+     * read position in compressed data
+     */
+    size_t position;
+
+    /**
+     * bits read from compressed data. The next bit is least significant.
+     */
+    uint64_t bit_buffer;
+
+    /**
+     * count of bits in bit_buffer
+     */
+    unsigned int bit_count;
+};
+
+/**
+ * base lengths for length symbols
+ */
+static const uint16_t CAB_MSZIP_DECODER_LENGTH_BASE[] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+/**
+ * extra bits for length symbols
+ */
+static const uint8_t CAB_MSZIP_DECODER_LENGTH_EXTRA[] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+/**
+ * base distances for distance symbols
+ */
+static const uint16_t CAB_MSZIP_DECODER_DIST_BASE[] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+    8193, 12289, 16385, 24577
+};
+
+/**
+ * extra bits for distance symbols
+ */
+static const uint8_t CAB_MSZIP_DECODER_DIST_EXTRA[] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+/**
+ * order of code length code lengths
+ */
+static const uint8_t CAB_MSZIP_DECODER_CODELEN_ORDER[] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+/**
+ * build decoding table from code lengths.
+ * Incomplete code is accepted but over subscribed code is not.
+ */
+static int
+cab_mszip_decoder_build_table(
+    cab_mszip_decoder_table* table,
+    const uint8_t* lengths,
+    unsigned int count);
+
+/**
+ * fill bit buffer to have count bits at least.
+ * Zero bits are filled after the end of data.
+ */
+static void
+cab_mszip_decoder_fill_bits(
+    cab_mszip_decoder* obj,
+    unsigned int count);
+
+/**
+ * read bits
+ */
+static unsigned int
+cab_mszip_decoder_read_bits(
+    cab_mszip_decoder* obj,
+    unsigned int count);
+
+/**
+ * read a symbol with decoding table.
+ * You get -1 if the bits do not make a code.
+ */
+static int
+cab_mszip_decoder_read_symbol(
+    cab_mszip_decoder* obj,
+    const cab_mszip_decoder_table* table);
+
+/**
+ * decompress a stored block
+ */
+static int
+cab_mszip_decoder_stored_block(
+    cab_mszip_decoder* obj,
+    unsigned int* out_position,
+    unsigned int out_end);
+
+/**
+ * read code lengths of dynamic block and build tables
+ */
+static int
+cab_mszip_decoder_read_tables(
+    cab_mszip_decoder* obj);
+
+/**
+ * decompress a huffman coded block
+ */
+static int
+cab_mszip_decoder_huffman_block(
+    cab_mszip_decoder* obj,
+    const cab_mszip_decoder_table* litlen,
+    const cab_mszip_decoder_table* dist,
+    unsigned int* out_position,
+    unsigned int out_end);
+
+/**
+ * allocate memory
+ */
+static void*
+cab_mszip_decoder_mem_alloc(
+    size_t size);
+
+/**
+ * free memory
+ */
+static void
+cab_mszip_decoder_mem_free(
+    void* heap_obj);
+
+/**
+ * create mszip decompressor
+ */
+cab_mszip_decoder*
+cab_mszip_decoder_create()
+{
+    cab_mszip_decoder* result;
+    result = (cab_mszip_decoder*)cab_mszip_decoder_mem_alloc(
+        sizeof(cab_mszip_decoder));
+    if (result) {
+        uint8_t lengths[CAB_MSZIP_DECODER_LITLEN_SYMBOLS];
+        memset(lengths, 8, 144);
+        memset(lengths + 144, 9, 256 - 144);
+        memset(lengths + 256, 7, 280 - 256);
+        memset(lengths + 280, 8, CAB_MSZIP_DECODER_LITLEN_SYMBOLS - 280);
+        cab_mszip_decoder_build_table(&result->fixed_litlen,
+            lengths, CAB_MSZIP_DECODER_LITLEN_SYMBOLS);
+        memset(lengths, 5, CAB_MSZIP_DECODER_DIST_SYMBOLS);
+        cab_mszip_decoder_build_table(&result->fixed_dist,
+            lengths, CAB_MSZIP_DECODER_DIST_SYMBOLS);
+        cab_mszip_decoder_reset(result);
+    }
+    return result;
+}
+
+/**
+ * free mszip decompressor
+ */
+void
+cab_mszip_decoder_free(
+    cab_mszip_decoder* obj)
+{
+    if (obj) {
+        cab_mszip_decoder_mem_free(obj);
+    }
+}
+
+/**
+ * reset decompressor to begin new folder
+ */
+int
+cab_mszip_decoder_reset(
+    cab_mszip_decoder* obj)
+{
+    int result;
+    if (obj) {
+        obj->history_size = 0;
+        result = 0;
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * decompress a data block made of "CK" signature and a deflate stream.
+ */
+int
+cab_mszip_decoder_decompress(
+    cab_mszip_decoder* obj,
+    const void* src,
+    unsigned int src_size,
+    void* dst,
+    unsigned int dst_size)
+{
+    int result;
+    unsigned int out_position;
+    unsigned int out_end;
+    if (obj && src && dst && dst_size <= CAB_MSZIP_DECODER_WINDOW_SIZE
+        && src_size >= 2 && ((const uint8_t*)src)[0] == 'C'
+        && ((const uint8_t*)src)[1] == 'K') {
+        result = 0;
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    out_position = 0;
+    out_end = 0;
+    if (result == 0) {
+        obj->src = (const uint8_t*)src + 2;
+        obj->src_size = src_size - 2;
+        obj->position = 0;
+        obj->bit_buffer = 0;
+        obj->bit_count = 0;
+        out_position = obj->history_size;
+        out_end = obj->history_size + dst_size;
+    }
+    while (result == 0) {
+        unsigned int final_block;
+        unsigned int block_type;
+        final_block = cab_mszip_decoder_read_bits(obj, 1);
+        block_type = cab_mszip_decoder_read_bits(obj, 2);
+        switch (block_type) {
+        case 0:
+            result = cab_mszip_decoder_stored_block(obj,
+                &out_position, out_end);
+            break;
+        case 1:
+            result = cab_mszip_decoder_huffman_block(obj,
+                &obj->fixed_litlen, &obj->fixed_dist,
+                &out_position, out_end);
+            break;
+        case 2:
+            result = cab_mszip_decoder_read_tables(obj);
+            if (result == 0) {
+                result = cab_mszip_decoder_huffman_block(obj,
+                    &obj->litlen, &obj->dist, &out_position, out_end);
+            }
+            break;
+        default:
+            result = -1;
+            break;
+        }
+        if (final_block) {
+            break;
+        }
+    }
+    /* the block must fill the size without reading over the end */
+    if (result == 0 && (out_position != out_end
+        || obj->position - obj->bit_count / 8 > obj->src_size)) {
+        result = -1;
+    }
+    if (result == 0) {
+        unsigned int keep_size;
+        memcpy(dst, obj->window + obj->history_size, dst_size);
+        keep_size = out_end < CAB_MSZIP_DECODER_WINDOW_SIZE ?
+            out_end : CAB_MSZIP_DECODER_WINDOW_SIZE;
+        memmove(obj->window, obj->window + out_end - keep_size, keep_size);
+        obj->history_size = keep_size;
+    } else {
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * build decoding table from code lengths.
+ */
+static int
+cab_mszip_decoder_build_table(
+    cab_mszip_decoder_table* table,
+    const uint8_t* lengths,
+    unsigned int count)
+{
+    uint16_t offsets[CAB_MSZIP_DECODER_MAX_BITS + 2];
+    unsigned int next_codes[CAB_MSZIP_DECODER_MAX_BITS + 1];
+    unsigned int idx;
+    unsigned int code;
+    int left;
+    int result;
+    memset(table->counts, 0, sizeof(table->counts));
+    memset(table->fast, 0, sizeof(table->fast));
+    for (idx = 0; idx < count; idx++) {
+        table->counts[lengths[idx]]++;
+    }
+    table->counts[0] = 0;
+    left = 1;
+    result = 0;
+    for (idx = 1; idx <= CAB_MSZIP_DECODER_MAX_BITS; idx++) {
+        left <<= 1;
+        left -= table->counts[idx];
+        if (left < 0) {
+            result = -1;
+            break;
+        }
+    }
+    if (result == 0) {
+        offsets[1] = 0;
+        code = 0;
+        for (idx = 1; idx <= CAB_MSZIP_DECODER_MAX_BITS; idx++) {
+            offsets[idx + 1] = offsets[idx] + table->counts[idx];
+            next_codes[idx] = code;
+            code = (code + table->counts[idx]) << 1;
+        }
+        for (idx = 0; idx < count; idx++) {
+            unsigned int length;
+            length = lengths[idx];
+            if (!length) {
+                continue;
+            }
+            table->symbols[offsets[length]++] = (uint16_t)idx;
+            code = next_codes[length]++;
+            if (length <= CAB_MSZIP_DECODER_FAST_BITS) {
+                unsigned int reversed;
+                unsigned int bit_idx;
+                reversed = 0;
+                for (bit_idx = 0; bit_idx < length; bit_idx++) {
+                    reversed = (reversed << 1) | ((code >> bit_idx) & 1);
+                }
+                for (; reversed < (1U << CAB_MSZIP_DECODER_FAST_BITS);
+                    reversed += 1U << length) {
+                    table->fast[reversed] = (uint16_t)((idx << 4) | length);
+                }
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ * fill bit buffer to have count bits at least.
+ */
+static void
+cab_mszip_decoder_fill_bits(
+    cab_mszip_decoder* obj,
+    unsigned int count)
+{
+    while (obj->bit_count < count) {
+        uint64_t value;
+        value = obj->position < obj->src_size ? obj->src[obj->position] : 0;
+        obj->position++;
+        obj->bit_buffer |= value << obj->bit_count;
+        obj->bit_count += 8;
+    }
+}
+
+/**
+ * read bits
+ */
+static unsigned int
+cab_mszip_decoder_read_bits(
+    cab_mszip_decoder* obj,
+    unsigned int count)
+{
+    unsigned int result;
+    cab_mszip_decoder_fill_bits(obj, count);
+    result = (unsigned int)(obj->bit_buffer & ((1U << count) - 1));
+    obj->bit_buffer >>= count;
+    obj->bit_count -= count;
+    return result;
+}
+
+/**
+ * read a symbol with decoding table.
+ */
+static int
+cab_mszip_decoder_read_symbol(
+    cab_mszip_decoder* obj,
+    const cab_mszip_decoder_table* table)
+{
+    unsigned int entry;
+    int result;
+    cab_mszip_decoder_fill_bits(obj, CAB_MSZIP_DECODER_MAX_BITS);
+    entry = table->fast[obj->bit_buffer
+        & ((1U << CAB_MSZIP_DECODER_FAST_BITS) - 1)];
+    if (entry) {
+        obj->bit_buffer >>= entry & 0xf;
+        obj->bit_count -= entry & 0xf;
+        result = (int)(entry >> 4);
+    } else {
+        unsigned int length;
+        int code;
+        int first;
+        int index;
+        result = -1;
+        code = 0;
+        first = 0;
+        index = 0;
+        for (length = 1; length <= CAB_MSZIP_DECODER_MAX_BITS; length++) {
+            int count;
+            code |= (int)((obj->bit_buffer >> (length - 1)) & 1);
+            count = table->counts[length];
+            if (code - first < count) {
+                obj->bit_buffer >>= length;
+                obj->bit_count -= length;
+                result = table->symbols[index + code - first];
+                break;
+            }
+            index += count;
+            first += count;
+            first <<= 1;
+            code <<= 1;
+        }
+    }
+    return result;
+}
+
+/**
+ * decompress a stored block
+ */
+static int
+cab_mszip_decoder_stored_block(
+    cab_mszip_decoder* obj,
+    unsigned int* out_position,
+    unsigned int out_end)
+{
+    unsigned int length;
+    unsigned int length_complement;
+    int result;
+    cab_mszip_decoder_read_bits(obj, obj->bit_count & 7);
+    length = cab_mszip_decoder_read_bits(obj, 16);
+    length_complement = cab_mszip_decoder_read_bits(obj, 16);
+    if (length == (~length_complement & 0xffff)
+        && *out_position + length <= out_end) {
+        result = 0;
+    } else {
+        result = -1;
+    }
+    if (result == 0) {
+        while (obj->bit_count && length) {
+            obj->window[(*out_position)++] =
+                (uint8_t)cab_mszip_decoder_read_bits(obj, 8);
+            length--;
+        }
+        if (obj->position + length <= obj->src_size) {
+            memcpy(obj->window + *out_position,
+                obj->src + obj->position, length);
+            obj->position += length;
+            *out_position += length;
+        } else {
+            result = -1;
+        }
+    }
+    return result;
+}
+
+/**
+ * read code lengths of dynamic block and build tables
+ */
+static int
+cab_mszip_decoder_read_tables(
+    cab_mszip_decoder* obj)
+{
+    uint8_t lengths[CAB_MSZIP_DECODER_LITLEN_SYMBOLS
+        + CAB_MSZIP_DECODER_DIST_SYMBOLS];
+    uint8_t codelen_lengths[CAB_MSZIP_DECODER_CODELEN_SYMBOLS];
+    unsigned int litlen_count;
+    unsigned int dist_count;
+    unsigned int codelen_count;
+    unsigned int idx;
+    int result;
+    litlen_count = cab_mszip_decoder_read_bits(obj, 5) + 257;
+    dist_count = cab_mszip_decoder_read_bits(obj, 5) + 1;
+    codelen_count = cab_mszip_decoder_read_bits(obj, 4) + 4;
+    memset(codelen_lengths, 0, sizeof(codelen_lengths));
+    for (idx = 0; idx < codelen_count; idx++) {
+        codelen_lengths[CAB_MSZIP_DECODER_CODELEN_ORDER[idx]] =
+            (uint8_t)cab_mszip_decoder_read_bits(obj, 3);
+    }
+    result = litlen_count <= 286 && dist_count <= 30 ? 0 : -1;
+    if (result == 0) {
+        result = cab_mszip_decoder_build_table(&obj->codelen,
+            codelen_lengths, CAB_MSZIP_DECODER_CODELEN_SYMBOLS);
+    }
+    idx = 0;
+    while (result == 0 && idx < litlen_count + dist_count) {
+        int symbol;
+        unsigned int repeat;
+        uint8_t value;
+        symbol = cab_mszip_decoder_read_symbol(obj, &obj->codelen);
+        if (symbol < 0) {
+            result = -1;
+            break;
+        }
+        if (symbol < 16) {
+            lengths[idx++] = (uint8_t)symbol;
+            continue;
+        }
+        if (symbol == 16) {
+            if (idx == 0) {
+                result = -1;
+                break;
+            }
+            value = lengths[idx - 1];
+            repeat = 3 + cab_mszip_decoder_read_bits(obj, 2);
+        } else if (symbol == 17) {
+            value = 0;
+            repeat = 3 + cab_mszip_decoder_read_bits(obj, 3);
+        } else {
+            value = 0;
+            repeat = 11 + cab_mszip_decoder_read_bits(obj, 7);
+        }
+        if (idx + repeat > litlen_count + dist_count) {
+            result = -1;
+            break;
+        }
+        memset(lengths + idx, value, repeat);
+        idx += repeat;
+    }
+    if (result == 0 && !lengths[CAB_MSZIP_DECODER_END_OF_BLOCK]) {
+        result = -1;
+    }
+    if (result == 0) {
+        result = cab_mszip_decoder_build_table(&obj->litlen,
+            lengths, litlen_count);
+    }
+    if (result == 0) {
+        result = cab_mszip_decoder_build_table(&obj->dist,
+            lengths + litlen_count, dist_count);
+    }
+    return result;
+}
+
+/**
+ * decompress a huffman coded block
+ */
+static int
+cab_mszip_decoder_huffman_block(
+    cab_mszip_decoder* obj,
+    const cab_mszip_decoder_table* litlen,
+    const cab_mszip_decoder_table* dist,
+    unsigned int* out_position,
+    unsigned int out_end)
+{
+    uint8_t* window;
+    unsigned int position;
+    int result;
+    window = obj->window;
+    position = *out_position;
+    result = 0;
+    while (1) {
+        int symbol;
+        unsigned int length;
+        unsigned int distance;
+        symbol = cab_mszip_decoder_read_symbol(obj, litlen);
+        if (symbol < CAB_MSZIP_DECODER_END_OF_BLOCK) {
+            if (symbol < 0 || position == out_end) {
+                result = -1;
+                break;
+            }
+            window[position++] = (uint8_t)symbol;
+            continue;
+        }
+        if (symbol == CAB_MSZIP_DECODER_END_OF_BLOCK) {
+            break;
+        }
+        symbol -= 257;
+        if (symbol >= (int)sizeof(CAB_MSZIP_DECODER_LENGTH_BASE)
+            / (int)sizeof(CAB_MSZIP_DECODER_LENGTH_BASE[0])) {
+            result = -1;
+            break;
+        }
+        length = CAB_MSZIP_DECODER_LENGTH_BASE[symbol]
+            + cab_mszip_decoder_read_bits(obj,
+                CAB_MSZIP_DECODER_LENGTH_EXTRA[symbol]);
+        symbol = cab_mszip_decoder_read_symbol(obj, dist);
+        if (symbol < 0 || symbol >= (int)sizeof(CAB_MSZIP_DECODER_DIST_BASE)
+            / (int)sizeof(CAB_MSZIP_DECODER_DIST_BASE[0])) {
+            result = -1;
+            break;
+        }
+        distance = CAB_MSZIP_DECODER_DIST_BASE[symbol]
+            + cab_mszip_decoder_read_bits(obj,
+                CAB_MSZIP_DECODER_DIST_EXTRA[symbol]);
+        if (distance > position || position + length > out_end) {
+            result = -1;
+            break;
+        }
+        if (distance >= length) {
+            memcpy(window + position, window + position - distance, length);
+            position += length;
+        } else {
+            const uint8_t* src;
+            src = window + position - distance;
+            while (length--) {
+                window[position++] = *src++;
+            }
+        }
+    }
+    *out_position = position;
+    return result;
+}
+
+/**
+ * allocate memory
+ */
+static void*
+cab_mszip_decoder_mem_alloc(
+    size_t size)
+{
+    return malloc(size);
+}
+
+/**
+ * free memory
+ */
+static void
+cab_mszip_decoder_mem_free(
+    void* heap_obj)
+{
+    free(heap_obj);
+}
+
+/* vi: se ts=4 sw=4 et: */
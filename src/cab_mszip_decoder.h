@@ -0,0 +1,57 @@
+#ifndef __CAB_MSZIP_DECODER_H__
+#define __CAB_MSZIP_DECODER_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+#define _CAB_MSZIP_DECODER_ITFC_BEGIN extern "C" {
+#define _CAB_MSZIP_DECODER_ITFC_END }
+#else
+#define _CAB_MSZIP_DECODER_ITFC_BEGIN
+#define _CAB_MSZIP_DECODER_ITFC_END
+#endif
+
+_CAB_MSZIP_DECODER_ITFC_BEGIN
+
+/**
+ * mszip decompressor
+ */
+typedef struct _cab_mszip_decoder cab_mszip_decoder;
+
+/**
+ * create mszip decompressor
+ */
+cab_mszip_decoder*
+cab_mszip_decoder_create();
+
+/**
+ * free mszip decompressor
+ */
+void
+cab_mszip_decoder_free(
+    cab_mszip_decoder* obj);
+
+/**
+ * reset decompressor to begin new folder
+ */
+int
+cab_mszip_decoder_reset(
+    cab_mszip_decoder* obj);
+
+/**
+ * decompress a data block made of "CK" signature and a deflate stream.
+ * The block has to be decompressed into dst_size bytes exactly.
+ * The previous blocks in the folder are used as dictionary.
+ */
+int
+cab_mszip_decoder_decompress(
+    cab_mszip_decoder* obj,
+    const void* src,
+    unsigned int src_size,
+    void* dst,
+    unsigned int dst_size);
+
+_CAB_MSZIP_DECODER_ITFC_END
+
+/* vi: se ts=4 sw=4 et: */
+#endif
@@ -0,0 +1,448 @@
+#include "cab_planner.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "fci_compat.h"
+#include "cab_compressor.h"
+#include "file_i.h"
+#include "worker_pool.h"
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+/**
+ * size of data block header
+ */
+#define CAB_PLANNER_BLOCK_HEADER_SIZE 8
+
+/**
+ * file to be estimated
+ */
+typedef struct _cab_planner_file cab_planner_file;
+
+/**
+ * state kept by a thread estimating files
+ */
+typedef struct _cab_planner_worker cab_planner_worker;
+
+/**
+ * file to be estimated
+ */
+struct _cab_planner_file {
+    /**
+     * file path
+     */
+    const char* path;
+
+    /**
+     * compression type
+     */
+    unsigned int type_compress;
+
+    /**
+     * estimated size
+     */
+    unsigned long long* size;
+
+    /**
+     * file size
+     */
+    unsigned long long file_size;
+};
+
+/**
+ * state kept by a thread estimating files
+ */
+struct _cab_planner_worker {
+    /**
+     * compressor kept for the next file having the same compression type
+     */
+    cab_compressor* compressor;
+
+    /**
+     * buffer for compressed samples
+     */
+    unsigned char* buffer;
+};
+
+/**
+ * estimate a file in files
+ */
+static void
+cab_planner_run(
+    void* context,
+    void* local,
+    size_t idx);
+
+/**
+ * create state kept by a thread estimating files
+ */
+static void*
+cab_planner_create_worker(
+    void* context);
+
+/**
+ * free state kept by a thread estimating files
+ */
+static void
+cab_planner_free_worker(
+    void* context,
+    void* local);
+
+/**
+ * estimate compressed size of a file
+ */
+static int
+cab_planner_estimate_file(
+    cab_planner_file* file,
+    cab_compressor** compressor,
+    unsigned char* buffer);
+
+/**
+ * compress sample blocks and get the compressed size
+ */
+static int
+cab_planner_compress_samples(
+    cab_compressor* compressor,
+    const unsigned char* data,
+    size_t data_size,
+    unsigned char* buffer,
+    unsigned long long* compressed_size);
+
+/**
+ * allocate memory
+ */
+static void*
+cab_planner_mem_alloc(
+    size_t size);
+
+/**
+ * free memory
+ */
+static void
+cab_planner_mem_free(
+    void* heap_obj);
+
+/**
+ * estimate compressed size of files.
+ */
+int
+cab_planner_estimate(
+    const char* const* file_paths,
+    const unsigned long long* file_sizes,
+    const unsigned int* types_compress,
+    size_t file_count,
+    unsigned int jobs,
+    unsigned long long* sizes)
+{
+    int result;
+    cab_planner_file* files;
+    size_t idx;
+    files = (cab_planner_file*)cab_planner_mem_alloc(
+        sizeof(cab_planner_file) * (file_count + 1));
+    result = files ? 0 : -1;
+    if (result == 0) {
+        for (idx = 0; idx < file_count; idx++) {
+            files[idx].path = file_paths[idx];
+            files[idx].type_compress = types_compress[idx];
+            files[idx].size = &sizes[idx];
+            files[idx].file_size = file_sizes[idx];
+        }
+    }
+    if (result == 0) {
+        result = worker_pool_for_each(jobs, file_count, cab_planner_run,
+            cab_planner_create_worker, cab_planner_free_worker, files);
+    }
+    if (files) {
+        cab_planner_mem_free(files);
+    }
+    return result;
+}
+
+/**
+ * pack items into bins keeping the order of items in each bin.
+ */
+int
+cab_planner_pack(
+    const unsigned long long* item_sizes,
+    size_t item_count,
+    unsigned long long bin_capacity,
+    size_t* bins,
+    size_t* bin_count)
+{
+    int result;
+    unsigned long long* bin_sizes;
+    size_t open_bin_count;
+    size_t idx;
+    bin_sizes = (unsigned long long*)cab_planner_mem_alloc(
+        sizeof(unsigned long long) * (CAB_PLANNER_OPEN_BIN_COUNT + 1));
+    result = bin_sizes ? 0 : -1;
+    open_bin_count = 0;
+    *bin_count = 0;
+    for (idx = 0; result == 0 && idx < item_count; idx++) {
+        size_t bin_idx;
+        bin_idx = open_bin_count;
+        if (item_sizes[idx] <= bin_capacity) {
+            for (bin_idx = 0; bin_idx < open_bin_count; bin_idx++) {
+                if (bin_capacity - bin_sizes[bin_idx] >= item_sizes[idx]) {
+                    break;
+                }
+            }
+        }
+        if (bin_idx == open_bin_count) {
+            if (open_bin_count == CAB_PLANNER_OPEN_BIN_COUNT) {
+                /* the oldest bin is closed */
+                memmove(&bin_sizes[0], &bin_sizes[1],
+                    sizeof(bin_sizes[0]) * (open_bin_count - 1));
+                open_bin_count--;
+                bin_idx--;
+            }
+            /* too large item fills new bin by itself */
+            bin_sizes[bin_idx] = item_sizes[idx] <= bin_capacity ?
+                0 : bin_capacity;
+            open_bin_count++;
+            (*bin_count)++;
+        }
+        if (item_sizes[idx] <= bin_capacity) {
+            bin_sizes[bin_idx] += item_sizes[idx];
+        }
+        bins[idx] = *bin_count - (open_bin_count - bin_idx);
+    }
+    if (bin_sizes) {
+        cab_planner_mem_free(bin_sizes);
+    }
+    return result;
+}
+
+/**
+ * estimate a file in files
+ */
+static void
+cab_planner_run(
+    void* context,
+    void* local,
+    size_t idx)
+{
+    cab_planner_worker* worker;
+    cab_compressor* compressor;
+    worker = (cab_planner_worker*)local;
+    compressor = NULL;
+    /* the file is estimated as it is stored without worker state */
+    cab_planner_estimate_file(&((cab_planner_file*)context)[idx],
+        worker ? &worker->compressor : &compressor,
+        worker ? worker->buffer : NULL);
+}
+
+/**
+ * create state kept by a thread estimating files
+ */
+static void*
+cab_planner_create_worker(
+    void* context)
+{
+    cab_planner_worker* result;
+    (void)context;
+    result = (cab_planner_worker*)cab_planner_mem_alloc(
+        sizeof(cab_planner_worker));
+    if (result) {
+        result->compressor = NULL;
+        result->buffer = (unsigned char*)cab_planner_mem_alloc(
+            CAB_COMPRESSOR_MAX_COMPRESSED_SIZE);
+    }
+    return result;
+}
+
+/**
+ * free state kept by a thread estimating files
+ */
+static void
+cab_planner_free_worker(
+    void* context,
+    void* local)
+{
+    cab_planner_worker* worker;
+    (void)context;
+    worker = (cab_planner_worker*)local;
+    if (worker) {
+        if (worker->compressor) {
+            cab_compressor_free(worker->compressor);
+        }
+        if (worker->buffer) {
+            cab_planner_mem_free(worker->buffer);
+        }
+        cab_planner_mem_free(worker);
+    }
+}
+
+/**
+ * estimate compressed size of a file. The compressor is kept for the next
+ * file having the same compression type.
+ */
+static int
+cab_planner_estimate_file(
+    cab_planner_file* file,
+    cab_compressor** compressor,
+    unsigned char* buffer)
+{
+    int result;
+    unsigned long long file_size;
+    unsigned long long data_size;
+    int fd;
+    fd = -1;
+    file_size = file->file_size;
+    result = 0;
+    data_size = file_size;
+    if (result == 0 && file_size && buffer
+        && CompressionTypeFromTCOMP(file->type_compress) != tcompTYPE_NONE) {
+        if (*compressor && cab_compressor_get_type(*compressor)
+            != file->type_compress) {
+            cab_compressor_free(*compressor);
+            *compressor = NULL;
+        }
+        if (!*compressor) {
+            *compressor = cab_compressor_create(file->type_compress);
+        }
+        result = *compressor ? 0 : -1;
+        if (result == 0) {
+            fd = file_i_open(file->path, O_RDONLY | O_BINARY, 0);
+            result = fd != -1 ? 0 : -1;
+        }
+    }
+    if (fd != -1) {
+        const void* data;
+        unsigned long long compressed_size;
+        unsigned long long sampled_size;
+        compressed_size = 0;
+        sampled_size = 0;
+        data = NULL;
+        if (file_size <= (size_t)-1) {
+            data = file_i_map(fd, (size_t)file_size);
+        }
+        if (data) {
+            unsigned int sample_count;
+            unsigned int idx;
+            sample_count = CAB_PLANNER_SAMPLE_COUNT;
+            if (file_size < (unsigned long long)CAB_PLANNER_SAMPLE_SIZE
+                * CAB_PLANNER_SAMPLE_COUNT) {
+                sample_count = (unsigned int)((file_size
+                    + CAB_PLANNER_SAMPLE_SIZE - 1) / CAB_PLANNER_SAMPLE_SIZE);
+            }
+            cab_compressor_reset(*compressor);
+            for (idx = 0; result == 0 && idx < sample_count; idx++) {
+                unsigned long long offset;
+                size_t sample_size;
+                unsigned long long block_compressed_size;
+                if (sample_count < CAB_PLANNER_SAMPLE_COUNT) {
+                    offset = (unsigned long long)idx * CAB_PLANNER_SAMPLE_SIZE;
+                } else {
+                    /* samples are spread from the head to the tail */
+                    offset = (file_size - CAB_PLANNER_SAMPLE_SIZE) * idx
+                        / (CAB_PLANNER_SAMPLE_COUNT - 1);
+                }
+                sample_size = file_size - offset < CAB_PLANNER_SAMPLE_SIZE ?
+                    (size_t)(file_size - offset) : CAB_PLANNER_SAMPLE_SIZE;
+                result = cab_planner_compress_samples(*compressor,
+                    (const unsigned char*)data + offset, sample_size, buffer,
+                    &block_compressed_size);
+                if (result == 0) {
+                    compressed_size += block_compressed_size;
+                    sampled_size += sample_size;
+                }
+            }
+            file_i_unmap(data, (size_t)file_size);
+        } else {
+            unsigned char* sample;
+            sample = (unsigned char*)cab_planner_mem_alloc(
+                CAB_PLANNER_SAMPLE_SIZE);
+            result = sample ? 0 : -1;
+            if (result == 0) {
+                cab_compressor_reset(*compressor);
+            }
+            /* samples are read from the head if file can not be mapped */
+            while (result == 0 && sampled_size < file_size
+                && sampled_size < (unsigned long long)CAB_PLANNER_SAMPLE_SIZE
+                    * CAB_PLANNER_SAMPLE_COUNT) {
+                ssize_t read_size;
+                unsigned long long block_compressed_size;
+                read_size = read(fd, sample, CAB_PLANNER_SAMPLE_SIZE);
+                result = read_size > 0 ? 0 : -1;
+                if (result == 0) {
+                    result = cab_planner_compress_samples(*compressor,
+                        sample, (size_t)read_size, buffer,
+                        &block_compressed_size);
+                }
+                if (result == 0) {
+                    compressed_size += block_compressed_size;
+                    sampled_size += (unsigned long long)read_size;
+                }
+            }
+            if (sample) {
+                cab_planner_mem_free(sample);
+            }
+        }
+        if (result == 0 && sampled_size) {
+            data_size = (unsigned long long)((double)file_size
+                * compressed_size / sampled_size);
+        }
+        close(fd);
+    }
+    *file->size = data_size + CAB_PLANNER_BLOCK_HEADER_SIZE
+        * ((file_size + CAB_COMPRESSOR_BLOCK_SIZE - 1)
+            / CAB_COMPRESSOR_BLOCK_SIZE + 1);
+    return result;
+}
+
+/**
+ * compress sample blocks and get the compressed size
+ */
+static int
+cab_planner_compress_samples(
+    cab_compressor* compressor,
+    const unsigned char* data,
+    size_t data_size,
+    unsigned char* buffer,
+    unsigned long long* compressed_size)
+{
+    int result;
+    result = 0;
+    *compressed_size = 0;
+    while (result == 0 && data_size) {
+        unsigned int block_size;
+        unsigned int dst_size;
+        block_size = data_size < CAB_COMPRESSOR_BLOCK_SIZE ?
+            (unsigned int)data_size : CAB_COMPRESSOR_BLOCK_SIZE;
+        result = cab_compressor_compress(compressor, data, block_size,
+            buffer, &dst_size);
+        if (result == 0) {
+            *compressed_size += dst_size;
+            data += block_size;
+            data_size -= block_size;
+        }
+    }
+    return result;
+}
+
+/**
+ * allocate memory
+ */
+static void*
+cab_planner_mem_alloc(
+    size_t size)
+{
+    return malloc(size);
+}
+
+/**
+ * free memory
+ */
+static void
+cab_planner_mem_free(
+    void* heap_obj)
+{
+    free(heap_obj);
+}
+
+/* vi: se ts=4 sw=4 et: */
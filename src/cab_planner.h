@@ -0,0 +1,66 @@
+#ifndef __CAB_PLANNER_H__
+#define __CAB_PLANNER_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+#define _CAB_PLANNER_ITFC_BEGIN extern "C" {
+#define _CAB_PLANNER_ITFC_END }
+#else
+#define _CAB_PLANNER_ITFC_BEGIN
+#define _CAB_PLANNER_ITFC_END
+#endif
+
+_CAB_PLANNER_ITFC_BEGIN
+
+/**
+ * size of a sample block compressed to estimate compressed size
+ */
+#define CAB_PLANNER_SAMPLE_SIZE 32768U
+
+/**
+ * maximum count of sample blocks in a file
+ */
+#define CAB_PLANNER_SAMPLE_COUNT 4
+
+/**
+ * count of the last bins searched for room of an item
+ */
+#define CAB_PLANNER_OPEN_BIN_COUNT 64
+
+/**
+ * estimate compressed size of files.
+ * Up to CAB_PLANNER_SAMPLE_COUNT blocks spread over a file are compressed
+ * with the compression type of the file and the ratio is applied to the
+ * file size in file_sizes. sizes gets the estimated size of compressed data
+ * including data block headers. Files are sampled in jobs threads. The size
+ * of file which can not be read is estimated as it is stored.
+ */
+int
+cab_planner_estimate(
+    const char* const* file_paths,
+    const unsigned long long* file_sizes,
+    const unsigned int* types_compress,
+    size_t file_count,
+    unsigned int jobs,
+    unsigned long long* sizes);
+
+/**
+ * pack items into bins keeping the order of items in each bin.
+ * An item is put in the first bin having room for it among the last
+ * CAB_PLANNER_OPEN_BIN_COUNT bins, or in a new bin. An item larger than
+ * bin_capacity is put in a new bin alone. bins[idx] gets the bin index of
+ * the item and bin_count gets the count of bins.
+ */
+int
+cab_planner_pack(
+    const unsigned long long* item_sizes,
+    size_t item_count,
+    unsigned long long bin_capacity,
+    size_t* bins,
+    size_t* bin_count);
+
+_CAB_PLANNER_ITFC_END
+
+/* vi: se ts=4 sw=4 et: */
+#endif
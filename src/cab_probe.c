@@ -0,0 +1,310 @@
+#include "cab_probe.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "file_i.h"
+#include "worker_pool.h"
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+/**
+ * file to be probed
+ */
+typedef struct _cab_probe_file cab_probe_file;
+
+/**
+ * file to be probed
+ */
+struct _cab_probe_file {
+    /**
+     * file path
+     */
+    const char* path;
+
+    /**
+     * file size
+     */
+    unsigned long long size;
+
+    /**
+     * not zero if the file looks incompressible
+     */
+    int* incompressible;
+};
+
+/**
+ * probe a file in files
+ */
+static void
+cab_probe_run(
+    void* context,
+    void* local,
+    size_t idx);
+
+/**
+ * create sample buffer kept by a thread probing files
+ */
+static void*
+cab_probe_create_sample(
+    void* context);
+
+/**
+ * free sample buffer kept by a thread probing files
+ */
+static void
+cab_probe_free_sample(
+    void* context,
+    void* local);
+
+/**
+ * probe a file
+ */
+static int
+cab_probe_file_contents(
+    cab_probe_file* file,
+    unsigned char* sample);
+
+/**
+ * count byte frequencies in data
+ */
+static void
+cab_probe_count(
+    const unsigned char* data,
+    size_t data_size,
+    unsigned long* counts);
+
+/**
+ * judge byte frequencies incompressible
+ */
+static int
+cab_probe_is_uniform(
+    const unsigned long* counts,
+    unsigned long long sampled_size);
+
+/**
+ * allocate memory
+ */
+static void*
+cab_probe_mem_alloc(
+    size_t size);
+
+/**
+ * free memory
+ */
+static void
+cab_probe_mem_free(
+    void* heap_obj);
+
+/**
+ * probe files whether compression gains nothing.
+ */
+int
+cab_probe_files(
+    const char* const* file_paths,
+    const unsigned long long* file_sizes,
+    size_t file_count,
+    unsigned int jobs,
+    int* incompressible)
+{
+    int result;
+    cab_probe_file* files;
+    size_t idx;
+    files = (cab_probe_file*)cab_probe_mem_alloc(
+        sizeof(cab_probe_file) * (file_count + 1));
+    result = files ? 0 : -1;
+    if (result == 0) {
+        for (idx = 0; idx < file_count; idx++) {
+            files[idx].path = file_paths[idx];
+            files[idx].size = file_sizes[idx];
+            files[idx].incompressible = &incompressible[idx];
+            incompressible[idx] = 0;
+        }
+    }
+    if (result == 0) {
+        result = worker_pool_for_each(jobs, file_count, cab_probe_run,
+            cab_probe_create_sample, cab_probe_free_sample, files);
+    }
+    if (files) {
+        cab_probe_mem_free(files);
+    }
+    return result;
+}
+
+/**
+ * probe a file in files
+ */
+static void
+cab_probe_run(
+    void* context,
+    void* local,
+    size_t idx)
+{
+    cab_probe_file_contents(&((cab_probe_file*)context)[idx],
+        (unsigned char*)local);
+}
+
+/**
+ * create sample buffer kept by a thread probing files
+ */
+static void*
+cab_probe_create_sample(
+    void* context)
+{
+    (void)context;
+    return cab_probe_mem_alloc(CAB_PROBE_SAMPLE_SIZE);
+}
+
+/**
+ * free sample buffer kept by a thread probing files
+ */
+static void
+cab_probe_free_sample(
+    void* context,
+    void* local)
+{
+    (void)context;
+    if (local) {
+        cab_probe_mem_free(local);
+    }
+}
+
+/**
+ * probe a file
+ */
+static int
+cab_probe_file_contents(
+    cab_probe_file* file,
+    unsigned char* sample)
+{
+    int result;
+    unsigned long long file_size;
+    unsigned long long sampled_size;
+    unsigned long counts[256];
+    int fd;
+    fd = -1;
+    file_size = file->size;
+    sampled_size = 0;
+    memset(counts, 0, sizeof(counts));
+    result = 0;
+    if (file_size >= CAB_PROBE_MIN_SIZE) {
+        fd = file_i_open(file->path, O_RDONLY | O_BINARY, 0);
+        result = fd != -1 ? 0 : -1;
+    }
+    if (fd != -1) {
+        const void* data;
+        data = NULL;
+        if (file_size <= (size_t)-1) {
+            data = file_i_map(fd, (size_t)file_size);
+        }
+        if (data) {
+            unsigned int sample_count;
+            unsigned int idx;
+            sample_count = CAB_PROBE_SAMPLE_COUNT;
+            if (file_size < (unsigned long long)CAB_PROBE_SAMPLE_SIZE
+                * CAB_PROBE_SAMPLE_COUNT) {
+                sample_count = (unsigned int)((file_size
+                    + CAB_PROBE_SAMPLE_SIZE - 1) / CAB_PROBE_SAMPLE_SIZE);
+            }
+            for (idx = 0; idx < sample_count; idx++) {
+                unsigned long long offset;
+                size_t sample_size;
+                if (sample_count < CAB_PROBE_SAMPLE_COUNT) {
+                    offset = (unsigned long long)idx * CAB_PROBE_SAMPLE_SIZE;
+                } else {
+                    /* samples are spread from the head to the tail */
+                    offset = (file_size - CAB_PROBE_SAMPLE_SIZE) * idx
+                        / (CAB_PROBE_SAMPLE_COUNT - 1);
+                }
+                sample_size = file_size - offset < CAB_PROBE_SAMPLE_SIZE ?
+                    (size_t)(file_size - offset) : CAB_PROBE_SAMPLE_SIZE;
+                cab_probe_count((const unsigned char*)data + offset,
+                    sample_size, counts);
+                sampled_size += sample_size;
+            }
+            file_i_unmap(data, (size_t)file_size);
+        } else {
+            result = sample ? 0 : -1;
+            /* samples are read from the head if file can not be mapped */
+            while (result == 0 && sampled_size < file_size
+                && sampled_size < (unsigned long long)CAB_PROBE_SAMPLE_SIZE
+                    * CAB_PROBE_SAMPLE_COUNT) {
+                ssize_t read_size;
+                read_size = read(fd, sample, CAB_PROBE_SAMPLE_SIZE);
+                result = read_size > 0 ? 0 : -1;
+                if (result == 0) {
+                    cab_probe_count(sample, (size_t)read_size, counts);
+                    sampled_size += (unsigned long long)read_size;
+                }
+            }
+        }
+        close(fd);
+    }
+    if (result == 0 && sampled_size >= CAB_PROBE_MIN_SIZE) {
+        *file->incompressible = cab_probe_is_uniform(counts, sampled_size);
+    }
+    return result;
+}
+
+/**
+ * count byte frequencies in data
+ */
+static void
+cab_probe_count(
+    const unsigned char* data,
+    size_t data_size,
+    unsigned long* counts)
+{
+    size_t idx;
+    for (idx = 0; idx < data_size; idx++) {
+        counts[data[idx]]++;
+    }
+}
+
+/**
+ * judge byte frequencies incompressible.
+ * The chi-square statistic of byte frequencies against uniform distribution
+ * is 256 * sum(count * count) / size - size. It is about 255 for random data
+ * and it grows in proportion to the size for data having redundancy. The
+ * data is incompressible if the statistic is less than size / 16 + 512,
+ * which is about 0.045 bit per byte of the entropy lacking.
+ */
+static int
+cab_probe_is_uniform(
+    const unsigned long* counts,
+    unsigned long long sampled_size)
+{
+    unsigned long long square_sum;
+    size_t idx;
+    square_sum = 0;
+    for (idx = 0; idx < 256; idx++) {
+        square_sum += (unsigned long long)counts[idx] * counts[idx];
+    }
+    return square_sum * 256 < sampled_size
+        * (sampled_size + sampled_size / 16 + 512);
+}
+
+/**
+ * allocate memory
+ */
+static void*
+cab_probe_mem_alloc(
+    size_t size)
+{
+    return malloc(size);
+}
+
+/**
+ * free memory
+ */
+static void
+cab_probe_mem_free(
+    void* heap_obj)
+{
+    free(heap_obj);
+}
+
+/* vi: se ts=4 sw=4 et: */
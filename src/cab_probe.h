@@ -0,0 +1,53 @@
+#ifndef __CAB_PROBE_H__
+#define __CAB_PROBE_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+#define _CAB_PROBE_ITFC_BEGIN extern "C" {
+#define _CAB_PROBE_ITFC_END }
+#else
+#define _CAB_PROBE_ITFC_BEGIN
+#define _CAB_PROBE_ITFC_END
+#endif
+
+_CAB_PROBE_ITFC_BEGIN
+
+/**
+ * size of a sample block to count byte frequencies
+ */
+#define CAB_PROBE_SAMPLE_SIZE 16384U
+
+/**
+ * maximum count of sample blocks in a file
+ */
+#define CAB_PROBE_SAMPLE_COUNT 4
+
+/**
+ * minimum sampled size to judge a file incompressible
+ */
+#define CAB_PROBE_MIN_SIZE 4096U
+
+/**
+ * probe files whether compression gains nothing.
+ * Up to CAB_PROBE_SAMPLE_COUNT blocks spread over a file are sampled and
+ * the file is judged incompressible if its byte frequencies are so close to
+ * uniform distribution that the order-0 entropy lacks less than about 0.05
+ * bit per byte, like already compressed or encrypted data.
+ * incompressible[idx] gets not zero for such a file. A file smaller than
+ * CAB_PROBE_MIN_SIZE or a file which can not be read is compressible.
+ * file_sizes[idx] is the size of the file at idx. Files are probed in jobs
+ * threads.
+ */
+int
+cab_probe_files(
+    const char* const* file_paths,
+    const unsigned long long* file_sizes,
+    size_t file_count,
+    unsigned int jobs,
+    int* incompressible);
+
+_CAB_PROBE_ITFC_END
+
+/* vi: se ts=4 sw=4 et: */
+#endif
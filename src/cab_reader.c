@@ -0,0 +1,622 @@
+#include "cab_reader.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "file_i.h"
+#include "cab_checksum.h"
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+/**
+ * CFHEADER size without optional fields
+ */
+#define CAB_READER_CFHEADER_SIZE 36
+
+/**
+ * CFFOLDER size without reserved area
+ */
+#define CAB_READER_CFFOLDER_SIZE 8
+
+/**
+ * CFFILE size without file name
+ */
+#define CAB_READER_CFFILE_SIZE 16
+
+/**
+ * CFDATA size without reserved area
+ */
+#define CAB_READER_CFDATA_SIZE 8
+
+/**
+ * the cabinet has the previous cabinet
+ */
+#define CAB_READER_FLAG_PREV_CABINET 0x0001
+
+/**
+ * the cabinet has the next cabinet
+ */
+#define CAB_READER_FLAG_NEXT_CABINET 0x0002
+
+/**
+ * the cabinet has reserved areas
+ */
+#define CAB_READER_FLAG_RESERVE_PRESENT 0x0004
+
+/**
+ * cabinet read from mapped memory
+ */
+struct _cab_reader {
+    /**
+     * cabinet contents
+     */
+    const unsigned char* data;
+
+    /**
+     * size of cabinet
+     */
+    size_t size;
+
+    /**
+     * not zero if data is mapped. data is allocated memory if this is zero.
+     */
+    int mapped;
+
+    /**
+     * set identifier
+     */
+    unsigned int set_id;
+
+    /**
+     * index in set
+     */
+    unsigned int index;
+
+    /**
+     * the previous cabinet name
+     */
+    const char* prev_cabinet;
+
+    /**
+     * the next cabinet name
+     */
+    const char* next_cabinet;
+
+    /**
+     * folders
+     */
+    cab_reader_folder* folders;
+
+    /**
+     * count of folders
+     */
+    size_t folder_count;
+
+    /**
+     * data blocks of all folders
+     */
+    cab_reader_block* blocks;
+
+    /**
+     * files
+     */
+    cab_reader_file* files;
+
+    /**
+     * count of files
+     */
+    size_t file_count;
+};
+
+/**
+ * load cabinet contents from file descriptor
+ */
+static int
+cab_reader_load(
+    cab_reader* obj,
+    int fd);
+
+/**
+ * parse cabinet headers
+ */
+static int
+cab_reader_parse(
+    cab_reader* obj);
+
+/**
+ * get null terminated string at the offset.
+ * You get NULL if the string is not terminated in cabinet.
+ */
+static const char*
+cab_reader_get_str(
+    cab_reader* obj,
+    size_t* offset);
+
+/**
+ * get little endian 16 bit value
+ */
+static unsigned int
+cab_reader_get_u16(
+    const unsigned char* ptr);
+
+/**
+ * get little endian 32 bit value
+ */
+static unsigned long
+cab_reader_get_u32(
+    const unsigned char* ptr);
+
+/**
+ * allocate memory
+ */
+static void*
+cab_reader_mem_alloc(
+    size_t size);
+
+/**
+ * free memory
+ */
+static void
+cab_reader_mem_free(
+    void* heap_obj);
+
+/**
+ * open cabinet file and read the entries.
+ */
+cab_reader*
+cab_reader_open(
+    const char* file_path)
+{
+    cab_reader* result;
+    int fd;
+    result = NULL;
+    fd = -1;
+    if (file_path) {
+        fd = file_i_open(file_path, O_RDONLY | O_BINARY, 0);
+    } else {
+        errno = EINVAL;
+    }
+    if (fd != -1) {
+        result = (cab_reader*)cab_reader_mem_alloc(sizeof(cab_reader));
+    }
+    if (result) {
+        memset(result, 0, sizeof(*result));
+        if (cab_reader_load(result, fd) || cab_reader_parse(result)) {
+            int err;
+            err = errno;
+            cab_reader_close(result);
+            result = NULL;
+            errno = err;
+        }
+    }
+    if (fd != -1) {
+        close(fd);
+    }
+    return result;
+}
+
+/**
+ * close cabinet
+ */
+void
+cab_reader_close(
+    cab_reader* obj)
+{
+    if (obj) {
+        if (obj->data) {
+            if (obj->mapped) {
+                file_i_unmap(obj->data, obj->size);
+            } else {
+                cab_reader_mem_free((void*)obj->data);
+            }
+        }
+        if (obj->folders) {
+            cab_reader_mem_free(obj->folders);
+        }
+        if (obj->blocks) {
+            cab_reader_mem_free(obj->blocks);
+        }
+        if (obj->files) {
+            cab_reader_mem_free(obj->files);
+        }
+        cab_reader_mem_free(obj);
+    }
+}
+
+/**
+ * get set identifier shared by the cabinets in a set
+ */
+unsigned int
+cab_reader_get_set_id(
+    cab_reader* obj)
+{
+    return obj->set_id;
+}
+
+/**
+ * get index of the cabinet in a set
+ */
+unsigned int
+cab_reader_get_index(
+    cab_reader* obj)
+{
+    return obj->index;
+}
+
+/**
+ * get the previous cabinet name.
+ */
+const char*
+cab_reader_get_prev_cabinet(
+    cab_reader* obj)
+{
+    return obj->prev_cabinet;
+}
+
+/**
+ * get the next cabinet name.
+ */
+const char*
+cab_reader_get_next_cabinet(
+    cab_reader* obj)
+{
+    return obj->next_cabinet;
+}
+
+/**
+ * get count of folders
+ */
+size_t
+cab_reader_get_folder_count(
+    cab_reader* obj)
+{
+    return obj->folder_count;
+}
+
+/**
+ * get folder entry
+ */
+const cab_reader_folder*
+cab_reader_get_folder(
+    cab_reader* obj,
+    size_t index)
+{
+    const cab_reader_folder* result;
+    if (index < obj->folder_count) {
+        result = &obj->folders[index];
+    } else {
+        result = NULL;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * get count of files
+ */
+size_t
+cab_reader_get_file_count(
+    cab_reader* obj)
+{
+    return obj->file_count;
+}
+
+/**
+ * get file entry
+ */
+const cab_reader_file*
+cab_reader_get_file(
+    cab_reader* obj,
+    size_t index)
+{
+    const cab_reader_file* result;
+    if (index < obj->file_count) {
+        result = &obj->files[index];
+    } else {
+        result = NULL;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * verify checksum of data block.
+ */
+int
+cab_reader_verify_block(
+    const cab_reader_block* block)
+{
+    int result;
+    unsigned long checksum;
+    checksum = cab_reader_get_u32(block->header);
+    result = 0;
+    if (checksum) {
+        uint32_t computed;
+        /* the checksum covers data, sizes and reserved area */
+        computed = cab_checksum_compute(block->data,
+            block->compressed_size, 0);
+        computed = cab_checksum_compute(block->header + 4,
+            block->header_size - 4, computed);
+        if (computed != checksum) {
+            result = -1;
+            errno = EINVAL;
+        }
+    }
+    return result;
+}
+
+/**
+ * load cabinet contents from file descriptor
+ */
+static int
+cab_reader_load(
+    cab_reader* obj,
+    int fd)
+{
+    file_i_stat_info stat_content;
+    int result;
+    result = file_i_fstat(fd, &stat_content);
+    if (result == 0) {
+        if (stat_content.is_regular
+            && stat_content.size >= CAB_READER_CFHEADER_SIZE
+            && stat_content.size <= (size_t)-1) {
+            obj->size = (size_t)stat_content.size;
+        } else {
+            result = -1;
+            errno = EINVAL;
+        }
+    }
+    if (result == 0) {
+        obj->data = (const unsigned char*)file_i_map(fd, obj->size);
+        obj->mapped = obj->data != NULL;
+    }
+    if (result == 0 && !obj->data) {
+        unsigned char* buffer;
+        size_t read_size;
+        buffer = (unsigned char*)cab_reader_mem_alloc(obj->size);
+        result = buffer ? 0 : -1;
+        read_size = 0;
+        while (result == 0 && read_size < obj->size) {
+            size_t chunk_size;
+            ssize_t state;
+            chunk_size = obj->size - read_size;
+            if (chunk_size > 0x40000000) {
+                chunk_size = 0x40000000;
+            }
+            state = read(fd, buffer + read_size, chunk_size);
+            if (state > 0) {
+                read_size += (size_t)state;
+            } else {
+                if (state == 0) {
+                    errno = EINVAL;
+                }
+                result = -1;
+            }
+        }
+        if (result == 0) {
+            obj->data = buffer;
+        } else if (buffer) {
+            cab_reader_mem_free(buffer);
+        }
+    }
+    return result;
+}
+
+/**
+ * parse cabinet headers
+ */
+static int
+cab_reader_parse(
+    cab_reader* obj)
+{
+    const unsigned char* data;
+    size_t offset;
+    size_t folders_offset;
+    size_t files_offset;
+    unsigned int flags;
+    unsigned int folder_reserve_size;
+    unsigned int data_reserve_size;
+    size_t block_count;
+    size_t idx;
+    int result;
+    data = obj->data;
+    result = memcmp(data, "MSCF", 4) == 0
+        && cab_reader_get_u32(data + 8) <= obj->size ? 0 : -1;
+    folder_reserve_size = 0;
+    data_reserve_size = 0;
+    offset = CAB_READER_CFHEADER_SIZE;
+    files_offset = 0;
+    flags = 0;
+    if (result == 0) {
+        files_offset = cab_reader_get_u32(data + 16);
+        obj->folder_count = cab_reader_get_u16(data + 26);
+        obj->file_count = cab_reader_get_u16(data + 28);
+        flags = cab_reader_get_u16(data + 30);
+        obj->set_id = cab_reader_get_u16(data + 32);
+        obj->index = cab_reader_get_u16(data + 34);
+        if (flags & CAB_READER_FLAG_RESERVE_PRESENT) {
+            if (offset + 4 <= obj->size) {
+                offset += 4 + cab_reader_get_u16(data + offset);
+                folder_reserve_size = data[CAB_READER_CFHEADER_SIZE + 2];
+                data_reserve_size = data[CAB_READER_CFHEADER_SIZE + 3];
+            } else {
+                result = -1;
+            }
+        }
+    }
+    if (result == 0 && (flags & CAB_READER_FLAG_PREV_CABINET)) {
+        obj->prev_cabinet = cab_reader_get_str(obj, &offset);
+        result = obj->prev_cabinet && cab_reader_get_str(obj, &offset) ?
+            0 : -1;
+    }
+    if (result == 0 && (flags & CAB_READER_FLAG_NEXT_CABINET)) {
+        obj->next_cabinet = cab_reader_get_str(obj, &offset);
+        result = obj->next_cabinet && cab_reader_get_str(obj, &offset) ?
+            0 : -1;
+    }
+    if (result == 0 && obj->folder_count) {
+        obj->folders = (cab_reader_folder*)cab_reader_mem_alloc(
+            sizeof(cab_reader_folder) * obj->folder_count);
+        result = obj->folders ? 0 : -1;
+    }
+    block_count = 0;
+    folders_offset = offset;
+    for (idx = 0; result == 0 && idx < obj->folder_count; idx++) {
+        if (offset + CAB_READER_CFFOLDER_SIZE + folder_reserve_size
+            <= obj->size) {
+            obj->folders[idx].block_count =
+                cab_reader_get_u16(data + offset + 4);
+            obj->folders[idx].type_compress =
+                cab_reader_get_u16(data + offset + 6);
+            obj->folders[idx].blocks = NULL;
+            block_count += obj->folders[idx].block_count;
+            offset += CAB_READER_CFFOLDER_SIZE + folder_reserve_size;
+        } else {
+            result = -1;
+        }
+    }
+    if (result == 0 && block_count) {
+        /* data blocks follow the folders, reject counts not fit in them */
+        result = offset <= obj->size
+            && block_count <= (obj->size - offset)
+                / (CAB_READER_CFDATA_SIZE + data_reserve_size) ? 0 : -1;
+    }
+    if (result == 0 && block_count) {
+        obj->blocks = (cab_reader_block*)cab_reader_mem_alloc(
+            sizeof(cab_reader_block) * block_count);
+        result = obj->blocks ? 0 : -1;
+    }
+    if (result == 0) {
+        cab_reader_block* block;
+        block = obj->blocks;
+        for (idx = 0; result == 0 && idx < obj->folder_count; idx++) {
+            size_t block_offset;
+            unsigned int block_idx;
+            block_offset = cab_reader_get_u32(data + folders_offset
+                + (CAB_READER_CFFOLDER_SIZE + folder_reserve_size) * idx);
+            obj->folders[idx].blocks = block;
+            for (block_idx = 0; block_idx < obj->folders[idx].block_count;
+                block_idx++) {
+                if (block_offset + CAB_READER_CFDATA_SIZE + data_reserve_size
+                    > obj->size) {
+                    result = -1;
+                    break;
+                }
+                block->header = data + block_offset;
+                block->header_size = CAB_READER_CFDATA_SIZE
+                    + data_reserve_size;
+                block->compressed_size =
+                    cab_reader_get_u16(block->header + 4);
+                block->uncompressed_size =
+                    cab_reader_get_u16(block->header + 6);
+                block->data = block->header + block->header_size;
+                block_offset += block->header_size;
+                if (block_offset + block->compressed_size > obj->size) {
+                    result = -1;
+                    break;
+                }
+                block_offset += block->compressed_size;
+                block++;
+            }
+        }
+    }
+    if (result == 0 && obj->file_count) {
+        obj->files = (cab_reader_file*)cab_reader_mem_alloc(
+            sizeof(cab_reader_file) * obj->file_count);
+        result = obj->files ? 0 : -1;
+    }
+    offset = files_offset;
+    for (idx = 0; result == 0 && idx < obj->file_count; idx++) {
+        cab_reader_file* file;
+        file = &obj->files[idx];
+        if (offset + CAB_READER_CFFILE_SIZE < obj->size) {
+            file->size = cab_reader_get_u32(data + offset);
+            file->offset = cab_reader_get_u32(data + offset + 4);
+            file->folder_index = cab_reader_get_u16(data + offset + 8);
+            file->date = cab_reader_get_u16(data + offset + 10);
+            file->time = cab_reader_get_u16(data + offset + 12);
+            file->attribs = cab_reader_get_u16(data + offset + 14);
+            offset += CAB_READER_CFFILE_SIZE;
+            file->name = cab_reader_get_str(obj, &offset);
+        } else {
+            file->name = NULL;
+        }
+        if (!file->name || (file->folder_index >= obj->folder_count
+            && file->folder_index < CAB_READER_IFOLD_CONTINUED_FROM_PREV)) {
+            result = -1;
+        }
+    }
+    if (result && errno != ENOMEM) {
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * get null terminated string at the offset.
+ */
+static const char*
+cab_reader_get_str(
+    cab_reader* obj,
+    size_t* offset)
+{
+    const char* result;
+    const unsigned char* terminator;
+    result = NULL;
+    if (*offset < obj->size) {
+        terminator = (const unsigned char*)memchr(obj->data + *offset, '\0',
+            obj->size - *offset);
+        if (terminator) {
+            result = (const char*)obj->data + *offset;
+            *offset = terminator - obj->data + 1;
+        }
+    }
+    return result;
+}
+
+/**
+ * get little endian 16 bit value
+ */
+static unsigned int
+cab_reader_get_u16(
+    const unsigned char* ptr)
+{
+    return ptr[0] | ((unsigned int)ptr[1] << 8);
+}
+
+/**
+ * get little endian 32 bit value
+ */
+static unsigned long
+cab_reader_get_u32(
+    const unsigned char* ptr)
+{
+    return ptr[0] | ((unsigned long)ptr[1] << 8)
+        | ((unsigned long)ptr[2] << 16) | ((unsigned long)ptr[3] << 24);
+}
+
+/**
+ * allocate memory
+ */
+static void*
+cab_reader_mem_alloc(
+    size_t size)
+{
+    return malloc(size);
+}
+
+/**
+ * free memory
+ */
+static void
+cab_reader_mem_free(
+    void* heap_obj)
+{
+    free(heap_obj);
+}
+
+/* vi: se ts=4 sw=4 et: */
@@ -0,0 +1,227 @@
+#ifndef __CAB_READER_H__
+#define __CAB_READER_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+#define _CAB_READER_ITFC_BEGIN extern "C" {
+#define _CAB_READER_ITFC_END }
+#else
+#define _CAB_READER_ITFC_BEGIN
+#define _CAB_READER_ITFC_END
+#endif
+
+_CAB_READER_ITFC_BEGIN
+
+/**
+ * file folder index for the file continued from the previous cabinet
+ */
+#define CAB_READER_IFOLD_CONTINUED_FROM_PREV 0xFFFD
+
+/**
+ * file folder index for the file continued to the next cabinet
+ */
+#define CAB_READER_IFOLD_CONTINUED_TO_NEXT 0xFFFE
+
+/**
+ * file folder index for the file continued from the previous cabinet and
+ * to the next cabinet
+ */
+#define CAB_READER_IFOLD_CONTINUED_PREV_AND_NEXT 0xFFFF
+
+/**
+ * cabinet read from mapped memory
+ */
+typedef struct _cab_reader cab_reader;
+
+/**
+ * data block entry
+ */
+typedef struct _cab_reader_block cab_reader_block;
+
+/**
+ * folder entry
+ */
+typedef struct _cab_reader_folder cab_reader_folder;
+
+/**
+ * file entry
+ */
+typedef struct _cab_reader_file cab_reader_file;
+
+/**
+ * data block entry
+ */
+struct _cab_reader_block {
+    /**
+     * CFDATA header followed by reserved area
+     */
+    const unsigned char* header;
+
+    /**
+     * size of header including reserved area
+     */
+    unsigned int header_size;
+
+    /**
+     * compressed data
+     */
+    const unsigned char* data;
+
+    /**
+     * size of compressed data
+     */
+    unsigned int compressed_size;
+
+    /**
+     * size of uncompressed data. It is zero if the data continues into the
+     * first block of the next cabinet.
+     */
+    unsigned int uncompressed_size;
+};
+
+/**
+ * folder entry
+ */
+struct _cab_reader_folder {
+    /**
+     * compression type
+     */
+    unsigned int type_compress;
+
+    /**
+     * count of data blocks in this cabinet
+     */
+    unsigned int block_count;
+
+    /**
+     * data blocks
+     */
+    const cab_reader_block* blocks;
+};
+
+/**
+ * file entry
+ */
+struct _cab_reader_file {
+    /**
+     * file name in cabinet. The name is encoded as the attributes specify.
+     */
+    const char* name;
+
+    /**
+     * uncompressed file size
+     */
+    unsigned long size;
+
+    /**
+     * uncompressed offset in folder
+     */
+    unsigned long offset;
+
+    /**
+     * folder index or one of CAB_READER_IFOLD_XXX
+     */
+    unsigned int folder_index;
+
+    /**
+     * date in fat format
+     */
+    unsigned int date;
+
+    /**
+     * time in fat format
+     */
+    unsigned int time;
+
+    /**
+     * file attributes
+     */
+    unsigned int attribs;
+};
+
+/**
+ * open cabinet file and read the entries.
+ * You get NULL and errno is set EINVAL if the file is not a cabinet.
+ */
+cab_reader*
+cab_reader_open(
+    const char* file_path);
+
+/**
+ * close cabinet
+ */
+void
+cab_reader_close(
+    cab_reader* obj);
+
+/**
+ * get set identifier shared by the cabinets in a set
+ */
+unsigned int
+cab_reader_get_set_id(
+    cab_reader* obj);
+
+/**
+ * get index of the cabinet in a set
+ */
+unsigned int
+cab_reader_get_index(
+    cab_reader* obj);
+
+/**
+ * get the previous cabinet name. You get NULL for the first cabinet.
+ */
+const char*
+cab_reader_get_prev_cabinet(
+    cab_reader* obj);
+
+/**
+ * get the next cabinet name. You get NULL for the last cabinet.
+ */
+const char*
+cab_reader_get_next_cabinet(
+    cab_reader* obj);
+
+/**
+ * get count of folders
+ */
+size_t
+cab_reader_get_folder_count(
+    cab_reader* obj);
+
+/**
+ * get folder entry
+ */
+const cab_reader_folder*
+cab_reader_get_folder(
+    cab_reader* obj,
+    size_t index);
+
+/**
+ * get count of files
+ */
+size_t
+cab_reader_get_file_count(
+    cab_reader* obj);
+
+/**
+ * get file entry
+ */
+const cab_reader_file*
+cab_reader_get_file(
+    cab_reader* obj,
+    size_t index);
+
+/**
+ * verify checksum of data block.
+ * You get zero if the checksum matches or the block does not have checksum.
+ */
+int
+cab_reader_verify_block(
+    const cab_reader_block* block);
+
+_CAB_READER_ITFC_END
+
+/* vi: se ts=4 sw=4 et: */
+#endif
@@ -0,0 +1,4157 @@
+#include "cab_writer.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "cab_checksum.h"
+#include "cab_compressor.h"
+#include "sha256.h"
+#include "thread_i.h"
+#include "worker_pool.h"
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+#ifndef S_IREAD
+#define S_IREAD S_IRUSR
+#endif
+
+#ifndef S_IWRITE
+#define S_IWRITE S_IWUSR
+#endif
+
+/**
+ * permission for cabinet file
+ */
+#if defined(S_IRGRP) && defined(S_IROTH)
+#define CAB_WRITER_CABINET_MODE \
+    (S_IREAD | S_IWRITE | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH)
+#else
+#define CAB_WRITER_CABINET_MODE (S_IREAD | S_IWRITE)
+#endif
+
+/**
+ * cabinet writer
+ */
+typedef struct _cab_writer cab_writer;
+
+/**
+ * file entry in folder
+ */
+typedef struct _cab_writer_file cab_writer_file;
+
+/**
+ * data block in folder
+ */
+typedef struct _cab_writer_block cab_writer_block;
+
+/**
+ * folder
+ */
+typedef struct _cab_writer_folder cab_writer_folder;
+
+/**
+ * scheduled files compressed in background
+ */
+typedef struct _cab_writer_job cab_writer_job;
+
+/**
+ * folder compressed in background
+ */
+typedef struct _cab_writer_job_folder cab_writer_job_folder;
+
+/**
+ * size of CFHEADER without optional fields
+ */
+#define CAB_WRITER_CFHEADER_SIZE 36
+
+/**
+ * size of reserve fields in CFHEADER
+ */
+#define CAB_WRITER_CFHEADER_RESERVE_SIZE 4
+
+/**
+ * size of CFFOLDER without reserved area
+ */
+#define CAB_WRITER_CFFOLDER_SIZE 8
+
+/**
+ * size of CFFILE without name
+ */
+#define CAB_WRITER_CFFILE_SIZE 16
+
+/**
+ * size of CFDATA without reserved area
+ */
+#define CAB_WRITER_CFDATA_SIZE 8
+
+/**
+ * cabinet has previous cabinet
+ */
+#define CAB_WRITER_FLAG_PREV_CABINET 0x0001
+
+/**
+ * cabinet has next cabinet
+ */
+#define CAB_WRITER_FLAG_NEXT_CABINET 0x0002
+
+/**
+ * cabinet has reserved fields
+ */
+#define CAB_WRITER_FLAG_RESERVE_PRESENT 0x0004
+
+/**
+ * file continued from previous cabinet
+ */
+#define CAB_WRITER_IFOLD_CONTINUED_FROM_PREV 0xFFFD
+
+/**
+ * file continued to next cabinet
+ */
+#define CAB_WRITER_IFOLD_CONTINUED_TO_NEXT 0xFFFE
+
+/**
+ * file continued from previous cabinet and to next cabinet
+ */
+#define CAB_WRITER_IFOLD_CONTINUED_PREV_AND_NEXT 0xFFFF
+
+/**
+ * maximum count of folders, files or data blocks
+ */
+#define CAB_WRITER_MAX_COUNT 0xFFFF
+
+/**
+ * copy buffer size
+ */
+#define CAB_WRITER_IO_BUFFER_SIZE 0x10000
+
+/**
+ * count of jobs compressed ahead for each thread
+ */
+#define CAB_WRITER_JOB_LOOKAHEAD 2
+
+/**
+ * signature of folder cache entry. It is also hashed into the cache key,
+ * so that the entries of other formats are never looked up.
+ */
+#define CAB_WRITER_CACHE_SIGNATURE "CABXFC01"
+
+/**
+ * size of folder cache entry header
+ */
+#define CAB_WRITER_CACHE_HEADER_SIZE 16
+
+/**
+ * size of data block record in folder cache entry
+ */
+#define CAB_WRITER_CACHE_BLOCK_SIZE 8
+
+/**
+ * file entry in folder
+ */
+struct _cab_writer_file {
+    /**
+     * file name in cabinet
+     */
+    char* name;
+
+    /**
+     * uncompressed file size
+     */
+    unsigned long size;
+
+    /**
+     * uncompressed offset in folder
+     */
+    unsigned long offset;
+
+    /**
+     * fat date
+     */
+    unsigned short date;
+
+    /**
+     * fat time
+     */
+    unsigned short time;
+
+    /**
+     * attributes
+     */
+    unsigned short attribs;
+
+    /**
+     * source file path copied when cabinet is written. NULL if the data
+     * is kept in temporary file.
+     */
+    char* source_path;
+};
+
+/**
+ * data block in folder
+ */
+struct _cab_writer_block {
+    /**
+     * offset in temporary stream just after this block
+     */
+    long data_end;
+
+    /**
+     * uncompressed offset in folder just after this block
+     */
+    unsigned long uncompressed_end;
+};
+
+/**
+ * folder
+ */
+struct _cab_writer_folder {
+    /**
+     * compression type
+     */
+    TCOMP type_compress;
+
+    /**
+     * not zero if data blocks are stored from source files when cabinet is
+     * written. The folder has no temporary file.
+     */
+    int stored;
+
+    /**
+     * temporary file path to keep data blocks
+     */
+    char temp_path[CB_MAX_CAB_PATH];
+
+    /**
+     * temporary file handle
+     */
+    intptr_t temp_hdl;
+
+    /**
+     * written size of temporary file. It is the size of data blocks in
+     * stored folder.
+     */
+    long temp_size;
+
+    /**
+     * current position of temporary file
+     */
+    long temp_position;
+
+    /**
+     * data blocks
+     */
+    cab_writer_block* blocks;
+
+    /**
+     * count of data blocks
+     */
+    size_t block_count;
+
+    /**
+     * capacity of data blocks
+     */
+    size_t block_capacity;
+
+    /**
+     * the first data block which is not written into cabinet
+     */
+    size_t block_start;
+
+    /**
+     * offset in temporary stream at block_start
+     */
+    long data_offset;
+
+    /**
+     * uncompressed offset at block_start
+     */
+    unsigned long uncompressed_offset;
+
+    /**
+     * files in this folder
+     */
+    cab_writer_file* files;
+
+    /**
+     * count of files
+     */
+    size_t file_count;
+
+    /**
+     * capacity of files
+     */
+    size_t file_capacity;
+
+    /**
+     * the first file which is not completed in cabinets
+     */
+    size_t file_start;
+
+    /**
+     * total size of CFFILE entries from file_start
+     */
+    unsigned long file_entry_size;
+};
+
+/**
+ * folder compressed in background
+ */
+struct _cab_writer_job_folder {
+    /**
+     * temporary file path to keep data blocks
+     */
+    char temp_path[CB_MAX_CAB_PATH];
+
+    /**
+     * temporary file handle
+     */
+    intptr_t temp_hdl;
+
+    /**
+     * written size of temporary file
+     */
+    long temp_size;
+
+    /**
+     * data blocks
+     */
+    cab_writer_block* blocks;
+
+    /**
+     * count of data blocks
+     */
+    size_t block_count;
+
+    /**
+     * capacity of data blocks
+     */
+    size_t block_capacity;
+
+    /**
+     * index of source file just after the last file in this folder
+     */
+    size_t file_end;
+
+    /**
+     * not zero if the data blocks are copied from folder cache
+     */
+    int cached;
+};
+
+/**
+ * scheduled files compressed in background
+ */
+struct _cab_writer_job {
+    /**
+     * cabinet writer
+     */
+    cab_writer* writer;
+
+    /**
+     * compression type
+     */
+    TCOMP type_compress;
+
+    /**
+     * folder threshold when the job was scheduled
+     */
+    unsigned long folder_threshold;
+
+    /**
+     * size of CFDATA header with reserved area
+     */
+    unsigned int header_size;
+
+    /**
+     * source files
+     */
+    char** source_files;
+
+    /**
+     * source file sizes
+     */
+    unsigned long* source_sizes;
+
+    /**
+     * count of source files
+     */
+    size_t source_count;
+
+    /**
+     * sha256 digests of source file contents. NULL if the writer has no
+     * folder cache.
+     */
+    unsigned char* digests;
+
+    /**
+     * folders
+     */
+    cab_writer_job_folder* folders;
+
+    /**
+     * count of folders
+     */
+    size_t folder_count;
+
+    /**
+     * capacity of folders
+     */
+    size_t folder_capacity;
+
+    /**
+     * not zero if the job is completed
+     */
+    int done;
+
+    /**
+     * error information
+     */
+    ERF erf;
+
+    /**
+     * the folder in progress in cabinet
+     */
+    size_t folder_index;
+
+    /**
+     * the next data block in the folder in progress
+     */
+    size_t block_index;
+
+    /**
+     * the next source file to be added
+     */
+    size_t source_index;
+
+    /**
+     * next job
+     */
+    cab_writer_job* next;
+};
+
+/**
+ * cabinet writer
+ */
+struct _cab_writer {
+    /**
+     * error information
+     */
+    PERF erf;
+
+    /**
+     * file placed callback
+     */
+    PFNFCIFILEPLACED file_placed;
+
+    /**
+     * allocate memory
+     */
+    PFNFCIALLOC mem_alloc;
+
+    /**
+     * free memory
+     */
+    PFNFCIFREE mem_free;
+
+    /**
+     * open file
+     */
+    PFNFCIOPEN open_file;
+
+    /**
+     * read file
+     */
+    PFNFCIREAD read_file;
+
+    /**
+     * write file
+     */
+    PFNFCIWRITE write_file;
+
+    /**
+     * close file
+     */
+    PFNFCICLOSE close_file;
+
+    /**
+     * seek file
+     */
+    PFNFCISEEK seek_file;
+
+    /**
+     * delete file
+     */
+    PFNFCIDELETE delete_file;
+
+    /**
+     * get temporary file name
+     */
+    PFNFCIGETTEMPFILE get_temp_file;
+
+    /**
+     * map source file
+     */
+    PFNCABWRITERMAP map_file;
+
+    /**
+     * unmap source file
+     */
+    PFNCABWRITERUNMAP unmap_file;
+
+    /**
+     * cache of compressed folders
+     */
+    folder_cache* folder_cache;
+
+    /**
+     * get next cabinet in current operation
+     */
+    PFNFCIGETNEXTCABINET get_next_cabinet;
+
+    /**
+     * progress in current operation
+     */
+    PFNFCISTATUS status;
+
+    /**
+     * user data for callbacks
+     */
+    void* user_data;
+
+    /**
+     * current cabinet parameter
+     */
+    CCAB ccab;
+
+    /**
+     * previous cabinet name
+     */
+    char prev_cab[CB_MAX_CABINET_NAME];
+
+    /**
+     * previous disk name
+     */
+    char prev_disk[CB_MAX_DISK_NAME];
+
+    /**
+     * not zero if the current cabinet has previous cabinet
+     */
+    int has_prev;
+
+    /**
+     * not zero if the writer has to get next cabinet before adding a file
+     */
+    int need_next_cab;
+
+    /**
+     * pending folders in current cabinet
+     */
+    cab_writer_folder** folders;
+
+    /**
+     * count of pending folders
+     */
+    size_t folder_count;
+
+    /**
+     * capacity of pending folders
+     */
+    size_t folder_capacity;
+
+    /**
+     * not zero if the last pending folder accepts data
+     */
+    int folder_open;
+
+    /**
+     * compressor
+     */
+    cab_compressor* compressor;
+
+    /**
+     * uncompressed data block
+     */
+    unsigned char* block_buffer;
+
+    /**
+     * size of data in block_buffer
+     */
+    unsigned int block_fill;
+
+    /**
+     * CFDATA buffer
+     */
+    unsigned char* data_buffer;
+
+    /**
+     * copy buffer
+     */
+    unsigned char* io_buffer;
+
+    /**
+     * threads to compress scheduled files
+     */
+    worker_pool* pool;
+
+    /**
+     * lock for jobs and callbacks shared with threads
+     */
+    thread_i_mutex* lock;
+
+    /**
+     * signaled when a job is completed
+     */
+    thread_i_cond* job_done;
+
+    /**
+     * the first scheduled job
+     */
+    cab_writer_job* job_head;
+
+    /**
+     * the last scheduled job
+     */
+    cab_writer_job* job_tail;
+
+    /**
+     * the first job which is not submitted to threads
+     */
+    cab_writer_job* job_pending;
+
+    /**
+     * count of jobs submitted to threads and not released
+     */
+    size_t job_running_count;
+
+    /**
+     * not zero if the folder in progress takes data from the first job
+     */
+    int job_folder_open;
+
+    /**
+     * not zero if the threads have to stop compression
+     */
+    int job_cancel;
+};
+
+/**
+ * set error
+ */
+static void
+cab_writer_set_error(
+    cab_writer* obj,
+    int oper,
+    int type);
+
+/**
+ * grow array
+ */
+static int
+cab_writer_grow(
+    cab_writer* obj,
+    void** array,
+    size_t* capacity,
+    size_t element_size,
+    size_t required);
+
+/**
+ * grow array without setting error
+ */
+static int
+cab_writer_grow_array(
+    cab_writer* obj,
+    void** array,
+    size_t* capacity,
+    size_t element_size,
+    size_t required);
+
+/**
+ * lock callbacks and jobs shared with threads
+ */
+static void
+cab_writer_lock(
+    cab_writer* obj);
+
+/**
+ * unlock callbacks and jobs shared with threads
+ */
+static void
+cab_writer_unlock(
+    cab_writer* obj);
+
+/**
+ * create temporary file
+ */
+static int
+cab_writer_open_temp_file(
+    cab_writer* obj,
+    char* temp_path,
+    int temp_path_size,
+    intptr_t* temp_hdl,
+    int* err);
+
+/**
+ * open new folder
+ */
+static int
+cab_writer_open_folder(
+    cab_writer* obj,
+    TCOMP type_compress);
+
+/**
+ * complete the folder in progress
+ */
+static int
+cab_writer_close_folder(
+    cab_writer* obj);
+
+/**
+ * move file entries of the folder which has no data block into another
+ * folder. The files are placed at the uncompressed end of the folder.
+ */
+static int
+cab_writer_move_files(
+    cab_writer* obj,
+    cab_writer_folder* src_folder,
+    cab_writer_folder* dst_folder);
+
+/**
+ * free folder
+ */
+static void
+cab_writer_free_folder(
+    cab_writer* obj,
+    cab_writer_folder* folder);
+
+/**
+ * add file entry into the folder in progress
+ */
+static int
+cab_writer_add_file_entry(
+    cab_writer* obj,
+    const char* file_name,
+    unsigned long size,
+    unsigned short date,
+    unsigned short time,
+    unsigned short attribs);
+
+/**
+ * read source file into folder
+ */
+static int
+cab_writer_read_source(
+    cab_writer* obj,
+    intptr_t src_hdl,
+    unsigned long size);
+
+/**
+ * compress mapped source file into folder in progress
+ */
+static int
+cab_writer_add_mapped_source(
+    cab_writer* obj,
+    const unsigned char* data,
+    unsigned long size);
+
+/**
+ * compress a block and append it into folder in progress.
+ * The source is block buffer or a block in mapped source file.
+ */
+static int
+cab_writer_emit_block(
+    cab_writer* obj,
+    const unsigned char* src);
+
+/**
+ * add source file into stored folder in progress without reading it
+ */
+static int
+cab_writer_add_stored_source(
+    cab_writer* obj,
+    const char* source_file,
+    unsigned long size);
+
+/**
+ * append data block stored from source files into folder in progress
+ */
+static int
+cab_writer_emit_stored_block(
+    cab_writer* obj);
+
+/**
+ * compress data into CFDATA
+ */
+static int
+cab_writer_build_block(
+    cab_compressor* compressor,
+    const unsigned char* src,
+    unsigned int src_size,
+    unsigned char* data_buffer,
+    unsigned int header_size,
+    unsigned int* data_size);
+
+/**
+ * append CFDATA written in temporary file into folder in progress
+ */
+static int
+cab_writer_append_block(
+    cab_writer* obj,
+    unsigned int data_size);
+
+/**
+ * take the next folder in the first job for folder in progress
+ */
+static int
+cab_writer_take_job_folder(
+    cab_writer* obj,
+    cab_writer_folder* folder,
+    TCOMP type_compress);
+
+/**
+ * add source file compressed by the first job into folder
+ */
+static int
+cab_writer_add_job_source(
+    cab_writer* obj,
+    const char* source_file,
+    unsigned long size);
+
+/**
+ * append data block compressed by the first job into folder in progress
+ */
+static int
+cab_writer_emit_job_block(
+    cab_writer* obj);
+
+/**
+ * complete the folder taken from the first job
+ */
+static int
+cab_writer_release_job_folder(
+    cab_writer* obj);
+
+/**
+ * wait for the job to be completed
+ */
+static int
+cab_writer_wait_job(
+    cab_writer* obj,
+    cab_writer_job* job);
+
+/**
+ * submit pending jobs to threads
+ */
+static int
+cab_writer_submit_jobs(
+    cab_writer* obj);
+
+/**
+ * free job
+ */
+static void
+cab_writer_free_job(
+    cab_writer* obj,
+    cab_writer_job* job);
+
+/**
+ * compress scheduled files in a thread
+ */
+static void
+cab_writer_job_run(
+    void* arg);
+
+/**
+ * start new folder in the job
+ */
+static int
+cab_writer_job_open_folder(
+    cab_writer_job* job);
+
+/**
+ * open a source file in the job and get its size
+ */
+static int
+cab_writer_job_open_source(
+    cab_writer_job* job,
+    size_t source_index,
+    intptr_t* src_hdl,
+    long* src_size);
+
+/**
+ * read a source file and compress it into the last folder in the job
+ */
+static int
+cab_writer_job_read_source(
+    cab_writer_job* job,
+    size_t source_index,
+    cab_compressor* compressor,
+    unsigned char* block_buffer,
+    unsigned int* block_fill,
+    unsigned char* data_buffer);
+
+/**
+ * compress block buffer into the last folder in the job
+ */
+static int
+cab_writer_job_write_block(
+    cab_writer_job* job,
+    cab_compressor* compressor,
+    const unsigned char* block_buffer,
+    unsigned int block_fill,
+    unsigned char* data_buffer);
+
+/**
+ * calculate digests of all source files in the job
+ */
+static int
+cab_writer_job_digest_sources(
+    cab_writer_job* job,
+    unsigned char* block_buffer);
+
+/**
+ * get folder cache key for the folder starting at the source file
+ */
+static void
+cab_writer_job_get_cache_key(
+    cab_writer_job* job,
+    size_t source_index,
+    unsigned char* key);
+
+/**
+ * copy the folder starting at the source file from folder cache into the
+ * last folder in the job.
+ * You get 1 if the folder is copied, 0 if the cache does not have the
+ * folder or -1 if error.
+ */
+static int
+cab_writer_job_load_folder(
+    cab_writer_job* job,
+    size_t source_index,
+    unsigned char* data_buffer);
+
+/**
+ * store the last folder in the job into folder cache.
+ * The folder is not stored if any error occurs.
+ */
+static void
+cab_writer_job_store_folder(
+    cab_writer_job* job,
+    size_t source_index,
+    unsigned char* data_buffer);
+
+/**
+ * you get non zero if the writer cancels jobs
+ */
+static int
+cab_writer_job_is_cancelled(
+    cab_writer_job* job);
+
+/**
+ * set error into job
+ */
+static void
+cab_writer_job_set_error(
+    cab_writer_job* job,
+    int oper,
+    int type);
+
+/**
+ * write cabinets while pending data exceed cabinet size
+ */
+static int
+cab_writer_fit_cabinet(
+    cab_writer* obj);
+
+/**
+ * get next cabinet parameter
+ */
+static int
+cab_writer_get_next_cabinet(
+    cab_writer* obj,
+    CCAB* next_ccab,
+    unsigned long prev_size);
+
+/**
+ * move to next cabinet
+ */
+static void
+cab_writer_move_to_next_cabinet(
+    cab_writer* obj,
+    const CCAB* next_ccab,
+    int linked);
+
+/**
+ * calculate cabinet header size
+ */
+static unsigned long
+cab_writer_header_size(
+    cab_writer* obj,
+    const CCAB* next_ccab);
+
+/**
+ * calculate cabinet size for pending folders
+ */
+static unsigned long
+cab_writer_cabinet_size(
+    cab_writer* obj,
+    size_t folder_count,
+    size_t last_block_end,
+    const CCAB* next_ccab);
+
+/**
+ * calculate size of CFFILE entries in a folder part
+ */
+static unsigned long
+cab_writer_folder_file_entry_size(
+    cab_writer* obj,
+    cab_writer_folder* folder,
+    size_t block_end,
+    size_t* file_count);
+
+/**
+ * uncompressed offset at the block
+ */
+static unsigned long
+cab_writer_folder_uncompressed_end(
+    cab_writer_folder* folder,
+    size_t block_end);
+
+/**
+ * data offset at the block
+ */
+static long
+cab_writer_folder_data_end(
+    cab_writer_folder* folder,
+    size_t block_end);
+
+/**
+ * you get non zero if the folder part is the last part of the folder.
+ */
+static int
+cab_writer_is_final_part(
+    cab_writer* obj,
+    cab_writer_folder* folder,
+    size_t block_end);
+
+/**
+ * you get non zero if the file is in the folder part.
+ */
+static int
+cab_writer_file_in_part(
+    cab_writer* obj,
+    cab_writer_folder* folder,
+    cab_writer_file* file,
+    size_t block_end);
+
+/**
+ * write cabinet file
+ */
+static int
+cab_writer_write_cabinet(
+    cab_writer* obj,
+    size_t folder_count,
+    size_t last_block_end,
+    const CCAB* next_ccab);
+
+/**
+ * write cabinet header, folder entries and file entries
+ */
+static int
+cab_writer_write_cabinet_entries(
+    cab_writer* obj,
+    intptr_t cab_hdl,
+    size_t folder_count,
+    size_t last_block_end,
+    const CCAB* next_ccab,
+    unsigned long cabinet_size);
+
+/**
+ * copy folder data into cabinet
+ */
+static int
+cab_writer_copy_folder_data(
+    cab_writer* obj,
+    intptr_t cab_hdl,
+    cab_writer_folder* folder,
+    size_t block_end);
+
+/**
+ * write data blocks of stored folder into cabinet from source files
+ */
+static int
+cab_writer_store_folder_data(
+    cab_writer* obj,
+    intptr_t cab_hdl,
+    cab_writer_folder* folder,
+    size_t block_end);
+
+/**
+ * open source file of stored folder and map it if possible
+ */
+static int
+cab_writer_open_stored_source(
+    cab_writer* obj,
+    const cab_writer_file* file,
+    intptr_t* src_hdl,
+    const unsigned char** src_data);
+
+/**
+ * close source file of stored folder
+ */
+static void
+cab_writer_close_stored_source(
+    cab_writer* obj,
+    const cab_writer_file* file,
+    intptr_t src_hdl,
+    const unsigned char* src_data);
+
+/**
+ * read a part of source file of stored folder
+ */
+static int
+cab_writer_read_stored_source(
+    cab_writer* obj,
+    intptr_t src_hdl,
+    unsigned long position,
+    unsigned char* buffer,
+    unsigned long size);
+
+/**
+ * notify placed files
+ */
+static int
+cab_writer_notify_placed(
+    cab_writer* obj,
+    size_t folder_count,
+    size_t last_block_end);
+
+/**
+ * update pending folders after writing cabinet
+ */
+static void
+cab_writer_remove_written(
+    cab_writer* obj,
+    size_t folder_count,
+    size_t last_block_end);
+
+/**
+ * call status callback
+ */
+static int
+cab_writer_notify_status(
+    cab_writer* obj,
+    unsigned int type_status,
+    unsigned long size_1,
+    unsigned long size_2);
+
+/**
+ * store 16 bit little endian value
+ */
+static unsigned char*
+cab_writer_put_u16(
+    unsigned char* ptr,
+    unsigned int value);
+
+/**
+ * store 32 bit little endian value
+ */
+static unsigned char*
+cab_writer_put_u32(
+    unsigned char* ptr,
+    unsigned long value);
+
+/**
+ * store string with null terminator
+ */
+static unsigned char*
+cab_writer_put_str(
+    unsigned char* ptr,
+    const char* str);
+
+/**
+ * load 32 bit little endian value
+ */
+static unsigned long
+cab_writer_get_u32(
+    const unsigned char* ptr);
+
+/**
+ * create cabinet writer
+ */
+HFCI DIAMONDAPI
+cab_writer_create(
+    PERF erf,
+    PFNFCIFILEPLACED file_placed,
+    PFNFCIALLOC mem_alloc,
+    PFNFCIFREE mem_free,
+    PFNFCIOPEN open_file,
+    PFNFCIREAD read_file,
+    PFNFCIWRITE write_file,
+    PFNFCICLOSE close_file,
+    PFNFCISEEK seek_file,
+    PFNFCIDELETE delete_file,
+    PFNFCIGETTEMPFILE get_temp_file,
+    PCCAB ccab,
+    void* user_data)
+{
+    cab_writer* result;
+    result = NULL;
+    if (erf && file_placed && mem_alloc && mem_free && open_file
+        && read_file && write_file && close_file && seek_file
+        && delete_file && get_temp_file && ccab) {
+        result = (cab_writer*)mem_alloc(sizeof(cab_writer));
+    } else {
+        errno = EINVAL;
+    }
+    if (result) {
+        memset(result, 0, sizeof(*result));
+        result->erf = erf;
+        result->file_placed = file_placed;
+        result->mem_alloc = mem_alloc;
+        result->mem_free = mem_free;
+        result->open_file = open_file;
+        result->read_file = read_file;
+        result->write_file = write_file;
+        result->close_file = close_file;
+        result->seek_file = seek_file;
+        result->delete_file = delete_file;
+        result->get_temp_file = get_temp_file;
+        result->user_data = user_data;
+        result->ccab = *ccab;
+        result->block_buffer = (unsigned char*)mem_alloc(
+            CAB_COMPRESSOR_BLOCK_SIZE);
+        result->data_buffer = (unsigned char*)mem_alloc(
+            CAB_WRITER_CFDATA_SIZE + ccab->cbReserveCFData
+            + CAB_COMPRESSOR_MAX_COMPRESSED_SIZE);
+        result->io_buffer = (unsigned char*)mem_alloc(
+            CAB_WRITER_IO_BUFFER_SIZE);
+        if (!result->block_buffer || !result->data_buffer
+            || !result->io_buffer) {
+            cab_writer_destroy(result);
+            result = NULL;
+        }
+    }
+    if (!result && erf) {
+        erf->erfOper = FCIERR_ALLOC_FAIL;
+        erf->erfType = errno;
+        erf->fError = TRUE;
+    }
+    return (HFCI)result;
+}
+
+
+/**
+ * add a file into cabinet
+ */
+BOOL DIAMONDAPI
+cab_writer_add_file(
+    HFCI hdl,
+    LPSTR source_file,
+    LPSTR file_name,
+    BOOL execute,
+    PFNFCIGETNEXTCABINET get_next_cabinet,
+    PFNFCISTATUS status,
+    PFNFCIGETOPENINFO get_open_info,
+    TCOMP type_compress)
+{
+    int result;
+    cab_writer* obj;
+    intptr_t src_hdl;
+    long src_size;
+    unsigned short date;
+    unsigned short time;
+    unsigned short attribs;
+    obj = (cab_writer*)hdl;
+    src_hdl = -1;
+    src_size = 0;
+    date = 0;
+    time = 0;
+    attribs = 0;
+    if (obj && source_file && file_name && get_next_cabinet
+        && get_open_info) {
+        result = 0;
+        obj->get_next_cabinet = get_next_cabinet;
+        obj->status = status;
+        if (strlen(file_name) >= CB_MAX_FILENAME) {
+            cab_writer_set_error(obj, FCIERR_CAB_FORMAT_LIMIT, ENAMETOOLONG);
+            result = -1;
+        }
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    if (result == 0 && obj->need_next_cab) {
+        CCAB next_ccab;
+        result = cab_writer_get_next_cabinet(obj, &next_ccab, 0);
+        if (result == 0) {
+            cab_writer_move_to_next_cabinet(obj, &next_ccab, 0);
+        }
+    }
+    if (result == 0 && obj->folder_open) {
+        cab_writer_folder* folder;
+        folder = obj->folders[obj->folder_count - 1];
+        if (folder->type_compress != type_compress
+            || (unsigned long)folder->temp_size >= obj->ccab.cbFolderThresh) {
+            result = cab_writer_close_folder(obj);
+        }
+    }
+    if (result == 0) {
+        int err;
+        err = 0;
+        cab_writer_lock(obj);
+        src_hdl = get_open_info(source_file, &date, &time, &attribs,
+            &err, obj->user_data);
+        cab_writer_unlock(obj);
+        if (src_hdl == -1) {
+            cab_writer_set_error(obj, FCIERR_OPEN_SRC, err);
+            result = -1;
+        }
+    }
+    if (result == 0) {
+        int err;
+        err = 0;
+        src_size = obj->seek_file(src_hdl, 0, SEEK_END, &err, obj->user_data);
+        if (src_size != -1) {
+            if (obj->seek_file(src_hdl, 0, SEEK_SET, &err,
+                obj->user_data) == -1) {
+                src_size = -1;
+            }
+        }
+        if (src_size == -1) {
+            cab_writer_set_error(obj, FCIERR_READ_SRC, err);
+            result = -1;
+        }
+    }
+    if (result == 0 && !obj->folder_open) {
+        result = cab_writer_open_folder(obj, type_compress);
+    }
+    if (result == 0) {
+        if (execute) {
+            attribs |= _A_EXEC;
+        }
+        result = cab_writer_add_file_entry(obj, file_name,
+            (unsigned long)src_size, date, time, attribs);
+    }
+    if (result == 0) {
+        if (obj->folders[obj->folder_count - 1]->stored) {
+            result = cab_writer_add_stored_source(obj, source_file,
+                (unsigned long)src_size);
+        } else if (obj->job_folder_open) {
+            result = cab_writer_add_job_source(obj, source_file,
+                (unsigned long)src_size);
+        } else {
+            result = cab_writer_read_source(obj, src_hdl,
+                (unsigned long)src_size);
+        }
+    }
+    if (src_hdl != -1) {
+        int err;
+        err = 0;
+        obj->close_file(src_hdl, &err, obj->user_data);
+    }
+    return result == 0 ? TRUE : FALSE;
+}
+
+/**
+ * complete the current cabinet
+ */
+BOOL DIAMONDAPI
+cab_writer_flush_cabinet(
+    HFCI hdl,
+    BOOL get_next_cab,
+    PFNFCIGETNEXTCABINET get_next_cabinet,
+    PFNFCISTATUS status)
+{
+    int result;
+    cab_writer* obj;
+    CCAB next_ccab;
+    const CCAB* next_ccab_ptr;
+    obj = (cab_writer*)hdl;
+    next_ccab_ptr = NULL;
+    if (obj && get_next_cabinet) {
+        result = 0;
+        obj->get_next_cabinet = get_next_cabinet;
+        obj->status = status;
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    if (result == 0 && obj->folder_open) {
+        result = cab_writer_close_folder(obj);
+    }
+    if (result == 0 && obj->folder_count) {
+        if (get_next_cab) {
+            result = cab_writer_get_next_cabinet(obj, &next_ccab,
+                cab_writer_cabinet_size(obj, obj->folder_count,
+                    obj->folders[obj->folder_count - 1]->block_count, NULL));
+            if (result == 0 && next_ccab.szCab[0]) {
+                next_ccab_ptr = &next_ccab;
+            }
+        }
+        if (result == 0) {
+            result = cab_writer_write_cabinet(obj, obj->folder_count,
+                obj->folders[obj->folder_count - 1]->block_count,
+                next_ccab_ptr);
+        }
+        if (result == 0) {
+            if (next_ccab_ptr) {
+                cab_writer_move_to_next_cabinet(obj, next_ccab_ptr, 1);
+            } else {
+                obj->has_prev = 0;
+                obj->need_next_cab = 1;
+            }
+        }
+    }
+    return result == 0 ? TRUE : FALSE;
+}
+
+/**
+ * complete the current folder and start new folder
+ */
+BOOL DIAMONDAPI
+cab_writer_flush_folder(
+    HFCI hdl,
+    PFNFCIGETNEXTCABINET get_next_cabinet,
+    PFNFCISTATUS status)
+{
+    int result;
+    cab_writer* obj;
+    obj = (cab_writer*)hdl;
+    if (obj && get_next_cabinet) {
+        result = 0;
+        obj->get_next_cabinet = get_next_cabinet;
+        obj->status = status;
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    if (result == 0 && obj->folder_open) {
+        result = cab_writer_close_folder(obj);
+    }
+    return result == 0 ? TRUE : FALSE;
+}
+
+/**
+ * set count of threads which compress scheduled folders.
+ */
+BOOL DIAMONDAPI
+cab_writer_set_jobs(
+    HFCI hdl,
+    unsigned int jobs)
+{
+    int result;
+    cab_writer* obj;
+    obj = (cab_writer*)hdl;
+    if (obj && !obj->pool && !obj->folder_count) {
+        result = 0;
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    if (result == 0 && jobs > 1) {
+        obj->lock = thread_i_mutex_create();
+        obj->job_done = thread_i_cond_create();
+        if (obj->lock && obj->job_done) {
+            obj->pool = worker_pool_create(jobs);
+        }
+        if (!obj->pool) {
+            cab_writer_set_error(obj, FCIERR_ALLOC_FAIL, errno);
+            thread_i_cond_free(obj->job_done);
+            thread_i_mutex_free(obj->lock);
+            obj->job_done = NULL;
+            obj->lock = NULL;
+            result = -1;
+        }
+    }
+    return result == 0 ? TRUE : FALSE;
+}
+
+/**
+ * schedule source files which will be added into a folder.
+ */
+BOOL DIAMONDAPI
+cab_writer_schedule_files(
+    HFCI hdl,
+    LPSTR* source_files,
+    size_t file_count,
+    TCOMP type_compress)
+{
+    int result;
+    cab_writer* obj;
+    cab_writer_job* job;
+    obj = (cab_writer*)hdl;
+    job = NULL;
+    if (obj && (source_files || !file_count)) {
+        result = 0;
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    /* stored files are copied from sources when cabinet is written */
+    if (result == 0 && (obj->pool || obj->folder_cache) && file_count
+        && CompressionTypeFromTCOMP(type_compress) != tcompTYPE_NONE) {
+        job = (cab_writer_job*)obj->mem_alloc(sizeof(cab_writer_job));
+        if (job) {
+            memset(job, 0, sizeof(*job));
+            job->writer = obj;
+            job->type_compress = type_compress;
+            job->folder_threshold = obj->ccab.cbFolderThresh;
+            job->header_size = CAB_WRITER_CFDATA_SIZE
+                + obj->ccab.cbReserveCFData;
+            job->source_files = (char**)obj->mem_alloc(
+                sizeof(char*) * file_count);
+            job->source_sizes = (unsigned long*)obj->mem_alloc(
+                sizeof(unsigned long) * file_count);
+            if (obj->folder_cache) {
+                job->digests = (unsigned char*)obj->mem_alloc(
+                    SHA256_DIGEST_SIZE * file_count);
+            }
+            if (job->source_files && job->source_sizes
+                && (job->digests || !obj->folder_cache)) {
+                memset(job->source_files, 0, sizeof(char*) * file_count);
+                job->source_count = file_count;
+            } else {
+                result = -1;
+            }
+        } else {
+            result = -1;
+        }
+        if (result == 0) {
+            size_t idx;
+            for (idx = 0; idx < file_count; idx++) {
+                size_t path_size;
+                path_size = strlen(source_files[idx]) + 1;
+                job->source_files[idx] = (char*)obj->mem_alloc(path_size);
+                if (!job->source_files[idx]) {
+                    result = -1;
+                    break;
+                }
+                memcpy(job->source_files[idx], source_files[idx], path_size);
+            }
+        }
+        if (result == 0) {
+            if (obj->job_tail) {
+                obj->job_tail->next = job;
+            } else {
+                obj->job_head = job;
+            }
+            obj->job_tail = job;
+            if (!obj->job_pending) {
+                obj->job_pending = job;
+            }
+            job = NULL;
+            result = cab_writer_submit_jobs(obj);
+        } else {
+            cab_writer_set_error(obj, FCIERR_ALLOC_FAIL, errno);
+        }
+    }
+    if (job) {
+        cab_writer_free_job(obj, job);
+    }
+    return result == 0 ? TRUE : FALSE;
+}
+
+/**
+ * set callbacks to compress source files directly from mapped memory.
+ */
+BOOL DIAMONDAPI
+cab_writer_set_source_map(
+    HFCI hdl,
+    PFNCABWRITERMAP map_file,
+    PFNCABWRITERUNMAP unmap_file)
+{
+    int result;
+    cab_writer* obj;
+    obj = (cab_writer*)hdl;
+    if (obj && (map_file ? 1 : 0) == (unmap_file ? 1 : 0)) {
+        obj->map_file = map_file;
+        obj->unmap_file = unmap_file;
+        result = 0;
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result == 0 ? TRUE : FALSE;
+}
+
+/**
+ * set cache which keeps compressed folders across runs.
+ */
+BOOL DIAMONDAPI
+cab_writer_set_folder_cache(
+    HFCI hdl,
+    folder_cache* cache)
+{
+    int result;
+    cab_writer* obj;
+    obj = (cab_writer*)hdl;
+    if (obj && !obj->folder_count && !obj->job_head) {
+        obj->folder_cache = cache;
+        result = 0;
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result == 0 ? TRUE : FALSE;
+}
+
+/**
+ * destroy cabinet writer
+ */
+BOOL DIAMONDAPI
+cab_writer_destroy(
+    HFCI hdl)
+{
+    int result;
+    cab_writer* obj;
+    obj = (cab_writer*)hdl;
+    if (obj) {
+        size_t idx;
+        result = 0;
+        if (obj->pool) {
+            cab_writer_lock(obj);
+            obj->job_cancel = 1;
+            cab_writer_unlock(obj);
+            worker_pool_free(obj->pool);
+            obj->pool = NULL;
+        }
+        while (obj->job_head) {
+            cab_writer_job* job;
+            job = obj->job_head;
+            obj->job_head = job->next;
+            cab_writer_free_job(obj, job);
+        }
+        for (idx = 0; idx < obj->folder_count; idx++) {
+            cab_writer_free_folder(obj, obj->folders[idx]);
+        }
+        if (obj->folders) {
+            obj->mem_free(obj->folders);
+        }
+        if (obj->compressor) {
+            cab_compressor_free(obj->compressor);
+        }
+        if (obj->block_buffer) {
+            obj->mem_free(obj->block_buffer);
+        }
+        if (obj->data_buffer) {
+            obj->mem_free(obj->data_buffer);
+        }
+        if (obj->io_buffer) {
+            obj->mem_free(obj->io_buffer);
+        }
+        thread_i_cond_free(obj->job_done);
+        thread_i_mutex_free(obj->lock);
+        obj->mem_free(obj);
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result == 0 ? TRUE : FALSE;
+}
+
+/**
+ * set error
+ */
+static void
+cab_writer_set_error(
+    cab_writer* obj,
+    int oper,
+    int type)
+{
+    obj->erf->erfOper = oper;
+    obj->erf->erfType = type;
+    obj->erf->fError = TRUE;
+}
+
+/**
+ * grow array
+ */
+static int
+cab_writer_grow(
+    cab_writer* obj,
+    void** array,
+    size_t* capacity,
+    size_t element_size,
+    size_t required)
+{
+    int result;
+    result = cab_writer_grow_array(obj, array, capacity, element_size,
+        required);
+    if (result) {
+        cab_writer_set_error(obj, FCIERR_ALLOC_FAIL, errno);
+    }
+    return result;
+}
+
+/**
+ * grow array without setting error
+ */
+static int
+cab_writer_grow_array(
+    cab_writer* obj,
+    void** array,
+    size_t* capacity,
+    size_t element_size,
+    size_t required)
+{
+    int result;
+    result = 0;
+    if (*capacity < required) {
+        size_t new_capacity;
+        void* new_array;
+        new_capacity = *capacity ? *capacity * 2 : 16;
+        if (new_capacity < required) {
+            new_capacity = required;
+        }
+        new_array = obj->mem_alloc(new_capacity * element_size);
+        result = new_array ? 0 : -1;
+        if (result == 0) {
+            if (*array) {
+                memcpy(new_array, *array, *capacity * element_size);
+                obj->mem_free(*array);
+            }
+            *array = new_array;
+            *capacity = new_capacity;
+        }
+    }
+    return result;
+}
+
+/**
+ * lock callbacks and jobs shared with threads
+ */
+static void
+cab_writer_lock(
+    cab_writer* obj)
+{
+    if (obj->lock) {
+        thread_i_mutex_lock(obj->lock);
+    }
+}
+
+/**
+ * unlock callbacks and jobs shared with threads
+ */
+static void
+cab_writer_unlock(
+    cab_writer* obj)
+{
+    if (obj->lock) {
+        thread_i_mutex_unlock(obj->lock);
+    }
+}
+
+/**
+ * create temporary file
+ */
+static int
+cab_writer_open_temp_file(
+    cab_writer* obj,
+    char* temp_path,
+    int temp_path_size,
+    intptr_t* temp_hdl,
+    int* err)
+{
+    int result;
+    cab_writer_lock(obj);
+    if (obj->get_temp_file(temp_path, temp_path_size, obj->user_data)) {
+        *temp_hdl = obj->open_file(temp_path,
+            O_RDWR | O_CREAT | O_TRUNC | O_BINARY,
+            S_IREAD | S_IWRITE, err, obj->user_data);
+        result = *temp_hdl != -1 ? 0 : -1;
+    } else {
+        *err = errno;
+        temp_path[0] = '\0';
+        result = -1;
+    }
+    cab_writer_unlock(obj);
+    return result;
+}
+
+/**
+ * open new folder
+ */
+static int
+cab_writer_open_folder(
+    cab_writer* obj,
+    TCOMP type_compress)
+{
+    int result;
+    cab_writer_folder* folder;
+    int stored;
+    folder = NULL;
+    result = 0;
+    stored = CompressionTypeFromTCOMP(type_compress) == tcompTYPE_NONE;
+    if (obj->compressor
+        && cab_compressor_get_type(obj->compressor) != type_compress) {
+        cab_compressor_free(obj->compressor);
+        obj->compressor = NULL;
+    }
+    if (!obj->job_head && !stored) {
+        if (!obj->compressor) {
+            obj->compressor = cab_compressor_create(type_compress);
+            if (!obj->compressor) {
+                cab_writer_set_error(obj, FCIERR_BAD_COMPR_TYPE, errno);
+                result = -1;
+            }
+        } else {
+            result = cab_compressor_reset(obj->compressor);
+            if (result) {
+                cab_writer_set_error(obj, FCIERR_MCI_FAIL, errno);
+            }
+        }
+    }
+    if (result == 0) {
+        result = cab_writer_grow(obj, (void**)&obj->folders,
+            &obj->folder_capacity, sizeof(cab_writer_folder*),
+            obj->folder_count + 1);
+    }
+    if (result == 0) {
+        folder = (cab_writer_folder*)obj->mem_alloc(
+            sizeof(cab_writer_folder));
+        if (folder) {
+            memset(folder, 0, sizeof(*folder));
+            folder->type_compress = type_compress;
+            folder->stored = stored;
+            folder->temp_hdl = -1;
+        } else {
+            cab_writer_set_error(obj, FCIERR_ALLOC_FAIL, errno);
+            result = -1;
+        }
+    }
+    if (result == 0 && !stored && obj->job_head) {
+        result = cab_writer_take_job_folder(obj, folder, type_compress);
+    } else if (result == 0 && !stored) {
+        int err;
+        err = 0;
+        result = cab_writer_open_temp_file(obj, folder->temp_path,
+            sizeof(folder->temp_path), &folder->temp_hdl, &err);
+        if (result) {
+            cab_writer_set_error(obj, FCIERR_TEMP_FILE, err);
+        }
+    }
+    if (result == 0 && obj->folder_count
+        && !obj->folders[obj->folder_count - 1]->block_count) {
+        /* zero length files left without data block are carried */
+        result = cab_writer_move_files(obj,
+            obj->folders[obj->folder_count - 1], folder);
+        if (result == 0) {
+            cab_writer_free_folder(obj, obj->folders[--obj->folder_count]);
+        }
+    }
+    if (result == 0) {
+        obj->folders[obj->folder_count++] = folder;
+        obj->folder_open = 1;
+        obj->block_fill = 0;
+        folder = NULL;
+    }
+    if (folder) {
+        cab_writer_free_folder(obj, folder);
+    }
+    return result;
+}
+
+/**
+ * complete the folder in progress
+ */
+static int
+cab_writer_close_folder(
+    cab_writer* obj)
+{
+    int result;
+    result = 0;
+    if (obj->block_fill) {
+        if (obj->folders[obj->folder_count - 1]->stored) {
+            result = cab_writer_emit_stored_block(obj);
+        } else if (obj->job_folder_open) {
+            result = cab_writer_emit_job_block(obj);
+        } else {
+            result = cab_writer_emit_block(obj, obj->block_buffer);
+        }
+    }
+    if (result == 0 && obj->job_folder_open) {
+        result = cab_writer_release_job_folder(obj);
+    }
+    if (result == 0) {
+        cab_writer_folder* folder;
+        obj->folder_open = 0;
+        folder = obj->folders[obj->folder_count - 1];
+        if (!folder->block_count && folder->file_count
+            && obj->folder_count > 1) {
+            /*
+             * folder without data block is not accepted by some readers.
+             * zero length files in it are given to the previous folder.
+             * If there is no previous folder, the folder is kept until
+             * next folder takes them.
+             */
+            result = cab_writer_move_files(obj, folder,
+                obj->folders[obj->folder_count - 2]);
+        }
+        if (result == 0 && !folder->block_count && !folder->file_count) {
+            cab_writer_free_folder(obj, folder);
+            obj->folder_count--;
+        } else if (result == 0) {
+            result = cab_writer_notify_status(obj, statusFolder,
+                (unsigned long)folder->temp_size,
+                cab_writer_folder_uncompressed_end(folder,
+                    folder->block_count));
+        }
+    }
+    if (result == 0) {
+        result = cab_writer_fit_cabinet(obj);
+    }
+    return result;
+}
+
+/**
+ * move file entries of the folder which has no data block into another
+ * folder.
+ */
+static int
+cab_writer_move_files(
+    cab_writer* obj,
+    cab_writer_folder* src_folder,
+    cab_writer_folder* dst_folder)
+{
+    int result;
+    result = cab_writer_grow(obj, (void**)&dst_folder->files,
+        &dst_folder->file_capacity, sizeof(cab_writer_file),
+        dst_folder->file_count + src_folder->file_count);
+    if (result == 0) {
+        unsigned long offset;
+        size_t idx;
+        offset = cab_writer_folder_uncompressed_end(dst_folder,
+            dst_folder->block_count);
+        for (idx = 0; idx < src_folder->file_count; idx++) {
+            cab_writer_file* file;
+            file = &dst_folder->files[dst_folder->file_count++];
+            *file = src_folder->files[idx];
+            file->offset = offset;
+        }
+        dst_folder->file_entry_size += src_folder->file_entry_size;
+        src_folder->file_count = 0;
+        src_folder->file_entry_size = 0;
+    }
+    return result;
+}
+
+/**
+ * free folder
+ */
+static void
+cab_writer_free_folder(
+    cab_writer* obj,
+    cab_writer_folder* folder)
+{
+    size_t idx;
+    int err;
+    err = 0;
+    if (folder->temp_hdl != -1) {
+        obj->close_file(folder->temp_hdl, &err, obj->user_data);
+        cab_writer_lock(obj);
+        obj->delete_file(folder->temp_path, &err, obj->user_data);
+        cab_writer_unlock(obj);
+    }
+    for (idx = 0; idx < folder->file_count; idx++) {
+        obj->mem_free(folder->files[idx].name);
+        if (folder->files[idx].source_path) {
+            obj->mem_free(folder->files[idx].source_path);
+        }
+    }
+    if (folder->files) {
+        obj->mem_free(folder->files);
+    }
+    if (folder->blocks) {
+        obj->mem_free(folder->blocks);
+    }
+    obj->mem_free(folder);
+}
+
+/**
+ * add file entry into the folder in progress
+ */
+static int
+cab_writer_add_file_entry(
+    cab_writer* obj,
+    const char* file_name,
+    unsigned long size,
+    unsigned short date,
+    unsigned short time,
+    unsigned short attribs)
+{
+    int result;
+    cab_writer_folder* folder;
+    size_t name_size;
+    char* name;
+    folder = obj->folders[obj->folder_count - 1];
+    name_size = strlen(file_name) + 1;
+    name = NULL;
+    result = cab_writer_grow(obj, (void**)&folder->files,
+        &folder->file_capacity, sizeof(cab_writer_file),
+        folder->file_count + 1);
+    if (result == 0) {
+        name = (char*)obj->mem_alloc(name_size);
+        if (name) {
+            memcpy(name, file_name, name_size);
+        } else {
+            cab_writer_set_error(obj, FCIERR_ALLOC_FAIL, errno);
+            result = -1;
+        }
+    }
+    if (result == 0) {
+        cab_writer_file* file;
+        file = &folder->files[folder->file_count++];
+        file->name = name;
+        file->size = size;
+        file->offset = cab_writer_folder_uncompressed_end(
+            folder, folder->block_count) + obj->block_fill;
+        file->date = date;
+        file->time = time;
+        file->attribs = attribs;
+        file->source_path = NULL;
+        folder->file_entry_size += CAB_WRITER_CFFILE_SIZE + name_size;
+    }
+    return result;
+}
+
+/**
+ * read source file into folder
+ */
+static int
+cab_writer_read_source(
+    cab_writer* obj,
+    intptr_t src_hdl,
+    unsigned long size)
+{
+    int result;
+    unsigned long remaining;
+    const unsigned char* data;
+    int err;
+    result = 0;
+    data = NULL;
+    err = 0;
+    if (obj->map_file && size) {
+        data = (const unsigned char*)obj->map_file(src_hdl, size, &err,
+            obj->user_data);
+    }
+    if (data) {
+        result = cab_writer_add_mapped_source(obj, data, size);
+        obj->unmap_file(data, size, &err, obj->user_data);
+    }
+    remaining = data ? 0 : size;
+    while (result == 0 && remaining) {
+        unsigned int read_size;
+        unsigned int request_size;
+        err = 0;
+        request_size = CAB_COMPRESSOR_BLOCK_SIZE - obj->block_fill;
+        if (request_size > remaining) {
+            request_size = (unsigned int)remaining;
+        }
+        read_size = obj->read_file(src_hdl,
+            obj->block_buffer + obj->block_fill, request_size,
+            &err, obj->user_data);
+        if (read_size == (unsigned int)-1 || read_size == 0) {
+            cab_writer_set_error(obj, FCIERR_READ_SRC, err);
+            result = -1;
+        }
+        if (result == 0) {
+            obj->block_fill += read_size;
+            remaining -= read_size;
+            if (obj->block_fill == CAB_COMPRESSOR_BLOCK_SIZE) {
+                result = cab_writer_emit_block(obj, obj->block_buffer);
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ * compress mapped source file into folder in progress.
+ * The whole blocks in the mapped memory are compressed without copying,
+ * and only the parts across the block boundaries go through block buffer.
+ */
+static int
+cab_writer_add_mapped_source(
+    cab_writer* obj,
+    const unsigned char* data,
+    unsigned long size)
+{
+    int result;
+    unsigned long offset;
+    result = 0;
+    offset = 0;
+    while (result == 0 && offset < size) {
+        unsigned long remaining;
+        remaining = size - offset;
+        if (!obj->block_fill && remaining >= CAB_COMPRESSOR_BLOCK_SIZE) {
+            obj->block_fill = CAB_COMPRESSOR_BLOCK_SIZE;
+            result = cab_writer_emit_block(obj, data + offset);
+            offset += CAB_COMPRESSOR_BLOCK_SIZE;
+        } else {
+            unsigned int copy_size;
+            copy_size = CAB_COMPRESSOR_BLOCK_SIZE - obj->block_fill;
+            if (copy_size > remaining) {
+                copy_size = (unsigned int)remaining;
+            }
+            memcpy(obj->block_buffer + obj->block_fill, data + offset,
+                copy_size);
+            obj->block_fill += copy_size;
+            offset += copy_size;
+            if (obj->block_fill == CAB_COMPRESSOR_BLOCK_SIZE) {
+                result = cab_writer_emit_block(obj, obj->block_buffer);
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ * compress a block and append it into folder in progress
+ */
+static int
+cab_writer_emit_block(
+    cab_writer* obj,
+    const unsigned char* src)
+{
+    int result;
+    cab_writer_folder* folder;
+    unsigned int data_size;
+    folder = obj->folders[obj->folder_count - 1];
+    data_size = 0;
+    result = cab_writer_build_block(obj->compressor,
+        src, obj->block_fill, obj->data_buffer,
+        CAB_WRITER_CFDATA_SIZE + obj->ccab.cbReserveCFData, &data_size);
+    if (result) {
+        cab_writer_set_error(obj, FCIERR_MCI_FAIL, errno);
+    }
+    if (result == 0 && folder->temp_position != folder->temp_size) {
+        int err;
+        err = 0;
+        if (obj->seek_file(folder->temp_hdl, folder->temp_size, SEEK_SET,
+            &err, obj->user_data) == -1) {
+            cab_writer_set_error(obj, FCIERR_TEMP_FILE, err);
+            result = -1;
+        } else {
+            folder->temp_position = folder->temp_size;
+        }
+    }
+    if (result == 0) {
+        int err;
+        unsigned int written_size;
+        err = 0;
+        written_size = obj->write_file(folder->temp_hdl, obj->data_buffer,
+            data_size, &err, obj->user_data);
+        if (written_size != data_size) {
+            cab_writer_set_error(obj, FCIERR_TEMP_FILE, err);
+            result = -1;
+        }
+    }
+    if (result == 0) {
+        folder->temp_position += data_size;
+        result = cab_writer_append_block(obj, data_size);
+    }
+    return result;
+}
+
+/**
+ * add source file into stored folder in progress without reading it.
+ * Only the sizes of data blocks are recorded, and the data is copied from
+ * the source file when cabinet is written.
+ */
+static int
+cab_writer_add_stored_source(
+    cab_writer* obj,
+    const char* source_file,
+    unsigned long size)
+{
+    int result;
+    cab_writer_folder* folder;
+    size_t path_size;
+    char* source_path;
+    unsigned long remaining;
+    folder = obj->folders[obj->folder_count - 1];
+    path_size = strlen(source_file) + 1;
+    source_path = (char*)obj->mem_alloc(path_size);
+    if (source_path) {
+        memcpy(source_path, source_file, path_size);
+        folder->files[folder->file_count - 1].source_path = source_path;
+        result = 0;
+    } else {
+        cab_writer_set_error(obj, FCIERR_ALLOC_FAIL, errno);
+        result = -1;
+    }
+    remaining = size;
+    while (result == 0 && remaining) {
+        unsigned int fill_size;
+        fill_size = CAB_COMPRESSOR_BLOCK_SIZE - obj->block_fill;
+        if (fill_size > remaining) {
+            fill_size = (unsigned int)remaining;
+        }
+        obj->block_fill += fill_size;
+        remaining -= fill_size;
+        if (obj->block_fill == CAB_COMPRESSOR_BLOCK_SIZE) {
+            result = cab_writer_emit_stored_block(obj);
+        }
+    }
+    return result;
+}
+
+/**
+ * append data block stored from source files into folder in progress
+ */
+static int
+cab_writer_emit_stored_block(
+    cab_writer* obj)
+{
+    return cab_writer_append_block(obj, CAB_WRITER_CFDATA_SIZE
+        + obj->ccab.cbReserveCFData + obj->block_fill);
+}
+
+/**
+ * compress data into CFDATA
+ */
+static int
+cab_writer_build_block(
+    cab_compressor* compressor,
+    const unsigned char* src,
+    unsigned int src_size,
+    unsigned char* data_buffer,
+    unsigned int header_size,
+    unsigned int* data_size)
+{
+    int result;
+    unsigned int compressed_size;
+    compressed_size = 0;
+    result = cab_compressor_compress(compressor, src, src_size,
+        data_buffer + header_size, &compressed_size);
+    if (result == 0) {
+        unsigned char* ptr;
+        ptr = cab_writer_put_u32(data_buffer,
+            cab_checksum_cfdata(data_buffer + header_size,
+                compressed_size, src_size));
+        ptr = cab_writer_put_u16(ptr, compressed_size);
+        ptr = cab_writer_put_u16(ptr, src_size);
+        memset(ptr, 0, header_size - CAB_WRITER_CFDATA_SIZE);
+        *data_size = header_size + compressed_size;
+    }
+    return result;
+}
+
+/**
+ * append CFDATA written in temporary file into folder in progress
+ */
+static int
+cab_writer_append_block(
+    cab_writer* obj,
+    unsigned int data_size)
+{
+    int result;
+    cab_writer_folder* folder;
+    unsigned int uncompressed_size;
+    folder = obj->folders[obj->folder_count - 1];
+    uncompressed_size = obj->block_fill;
+    result = 0;
+    if (folder->block_count - folder->block_start >= CAB_WRITER_MAX_COUNT) {
+        cab_writer_set_error(obj, FCIERR_CAB_FORMAT_LIMIT, EFBIG);
+        result = -1;
+    }
+    if (result == 0) {
+        result = cab_writer_grow(obj, (void**)&folder->blocks,
+            &folder->block_capacity, sizeof(cab_writer_block),
+            folder->block_count + 1);
+    }
+    if (result == 0) {
+        cab_writer_block* block;
+        block = &folder->blocks[folder->block_count];
+        folder->temp_size += data_size;
+        block->data_end = folder->temp_size;
+        block->uncompressed_end = cab_writer_folder_uncompressed_end(
+            folder, folder->block_count) + uncompressed_size;
+        folder->block_count++;
+        obj->block_fill = 0;
+        result = cab_writer_notify_status(obj, statusFile,
+            data_size - CAB_WRITER_CFDATA_SIZE - obj->ccab.cbReserveCFData,
+            uncompressed_size);
+    }
+    if (result == 0) {
+        result = cab_writer_fit_cabinet(obj);
+    }
+    return result;
+}
+
+/**
+ * take the next folder in the first job for folder in progress
+ */
+static int
+cab_writer_take_job_folder(
+    cab_writer* obj,
+    cab_writer_folder* folder,
+    TCOMP type_compress)
+{
+    int result;
+    cab_writer_job* job;
+    job = obj->job_head;
+    result = cab_writer_wait_job(obj, job);
+    if (result == 0) {
+        if (job->type_compress != type_compress
+            || job->folder_index >= job->folder_count) {
+            cab_writer_set_error(obj, FCIERR_USER_ABORT, EINVAL);
+            result = -1;
+        }
+    }
+    if (result == 0) {
+        cab_writer_job_folder* job_folder;
+        job_folder = &job->folders[job->folder_index];
+        memcpy(folder->temp_path, job_folder->temp_path,
+            sizeof(folder->temp_path));
+        folder->temp_hdl = job_folder->temp_hdl;
+        folder->temp_position = job_folder->temp_size;
+        job_folder->temp_hdl = -1;
+        job_folder->temp_path[0] = '\0';
+        job->block_index = 0;
+        obj->job_folder_open = 1;
+    }
+    return result;
+}
+
+/**
+ * add source file compressed by the first job into folder
+ */
+static int
+cab_writer_add_job_source(
+    cab_writer* obj,
+    const char* source_file,
+    unsigned long size)
+{
+    int result;
+    cab_writer_job* job;
+    unsigned long remaining;
+    job = obj->job_head;
+    result = 0;
+    if (job->source_index >= job->folders[job->folder_index].file_end
+        || strcmp(job->source_files[job->source_index], source_file)
+        || job->source_sizes[job->source_index] != size) {
+        cab_writer_set_error(obj, FCIERR_USER_ABORT, EINVAL);
+        result = -1;
+    }
+    if (result == 0) {
+        job->source_index++;
+    }
+    remaining = size;
+    while (result == 0 && remaining) {
+        unsigned int fill_size;
+        fill_size = CAB_COMPRESSOR_BLOCK_SIZE - obj->block_fill;
+        if (fill_size > remaining) {
+            fill_size = (unsigned int)remaining;
+        }
+        obj->block_fill += fill_size;
+        remaining -= fill_size;
+        if (obj->block_fill == CAB_COMPRESSOR_BLOCK_SIZE) {
+            result = cab_writer_emit_job_block(obj);
+        }
+    }
+    return result;
+}
+
+/**
+ * append data block compressed by the first job into folder in progress
+ */
+static int
+cab_writer_emit_job_block(
+    cab_writer* obj)
+{
+    int result;
+    cab_writer_job* job;
+    cab_writer_job_folder* job_folder;
+    long data_start;
+    unsigned long uncompressed_start;
+    job = obj->job_head;
+    job_folder = &job->folders[job->folder_index];
+    data_start = 0;
+    uncompressed_start = 0;
+    result = 0;
+    if (job->block_index < job_folder->block_count) {
+        if (job->block_index) {
+            data_start = job_folder->blocks[job->block_index - 1].data_end;
+            uncompressed_start =
+                job_folder->blocks[job->block_index - 1].uncompressed_end;
+        }
+        if (job_folder->blocks[job->block_index].uncompressed_end
+            - uncompressed_start != obj->block_fill) {
+            result = -1;
+        }
+    } else {
+        result = -1;
+    }
+    if (result == 0) {
+        unsigned int data_size;
+        data_size = (unsigned int)(
+            job_folder->blocks[job->block_index].data_end - data_start);
+        job->block_index++;
+        result = cab_writer_append_block(obj, data_size);
+    } else {
+        cab_writer_set_error(obj, FCIERR_USER_ABORT, EINVAL);
+    }
+    return result;
+}
+
+/**
+ * complete the folder taken from the first job
+ */
+static int
+cab_writer_release_job_folder(
+    cab_writer* obj)
+{
+    int result;
+    cab_writer_job* job;
+    cab_writer_job_folder* job_folder;
+    job = obj->job_head;
+    job_folder = &job->folders[job->folder_index];
+    obj->job_folder_open = 0;
+    if (job->block_index == job_folder->block_count
+        && job->source_index == job_folder->file_end) {
+        result = 0;
+        job->folder_index++;
+    } else {
+        cab_writer_set_error(obj, FCIERR_USER_ABORT, EINVAL);
+        result = -1;
+    }
+    if (result == 0 && job->folder_index == job->folder_count) {
+        obj->job_head = job->next;
+        if (!obj->job_head) {
+            obj->job_tail = NULL;
+        }
+        cab_writer_free_job(obj, job);
+        obj->job_running_count--;
+        result = cab_writer_submit_jobs(obj);
+    }
+    return result;
+}
+
+/**
+ * wait for the job to be completed
+ */
+static int
+cab_writer_wait_job(
+    cab_writer* obj,
+    cab_writer_job* job)
+{
+    int result;
+    if (!obj->pool && !job->done) {
+        /* the job runs in calling thread if the writer has no threads */
+        if (obj->job_pending == job) {
+            obj->job_pending = job->next;
+        }
+        obj->job_running_count++;
+        cab_writer_job_run(job);
+    }
+    cab_writer_lock(obj);
+    while (!job->done) {
+        thread_i_cond_wait(obj->job_done, obj->lock);
+    }
+    cab_writer_unlock(obj);
+    if (job->erf.fError) {
+        cab_writer_set_error(obj, job->erf.erfOper, job->erf.erfType);
+        result = -1;
+    } else {
+        result = 0;
+    }
+    return result;
+}
+
+/**
+ * submit pending jobs to threads
+ */
+static int
+cab_writer_submit_jobs(
+    cab_writer* obj)
+{
+    int result;
+    size_t running_limit;
+    result = 0;
+    running_limit = obj->pool ?
+        (size_t)worker_pool_get_thread_count(obj->pool)
+        * CAB_WRITER_JOB_LOOKAHEAD : 0;
+    while (result == 0 && obj->job_pending
+        && obj->job_running_count < running_limit) {
+        result = worker_pool_submit(obj->pool, cab_writer_job_run,
+            obj->job_pending);
+        if (result == 0) {
+            obj->job_pending = obj->job_pending->next;
+            obj->job_running_count++;
+        } else {
+            cab_writer_set_error(obj, FCIERR_ALLOC_FAIL, errno);
+        }
+    }
+    return result;
+}
+
+/**
+ * free job
+ */
+static void
+cab_writer_free_job(
+    cab_writer* obj,
+    cab_writer_job* job)
+{
+    size_t idx;
+    int err;
+    err = 0;
+    for (idx = 0; idx < job->folder_count; idx++) {
+        cab_writer_job_folder* job_folder;
+        job_folder = &job->folders[idx];
+        if (job_folder->temp_hdl != -1) {
+            obj->close_file(job_folder->temp_hdl, &err, obj->user_data);
+        }
+        if (job_folder->temp_path[0]) {
+            cab_writer_lock(obj);
+            obj->delete_file(job_folder->temp_path, &err, obj->user_data);
+            cab_writer_unlock(obj);
+        }
+        if (job_folder->blocks) {
+            obj->mem_free(job_folder->blocks);
+        }
+    }
+    if (job->folders) {
+        obj->mem_free(job->folders);
+    }
+    if (job->source_files) {
+        for (idx = 0; idx < job->source_count; idx++) {
+            if (job->source_files[idx]) {
+                obj->mem_free(job->source_files[idx]);
+            }
+        }
+        obj->mem_free(job->source_files);
+    }
+    if (job->source_sizes) {
+        obj->mem_free(job->source_sizes);
+    }
+    if (job->digests) {
+        obj->mem_free(job->digests);
+    }
+    obj->mem_free(job);
+}
+
+/**
+ * compress scheduled files in a thread.
+ * The files are split into folders at the same points as adding them one
+ * by one, so that the writer can emit the data blocks in the same order.
+ * If the writer has folder cache, each folder is copied from the cache when
+ * the cache has the folder starting at the same source contents, and the
+ * compressed folders are stored into the cache.
+ */
+static void
+cab_writer_job_run(
+    void* arg)
+{
+    int result;
+    cab_writer_job* job;
+    cab_writer* obj;
+    cab_compressor* compressor;
+    unsigned char* block_buffer;
+    unsigned char* data_buffer;
+    unsigned int block_fill;
+    size_t folder_start;
+    size_t idx;
+    job = (cab_writer_job*)arg;
+    obj = job->writer;
+    compressor = NULL;
+    block_fill = 0;
+    folder_start = 0;
+    block_buffer = (unsigned char*)obj->mem_alloc(CAB_COMPRESSOR_BLOCK_SIZE);
+    data_buffer = (unsigned char*)obj->mem_alloc(
+        job->header_size + CAB_COMPRESSOR_MAX_COMPRESSED_SIZE);
+    result = block_buffer && data_buffer ? 0 : -1;
+    if (result) {
+        cab_writer_job_set_error(job, FCIERR_ALLOC_FAIL, errno);
+    }
+    if (result == 0 && cab_writer_job_is_cancelled(job)) {
+        cab_writer_job_set_error(job, FCIERR_USER_ABORT, 0);
+        result = -1;
+    }
+    if (result == 0) {
+        compressor = cab_compressor_create(job->type_compress);
+        if (!compressor) {
+            cab_writer_job_set_error(job, FCIERR_BAD_COMPR_TYPE, errno);
+            result = -1;
+        }
+    }
+    if (result == 0 && job->digests) {
+        result = cab_writer_job_digest_sources(job, block_buffer);
+    }
+    if (result == 0) {
+        result = cab_writer_job_open_folder(job);
+    }
+    idx = 0;
+    while (result == 0 && idx < job->source_count) {
+        cab_writer_job_folder* job_folder;
+        job_folder = &job->folders[job->folder_count - 1];
+        if (idx != folder_start && (unsigned long)job_folder->temp_size
+            >= job->folder_threshold) {
+            if (block_fill) {
+                result = cab_writer_job_write_block(job, compressor,
+                    block_buffer, block_fill, data_buffer);
+                block_fill = 0;
+            }
+            if (result == 0) {
+                job_folder->file_end = idx;
+                if (job->digests && !job_folder->cached) {
+                    cab_writer_job_store_folder(job, folder_start,
+                        data_buffer);
+                }
+                folder_start = idx;
+                result = cab_writer_job_open_folder(job);
+            }
+            if (result == 0) {
+                result = cab_compressor_reset(compressor);
+                if (result) {
+                    cab_writer_job_set_error(job, FCIERR_MCI_FAIL, errno);
+                }
+            }
+        }
+        if (result == 0 && cab_writer_job_is_cancelled(job)) {
+            cab_writer_job_set_error(job, FCIERR_USER_ABORT, 0);
+            result = -1;
+        }
+        if (result == 0 && idx == folder_start && job->digests) {
+            int state;
+            state = cab_writer_job_load_folder(job, idx, data_buffer);
+            if (state > 0) {
+                idx = job->folders[job->folder_count - 1].file_end;
+                continue;
+            }
+            result = state;
+        }
+        if (result == 0) {
+            result = cab_writer_job_read_source(job, idx, compressor,
+                block_buffer, &block_fill, data_buffer);
+        }
+        idx++;
+    }
+    if (result == 0 && block_fill) {
+        result = cab_writer_job_write_block(job, compressor,
+            block_buffer, block_fill, data_buffer);
+    }
+    if (result == 0) {
+        cab_writer_job_folder* job_folder;
+        job_folder = &job->folders[job->folder_count - 1];
+        job_folder->file_end = job->source_count;
+        if (job->digests && !job_folder->cached) {
+            cab_writer_job_store_folder(job, folder_start, data_buffer);
+        }
+    }
+    if (compressor) {
+        cab_compressor_free(compressor);
+    }
+    if (block_buffer) {
+        obj->mem_free(block_buffer);
+    }
+    if (data_buffer) {
+        obj->mem_free(data_buffer);
+    }
+    cab_writer_lock(obj);
+    job->done = 1;
+    if (obj->job_done) {
+        thread_i_cond_broadcast(obj->job_done);
+    }
+    cab_writer_unlock(obj);
+}
+
+/**
+ * start new folder in the job
+ */
+static int
+cab_writer_job_open_folder(
+    cab_writer_job* job)
+{
+    int result;
+    cab_writer* obj;
+    obj = job->writer;
+    result = cab_writer_grow_array(obj, (void**)&job->folders,
+        &job->folder_capacity, sizeof(cab_writer_job_folder),
+        job->folder_count + 1);
+    if (result) {
+        cab_writer_job_set_error(job, FCIERR_ALLOC_FAIL, errno);
+    }
+    if (result == 0) {
+        cab_writer_job_folder* job_folder;
+        int err;
+        err = 0;
+        job_folder = &job->folders[job->folder_count++];
+        memset(job_folder, 0, sizeof(*job_folder));
+        job_folder->temp_hdl = -1;
+        result = cab_writer_open_temp_file(obj, job_folder->temp_path,
+            sizeof(job_folder->temp_path), &job_folder->temp_hdl, &err);
+        if (result) {
+            cab_writer_job_set_error(job, FCIERR_TEMP_FILE, err);
+        }
+    }
+    return result;
+}
+
+/**
+ * open a source file in the job and get its size
+ */
+static int
+cab_writer_job_open_source(
+    cab_writer_job* job,
+    size_t source_index,
+    intptr_t* src_hdl,
+    long* src_size)
+{
+    int result;
+    cab_writer* obj;
+    int err;
+    obj = job->writer;
+    err = 0;
+    *src_size = -1;
+    cab_writer_lock(obj);
+    *src_hdl = obj->open_file(job->source_files[source_index],
+        O_RDONLY | O_BINARY, 0, &err, obj->user_data);
+    cab_writer_unlock(obj);
+    if (*src_hdl != -1) {
+        result = 0;
+    } else {
+        cab_writer_job_set_error(job, FCIERR_OPEN_SRC, err);
+        result = -1;
+    }
+    if (result == 0) {
+        *src_size = obj->seek_file(*src_hdl, 0, SEEK_END, &err,
+            obj->user_data);
+        if (*src_size != -1) {
+            if (obj->seek_file(*src_hdl, 0, SEEK_SET, &err,
+                obj->user_data) == -1) {
+                *src_size = -1;
+            }
+        }
+        if (*src_size == -1) {
+            cab_writer_job_set_error(job, FCIERR_READ_SRC, err);
+            result = -1;
+        }
+    }
+    if (result == 0) {
+        job->source_sizes[source_index] = (unsigned long)*src_size;
+    }
+    return result;
+}
+
+/**
+ * read a source file and compress it into the last folder in the job
+ */
+static int
+cab_writer_job_read_source(
+    cab_writer_job* job,
+    size_t source_index,
+    cab_compressor* compressor,
+    unsigned char* block_buffer,
+    unsigned int* block_fill,
+    unsigned char* data_buffer)
+{
+    int result;
+    cab_writer* obj;
+    intptr_t src_hdl;
+    long src_size;
+    unsigned long remaining;
+    const unsigned char* data;
+    int err;
+    obj = job->writer;
+    err = 0;
+    data = NULL;
+    result = cab_writer_job_open_source(job, source_index,
+        &src_hdl, &src_size);
+    if (result == 0 && obj->map_file && src_size) {
+        data = (const unsigned char*)obj->map_file(src_hdl,
+            (unsigned long)src_size, &err, obj->user_data);
+    }
+    remaining = result == 0 ? (unsigned long)src_size : 0;
+    while (result == 0 && remaining) {
+        unsigned int read_size;
+        unsigned int request_size;
+        request_size = CAB_COMPRESSOR_BLOCK_SIZE - *block_fill;
+        if (request_size > remaining) {
+            request_size = (unsigned int)remaining;
+        }
+        if (data && request_size == CAB_COMPRESSOR_BLOCK_SIZE) {
+            result = cab_writer_job_write_block(job, compressor,
+                data + (src_size - remaining), request_size, data_buffer);
+            read_size = request_size;
+        } else {
+            if (data) {
+                memcpy(block_buffer + *block_fill,
+                    data + (src_size - remaining), request_size);
+                read_size = request_size;
+            } else {
+                read_size = obj->read_file(src_hdl,
+                    block_buffer + *block_fill, request_size,
+                    &err, obj->user_data);
+            }
+            if (read_size == (unsigned int)-1 || read_size == 0) {
+                cab_writer_job_set_error(job, FCIERR_READ_SRC, err);
+                result = -1;
+            }
+            if (result == 0) {
+                *block_fill += read_size;
+            }
+            if (result == 0 && *block_fill == CAB_COMPRESSOR_BLOCK_SIZE) {
+                result = cab_writer_job_write_block(job, compressor,
+                    block_buffer, *block_fill, data_buffer);
+                *block_fill = 0;
+            }
+        }
+        if (result == 0) {
+            remaining -= read_size;
+        }
+    }
+    if (data) {
+        obj->unmap_file(data, (unsigned long)src_size, &err,
+            obj->user_data);
+    }
+    if (src_hdl != -1) {
+        obj->close_file(src_hdl, &err, obj->user_data);
+    }
+    return result;
+}
+
+/**
+ * compress block buffer into the last folder in the job
+ */
+static int
+cab_writer_job_write_block(
+    cab_writer_job* job,
+    cab_compressor* compressor,
+    const unsigned char* block_buffer,
+    unsigned int block_fill,
+    unsigned char* data_buffer)
+{
+    int result;
+    cab_writer* obj;
+    cab_writer_job_folder* job_folder;
+    unsigned int data_size;
+    obj = job->writer;
+    job_folder = &job->folders[job->folder_count - 1];
+    data_size = 0;
+    result = cab_writer_grow_array(obj, (void**)&job_folder->blocks,
+        &job_folder->block_capacity, sizeof(cab_writer_block),
+        job_folder->block_count + 1);
+    if (result) {
+        cab_writer_job_set_error(job, FCIERR_ALLOC_FAIL, errno);
+    }
+    if (result == 0) {
+        result = cab_writer_build_block(compressor, block_buffer,
+            block_fill, data_buffer, job->header_size, &data_size);
+        if (result) {
+            cab_writer_job_set_error(job, FCIERR_MCI_FAIL, errno);
+        }
+    }
+    if (result == 0) {
+        int err;
+        err = 0;
+        if (obj->write_file(job_folder->temp_hdl, data_buffer, data_size,
+            &err, obj->user_data) != data_size) {
+            cab_writer_job_set_error(job, FCIERR_TEMP_FILE, err);
+            result = -1;
+        }
+    }
+    if (result == 0) {
+        cab_writer_block* block;
+        unsigned long uncompressed_start;
+        uncompressed_start = job_folder->block_count ?
+            job_folder->blocks[job_folder->block_count - 1].uncompressed_end
+            : 0;
+        block = &job_folder->blocks[job_folder->block_count++];
+        job_folder->temp_size += data_size;
+        block->data_end = job_folder->temp_size;
+        block->uncompressed_end = uncompressed_start + block_fill;
+    }
+    return result;
+}
+
+/**
+ * calculate digests of all source files in the job
+ */
+static int
+cab_writer_job_digest_sources(
+    cab_writer_job* job,
+    unsigned char* block_buffer)
+{
+    int result;
+    cab_writer* obj;
+    size_t idx;
+    obj = job->writer;
+    result = 0;
+    for (idx = 0; result == 0 && idx < job->source_count; idx++) {
+        sha256_context ctx;
+        intptr_t src_hdl;
+        long src_size;
+        const unsigned char* data;
+        int err;
+        err = 0;
+        data = NULL;
+        sha256_init(&ctx);
+        if (cab_writer_job_is_cancelled(job)) {
+            cab_writer_job_set_error(job, FCIERR_USER_ABORT, 0);
+            result = -1;
+            break;
+        }
+        result = cab_writer_job_open_source(job, idx, &src_hdl, &src_size);
+        if (result == 0 && obj->map_file && src_size) {
+            data = (const unsigned char*)obj->map_file(src_hdl,
+                (unsigned long)src_size, &err, obj->user_data);
+        }
+        if (data) {
+            sha256_update(&ctx, data, (size_t)src_size);
+            obj->unmap_file(data, (unsigned long)src_size, &err,
+                obj->user_data);
+        } else if (result == 0) {
+            unsigned long remaining;
+            remaining = (unsigned long)src_size;
+            while (remaining) {
+                unsigned int read_size;
+                unsigned int request_size;
+                request_size = CAB_COMPRESSOR_BLOCK_SIZE;
+                if (request_size > remaining) {
+                    request_size = (unsigned int)remaining;
+                }
+                read_size = obj->read_file(src_hdl, block_buffer,
+                    request_size, &err, obj->user_data);
+                if (read_size == (unsigned int)-1 || read_size == 0) {
+                    cab_writer_job_set_error(job, FCIERR_READ_SRC, err);
+                    result = -1;
+                    break;
+                }
+                sha256_update(&ctx, block_buffer, read_size);
+                remaining -= read_size;
+            }
+        }
+        if (result == 0) {
+            sha256_final(&ctx, job->digests + idx * SHA256_DIGEST_SIZE);
+        }
+        if (src_hdl != -1) {
+            obj->close_file(src_hdl, &err, obj->user_data);
+        }
+    }
+    return result;
+}
+
+/**
+ * get folder cache key for the folder starting at the source file.
+ * The key covers the compression type with compressor options, the folder
+ * threshold and CFDATA header size which decide the data blocks, and the
+ * contents of the first source file. The rest of source files are compared
+ * with the digests in the entry.
+ */
+static void
+cab_writer_job_get_cache_key(
+    cab_writer_job* job,
+    size_t source_index,
+    unsigned char* key)
+{
+    sha256_context ctx;
+    unsigned char params[12];
+    unsigned char* ptr;
+    ptr = cab_writer_put_u32(params, job->type_compress);
+    ptr = cab_writer_put_u32(ptr, job->folder_threshold);
+    cab_writer_put_u32(ptr, job->header_size);
+    sha256_init(&ctx);
+    sha256_update(&ctx, CAB_WRITER_CACHE_SIGNATURE,
+        sizeof(CAB_WRITER_CACHE_SIGNATURE) - 1);
+    sha256_update(&ctx, params, sizeof(params));
+    sha256_update(&ctx, job->digests + source_index * SHA256_DIGEST_SIZE,
+        SHA256_DIGEST_SIZE);
+    sha256_final(&ctx, key);
+}
+
+/**
+ * copy the folder starting at the source file from folder cache into the
+ * last folder in the job.
+ * The entry is used only if it has the same source contents, and if the
+ * folder reached the folder threshold or ends at the last source file,
+ * so that the job splits the folders at the same points as compressing.
+ */
+static int
+cab_writer_job_load_folder(
+    cab_writer_job* job,
+    size_t source_index,
+    unsigned char* data_buffer)
+{
+    int result;
+    cab_writer* obj;
+    cab_writer_job_folder* job_folder;
+    unsigned char key[SHA256_DIGEST_SIZE];
+    unsigned char header[CAB_WRITER_CACHE_HEADER_SIZE];
+    FILE* stream;
+    size_t file_count;
+    size_t block_count;
+    size_t idx;
+    unsigned long uncompressed_size;
+    long data_end;
+    int written;
+    obj = job->writer;
+    job_folder = &job->folders[job->folder_count - 1];
+    file_count = 0;
+    block_count = 0;
+    uncompressed_size = 0;
+    data_end = 0;
+    written = 0;
+    cab_writer_job_get_cache_key(job, source_index, key);
+    stream = folder_cache_open(obj->folder_cache, key, sizeof(key));
+    result = stream ? 1 : 0;
+    if (result > 0) {
+        if (fread(header, 1, sizeof(header), stream) == sizeof(header)
+            && memcmp(header, CAB_WRITER_CACHE_SIGNATURE,
+                sizeof(CAB_WRITER_CACHE_SIGNATURE) - 1) == 0) {
+            file_count = (size_t)cab_writer_get_u32(header + 8);
+            block_count = (size_t)cab_writer_get_u32(header + 12);
+        }
+        if (!file_count || file_count > job->source_count - source_index
+            || block_count > CAB_WRITER_MAX_COUNT) {
+            result = 0;
+        }
+    }
+    for (idx = 0; result > 0 && idx < file_count; idx++) {
+        unsigned char digest[SHA256_DIGEST_SIZE];
+        if (fread(digest, 1, sizeof(digest), stream) != sizeof(digest)
+            || memcmp(digest, job->digests
+                + (source_index + idx) * SHA256_DIGEST_SIZE,
+                sizeof(digest))) {
+            result = 0;
+        }
+        uncompressed_size += job->source_sizes[source_index + idx];
+    }
+    if (result > 0 && block_count) {
+        if (cab_writer_grow_array(obj, (void**)&job_folder->blocks,
+            &job_folder->block_capacity, sizeof(cab_writer_block),
+            block_count)) {
+            cab_writer_job_set_error(job, FCIERR_ALLOC_FAIL, errno);
+            result = -1;
+        }
+    }
+    for (idx = 0; result > 0 && idx < block_count; idx++) {
+        unsigned char record[CAB_WRITER_CACHE_BLOCK_SIZE];
+        unsigned long data_size;
+        unsigned long block_size;
+        cab_writer_block* block;
+        if (fread(record, 1, sizeof(record), stream) != sizeof(record)) {
+            result = 0;
+            break;
+        }
+        data_size = cab_writer_get_u32(record);
+        block_size = cab_writer_get_u32(record + 4);
+        if (data_size <= job->header_size || data_size > job->header_size
+            + CAB_COMPRESSOR_MAX_COMPRESSED_SIZE
+            || !block_size || block_size > CAB_COMPRESSOR_BLOCK_SIZE) {
+            result = 0;
+            break;
+        }
+        block = &job_folder->blocks[idx];
+        data_end += (long)data_size;
+        block->data_end = data_end;
+        block->uncompressed_end = (idx ? job_folder->blocks[idx - 1]
+            .uncompressed_end : 0) + block_size;
+    }
+    if (result > 0) {
+        if ((block_count ? job_folder->blocks[block_count - 1]
+                .uncompressed_end : 0) != uncompressed_size
+            || (source_index + file_count != job->source_count
+                && (unsigned long)data_end < job->folder_threshold)) {
+            result = 0;
+        }
+    }
+    for (idx = 0; result > 0 && idx < block_count; idx++) {
+        unsigned int data_size;
+        unsigned int compressed_size;
+        unsigned int block_size;
+        int err;
+        err = 0;
+        data_size = (unsigned int)(job_folder->blocks[idx].data_end
+            - (idx ? job_folder->blocks[idx - 1].data_end : 0));
+        compressed_size = data_size - job->header_size;
+        block_size = (unsigned int)(job_folder->blocks[idx].uncompressed_end
+            - (idx ? job_folder->blocks[idx - 1].uncompressed_end : 0));
+        if (fread(data_buffer, 1, data_size, stream) != data_size
+            || cab_writer_get_u32(data_buffer) != cab_checksum_cfdata(
+                data_buffer + job->header_size, compressed_size, block_size)
+            || cab_writer_get_u32(data_buffer + 4)
+                != (compressed_size | ((unsigned long)block_size << 16))) {
+            result = 0;
+            break;
+        }
+        written = 1;
+        if (obj->write_file(job_folder->temp_hdl, data_buffer, data_size,
+            &err, obj->user_data) != data_size) {
+            cab_writer_job_set_error(job, FCIERR_TEMP_FILE, err);
+            result = -1;
+        }
+    }
+    if (stream) {
+        fclose(stream);
+    }
+    if (result > 0) {
+        job_folder->block_count = block_count;
+        job_folder->temp_size = data_end;
+        job_folder->file_end = source_index + file_count;
+        job_folder->cached = 1;
+    } else if (result == 0 && written) {
+        int err;
+        err = 0;
+        if (obj->seek_file(job_folder->temp_hdl, 0, SEEK_SET, &err,
+            obj->user_data) == -1) {
+            cab_writer_job_set_error(job, FCIERR_TEMP_FILE, err);
+            result = -1;
+        }
+    }
+    return result;
+}
+
+/**
+ * store the last folder in the job into folder cache.
+ */
+static void
+cab_writer_job_store_folder(
+    cab_writer_job* job,
+    size_t source_index,
+    unsigned char* data_buffer)
+{
+    int result;
+    cab_writer* obj;
+    cab_writer_job_folder* job_folder;
+    unsigned char key[SHA256_DIGEST_SIZE];
+    unsigned char header[CAB_WRITER_CACHE_HEADER_SIZE];
+    folder_cache_entry* entry;
+    size_t file_count;
+    size_t idx;
+    unsigned char* ptr;
+    obj = job->writer;
+    job_folder = &job->folders[job->folder_count - 1];
+    file_count = job_folder->file_end - source_index;
+    cab_writer_job_get_cache_key(job, source_index, key);
+    entry = folder_cache_entry_create(obj->folder_cache, key, sizeof(key));
+    result = entry ? 0 : -1;
+    if (result == 0) {
+        memcpy(header, CAB_WRITER_CACHE_SIGNATURE,
+            sizeof(CAB_WRITER_CACHE_SIGNATURE) - 1);
+        ptr = cab_writer_put_u32(header + 8, (unsigned long)file_count);
+        cab_writer_put_u32(ptr, (unsigned long)job_folder->block_count);
+        result = folder_cache_entry_write(entry, header, sizeof(header));
+    }
+    if (result == 0) {
+        result = folder_cache_entry_write(entry,
+            job->digests + source_index * SHA256_DIGEST_SIZE,
+            file_count * SHA256_DIGEST_SIZE);
+    }
+    for (idx = 0; result == 0 && idx < job_folder->block_count; idx++) {
+        unsigned char record[CAB_WRITER_CACHE_BLOCK_SIZE];
+        ptr = cab_writer_put_u32(record,
+            (unsigned long)(job_folder->blocks[idx].data_end
+                - (idx ? job_folder->blocks[idx - 1].data_end : 0)));
+        cab_writer_put_u32(ptr, job_folder->blocks[idx].uncompressed_end
+            - (idx ? job_folder->blocks[idx - 1].uncompressed_end : 0));
+        result = folder_cache_entry_write(entry, record, sizeof(record));
+    }
+    if (result == 0 && job_folder->block_count) {
+        int err;
+        err = 0;
+        if (obj->seek_file(job_folder->temp_hdl, 0, SEEK_SET, &err,
+            obj->user_data) == -1) {
+            result = -1;
+        }
+    }
+    for (idx = 0; result == 0 && idx < job_folder->block_count; idx++) {
+        unsigned int data_size;
+        int err;
+        err = 0;
+        data_size = (unsigned int)(job_folder->blocks[idx].data_end
+            - (idx ? job_folder->blocks[idx - 1].data_end : 0));
+        if (obj->read_file(job_folder->temp_hdl, data_buffer, data_size,
+            &err, obj->user_data) != data_size) {
+            result = -1;
+        }
+        if (result == 0) {
+            result = folder_cache_entry_write(entry, data_buffer, data_size);
+        }
+    }
+    if (result == 0) {
+        folder_cache_entry_commit(entry);
+    } else if (entry) {
+        folder_cache_entry_free(entry);
+    }
+}
+
+/**
+ * you get non zero if the writer cancels jobs
+ */
+static int
+cab_writer_job_is_cancelled(
+    cab_writer_job* job)
+{
+    int result;
+    cab_writer_lock(job->writer);
+    result = job->writer->job_cancel;
+    cab_writer_unlock(job->writer);
+    return result;
+}
+
+/**
+ * set error into job
+ */
+static void
+cab_writer_job_set_error(
+    cab_writer_job* job,
+    int oper,
+    int type)
+{
+    job->erf.erfOper = oper;
+    job->erf.erfType = type;
+    job->erf.fError = TRUE;
+}
+
+/**
+ * write cabinets while pending data exceed cabinet size
+ */
+static int
+cab_writer_fit_cabinet(
+    cab_writer* obj)
+{
+    int result;
+    result = 0;
+    while (result == 0 && obj->folder_count) {
+        cab_writer_folder* last_folder;
+        unsigned long cabinet_size;
+        CCAB next_ccab;
+        size_t block_end;
+        size_t folder_count;
+        last_folder = obj->folders[obj->folder_count - 1];
+        cabinet_size = cab_writer_cabinet_size(obj, obj->folder_count,
+            last_folder->block_count, NULL);
+        if (cabinet_size <= obj->ccab.cb) {
+            break;
+        }
+        if (obj->folder_count == 1
+            && last_folder->block_start == last_folder->block_count) {
+            break;
+        }
+        result = cab_writer_get_next_cabinet(obj, &next_ccab, cabinet_size);
+        if (result) {
+            break;
+        }
+        if (!next_ccab.szCab[0]) {
+            break;
+        }
+        folder_count = obj->folder_count;
+        block_end = last_folder->block_start;
+        while (block_end < last_folder->block_count
+            && cab_writer_cabinet_size(obj, folder_count, block_end + 1,
+                &next_ccab) <= obj->ccab.cb) {
+            block_end++;
+        }
+        if (block_end == last_folder->block_start) {
+            if (folder_count > 1) {
+                folder_count--;
+                block_end = obj->folders[folder_count - 1]->block_count;
+            } else {
+                block_end++;
+            }
+        }
+        result = cab_writer_write_cabinet(obj, folder_count, block_end,
+            &next_ccab);
+        if (result == 0) {
+            cab_writer_move_to_next_cabinet(obj, &next_ccab, 1);
+        }
+    }
+    return result;
+}
+
+/**
+ * get next cabinet parameter
+ */
+static int
+cab_writer_get_next_cabinet(
+    cab_writer* obj,
+    CCAB* next_ccab,
+    unsigned long prev_size)
+{
+    int result;
+    *next_ccab = obj->ccab;
+    next_ccab->iCab++;
+    cab_writer_lock(obj);
+    result = obj->get_next_cabinet(next_ccab, prev_size, obj->user_data) ?
+        0 : -1;
+    cab_writer_unlock(obj);
+    if (result) {
+        cab_writer_set_error(obj, FCIERR_USER_ABORT, 0);
+    }
+    return result;
+}
+
+/**
+ * move to next cabinet
+ */
+static void
+cab_writer_move_to_next_cabinet(
+    cab_writer* obj,
+    const CCAB* next_ccab,
+    int linked)
+{
+    if (linked) {
+        memcpy(obj->prev_cab, obj->ccab.szCab, sizeof(obj->prev_cab));
+        memcpy(obj->prev_disk, obj->ccab.szDisk, sizeof(obj->prev_disk));
+    }
+    obj->has_prev = linked;
+    obj->need_next_cab = 0;
+    obj->ccab = *next_ccab;
+}
+
+/**
+ * calculate cabinet header size
+ */
+static unsigned long
+cab_writer_header_size(
+    cab_writer* obj,
+    const CCAB* next_ccab)
+{
+    unsigned long result;
+    result = CAB_WRITER_CFHEADER_SIZE;
+    if (obj->ccab.cbReserveCFHeader || obj->ccab.cbReserveCFFolder
+        || obj->ccab.cbReserveCFData) {
+        result += CAB_WRITER_CFHEADER_RESERVE_SIZE
+            + obj->ccab.cbReserveCFHeader;
+    }
+    if (obj->has_prev) {
+        result += strlen(obj->prev_cab) + 1 + strlen(obj->prev_disk) + 1;
+    }
+    if (next_ccab) {
+        result += strlen(next_ccab->szCab) + 1
+            + strlen(next_ccab->szDisk) + 1;
+    }
+    return result;
+}
+
+/**
+ * calculate cabinet size for pending folders
+ */
+static unsigned long
+cab_writer_cabinet_size(
+    cab_writer* obj,
+    size_t folder_count,
+    size_t last_block_end,
+    const CCAB* next_ccab)
+{
+    unsigned long result;
+    size_t idx;
+    result = cab_writer_header_size(obj, next_ccab);
+    for (idx = 0; idx < folder_count; idx++) {
+        cab_writer_folder* folder;
+        size_t block_end;
+        folder = obj->folders[idx];
+        block_end = idx == folder_count - 1 ?
+            last_block_end : folder->block_count;
+        result += CAB_WRITER_CFFOLDER_SIZE + obj->ccab.cbReserveCFFolder;
+        result += (unsigned long)(cab_writer_folder_data_end(
+            folder, block_end) - folder->data_offset);
+        result += cab_writer_folder_file_entry_size(
+            obj, folder, block_end, NULL);
+    }
+    return result;
+}
+
+/**
+ * calculate size of CFFILE entries in a folder part
+ */
+static unsigned long
+cab_writer_folder_file_entry_size(
+    cab_writer* obj,
+    cab_writer_folder* folder,
+    size_t block_end,
+    size_t* file_count)
+{
+    unsigned long result;
+    size_t count;
+    if (cab_writer_is_final_part(obj, folder, block_end)) {
+        result = folder->file_entry_size;
+        count = folder->file_count - folder->file_start;
+    } else {
+        size_t idx;
+        result = 0;
+        count = 0;
+        for (idx = folder->file_start; idx < folder->file_count; idx++) {
+            if (!cab_writer_file_in_part(obj, folder, &folder->files[idx],
+                block_end)) {
+                break;
+            }
+            result += CAB_WRITER_CFFILE_SIZE
+                + strlen(folder->files[idx].name) + 1;
+            count++;
+        }
+    }
+    if (file_count) {
+        *file_count = count;
+    }
+    return result;
+}
+
+/**
+ * uncompressed offset at the block
+ */
+static unsigned long
+cab_writer_folder_uncompressed_end(
+    cab_writer_folder* folder,
+    size_t block_end)
+{
+    unsigned long result;
+    if (block_end) {
+        result = folder->blocks[block_end - 1].uncompressed_end;
+    } else {
+        result = 0;
+    }
+    return result;
+}
+
+/**
+ * data offset at the block
+ */
+static long
+cab_writer_folder_data_end(
+    cab_writer_folder* folder,
+    size_t block_end)
+{
+    long result;
+    if (block_end) {
+        result = folder->blocks[block_end - 1].data_end;
+    } else {
+        result = 0;
+    }
+    return result;
+}
+
+/**
+ * you get non zero if the folder part is the last part of the folder.
+ */
+static int
+cab_writer_is_final_part(
+    cab_writer* obj,
+    cab_writer_folder* folder,
+    size_t block_end)
+{
+    int result;
+    result = block_end == folder->block_count;
+    if (result && obj->folder_open) {
+        result = folder != obj->folders[obj->folder_count - 1];
+    }
+    return result;
+}
+
+/**
+ * you get non zero if the file is in the folder part.
+ */
+static int
+cab_writer_file_in_part(
+    cab_writer* obj,
+    cab_writer_folder* folder,
+    cab_writer_file* file,
+    size_t block_end)
+{
+    int result;
+    if (cab_writer_is_final_part(obj, folder, block_end)) {
+        result = 1;
+    } else {
+        result = file->offset
+            < cab_writer_folder_uncompressed_end(folder, block_end);
+    }
+    return result;
+}
+
+/**
+ * write cabinet file
+ */
+static int
+cab_writer_write_cabinet(
+    cab_writer* obj,
+    size_t folder_count,
+    size_t last_block_end,
+    const CCAB* next_ccab)
+{
+    int result;
+    char* cab_path;
+    size_t cab_path_size;
+    intptr_t cab_hdl;
+    unsigned long cabinet_size;
+    cab_hdl = -1;
+    cab_path_size = strlen(obj->ccab.szCabPath)
+        + strlen(obj->ccab.szCab) + 1;
+    cabinet_size = cab_writer_cabinet_size(obj, folder_count,
+        last_block_end, next_ccab);
+    cab_path = (char*)obj->mem_alloc(cab_path_size);
+    result = cab_path ? 0 : -1;
+    if (result == 0) {
+        snprintf(cab_path, cab_path_size, "%s%s",
+            obj->ccab.szCabPath, obj->ccab.szCab);
+    } else {
+        cab_writer_set_error(obj, FCIERR_ALLOC_FAIL, errno);
+    }
+    if (result == 0) {
+        int err;
+        err = 0;
+        cab_writer_lock(obj);
+        cab_hdl = obj->open_file(cab_path,
+            O_WRONLY | O_CREAT | O_TRUNC | O_BINARY,
+            CAB_WRITER_CABINET_MODE, &err, obj->user_data);
+        cab_writer_unlock(obj);
+        if (cab_hdl == -1) {
+            cab_writer_set_error(obj, FCIERR_CAB_FILE, err);
+            result = -1;
+        }
+    }
+    if (result == 0) {
+        result = cab_writer_write_cabinet_entries(obj, cab_hdl,
+            folder_count, last_block_end, next_ccab, cabinet_size);
+    }
+    if (result == 0) {
+        size_t idx;
+        for (idx = 0; idx < folder_count; idx++) {
+            size_t block_end;
+            block_end = idx == folder_count - 1 ?
+                last_block_end : obj->folders[idx]->block_count;
+            if (obj->folders[idx]->stored) {
+                result = cab_writer_store_folder_data(obj, cab_hdl,
+                    obj->folders[idx], block_end);
+            } else {
+                result = cab_writer_copy_folder_data(obj, cab_hdl,
+                    obj->folders[idx], block_end);
+            }
+            if (result) {
+                break;
+            }
+        }
+    }
+    if (cab_hdl != -1) {
+        int err;
+        err = 0;
+        if (obj->close_file(cab_hdl, &err, obj->user_data) && result == 0) {
+            cab_writer_set_error(obj, FCIERR_CAB_FILE, err);
+            result = -1;
+        }
+    }
+    if (result == 0) {
+        result = cab_writer_notify_placed(obj, folder_count, last_block_end);
+    }
+    if (result == 0) {
+        result = cab_writer_notify_status(obj, statusCabinet,
+            cabinet_size, cabinet_size);
+    }
+    if (result == 0) {
+        cab_writer_remove_written(obj, folder_count, last_block_end);
+    }
+    if (cab_path) {
+        obj->mem_free(cab_path);
+    }
+    return result;
+}
+
+/**
+ * write cabinet header, folder entries and file entries
+ */
+static int
+cab_writer_write_cabinet_entries(
+    cab_writer* obj,
+    intptr_t cab_hdl,
+    size_t folder_count,
+    size_t last_block_end,
+    const CCAB* next_ccab,
+    unsigned long cabinet_size)
+{
+    int result;
+    unsigned long header_size;
+    unsigned long entries_size;
+    unsigned long files_offset;
+    unsigned long data_offset;
+    size_t file_count;
+    unsigned char* entries;
+    size_t idx;
+    header_size = cab_writer_header_size(obj, next_ccab);
+    files_offset = header_size + (unsigned long)folder_count
+        * (CAB_WRITER_CFFOLDER_SIZE + obj->ccab.cbReserveCFFolder);
+    entries_size = files_offset;
+    file_count = 0;
+    for (idx = 0; idx < folder_count; idx++) {
+        size_t count;
+        count = 0;
+        entries_size += cab_writer_folder_file_entry_size(obj,
+            obj->folders[idx], idx == folder_count - 1 ?
+                last_block_end : obj->folders[idx]->block_count,
+            &count);
+        file_count += count;
+    }
+    result = 0;
+    if (folder_count > CAB_WRITER_MAX_COUNT
+        || file_count > CAB_WRITER_MAX_COUNT) {
+        cab_writer_set_error(obj, FCIERR_CAB_FORMAT_LIMIT, EFBIG);
+        result = -1;
+    }
+    entries = NULL;
+    if (result == 0) {
+        entries = (unsigned char*)obj->mem_alloc(entries_size);
+        if (!entries) {
+            cab_writer_set_error(obj, FCIERR_ALLOC_FAIL, errno);
+            result = -1;
+        }
+    }
+    if (result == 0) {
+        unsigned char* ptr;
+        unsigned int flags;
+        int has_reserve;
+        has_reserve = obj->ccab.cbReserveCFHeader || obj->ccab.cbReserveCFFolder
+            || obj->ccab.cbReserveCFData;
+        flags = 0;
+        if (obj->has_prev) {
+            flags |= CAB_WRITER_FLAG_PREV_CABINET;
+        }
+        if (next_ccab) {
+            flags |= CAB_WRITER_FLAG_NEXT_CABINET;
+        }
+        if (has_reserve) {
+            flags |= CAB_WRITER_FLAG_RESERVE_PRESENT;
+        }
+        ptr = entries;
+        *ptr++ = 'M';
+        *ptr++ = 'S';
+        *ptr++ = 'C';
+        *ptr++ = 'F';
+        ptr = cab_writer_put_u32(ptr, 0);
+        ptr = cab_writer_put_u32(ptr, cabinet_size);
+        ptr = cab_writer_put_u32(ptr, 0);
+        ptr = cab_writer_put_u32(ptr, files_offset);
+        ptr = cab_writer_put_u32(ptr, 0);
+        *ptr++ = 3;
+        *ptr++ = 1;
+        ptr = cab_writer_put_u16(ptr, (unsigned int)folder_count);
+        ptr = cab_writer_put_u16(ptr, (unsigned int)file_count);
+        ptr = cab_writer_put_u16(ptr, flags);
+        ptr = cab_writer_put_u16(ptr, obj->ccab.setID);
+        ptr = cab_writer_put_u16(ptr, (unsigned int)obj->ccab.iCab);
+        if (has_reserve) {
+            ptr = cab_writer_put_u16(ptr, obj->ccab.cbReserveCFHeader);
+            *ptr++ = (unsigned char)obj->ccab.cbReserveCFFolder;
+            *ptr++ = (unsigned char)obj->ccab.cbReserveCFData;
+            memset(ptr, 0, obj->ccab.cbReserveCFHeader);
+            ptr += obj->ccab.cbReserveCFHeader;
+        }
+        if (obj->has_prev) {
+            ptr = cab_writer_put_str(ptr, obj->prev_cab);
+            ptr = cab_writer_put_str(ptr, obj->prev_disk);
+        }
+        if (next_ccab) {
+            ptr = cab_writer_put_str(ptr, next_ccab->szCab);
+            ptr = cab_writer_put_str(ptr, next_ccab->szDisk);
+        }
+        data_offset = entries_size;
+        for (idx = 0; idx < folder_count; idx++) {
+            cab_writer_folder* folder;
+            size_t block_end;
+            folder = obj->folders[idx];
+            block_end = idx == folder_count - 1 ?
+                last_block_end : folder->block_count;
+            ptr = cab_writer_put_u32(ptr, data_offset);
+            ptr = cab_writer_put_u16(ptr,
+                (unsigned int)(block_end - folder->block_start));
+            ptr = cab_writer_put_u16(ptr,
+                cab_compressor_get_folder_type(folder->type_compress));
+            memset(ptr, 0, obj->ccab.cbReserveCFFolder);
+            ptr += obj->ccab.cbReserveCFFolder;
+            data_offset += (unsigned long)(cab_writer_folder_data_end(
+                folder, block_end) - folder->data_offset);
+        }
+        for (idx = 0; idx < folder_count; idx++) {
+            cab_writer_folder* folder;
+            size_t block_end;
+            unsigned long part_start;
+            unsigned long part_end;
+            int last_part;
+            size_t file_idx;
+            folder = obj->folders[idx];
+            block_end = idx == folder_count - 1 ?
+                last_block_end : folder->block_count;
+            last_part = cab_writer_is_final_part(obj, folder, block_end);
+            part_start = folder->uncompressed_offset;
+            part_end = cab_writer_folder_uncompressed_end(folder, block_end);
+            for (file_idx = folder->file_start;
+                file_idx < folder->file_count; file_idx++) {
+                cab_writer_file* file;
+                unsigned int folder_index;
+                int continued_from_prev;
+                int continued_to_next;
+                file = &folder->files[file_idx];
+                if (!cab_writer_file_in_part(obj, folder, file, block_end)) {
+                    break;
+                }
+                continued_from_prev = file->offset < part_start;
+                continued_to_next = !last_part
+                    && file->offset + file->size > part_end;
+                if (continued_from_prev && continued_to_next) {
+                    folder_index = CAB_WRITER_IFOLD_CONTINUED_PREV_AND_NEXT;
+                } else if (continued_from_prev) {
+                    folder_index = CAB_WRITER_IFOLD_CONTINUED_FROM_PREV;
+                } else if (continued_to_next) {
+                    folder_index = CAB_WRITER_IFOLD_CONTINUED_TO_NEXT;
+                } else {
+                    folder_index = (unsigned int)idx;
+                }
+                ptr = cab_writer_put_u32(ptr, file->size);
+                ptr = cab_writer_put_u32(ptr, file->offset);
+                ptr = cab_writer_put_u16(ptr, folder_index);
+                ptr = cab_writer_put_u16(ptr, file->date);
+                ptr = cab_writer_put_u16(ptr, file->time);
+                ptr = cab_writer_put_u16(ptr, file->attribs);
+                ptr = cab_writer_put_str(ptr, file->name);
+            }
+        }
+    }
+    if (result == 0) {
+        int err;
+        err = 0;
+        if (obj->write_file(cab_hdl, entries, (unsigned int)entries_size,
+            &err, obj->user_data) != entries_size) {
+            cab_writer_set_error(obj, FCIERR_CAB_FILE, err);
+            result = -1;
+        }
+    }
+    if (entries) {
+        obj->mem_free(entries);
+    }
+    return result;
+}
+
+/**
+ * copy folder data into cabinet
+ */
+static int
+cab_writer_copy_folder_data(
+    cab_writer* obj,
+    intptr_t cab_hdl,
+    cab_writer_folder* folder,
+    size_t block_end)
+{
+    int result;
+    long remaining;
+    int err;
+    err = 0;
+    result = 0;
+    remaining = cab_writer_folder_data_end(folder, block_end)
+        - folder->data_offset;
+    if (remaining) {
+        if (obj->seek_file(folder->temp_hdl, folder->data_offset, SEEK_SET,
+            &err, obj->user_data) == -1) {
+            cab_writer_set_error(obj, FCIERR_TEMP_FILE, err);
+            result = -1;
+        } else {
+            folder->temp_position = folder->data_offset;
+        }
+    }
+    while (result == 0 && remaining) {
+        unsigned int request_size;
+        unsigned int read_size;
+        request_size = CAB_WRITER_IO_BUFFER_SIZE;
+        if ((long)request_size > remaining) {
+            request_size = (unsigned int)remaining;
+        }
+        read_size = obj->read_file(folder->temp_hdl, obj->io_buffer,
+            request_size, &err, obj->user_data);
+        if (read_size != request_size) {
+            cab_writer_set_error(obj, FCIERR_TEMP_FILE, err);
+            result = -1;
+        }
+        if (result == 0) {
+            if (obj->write_file(cab_hdl, obj->io_buffer, read_size,
+                &err, obj->user_data) != read_size) {
+                cab_writer_set_error(obj, FCIERR_CAB_FILE, err);
+                result = -1;
+            }
+        }
+        if (result == 0) {
+            remaining -= read_size;
+            folder->temp_position += read_size;
+        }
+    }
+    return result;
+}
+
+/**
+ * write data blocks of stored folder into cabinet from source files.
+ * The block lying in a mapped source file is written from the mapped
+ * memory with the checksum calculated on it. The other blocks are gathered
+ * into copy buffer.
+ */
+static int
+cab_writer_store_folder_data(
+    cab_writer* obj,
+    intptr_t cab_hdl,
+    cab_writer_folder* folder,
+    size_t block_end)
+{
+    int result;
+    unsigned int header_size;
+    size_t file_idx;
+    size_t src_idx;
+    intptr_t src_hdl;
+    const unsigned char* src_data;
+    size_t block_idx;
+    header_size = CAB_WRITER_CFDATA_SIZE + obj->ccab.cbReserveCFData;
+    file_idx = folder->file_start;
+    src_idx = folder->file_count;
+    src_hdl = -1;
+    src_data = NULL;
+    result = 0;
+    for (block_idx = folder->block_start;
+        result == 0 && block_idx < block_end; block_idx++) {
+        unsigned long block_start;
+        unsigned int block_size;
+        unsigned int fill;
+        const unsigned char* payload;
+        unsigned char* header;
+        int err;
+        block_start = cab_writer_folder_uncompressed_end(folder, block_idx);
+        block_size = (unsigned int)(folder->blocks[block_idx].uncompressed_end
+            - block_start);
+        payload = NULL;
+        fill = 0;
+        while (result == 0 && fill < block_size) {
+            const cab_writer_file* file;
+            unsigned long offset;
+            unsigned long piece_size;
+            offset = block_start + fill;
+            while (file_idx < folder->file_count
+                && folder->files[file_idx].offset
+                    + folder->files[file_idx].size <= offset) {
+                file_idx++;
+            }
+            if (file_idx == folder->file_count) {
+                cab_writer_set_error(obj, FCIERR_READ_SRC, EINVAL);
+                result = -1;
+                break;
+            }
+            file = &folder->files[file_idx];
+            if (src_idx != file_idx) {
+                if (src_hdl != -1) {
+                    cab_writer_close_stored_source(obj,
+                        &folder->files[src_idx], src_hdl, src_data);
+                }
+                src_data = NULL;
+                src_idx = file_idx;
+                result = cab_writer_open_stored_source(obj, file,
+                    &src_hdl, &src_data);
+                if (result) {
+                    break;
+                }
+            }
+            piece_size = file->offset + file->size - offset;
+            if (piece_size > block_size - fill) {
+                piece_size = block_size - fill;
+            }
+            if (src_data && !fill && piece_size == block_size) {
+                payload = src_data + (offset - file->offset);
+            } else if (src_data) {
+                memcpy(obj->io_buffer + header_size + fill,
+                    src_data + (offset - file->offset), piece_size);
+            } else {
+                result = cab_writer_read_stored_source(obj, src_hdl,
+                    offset - file->offset,
+                    obj->io_buffer + header_size + fill, piece_size);
+            }
+            fill += (unsigned int)piece_size;
+        }
+        if (result == 0) {
+            unsigned char* ptr;
+            if (payload) {
+                header = obj->data_buffer;
+            } else {
+                header = obj->io_buffer;
+                payload = header + header_size;
+            }
+            ptr = cab_writer_put_u32(header,
+                cab_checksum_cfdata(payload, block_size, block_size));
+            ptr = cab_writer_put_u16(ptr, block_size);
+            ptr = cab_writer_put_u16(ptr, block_size);
+            memset(ptr, 0, header_size - CAB_WRITER_CFDATA_SIZE);
+            err = 0;
+            if (header + header_size == payload) {
+                /* gathered block is written with the header at once */
+                result = obj->write_file(cab_hdl, header,
+                    header_size + block_size, &err, obj->user_data)
+                    == header_size + block_size ? 0 : -1;
+            } else {
+                result = obj->write_file(cab_hdl, header, header_size,
+                    &err, obj->user_data) == header_size ? 0 : -1;
+                if (result == 0) {
+                    result = obj->write_file(cab_hdl, (void*)payload,
+                        block_size, &err, obj->user_data)
+                        == block_size ? 0 : -1;
+                }
+            }
+            if (result) {
+                cab_writer_set_error(obj, FCIERR_CAB_FILE, err);
+            }
+        }
+    }
+    if (src_hdl != -1) {
+        cab_writer_close_stored_source(obj, &folder->files[src_idx],
+            src_hdl, src_data);
+    }
+    return result;
+}
+
+/**
+ * open source file of stored folder and map it if possible
+ */
+static int
+cab_writer_open_stored_source(
+    cab_writer* obj,
+    const cab_writer_file* file,
+    intptr_t* src_hdl,
+    const unsigned char** src_data)
+{
+    int result;
+    int err;
+    err = 0;
+    *src_data = NULL;
+    cab_writer_lock(obj);
+    *src_hdl = obj->open_file(file->source_path, O_RDONLY | O_BINARY, 0,
+        &err, obj->user_data);
+    cab_writer_unlock(obj);
+    if (*src_hdl != -1) {
+        long src_size;
+        src_size = obj->seek_file(*src_hdl, 0, SEEK_END, &err,
+            obj->user_data);
+        /* the file must not be changed since it was added */
+        result = src_size != -1 && (unsigned long)src_size == file->size ?
+            0 : -1;
+        if (result) {
+            cab_writer_set_error(obj, FCIERR_READ_SRC, err);
+        }
+    } else {
+        cab_writer_set_error(obj, FCIERR_OPEN_SRC, err);
+        result = -1;
+    }
+    if (result == 0 && obj->map_file) {
+        *src_data = (const unsigned char*)obj->map_file(*src_hdl,
+            file->size, &err, obj->user_data);
+    }
+    if (result && *src_hdl != -1) {
+        obj->close_file(*src_hdl, &err, obj->user_data);
+        *src_hdl = -1;
+    }
+    return result;
+}
+
+/**
+ * close source file of stored folder
+ */
+static void
+cab_writer_close_stored_source(
+    cab_writer* obj,
+    const cab_writer_file* file,
+    intptr_t src_hdl,
+    const unsigned char* src_data)
+{
+    int err;
+    err = 0;
+    if (src_data) {
+        obj->unmap_file(src_data, file->size, &err, obj->user_data);
+    }
+    obj->close_file(src_hdl, &err, obj->user_data);
+}
+
+/**
+ * read a part of source file of stored folder
+ */
+static int
+cab_writer_read_stored_source(
+    cab_writer* obj,
+    intptr_t src_hdl,
+    unsigned long position,
+    unsigned char* buffer,
+    unsigned long size)
+{
+    int result;
+    int err;
+    err = 0;
+    result = obj->seek_file(src_hdl, (long)position, SEEK_SET, &err,
+        obj->user_data) != -1 ? 0 : -1;
+    while (result == 0 && size) {
+        unsigned int read_size;
+        read_size = obj->read_file(src_hdl, buffer, (unsigned int)size,
+            &err, obj->user_data);
+        if (read_size == (unsigned int)-1 || read_size == 0) {
+            result = -1;
+        } else {
+            buffer += read_size;
+            size -= read_size;
+        }
+    }
+    if (result) {
+        cab_writer_set_error(obj, FCIERR_READ_SRC, err);
+    }
+    return result;
+}
+
+/**
+ * notify placed files
+ */
+static int
+cab_writer_notify_placed(
+    cab_writer* obj,
+    size_t folder_count,
+    size_t last_block_end)
+{
+    int result;
+    size_t idx;
+    result = 0;
+    for (idx = 0; idx < folder_count; idx++) {
+        cab_writer_folder* folder;
+        size_t block_end;
+        size_t file_idx;
+        folder = obj->folders[idx];
+        block_end = idx == folder_count - 1 ?
+            last_block_end : folder->block_count;
+        for (file_idx = folder->file_start;
+            file_idx < folder->file_count; file_idx++) {
+            cab_writer_file* file;
+            file = &folder->files[file_idx];
+            if (!cab_writer_file_in_part(obj, folder, file, block_end)) {
+                break;
+            }
+            if (obj->file_placed(&obj->ccab, file->name, (long)file->size,
+                file->offset < folder->uncompressed_offset ? TRUE : FALSE,
+                obj->user_data) == -1) {
+                cab_writer_set_error(obj, FCIERR_USER_ABORT, 0);
+                result = -1;
+                break;
+            }
+        }
+        if (result) {
+            break;
+        }
+    }
+    return result;
+}
+
+/**
+ * update pending folders after writing cabinet
+ */
+static void
+cab_writer_remove_written(
+    cab_writer* obj,
+    size_t folder_count,
+    size_t last_block_end)
+{
+    size_t written_count;
+    cab_writer_folder* last_folder;
+    size_t idx;
+    written_count = folder_count;
+    last_folder = obj->folders[folder_count - 1];
+    if (!cab_writer_is_final_part(obj, last_folder, last_block_end)) {
+        unsigned long part_end;
+        part_end = cab_writer_folder_uncompressed_end(
+            last_folder, last_block_end);
+        while (last_folder->file_start < last_folder->file_count) {
+            cab_writer_file* file;
+            file = &last_folder->files[last_folder->file_start];
+            if (file->offset >= part_end
+                || file->offset + file->size > part_end) {
+                break;
+            }
+            last_folder->file_entry_size -= CAB_WRITER_CFFILE_SIZE
+                + strlen(file->name) + 1;
+            last_folder->file_start++;
+        }
+        last_folder->data_offset = cab_writer_folder_data_end(
+            last_folder, last_block_end);
+        last_folder->uncompressed_offset = part_end;
+        last_folder->block_start = last_block_end;
+        written_count--;
+    }
+    for (idx = 0; idx < written_count; idx++) {
+        cab_writer_free_folder(obj, obj->folders[idx]);
+    }
+    memmove(obj->folders, obj->folders + written_count,
+        (obj->folder_count - written_count) * sizeof(cab_writer_folder*));
+    obj->folder_count -= written_count;
+}
+
+/**
+ * call status callback
+ */
+static int
+cab_writer_notify_status(
+    cab_writer* obj,
+    unsigned int type_status,
+    unsigned long size_1,
+    unsigned long size_2)
+{
+    int result;
+    result = 0;
+    if (obj->status) {
+        if (obj->status(type_status, size_1, size_2, obj->user_data) == -1) {
+            cab_writer_set_error(obj, FCIERR_USER_ABORT, 0);
+            result = -1;
+        }
+    }
+    return result;
+}
+
+/**
+ * store 16 bit little endian value
+ */
+static unsigned char*
+cab_writer_put_u16(
+    unsigned char* ptr,
+    unsigned int value)
+{
+    ptr[0] = (unsigned char)value;
+    ptr[1] = (unsigned char)(value >> 8);
+    return ptr + 2;
+}
+
+/**
+ * store 32 bit little endian value
+ */
+static unsigned char*
+cab_writer_put_u32(
+    unsigned char* ptr,
+    unsigned long value)
+{
+    ptr[0] = (unsigned char)value;
+    ptr[1] = (unsigned char)(value >> 8);
+    ptr[2] = (unsigned char)(value >> 16);
+    ptr[3] = (unsigned char)(value >> 24);
+    return ptr + 4;
+}
+
+/**
+ * store string with null terminator
+ */
+static unsigned char*
+cab_writer_put_str(
+    unsigned char* ptr,
+    const char* str)
+{
+    size_t size;
+    size = strlen(str) + 1;
+    memcpy(ptr, str, size);
+    return ptr + size;
+}
+
+/**
+ * load 32 bit little endian value
+ */
+static unsigned long
+cab_writer_get_u32(
+    const unsigned char* ptr)
+{
+    return (unsigned long)ptr[0] | ((unsigned long)ptr[1] << 8)
+        | ((unsigned long)ptr[2] << 16) | ((unsigned long)ptr[3] << 24);
+}
+
+/* vi: se ts=4 sw=4 et: */
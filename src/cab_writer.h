@@ -0,0 +1,160 @@
+#ifndef __CAB_WRITER_H__
+#define __CAB_WRITER_H__
+
+#include "fci_compat.h"
+#include "folder_cache.h"
+
+#ifdef __cplusplus
+#define _CAB_WRITER_ITFC_BEGIN extern "C" {
+#define _CAB_WRITER_ITFC_END }
+#else
+#define _CAB_WRITER_ITFC_BEGIN
+#define _CAB_WRITER_ITFC_END
+#endif
+
+_CAB_WRITER_ITFC_BEGIN
+
+/*
+ * native cabinet writer.
+ * The interface is compatible with fci in cabinet.dll, so that the callers
+ * can switch fci and this writer without changing callbacks.
+ */
+
+/**
+ * map source file opened by get_open_info or open_file callback as read
+ * only memory from the beginning to the size. Return NULL to let the writer
+ * read the file with read_file callback.
+ */
+typedef const void* (*PFNCABWRITERMAP)(
+    intptr_t hf,
+    unsigned long cb,
+    int* err,
+    void* pv);
+
+/**
+ * unmap source file mapped by PFNCABWRITERMAP
+ */
+typedef int (*PFNCABWRITERUNMAP)(
+    const void* pv_data,
+    unsigned long cb,
+    int* err,
+    void* pv);
+
+/**
+ * create cabinet writer
+ */
+HFCI DIAMONDAPI
+cab_writer_create(
+    PERF erf,
+    PFNFCIFILEPLACED file_placed,
+    PFNFCIALLOC mem_alloc,
+    PFNFCIFREE mem_free,
+    PFNFCIOPEN open_file,
+    PFNFCIREAD read_file,
+    PFNFCIWRITE write_file,
+    PFNFCICLOSE close_file,
+    PFNFCISEEK seek_file,
+    PFNFCIDELETE delete_file,
+    PFNFCIGETTEMPFILE get_temp_file,
+    PCCAB ccab,
+    void* user_data);
+
+/**
+ * add a file into cabinet.
+ * A file added without compression is not read here. Its data blocks are
+ * copied from the source file when the cabinet is written, so the source
+ * file has to be kept unchanged until the cabinet is completed.
+ */
+BOOL DIAMONDAPI
+cab_writer_add_file(
+    HFCI hdl,
+    LPSTR source_file,
+    LPSTR file_name,
+    BOOL execute,
+    PFNFCIGETNEXTCABINET get_next_cabinet,
+    PFNFCISTATUS status,
+    PFNFCIGETOPENINFO get_open_info,
+    TCOMP type_compress);
+
+/**
+ * complete the current cabinet
+ */
+BOOL DIAMONDAPI
+cab_writer_flush_cabinet(
+    HFCI hdl,
+    BOOL get_next_cab,
+    PFNFCIGETNEXTCABINET get_next_cabinet,
+    PFNFCISTATUS status);
+
+/**
+ * complete the current folder and start new folder
+ */
+BOOL DIAMONDAPI
+cab_writer_flush_folder(
+    HFCI hdl,
+    PFNFCIGETNEXTCABINET get_next_cabinet,
+    PFNFCISTATUS status);
+
+/**
+ * set count of threads which compress scheduled folders.
+ * The threads call open_file, read_file, write_file, seek_file, close_file,
+ * delete_file and get_temp_file callbacks, and the writer never calls
+ * open_file, delete_file, get_temp_file and get_next_cabinet at the same
+ * time. You have to call this before adding files.
+ */
+BOOL DIAMONDAPI
+cab_writer_set_jobs(
+    HFCI hdl,
+    unsigned int jobs);
+
+/**
+ * schedule source files which will be added into a folder.
+ * The files are compressed in background, and cab_writer_add_file uses
+ * the compressed data when the same files are added in the same order
+ * with the same compression type. The folder has to be completed by
+ * cab_writer_flush_folder or cab_writer_flush_cabinet after the last file.
+ * This does nothing if the jobs is less than 2 or the files are stored
+ * without compression.
+ */
+BOOL DIAMONDAPI
+cab_writer_schedule_files(
+    HFCI hdl,
+    LPSTR* source_files,
+    size_t file_count,
+    TCOMP type_compress);
+
+/**
+ * set callbacks to compress source files directly from mapped memory.
+ * The writer reads source files with read_file callback if the callbacks
+ * are not set or map_file returns NULL.
+ */
+BOOL DIAMONDAPI
+cab_writer_set_source_map(
+    HFCI hdl,
+    PFNCABWRITERMAP map_file,
+    PFNCABWRITERUNMAP unmap_file);
+
+/**
+ * set cache which keeps compressed folders across runs.
+ * The scheduled files are compressed through jobs even if the jobs is less
+ * than 2, and a folder is copied from the cache without compression when
+ * the source contents, the compression type and the folder threshold are
+ * the same with the cached folder. The writer does not free the cache.
+ * You have to call this before adding files.
+ */
+BOOL DIAMONDAPI
+cab_writer_set_folder_cache(
+    HFCI hdl,
+    folder_cache* cache);
+
+/**
+ * destroy cabinet writer
+ */
+BOOL DIAMONDAPI
+cab_writer_destroy(
+    HFCI hdl);
+
+_CAB_WRITER_ITFC_END
+
+/* vi: se ts=4 sw=4 et: */
+#endif
@@ -1,7 +1,6 @@
 #include "cabx.h"
 #include "cabx_i.h"
-#include <windows.h>
-#include <fci.h>
+#include "fci_compat.h"
 #include <unistd.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -13,14 +12,12 @@
 #include <stdint.h>
 #include <sys/stat.h>
 #include <limits.h>
-#include <direct.h>
-#include <io.h>
 #include "exe_info.h"
 #include "col/array_list.h"
 #include "col/list_ref.h"
 #include "col/rb_map.h"
 #include "cstr.h"
-#include "csv.h"
+#include "csv_stream.h"
 #include "buffer/char_buffer.h"
 #include "buffer/variable_buffer.h"
 #include "name_compression.h"
@@ -28,6 +25,25 @@
 #include "str_conv.h"
 #include "str_hash.h"
 #include "path.h"
+#include "dir.h"
+#include "file_i.h"
+#include "cab_writer.h"
+#include "cab_compressor.h"
+#include "cab_extractor.h"
+#include "cab_planner.h"
+#include "cab_probe.h"
+#include "read_ahead.h"
+#include "file_check.h"
+#include "dir_walker.h"
+#include "bin_manifest.h"
+#include "thread_i.h"
+#include "worker_pool.h"
+#include "buffered_writer.h"
+#include "temp_store.h"
+#include "bounded_queue.h"
+#include "folder_cache.h"
+#include "dup_finder.h"
+#include "similarity_order.h"
 
 /**
  * option for cabinet genertor
@@ -55,6 +71,36 @@ typedef struct _CABX_ENTRY_ITER_REPORT_STATE CABX_ENTRY_ITER_REPORT_STATE;
  */
 typedef struct _CABX_GENERATION_STATUS CABX_GENERATION_STATUS;
 
+/**
+ * cabinet generation backend
+ */
+typedef struct _CABX_BACKEND CABX_BACKEND;
+
+/**
+ * file handle passed to backend
+ */
+typedef struct _CABX_FILE CABX_FILE;
+
+/**
+ * input of entries
+ */
+typedef struct _CABX_INPUT CABX_INPUT;
+
+/**
+ * rule for files in input directory
+ */
+typedef struct _CABX_INPUT_RULE CABX_INPUT_RULE;
+
+/**
+ * binary manifest loaded into memory
+ */
+typedef struct _CABX_MANIFEST CABX_MANIFEST;
+
+/**
+ * entries loaded while they are added into cabinet
+ */
+typedef struct _CABX_PIPELINE CABX_PIPELINE;
+
 /**
  * cabinet generator
  */
@@ -72,7 +118,7 @@ struct _CABX {
     col_list* entries;
 
     /**
-     * source path to entry name map
+     * source path to entry map
      */
     col_map* source_path_entry_map;
 
@@ -101,6 +147,12 @@ struct _CABX {
      * option
      */
     CABX_OPTION* option;
+
+    /**
+     * binary manifest which loaded entries are placed in. NULL if entries
+     * are not loaded from binary manifest.
+     */
+    CABX_MANIFEST* manifest;
 };
 
 /**
@@ -149,1278 +201,3712 @@ struct _CABX_OPTION {
      * report file
      */
     char* report_file;
-};
-
-/**
- * cab entry
- */
-struct _CABX_ENTRY {
 
     /**
-     * reference count
+     * cabinet generation backend
      */
-    unsigned int ref_count;
+    const CABX_BACKEND* backend;
 
     /**
-     * source file path
+     * compression preset applied to entries which do not specify preset
      */
-    char* source_file;
-    
+    unsigned int compression_preset;
+
     /**
-     * cab entry name
+     * count of threads compressing folders
      */
-    char* entry_name;
+    unsigned int jobs;
 
     /**
-     * compression kind
+     * not zero if source files are compressed from mapped memory
      */
-    int compression;
+    int map_source;
 
     /**
-     * data attribute
+     * not zero if output files are written in background thread
      */
-    int attribute;
+    int write_thread;
 
     /**
-     * has executing flag
+     * memory budget for temporary files. temporary files are created on
+     * disk if this is zero.
      */
-    int execute;
+    unsigned long temp_memory;
 
     /**
-     * flush folder flat
+     * not zero if entries are loaded while they are added into cabinet
      */
-    int flush_folder;
+    int pipeline;
 
     /**
-     * flush cabinet flag
+     * directory to keep compressed folders across runs. NULL if folders
+     * are not cached.
      */
-    int flush_cabinet;
-};
+    char* folder_cache;
 
-/**
- * entry iteration status
- */
-struct _CABX_ENTRY_ITER_STATE {
     /**
-     * last compression type
+     * cabinet to extract files from. NULL if cabinets are generated.
      */
+    char* extract;
 
-    int last_compression_type;
+    /**
+     * not zero if entries having the same source contents are placed next
+     * to each other
+     */
+    int group_duplicates;
 
     /**
-     * processed count
+     * not zero if entries are ordered by similarity of source contents
      */
-    size_t processed_count;
+    int order_entries;
 
     /**
-     * fci handle
+     * not zero if cabinets are estimated without generating them
      */
-    HFCI fci_handle;
+    int dry_run;
 
+    /**
+     * percent of max cabinet size filled by planned entries.
+     * 0 if entries are not planned into cabinets.
+     */
+    unsigned int plan_fill;
 
     /**
-     * generation status
+     * count of source files read ahead in background.
+     * 0 if source files are not read ahead.
      */
-    CABX_GENERATION_STATUS* generation_status;
-};
+    unsigned int read_ahead;
 
-/**
- * entry iteration status for reporting
- */
-struct _CABX_ENTRY_ITER_REPORT_STATE {
+    /**
+     * not zero if source files read ahead, cabinets and temporary files
+     * are read or written through io ring
+     */
+    int io_ring;
 
     /**
-     * cabinet extension object
+     * directory whose files are added as entries instead of csv.
+     * NULL if entries are read from csv.
      */
-    CABX* cabx;
+    char* input_dir;
 
+    /**
+     * csv file of rules for files in input directory. NULL if no rule is
+     * used.
+     */
+    char* input_rules;
 
     /**
-     * output stream
+     * binary manifest file compiled from input. NULL if cabinets are
+     * generated.
      */
-    FILE* output_stream;
+    char* compile_manifest;
 };
 
-
-
 /**
- * generation status
+ * cabinet generation backend.
+ * The backend has the same interface with fci in cabinet.dll.
  */
-struct _CABX_GENERATION_STATUS {
-
+struct _CABX_BACKEND {
     /**
-     * cabinet object
+     * backend name
      */
-    CABX* cabx;
+    const char* name;
 
     /**
-     * cabinet configuration
+     * not zero if the backend accepts compressor options like preset in
+     * compression type
      */
-    CCAB* ccab;
+    int accept_compressor_options;
 
+    /**
+     * not zero if the backend can hold folders with different compression
+     * types in a cabinet
+     */
+    int mix_compression_types;
 
     /**
-     * end of generation
+     * create cabinet generation context
      */
-    int end_of_generation;
+    HFCI (DIAMONDAPI *create)(
+        PERF, PFNFCIFILEPLACED, PFNFCIALLOC, PFNFCIFREE,
+        PFNFCIOPEN, PFNFCIREAD, PFNFCIWRITE, PFNFCICLOSE, PFNFCISEEK,
+        PFNFCIDELETE, PFNFCIGETTEMPFILE, PCCAB, void*);
 
+    /**
+     * add a file into cabinet
+     */
+    BOOL (DIAMONDAPI *add_file)(
+        HFCI, LPSTR, LPSTR, BOOL, PFNFCIGETNEXTCABINET,
+        PFNFCISTATUS, PFNFCIGETOPENINFO, TCOMP);
 
     /**
-     * last file entry 
+     * complete the current cabinet
      */
-    cstr* last_file_entry;
+    BOOL (DIAMONDAPI *flush_cabinet)(
+        HFCI, BOOL, PFNFCIGETNEXTCABINET, PFNFCISTATUS);
 
     /**
-     * the begining cabinet name when the file is continuation for cabinet.
+     * complete the current folder
      */
-    cstr* starting_cabinet_name;
+    BOOL (DIAMONDAPI *flush_folder)(
+        HFCI, PFNFCIGETNEXTCABINET, PFNFCISTATUS);
 
     /**
-     * next cabinet name
+     * set count of threads compressing folders.
+     * NULL if the backend compresses folders only in calling thread.
      */
-    cstr* next_cabinet_name;
+    BOOL (DIAMONDAPI *set_jobs)(
+        HFCI, unsigned int);
 
     /**
-     * next disk name
+     * schedule source files compressed into a folder in background
      */
-    cstr* next_disk_name;
-};
+    BOOL (DIAMONDAPI *schedule_files)(
+        HFCI, LPSTR*, size_t, TCOMP);
 
+    /**
+     * set callbacks to map source files.
+     * NULL if the backend reads source files only with read callback.
+     */
+    BOOL (DIAMONDAPI *set_source_map)(
+        HFCI, PFNCABWRITERMAP, PFNCABWRITERUNMAP);
 
-/**
- * show help message
- */
-static int
-cabx_show_help(
-    CABX* obj);
+    /**
+     * set cache of compressed folders.
+     * NULL if the backend compresses all folders.
+     */
+    BOOL (DIAMONDAPI *set_folder_cache)(
+        HFCI, folder_cache*);
 
-/**
- * generate cabinet
- */
-static int
-cabx_generate(
-    CABX* obj);
-/**
- * add an entry
- */
-static int
-cabx_add_entry(
-    CABX* obj,
-    const char* source_path,
-    const char* entry_name,
-    int compression_code,
-    int attribute,
-    int execute,
-    int flush_folder,
-    int flush_cabinet);
+    /**
+     * destroy cabinet generation context
+     */
+    BOOL (DIAMONDAPI *destroy)(
+        HFCI);
+};
 
 /**
- * load entries 
+ * file handle passed to backend
  */
-static int
-cabx_load_entries(
-    CABX* obj);
+struct _CABX_FILE {
+    /**
+     * stream
+     */
+    FILE* stream;
 
-/**
- * create cabinet
- */
-static int
-cabx_create_cab(
-    CABX* obj,
-    HFCI fci_hdl,
-    CABX_GENERATION_STATUS* generation_status);
+    /**
+     * buffered writer for write only file. NULL for the other files.
+     */
+    buffered_writer* writer;
 
-/**
- * get non zero if all entries are belong into a cabinet.
- */
-static int
-cabx_is_generated_all(
-    CABX* obj);
+    /**
+     * temporary file held in memory. stream is NULL if this is not NULL.
+     */
+    temp_store_file* temp;
 
+    /**
+     * data read ahead from the beginning of source file.
+     * NULL if the file is not read ahead.
+     */
+    unsigned char* ahead_data;
 
-/**
- * report entry name cabinet map
- */
-static int
-cabx_report_cab_map(
-    CABX* obj);
+    /**
+     * size of data read ahead
+     */
+    size_t ahead_size;
+};
 
 /**
- * put cabinet output directory
+ * rule for files in input directory
  */
-static int
-cabx_put_cabinet_output_dir(
-    CABX* obj,
-    const char* cabinet_name,
-    const char* output_dir);
+struct _CABX_INPUT_RULE {
+    /**
+     * glob pattern matched with path from input directory
+     */
+    char* pattern;
 
-/**
- * remove last cabinet if it is empty
- */
-static int
-cabx_remove_last_cab_if_empty(
-    CABX* obj,
-    cstr* outdir,
-    cstr* cabinet_name);
+    /**
+     * not zero if the matched files are not added
+     */
+    int exclude;
 
-/**
- *  handle file path to for output directory
- */
-static int
-cabx_handle_file_path_for_output_dir(
-    CABX* obj,
-    const char* file_path,
-    int (*run)(CABX*, const char*, const char*, const char*));
+    /**
+     * compression code
+     */
+    int compression;
 
-/**
- * create output directory if directry is not exist.
- */
-static int
-cabx_create_output_dir_if_not(
-    CABX* obj,
-    const char* file_path,
-    const char* output_dir,
-    const char* file_name);
+    /**
+     * attribute
+     */
+    int attribute;
 
+    /**
+     * execute flag
+     */
+    int execute;
 
+    /**
+     * flush folder after the matched file
+     */
+    int flush_folder;
 
-/**
- * load entries from csv
- */
-static int
-cabx_load_entries_from_csv(
-    CABX* obj,
-    csv* csv_in);
+    /**
+     * flush cabinet after the matched file
+     */
+    int flush_cabinet;
+};
 
 /**
- * load csv input raw data 
+ * binary manifest loaded into memory
  */
-static int
-cabx_load_csv_input(
-    CABX* obj,
-    char** src,
-    size_t* src_size);
+struct _CABX_MANIFEST {
+    /**
+     * mapped manifest file
+     */
+    const void* data;
 
-/**
- * load csv from input
- */
-static csv*
-cabx_load_csv_from_input(
-    CABX* obj);
+    /**
+     * size of mapped manifest file
+     */
+    size_t data_size;
 
-/**
- * fill fci cab parameter
- */
-static int
-cabx_fill_cab_param(
-    CABX* obj,
-    CCAB* param);
+    /**
+     * records and string table in mapped manifest
+     */
+    bin_manifest view;
 
-/**
- * fill cabinet name
- */
-static int
-cabx_fill_cabinet_name(
-    CABX* obj,
-    int cab_index,
-    char* buffer,
-    size_t buffer_size);
+    /**
+     * an entry for each record. The entry is filled when the record is
+     * read, and its names point to the string table.
+     */
+    CABX_ENTRY* entries;
+};
 
 /**
- * fill disk name
+ * input of entries from csv, binary manifest or directory
  */
-static int
-cabx_fill_disk_name(
-    CABX* obj,
-    int disk_index,
-    char* buffer,
-    size_t buffer_size);
+struct _CABX_INPUT {
+    /**
+     * file descriptor. -1 if the file is owned by stream or not opened.
+     */
+    int fd;
 
-/**
- * copy cab path into buffer 
- */
-static int
-cabx_fill_cab_path(
-    CABX* obj,
-    const char* cab_name,
-    char* buffer,
-    size_t buffer_size);
-
-/**
- * entry iterator
- */
-static int
-cabx_entries_iter(
-    CABX_ENTRY_ITER_STATE* iter_state,
-    CABX_ENTRY* entry);
-/**
- * You get non zero if entry is last element.
- */
-static int
-cabx_entries_iter_is_end_of_entry(
-    CABX_ENTRY_ITER_STATE* iter_state);
+    /**
+     * stream to read csv. NULL if csv is read from mapped data.
+     */
+    FILE* stream;
 
-/**
- * entry iterator
- */
-static int
-cabx_entries_iter_for_reporting(
-    CABX_ENTRY_ITER_REPORT_STATE* iter_state,
-    CABX_ENTRY* entry);
+    /**
+     * mapped csv file
+     */
+    const void* data;
 
-/**
- * create option instance
- */
-static CABX_OPTION*
-cabx_option_create();
+    /**
+     * size of mapped csv file
+     */
+    size_t data_size;
 
-/**
- * free option instance
- */
-static void
-cabx_option_free(
-    CABX_OPTION* opt);
+    /**
+     * csv tokenizer. NULL if entries are taken from binary manifest or
+     * directory.
+     */
+    csv_stream* csv;
 
-/**
- * set input into option
- */
-static int
-cabx_option_set_input(
-    CABX_OPTION* opt,
-    const char* input);
+    /**
+     * binary manifest owned by cabx. NULL if entries are not read from
+     * binary manifest.
+     */
+    CABX_MANIFEST* manifest;
 
-/**
- * set output directory into option
- */
-static int
-cabx_option_set_output_dir(
-    CABX_OPTION* opt,
-    const char* output_dir);
+    /**
+     * index of the next record in binary manifest
+     */
+    size_t manifest_next;
 
-/**
- * set cabinet name into option
- */
-static int
-cabx_option_set_cabinet_name(
-    CABX_OPTION* opt,
-    const char* cabinet_name);
+    /**
+     * walker for input directory. NULL if entries are read from csv.
+     */
+    dir_walker* walker;
 
-/**
- * set disk name into option
- */
-static int
-cabx_option_set_disk_name(
-    CABX_OPTION* opt,
-    const char* disk_name);
+    /**
+     * rules for files in input directory
+     */
+    CABX_INPUT_RULE* rules;
 
-/**
- * set max cabinet size by string format into option
- */
-static int
-cabx_option_set_max_cabinet_size(
-    CABX_OPTION* opt,
-    const char* max_size);
+    /**
+     * count of rules
+     */
+    size_t rule_count;
+};
 
 /**
- * set cabinet folder threshold size by string format into option
+ * entries loaded while they are added into cabinet
  */
-static int
-cabx_option_set_folder_threshold(
-    CABX_OPTION* opt,
-    const char* threshold_size);
+struct _CABX_PIPELINE {
+    /**
+     * cabx object
+     */
+    CABX* cabx;
 
+    /**
+     * csv, binary manifest or directory input
+     */
+    CABX_INPUT input;
 
-/**
- * set report file into option
- */
-static int
-cabx_option_set_report(
-    CABX_OPTION* opt,
-    const char* output);
+    /**
+     * entries loaded and not added yet
+     */
+    bounded_queue* queue;
 
+    /**
+     * thread loading entries
+     */
+    thread_i_thread* loader;
 
+    /**
+     * result of loading entries
+     */
+    int result;
+};
 
 /**
  * cab entry
  */
-static CABX_ENTRY*
-cabx_entry_create_0();
+struct _CABX_ENTRY {
 
-/**
- * cab entry
- */
-static CABX_ENTRY*
-cabx_entry_create_1(
-    const char* src_name,
-    const char* entry_name,
-    int compression_code,
-    int attribute,
-    int executing,
-    int flush_folder,
-    int flush_cabinet);
+    /**
+     * reference count
+     */
+    unsigned int ref_count;
 
+    /**
+     * source file path
+     */
+    char* source_file;
+    
+    /**
+     * cab entry name
+     */
+    char* entry_name;
 
-/**
- * increment reference count
- */
-static unsigned int
-cabx_entry_retain(
-    CABX_ENTRY* entry);
+    /**
+     * compression kind
+     */
+    int compression;
 
-/**
- * decrement reference count
- */
-static unsigned int
-cabx_entry_release(
-    CABX_ENTRY* entry);
+    /**
+     * data attribute
+     */
+    int attribute;
 
-/**
- * decrement reference count
- */
-static void
-cabx_entry_release_1(
-    CABX_ENTRY* entry);
+    /**
+     * has executing flag
+     */
+    int execute;
 
-/**
- * copy entry object
- */
-static int
-cabx_entry_copy_ref(
-    CABX_ENTRY* src_entry,
-    CABX_ENTRY** dst_entry);
+    /**
+     * flush folder flat
+     */
+    int flush_folder;
 
-/**
- * calculate hash code
- */
-static int
-cabx_entry_hash_code(
-    CABX_ENTRY* entry);
+    /**
+     * flush cabinet flag
+     */
+    int flush_cabinet;
 
-/**
- * set source file
- */
-int
-cabx_entry_set_source_file(
-    CABX_ENTRY* entry,
-    const char* source_file);
+    /**
+     * entry name of the first entry having the same source contents.
+     * NULL if no other entry has the same contents.
+     */
+    char* duplicate_group;
 
-/**
- * set entry name
- */
-static int
-cabx_entry_set_entry_name(
-    CABX_ENTRY* entry,
-    const char* entry_name);
+    /**
+     * not zero if source file is checked and its status is kept
+     */
+    int source_checked;
 
-/**
- * encode  string
- */
-static int
-cabx_encode_str(
-    const char* src,
-    char** encoded,
-    int* attribute);
+    /**
+     * size of source file when it is checked. The stages arranging entries
+     * use it instead of getting the status again.
+     */
+    unsigned long long source_size;
 
-/**
- * decode string
- */
-static int
-cabx_decode_str(
-    const char* src,
-    char** decoded);
+    /**
+     * modified time of source file when it is checked
+     */
+    time_t source_mtime;
+
+    /**
+     * not zero if the entry is placed in the entries of binary manifest.
+     * Neither the entry nor its names are freed when it is released.
+     */
+    int in_manifest;
+};
 
 /**
- * set last file entry 
+ * entry iteration status
  */
-static int
-cabinet_generation_status_set_last_file_entry(
-    CABX_GENERATION_STATUS* obj,
-    cstr* last_file_entry);
+struct _CABX_ENTRY_ITER_STATE {
+    /**
+     * last compression type
+     */
 
+    int last_compression_type;
 
-/**
- * set starting cabinet name 
- */
-static int
-cabinet_generation_status_set_starting_cabinet_name(
-    CABX_GENERATION_STATUS* obj,
-    cstr* cabinet_name);
+    /**
+     * processed count
+     */
+    size_t processed_count;
+
+    /**
+     * fci handle
+     */
+    HFCI fci_handle;
+
+    /**
+     * backend to handle fci_handle
+     */
+    const CABX_BACKEND* backend;
+
+
+    /**
+     * generation status
+     */
+    CABX_GENERATION_STATUS* generation_status;
+
+    /**
+     * source files in the run to be scheduled
+     */
+    LPSTR* run_files;
+
+    /**
+     * count of source files in the run to be scheduled
+     */
+    size_t run_file_count;
+
+    /**
+     * compression type of the run to be scheduled
+     */
+    unsigned int run_compression_type;
+
+    /**
+     * entries in the run to be added after scheduling
+     */
+    CABX_ENTRY** run_entries;
+
+    /**
+     * capacity of run_files and run_entries
+     */
+    size_t run_capacity;
+
+    /**
+     * not zero if entries may come after the processed entries
+     */
+    int more_entries;
+};
 
 /**
- * set next cabinet name
+ * entry iteration status for reporting
  */
-static int
-cabinet_generation_status_set_next_cabinet_name(
-    CABX_GENERATION_STATUS* obj,
-    cstr* next_cabinet_name);
+struct _CABX_ENTRY_ITER_REPORT_STATE {
+
+    /**
+     * cabinet extension object
+     */
+    CABX* cabx;
+
+
+    /**
+     * output stream
+     */
+    FILE* output_stream;
+};
+
 
 
 /**
- * set disk name 
+ * generation status
  */
-static int
-cabinet_generation_status_set_next_disk_name(
-    CABX_GENERATION_STATUS* obj,
-    cstr* disk_name);
+struct _CABX_GENERATION_STATUS {
+
+    /**
+     * cabinet object
+     */
+    CABX* cabx;
+
+    /**
+     * cabinet configuration
+     */
+    CCAB* ccab;
+
+
+    /**
+     * end of generation
+     */
+    int end_of_generation;
+
+
+    /**
+     * last file entry 
+     */
+    cstr* last_file_entry;
+
+    /**
+     * the begining cabinet name when the file is continuation for cabinet.
+     */
+    cstr* starting_cabinet_name;
+
+    /**
+     * next cabinet name
+     */
+    cstr* next_cabinet_name;
+
+    /**
+     * next disk name
+     */
+    cstr* next_disk_name;
+
+    /**
+     * thread to write output files in background
+     */
+    worker_pool* write_pool;
+
+    /**
+     * temporary files held in memory
+     */
+    temp_store* temp_store;
+
+    /**
+     * source files read ahead in background. NULL if files are not read
+     * ahead.
+     */
+    read_ahead* read_ahead;
+};
 
 
 /**
- * add entry into cab name to entries map
+ * show help message
  */
 static int
-cabx_cab_entries_add_entry(
-    col_map* cab_entries_map,
-    cstr* cab_name,
-    cstr* entry_name);
+cabx_show_help(
+    CABX* obj);
 
 /**
- * get entry count of cab name to entries map
+ * generate cabinet
  */
 static int
-cabx_cab_entries_get_entry_count(
-    col_map* cab_entries_map,
-    cstr* cab_name,
-    size_t* count);
+cabx_generate(
+    CABX* obj);
 
 /**
- * allocate memory for fci
+ * estimate cabinets and report entries in them without generating
  */
-static void* 
-cabx_fci_alloc(unsigned long size);
+static int
+cabx_dry_run(
+    CABX* obj);
 
 /**
- * free memory for fci
+ * estimate cabinet which each entry is placed in.
+ * You have to free cabinet_sizes by cabx_i_mem_free.
  */
-static void 
-cabx_fci_free(void* heap_obj);
+static int
+cabx_estimate_cab_map(
+    CABX* obj,
+    unsigned long long** cabinet_sizes,
+    size_t* cabinet_count);
 
 /**
- * open file for fci
+ * add estimated cabinet size
  */
-static intptr_t 
-cabx_fci_open(
-    LPSTR file_path,
-    int open_flag,
-    int mode,
-    int *err,
-    void* user_data);
+static int
+cabx_estimate_add_cabinet(
+    unsigned long long** cabinet_sizes,
+    size_t* cabinet_count,
+    size_t* cabinet_capacity,
+    unsigned long long cabinet_size);
+
 /**
- * read data for fci
+ * put entry name and cabinet name into entry cabinet map
  */
-static unsigned int
-cabx_fci_read(
-    intptr_t file_hdl,
-    void* buffer,
-    unsigned int buffer_size,
-    int* err,
-    void* user_data);
+static int
+cabx_put_entry_cab_map(
+    CABX* obj,
+    const char* entry_name,
+    size_t cab_index);
 
 /**
- * write data for fci
+ * order, group and plan entries as options request
+ */
+static int
+cabx_arrange_entries(
+    CABX* obj);
+
+/**
+ * get compression type of entry with the global preset
  */
 static unsigned int
-cabx_fci_write(
-    intptr_t file_hdl,
-    void* buffer,
-    unsigned int buffer_size,
-    int* err,
-    void* user_data);
+cabx_get_entry_compression(
+    CABX* obj,
+    CABX_ENTRY* entry);
 
 /**
- * seek file for fci
+ * extract files from cabinet set
  */
-static long 
-cabx_fci_seek(
-    intptr_t file_hdl,
-    long dist,
-    int seek_type,
-    int *err,
-    void* user_data);
+static int
+cabx_extract(
+    CABX* obj);
 
 /**
- * close file for fci
+ * compile csv or directory input into binary manifest
  */
 static int
-cabx_fci_close(
-    intptr_t file_hdl,
-    int *err,
-    void* user_data);
+cabx_compile_manifest(
+    CABX* obj);
+
 /**
- * delete file for fci
+ * make safe relative path from file name in cabinet
  */
 static int
-cabx_fci_delete(
-    LPSTR file_path,
-    int *err,
-    void* user_data);
+cabx_extract_file_path(
+    CABX* obj,
+    const cab_reader_file* file,
+    char** file_path);
 /**
- * be called when a file is placed in cabinet.
+ * add an entry into entries and source path map
  */
 static int
-cabx_fci_file_placed(
-    PCCAB pccab,
-    char* file,
-    long file_size,
-    BOOL file_continuation,
-    void* user_data);
+cabx_register_entry(
+    CABX* obj,
+    CABX_ENTRY* entry);
 
 /**
- * get temporary file name
+ * create entry from csv row.
+ * You get NULL entry for the row which does not have enough cells.
  */
 static int
-cabx_fci_get_temporary_file_name(
-    char* temporary_file_path,
-    int file_path_size,
-    void* user_data);
+cabx_entry_create_from_row(
+    const char* const* cells,
+    size_t cell_count,
+    CABX_ENTRY** entry);
 
 /**
- * control next cabinet generating operation
+ * open csv, binary manifest or directory input
  */
 static int
-cabx_fci_get_next_cabinet(
-    CCAB* cab_param,
-    unsigned long previous_cab,
-    void* user_data);
-
+cabx_input_open(
+    CABX* obj,
+    CABX_INPUT* input);
 
 /**
- * progress
+ * close csv, binary manifest or directory input
  */
-static long 
-cabx_fci_progress(
-    unsigned int status,
-    unsigned long data_1,
-    unsigned long data_2,
-    void* user_data);
+static void
+cabx_input_close(
+    CABX_INPUT* input);
 
 /**
- * get file date time attribute as fat format
+ * read the next entry from input.
+ * You get 1 and entry, or NULL entry for the row or file which is not
+ * added. You get 0 if no entry is left, or -1 if an error occurs.
  */
-static intptr_t
-cabx_fci_get_open_info(
-    LPSTR file_path,
-    unsigned short* data,
-    unsigned short* time,
-    unsigned short* attr,
-    int* err,
-    void* user_data);
+static int
+cabx_input_read_entry(
+    CABX_INPUT* input,
+    CABX_ENTRY** entry);
 
+/**
+ * load binary manifest from the opened input file
+ */
+static int
+cabx_input_load_manifest(
+    CABX* obj,
+    CABX_INPUT* input,
+    size_t size);
 
 /**
- * get file path from stream handle.
- * You have to free memory by calling cabx_i_mem_free.
+ * get the entry for the record of binary manifest
  */
-static wchar_t*
-cabx_fci_get_file_path_from_stream_handle(
-    FILE* fs);
+static int
+cabx_manifest_get_entry(
+    CABX_MANIFEST* manifest,
+    size_t index,
+    CABX_ENTRY** entry);
 
 /**
- * default max cabinet size
+ * unmap binary manifest and free the entries in it
  */
-const unsigned long CABX_MAX_CABINET_SIZE_DEF = ULONG_MAX;
+static void
+cabx_manifest_free(
+    CABX_MANIFEST* manifest);
 
 /**
- * default folder threshold size
+ * load rules for files in input directory.
+ * The rule for files not matched with any rule in the file is appended.
  */
-const unsigned long CABX_FOLDER_THRESHOLD_DEF = ULONG_MAX;
+static int
+cabx_input_load_rules(
+    CABX_INPUT* input,
+    const char* rules_path);
 
+/**
+ * add a rule from csv row
+ */
+static int
+cabx_input_add_rule(
+    CABX_INPUT* input,
+    const char* const* cells,
+    size_t cell_count,
+    size_t* rule_capacity);
 
 /**
- * create cabinet generator instance
+ * create entry for the file in input directory.
+ * You get NULL entry if the file is excluded by rule.
+ */
+static int
+cabx_input_create_file_entry(
+    CABX_INPUT* input,
+    const char* file_path,
+    const char* relative_path,
+    CABX_ENTRY** entry);
+
+/**
+ * start loading entries in background
+ */
+static int
+cabx_pipeline_start(
+    CABX* obj,
+    CABX_PIPELINE* pipeline);
+
+/**
+ * stop loading entries and get the result of loading
+ */
+static int
+cabx_pipeline_finish(
+    CABX_PIPELINE* pipeline);
+
+/**
+ * load entries into pipeline queue
+ */
+static void
+cabx_pipeline_load(
+    void* arg);
+
+/**
+ * load entries 
+ */
+static int
+cabx_load_entries(
+    CABX* obj);
+
+/**
+ * create cabinet
+ */
+static int
+cabx_create_cab(
+    CABX* obj,
+    HFCI fci_hdl,
+    CABX_GENERATION_STATUS* generation_status);
+
+/**
+ * create cabinet from entries coming through pipeline
+ */
+static int
+cabx_create_cab_from_pipeline(
+    CABX* obj,
+    HFCI fci_hdl,
+    CABX_GENERATION_STATUS* generation_status,
+    CABX_PIPELINE* pipeline);
+
+/**
+ * add the entry coming through pipeline into cabinet.
+ * The flush requested by the entry is deferred if it is not known in a
+ * while whether the entry is the last.
+ */
+static int
+cabx_pipeline_iter(
+    CABX_ENTRY_ITER_STATE* iter_state,
+    CABX_PIPELINE* pipeline,
+    CABX_ENTRY* entry,
+    CABX_ENTRY** deferred_entry);
+
+/**
+ * schedule the run collected from pipeline and add the entries
+ */
+static int
+cabx_pipeline_iter_run(
+    CABX_ENTRY_ITER_STATE* iter_state,
+    CABX_PIPELINE* pipeline,
+    CABX_ENTRY** deferred_entry);
+
+/**
+ * append the entry into the run collected from pipeline
+ */
+static int
+cabx_pipeline_append_run(
+    CABX_ENTRY_ITER_STATE* iter_state,
+    CABX_ENTRY* entry);
+
+
+/**
+ * report entry name cabinet map
+ */
+static int
+cabx_report_cab_map(
+    CABX* obj);
+
+/**
+ * put cabinet output directory
+ */
+static int
+cabx_put_cabinet_output_dir(
+    CABX* obj,
+    const char* cabinet_name,
+    const char* output_dir);
+
+/**
+ * remove last cabinet if it is empty
+ */
+static int
+cabx_remove_last_cab_if_empty(
+    CABX* obj,
+    cstr* outdir,
+    cstr* cabinet_name);
+
+/**
+ *  handle file path to for output directory
+ */
+static int
+cabx_handle_file_path_for_output_dir(
+    CABX* obj,
+    const char* file_path,
+    int (*run)(CABX*, const char*, const char*, const char*));
+
+/**
+ * create output directory if directry is not exist.
+ */
+static int
+cabx_create_output_dir_if_not(
+    CABX* obj,
+    const char* file_path,
+    const char* output_dir,
+    const char* file_name);
+
+
+
+/**
+ * load entries from csv, binary manifest or directory input
+ */
+static int
+cabx_load_entries_from_input(
+    CABX* obj,
+    CABX_INPUT* input);
+
+/**
+ * place entries having the same source contents next to each other
+ */
+static int
+cabx_group_duplicates(
+    CABX* obj);
+
+/**
+ * check all source files can be read before entries are added
+ */
+static int
+cabx_check_sources(
+    CABX* obj);
+
+/**
+ * resolve AUTO compression of entries
+ */
+static int
+cabx_resolve_auto_compression(
+    CABX* obj);
+
+/**
+ * resolve AUTO compression of entries in array
+ */
+static int
+cabx_resolve_entries_compression(
+    CABX* obj,
+    CABX_ENTRY* const* entries,
+    size_t entry_count);
+
+/**
+ * order entries by extension and similarity of source contents
+ */
+static int
+cabx_order_entries(
+    CABX* obj);
+
+/**
+ * pack entries into cabinets by estimated compressed size
+ */
+static int
+cabx_plan_cabinets(
+    CABX* obj);
+
+/**
+ * pack items of entries in a range closed by flushing cabinet
+ */
+static int
+cabx_plan_cabinets_in_range(
+    CABX_ENTRY** entries,
+    size_t range_start,
+    const size_t* item_ends,
+    const unsigned long long* item_sizes,
+    size_t item_count,
+    unsigned long long capacity,
+    size_t* order,
+    size_t* order_count,
+    size_t* bins);
+
+/**
+ * get entries as array. You have to free the array by cabx_i_mem_free.
+ */
+static int
+cabx_get_entries(
+    CABX* obj,
+    CABX_ENTRY*** entries,
+    size_t* entry_count);
+
+/**
+ * replace entries with the entries in the order
+ */
+static int
+cabx_set_entries(
+    CABX* obj,
+    CABX_ENTRY* const* entries,
+    const size_t* order,
+    size_t entry_count);
+
+/**
+ * entry iterator collecting entries into array
+ */
+static int
+cabx_entries_iter_for_collecting(
+    CABX_ENTRY*** entries,
+    CABX_ENTRY* entry);
+
+/**
+ * fill fci cab parameter
+ */
+static int
+cabx_fill_cab_param(
+    CABX* obj,
+    CCAB* param);
+
+/**
+ * fill cabinet name
+ */
+static int
+cabx_fill_cabinet_name(
+    CABX* obj,
+    int cab_index,
+    char* buffer,
+    size_t buffer_size);
+
+/**
+ * fill disk name
+ */
+static int
+cabx_fill_disk_name(
+    CABX* obj,
+    int disk_index,
+    char* buffer,
+    size_t buffer_size);
+
+/**
+ * copy cab path into buffer 
+ */
+static int
+cabx_fill_cab_path(
+    CABX* obj,
+    const char* cab_name,
+    char* buffer,
+    size_t buffer_size);
+
+/**
+ * entry iterator
+ */
+static int
+cabx_entries_iter(
+    CABX_ENTRY_ITER_STATE* iter_state,
+    CABX_ENTRY* entry);
+
+/**
+ * add the entry into cabinet
+ */
+static int
+cabx_entries_iter_add(
+    CABX_ENTRY_ITER_STATE* iter_state,
+    CABX_ENTRY* entry);
+
+/**
+ * flush folder or cabinet as the entry requests
+ */
+static int
+cabx_entries_iter_flush(
+    CABX_ENTRY_ITER_STATE* iter_state,
+    CABX_ENTRY* entry);
+/**
+ * You get non zero if entry is last element.
+ */
+static int
+cabx_entries_iter_is_end_of_entry(
+    CABX_ENTRY_ITER_STATE* iter_state);
+
+/**
+ * schedule entries to be compressed in background
+ */
+static int
+cabx_schedule_entries(
+    CABX* obj,
+    CABX_ENTRY_ITER_STATE* iter_state);
+
+/**
+ * entry iterator for scheduling
+ */
+static int
+cabx_entries_iter_for_scheduling(
+    CABX_ENTRY_ITER_STATE* iter_state,
+    CABX_ENTRY* entry);
+
+/**
+ * schedule the run of entries collected by iterator
+ */
+static int
+cabx_entries_iter_schedule_run(
+    CABX_ENTRY_ITER_STATE* iter_state);
+
+/**
+ * entry iterator
+ */
+static int
+cabx_entries_iter_for_reporting(
+    CABX_ENTRY_ITER_REPORT_STATE* iter_state,
+    CABX_ENTRY* entry);
+
+/**
+ * create option instance
+ */
+static CABX_OPTION*
+cabx_option_create();
+
+/**
+ * free option instance
+ */
+static void
+cabx_option_free(
+    CABX_OPTION* opt);
+
+/**
+ * set input into option
+ */
+static int
+cabx_option_set_input(
+    CABX_OPTION* opt,
+    const char* input);
+
+/**
+ * set output directory into option
+ */
+static int
+cabx_option_set_output_dir(
+    CABX_OPTION* opt,
+    const char* output_dir);
+
+/**
+ * set cabinet name into option
+ */
+static int
+cabx_option_set_cabinet_name(
+    CABX_OPTION* opt,
+    const char* cabinet_name);
+
+/**
+ * set disk name into option
+ */
+static int
+cabx_option_set_disk_name(
+    CABX_OPTION* opt,
+    const char* disk_name);
+
+/**
+ * set max cabinet size by string format into option
+ */
+static int
+cabx_option_set_max_cabinet_size(
+    CABX_OPTION* opt,
+    const char* max_size);
+
+/**
+ * set cabinet folder threshold size by string format into option
+ */
+static int
+cabx_option_set_folder_threshold(
+    CABX_OPTION* opt,
+    const char* threshold_size);
+
+
+/**
+ * set report file into option
+ */
+static int
+cabx_option_set_report(
+    CABX_OPTION* opt,
+    const char* output);
+
+/**
+ * set cabinet generation backend by name into option
+ */
+static int
+cabx_option_set_backend(
+    CABX_OPTION* opt,
+    const char* backend_name);
+
+/**
+ * set compression preset by name into option
+ */
+static int
+cabx_option_set_compression_preset(
+    CABX_OPTION* opt,
+    const char* preset_name);
+
+/**
+ * set count of threads compressing folders into option
+ */
+static int
+cabx_option_set_jobs(
+    CABX_OPTION* opt,
+    const char* jobs);
+
+/**
+ * set percent of max cabinet size filled by planned entries into option
+ */
+static int
+cabx_option_set_plan_fill(
+    CABX_OPTION* opt,
+    const char* fill);
+
+/**
+ * set count of source files read ahead into option
+ */
+static int
+cabx_option_set_read_ahead(
+    CABX_OPTION* opt,
+    const char* count);
+
+/**
+ * set source access mode by name into option
+ */
+static int
+cabx_option_set_source_access(
+    CABX_OPTION* opt,
+    const char* access_name);
+
+/**
+ * set memory budget for temporary files by string format into option
+ */
+static int
+cabx_option_set_temp_memory(
+    CABX_OPTION* opt,
+    const char* size_str);
+
+/**
+ * set folder cache directory into option
+ */
+static int
+cabx_option_set_folder_cache(
+    CABX_OPTION* opt,
+    const char* dir_path);
+
+/**
+ * set cabinet to extract files from into option
+ */
+static int
+cabx_option_set_extract(
+    CABX_OPTION* opt,
+    const char* cab_path);
+
+/**
+ * set input directory into option
+ */
+static int
+cabx_option_set_input_dir(
+    CABX_OPTION* opt,
+    const char* dir_path);
+
+/**
+ * set rules file for input directory into option
+ */
+static int
+cabx_option_set_input_rules(
+    CABX_OPTION* opt,
+    const char* rules_path);
+
+/**
+ * set binary manifest file compiled from input into option
+ */
+static int
+cabx_option_set_compile_manifest(
+    CABX_OPTION* opt,
+    const char* manifest_path);
+
+/**
+ * get compression type passed to backend for the entry
+ */
+static unsigned int
+cabx_entries_iter_get_compression(
+    CABX_ENTRY_ITER_STATE* iter_state,
+    CABX_ENTRY* entry);
+
+
+
+/**
+ * cab entry
+ */
+static CABX_ENTRY*
+cabx_entry_create_0();
+
+/**
+ * cab entry
+ */
+static CABX_ENTRY*
+cabx_entry_create_1(
+    const char* src_name,
+    const char* entry_name,
+    int compression_code,
+    int attribute,
+    int executing,
+    int flush_folder,
+    int flush_cabinet);
+
+
+/**
+ * increment reference count
+ */
+static unsigned int
+cabx_entry_retain(
+    CABX_ENTRY* entry);
+
+/**
+ * decrement reference count
+ */
+static unsigned int
+cabx_entry_release(
+    CABX_ENTRY* entry);
+
+/**
+ * decrement reference count
+ */
+static void
+cabx_entry_release_1(
+    CABX_ENTRY* entry);
+
+/**
+ * copy entry object
+ */
+static int
+cabx_entry_copy_ref(
+    CABX_ENTRY* src_entry,
+    CABX_ENTRY** dst_entry);
+
+/**
+ * calculate hash code
+ */
+static int
+cabx_entry_hash_code(
+    CABX_ENTRY* entry);
+
+/**
+ * set source file
+ */
+int
+cabx_entry_set_source_file(
+    CABX_ENTRY* entry,
+    const char* source_file);
+
+/**
+ * set entry name
+ */
+static int
+cabx_entry_set_entry_name(
+    CABX_ENTRY* entry,
+    const char* entry_name);
+
+/**
+ * set entry name of the first entry having the same source contents
+ */
+static int
+cabx_entry_set_duplicate_group(
+    CABX_ENTRY* entry,
+    const char* entry_name);
+
+/**
+ * encode  string
+ */
+static int
+cabx_encode_str(
+    const char* src,
+    char** encoded,
+    int* attribute);
+
+/**
+ * decode string
+ */
+static int
+cabx_decode_str(
+    const char* src,
+    char** decoded);
+
+/**
+ * set last file entry 
+ */
+static int
+cabinet_generation_status_set_last_file_entry(
+    CABX_GENERATION_STATUS* obj,
+    cstr* last_file_entry);
+
+
+/**
+ * set starting cabinet name 
+ */
+static int
+cabinet_generation_status_set_starting_cabinet_name(
+    CABX_GENERATION_STATUS* obj,
+    cstr* cabinet_name);
+
+/**
+ * set next cabinet name
+ */
+static int
+cabinet_generation_status_set_next_cabinet_name(
+    CABX_GENERATION_STATUS* obj,
+    cstr* next_cabinet_name);
+
+
+/**
+ * set disk name 
+ */
+static int
+cabinet_generation_status_set_next_disk_name(
+    CABX_GENERATION_STATUS* obj,
+    cstr* disk_name);
+
+
+/**
+ * add entry into cab name to entries map
+ */
+static int
+cabx_cab_entries_add_entry(
+    col_map* cab_entries_map,
+    cstr* cab_name,
+    cstr* entry_name);
+
+/**
+ * get entry count of cab name to entries map
+ */
+static int
+cabx_cab_entries_get_entry_count(
+    col_map* cab_entries_map,
+    cstr* cab_name,
+    size_t* count);
+
+/**
+ * allocate memory for fci
+ */
+static void* 
+cabx_fci_alloc(unsigned long size);
+
+/**
+ * free memory for fci
+ */
+static void 
+cabx_fci_free(void* heap_obj);
+
+/**
+ * open file for fci
+ */
+static intptr_t 
+cabx_fci_open(
+    LPSTR file_path,
+    int open_flag,
+    int mode,
+    int *err,
+    void* user_data);
+/**
+ * read data for fci
+ */
+static unsigned int
+cabx_fci_read(
+    intptr_t file_hdl,
+    void* buffer,
+    unsigned int buffer_size,
+    int* err,
+    void* user_data);
+
+/**
+ * write data for fci
+ */
+static unsigned int
+cabx_fci_write(
+    intptr_t file_hdl,
+    void* buffer,
+    unsigned int buffer_size,
+    int* err,
+    void* user_data);
+
+/**
+ * seek file for fci
+ */
+static long 
+cabx_fci_seek(
+    intptr_t file_hdl,
+    long dist,
+    int seek_type,
+    int *err,
+    void* user_data);
+
+/**
+ * close file for fci
+ */
+static int
+cabx_fci_close(
+    intptr_t file_hdl,
+    int *err,
+    void* user_data);
+
+/**
+ * map source file for native backend
+ */
+static const void*
+cabx_fci_map(
+    intptr_t file_hdl,
+    unsigned long size,
+    int *err,
+    void* user_data);
+
+/**
+ * unmap source file for native backend
+ */
+static int
+cabx_fci_unmap(
+    const void* data,
+    unsigned long size,
+    int *err,
+    void* user_data);
+/**
+ * delete file for fci
+ */
+static int
+cabx_fci_delete(
+    LPSTR file_path,
+    int *err,
+    void* user_data);
+/**
+ * be called when a file is placed in cabinet.
+ */
+static int
+cabx_fci_file_placed(
+    PCCAB pccab,
+    char* file,
+    long file_size,
+    BOOL file_continuation,
+    void* user_data);
+
+/**
+ * get temporary file name
+ */
+static int
+cabx_fci_get_temporary_file_name(
+    char* temporary_file_path,
+    int file_path_size,
+    void* user_data);
+
+/**
+ * control next cabinet generating operation
+ */
+static int
+cabx_fci_get_next_cabinet(
+    CCAB* cab_param,
+    unsigned long previous_cab,
+    void* user_data);
+
+
+/**
+ * progress
+ */
+static long 
+cabx_fci_progress(
+    unsigned int status,
+    unsigned long data_1,
+    unsigned long data_2,
+    void* user_data);
+
+/**
+ * get file date time attribute as fat format
+ */
+static intptr_t
+cabx_fci_get_open_info(
+    LPSTR file_path,
+    unsigned short* data,
+    unsigned short* time,
+    unsigned short* attr,
+    int* err,
+    void* user_data);
+
+/**
+ * take source file read ahead as file handle for fci.
+ * You get NULL if the file is not read ahead.
+ */
+static CABX_FILE*
+cabx_fci_take_read_ahead(
+    read_ahead* ahead,
+    const char* file_path);
+
+
+#ifdef _WIN32
+/**
+ * get file path from stream handle.
+ * You have to free memory by calling cabx_i_mem_free.
+ */
+static wchar_t*
+cabx_fci_get_file_path_from_stream_handle(
+    FILE* fs);
+#endif
+
+/**
+ * default max cabinet size
+ */
+const unsigned long CABX_MAX_CABINET_SIZE_DEF = ULONG_MAX;
+
+/**
+ * default folder threshold size
+ */
+const unsigned long CABX_FOLDER_THRESHOLD_DEF = ULONG_MAX;
+
+/**
+ * default percent of max cabinet size filled by planned entries
+ */
+const unsigned int CABX_PLAN_FILL_DEF = 95;
+
+/**
+ * max count of source files read ahead
+ */
+const unsigned int CABX_READ_AHEAD_MAX = 256;
+
+/**
+ * size read ahead from the beginning of source file
+ */
+const size_t CABX_READ_AHEAD_SIZE = 0x100000;
+
+/**
+ * count of threads listing sub directories of input directory
+ */
+const unsigned int CABX_WALK_THREAD_COUNT = 4;
+
+/**
+ * size reserved for cabinet header and names of linked cabinets
+ */
+const unsigned long CABX_PLAN_CABINET_OVERHEAD = 0x400;
+
+/**
+ * size of cabinet header without reserved area and names
+ */
+const unsigned long CABX_CABINET_HEADER_SIZE = 36;
+
+/**
+ * size of folder entry
+ */
+const unsigned long CABX_PLAN_FOLDER_SIZE = 8;
+
+/**
+ * size of file entry without name
+ */
+const unsigned long CABX_PLAN_FILE_SIZE = 16;
+
+/**
+ * minimum source size to be mapped.
+ * Smaller files are read faster through stream than mapping.
+ */
+const unsigned long CABX_MAP_SIZE_MIN = 0x10000;
+
+/**
+ * buffer size to write output file
+ */
+const size_t CABX_WRITE_BUFFER_SIZE = 0x100000;
+
+/**
+ * default memory budget for temporary files
+ */
+const unsigned long CABX_TEMP_MEMORY_DEF = 0x10000000;
+
+/**
+ * count of entries loaded ahead in pipeline
+ */
+const size_t CABX_PIPELINE_QUEUE_SIZE = 0x400;
+
+/**
+ * milliseconds to wait for the next entry to know whether the entry
+ * requesting flush is the last
+ */
+const unsigned int CABX_PIPELINE_END_WAIT = 100;
+
+/**
+ * maximum source size to be mapped.
+ * Larger files are read through stream not to exhaust address space.
+ */
+const unsigned long CABX_MAP_SIZE_MAX = sizeof(void*) > 4 ?
+    0x7fffffffUL : 0x10000000UL;
+
+/**
+ * cabinet generation backends
+ */
+static const CABX_BACKEND CABX_BACKENDS[] = {
+#if FCI_COMPAT_HAVE_FCI
+    {
+        .name = "fci",
+        .accept_compressor_options = 0,
+        .mix_compression_types = 0,
+        .create = FCICreate,
+        .add_file = FCIAddFile,
+        .flush_cabinet = FCIFlushCabinet,
+        .flush_folder = FCIFlushFolder,
+        .set_jobs = NULL,
+        .schedule_files = NULL,
+        .set_source_map = NULL,
+        .set_folder_cache = NULL,
+        .destroy = FCIDestroy
+    },
+#endif
+    {
+        .name = "native",
+        .accept_compressor_options = 1,
+        .mix_compression_types = 1,
+        .create = cab_writer_create,
+        .add_file = cab_writer_add_file,
+        .flush_cabinet = cab_writer_flush_cabinet,
+        .flush_folder = cab_writer_flush_folder,
+        .set_jobs = cab_writer_set_jobs,
+        .schedule_files = cab_writer_schedule_files,
+        .set_source_map = cab_writer_set_source_map,
+        .set_folder_cache = cab_writer_set_folder_cache,
+        .destroy = cab_writer_destroy
+    }
+};
+
+/**
+ * compression preset names
+ */
+static const struct {
+    /**
+     * preset name
+     */
+    const char* name;
+
+    /**
+     * preset
+     */
+    unsigned int preset;
+} CABX_COMPRESSION_PRESETS[] = {
+    { "fast", CAB_COMPRESSOR_PRESET_FAST },
+    { "normal", CAB_COMPRESSOR_PRESET_NORMAL },
+    { "high", CAB_COMPRESSOR_PRESET_HIGH },
+    { "max", CAB_COMPRESSOR_PRESET_MAX }
+};
+
+/**
+ * default output directory
+ */
+#ifdef _WIN32
+#define CABX_OUTPUT_DIR_DEF ".\\"
+#else
+#define CABX_OUTPUT_DIR_DEF "./"
+#endif
+
+/**
+ * compression of files in input directory not matched with any rule
+ */
+#define CABX_INPUT_COMPRESSION_DEF "MSZIP"
+
+
+/**
+ * create cabinet generator instance
  */
 CABX*
 cabx_create()
 {
-    CABX* result;
-    CABX_OPTION* option;
-    col_list* entries;
-    col_map* source_path_entry_map;
-    col_map* entry_cab_map;
-    col_map* cab_entries_map;
-    col_map* cab_outdir_map;
-    result = (CABX*)cabx_i_mem_alloc(sizeof(CABX));
-    option = cabx_option_create();
-    entries = col_array_list_create(
-        10, 10,
-        (int (*)(void*))cabx_entry_hash_code,
-        (int (*)(const void*, void**))cabx_entry_copy_ref,
-        (void (*)(void*))cabx_entry_release_1);
+    CABX* result;
+    CABX_OPTION* option;
+    col_list* entries;
+    col_map* source_path_entry_map;
+    col_map* entry_cab_map;
+    col_map* cab_entries_map;
+    col_map* cab_outdir_map;
+    result = (CABX*)cabx_i_mem_alloc(sizeof(CABX));
+    option = cabx_option_create();
+    entries = col_array_list_create(
+        10, 10,
+        (int (*)(void*))cabx_entry_hash_code,
+        (int (*)(const void*, void**))cabx_entry_copy_ref,
+        (void (*)(void*))cabx_entry_release_1);
+
+    source_path_entry_map = col_rb_map_create(
+        (int (*)(const void*, const void*))cstr_compare,
+        (unsigned int (*)(const void*))cstr_hash,
+        (unsigned int (*)(const void*))cabx_entry_hash_code,
+        (int (*)(const void*, void**))cabx_entry_copy_ref,
+        (int (*)(const void*, void**))cstr_retain_1,
+        (void (*)(void*))cabx_entry_release_1,
+        (void (*)(void*))cstr_release_1);
+
+    entry_cab_map = col_rb_map_create(
+        (int (*)(const void*, const void*))cstr_compare,
+        (unsigned int (*)(const void*))cstr_hash,
+        (unsigned int (*)(const void*))cstr_hash,
+        (int (*)(const void*, void**))cstr_retain_1,
+        (int (*)(const void*, void**))cstr_retain_1,
+        (void (*)(void*))cstr_release_1,
+        (void (*)(void*))cstr_release_1);
+
+    cab_outdir_map = col_rb_map_create(
+        (int (*)(const void*, const void*))cstr_compare,
+        (unsigned int (*)(const void*))cstr_hash,
+        (unsigned int (*)(const void*))cstr_hash,
+        (int (*)(const void*, void**))cstr_retain_1,
+        (int (*)(const void*, void**))cstr_retain_1,
+        (void (*)(void*))cstr_release_1,
+        (void (*)(void*))cstr_release_1);
+
+    cab_entries_map = col_rb_map_create(
+        (int (*)(const void*, const void*))cstr_compare,
+        (unsigned int (*)(const void*))cstr_hash,
+        (unsigned int (*)(const void*))col_list_ref_hash,
+        (int (*)(const void*, void**))col_list_ref_copy_1,
+        (int (*)(const void*, void**))cstr_retain_1,
+        (void (*)(void*))col_list_ref_release,
+        (void (*)(void*))cstr_release_1);
+
+    if (result && option && entries && cab_outdir_map 
+        && source_path_entry_map && entry_cab_map && cab_entries_map) {
+        result->ref_count = 1;
+        result->run = cabx_generate;
+        result->option = option;
+        result->entries = entries;
+        result->source_path_entry_map = source_path_entry_map;
+        result->entry_cab_map = entry_cab_map;
+        result->cab_outdir_map = cab_outdir_map; 
+        result->cab_entries_map = cab_entries_map;
+        result->manifest = NULL;
+    } else {
+        if (cab_entries_map) {
+            col_map_free(cab_entries_map);
+        }
+        if (cab_outdir_map) {
+            col_map_free(cab_outdir_map); 
+        }
+        if (entry_cab_map) {
+            col_map_free(entry_cab_map);
+        }
+        if (source_path_entry_map) {
+            col_map_free(source_path_entry_map);
+        }
+        if (entries) {
+            col_list_free(entries);
+        }
+        if (option) {
+            cabx_option_free(option);
+        }
+        if (result) {
+            cabx_i_mem_free(result);
+            result = NULL;
+        }
+    }
+    return result;
+}
+
+
+/**
+ * increment reference count
+ */
+unsigned int
+cabx_retain(
+    CABX* obj)
+{
+    unsigned int result;
+    result = 0;
+    if (obj) {
+        result = ++obj->ref_count;
+    } else {
+        errno = EINVAL;
+    }
+    return result;
+}
+
+
+/**
+ * decrement reference count
+ */
+unsigned int
+cabx_release(
+    CABX* obj)
+{
+    unsigned int result;
+    result = 0;
+    if (obj) {
+        result = --obj->ref_count;
+        if (result == 0) {
+            col_map_free(obj->cab_entries_map);
+            col_map_free(obj->entry_cab_map);
+            col_map_free(obj->cab_outdir_map); 
+            col_map_free(obj->source_path_entry_map);
+            col_list_free(obj->entries);
+            /* entries in the manifest are released with the collections */
+            cabx_manifest_free(obj->manifest);
+            cabx_option_free(obj->option);
+            cabx_i_mem_free(obj);
+        }
+    } else {
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * parse command option 
+ */
+int
+cabx_parse_option(
+    CABX* obj,
+    int argc,
+    char* const * argv)
+{
+    int result;
+    struct option options[] = {
+        {
+            .name = "input",
+            .has_arg = required_argument,
+            .flag = NULL,
+            .val = 'i'
+        },
+        {
+            .name = "output",
+            .has_arg = required_argument,
+            .flag = NULL,
+            .val = 'o'
+        },
+        {
+            .name = "cab-name",
+            .has_arg = required_argument,
+            .flag = NULL,
+            .val = 'c'
+        },
+        {
+            .name = "disk-name",
+            .has_arg = required_argument,
+            .flag = NULL,
+            .val = 'd'
+        },
+        {
+            .name = "max-cabinet",
+            .has_arg = required_argument,
+            .flag = NULL,
+            .val = 'm'
+        },
+        {
+            .name = "folder-thresh",
+            .has_arg = required_argument,
+            .flag = NULL,
+            .val = 'f'
+        },
+        {
+            .name = "report",
+            .has_arg = optional_argument,
+            .flag = NULL,
+            .val = 'r'
+        },
+        {
+            .name = "show-status",
+            .has_arg = no_argument,
+            .val = 's'
+        },
+        {
+            .name = "backend",
+            .has_arg = required_argument,
+            .flag = NULL,
+            .val = 'b'
+        },
+        {
+            .name = "preset",
+            .has_arg = required_argument,
+            .flag = NULL,
+            .val = 'z'
+        },
+        {
+            .name = "jobs",
+            .has_arg = required_argument,
+            .flag = NULL,
+            .val = 'j'
+        },
+        {
+            .name = "source-access",
+            .has_arg = required_argument,
+            .flag = NULL,
+            .val = 'a'
+        },
+        {
+            .name = "write-thread",
+            .has_arg = no_argument,
+            .flag = NULL,
+            .val = 'w'
+        },
+        {
+            .name = "temp-memory",
+            .has_arg = required_argument,
+            .flag = NULL,
+            .val = 't'
+        },
+        {
+            .name = "pipeline",
+            .has_arg = no_argument,
+            .flag = NULL,
+            .val = 'p'
+        },
+        {
+            .name = "folder-cache",
+            .has_arg = required_argument,
+            .flag = NULL,
+            .val = 'k'
+        },
+        {
+            .name = "extract",
+            .has_arg = required_argument,
+            .flag = NULL,
+            .val = 'x'
+        },
+        {
+            .name = "group-duplicates",
+            .has_arg = no_argument,
+            .flag = NULL,
+            .val = 'g'
+        },
+        {
+            .name = "order-entries",
+            .has_arg = no_argument,
+            .flag = NULL,
+            .val = 'e'
+        },
+        {
+            .name = "plan-cabinets",
+            .has_arg = optional_argument,
+            .flag = NULL,
+            .val = 'l'
+        },
+        {
+            .name = "dry-run",
+            .has_arg = no_argument,
+            .flag = NULL,
+            .val = 'n'
+        },
+        {
+            .name = "read-ahead",
+            .has_arg = required_argument,
+            .flag = NULL,
+            .val = 'q'
+        },
+        {
+            .name = "io-ring",
+            .has_arg = no_argument,
+            .flag = NULL,
+            .val = 'u'
+        },
+        {
+            .name = "input-dir",
+            .has_arg = required_argument,
+            .flag = NULL,
+            .val = 'y'
+        },
+        {
+            .name = "input-rules",
+            .has_arg = required_argument,
+            .flag = NULL,
+            .val = 'v'
+        },
+        {
+            .name = "compile-manifest",
+            .has_arg = required_argument,
+            .flag = NULL,
+            .val = 'C'
+        },
+        {
+            .name = "help",
+            .has_arg = no_argument,
+            .flag = NULL,
+            .val = 'h'
+        },
+        { NULL, 0, NULL, 0 }
+    };
+    result = 0;
+    while (1) {
+        int opt;
+        opt = getopt_long(argc, argv,
+            "i:o:d:c:m:f:r::b:z:j:a:wt:pk:x:gel::nq:uy:v:C:hs", options, NULL);
+
+        switch (opt) {
+            case 'i':
+                result = cabx_option_set_input(obj->option, optarg);
+                break;
+            case 'c':
+                result = cabx_option_set_cabinet_name(obj->option, optarg);
+                break;
+            case 'd':
+                result = cabx_option_set_disk_name(obj->option, optarg);
+                break;
+            case 'm':
+                result = cabx_option_set_max_cabinet_size(obj->option, optarg);
+                break;
+            case 'f':
+                result = cabx_option_set_folder_threshold(obj->option, optarg);
+                break;
+            case 'r':
+                result = cabx_option_set_report(obj->option, optarg);
+                break;
+            case 'o':
+                result = cabx_option_set_output_dir(obj->option, optarg);
+                break;
+            case 's':
+                obj->option->show_status = 1;
+                break;
+            case 'b':
+                result = cabx_option_set_backend(obj->option, optarg);
+                break;
+            case 'z':
+                result = cabx_option_set_compression_preset(
+                    obj->option, optarg);
+                break;
+            case 'j':
+                result = cabx_option_set_jobs(obj->option, optarg);
+                break;
+            case 'a':
+                result = cabx_option_set_source_access(obj->option, optarg);
+                break;
+            case 'w':
+                obj->option->write_thread = 1;
+                break;
+            case 't':
+                result = cabx_option_set_temp_memory(obj->option, optarg);
+                break;
+            case 'p':
+                obj->option->pipeline = 1;
+                break;
+            case 'k':
+                result = cabx_option_set_folder_cache(obj->option, optarg);
+                break;
+            case 'x':
+                result = cabx_option_set_extract(obj->option, optarg);
+                if (result == 0) {
+                    obj->run = cabx_extract;
+                }
+                break;
+            case 'g':
+                obj->option->group_duplicates = 1;
+                break;
+            case 'e':
+                obj->option->order_entries = 1;
+                break;
+            case 'l':
+                result = cabx_option_set_plan_fill(obj->option, optarg);
+                break;
+            case 'n':
+                obj->option->dry_run = 1;
+                obj->run = cabx_dry_run;
+                break;
+            case 'q':
+                result = cabx_option_set_read_ahead(obj->option, optarg);
+                break;
+            case 'u':
+                obj->option->io_ring = 1;
+                break;
+            case 'y':
+                result = cabx_option_set_input_dir(obj->option, optarg);
+                break;
+            case 'v':
+                result = cabx_option_set_input_rules(obj->option, optarg);
+                break;
+            case 'C':
+                result = cabx_option_set_compile_manifest(obj->option,
+                    optarg);
+                if (result == 0) {
+                    obj->run = cabx_compile_manifest;
+                }
+                break;
+            case 'h':
+                obj->run = cabx_show_help;
+                break;
+            default:
+                break;
+        }
+        if (result) {
+            break;
+        }
+        if (opt == -1) {
+            break;
+        }
+    }
+
+    return result;    
+}
+
+
+/**
+ * show help message
+ */
+static int
+cabx_show_help(
+    CABX* obj)
+{
+    int result;
+    char* exe_name;
+    exe_name = exe_info_get_exe_name();
+    result = 0;
+    printf(
+"%s [OPTIONS]\n"
+"-i, --input= [INPUT]               specify cab entry csv file or binary\n"
+"                                   manifest.\n"
+"                                   default is - which means standard input.\n"
+"-o, --output= [OUTPUT]             specify output directory.\n"
+"                                   default current working directory.\n"
+"-c, --cab-name= [CAB]              specify cabinet file name template.\n"
+"                                   default \"data%%d.cab\"\n"
+"-d, --disk-name= [DISK]            specify disk name template.\n"
+"                                   default is empty (\"\") which means\n"
+"                                   not using disk\n"
+"-m, --max-cabinet= [SIZE][k|m]     specify maximum cabinet size.\n"
+"                                   default is %lu bytes\n"
+"-f, --folder-thresh= [SIZE][k|m]   specify folder threshold size.\n"
+"                                   default is %lu bytes\n"
+"-r, --report= [FILE]               specify report file.\n"
+"                                   if you set \"-\" as file, then print to\n"
+"                                   stdout.\n"
+"-s, --show-status                  show proccessing status.\n"
+"-b, --backend= [BACKEND]           specify cabinet generation backend.\n"
+"                                   fci: cabinet.dll (windows only)\n"
+"                                   native: builtin cabinet writer\n"
+"                                   default is %s\n"
+"-z, --preset= [PRESET]             specify compression preset for MSZIP\n"
+"                                   and LZX entries without preset in csv.\n"
+"                                   fast, normal, high or max\n"
+"                                   default is normal. native backend\n"
+"                                   only.\n"
+"-j, --jobs= [COUNT]                specify count of threads compressing\n"
+"                                   or extracting folders. 0 means count\n"
+"                                   of processors.\n"
+"                                   default is 1. native backend only.\n"
+"-a, --source-access= [ACCESS]      specify how to read source files.\n"
+"                                   map: compress from mapped memory\n"
+"                                   stream: read through stream\n"
+"                                   default is map. native backend only.\n"
+"-w, --write-thread                 write cabinet files or extracted files\n"
+"                                   in background thread.\n"
+"-t, --temp-memory= [SIZE][k|m]     specify memory budget for temporary\n"
+"                                   files. files exceeding the budget are\n"
+"                                   moved to disk. 0 means using disk only.\n"
+"                                   default is %lu bytes\n"
+"-p, --pipeline                     add entries into cabinet while the\n"
+"                                   rest of csv is loaded.\n"
+"-k, --folder-cache= [DIR]          keep compressed folders in directory\n"
+"                                   and reuse them for the same source\n"
+"                                   contents. native backend only.\n"
+"-x, --extract= [CAB]               extract files from cabinet set into\n"
+"                                   output directory.\n"
+"-g, --group-duplicates             place entries having the same source\n"
+"                                   contents next to each other in the\n"
+"                                   folder. the entries are reported with\n"
+"                                   the first entry of the group. csv is\n"
+"                                   loaded before entries are added.\n"
+"-e, --order-entries                order entries by file name extension and\n"
+"                                   similarity of source contents within\n"
+"                                   entries having the same compression\n"
+"                                   before flushing folder or cabinet. csv is\n"
+"                                   loaded before entries are added.\n"
+"-l, --plan-cabinets[=PERCENT]      pack entries into cabinets by compressed\n"
+"                                   size estimated from samples, so that a\n"
+"                                   file rarely continues into the next\n"
+"                                   cabinet. cabinets are filled up to\n"
+"                                   PERCENT of max cabinet size.\n"
+"                                   default is 95. used with -m.\n"
+"-n, --dry-run                      estimate cabinets from compressed\n"
+"                                   samples of sources without generating\n"
+"                                   them. entries are reported with the\n"
+"                                   estimated cabinet, to stdout if -r is\n"
+"                                   not specified, and estimated cabinet\n"
+"                                   sizes are printed to stderr.\n"
+"-q, --read-ahead= [COUNT]          open and read COUNT source files ahead\n"
+"                                   of the file being added in background\n"
+"                                   threads. 0 means no read ahead.\n"
+"                                   default is 0. ignored with -p, or with\n"
+"                                   -j or -k on native backend.\n"
+"-u, --io-ring                      read source files ahead and write\n"
+"                                   cabinets and temporary files through\n"
+"                                   io_uring with a few requests in flight.\n"
+"                                   pread and pwrite are used if io_uring\n"
+"                                   is not available.\n"
+"-y, --input-dir= [DIR]             add regular files in directory tree as\n"
+"                                   entries instead of csv. entries are\n"
+"                                   named by paths from DIR and sorted by\n"
+"                                   name in each directory. sub directories\n"
+"                                   are listed in background threads.\n"
+"-v, --input-rules= [FILE]          specify csv file of rules for files in\n"
+"                                   input directory. each row is\n"
+"                                   GLOB,COMPRESSION[,ATTRIBUTE[,EXECUTE\n"
+"                                   [,FLUSH_FOLDER[,FLUSH_CABINET]]]], and\n"
+"                                   the first rule matched with the path\n"
+"                                   from DIR is used. GLOB without '/' is\n"
+"                                   matched with file name. COMPRESSION -\n"
+"                                   excludes the files. files without rule\n"
+"                                   are compressed with %s.\n"
+"-C, --compile-manifest= [FILE]     compile csv or directory input into\n"
+"                                   binary manifest FILE instead of\n"
+"                                   generating cabinets. -i accepts the\n"
+"                                   binary manifest, and its entries are\n"
+"                                   used from mapped file without parsing.\n"
+"                                   the manifest is valid for cabx built\n"
+"                                   for the same byte order.\n"
+"-h                                 show this message\n",
+        exe_name,
+        CABX_MAX_CABINET_SIZE_DEF,
+        CABX_FOLDER_THRESHOLD_DEF,
+        CABX_BACKENDS[0].name,
+        CABX_TEMP_MEMORY_DEF,
+        CABX_INPUT_COMPRESSION_DEF);
 
-    source_path_entry_map = col_rb_map_create(
-        (int (*)(const void*, const void*))cstr_compare,
-        (unsigned int (*)(const void*))cstr_hash,
-        (unsigned int (*)(const void*))cstr_hash,
-        (int (*)(const void*, void**))cstr_retain_1,
-        (int (*)(const void*, void**))cstr_retain_1,
-        (void (*)(void*))cstr_release_1,
-        (void (*)(void*))cstr_release_1);
 
-    entry_cab_map = col_rb_map_create(
-        (int (*)(const void*, const void*))cstr_compare,
-        (unsigned int (*)(const void*))cstr_hash,
-        (unsigned int (*)(const void*))cstr_hash,
-        (int (*)(const void*, void**))cstr_retain_1,
-        (int (*)(const void*, void**))cstr_retain_1,
-        (void (*)(void*))cstr_release_1,
-        (void (*)(void*))cstr_release_1);
+    if (exe_name) {
+        exe_info_free(exe_name);
+    }
 
-    cab_outdir_map = col_rb_map_create(
-        (int (*)(const void*, const void*))cstr_compare,
-        (unsigned int (*)(const void*))cstr_hash,
-        (unsigned int (*)(const void*))cstr_hash,
-        (int (*)(const void*, void**))cstr_retain_1,
-        (int (*)(const void*, void**))cstr_retain_1,
-        (void (*)(void*))cstr_release_1,
-        (void (*)(void*))cstr_release_1);
+    return result;
+}
 
-    cab_entries_map = col_rb_map_create(
-        (int (*)(const void*, const void*))cstr_compare,
-        (unsigned int (*)(const void*))cstr_hash,
-        (unsigned int (*)(const void*))col_list_ref_hash,
-        (int (*)(const void*, void**))col_list_ref_copy_1,
-        (int (*)(const void*, void**))cstr_retain_1,
-        (void (*)(void*))col_list_ref_release,
-        (void (*)(void*))cstr_release_1);
+/**
+ * load entries 
+ */
+static int
+cabx_load_entries(
+    CABX* obj)
+{
+    int result;
+    CABX_INPUT input;
+    result = cabx_input_open(obj, &input);
+    if (result == 0) {
+        result = cabx_load_entries_from_input(obj, &input);
+        cabx_input_close(&input);
+    }
+    return result;
+}
+ 
+/**
+ * load entries from csv, binary manifest or directory input
+ */
+static int
+cabx_load_entries_from_input(
+    CABX* obj,
+    CABX_INPUT* input)
+{
+    int result;
+    result = 0;
+    while (1) {
+        CABX_ENTRY* entry;
+        int state;
+        state = cabx_input_read_entry(input, &entry);
+        if (state <= 0) {
+            result = state;
+            break;
+        }
+        if (entry) {
+            result = cabx_register_entry(obj, entry);
+            cabx_entry_release(entry);
+        }
+        if (result) {
+            break;
+        }
+    }
+    return result;
+}
 
-    if (result && option && entries && cab_outdir_map 
-        && source_path_entry_map && entry_cab_map && cab_entries_map) {
-        result->ref_count = 1;
-        result->run = cabx_generate;
-        result->option = option;
-        result->entries = entries;
-        result->source_path_entry_map = source_path_entry_map;
-        result->entry_cab_map = entry_cab_map;
-        result->cab_outdir_map = cab_outdir_map; 
-        result->cab_entries_map = cab_entries_map;
-    } else {
-        if (cab_entries_map) {
-            col_map_free(cab_entries_map);
+/**
+ * compile csv or directory input into binary manifest
+ */
+static int
+cabx_compile_manifest(
+    CABX* obj)
+{
+    int result;
+    CABX_INPUT input;
+    int input_opened;
+    FILE* stream;
+    bin_manifest_writer* writer;
+    stream = NULL;
+    writer = NULL;
+    result = cabx_input_open(obj, &input);
+    input_opened = result == 0;
+    if (result == 0) {
+        stream = file_i_fopen(obj->option->compile_manifest, "wb");
+        result = stream ? 0 : -1;
+    }
+    if (result == 0) {
+        setvbuf(stream, NULL, _IOFBF, CABX_WRITE_BUFFER_SIZE);
+        writer = bin_manifest_writer_create(stream);
+        result = writer ? 0 : -1;
+    }
+    while (result == 0) {
+        CABX_ENTRY* entry;
+        int state;
+        state = cabx_input_read_entry(&input, &entry);
+        if (state <= 0) {
+            result = state;
+            break;
         }
-        if (cab_outdir_map) {
-            col_map_free(cab_outdir_map); 
+        if (entry) {
+            result = bin_manifest_writer_add(writer,
+                entry->source_file, entry->entry_name,
+                entry->compression, entry->attribute, entry->execute,
+                entry->flush_folder, entry->flush_cabinet);
+            cabx_entry_release(entry);
         }
-        if (entry_cab_map) {
-            col_map_free(entry_cab_map);
+    }
+    if (result == 0) {
+        result = bin_manifest_writer_finish(writer);
+    }
+    if (writer) {
+        bin_manifest_writer_free(writer);
+    }
+    if (stream) {
+        if (fclose(stream) && result == 0) {
+            result = -1;
+        }
+    }
+    if (result && stream) {
+        fprintf(stderr, "can not compile binary manifest: %s\n",
+            obj->option->compile_manifest);
+    } else if (input_opened && !stream) {
+        fprintf(stderr, "can not open binary manifest: %s\n",
+            obj->option->compile_manifest);
+    }
+    if (input_opened) {
+        cabx_input_close(&input);
+    }
+    return result;
+}
+
+/**
+ * check all source files can be read before entries are added.
+ * Source files are opened in jobs threads, and their sizes and modified times
+ * are kept in entries. All entries whose source file can not be read are
+ * reported, then you get non zero.
+ */
+static int
+cabx_check_sources(
+    CABX* obj)
+{
+    int result;
+    size_t entry_count;
+    CABX_ENTRY** entries;
+    const char** source_files;
+    file_i_stat_info* infos;
+    int* errors;
+    size_t idx;
+    source_files = NULL;
+    infos = NULL;
+    errors = NULL;
+    result = cabx_get_entries(obj, &entries, &entry_count);
+    if (result == 0) {
+        source_files = (const char**)cabx_i_mem_alloc(
+            sizeof(char*) * (entry_count + 1));
+        infos = (file_i_stat_info*)cabx_i_mem_alloc(
+            sizeof(file_i_stat_info) * (entry_count + 1));
+        errors = (int*)cabx_i_mem_alloc(sizeof(int) * (entry_count + 1));
+        result = source_files && infos && errors ? 0 : -1;
+    }
+    if (result == 0) {
+        for (idx = 0; idx < entry_count; idx++) {
+            source_files[idx] = entries[idx]->source_file;
+        }
+        result = file_check_all(source_files, entry_count,
+            obj->option->jobs, infos, errors);
+    }
+    if (result == 0) {
+        size_t bad_count;
+        bad_count = 0;
+        for (idx = 0; idx < entry_count; idx++) {
+            if (errors[idx]) {
+                fprintf(stderr, "can not read source file for %s: %s: %s\n",
+                    entries[idx]->entry_name, entries[idx]->source_file,
+                    strerror(errors[idx]));
+                bad_count++;
+            } else {
+                entries[idx]->source_checked = 1;
+                entries[idx]->source_size = infos[idx].size;
+                entries[idx]->source_mtime = infos[idx].mtime;
+            }
+        }
+        if (bad_count) {
+            fprintf(stderr, "%lu of %lu source files can not be read\n",
+                (unsigned long)bad_count, (unsigned long)entry_count);
+            errno = EINVAL;
+            result = -1;
+        }
+    }
+    if (errors) {
+        cabx_i_mem_free(errors);
+    }
+    if (infos) {
+        cabx_i_mem_free(infos);
+    }
+    if (source_files) {
+        cabx_i_mem_free(source_files);
+    }
+    if (entries) {
+        cabx_i_mem_free(entries);
+    }
+    return result;
+}
+
+/**
+ * resolve AUTO compression of entries
+ */
+static int
+cabx_resolve_auto_compression(
+    CABX* obj)
+{
+    int result;
+    size_t entry_count;
+    CABX_ENTRY** entries;
+    result = cabx_get_entries(obj, &entries, &entry_count);
+    if (result == 0) {
+        result = cabx_resolve_entries_compression(obj, entries, entry_count);
+    }
+    if (entries) {
+        cabx_i_mem_free(entries);
+    }
+    return result;
+}
+
+/**
+ * resolve AUTO compression of entries in array.
+ * The entry whose source file looks incompressible is stored without
+ * compression, and the other entry keeps the compression without AUTO.
+ * Source files are not probed if the backend can not hold folders with
+ * different compression, because changing compression closes the cabinet.
+ */
+static int
+cabx_resolve_entries_compression(
+    CABX* obj,
+    CABX_ENTRY* const* entries,
+    size_t entry_count)
+{
+    int result;
+    size_t* auto_entries;
+    const char** source_files;
+    unsigned long long* file_sizes;
+    int* incompressible;
+    size_t auto_count;
+    size_t idx;
+    auto_count = 0;
+    source_files = NULL;
+    file_sizes = NULL;
+    incompressible = NULL;
+    auto_entries = (size_t*)cabx_i_mem_alloc(
+        sizeof(size_t) * (entry_count + 1));
+    result = auto_entries ? 0 : -1;
+    if (result == 0) {
+        for (idx = 0; idx < entry_count; idx++) {
+            if (entries[idx]->compression & CAB_COMPRESSOR_AUTO) {
+                entries[idx]->compression &= ~(int)CAB_COMPRESSOR_AUTO;
+                auto_entries[auto_count++] = idx;
+            }
+        }
+    }
+    if (result == 0 && auto_count
+        && obj->option->backend->mix_compression_types) {
+        source_files = (const char**)cabx_i_mem_alloc(
+            sizeof(char*) * auto_count);
+        file_sizes = (unsigned long long*)cabx_i_mem_alloc(
+            sizeof(unsigned long long) * auto_count);
+        incompressible = (int*)cabx_i_mem_alloc(sizeof(int) * auto_count);
+        result = source_files && file_sizes && incompressible ? 0 : -1;
+        for (idx = 0; result == 0 && idx < auto_count; idx++) {
+            source_files[idx] = entries[auto_entries[idx]]->source_file;
+            file_sizes[idx] = entries[auto_entries[idx]]->source_size;
+        }
+        if (result == 0) {
+            result = cab_probe_files(source_files, file_sizes, auto_count,
+                obj->option->jobs, incompressible);
+        }
+        for (idx = 0; result == 0 && idx < auto_count; idx++) {
+            if (incompressible[idx]) {
+                entries[auto_entries[idx]]->compression = tcompTYPE_NONE;
+            }
+        }
+    }
+    if (incompressible) {
+        cabx_i_mem_free(incompressible);
+    }
+    if (file_sizes) {
+        cabx_i_mem_free(file_sizes);
+    }
+    if (source_files) {
+        cabx_i_mem_free(source_files);
+    }
+    if (auto_entries) {
+        cabx_i_mem_free(auto_entries);
+    }
+    return result;
+}
+
+/**
+ * place entries having the same source contents next to each other.
+ * Entries are moved only within the range closed by the entry which
+ * flushes folder or cabinet, and only next to the entries with the same
+ * compression, so that they are compressed into the same folder.
+ */
+static int
+cabx_group_duplicates(
+    CABX* obj)
+{
+    int result;
+    size_t entry_count;
+    CABX_ENTRY** entries;
+    const char** source_files;
+    unsigned long long* file_sizes;
+    size_t* groups;
+    size_t* next_members;
+    size_t* order;
+    unsigned char* placed;
+    size_t order_count;
+    size_t idx;
+    source_files = NULL;
+    file_sizes = NULL;
+    groups = NULL;
+    next_members = NULL;
+    order = NULL;
+    placed = NULL;
+    order_count = 0;
+    result = cabx_get_entries(obj, &entries, &entry_count);
+    if (result == 0) {
+        source_files = (const char**)cabx_i_mem_alloc(
+            sizeof(char*) * (entry_count + 1));
+        file_sizes = (unsigned long long*)cabx_i_mem_alloc(
+            sizeof(unsigned long long) * (entry_count + 1));
+        groups = (size_t*)cabx_i_mem_alloc(
+            sizeof(size_t) * (entry_count + 1));
+        next_members = (size_t*)cabx_i_mem_alloc(
+            sizeof(size_t) * (entry_count + 1));
+        order = (size_t*)cabx_i_mem_alloc(sizeof(size_t) * (entry_count + 1));
+        placed = (unsigned char*)cabx_i_mem_alloc(entry_count + 1);
+        result = source_files && file_sizes && groups && next_members
+            && order && placed ? 0 : -1;
+    }
+    if (result == 0) {
+        for (idx = 0; idx < entry_count; idx++) {
+            source_files[idx] = entries[idx]->source_file;
+            file_sizes[idx] = entries[idx]->source_size;
         }
-        if (source_path_entry_map) {
-            col_map_free(source_path_entry_map);
+        result = dup_finder_find(source_files, file_sizes, entry_count,
+            obj->option->jobs, groups);
+    }
+    if (result == 0) {
+        /* link members of a group in entry order from the first entry */
+        for (idx = 0; idx < entry_count; idx++) {
+            next_members[idx] = entry_count;
+            placed[idx] = 0;
         }
-        if (entries) {
-            col_list_free(entries);
+        for (idx = entry_count; idx > 0; idx--) {
+            if (groups[idx - 1] != idx - 1) {
+                next_members[idx - 1] = next_members[groups[idx - 1]];
+                next_members[groups[idx - 1]] = idx - 1;
+            }
         }
-        if (option) {
-            cabx_option_free(option);
+    }
+    if (result == 0) {
+        size_t range_start;
+        range_start = 0;
+        for (idx = 0; idx < entry_count; idx++) {
+            size_t range_last;
+            size_t fixed_entry;
+            size_t entry_idx;
+            if (!entries[idx]->flush_folder && !entries[idx]->flush_cabinet
+                && idx + 1 < entry_count) {
+                continue;
+            }
+            range_last = idx;
+            /* the entry flushing folder has to be kept at the last */
+            if (entries[idx]->flush_folder || entries[idx]->flush_cabinet) {
+                fixed_entry = idx;
+            } else {
+                fixed_entry = entry_count;
+            }
+            for (entry_idx = range_start; entry_idx <= range_last;
+                entry_idx++) {
+                size_t member;
+                if (placed[entry_idx] || entry_idx == fixed_entry) {
+                    continue;
+                }
+                placed[entry_idx] = 1;
+                order[order_count++] = entry_idx;
+                for (member = next_members[entry_idx];
+                    member <= range_last; member = next_members[member]) {
+                    if (!placed[member] && member != fixed_entry
+                        && entries[member]->compression
+                            == entries[entry_idx]->compression) {
+                        placed[member] = 1;
+                        order[order_count++] = member;
+                    }
+                }
+            }
+            if (fixed_entry != entry_count) {
+                placed[fixed_entry] = 1;
+                order[order_count++] = fixed_entry;
+            }
+            range_start = idx + 1;
         }
-        if (result) {
-            cabx_i_mem_free(result);
-            result = NULL;
+    }
+    for (idx = 0; result == 0 && idx < entry_count; idx++) {
+        if (groups[idx] != idx || next_members[idx] != entry_count) {
+            result = cabx_entry_set_duplicate_group(entries[idx],
+                entries[groups[idx]]->entry_name);
         }
     }
+    if (result == 0) {
+        result = cabx_set_entries(obj, entries, order, order_count);
+    }
+    if (placed) {
+        cabx_i_mem_free(placed);
+    }
+    if (order) {
+        cabx_i_mem_free(order);
+    }
+    if (next_members) {
+        cabx_i_mem_free(next_members);
+    }
+    if (groups) {
+        cabx_i_mem_free(groups);
+    }
+    if (source_files) {
+        cabx_i_mem_free(source_files);
+    }
+    if (entries) {
+        cabx_i_mem_free(entries);
+    }
     return result;
 }
 
-
 /**
- * increment reference count
+ * order entries by extension and similarity of source contents.
+ * Entries are ordered within the range closed by the entry which flushes
+ * folder or cabinet, and entries having the same compression are placed
+ * together. The entry flushing folder or cabinet is kept at the last.
  */
-unsigned int
-cabx_retain(
+static int
+cabx_order_entries(
     CABX* obj)
 {
-    unsigned int result;
-    result = 0;
-    if (obj) {
-        result = ++obj->ref_count;
-    } else {
-        errno = EINVAL;
+    int result;
+    size_t entry_count;
+    CABX_ENTRY** entries;
+    const char** source_files;
+    unsigned long long* file_sizes;
+    size_t* classes;
+    size_t* range_classes;
+    size_t* order;
+    size_t idx;
+    source_files = NULL;
+    file_sizes = NULL;
+    classes = NULL;
+    range_classes = NULL;
+    order = NULL;
+    result = cabx_get_entries(obj, &entries, &entry_count);
+    if (result == 0) {
+        source_files = (const char**)cabx_i_mem_alloc(
+            sizeof(char*) * (entry_count + 1));
+        file_sizes = (unsigned long long*)cabx_i_mem_alloc(
+            sizeof(unsigned long long) * (entry_count + 1));
+        classes = (size_t*)cabx_i_mem_alloc(
+            sizeof(size_t) * (entry_count + 1));
+        range_classes = (size_t*)cabx_i_mem_alloc(
+            sizeof(size_t) * (entry_count + 1));
+        order = (size_t*)cabx_i_mem_alloc(sizeof(size_t) * (entry_count + 1));
+        result = source_files && file_sizes && classes && range_classes
+            && order ? 0 : -1;
+    }
+    if (result == 0) {
+        size_t range_class_count;
+        range_class_count = 0;
+        for (idx = 0; idx < entry_count; idx++) {
+            source_files[idx] = entries[idx]->source_file;
+            file_sizes[idx] = entries[idx]->source_size;
+            if (entries[idx]->flush_folder || entries[idx]->flush_cabinet) {
+                /* the entry is the last one in the range */
+                classes[idx] = idx;
+                range_class_count = 0;
+            } else {
+                size_t class_idx;
+                /* class is the first entry having the same compression
+                   in the range */
+                for (class_idx = 0; class_idx < range_class_count;
+                    class_idx++) {
+                    if (entries[range_classes[class_idx]]->compression
+                        == entries[idx]->compression) {
+                        break;
+                    }
+                }
+                if (class_idx == range_class_count) {
+                    range_classes[range_class_count++] = idx;
+                }
+                classes[idx] = range_classes[class_idx];
+            }
+        }
+        result = similarity_order_sort(source_files, file_sizes, classes,
+            entry_count, obj->option->jobs, order);
+    }
+    if (result == 0) {
+        result = cabx_set_entries(obj, entries, order, entry_count);
+    }
+    if (order) {
+        cabx_i_mem_free(order);
+    }
+    if (range_classes) {
+        cabx_i_mem_free(range_classes);
+    }
+    if (classes) {
+        cabx_i_mem_free(classes);
+    }
+    if (file_sizes) {
+        cabx_i_mem_free(file_sizes);
+    }
+    if (source_files) {
+        cabx_i_mem_free(source_files);
+    }
+    if (entries) {
+        cabx_i_mem_free(entries);
     }
     return result;
 }
 
-
 /**
- * decrement reference count
+ * pack entries into cabinets by estimated compressed size.
+ * Entries up to the entry flushing folder are packed as an item, and the
+ * other entries are packed one by one. Items are packed within the range
+ * closed by the entry flushing cabinet. The last entry of each packed
+ * cabinet flushes cabinet.
  */
-unsigned int
-cabx_release(
+static int
+cabx_plan_cabinets(
     CABX* obj)
 {
-    unsigned int result;
-    result = 0;
-    if (obj) {
-        result = --obj->ref_count;
-        if (result == 0) {
-            col_map_free(obj->cab_entries_map);
-            col_map_free(obj->entry_cab_map);
-            col_map_free(obj->cab_outdir_map); 
-            col_map_free(obj->source_path_entry_map);
-            col_list_free(obj->entries);
-            cabx_option_free(obj->option);
-            cabx_i_mem_free(obj);
-        }
+    int result;
+    size_t entry_count;
+    CABX_ENTRY** entries;
+    const char** source_files;
+    unsigned long long* file_sizes;
+    unsigned int* types_compress;
+    unsigned long long* sizes;
+    size_t* item_ends;
+    unsigned long long* item_sizes;
+    size_t* order;
+    size_t* bins;
+    size_t order_count;
+    unsigned long long capacity;
+    size_t idx;
+    source_files = NULL;
+    file_sizes = NULL;
+    types_compress = NULL;
+    sizes = NULL;
+    item_ends = NULL;
+    item_sizes = NULL;
+    order = NULL;
+    bins = NULL;
+    order_count = 0;
+    entries = NULL;
+    entry_count = 0;
+    capacity = (unsigned long long)obj->option->max_cabinet_size
+        / 100 * obj->option->plan_fill;
+    if (capacity > CABX_PLAN_CABINET_OVERHEAD) {
+        capacity -= CABX_PLAN_CABINET_OVERHEAD;
     } else {
-        errno = EINVAL;
+        capacity = 0;
+    }
+    if (obj->option->max_cabinet_size != CABX_MAX_CABINET_SIZE_DEF
+        && capacity) {
+        result = cabx_get_entries(obj, &entries, &entry_count);
+    } else {
+        /* cabinet size is not limited enough to plan */
+        result = 0;
+    }
+    if (result == 0 && entries) {
+        source_files = (const char**)cabx_i_mem_alloc(
+            sizeof(char*) * (entry_count + 1));
+        file_sizes = (unsigned long long*)cabx_i_mem_alloc(
+            sizeof(unsigned long long) * (entry_count + 1));
+        types_compress = (unsigned int*)cabx_i_mem_alloc(
+            sizeof(unsigned int) * (entry_count + 1));
+        sizes = (unsigned long long*)cabx_i_mem_alloc(
+            sizeof(unsigned long long) * (entry_count + 1));
+        item_ends = (size_t*)cabx_i_mem_alloc(
+            sizeof(size_t) * (entry_count + 1));
+        item_sizes = (unsigned long long*)cabx_i_mem_alloc(
+            sizeof(unsigned long long) * (entry_count + 1));
+        order = (size_t*)cabx_i_mem_alloc(sizeof(size_t) * (entry_count + 1));
+        bins = (size_t*)cabx_i_mem_alloc(sizeof(size_t) * (entry_count + 1));
+        result = source_files && file_sizes && types_compress && sizes
+            && item_ends && item_sizes && order && bins ? 0 : -1;
+    }
+    if (result == 0 && entries) {
+        for (idx = 0; idx < entry_count; idx++) {
+            source_files[idx] = entries[idx]->source_file;
+            file_sizes[idx] = entries[idx]->source_size;
+            types_compress[idx] = cabx_get_entry_compression(obj,
+                entries[idx]);
+        }
+        result = cab_planner_estimate(source_files, file_sizes,
+            types_compress, entry_count, obj->option->jobs, sizes);
+    }
+    if (result == 0 && entries) {
+        size_t range_start;
+        range_start = 0;
+        for (idx = 0; result == 0 && idx < entry_count; idx++) {
+            size_t folder_last;
+            size_t item_count;
+            int item_open;
+            size_t entry_idx;
+            if (!entries[idx]->flush_cabinet && idx + 1 < entry_count) {
+                continue;
+            }
+            folder_last = entry_count;
+            for (entry_idx = range_start; entry_idx < idx; entry_idx++) {
+                if (entries[entry_idx]->flush_folder) {
+                    folder_last = entry_idx;
+                }
+            }
+            item_count = 0;
+            item_open = 0;
+            for (entry_idx = range_start; entry_idx <= idx; entry_idx++) {
+                if (!item_open) {
+                    item_sizes[item_count] = CABX_PLAN_FOLDER_SIZE;
+                    item_count++;
+                    item_open = 1;
+                }
+                item_sizes[item_count - 1] += sizes[entry_idx]
+                    + CABX_PLAN_FILE_SIZE
+                    + strlen(entries[entry_idx]->entry_name) + 1;
+                item_ends[item_count - 1] = entry_idx;
+                /* entries up to the last entry flushing folder are bound */
+                if (folder_last == entry_count || entry_idx >= folder_last
+                    || entries[entry_idx]->flush_folder) {
+                    item_open = 0;
+                }
+            }
+            result = cabx_plan_cabinets_in_range(entries, range_start,
+                item_ends, item_sizes, item_count, capacity,
+                order, &order_count, bins);
+            range_start = idx + 1;
+        }
+    }
+    if (result == 0 && entries) {
+        result = cabx_set_entries(obj, entries, order, order_count);
+    }
+    if (bins) {
+        cabx_i_mem_free(bins);
+    }
+    if (order) {
+        cabx_i_mem_free(order);
+    }
+    if (item_sizes) {
+        cabx_i_mem_free(item_sizes);
+    }
+    if (item_ends) {
+        cabx_i_mem_free(item_ends);
+    }
+    if (sizes) {
+        cabx_i_mem_free(sizes);
+    }
+    if (types_compress) {
+        cabx_i_mem_free(types_compress);
+    }
+    if (file_sizes) {
+        cabx_i_mem_free(file_sizes);
+    }
+    if (source_files) {
+        cabx_i_mem_free(source_files);
+    }
+    if (entries) {
+        cabx_i_mem_free(entries);
     }
     return result;
 }
 
 /**
- * parse command option 
+ * pack items of entries in a range closed by flushing cabinet.
+ * Entries of packed items are put into order cabinet by cabinet and the
+ * last entry of each cabinet except the last one flushes cabinet.
  */
-int
-cabx_parse_option(
-    CABX* obj,
-    int argc,
-    char* const * argv)
+static int
+cabx_plan_cabinets_in_range(
+    CABX_ENTRY** entries,
+    size_t range_start,
+    const size_t* item_ends,
+    const unsigned long long* item_sizes,
+    size_t item_count,
+    unsigned long long capacity,
+    size_t* order,
+    size_t* order_count,
+    size_t* bins)
 {
     int result;
-    struct option options[] = {
-        {
-            .name = "input",
-            .has_arg = required_argument,
-            .flag = NULL,
-            .val = 'i'
-        },
-        {
-            .name = "output",
-            .has_arg = required_argument,
-            .flag = NULL,
-            .val = 'o'
-        },
-        {
-            .name = "cab-name",
-            .has_arg = required_argument,
-            .flag = NULL,
-            .val = 'c'
-        },
-        {
-            .name = "disk-name",
-            .has_arg = required_argument,
-            .flag = NULL,
-            .val = 'd'
-        },
-        {
-            .name = "max-cabinet",
-            .has_arg = required_argument,
-            .flag = NULL,
-            .val = 'm'
-        },
-        {
-            .name = "folder-thresh",
-            .has_arg = required_argument,
-            .flag = NULL,
-            .val = 'f'
-        },
-        {
-            .name = "report",
-            .has_arg = optional_argument,
-            .flag = NULL,
-            .val = 'r'
-        },
-        {
-            .name = "show-status",
-            .has_arg = no_argument,
-            .val = 's'
-        },
-        {
-            .name = "help",
-            .has_arg = no_argument,
-            .flag = NULL,
-            .val = 'h'
-        },
-        { NULL, 0, NULL, 0 }
-    };
-    result = 0;
-    while (1) {
-        int opt;
-        opt = getopt_long(argc, argv,
-            "i:o:d:c:m:f:r::hs", options, NULL);
-
-        switch (opt) {
-            case 'i':
-                result = cabx_option_set_input(obj->option, optarg);
-                break;
-            case 'c':
-                result = cabx_option_set_cabinet_name(obj->option, optarg);
-                break;
-            case 'd':
-                result = cabx_option_set_disk_name(obj->option, optarg);
-                break;
-            case 'm':
-                result = cabx_option_set_max_cabinet_size(obj->option, optarg);
-                break;
-            case 'f':
-                result = cabx_option_set_folder_threshold(obj->option, optarg);
-                break;
-            case 'r':
-                result = cabx_option_set_report(obj->option, optarg);
-                break;
-            case 'o':
-                result = cabx_option_set_output_dir(obj->option, optarg);
-                break;
-            case 's':
-                obj->option->show_status = 1;
-                break;
-            case 'h':
-                obj->run = cabx_show_help;
-                break;
-            default:
-                break;
+    size_t bin_count;
+    size_t* bin_items;
+    size_t* next_items;
+    size_t idx;
+    bin_count = 0;
+    bin_items = NULL;
+    next_items = NULL;
+    result = cab_planner_pack(item_sizes, item_count, capacity,
+        bins, &bin_count);
+    if (result == 0) {
+        bin_items = (size_t*)cabx_i_mem_alloc(
+            sizeof(size_t) * (bin_count + 1));
+        next_items = (size_t*)cabx_i_mem_alloc(
+            sizeof(size_t) * (item_count + 1));
+        result = bin_items && next_items ? 0 : -1;
+    }
+    if (result == 0) {
+        /* link items in a bin in the order of items */
+        for (idx = 0; idx < bin_count; idx++) {
+            bin_items[idx] = item_count;
         }
-        if (result) {
-            break;
+        for (idx = item_count; idx > 0; idx--) {
+            next_items[idx - 1] = bin_items[bins[idx - 1]];
+            bin_items[bins[idx - 1]] = idx - 1;
         }
-        if (opt == -1) {
-            break;
+        for (idx = 0; idx < bin_count; idx++) {
+            size_t item_idx;
+            for (item_idx = bin_items[idx]; item_idx < item_count;
+                item_idx = next_items[item_idx]) {
+                size_t entry_idx;
+                entry_idx = item_idx ? item_ends[item_idx - 1] + 1
+                    : range_start;
+                for (; entry_idx <= item_ends[item_idx]; entry_idx++) {
+                    order[(*order_count)++] = entry_idx;
+                }
+            }
+            if (idx + 1 < bin_count) {
+                entries[order[*order_count - 1]]->flush_cabinet = 1;
+            }
         }
     }
-
-    return result;    
+    if (next_items) {
+        cabx_i_mem_free(next_items);
+    }
+    if (bin_items) {
+        cabx_i_mem_free(bin_items);
+    }
+    return result;
+}
+
+/**
+ * get entries as array. You have to free the array by cabx_i_mem_free.
+ */
+static int
+cabx_get_entries(
+    CABX* obj,
+    CABX_ENTRY*** entries,
+    size_t* entry_count)
+{
+    int result;
+    CABX_ENTRY** entries_ptr;
+    *entry_count = col_list_size(obj->entries);
+    *entries = (CABX_ENTRY**)cabx_i_mem_alloc(
+        sizeof(CABX_ENTRY*) * (*entry_count + 1));
+    result = *entries ? 0 : -1;
+    if (result == 0) {
+        entries_ptr = *entries;
+        result = col_list_forward_iterate(obj->entries,
+            (int (*)(void*, const void*))cabx_entries_iter_for_collecting,
+            &entries_ptr);
+    }
+    return result;
+}
+
+/**
+ * replace entries with the entries in the order
+ */
+static int
+cabx_set_entries(
+    CABX* obj,
+    CABX_ENTRY* const* entries,
+    const size_t* order,
+    size_t entry_count)
+{
+    int result;
+    col_list* new_entries;
+    size_t idx;
+    new_entries = col_array_list_create(
+        10, 10,
+        (int (*)(void*))cabx_entry_hash_code,
+        (int (*)(const void*, void**))cabx_entry_copy_ref,
+        (void (*)(void*))cabx_entry_release_1);
+    result = new_entries ? 0 : -1;
+    for (idx = 0; result == 0 && idx < entry_count; idx++) {
+        result = col_list_append(new_entries, entries[order[idx]]);
+    }
+    if (result == 0) {
+        col_list_free(obj->entries);
+        obj->entries = new_entries;
+        new_entries = NULL;
+    }
+    if (new_entries) {
+        col_list_free(new_entries);
+    }
+    return result;
 }
 
+/**
+ * entry iterator collecting entries into array
+ */
+static int
+cabx_entries_iter_for_collecting(
+    CABX_ENTRY*** entries,
+    CABX_ENTRY* entry)
+{
+    **entries = entry;
+    (*entries)++;
+    return 0;
+}
 
 /**
- * show help message
+ * create entry from csv row.
+ * You get NULL entry for the row which does not have enough cells.
  */
 static int
-cabx_show_help(
-    CABX* obj)
+cabx_entry_create_from_row(
+    const char* const* cells,
+    size_t cell_count,
+    CABX_ENTRY** entry)
 {
     int result;
-    char* exe_name;
-    exe_name = exe_info_get_exe_name();
+    const char* source_path;
+    const char* entry_name;
+    const char* compression_str;
+    const char* attr_str;
+    const char* execute_str;
+    const char* flush_folder_str;
+    const char* flush_cabinet_str;
     result = 0;
-    printf(
-"%s [OPTIONS]\n"
-"-i, --input= [INPUT]               specify cab entry csv file.\n"
-"                                   default is - which means standard input.\n"
-"-o, --output= [OUTPUT]             specify output directory.\n"
-"                                   default current working directory.\n"
-"-c, --cab-name= [CAB]              specify cabinet file name template.\n"
-"                                   default \"data%%d.cab\"\n"
-"-d, --disk-name= [DISK]            specify disk name template.\n"
-"                                   default is empty (\"\") which means\n"
-"                                   not using disk\n"
-"-m, --max-cabinet= [SIZE][k|m]     specify maximum cabinet size.\n"
-"                                   default is %lu bytes\n"
-"-f, --folder-thresh= [SIZE][k|m]   specify folder threshold size.\n"
-"                                   default is %lu bytes\n"
-"-r, --report= [FILE]               specify report file.\n"
-"                                   if you set \"-\" as file, then print to\n"
-"                                   stdout.\n"
-"-s, --show-status                  show proccessing status.\n"
-"-h                                 show this message\n",
-        exe_name,
-        CABX_MAX_CABINET_SIZE_DEF,
-        CABX_FOLDER_THRESHOLD_DEF);
-
+    *entry = NULL;
+    source_path = cell_count > 0 ? cells[0] : NULL;
+    entry_name = cell_count > 1 ? cells[1] : NULL;
+    compression_str = cell_count > 2 ? cells[2] : NULL;
+    attr_str = cell_count > 3 ? cells[3] : NULL;
+    execute_str = cell_count > 4 ? cells[4] : NULL;
+    flush_folder_str = cell_count > 5 ? cells[5] : NULL;
+    flush_cabinet_str = cell_count > 6 ? cells[6] : NULL;
+
+    if (source_path && entry_name && compression_str && attr_str) {
+        int compression_code;
+        int attr;
+        int execute;
+        int flush_folder;
+        int flush_cabinet;
+        attr = 0;
+        compression_code = 0;
+        execute = 0;
+        flush_folder = 0;
+        flush_cabinet = 0;
+        result = number_parser_str_to_int(attr_str, 10, &attr);
+
+        if (result == 0 && execute_str && execute_str[0]) {
+            result = number_parser_str_to_int(
+                execute_str, 10, &execute);
+        }
+        if (result == 0 && flush_folder_str && flush_folder_str[0]) {
+            result = number_parser_str_to_int(
+                flush_folder_str, 10, &flush_folder);
+        }
+        if (result == 0 && flush_cabinet_str && flush_cabinet_str[0]) {
+            result = number_parser_str_to_int(
+                flush_cabinet_str, 10, &flush_cabinet);
+        }
 
-    if (exe_name) {
-        exe_info_free(exe_name);
+        if (result == 0) {
+            result = name_compression_str_to_code(
+                compression_str, &compression_code);        
+        }
+        if (result == 0) {
+            *entry = cabx_entry_create_1(
+                source_path, entry_name, compression_code, attr,
+                execute, flush_folder, flush_cabinet);
+            result = *entry ? 0 : -1;
+        }
     }
-
     return result;
 }
 
 /**
- * load entries 
+ * add an entry into entries and source path map
  */
 static int
-cabx_load_entries(
-    CABX* obj)
+cabx_register_entry(
+    CABX* obj,
+    CABX_ENTRY* entry)
 {
     int result;
-    csv* csv_input;
-    result = 0;
+    cstr* source_path_cstr;
+    source_path_cstr = NULL;
+
+    result = col_list_append(obj->entries, entry);
 
-    csv_input = cabx_load_csv_from_input(obj);
-    result = csv_input ? 0 : -1;
     if (result == 0) {
-        result = cabx_load_entries_from_csv(obj, csv_input);
+        source_path_cstr = cstr_create_00(
+            entry->source_file, strlen(entry->source_file),
+            (void* (*)(unsigned int))cabx_i_mem_alloc,
+            cabx_i_mem_free);
+        result = source_path_cstr ? 0 : -1;
     }
-
-    if (csv_input) {
-        csv_release(csv_input);
+    if (result == 0) {
+        result = col_map_put(obj->source_path_entry_map,
+            source_path_cstr, entry);
+    }
+    if (source_path_cstr) {
+        cstr_release(source_path_cstr);
     }
     return result;
 }
- 
+
 /**
- * load entries from csv
+ * open csv, binary manifest or directory input
  */
 static int
-cabx_load_entries_from_csv(
+cabx_input_open(
     CABX* obj,
-    csv* csv_in)
+    CABX_INPUT* input)
 {
     int result;
-    unsigned int r_idx;
+    memset(input, 0, sizeof(*input));
+    input->fd = -1;
     result = 0;
-    for (r_idx = 0; r_idx < csv_get_row_count(csv_in); r_idx++) {
-        char* source_path;
-        char* entry_name;
-        char* compression_str;
-        char* attr_str;
-        char* execute_str;
-        char* flush_folder_str;
-        char* flush_cabinet_str;
-        result = 0;
-        source_path = NULL;
-        entry_name = NULL;
-        compression_str = NULL;
-        attr_str = NULL;
-        execute_str = NULL;
-        flush_folder_str = NULL;
-        flush_cabinet_str = NULL;
-        csv_get_value(csv_in, r_idx, 0, &source_path);
-        csv_get_value(csv_in, r_idx, 1, &entry_name);
-        csv_get_value(csv_in, r_idx, 2, &compression_str);
-        csv_get_value(csv_in, r_idx, 3, &attr_str);
-        csv_get_value(csv_in, r_idx, 4, &execute_str);
-        csv_get_value(csv_in, r_idx, 5, &flush_folder_str);
-        csv_get_value(csv_in, r_idx, 6, &flush_cabinet_str);
-
-        if (source_path && entry_name && compression_str && attr_str) {
-            int compression_code;
-            int state;
-            int attr;
-            int execute;
-            int flush_folder;
-            int flush_cabinet;
-            cstr* source_path_cstr;
-            cstr* entry_name_cstr;
-            attr = 0;
-            compression_code = 0;
-            execute = 0;
-            flush_folder = 0;
-            flush_cabinet = 0;
-            source_path_cstr = NULL;
-            entry_name_cstr = NULL;
-            state = number_parser_str_to_int(attr_str, 10, &attr);
-
-            if (state == 0 && execute_str && strlen(execute_str)) {
-                state = number_parser_str_to_int(
-                    execute_str, 10, &execute);
-            }
-            if (state == 0 && flush_folder_str && strlen(flush_folder_str)) {
-                state = number_parser_str_to_int(
-                    flush_folder_str, 10, &flush_folder);
-            }
-            if (state == 0 && flush_cabinet_str && strlen(flush_cabinet_str)) {
-                state = number_parser_str_to_int(
-                    flush_cabinet_str, 10, &flush_cabinet);
+    if (obj->option->input_dir) {
+        result = cabx_input_load_rules(input, obj->option->input_rules);
+        if (result == 0) {
+            input->walker = dir_walker_create(obj->option->input_dir,
+                CABX_WALK_THREAD_COUNT);
+            result = input->walker ? 0 : -1;
+        }
+    } else if (strcmp(obj->option->input, "-") == 0) {
+        input->stream = stdin;
+    } else {
+        input->fd = file_i_open(obj->option->input, O_RDONLY, 0);
+        result = input->fd >= 0 ? 0 : -1;
+    }
+    if (result == 0 && input->fd >= 0) {
+        file_i_stat_info stat_content;
+        char head[sizeof(bin_manifest_header)];
+        int is_regular;
+        is_regular = file_i_fstat(input->fd, &stat_content) == 0
+            && stat_content.is_regular;
+        if (is_regular && stat_content.size <= SIZE_MAX
+            && file_i_pread(input->fd, head, sizeof(head), 0)
+                == (long long)sizeof(head)
+            && bin_manifest_is_manifest(head, sizeof(head))) {
+            result = cabx_input_load_manifest(obj, input,
+                (size_t)stat_content.size);
+        } else if (is_regular
+            && stat_content.size >= CABX_MAP_SIZE_MIN
+            && stat_content.size <= CABX_MAP_SIZE_MAX) {
+            input->data_size = (size_t)stat_content.size;
+            input->data = file_i_map(input->fd, input->data_size);
+        }
+        if (result == 0 && !input->data && !input->manifest) {
+            input->stream = file_i_fdopen(input->fd, "rb");
+            result = input->stream ? 0 : -1;
+            if (input->stream) {
+                input->fd = -1;
             }
+        }
+    }
+    if (result == 0 && !input->walker && !input->manifest) {
+        if (input->data) {
+            input->csv = csv_stream_create_1(
+                (const char*)input->data, input->data_size);
+        } else {
+            input->csv = csv_stream_create(input->stream);
+        }
+        result = input->csv ? 0 : -1;
+    }
+    if (result) {
+        cabx_input_close(input);
+    }
+    return result;
+}
 
-            if (state == 0) {
-                state = name_compression_str_to_code(
-                    compression_str, &compression_code);        
-            }
-            if (state == 0) {
-                state = cabx_add_entry(
-                    obj, source_path, entry_name, compression_code, attr,
-                    execute, flush_folder, flush_cabinet);
-            }
+/**
+ * close csv, binary manifest or directory input.
+ * The binary manifest is kept by cabx.
+ */
+static void
+cabx_input_close(
+    CABX_INPUT* input)
+{
+    if (input->csv) {
+        csv_stream_free(input->csv);
+        input->csv = NULL;
+    }
+    if (input->data) {
+        file_i_unmap(input->data, input->data_size);
+        input->data = NULL;
+    }
+    if (input->stream) {
+        if (input->stream != stdin) {
+            fclose(input->stream);
+        }
+        input->stream = NULL;
+    }
+    if (input->fd >= 0) {
+        close(input->fd);
+        input->fd = -1;
+    }
+    if (input->walker) {
+        dir_walker_free(input->walker);
+        input->walker = NULL;
+    }
+    input->manifest = NULL;
+    if (input->rules) {
+        size_t idx;
+        for (idx = 0; idx < input->rule_count; idx++) {
+            cabx_i_mem_free(input->rules[idx].pattern);
+        }
+        cabx_i_mem_free(input->rules);
+        input->rules = NULL;
+        input->rule_count = 0;
+    }
+}
 
-            if (state == 0) {
-                source_path_cstr = cstr_create_00(
-                    source_path, strlen(source_path),
-                    (void* (*)(unsigned int))cabx_i_mem_alloc,
-                    cabx_i_mem_free);
-                state = source_path_cstr ? 0 : -1;
-            }
-            if (state == 0) {
-                entry_name_cstr = cstr_create_00(
-                    entry_name, strlen(entry_name),
-                    (void* (*)(unsigned int))cabx_i_mem_alloc, 
-                    cabx_i_mem_free);
-            }
-            if (state == 0) {
-                state = col_map_put(obj->source_path_entry_map,
-                    source_path_cstr, entry_name_cstr);
-            }
-            if (source_path_cstr) {
-                cstr_release(source_path_cstr);
+/**
+ * read the next entry from input
+ */
+static int
+cabx_input_read_entry(
+    CABX_INPUT* input,
+    CABX_ENTRY** entry)
+{
+    int result;
+    *entry = NULL;
+    if (input->walker) {
+        const char* file_path;
+        const char* relative_path;
+        result = dir_walker_next(input->walker, &file_path, &relative_path);
+        if (result > 0) {
+            if (cabx_input_create_file_entry(input,
+                file_path, relative_path, entry)) {
+                result = -1;
             }
-            if (entry_name_cstr) {
-                cstr_release(entry_name_cstr);
+        } else if (result < 0 && dir_walker_get_error_dir(input->walker)) {
+            fprintf(stderr, "can not list directory %s: %s\n",
+                dir_walker_get_error_dir(input->walker), strerror(errno));
+        }
+    } else if (input->manifest) {
+        result = 0;
+        if (input->manifest_next < input->manifest->view.record_count) {
+            result = cabx_manifest_get_entry(input->manifest,
+                input->manifest_next, entry) == 0 ? 1 : -1;
+            if (result < 0) {
+                fprintf(stderr, "invalid record %lu in binary manifest\n",
+                    (unsigned long)input->manifest_next);
             }
-            result = state;
+            input->manifest_next++;
         }
-        {
-            size_t res_idx;
-            char* str_res[] = {
-                source_path,
-                entry_name,
-                compression_str,
-                attr_str,
-                execute_str,
-                flush_folder_str,
-                flush_cabinet_str
-            };
-            for (res_idx = 0;
-                res_idx < sizeof(str_res) / sizeof(str_res[0]); 
-                res_idx++) {
-                cabx_i_mem_free(str_res[res_idx]);
+    } else {
+        const char* const* cells;
+        size_t cell_count;
+        result = csv_stream_read_row(input->csv, &cells, &cell_count);
+        if (result > 0) {
+            if (cabx_entry_create_from_row(cells, cell_count, entry)) {
+                result = -1;
             }
-        }  
-        if (result) {
-            break;
         }
     }
     return result;
 }
 
 /**
- * add an entry
+ * load binary manifest from the opened input file.
+ * The manifest is mapped and kept by cabx, since the loaded entries point
+ * to its string table.
  */
 static int
-cabx_add_entry(
+cabx_input_load_manifest(
     CABX* obj,
-    const char* source_path,
-    const char* entry_name,
-    int compression_code,
-    int attribute,
-    int execute,
-    int flush_folder,
-    int flush_cabinet)
+    CABX_INPUT* input,
+    size_t size)
 {
     int result;
-    CABX_ENTRY* entry;
-    result = 0;
-
-    entry = cabx_entry_create_1(
-        source_path, entry_name, compression_code, attribute,
-        execute, flush_folder, flush_cabinet);
-    result = entry ? 0 : -1; 
-
+    CABX_MANIFEST* manifest;
+    manifest = NULL;
+    if (obj->manifest) {
+        /* the entries of the manifest loaded before may be used */
+        errno = EBUSY;
+        result = -1;
+    } else {
+        manifest = (CABX_MANIFEST*)cabx_i_mem_alloc(sizeof(CABX_MANIFEST));
+        result = manifest ? 0 : -1;
+    }
     if (result == 0) {
-        result = col_list_append(obj->entries, entry);
+        memset(manifest, 0, sizeof(*manifest));
+        manifest->data_size = size;
+        manifest->data = file_i_map(input->fd, size);
+        result = manifest->data ? 0 : -1;
     }
-
-    if (entry) {
-        cabx_entry_release(entry);
+    if (result == 0) {
+        result = bin_manifest_open(manifest->data, manifest->data_size,
+            &manifest->view);
+        if (result) {
+            fprintf(stderr, "invalid binary manifest: %s\n",
+                obj->option->input);
+        }
+    }
+    if (result == 0 && manifest->view.record_count) {
+        /* an allocation for all entries instead of one for each entry */
+        if (manifest->view.record_count <= SIZE_MAX / sizeof(CABX_ENTRY)) {
+            manifest->entries = (CABX_ENTRY*)cabx_i_mem_alloc(
+                sizeof(CABX_ENTRY) * manifest->view.record_count);
+        }
+        result = manifest->entries ? 0 : -1;
+    }
+    if (result == 0) {
+        obj->manifest = manifest;
+        input->manifest = manifest;
+        close(input->fd);
+        input->fd = -1;
+    } else {
+        cabx_manifest_free(manifest);
     }
-
     return result;
 }
 
 /**
- * load csv from input
+ * get the entry for the record of binary manifest.
+ * The entry is placed in the entries of the manifest, and its names point
+ * to the string table, so that nothing is parsed or allocated.
  */
-static csv*
-cabx_load_csv_from_input(
-    CABX* obj)
+static int
+cabx_manifest_get_entry(
+    CABX_MANIFEST* manifest,
+    size_t index,
+    CABX_ENTRY** entry)
 {
-    char* input_data;
-    size_t input_data_size;
-    csv* result;
-    int state;
-
-    result = NULL;
-    input_data = NULL;
-    input_data_size = 0;
-
-    state = cabx_load_csv_input(obj, &input_data, &input_data_size);
+    int result;
+    const bin_manifest_record* record;
+    const char* source_path;
+    const char* entry_name;
+    record = &manifest->view.records[index];
+    source_path = bin_manifest_get_str(&manifest->view,
+        record->source_offset);
+    entry_name = bin_manifest_get_str(&manifest->view, record->name_offset);
+    result = source_path && entry_name ? 0 : -1;
+    if (result == 0) {
+        CABX_ENTRY* manifest_entry;
+        manifest_entry = &manifest->entries[index];
+        memset(manifest_entry, 0, sizeof(*manifest_entry));
+        manifest_entry->ref_count = 1;
+        manifest_entry->source_file = (char*)source_path;
+        manifest_entry->entry_name = (char*)entry_name;
+        manifest_entry->compression = record->compression;
+        manifest_entry->attribute = record->attribute;
+        manifest_entry->execute = record->execute;
+        manifest_entry->flush_folder = record->flush_folder;
+        manifest_entry->flush_cabinet = record->flush_cabinet;
+        manifest_entry->in_manifest = 1;
+        *entry = manifest_entry;
+    }
+    return result;
+}
 
-    if (state == 0) {
-        result = csv_create_1(
-            (void* (*)(unsigned int))cabx_i_mem_alloc, 
-            cabx_i_mem_free);
-        state = result ? 0 : -1;
+/**
+ * unmap binary manifest and free the entries in it
+ */
+static void
+cabx_manifest_free(
+    CABX_MANIFEST* manifest)
+{
+    if (manifest) {
+        if (manifest->entries) {
+            cabx_i_mem_free(manifest->entries);
+        }
+        if (manifest->data) {
+            file_i_unmap(manifest->data, manifest->data_size);
+        }
+        cabx_i_mem_free(manifest);
     }
+}
 
-    if (state == 0) {
-        const char* new_lines[] = {
-            "\n",
-            "\r\n"
-        };
-        state = csv_load(result, input_data, input_data_size,
-            ",", new_lines, sizeof(new_lines) / sizeof(new_lines[0]));
+/**
+ * load rules for files in input directory
+ */
+static int
+cabx_input_load_rules(
+    CABX_INPUT* input,
+    const char* rules_path)
+{
+    int result;
+    FILE* stream;
+    csv_stream* csv;
+    size_t rule_capacity;
+    stream = NULL;
+    csv = NULL;
+    rule_capacity = 0;
+    result = 0;
+    if (rules_path) {
+        stream = file_i_fopen(rules_path, "rb");
+        result = stream ? 0 : -1;
+        if (result) {
+            fprintf(stderr, "can not open rules file: %s\n", rules_path);
+        }
+    }
+    if (result == 0 && stream) {
+        csv = csv_stream_create(stream);
+        result = csv ? 0 : -1;
+    }
+    while (result == 0 && csv) {
+        const char* const* cells;
+        size_t cell_count;
+        int state;
+        state = csv_stream_read_row(csv, &cells, &cell_count);
+        if (state <= 0) {
+            result = state;
+            break;
+        }
+        result = cabx_input_add_rule(input, cells, cell_count,
+            &rule_capacity);
+        if (result) {
+            fprintf(stderr, "invalid rule for %s in %s\n",
+                cells[0], rules_path);
+        }
+    }
+    if (result == 0) {
+        const char* default_rule[] = { "**", CABX_INPUT_COMPRESSION_DEF };
+        result = cabx_input_add_rule(input, default_rule,
+            sizeof(default_rule) / sizeof(default_rule[0]),
+            &rule_capacity);
+    }
+    if (csv) {
+        csv_stream_free(csv);
+    }
+    if (stream) {
+        fclose(stream);
+    }
+    return result;
+}
 
-        if (state) {
-            csv_release(result);
-            result = NULL;
+/**
+ * add a rule from csv row.
+ * The row which does not have enough cells is ignored.
+ */
+static int
+cabx_input_add_rule(
+    CABX_INPUT* input,
+    const char* const* cells,
+    size_t cell_count,
+    size_t* rule_capacity)
+{
+    int result;
+    CABX_INPUT_RULE rule;
+    const char* attr_str;
+    const char* execute_str;
+    const char* flush_folder_str;
+    const char* flush_cabinet_str;
+    memset(&rule, 0, sizeof(rule));
+    result = 0;
+    attr_str = cell_count > 2 ? cells[2] : NULL;
+    execute_str = cell_count > 3 ? cells[3] : NULL;
+    flush_folder_str = cell_count > 4 ? cells[4] : NULL;
+    flush_cabinet_str = cell_count > 5 ? cells[5] : NULL;
+    if (cell_count > 1 && cells[0][0] && cells[1][0]) {
+        if (strcmp(cells[1], "-") == 0) {
+            rule.exclude = 1;
+        } else {
+            result = name_compression_str_to_code(
+                cells[1], &rule.compression);
+        }
+        if (result == 0 && attr_str && attr_str[0]) {
+            result = number_parser_str_to_int(
+                attr_str, 10, &rule.attribute);
+        }
+        if (result == 0 && execute_str && execute_str[0]) {
+            result = number_parser_str_to_int(
+                execute_str, 10, &rule.execute);
+        }
+        if (result == 0 && flush_folder_str && flush_folder_str[0]) {
+            result = number_parser_str_to_int(
+                flush_folder_str, 10, &rule.flush_folder);
+        }
+        if (result == 0 && flush_cabinet_str && flush_cabinet_str[0]) {
+            result = number_parser_str_to_int(
+                flush_cabinet_str, 10, &rule.flush_cabinet);
+        }
+        if (result == 0 && input->rule_count == *rule_capacity) {
+            CABX_INPUT_RULE* new_rules;
+            size_t new_capacity;
+            new_capacity = *rule_capacity ? *rule_capacity * 2 : 16;
+            new_rules = (CABX_INPUT_RULE*)cabx_i_mem_alloc(
+                sizeof(CABX_INPUT_RULE) * new_capacity);
+            result = new_rules ? 0 : -1;
+            if (result == 0) {
+                if (input->rules) {
+                    memcpy(new_rules, input->rules,
+                        sizeof(CABX_INPUT_RULE) * input->rule_count);
+                    cabx_i_mem_free(input->rules);
+                }
+                input->rules = new_rules;
+                *rule_capacity = new_capacity;
+            }
+        }
+        if (result == 0) {
+            rule.pattern = cabx_i_str_dup(cells[0]);
+            result = rule.pattern ? 0 : -1;
+        }
+        if (result == 0) {
+            input->rules[input->rule_count++] = rule;
         }
     }
     return result;
 }
 
 /**
- * load csv input raw data 
+ * create entry for the file in input directory.
+ * Entry name is the path from input directory separated by '\\'.
  */
 static int
-cabx_load_csv_input(
-    CABX* obj,
-    char** src,
-    size_t* src_size)
+cabx_input_create_file_entry(
+    CABX_INPUT* input,
+    const char* file_path,
+    const char* relative_path,
+    CABX_ENTRY** entry)
 {
     int result;
-    FILE* fi;
-    buffer_char_buffer* buffer;
-    fi = NULL;
-    buffer = NULL;
-    if (strcmp(obj->option->input, "-") == 0) {
-        fi = stdin;
-    } else {
-        fi = fopen(obj->option->input, "r");
+    const CABX_INPUT_RULE* rule;
+    char* entry_name;
+    size_t idx;
+    rule = NULL;
+    entry_name = NULL;
+    result = 0;
+    *entry = NULL;
+    /* the last rule matches any file */
+    for (idx = 0; !rule && idx < input->rule_count; idx++) {
+        if (path_match_glob(input->rules[idx].pattern, relative_path)) {
+            rule = &input->rules[idx];
+        }
     }
-    result = fi ? 0 : -1;
+    if (rule && !rule->exclude) {
+        entry_name = cabx_i_str_dup(relative_path);
+        result = entry_name ? 0 : -1;
+    }
+    if (entry_name) {
+        char* ptr;
+        for (ptr = entry_name; *ptr; ptr++) {
+            if (*ptr == '/') {
+                *ptr = '\\';
+            }
+        }
+        *entry = cabx_entry_create_1(file_path, entry_name,
+            rule->compression, rule->attribute, rule->execute,
+            rule->flush_folder, rule->flush_cabinet);
+        result = *entry ? 0 : -1;
+        cabx_i_mem_free(entry_name);
+    }
+    return result;
+}
 
+/**
+ * start loading entries in background
+ */
+static int
+cabx_pipeline_start(
+    CABX* obj,
+    CABX_PIPELINE* pipeline)
+{
+    int result;
+    memset(pipeline, 0, sizeof(*pipeline));
+    pipeline->cabx = obj;
+    result = cabx_input_open(obj, &pipeline->input);
     if (result == 0) {
-        buffer = buffer_char_buffer_create(100);
-        result = buffer ? 0 : -1;
+        pipeline->queue = bounded_queue_create(CABX_PIPELINE_QUEUE_SIZE);
+        result = pipeline->queue ? 0 : -1;
     }
-
     if (result == 0) {
-        char* f_buffer;
-        const static size_t f_buffer_size = 1024;
-        f_buffer = (char*)cabx_i_mem_alloc(f_buffer_size);
-        result = f_buffer ? 0 : -1;
-        while (result == 0) {
-            size_t read_size;
-            read_size = 0;
-            read_size = fread(f_buffer, 1, f_buffer_size, fi);
+        pipeline->loader = thread_i_thread_create(cabx_pipeline_load,
+            pipeline);
+        result = pipeline->loader ? 0 : -1;
+    }
+    if (result) {
+        bounded_queue_free(pipeline->queue, NULL);
+        pipeline->queue = NULL;
+        cabx_input_close(&pipeline->input);
+    }
+    return result;
+}
 
-            if (read_size) {
-                result = buffer_char_buffer_append(
-                    buffer, f_buffer, read_size);
-            } else {
-                break;
-            }
-        }
+/**
+ * stop loading entries and get the result of loading
+ */
+static int
+cabx_pipeline_finish(
+    CABX_PIPELINE* pipeline)
+{
+    int result;
+    bounded_queue_close(pipeline->queue);
+    thread_i_thread_join(pipeline->loader);
+    result = pipeline->result;
+    bounded_queue_free(pipeline->queue,
+        (void (*)(void*))cabx_entry_release_1);
+    cabx_input_close(&pipeline->input);
+    memset(pipeline, 0, sizeof(*pipeline));
+    return result;
+}
 
-        if (f_buffer) {
-            cabx_i_mem_free(f_buffer);
+/**
+ * load entries into pipeline queue
+ */
+static void
+cabx_pipeline_load(
+    void* arg)
+{
+    CABX_PIPELINE* pipeline;
+    int result;
+    pipeline = (CABX_PIPELINE*)arg;
+    result = 0;
+    while (result == 0) {
+        CABX_ENTRY* entry;
+        int state;
+        state = cabx_input_read_entry(&pipeline->input, &entry);
+        if (state <= 0) {
+            result = state;
+            break;
         }
-    }
-
-    if (result == 0) {
-        char* tmp_src;
-        tmp_src = (char*)cabx_i_mem_alloc(
-            buffer_char_buffer_get_size(buffer));
-        result = tmp_src ? 0 : -1;
-
-        if (result == 0) {
-            buffer_char_buffer_copy_to(buffer, tmp_src);
-            *src = tmp_src;
-            *src_size = buffer_char_buffer_get_size(buffer);
-            tmp_src = NULL;
+        if (entry) {
+            result = cabx_resolve_entries_compression(pipeline->cabx,
+                &entry, 1);
         }
-
-        if (tmp_src) {
-            cabx_i_mem_free(tmp_src);
+        if (result == 0 && entry) {
+            result = bounded_queue_push(pipeline->queue, entry);
+            if (result == 0) {
+                entry = NULL;
+            }
         }
-    }
-    if (buffer) {
-        buffer_char_buffer_release(buffer);
-    }
-
-    if (fi) {
-        if (strcmp(obj->option->input, "-") == 0) {
-            fclose(fi);
+        if (entry) {
+            cabx_entry_release(entry);
         }
     }
-    return result;
+    pipeline->result = result;
+    bounded_queue_close(pipeline->queue);
 }
 
 /**
@@ -1430,67 +3916,93 @@ static int
 cabx_entries_iter(
     CABX_ENTRY_ITER_STATE* iter_state,
     CABX_ENTRY* entry)
+{
+    int result;
+    result = cabx_entries_iter_add(iter_state, entry);
+    if (result == 0) {
+        result = cabx_entries_iter_flush(iter_state, entry);
+    }
+    return result;
+}
+
+/**
+ * add the entry into cabinet
+ */
+static int
+cabx_entries_iter_add(
+    CABX_ENTRY_ITER_STATE* iter_state,
+    CABX_ENTRY* entry)
 {
     int result;
     char* encoded_name;
     int encoded_attr;
-    wchar_t* entry_name_w;
-    size_t count_of_entries;
+    unsigned int compression;
 
     result = 0;
     encoded_attr = 0;
     encoded_name = NULL;
-    entry_name_w = str_conv_utf8_to_utf16(
-        entry->entry_name, strlen(entry->entry_name) + 1,
-        cabx_i_mem_alloc, cabx_i_mem_free);
 
-    count_of_entries = col_list_size(
-        iter_state->generation_status->cabx->entries);
+    compression = cabx_entries_iter_get_compression(iter_state, entry);
     if (iter_state->last_compression_type == tcompBAD) {
-        iter_state->last_compression_type = entry->compression;
-    } else {
-        int flush_cabinet;
-        flush_cabinet = iter_state->last_compression_type != entry->compression;
-        if (flush_cabinet) {
-            int state;
-            state = FCIFlushCabinet(iter_state->fci_handle,
+        iter_state->last_compression_type = (int)compression;
+    } else if (iter_state->last_compression_type != (int)compression) {
+        int state;
+        if (iter_state->backend->mix_compression_types) {
+            state = iter_state->backend->flush_folder(
+                iter_state->fci_handle,
+                cabx_fci_get_next_cabinet,
+                cabx_fci_progress);
+        } else {
+            state = iter_state->backend->flush_cabinet(
+                iter_state->fci_handle,
                 TRUE,
                 cabx_fci_get_next_cabinet,
                 cabx_fci_progress);
-            result = state ? 0 : -1;
         }
+        result = state ? 0 : -1;
     }
 
-    result = cabx_encode_str(entry->entry_name, &encoded_name, &encoded_attr);
+    if (result == 0) {
+        result = cabx_encode_str(entry->entry_name,
+            &encoded_name, &encoded_attr);
+    }
     
     if (result == 0) {
         int state;
-        state = FCIAddFile(iter_state->fci_handle,
+        state = iter_state->backend->add_file(iter_state->fci_handle,
             entry->source_file,
             encoded_name,
             entry->execute ? TRUE : FALSE,
             cabx_fci_get_next_cabinet,
             cabx_fci_progress,
             cabx_fci_get_open_info,
-            entry->compression);
+            (TCOMP)compression);
         
         result = state ? 0 : -1;
     }
     if (result == 0) {
-        int call_get_next_cab;
-        iter_state->last_compression_type = entry->compression;
+        iter_state->last_compression_type = (int)compression;
         iter_state->processed_count++;
-
-        call_get_next_cab = cabx_entries_iter_is_end_of_entry(iter_state);
-        iter_state->generation_status->end_of_generation = 
-            cabx_entries_iter_is_end_of_entry(iter_state);
-
-
     }
+    return result;
+}
+
+/**
+ * flush folder or cabinet as the entry requests
+ */
+static int
+cabx_entries_iter_flush(
+    CABX_ENTRY_ITER_STATE* iter_state,
+    CABX_ENTRY* entry)
+{
+    int result;
+    result = 0;
+    iter_state->generation_status->end_of_generation = 
+        cabx_entries_iter_is_end_of_entry(iter_state);
 
     if (result == 0 && entry->flush_folder) {
         int state;
-        state = FCIFlushFolder(iter_state->fci_handle,
+        state = iter_state->backend->flush_folder(iter_state->fci_handle,
             cabx_fci_get_next_cabinet,
             cabx_fci_progress);
         result = state ? 0 : -1;
@@ -1500,14 +4012,32 @@ cabx_entries_iter(
         int state;
 
 
-        state = FCIFlushCabinet(iter_state->fci_handle,
+        state = iter_state->backend->flush_cabinet(iter_state->fci_handle,
             TRUE,
             cabx_fci_get_next_cabinet,
             cabx_fci_progress);
         result = state ? 0 : -1;
     }
 
-    cabx_i_mem_free(entry_name_w);
+    return result;
+}
+
+/**
+ * get compression type passed to backend for the entry.
+ * The global preset is applied to MSZIP and LZX entry without preset, and
+ * the compressor options are removed if the backend does not accept them.
+ */
+static unsigned int
+cabx_entries_iter_get_compression(
+    CABX_ENTRY_ITER_STATE* iter_state,
+    CABX_ENTRY* entry)
+{
+    unsigned int result;
+    result = cabx_get_entry_compression(
+        iter_state->generation_status->cabx, entry);
+    if (!iter_state->backend->accept_compressor_options) {
+        result = cab_compressor_get_folder_type(result);
+    }
     return result;
 }
 
@@ -1521,18 +4051,8 @@ cabx_entries_iter_is_end_of_entry(
     size_t count_of_entries;
     count_of_entries = col_list_size(
         iter_state->generation_status->cabx->entries);
-    return iter_state->processed_count >= count_of_entries;
-}
-
-
-/**
- * get non zero if all entries are belong into a cabinet.
- */
-static int
-cabx_is_generated_all(
-    CABX* obj)
-{
-    return col_list_size(obj->entries) == col_map_size(obj->entry_cab_map);
+    return iter_state->processed_count >= count_of_entries
+        && !iter_state->more_entries;
 }
 
 
@@ -1578,6 +4098,21 @@ cabx_encode_str(
                 result = buffer_char_buffer_append(
                     buffer, tmp_buff, sizeof(tmp_buff));
                 utf_attr = 1; 
+            } else if ((str_ptr[0] & 0xfc00) == 0xd800
+                && (str_ptr[1] & 0xfc00) == 0xdc00) {
+                unsigned long code_point;
+                char tmp_buff[4];
+                /* surrogate pair is encoded in a 4 byte sequence */
+                code_point = 0x10000 + (((str_ptr[0] & 0x3ffUL) << 10)
+                    | (str_ptr[1] & 0x3ff));
+                tmp_buff[0] = (char)(0xf0 + (code_point >> 18));
+                tmp_buff[1] = (char)(0x80 + ((code_point >> 12) & 0x3f));
+                tmp_buff[2] = (char)(0x80 + ((code_point >> 6) & 0x3f));
+                tmp_buff[3] = (char)(0x80 + (code_point & 0x3f));
+                result = buffer_char_buffer_append(
+                    buffer, tmp_buff, sizeof(tmp_buff));
+                utf_attr = 1;
+                str_ptr++;
             } else if (0x0800 <= *str_ptr && *str_ptr <= 0xffff) {
                 char tmp_buff[] = { 
                     (char)(0xe0 + ((*str_ptr) >> 12)),
@@ -1633,42 +4168,53 @@ cabx_decode_str(
     result = buffer ? 0 : -1;
 
     if (result == 0) {
-        const char* str_ptr; 
-        str_ptr = src;
+        const unsigned char* str_ptr; 
+        str_ptr = (const unsigned char*)src;
         while (*str_ptr != '\0') {
-            uint16_t a_char;
-            a_char = 0;
-            if ((*str_ptr & 0xf0) == 0xe0) {
-                uint16_t tmp_buff;
-                tmp_buff = *str_ptr;
-                tmp_buff = (uint16_t)((0x0f & tmp_buff) << 12);
-                a_char |= tmp_buff;
-                str_ptr++;
-                tmp_buff = *str_ptr;
-                tmp_buff = (uint16_t)((0x3f & tmp_buff) << 6);
-                a_char |= tmp_buff;
-                str_ptr++;
-                tmp_buff = *str_ptr;
-                a_char |= (uint16_t)((0x3f & tmp_buff));
-            } else if ((*str_ptr & 0xf0) == 0xc0) {
-                uint16_t tmp_buff;
-                a_char = 0;
-                tmp_buff = *str_ptr;
-                tmp_buff = (uint16_t)((0x3f & tmp_buff) << 6);
-                a_char |= tmp_buff;
-                str_ptr++;
-                tmp_buff = *str_ptr;
-                tmp_buff = (uint16_t)(0x3f & tmp_buff);
-                a_char |= tmp_buff;
+            uint32_t code_point;
+            size_t length;
+            size_t idx;
+            if ((*str_ptr & 0x80) == 0) {
+                length = 1;
+                code_point = *str_ptr;
+            } else if ((*str_ptr & 0xe0) == 0xc0) {
+                length = 2;
+                code_point = *str_ptr & 0x1f;
+            } else if ((*str_ptr & 0xf0) == 0xe0) {
+                length = 3;
+                code_point = *str_ptr & 0x0f;
+            } else if ((*str_ptr & 0xf8) == 0xf0) {
+                length = 4;
+                code_point = *str_ptr & 0x07;
             } else {
-                a_char = *str_ptr;
+                length = 1;
+                code_point = 0xfffd;
+            }
+            /* the terminator stops a truncated sequence */
+            for (idx = 1; idx < length; idx++) {
+                if ((str_ptr[idx] & 0xc0) != 0x80) {
+                    break;
+                }
+                code_point = (code_point << 6) | (str_ptr[idx] & 0x3f);
+            }
+            if (idx < length || code_point > 0x10ffff) {
+                code_point = 0xfffd;
+            }
+            str_ptr += idx;
+            if (code_point >= 0x10000) {
+                uint16_t units[2];
+                code_point -= 0x10000;
+                units[0] = (uint16_t)(0xd800 | (code_point >> 10));
+                units[1] = (uint16_t)(0xdc00 | (code_point & 0x3ff));
+                result = buffer_variable_buffer_append(buffer, units, 2);
+            } else {
+                uint16_t a_char;
+                a_char = (uint16_t)code_point;
+                result = buffer_variable_buffer_append(buffer, &a_char, 1);
             }
-            result = buffer_variable_buffer_append(buffer, &a_char, 1);
-
             if (result) {
                 break;
             }
-            str_ptr++;
         }
         if (result == 0) {
             uint16_t null_char = 0;
@@ -1761,59 +4307,376 @@ cabinet_generation_status_set_next_cabinet_name(
         if (obj->next_cabinet_name) {
             cstr_release(obj->next_cabinet_name);
         }
-        obj->next_cabinet_name = next_cabinet_name;
+        obj->next_cabinet_name = next_cabinet_name;
+    }
+    return result;
+}
+
+
+/**
+ * set next disk name 
+ */
+static int
+cabinet_generation_status_set_next_disk_name(
+    CABX_GENERATION_STATUS* obj,
+    cstr* next_disk_name)
+{
+    int result;
+    result = 0;
+    if (next_disk_name != obj->next_disk_name) {
+        if (next_disk_name) {
+            cstr_retain(next_disk_name);
+        }
+        if (obj->next_disk_name) {
+            cstr_release(obj->next_disk_name);
+        }
+        obj->next_disk_name = next_disk_name;
+    }
+    return result;
+}
+
+
+
+/**
+ * create cabinet
+ */
+static int
+cabx_create_cab(
+    CABX* obj,
+    HFCI fci_hdl,
+    CABX_GENERATION_STATUS* generation_status)
+{
+    int result;
+    CABX_ENTRY_ITER_STATE state;
+    CABX_ENTRY** entries;
+    size_t entry_count;
+    const char** source_files;
+
+    result = 0;
+    entries = NULL;
+    entry_count = 0;
+    source_files = NULL;
+    memset(&state, 0, sizeof(state));
+    state.fci_handle = fci_hdl;
+    state.backend = obj->option->backend;
+    state.last_compression_type = tcompBAD;
+    state.generation_status = generation_status;
+
+    if ((obj->option->jobs > 1 || obj->option->folder_cache)
+        && state.backend->schedule_files) {
+        result = cabx_schedule_entries(obj, &state);
+    } else if (obj->option->read_ahead) {
+        /* source files are opened while the previous file is compressed */
+        size_t idx;
+        size_t read_size;
+        result = cabx_get_entries(obj, &entries, &entry_count);
+        if (result == 0) {
+            source_files = (const char**)cabx_i_mem_alloc(
+                sizeof(const char*) * (entry_count + 1));
+            result = source_files ? 0 : -1;
+        }
+        if (result == 0) {
+            for (idx = 0; idx < entry_count; idx++) {
+                source_files[idx] = entries[idx]->source_file;
+            }
+            read_size = CABX_READ_AHEAD_SIZE;
+            if (obj->option->map_source
+                && state.backend->set_source_map) {
+                /* larger files are compressed from mapped memory */
+                read_size = CABX_MAP_SIZE_MIN;
+            }
+            generation_status->read_ahead = read_ahead_create(
+                source_files, entry_count, obj->option->read_ahead,
+                read_size, obj->option->io_ring);
+        }
+    }
+    if (result == 0) {
+        result = col_list_forward_iterate(
+            obj->entries,
+            (int (*)(void*, const void*))cabx_entries_iter,
+            &state);
+    }
+    if (generation_status->read_ahead) {
+        read_ahead_free(generation_status->read_ahead);
+        generation_status->read_ahead = NULL;
+    }
+    if (source_files) {
+        cabx_i_mem_free(source_files);
+    }
+    if (entries) {
+        cabx_i_mem_free(entries);
+    }
+
+    return result;
+}
+
+/**
+ * create cabinet from entries coming through pipeline
+ */
+static int
+cabx_create_cab_from_pipeline(
+    CABX* obj,
+    HFCI fci_hdl,
+    CABX_GENERATION_STATUS* generation_status,
+    CABX_PIPELINE* pipeline)
+{
+    int result;
+    int scheduling;
+    CABX_ENTRY* deferred_entry;
+    CABX_ENTRY_ITER_STATE state;
+
+    result = 0;
+    deferred_entry = NULL;
+    memset(&state, 0, sizeof(state));
+    state.fci_handle = fci_hdl;
+    state.backend = obj->option->backend;
+    state.last_compression_type = tcompBAD;
+    state.generation_status = generation_status;
+    state.more_entries = 1;
+    scheduling = (obj->option->jobs > 1 || obj->option->folder_cache)
+        && state.backend->schedule_files;
+
+    while (result == 0) {
+        CABX_ENTRY* entry;
+        int pop_state;
+        entry = NULL;
+        pop_state = bounded_queue_pop(pipeline->queue, (void**)&entry);
+        if (deferred_entry) {
+            state.more_entries = pop_state > 0;
+            result = cabx_entries_iter_flush(&state, deferred_entry);
+            state.more_entries = 1;
+            deferred_entry = NULL;
+        }
+        if (pop_state <= 0) {
+            break;
+        }
+        if (result == 0) {
+            result = cabx_register_entry(obj, entry);
+        }
+        if (result == 0 && scheduling) {
+            unsigned int compression;
+            compression = cabx_entries_iter_get_compression(&state, entry);
+            if (state.run_file_count
+                && state.run_compression_type != compression) {
+                result = cabx_pipeline_iter_run(&state, pipeline,
+                    &deferred_entry);
+            }
+            if (result == 0) {
+                state.run_compression_type = compression;
+                result = cabx_pipeline_append_run(&state, entry);
+            }
+            if (result == 0 && (entry->flush_folder || entry->flush_cabinet)) {
+                result = cabx_pipeline_iter_run(&state, pipeline,
+                    &deferred_entry);
+            }
+        } else if (result == 0) {
+            result = cabx_pipeline_iter(&state, pipeline, entry,
+                &deferred_entry);
+        }
+        cabx_entry_release(entry);
+    }
+    if (result == 0 && state.run_file_count) {
+        result = cabx_pipeline_iter_run(&state, pipeline, &deferred_entry);
+    }
+    if (result == 0 && deferred_entry) {
+        state.more_entries = 0;
+        result = cabx_entries_iter_flush(&state, deferred_entry);
+    }
+    if (state.run_files) {
+        cabx_i_mem_free(state.run_files);
+    }
+    if (state.run_entries) {
+        cabx_i_mem_free(state.run_entries);
+    }
+    return result;
+}
+
+/**
+ * add the entry coming through pipeline into cabinet.
+ * The flush requested by the entry is deferred if it is not known in a
+ * while whether the entry is the last.
+ */
+static int
+cabx_pipeline_iter(
+    CABX_ENTRY_ITER_STATE* iter_state,
+    CABX_PIPELINE* pipeline,
+    CABX_ENTRY* entry,
+    CABX_ENTRY** deferred_entry)
+{
+    int result;
+    result = cabx_entries_iter_add(iter_state, entry);
+    if (result == 0 && (entry->flush_folder || entry->flush_cabinet)) {
+        int state;
+        state = bounded_queue_wait(pipeline->queue, CABX_PIPELINE_END_WAIT);
+        if (state < 0) {
+            *deferred_entry = entry;
+        } else {
+            iter_state->more_entries = state;
+            result = cabx_entries_iter_flush(iter_state, entry);
+            iter_state->more_entries = 1;
+        }
+    }
+    return result;
+}
+
+/**
+ * schedule the run collected from pipeline and add the entries
+ */
+static int
+cabx_pipeline_iter_run(
+    CABX_ENTRY_ITER_STATE* iter_state,
+    CABX_PIPELINE* pipeline,
+    CABX_ENTRY** deferred_entry)
+{
+    int result;
+    size_t run_count;
+    size_t idx;
+    run_count = iter_state->run_file_count;
+    result = cabx_entries_iter_schedule_run(iter_state);
+    for (idx = 0; result == 0 && idx < run_count; idx++) {
+        result = cabx_pipeline_iter(iter_state, pipeline,
+            iter_state->run_entries[idx], deferred_entry);
+    }
+    return result;
+}
+
+/**
+ * append the entry into the run collected from pipeline
+ */
+static int
+cabx_pipeline_append_run(
+    CABX_ENTRY_ITER_STATE* iter_state,
+    CABX_ENTRY* entry)
+{
+    int result;
+    result = 0;
+    if (iter_state->run_file_count == iter_state->run_capacity) {
+        size_t capacity;
+        LPSTR* run_files;
+        CABX_ENTRY** run_entries;
+        capacity = iter_state->run_capacity ?
+            iter_state->run_capacity * 2 : 0x100;
+        run_files = (LPSTR*)cabx_i_mem_alloc(sizeof(LPSTR) * capacity);
+        run_entries = (CABX_ENTRY**)cabx_i_mem_alloc(
+            sizeof(CABX_ENTRY*) * capacity);
+        result = run_files && run_entries ? 0 : -1;
+        if (result == 0 && iter_state->run_file_count) {
+            memcpy(run_files, iter_state->run_files,
+                sizeof(LPSTR) * iter_state->run_file_count);
+            memcpy(run_entries, iter_state->run_entries,
+                sizeof(CABX_ENTRY*) * iter_state->run_file_count);
+        }
+        if (result == 0) {
+            if (iter_state->run_files) {
+                cabx_i_mem_free(iter_state->run_files);
+            }
+            if (iter_state->run_entries) {
+                cabx_i_mem_free(iter_state->run_entries);
+            }
+            iter_state->run_files = run_files;
+            iter_state->run_entries = run_entries;
+            iter_state->run_capacity = capacity;
+        } else {
+            if (run_files) {
+                cabx_i_mem_free(run_files);
+            }
+            if (run_entries) {
+                cabx_i_mem_free(run_entries);
+            }
+        }
+    }
+    if (result == 0) {
+        iter_state->run_files[iter_state->run_file_count] =
+            entry->source_file;
+        iter_state->run_entries[iter_state->run_file_count] = entry;
+        iter_state->run_file_count++;
+    }
+    return result;
+}
+
+/**
+ * schedule entries to be compressed in background.
+ * The entries are split into runs at the points where the entry iterator
+ * flushes folder or cabinet, so that each run is compressed into folders
+ * as the entry iterator adds them.
+ */
+static int
+cabx_schedule_entries(
+    CABX* obj,
+    CABX_ENTRY_ITER_STATE* iter_state)
+{
+    int result;
+    size_t entry_count;
+    entry_count = col_list_size(obj->entries);
+    result = 0;
+    if (entry_count) {
+        iter_state->run_files = (LPSTR*)cabx_i_mem_alloc(
+            sizeof(LPSTR) * entry_count);
+        result = iter_state->run_files ? 0 : -1;
+    }
+    if (result == 0 && entry_count) {
+        iter_state->run_file_count = 0;
+        result = col_list_forward_iterate(
+            obj->entries,
+            (int (*)(void*, const void*))cabx_entries_iter_for_scheduling,
+            iter_state);
+        if (result == 0) {
+            result = cabx_entries_iter_schedule_run(iter_state);
+        }
+    }
+    if (iter_state->run_files) {
+        cabx_i_mem_free(iter_state->run_files);
+        iter_state->run_files = NULL;
     }
+    iter_state->run_file_count = 0;
     return result;
 }
 
-
 /**
- * set next disk name 
+ * entry iterator for scheduling
  */
 static int
-cabinet_generation_status_set_next_disk_name(
-    CABX_GENERATION_STATUS* obj,
-    cstr* next_disk_name)
+cabx_entries_iter_for_scheduling(
+    CABX_ENTRY_ITER_STATE* iter_state,
+    CABX_ENTRY* entry)
 {
     int result;
+    unsigned int compression;
     result = 0;
-    if (next_disk_name != obj->next_disk_name) {
-        if (next_disk_name) {
-            cstr_retain(next_disk_name);
-        }
-        if (obj->next_disk_name) {
-            cstr_release(obj->next_disk_name);
+    compression = cabx_entries_iter_get_compression(iter_state, entry);
+    if (iter_state->run_file_count
+        && iter_state->run_compression_type != compression) {
+        result = cabx_entries_iter_schedule_run(iter_state);
+    }
+    if (result == 0) {
+        iter_state->run_compression_type = compression;
+        iter_state->run_files[iter_state->run_file_count++] =
+            entry->source_file;
+        if (entry->flush_folder || entry->flush_cabinet) {
+            result = cabx_entries_iter_schedule_run(iter_state);
         }
-        obj->next_disk_name = next_disk_name;
     }
     return result;
 }
 
-
-
 /**
- * create cabinet
+ * schedule the run of entries collected by iterator
  */
 static int
-cabx_create_cab(
-    CABX* obj,
-    HFCI fci_hdl,
-    CABX_GENERATION_STATUS* generation_status)
+cabx_entries_iter_schedule_run(
+    CABX_ENTRY_ITER_STATE* iter_state)
 {
     int result;
-    CABX_ENTRY_ITER_STATE state;
-
     result = 0;
-    memset(&state, 0, sizeof(state));
-    state.fci_handle = fci_hdl;
-    state.last_compression_type = tcompBAD;
-    state.generation_status = generation_status;
-    
-    result = col_list_forward_iterate(
-        obj->entries,
-        (int (*)(void*, const void*))cabx_entries_iter,
-        &state);
-
+    if (iter_state->run_file_count) {
+        int state;
+        state = iter_state->backend->schedule_files(iter_state->fci_handle,
+            iter_state->run_files,
+            iter_state->run_file_count,
+            (TCOMP)iter_state->run_compression_type);
+        result = state ? 0 : -1;
+        iter_state->run_file_count = 0;
+    }
     return result;
 }
 
@@ -1831,11 +4694,25 @@ cabx_generate(
     ERF fci_err;
     CABX_GENERATION_STATUS gen_status;
     CCAB cab_param;
+    CABX_PIPELINE pipeline;
+    int pipeline_started;
+    folder_cache* cache;
     result = 0;
     fci_hdl = NULL;
+    cache = NULL;
+    pipeline_started = 0;
     memset(&fci_err, 0, sizeof(fci_err));
     memset(&gen_status, 0, sizeof(gen_status));
-    result = cabx_load_entries(obj);
+    if (obj->option->pipeline && !obj->option->group_duplicates
+        && !obj->option->order_entries && !obj->option->plan_fill) {
+        result = cabx_pipeline_start(obj, &pipeline);
+        pipeline_started = result == 0;
+    } else {
+        result = cabx_load_entries(obj);
+        if (result == 0) {
+            result = cabx_arrange_entries(obj);
+        }
+    }
     if (result == 0) {
         result = cabx_fill_cab_param(obj, &cab_param);
     }
@@ -1846,8 +4723,17 @@ cabx_generate(
             cab_param.szCab,
             cab_param.szCabPath);
     }
+    if (result == 0 && obj->option->write_thread) {
+        gen_status.write_pool = worker_pool_create(1);
+        result = gen_status.write_pool ? 0 : -1;
+    }
+    if (result == 0 && obj->option->temp_memory) {
+        gen_status.temp_store = temp_store_create(
+            (size_t)obj->option->temp_memory);
+        result = gen_status.temp_store ? 0 : -1;
+    }
     if (result == 0) {
-        fci_hdl = FCICreate(&fci_err,
+        fci_hdl = obj->option->backend->create(&fci_err,
             cabx_fci_file_placed,
             cabx_fci_alloc,
             cabx_fci_free,
@@ -1860,15 +4746,55 @@ cabx_generate(
             cabx_fci_get_temporary_file_name,
             &cab_param,
             &gen_status);
+        result = fci_hdl ? 0 : -1;
+    }
+    if (result == 0 && obj->option->jobs > 1
+        && obj->option->backend->set_jobs) {
+        int state;
+        state = obj->option->backend->set_jobs(fci_hdl, obj->option->jobs);
+        result = state ? 0 : -1;
+    }
+    if (result == 0 && obj->option->map_source
+        && obj->option->backend->set_source_map) {
+        int state;
+        state = obj->option->backend->set_source_map(fci_hdl,
+            cabx_fci_map, cabx_fci_unmap);
+        result = state ? 0 : -1;
+    }
+    if (result == 0 && obj->option->folder_cache
+        && obj->option->backend->set_folder_cache) {
+        cache = folder_cache_create(obj->option->folder_cache);
+        if (cache) {
+            int state;
+            state = obj->option->backend->set_folder_cache(fci_hdl, cache);
+            result = state ? 0 : -1;
+        } else {
+            fprintf(stderr, "can not use folder cache: %s\n",
+                obj->option->folder_cache);
+            result = -1;
+        }
     }
     if (result == 0) {
-        result = cabx_create_cab(obj, fci_hdl, &gen_status);
+        if (pipeline_started) {
+            result = cabx_create_cab_from_pipeline(obj, fci_hdl,
+                &gen_status, &pipeline);
+        } else {
+            result = cabx_create_cab(obj, fci_hdl, &gen_status);
+        }
+    }
+    if (pipeline_started) {
+        int state;
+        state = cabx_pipeline_finish(&pipeline);
+        pipeline_started = 0;
+        if (result == 0) {
+            result = state;
+        }
     }
 
-    if (result == 0 && !cabx_is_generated_all(obj)) {
+    if (result == 0) {
         int state;
         gen_status.end_of_generation = 1;
-        state = FCIFlushCabinet(fci_hdl,
+        state = obj->option->backend->flush_cabinet(fci_hdl,
             TRUE,
             cabx_fci_get_next_cabinet,
             cabx_fci_progress);
@@ -1897,7 +4823,16 @@ cabx_generate(
 
 
     if (fci_hdl) {
-        FCIDestroy(fci_hdl);
+        obj->option->backend->destroy(fci_hdl);
+    }
+    if (cache) {
+        folder_cache_free(cache);
+    }
+    if (gen_status.write_pool) {
+        worker_pool_free(gen_status.write_pool);
+    }
+    if (gen_status.temp_store) {
+        temp_store_free(gen_status.temp_store);
     }
     if (result == 0) {
         cabx_report_cab_map(obj); 
@@ -1905,6 +4840,495 @@ cabx_generate(
     return result;
 }
 
+/**
+ * extract files from cabinet set
+ */
+static int
+cabx_extract(
+    CABX* obj)
+{
+    int result;
+    cab_extractor* extractor;
+    worker_pool* write_pool;
+    size_t idx;
+    write_pool = NULL;
+    extractor = cab_extractor_open(obj->option->extract);
+    result = extractor ? 0 : -1;
+    if (result) {
+        fprintf(stderr, "can not open cabinet: %s\n", obj->option->extract);
+    }
+    if (result == 0 && obj->option->jobs > 1) {
+        result = cab_extractor_set_jobs(extractor, obj->option->jobs);
+    }
+    if (result == 0 && (obj->option->jobs > 1 || obj->option->write_thread)) {
+        write_pool = worker_pool_create(obj->option->jobs);
+        result = write_pool ? 0 : -1;
+        if (result == 0) {
+            result = cab_extractor_set_write_pool(extractor, write_pool);
+        }
+    }
+    for (idx = 0; result == 0
+        && idx < cab_extractor_get_file_count(extractor); idx++) {
+        const cab_reader_file* file;
+        char* file_path;
+        char* dir_path;
+        file_path = NULL;
+        dir_path = NULL;
+        file = cab_extractor_get_file(extractor, idx);
+        result = cabx_extract_file_path(obj, file, &file_path);
+        if (result == 0) {
+            result = path_remove_file_spec(file_path, &dir_path,
+                cabx_i_mem_alloc, cabx_i_mem_free);
+        }
+        if (result == 0 && dir_path[0] && !dir_is_exists(dir_path)) {
+            result = dir_mkdir_p(dir_path);
+        }
+        if (result == 0) {
+            result = cab_extractor_set_file_path(extractor, idx, file_path);
+        }
+        if (result == 0 && obj->option->show_status) {
+            int is_tty;
+            is_tty = file_i_isatty(stderr);
+            file_i_fputs(is_tty ? "\033[Kextract " : "extract ", stderr);
+            file_i_fputs(file_path, stderr);
+            file_i_fputs(is_tty ? "\r" : "\n", stderr);
+        }
+        if (dir_path) {
+            cabx_i_mem_free(dir_path);
+        }
+        if (file_path) {
+            cabx_i_mem_free(file_path);
+        }
+    }
+    if (result == 0) {
+        result = cab_extractor_extract(extractor);
+        if (result) {
+            fprintf(stderr, "can not extract cabinet: %s\n",
+                obj->option->extract);
+        }
+    }
+    if (extractor) {
+        cab_extractor_close(extractor);
+    }
+    if (write_pool) {
+        worker_pool_free(write_pool);
+    }
+    return result;
+}
+
+/**
+ * estimate cabinets and report entries in them without generating
+ */
+static int
+cabx_dry_run(
+    CABX* obj)
+{
+    int result;
+    unsigned long long* cabinet_sizes;
+    size_t cabinet_count;
+    cabinet_sizes = NULL;
+    cabinet_count = 0;
+    result = cabx_load_entries(obj);
+    if (result == 0) {
+        result = cabx_arrange_entries(obj);
+    }
+    if (result == 0 && !obj->option->report_file) {
+        result = cabx_option_set_report(obj->option, "-");
+    }
+    if (result == 0) {
+        result = cabx_estimate_cab_map(obj, &cabinet_sizes, &cabinet_count);
+    }
+    if (result == 0) {
+        result = cabx_report_cab_map(obj);
+    }
+    if (result == 0) {
+        unsigned long long total_size;
+        size_t idx;
+        total_size = 0;
+        for (idx = 0; idx < cabinet_count; idx++) {
+            char cab_name[CB_MAX_CABINET_NAME];
+            cabx_fill_cabinet_name(obj, (int)idx, cab_name, sizeof(cab_name));
+            fprintf(stderr, "%s,%llu\n", cab_name, cabinet_sizes[idx]);
+            total_size += cabinet_sizes[idx];
+        }
+        fprintf(stderr, "estimated %lu cabinet(s), %llu bytes\n",
+            (unsigned long)cabinet_count, total_size);
+    }
+    if (cabinet_sizes) {
+        cabx_i_mem_free(cabinet_sizes);
+    }
+    return result;
+}
+
+/**
+ * estimate cabinet which each entry is placed in.
+ * Cabinets are filled with estimated compressed size of entries in the way
+ * which backend does. A file which exceeds max cabinet size continues into
+ * the next cabinet and the file is reported with the last cabinet.
+ */
+static int
+cabx_estimate_cab_map(
+    CABX* obj,
+    unsigned long long** cabinet_sizes,
+    size_t* cabinet_count)
+{
+    int result;
+    size_t cabinet_capacity;
+    size_t entry_count;
+    CABX_ENTRY** entries;
+    const char** source_files;
+    unsigned int* types_compress;
+    unsigned long long* sizes;
+    unsigned long long* file_sizes;
+    unsigned long long max_size;
+    unsigned long long link_size;
+    size_t idx;
+    source_files = NULL;
+    types_compress = NULL;
+    sizes = NULL;
+    file_sizes = NULL;
+    *cabinet_sizes = NULL;
+    *cabinet_count = 0;
+    cabinet_capacity = 0;
+    max_size = obj->option->max_cabinet_size;
+    /* a cabinet has names of previous and next cabinet and disk */
+    link_size = strlen(obj->option->cabinet_name)
+        + strlen(obj->option->disk_name) + 2;
+    result = cabx_get_entries(obj, &entries, &entry_count);
+    if (result == 0) {
+        source_files = (const char**)cabx_i_mem_alloc(
+            sizeof(char*) * (entry_count + 1));
+        types_compress = (unsigned int*)cabx_i_mem_alloc(
+            sizeof(unsigned int) * (entry_count + 1));
+        sizes = (unsigned long long*)cabx_i_mem_alloc(
+            sizeof(unsigned long long) * (entry_count + 1));
+        file_sizes = (unsigned long long*)cabx_i_mem_alloc(
+            sizeof(unsigned long long) * (entry_count + 1));
+        result = source_files && types_compress && sizes && file_sizes ?
+            0 : -1;
+    }
+    if (result == 0) {
+        for (idx = 0; idx < entry_count; idx++) {
+            source_files[idx] = entries[idx]->source_file;
+            file_sizes[idx] = entries[idx]->source_size;
+            types_compress[idx] = cabx_get_entry_compression(obj,
+                entries[idx]);
+        }
+        result = cab_planner_estimate(source_files, file_sizes,
+            types_compress, entry_count, obj->option->jobs, sizes);
+    }
+    if (result == 0) {
+        unsigned long long cab_size;
+        unsigned long long folder_size;
+        unsigned long long folder_position;
+        int folder_open;
+        int close_cabinet;
+        cab_size = CABX_CABINET_HEADER_SIZE;
+        folder_size = 0;
+        folder_position = 0;
+        folder_open = 0;
+        close_cabinet = 0;
+        for (idx = 0; result == 0 && idx < entry_count; idx++) {
+            unsigned long long file_entry_size;
+            unsigned long long data_size;
+            unsigned long long block_size;
+            unsigned long long block_head;
+            close_cabinet = 0;
+            if (idx > 0 && types_compress[idx - 1] != types_compress[idx]) {
+                folder_open = 0;
+                close_cabinet =
+                    !obj->option->backend->mix_compression_types;
+            }
+            if (close_cabinet) {
+                result = cabx_estimate_add_cabinet(cabinet_sizes,
+                    cabinet_count, &cabinet_capacity, cab_size + link_size);
+                cab_size = CABX_CABINET_HEADER_SIZE + link_size;
+            }
+            if (!folder_open) {
+                cab_size += CABX_PLAN_FOLDER_SIZE;
+                folder_size = 0;
+                folder_position = 0;
+                folder_open = 1;
+            }
+            file_entry_size = CABX_PLAN_FILE_SIZE
+                + strlen(entries[idx]->entry_name) + 1;
+            data_size = sizes[idx];
+            cab_size += file_entry_size;
+            /* cabinet is split at data block boundary. block_head is the
+               data size of the file up to the first boundary. */
+            block_size = 0;
+            block_head = 0;
+            if (file_sizes[idx]) {
+                block_size = sizes[idx] * CAB_COMPRESSOR_BLOCK_SIZE
+                    / file_sizes[idx];
+                block_head = (CAB_COMPRESSOR_BLOCK_SIZE
+                    - folder_position % CAB_COMPRESSOR_BLOCK_SIZE)
+                    % CAB_COMPRESSOR_BLOCK_SIZE * sizes[idx]
+                    / file_sizes[idx];
+            }
+            while (result == 0 && max_size != CABX_MAX_CABINET_SIZE_DEF
+                && cab_size + data_size + link_size > max_size) {
+                unsigned long long room;
+                room = 0;
+                if (cab_size + link_size < max_size) {
+                    room = max_size - cab_size - link_size;
+                }
+                if (block_size) {
+                    if (room < block_head) {
+                        room = 0;
+                    } else {
+                        room -= (room - block_head) % block_size;
+                    }
+                    block_head = 0;
+                }
+                if (room == 0 && cab_size == CABX_CABINET_HEADER_SIZE
+                    + link_size + CABX_PLAN_FOLDER_SIZE + file_entry_size) {
+                    /* the cabinet can not hold any data */
+                    break;
+                }
+                data_size -= room;
+                result = cabx_estimate_add_cabinet(cabinet_sizes,
+                    cabinet_count, &cabinet_capacity,
+                    cab_size + room + link_size);
+                /* folder and file continue into the next cabinet */
+                cab_size = CABX_CABINET_HEADER_SIZE + link_size
+                    + CABX_PLAN_FOLDER_SIZE + file_entry_size;
+            }
+            cab_size += data_size;
+            folder_size += sizes[idx];
+            folder_position += file_sizes[idx];
+            if (result == 0) {
+                result = cabx_put_entry_cab_map(obj,
+                    entries[idx]->entry_name, *cabinet_count);
+            }
+            if (folder_size >= obj->option->folder_threshold
+                || entries[idx]->flush_folder) {
+                folder_open = 0;
+            }
+            if (result == 0 && entries[idx]->flush_cabinet
+                && idx + 1 < entry_count) {
+                result = cabx_estimate_add_cabinet(cabinet_sizes,
+                    cabinet_count, &cabinet_capacity, cab_size + link_size);
+                cab_size = CABX_CABINET_HEADER_SIZE + link_size;
+                folder_open = 0;
+            }
+        }
+        if (result == 0 && entry_count) {
+            result = cabx_estimate_add_cabinet(cabinet_sizes, cabinet_count,
+                &cabinet_capacity, cab_size);
+        }
+    }
+    if (file_sizes) {
+        cabx_i_mem_free(file_sizes);
+    }
+    if (sizes) {
+        cabx_i_mem_free(sizes);
+    }
+    if (types_compress) {
+        cabx_i_mem_free(types_compress);
+    }
+    if (source_files) {
+        cabx_i_mem_free(source_files);
+    }
+    if (entries) {
+        cabx_i_mem_free(entries);
+    }
+    return result;
+}
+
+/**
+ * add estimated cabinet size
+ */
+static int
+cabx_estimate_add_cabinet(
+    unsigned long long** cabinet_sizes,
+    size_t* cabinet_count,
+    size_t* cabinet_capacity,
+    unsigned long long cabinet_size)
+{
+    int result;
+    result = 0;
+    if (*cabinet_count == *cabinet_capacity) {
+        unsigned long long* new_sizes;
+        size_t new_capacity;
+        new_capacity = *cabinet_capacity ? *cabinet_capacity * 2 : 16;
+        new_sizes = (unsigned long long*)cabx_i_mem_alloc(
+            sizeof(unsigned long long) * new_capacity);
+        result = new_sizes ? 0 : -1;
+        if (result == 0) {
+            if (*cabinet_sizes) {
+                memcpy(new_sizes, *cabinet_sizes,
+                    sizeof(unsigned long long) * *cabinet_count);
+                cabx_i_mem_free(*cabinet_sizes);
+            }
+            *cabinet_sizes = new_sizes;
+            *cabinet_capacity = new_capacity;
+        }
+    }
+    if (result == 0) {
+        (*cabinet_sizes)[(*cabinet_count)++] = cabinet_size;
+    }
+    return result;
+}
+
+/**
+ * put entry name and cabinet name into entry cabinet map
+ */
+static int
+cabx_put_entry_cab_map(
+    CABX* obj,
+    const char* entry_name,
+    size_t cab_index)
+{
+    int result;
+    char cab_name[CB_MAX_CABINET_NAME];
+    cstr* entry_name_cstr;
+    cstr* cab_name_cstr;
+    cab_name_cstr = NULL;
+    cabx_fill_cabinet_name(obj, (int)cab_index, cab_name, sizeof(cab_name));
+    entry_name_cstr = cstr_create_00(
+        entry_name, strlen(entry_name),
+        (void* (*)(unsigned int))cabx_i_mem_alloc,
+        cabx_i_mem_free);
+    result = entry_name_cstr ? 0 : -1;
+    if (result == 0) {
+        cab_name_cstr = cstr_create_00(
+            cab_name, strlen(cab_name),
+            (void* (*)(unsigned int))cabx_i_mem_alloc,
+            cabx_i_mem_free);
+        result = cab_name_cstr ? 0 : -1;
+    }
+    if (result == 0) {
+        result = col_map_put(obj->entry_cab_map,
+            entry_name_cstr, cab_name_cstr);
+    }
+    if (cab_name_cstr) {
+        cstr_release(cab_name_cstr);
+    }
+    if (entry_name_cstr) {
+        cstr_release(entry_name_cstr);
+    }
+    return result;
+}
+
+/**
+ * resolve AUTO compression, then order, group and plan entries as options
+ * request
+ */
+static int
+cabx_arrange_entries(
+    CABX* obj)
+{
+    int result;
+    result = cabx_check_sources(obj);
+    if (result == 0) {
+        result = cabx_resolve_auto_compression(obj);
+    }
+    if (result == 0 && obj->option->order_entries) {
+        result = cabx_order_entries(obj);
+    }
+    if (result == 0 && obj->option->group_duplicates) {
+        result = cabx_group_duplicates(obj);
+    }
+    if (result == 0 && obj->option->plan_fill) {
+        result = cabx_plan_cabinets(obj);
+    }
+    return result;
+}
+
+/**
+ * get compression type of entry with the global preset.
+ * The global preset is applied to MSZIP and LZX entry without preset.
+ */
+static unsigned int
+cabx_get_entry_compression(
+    CABX* obj,
+    CABX_ENTRY* entry)
+{
+    unsigned int result;
+    /* AUTO is resolved before entries are added into cabinet */
+    result = (unsigned int)entry->compression & ~CAB_COMPRESSOR_AUTO;
+    if ((CompressionTypeFromTCOMP(result) == tcompTYPE_MSZIP
+            || CompressionTypeFromTCOMP(result) == tcompTYPE_LZX)
+        && CAB_COMPRESSOR_PRESET_FROM_TYPE(result)
+            == CAB_COMPRESSOR_PRESET_DEFAULT) {
+        result = CAB_COMPRESSOR_TYPE_WITH_PRESET(result,
+            obj->option->compression_preset);
+    }
+    return result;
+}
+
+/**
+ * make safe relative path from file name in cabinet
+ */
+static int
+cabx_extract_file_path(
+    CABX* obj,
+    const cab_reader_file* file,
+    char** file_path)
+{
+    int result;
+    char* name;
+    name = NULL;
+    if (file->attribs & _A_NAME_IS_UTF) {
+        result = cabx_decode_str(file->name, &name);
+    } else {
+        name = cabx_i_str_dup(file->name);
+        result = name ? 0 : -1;
+    }
+    if (result == 0) {
+        char* name_ptr;
+        char* component;
+        /* names in cabinet are separated by back slash */
+        for (name_ptr = name; *name_ptr; name_ptr++) {
+            if (*name_ptr == '\\') {
+                *name_ptr = '/';
+            }
+        }
+        /* do not write files out of output directory */
+        if (name[0] == '\0' || name[0] == '/'
+            || (name[0] && name[1] == ':')) {
+            result = -1;
+        }
+        component = name;
+        while (result == 0 && component) {
+            char* next_component;
+            size_t component_length;
+            next_component = strchr(component, '/');
+            if (next_component) {
+                component_length = (size_t)(next_component - component);
+            } else {
+                component_length = strlen(component);
+            }
+            if (component_length == 0 || (component_length == 2
+                && component[0] == '.' && component[1] == '.')) {
+                result = -1;
+            }
+            component = next_component ? next_component + 1 : NULL;
+        }
+        if (result) {
+            fprintf(stderr, "can not extract unsafe file name: %s\n", name);
+            errno = EINVAL;
+        }
+    }
+    if (result == 0) {
+#ifdef _WIN32
+        char* name_ptr;
+        for (name_ptr = name; *name_ptr; name_ptr++) {
+            if (*name_ptr == '/') {
+                *name_ptr = '\\';
+            }
+        }
+#endif
+        result = path_join(obj->option->output_dir, name, file_path,
+            cabx_i_mem_alloc, cabx_i_mem_free);
+    }
+    if (name) {
+        cabx_i_mem_free(name);
+    }
+    return result;
+}
+
 /**
  * remove last cabinet if it is empty
  */
@@ -1925,13 +5349,9 @@ cabx_remove_last_cab_if_empty(
         char* raw_out_dir;
         char* raw_cab_name;
         char* raw_cab_path;
-        wchar_t* cab_path_w;
-        wchar_t* out_dir_w;
         raw_out_dir = NULL;
         raw_cab_name = NULL;
         raw_cab_path = NULL;
-        cab_path_w = NULL;
-        out_dir_w = NULL;
         tmp_path = cstr_create_01(
             (void* (*)(unsigned int))cabx_i_mem_alloc,
             cabx_i_mem_free);
@@ -1954,27 +5374,12 @@ cabx_remove_last_cab_if_empty(
             raw_cab_path = cstr_to_flat_str(tmp_path);
             result = raw_cab_path ? 0 : -1;
         }
-        if (result == 0) {
-            cab_path_w = (wchar_t*)str_conv_utf8_to_utf16(
-                raw_cab_path, cstr_length(tmp_path) + 1,
-                cabx_i_mem_alloc, cabx_i_mem_free);
-            result = cab_path_w ? 0 : -1;
-        }
-        if (result == 0) {
-            out_dir_w = (wchar_t*)str_conv_utf8_to_utf16(
-                raw_out_dir, cstr_length(out_dir) + 1,
-                cabx_i_mem_alloc, cabx_i_mem_free);
-            result = out_dir_w ? 0 : -1;
-        }
         
         if (result == 0) {
-            _wremove(cab_path_w);
-            _wrmdir(out_dir_w);
+            file_i_remove(raw_cab_path);
+            dir_rmdir(raw_out_dir);
         } 
         
-        cabx_i_mem_free(out_dir_w);
-        cabx_i_mem_free(cab_path_w);
-        
         if (result == 0) {
             cstr_free_flat_str(tmp_path, raw_cab_path);
         }
@@ -2047,25 +5452,13 @@ cabx_report_cab_map(
         if (strcmp(obj->option->report_file, "-") == 0) {
             fs = stdout;
         } else {
-            wchar_t* report_file_w;
-            report_file_w = str_conv_utf8_to_utf16(
-                obj->option->report_file,
-                strlen(obj->option->report_file) + 1,
-                cabx_i_mem_alloc, cabx_i_mem_free);
-            result = report_file_w ? 0 : -1;
-            if (result == 0) {
-                fs = _wfopen(report_file_w, L"w");
-                result = fs ? 0 : -1;
-            }
-
-            if (report_file_w) {
-                cabx_i_mem_free(report_file_w);
-            }
+            fs = file_i_fopen(obj->option->report_file, "w");
+            result = fs ? 0 : -1;
         }
         if (result == 0) {
             if (obj->option->show_status) {
-                if (_isatty(_fileno(stderr)) && _isatty(_fileno(fs))) {
-                    fputws(L"\033[K", fs);
+                if (file_i_isatty(stderr) && file_i_isatty(fs)) {
+                    file_i_fputs("\033[K", fs);
                 }
             }
         }
@@ -2170,13 +5563,11 @@ cabx_entries_iter_for_reporting(
     int state;
     cstr* entry_name_cstr; 
     cstr* cabinet_name_cstr;
-    wchar_t* entry_name_w;
-    wchar_t* cabinet_name_w; 
+    char* cabinet_name;
     result = 0;
     state = 0;
     cabinet_name_cstr = NULL;
-    entry_name_w = NULL;
-    cabinet_name_w = NULL;
+    cabinet_name = NULL;
     entry_name_cstr = cstr_create_00(
         entry->entry_name,
         strlen(entry->entry_name),
@@ -2189,53 +5580,29 @@ cabx_entries_iter_for_reporting(
             (void **)&cabinet_name_cstr);
 
         if (cabinet_name_cstr) {
-            char* cabinet_name;
-
             cabinet_name = cstr_to_flat_str_0(cabinet_name_cstr,
                 (void* (*)(unsigned int))cabx_i_mem_alloc);  
             state = cabinet_name ? 0 : -1;
-
-            if (state == 0) {
-                cabinet_name_w = (wchar_t *)str_conv_utf8_to_utf16(
-                    cabinet_name,
-                    cstr_length(cabinet_name_cstr) + 1,
-                    cabx_i_mem_alloc,
-                    cabx_i_mem_free);
-                state = cabinet_name_w ? 0 : -1;
-            }
-
-            if (cabinet_name) {
-                cabx_i_mem_free(cabinet_name);
-            }
         }
     }
     if (state == 0) {
-        entry_name_w = (wchar_t *)str_conv_utf8_to_utf16(
-            entry->entry_name,
-            strlen(entry->entry_name) + 1,
-            cabx_i_mem_alloc,
-            cabx_i_mem_free);
-        state = entry_name_w ? 0 : -1;
-    }
-    if (state == 0) {
-        if (entry_name_w && cabinet_name_w) {
-            fwprintf(iter_state->output_stream,
-                L"%ls,%ls\n",
-                entry_name_w,
-                cabinet_name_w);
+        if (cabinet_name) {
+            file_i_fputs(entry->entry_name, iter_state->output_stream);
+            file_i_fputs(",", iter_state->output_stream);
+            file_i_fputs(cabinet_name, iter_state->output_stream);
+            if (entry->duplicate_group) {
+                file_i_fputs(",", iter_state->output_stream);
+                file_i_fputs(entry->duplicate_group,
+                    iter_state->output_stream);
+            }
+            file_i_fputs("\n", iter_state->output_stream);
         }
     }
 
-
-    if (entry_name_w) {
-        cabx_i_mem_free(entry_name_w);
-    }
-
-    if (cabinet_name_w) {
-        cabx_i_mem_free(cabinet_name_w);
+    if (cabinet_name) {
+        cabx_i_mem_free(cabinet_name);
     }
 
-
     if (cabinet_name_cstr) {
         cstr_release(cabinet_name_cstr);
     }
@@ -2243,6 +5610,7 @@ cabx_entries_iter_for_reporting(
     if (entry_name_cstr) {
         cstr_release(entry_name_cstr);
     }
+    return result;
 }
 
 
@@ -2353,7 +5721,7 @@ cabx_option_create()
     char* disk_name;
     result = (CABX_OPTION*)cabx_i_mem_alloc(sizeof(CABX_OPTION));
     input = cabx_i_str_dup("-");
-    output_dir = cabx_i_str_dup(".\\");
+    output_dir = cabx_i_str_dup(CABX_OUTPUT_DIR_DEF);
     cabinet_name = cabx_i_str_dup("data%d.cab");
     disk_name = cabx_i_str_dup("");
     if (result && input && output_dir && cabinet_name && disk_name) {
@@ -2365,6 +5733,24 @@ cabx_option_create()
         result->max_cabinet_size = CABX_MAX_CABINET_SIZE_DEF;
         result->folder_threshold = CABX_FOLDER_THRESHOLD_DEF;
         result->report_file = NULL;
+        result->backend = &CABX_BACKENDS[0];
+        result->compression_preset = CAB_COMPRESSOR_PRESET_DEFAULT;
+        result->jobs = 1;
+        result->map_source = 1;
+        result->write_thread = 0;
+        result->temp_memory = CABX_TEMP_MEMORY_DEF;
+        result->pipeline = 0;
+        result->folder_cache = NULL;
+        result->extract = NULL;
+        result->group_duplicates = 0;
+        result->order_entries = 0;
+        result->plan_fill = 0;
+        result->read_ahead = 0;
+        result->io_ring = 0;
+        result->input_dir = NULL;
+        result->input_rules = NULL;
+        result->compile_manifest = NULL;
+        result->dry_run = 0;
     } else {
         if (input) {
             cabx_i_mem_free(input);
@@ -2398,6 +5784,11 @@ cabx_option_free(
         cabx_option_set_output_dir(opt, NULL);
         cabx_option_set_cabinet_name(opt, NULL);
         cabx_option_set_disk_name(opt, NULL);
+        cabx_option_set_folder_cache(opt, NULL);
+        cabx_option_set_extract(opt, NULL);
+        cabx_option_set_input_dir(opt, NULL);
+        cabx_option_set_input_rules(opt, NULL);
+        cabx_option_set_compile_manifest(opt, NULL);
         if (opt->report_file) {
             cabx_i_mem_free(opt->report_file);
             opt->report_file = NULL;
@@ -2550,30 +5941,382 @@ cabx_option_set_folder_threshold(
     if (result == 0) {
         opt->folder_threshold = l_value;
     }
-    return result;  
+    return result;  
+}
+
+
+/**
+ * set report file into option
+ */
+static int
+cabx_option_set_report(
+    CABX_OPTION* opt,
+    const char* report_file)
+{
+    int result;
+    result = 0;
+    if (opt) {
+        if (!report_file) {
+            report_file = "-";
+        }
+        if (opt->report_file != report_file) {
+            if (opt->report_file) {
+                cabx_i_mem_free(opt->report_file);
+                opt->report_file = NULL;
+            }
+            opt->report_file = cabx_i_str_dup(report_file);
+        }
+    } else {
+        errno = EINVAL;
+        result = -1;
+    }
+    return result;
+}
+
+/**
+ * set compression preset by name into option
+ */
+static int
+cabx_option_set_compression_preset(
+    CABX_OPTION* opt,
+    const char* preset_name)
+{
+    int result;
+    result = 0;
+    if (opt && preset_name) {
+        size_t idx;
+        for (idx = 0; idx < sizeof(CABX_COMPRESSION_PRESETS)
+            / sizeof(CABX_COMPRESSION_PRESETS[0]); idx++) {
+            if (strcmp(CABX_COMPRESSION_PRESETS[idx].name,
+                preset_name) == 0) {
+                break;
+            }
+        }
+        if (idx < sizeof(CABX_COMPRESSION_PRESETS)
+            / sizeof(CABX_COMPRESSION_PRESETS[0])) {
+            opt->compression_preset = CABX_COMPRESSION_PRESETS[idx].preset;
+        } else {
+            fprintf(stderr, "unsupported preset: %s\n", preset_name);
+            errno = EINVAL;
+            result = -1;
+        }
+    } else {
+        errno = EINVAL;
+        result = -1;
+    }
+    return result;
+}
+
+/**
+ * set count of threads compressing folders into option
+ */
+static int
+cabx_option_set_jobs(
+    CABX_OPTION* opt,
+    const char* jobs)
+{
+    int result;
+    int value;
+    value = 0;
+    if (opt && jobs) {
+        result = number_parser_str_to_int(jobs, 10, &value);
+        if (result == 0 && value < 0) {
+            errno = EINVAL;
+            result = -1;
+        }
+        if (result) {
+            fprintf(stderr, "invalid jobs: %s\n", jobs);
+        }
+    } else {
+        errno = EINVAL;
+        result = -1;
+    }
+    if (result == 0) {
+        if (value) {
+            opt->jobs = (unsigned int)value;
+        } else {
+            opt->jobs = thread_i_get_processor_count();
+        }
+    }
+    return result;
+}
+
+/**
+ * set percent of max cabinet size filled by planned entries into option
+ */
+static int
+cabx_option_set_plan_fill(
+    CABX_OPTION* opt,
+    const char* fill)
+{
+    int result;
+    int value;
+    value = (int)CABX_PLAN_FILL_DEF;
+    if (opt) {
+        result = 0;
+        if (fill) {
+            result = number_parser_str_to_int(fill, 10, &value);
+            if (result == 0 && (value <= 0 || value > 100)) {
+                errno = EINVAL;
+                result = -1;
+            }
+            if (result) {
+                fprintf(stderr, "invalid cabinet fill percent: %s\n", fill);
+            }
+        }
+    } else {
+        errno = EINVAL;
+        result = -1;
+    }
+    if (result == 0) {
+        opt->plan_fill = (unsigned int)value;
+    }
+    return result;
+}
+
+/**
+ * set count of source files read ahead into option
+ */
+static int
+cabx_option_set_read_ahead(
+    CABX_OPTION* opt,
+    const char* count)
+{
+    int result;
+    int value;
+    value = 0;
+    if (opt && count) {
+        result = number_parser_str_to_int(count, 10, &value);
+        if (result == 0
+            && (value < 0 || (unsigned int)value > CABX_READ_AHEAD_MAX)) {
+            errno = EINVAL;
+            result = -1;
+        }
+        if (result) {
+            fprintf(stderr, "invalid read ahead count: %s\n", count);
+        }
+    } else {
+        errno = EINVAL;
+        result = -1;
+    }
+    if (result == 0) {
+        opt->read_ahead = (unsigned int)value;
+    }
+    return result;
+}
+
+/**
+ * set source access mode by name into option
+ */
+static int
+cabx_option_set_source_access(
+    CABX_OPTION* opt,
+    const char* access_name)
+{
+    int result;
+    result = 0;
+    if (opt && access_name) {
+        if (strcmp(access_name, "map") == 0) {
+            opt->map_source = 1;
+        } else if (strcmp(access_name, "stream") == 0) {
+            opt->map_source = 0;
+        } else {
+            fprintf(stderr, "unsupported source access: %s\n", access_name);
+            errno = EINVAL;
+            result = -1;
+        }
+    } else {
+        errno = EINVAL;
+        result = -1;
+    }
+    return result;
+}
+
+/**
+ * set memory budget for temporary files by string format into option
+ */
+static int
+cabx_option_set_temp_memory(
+    CABX_OPTION* opt,
+    const char* size_str)
+{
+    int result;
+    unsigned long l_value;
+    l_value = 0;
+    result = number_parser_str_to_long_with_mod(size_str, 0, &l_value);
+    if (result == 0) {
+        opt->temp_memory = l_value;
+    }
+    return result;
+}
+
+/**
+ * set folder cache directory into option
+ */
+static int
+cabx_option_set_folder_cache(
+    CABX_OPTION* opt,
+    const char* dir_path)
+{
+    int result;
+    result = 0;
+    if (opt) {
+        if (opt->folder_cache != dir_path) {
+            if (opt->folder_cache) {
+                cabx_i_mem_free(opt->folder_cache);
+                opt->folder_cache = NULL;
+            }
+            if (dir_path) {
+                opt->folder_cache = cabx_i_str_dup(dir_path);
+                result = opt->folder_cache ? 0 : -1;
+            }
+        }
+    } else {
+        errno = EINVAL;
+        result = -1;
+    }
+    return result;
+}
+
+/**
+ * set cabinet to extract files from into option
+ */
+static int
+cabx_option_set_extract(
+    CABX_OPTION* opt,
+    const char* cab_path)
+{
+    int result;
+    result = 0;
+    if (opt) {
+        if (opt->extract != cab_path) {
+            if (opt->extract) {
+                cabx_i_mem_free(opt->extract);
+                opt->extract = NULL;
+            }
+            if (cab_path) {
+                opt->extract = cabx_i_str_dup(cab_path);
+                result = opt->extract ? 0 : -1;
+            }
+        }
+    } else {
+        errno = EINVAL;
+        result = -1;
+    }
+    return result;
+}
+
+/**
+ * set input directory into option
+ */
+static int
+cabx_option_set_input_dir(
+    CABX_OPTION* opt,
+    const char* dir_path)
+{
+    int result;
+    result = 0;
+    if (opt) {
+        if (opt->input_dir != dir_path) {
+            if (opt->input_dir) {
+                cabx_i_mem_free(opt->input_dir);
+                opt->input_dir = NULL;
+            }
+            if (dir_path) {
+                opt->input_dir = cabx_i_str_dup(dir_path);
+                result = opt->input_dir ? 0 : -1;
+            }
+        }
+    } else {
+        errno = EINVAL;
+        result = -1;
+    }
+    return result;
+}
+
+/**
+ * set rules file for input directory into option
+ */
+static int
+cabx_option_set_input_rules(
+    CABX_OPTION* opt,
+    const char* rules_path)
+{
+    int result;
+    result = 0;
+    if (opt) {
+        if (opt->input_rules != rules_path) {
+            if (opt->input_rules) {
+                cabx_i_mem_free(opt->input_rules);
+                opt->input_rules = NULL;
+            }
+            if (rules_path) {
+                opt->input_rules = cabx_i_str_dup(rules_path);
+                result = opt->input_rules ? 0 : -1;
+            }
+        }
+    } else {
+        errno = EINVAL;
+        result = -1;
+    }
+    return result;
+}
+
+/**
+ * set binary manifest file compiled from input into option
+ */
+static int
+cabx_option_set_compile_manifest(
+    CABX_OPTION* opt,
+    const char* manifest_path)
+{
+    int result;
+    result = 0;
+    if (opt) {
+        if (opt->compile_manifest != manifest_path) {
+            if (opt->compile_manifest) {
+                cabx_i_mem_free(opt->compile_manifest);
+                opt->compile_manifest = NULL;
+            }
+            if (manifest_path) {
+                opt->compile_manifest = cabx_i_str_dup(manifest_path);
+                result = opt->compile_manifest ? 0 : -1;
+            }
+        }
+    } else {
+        errno = EINVAL;
+        result = -1;
+    }
+    return result;
 }
 
-
 /**
- * set report file into option
+ * set cabinet generation backend by name into option
  */
 static int
-cabx_option_set_report(
+cabx_option_set_backend(
     CABX_OPTION* opt,
-    const char* report_file)
+    const char* backend_name)
 {
     int result;
     result = 0;
-    if (opt) {
-        if (!report_file) {
-            report_file = "-";
-        }
-        if (opt->report_file != report_file) {
-            if (opt->report_file) {
-                cabx_i_mem_free(opt->report_file);
-                opt->report_file = NULL;
+    if (opt && backend_name) {
+        size_t idx;
+        const CABX_BACKEND* backend;
+        backend = NULL;
+        for (idx = 0;
+            idx < sizeof(CABX_BACKENDS) / sizeof(CABX_BACKENDS[0]); idx++) {
+            if (strcmp(CABX_BACKENDS[idx].name, backend_name) == 0) {
+                backend = &CABX_BACKENDS[idx];
+                break;
             }
-            opt->report_file = cabx_i_str_dup(report_file);
+        }
+        if (backend) {
+            opt->backend = backend;
+        } else {
+            fprintf(stderr, "unsupported backend: %s\n", backend_name);
+            errno = EINVAL;
+            result = -1;
         }
     } else {
         errno = EINVAL;
@@ -2599,6 +6342,11 @@ cabx_entry_create_0()
         result->entry_name = NULL;
         result->compression = 0;
         result->attribute = 0;
+        result->duplicate_group = NULL;
+        result->source_checked = 0;
+        result->source_size = 0;
+        result->source_mtime = 0;
+        result->in_manifest = 0;
     }
     return result;
 }
@@ -2676,9 +6424,13 @@ cabx_entry_release(
     result = 0;
     if (entry) {
         result = --entry->ref_count;
-        if (result == 0) {
+        if (result == 0 && entry->in_manifest) {
+            /* the names and the entry are owned by binary manifest */
+            cabx_entry_set_duplicate_group(entry, NULL);
+        } else if (result == 0) {
             cabx_entry_set_source_file(entry, NULL);
             cabx_entry_set_entry_name(entry, NULL);
+            cabx_entry_set_duplicate_group(entry, NULL);
             cabx_i_mem_free(entry);
         }
     } else {
@@ -2803,6 +6555,40 @@ cabx_entry_set_entry_name(
 }
 
 
+/**
+ * set entry name of the first entry having the same source contents
+ */
+static int
+cabx_entry_set_duplicate_group(
+    CABX_ENTRY* entry,
+    const char* entry_name)
+{
+    int result;
+    result = 0;
+    if (entry)  {
+        if (entry->duplicate_group != entry_name) {
+            char* new_value;
+            if (entry_name) {
+                new_value = cabx_i_str_dup(entry_name);
+                result = new_value ? 0 : -1;
+            } else {
+                new_value = 0;
+            }
+            if (result == 0) {
+                if (entry->duplicate_group) {
+                    cabx_i_mem_free(entry->duplicate_group);
+                    entry->duplicate_group = NULL;
+                }
+                entry->duplicate_group = new_value;
+            }
+        }
+    } else {
+        errno = EINVAL;
+        result = -1;
+    }
+    return result;
+}
+
 /**
  * be called when a file is placed in cabinet.
  */
@@ -2819,8 +6605,6 @@ cabx_fci_file_placed(
     char* decode_file;
     cstr* file_entry_cstr;
     cstr* cab_name_cstr;
-    wchar_t* decode_file_w;
-    wchar_t* cab_name_w;
 
     CABX_GENERATION_STATUS* gen_status;
 
@@ -2828,8 +6612,6 @@ cabx_fci_file_placed(
     file_entry_cstr = NULL;
     cab_name_cstr = NULL;
     decode_file = NULL;
-    decode_file_w = NULL;
-    cab_name_w = NULL;
     gen_status = (CABX_GENERATION_STATUS*)user_data;
     cabx_decode_str(file, &decode_file);
     state = decode_file ? 0 : -1;
@@ -2880,19 +6662,6 @@ cabx_fci_file_placed(
             gen_status->cabx->cab_entries_map,
             cab_name_cstr, file_entry_cstr);
     }
-    if (state == 0) {
-        decode_file_w = str_conv_utf8_to_utf16(
-            decode_file, strlen(decode_file) + 1,
-            cabx_i_mem_alloc, cabx_i_mem_free);
-        state = decode_file_w ? 0 : -1;
-    }
-    if (state == 0) {
-        cab_name_w = (wchar_t*)str_conv_utf8_to_utf16(
-           pccab->szCab, 
-           strlen(pccab->szCab) + 1,
-           cabx_i_mem_alloc, cabx_i_mem_free);
-        state = cab_name_w ? 0 : -1;
-    }
     if (state == 0) {
         if (file_entry_cstr && cab_name_cstr) {
             state = col_map_put(
@@ -2902,14 +6671,13 @@ cabx_fci_file_placed(
     }
     if (state == 0) {
         if (gen_status->cabx->option->show_status) {
-            const wchar_t* format;
-            if (_isatty(_fileno(stderr))) {
-                format = L"\033[Kplaced %ls in %ls\r";
-            } else {
-                format = L"placed %ls in %ls\n";
-            }
-            fwprintf(stderr, format,
-                decode_file_w, cab_name_w);
+            int is_tty;
+            is_tty = file_i_isatty(stderr);
+            file_i_fputs(is_tty ? "\033[Kplaced " : "placed ", stderr);
+            file_i_fputs(decode_file, stderr);
+            file_i_fputs(" in ", stderr);
+            file_i_fputs(pccab->szCab, stderr);
+            file_i_fputs(is_tty ? "\r" : "\n", stderr);
         }
     }
     if (file_entry_cstr) {
@@ -2918,12 +6686,6 @@ cabx_fci_file_placed(
     if (cab_name_cstr) {
         cstr_release(cab_name_cstr);
     }
-    if (cab_name_w) {
-        cabx_i_mem_free(cab_name_w);
-    }
-    if (decode_file_w) {
-        cabx_i_mem_free(decode_file_w);
-    }
     if (decode_file) {
         cabx_i_mem_free(decode_file);
     }
@@ -2964,35 +6726,52 @@ cabx_fci_open(
     void* user_data)
 {
     FILE* fs;
-    wchar_t* file_path_w;
+    CABX_FILE* result;
     int state;
     CABX_GENERATION_STATUS* gen_status;
 
     fs = NULL;
-    file_path_w = NULL;
+    result = NULL;
     gen_status = (CABX_GENERATION_STATUS*)user_data;
-    
-    state = cabx_handle_file_path_for_output_dir(
-        gen_status->cabx, file_path, 
-        cabx_create_output_dir_if_not);
-
+    state = 0;
+    if (gen_status->temp_store) {
+        /* temporary files are opened from memory */
+        temp_store_file* temp;
+        temp = temp_store_open(gen_status->temp_store, file_path,
+            open_flag & O_TRUNC);
+        if (temp) {
+            result = (CABX_FILE*)cabx_i_mem_alloc(sizeof(CABX_FILE));
+            if (result) {
+                result->stream = NULL;
+                result->writer = NULL;
+                result->temp = temp;
+                result->ahead_data = NULL;
+                result->ahead_size = 0;
+            } else {
+                temp_store_close(temp);
+            }
+            state = 1;
+        } else if (errno != ENOENT) {
+            state = -1;
+        }
+    }
     if (state == 0) {
-        file_path_w = str_conv_utf8_to_utf16(
-            file_path, strlen(file_path) + 1, 
-            cabx_i_mem_alloc, cabx_i_mem_free);
-        state = file_path_w ? 0 : -1;
+        state = cabx_handle_file_path_for_output_dir(
+            gen_status->cabx, file_path, 
+            cabx_create_output_dir_if_not);
     }
+
     if (state == 0) {
         int fd;
-        fd = _wopen(file_path_w, open_flag | _O_BINARY, mode); 
+        fd = file_i_open(file_path, open_flag, mode); 
         if (fd >= 0) {
             const char* f_mode;
-            int r_opt = _O_RDONLY;
-            int r_p_opt = _O_RDWR; 
-            int w_opt = _O_WRONLY | _O_CREAT | _O_TRUNC;
-            int w_p_opt = _O_RDWR | _O_CREAT | _O_TRUNC;
-            int a_opt = _O_WRONLY | _O_CREAT | _O_APPEND;
-            int a_p_opt = _O_RDWR | _O_CREAT | _O_APPEND;
+            int r_opt = O_RDONLY;
+            int r_p_opt = O_RDWR; 
+            int w_opt = O_WRONLY | O_CREAT | O_TRUNC;
+            int w_p_opt = O_RDWR | O_CREAT | O_TRUNC;
+            int a_opt = O_WRONLY | O_CREAT | O_APPEND;
+            int a_p_opt = O_RDWR | O_CREAT | O_APPEND;
             
             if ((open_flag & a_p_opt) == a_p_opt) {
                 f_mode = "a+b";
@@ -3007,18 +6786,52 @@ cabx_fci_open(
             } else {
                 f_mode = "rb";
             }
-            fs = _fdopen(fd, f_mode);
+            fs = file_i_fdopen(fd, f_mode);
+            if (fs == NULL) {
+                close(fd);
+            }
         }
-        if (fs == NULL) {
+        if (fs) {
+            result = (CABX_FILE*)cabx_i_mem_alloc(sizeof(CABX_FILE));
+        }
+        if (result) {
+            result->stream = fs;
+            result->writer = NULL;
+            result->temp = NULL;
+            result->ahead_data = NULL;
+            result->ahead_size = 0;
+            if (gen_status->cabx->option->io_ring
+                && (open_flag & O_CREAT) && !(open_flag & O_APPEND)
+                && (open_flag & (O_WRONLY | O_RDWR))) {
+                /* buffers are written at offsets while the next is filled */
+                setvbuf(fs, NULL, _IONBF, 0);
+                result->writer = buffered_writer_create_1(fs,
+                    CABX_WRITE_BUFFER_SIZE);
+                if (!result->writer) {
+                    cabx_i_mem_free(result);
+                    result = NULL;
+                }
+            } else if ((open_flag & (O_WRONLY | O_RDWR | O_CREAT))
+                == (O_WRONLY | O_CREAT)) {
+                setvbuf(fs, NULL, _IONBF, 0);
+                result->writer = buffered_writer_create(fs,
+                    CABX_WRITE_BUFFER_SIZE, gen_status->write_pool);
+                if (!result->writer) {
+                    cabx_i_mem_free(result);
+                    result = NULL;
+                }
+            }
+        }
+        if (result == NULL) {
             *err = errno;
+            if (fs) {
+                fclose(fs);
+            }
         }
-    } else {
+    } else if (!result) {
         *err = errno;
     }
-    if (file_path_w) {
-        cabx_i_mem_free(file_path_w);
-    }
-    return (intptr_t)fs;
+    return result ? (intptr_t)result : -1;
 }
 
 /**
@@ -3134,24 +6947,9 @@ cabx_create_output_dir_if_not(
 {
     int result;
     result = 0;
-
-    wchar_t* output_dir_w; 
-
-    output_dir_w = (wchar_t*)str_conv_utf8_to_utf16(
-        output_dir, strlen(output_dir) + 1,
-        cabx_i_mem_alloc, cabx_i_mem_free);
-
-    result = output_dir_w ? 0 : -1;
-    if (result == 0) {
-        int status;
-        struct _stat st;
-        memset(&st, 0, sizeof(st));
-        status = _wstat(output_dir_w, &st);
-        if (status) {
-            result = _wmkdir(output_dir_w);
-        }
+    if (!dir_is_exists(output_dir)) {
+        result = dir_mkdir(output_dir);
     }
-    cabx_i_mem_free(output_dir_w);
     return result;
 }
 
@@ -3168,24 +6966,9 @@ cabx_remove_output_dir(
 {
     int result;
     result = 0;
-
-    wchar_t* output_dir_w; 
-
-    output_dir_w = (wchar_t*)str_conv_utf8_to_utf16(
-        output_dir, strlen(output_dir) + 1,
-        cabx_i_mem_alloc, cabx_i_mem_free);
-
-    result = output_dir_w ? 0 : -1;
-    if (result == 0) {
-        int status;
-        struct _stat st;
-        memset(&st, 0, sizeof(st));
-        status = _wstat(output_dir_w, &st);
-        if (status == 0) {
-            result = _wrmdir(output_dir_w);
-        }
+    if (dir_is_exists(output_dir)) {
+        result = dir_rmdir(output_dir);
     }
-    cabx_i_mem_free(output_dir_w);
     return result;
 }
 
@@ -3202,14 +6985,46 @@ cabx_fci_read(
     int* err,
     void* user_data)
 {
-    FILE* fs;
+    CABX_FILE* file;
     size_t read_size;
+    int state;
     read_size = 0;
-    fs = (FILE*)file_hdl;
-    read_size = fread(buffer, 1, buffer_size, fs);
-
-
-    if (read_size == 0 && feof(fs) == 0) {
+    file = (CABX_FILE*)file_hdl;
+    state = 0;
+    if (file->writer) {
+        state = buffered_writer_flush(file->writer);
+    }
+    if (state == 0 && file->temp) {
+        state = temp_store_read(file->temp, buffer, buffer_size, &read_size);
+        if (state) {
+            *err = errno;
+        }
+    } else if (state == 0) {
+        long offset;
+        offset = file->ahead_data ? ftell(file->stream) : -1;
+        if (offset >= 0 && (unsigned long)offset < file->ahead_size) {
+            /* the beginning of source file is copied from data read ahead */
+            read_size = file->ahead_size - (size_t)offset;
+            if (read_size > buffer_size) {
+                read_size = buffer_size;
+            }
+            memcpy(buffer, file->ahead_data + offset, read_size);
+            state = fseek(file->stream, offset + (long)read_size, SEEK_SET);
+            if (state) {
+                *err = errno;
+                read_size = 0;
+            }
+        }
+        if (state == 0 && read_size < buffer_size) {
+            size_t size;
+            size = fread((char*)buffer + read_size, 1,
+                buffer_size - read_size, file->stream);
+            if (size == 0 && read_size == 0 && feof(file->stream) == 0) {
+                *err = errno;
+            }
+            read_size += size;
+        }
+    } else {
         *err = errno;
     }
     return (unsigned int)read_size;
@@ -3226,16 +7041,28 @@ cabx_fci_write(
     int* err,
     void* user_data)
 {
-    FILE* fs;
+    CABX_FILE* file;
     size_t written_size;
-    fs = (FILE*)file_hdl;
+    file = (CABX_FILE*)file_hdl;
 
-    written_size = fwrite(buffer, 1, buffer_size, fs);
+    if (file->writer) {
+        if (buffered_writer_write(file->writer, buffer, buffer_size) == 0) {
+            written_size = buffer_size;
+        } else {
+            written_size = 0;
+        }
+    } else if (file->temp) {
+        if (temp_store_write(file->temp, buffer, buffer_size) == 0) {
+            written_size = buffer_size;
+        } else {
+            written_size = 0;
+        }
+    } else {
+        written_size = fwrite(buffer, 1, buffer_size, file->stream);
+    }
 
     if (written_size != buffer_size) {
         *err = errno;
-    } else {
-        fflush(fs);
     }
     return (unsigned int)written_size;
 }
@@ -3251,17 +7078,30 @@ cabx_fci_seek(
     int *err,
     void* user_data)
 {
-    FILE* fs;
+    CABX_FILE* file;
     long result;
-    fs = (FILE*)file_hdl;
+    file = (CABX_FILE*)file_hdl;
     result = -1;
-    if (fs) {
+    if (file) {
         int state;
-        state = fseek(fs, dist, seek_type);
-        if (state) {
-            *err = errno;
+        state = 0;
+        if (file->writer) {
+            state = buffered_writer_flush(file->writer);
+        }
+        if (state == 0 && file->temp) {
+            result = temp_store_seek(file->temp, dist, seek_type);
+            if (result == -1) {
+                *err = errno;
+            }
         } else {
-            result = ftell(fs);
+            if (state == 0) {
+                state = fseek(file->stream, dist, seek_type);
+            }
+            if (state) {
+                *err = errno;
+            } else {
+                result = ftell(file->stream);
+            }
         }
 
     } else {
@@ -3281,18 +7121,91 @@ cabx_fci_close(
     int *err,
     void* user_data)
 {
-    FILE* fs;
+    CABX_FILE* file;
     int result;
-    fs = (FILE*)file_hdl;
+    file = (CABX_FILE*)file_hdl;
     result = 0;
-    if (fs) {
-        fclose(fs); 
+    if (file) {
+        if (file->writer) {
+            result = buffered_writer_free(file->writer);
+            if (result) {
+                *err = errno;
+            }
+        }
+        if (file->temp) {
+            result = temp_store_close(file->temp);
+            if (result) {
+                *err = errno;
+            }
+        } else if (fclose(file->stream) && result == 0) {
+            *err = errno;
+            result = -1;
+        }
+        read_ahead_free_data(file->ahead_data);
+        cabx_i_mem_free(file);
     } else {
         *err = EINVAL;
     }
     return result;
 }
 
+/**
+ * map source file for native backend.
+ * You get NULL for small, huge or not regular file, then the backend reads
+ * the file through stream.
+ */
+static const void*
+cabx_fci_map(
+    intptr_t file_hdl,
+    unsigned long size,
+    int *err,
+    void* user_data)
+{
+    FILE* fs;
+    const void* result;
+    file_i_stat_info stat_content;
+    int state;
+    fs = file_hdl != -1 ? ((CABX_FILE*)file_hdl)->stream : NULL;
+    result = NULL;
+    state = fs ? 0 : -1;
+    if (state == 0) {
+        state = size >= CABX_MAP_SIZE_MIN && size <= CABX_MAP_SIZE_MAX ?
+            0 : -1;
+    }
+    if (state == 0) {
+        state = file_i_fstat(fileno(fs), &stat_content);
+    }
+    if (state == 0) {
+        state = stat_content.is_regular && stat_content.size >= size ?
+            0 : -1;
+    }
+    if (state == 0) {
+        result = file_i_map(fileno(fs), (size_t)size);
+        if (!result) {
+            *err = errno;
+        }
+    }
+    return result;
+}
+
+/**
+ * unmap source file for native backend
+ */
+static int
+cabx_fci_unmap(
+    const void* data,
+    unsigned long size,
+    int *err,
+    void* user_data)
+{
+    int result;
+    result = file_i_unmap(data, (size_t)size);
+    if (result) {
+        *err = errno;
+    }
+    return result;
+}
+
 /**
  * delete file for fci
  */
@@ -3303,29 +7216,22 @@ cabx_fci_delete(
     void* user_data)
 {
     int result;
-    wchar_t* file_path_w;
-    result = 0;
-    file_path_w = (wchar_t*)str_conv_utf8_to_utf16(
-        file_path, strlen(file_path) + 1,
-        cabx_i_mem_alloc, cabx_i_mem_free);
-
-    if (file_path_w)  {
-        result = _wremove(file_path_w);
-        if (result) {
-            *err = errno;
-        }
-    } else {
+    CABX_GENERATION_STATUS* gen_status;
+    gen_status = (CABX_GENERATION_STATUS*)user_data;
+    if (gen_status->temp_store) {
+        temp_store_remove(gen_status->temp_store, file_path);
+    }
+    result = file_i_remove(file_path);
+    if (result) {
         *err = errno;
     }
-
-    cabx_i_mem_free(file_path_w);
-    
     return result;
 }
 
 
 /**
- * get temporary file name
+ * get temporary file name.
+ * The file is held in memory while it fits in the temporary memory budget.
  */
 static int
 cabx_fci_get_temporary_file_name(
@@ -3334,33 +7240,19 @@ cabx_fci_get_temporary_file_name(
     void* user_data)
 {
     int result;
-    wchar_t* tmp_file_w;
-    const size_t tmp_file_w_size = PATH_MAX;
-    CABX_GENERATION_STATUS* gen_status = (CABX_GENERATION_STATUS*)user_data;
-
-    tmp_file_w = (wchar_t*)cabx_i_mem_alloc(tmp_file_w_size * sizeof(wchar_t)); 
-    result = tmp_file_w ? TRUE : FALSE;
-    if (result == TRUE) {
-        char* tmp_file;
-        size_t tmp_file_w_len;
-        _wtmpnam(tmp_file_w);
-
-        tmp_file_w_len = wcslen(tmp_file_w);
-        tmp_file = str_conv_utf16_to_utf8(tmp_file_w, tmp_file_w_len + 1,
-            cabx_i_mem_alloc, cabx_i_mem_free);
-        if (tmp_file) {
-            size_t tmp_file_len;
-            tmp_file_len = strlen(tmp_file);
-            if (file_path_size > tmp_file_len + 1) {
-                memcpy(temporary_file_path, tmp_file, tmp_file_len + 1);
-                result = TRUE;
-            }
-            cabx_i_mem_free(tmp_file);
+    int state;
+    CABX_GENERATION_STATUS* gen_status;
+    gen_status = (CABX_GENERATION_STATUS*)user_data;
+    state = file_i_get_temporary_path(temporary_file_path,
+        (size_t)file_path_size);
+    if (state == 0 && gen_status->temp_store) {
+        state = temp_store_register(gen_status->temp_store,
+            temporary_file_path);
+        if (state) {
+            file_i_remove(temporary_file_path);
         }
     }
-    if (tmp_file_w) {
-        cabx_i_mem_free(tmp_file_w);
-    }
+    result = state == 0 ? TRUE : FALSE;
     return result;
 }
 
@@ -3542,36 +7434,54 @@ cabx_fci_get_open_info(
     int* err,
     void* user_data)
 {
-    wchar_t* file_path_w;
     size_t file_path_len;
-    struct _stat stat_content;
+    file_i_stat_info stat_content;
     CABX_GENERATION_STATUS* gen_status;
     intptr_t result;
     cstr* source_path_cstr;
-    cstr* entry_name_cstr;
+    CABX_ENTRY* entry;
     char* entry_name;
     int state;
-    FILE* fs;
+    CABX_FILE* file;
     unsigned short attr_0;
 
     gen_status = (CABX_GENERATION_STATUS*)user_data;
-    entry_name_cstr = NULL;
+    entry = NULL;
     source_path_cstr = NULL;
     entry_name = NULL;
     result = -1;
     state = 0;
     attr_0 = 0;
-    fs = NULL;
+    file = NULL;
     file_path_len = strlen(file_path);
-    file_path_w = (wchar_t*)str_conv_utf8_to_utf16(
-        file_path, file_path_len + 1, 
-        cabx_i_mem_alloc, cabx_i_mem_free);
-
-    fs = (FILE*)cabx_fci_open(file_path, _O_RDONLY, 0, err, user_data);
+    if (gen_status->read_ahead) {
+        file = cabx_fci_take_read_ahead(gen_status->read_ahead, file_path);
+    }
+    if (!file) {
+        result = cabx_fci_open(file_path, O_RDONLY, 0, err, user_data);
+        file = result != -1 ? (CABX_FILE*)result : NULL;
+    }
+    result = -1;
    
-    state = fs ? 0 : -1; 
+    state = file ? 0 : -1; 
+    if (state == 0) {
+        source_path_cstr = cstr_create_00(file_path, file_path_len,
+            (void *(*)(unsigned int))cabx_i_mem_alloc,
+            cabx_i_mem_free);
+        state = source_path_cstr ? 0 : -1;
+    }
+    if (state == 0) {
+        col_map_get(
+            gen_status->cabx->source_path_entry_map,
+            source_path_cstr, (void**)&entry);
+    }
     if (state == 0) {
-        state = _fstat(_fileno(fs), &stat_content);
+        if (entry && entry->source_checked) {
+            /* the status is kept when source files are checked */
+            stat_content.mtime = entry->source_mtime;
+        } else {
+            state = file_i_fstat(fileno(file->stream), &stat_content);
+        }
     }
 
     if (state == 0) {
@@ -3579,10 +7489,10 @@ cabx_fci_get_open_info(
         unsigned short date_0;
         unsigned short time_0;
          
-        tm_info = gmtime(&stat_content.st_mtime);
+        tm_info = gmtime(&stat_content.mtime);
 
         date_0 = tm_info->tm_mday |
-                 (tm_info->tm_mon << 5) |
+                 ((tm_info->tm_mon + 1) << 5) |
                  (((tm_info->tm_year + 1900) - 1980) << 9);
         time_0 = tm_info->tm_sec >> 1 |
                  (tm_info->tm_min << 5) |
@@ -3591,24 +7501,12 @@ cabx_fci_get_open_info(
         *time = time_0;
     }
     if (state == 0) {
-        source_path_cstr = cstr_create_00(file_path, file_path_len,
-            (void *(*)(unsigned int))cabx_i_mem_alloc,
-            cabx_i_mem_free);
-        state = source_path_cstr ? 0 : -1;
-    }
-    if (state == 0) {
-        result = (intptr_t)fs;
-        fs = NULL;
+        result = (intptr_t)file;
+        file = NULL;
     }
-    if (state == 0) {
-        col_map_get(
-            gen_status->cabx->source_path_entry_map,
-            source_path_cstr, (void**)&entry_name_cstr);
+    if (state == 0 && entry) {
+        entry_name = entry->entry_name;
     }
-    if (entry_name_cstr) {
-        entry_name = cstr_to_flat_str(entry_name_cstr);
-        state = entry_name ? 0 : -1;
-    } 
     if (entry_name) {
         char* encoded_str;
         int encoded_attr;
@@ -3620,24 +7518,61 @@ cabx_fci_get_open_info(
     }
     *attr = attr_0;
 
-    if (entry_name) {
-        cstr_free_flat_str(entry_name_cstr, entry_name);
-    }
-    if (entry_name_cstr) {
-        cstr_release(entry_name_cstr);
+    if (entry) {
+        cabx_entry_release(entry);
     }
     if (source_path_cstr) {
         cstr_release(source_path_cstr);
     } 
-    if (file_path_w) {
-        cabx_i_mem_free(file_path_w);
+    if (file) {
+        cabx_fci_close((intptr_t)file, err, user_data);
+    }
+    return result;
+}
+
+/**
+ * take source file read ahead as file handle for fci
+ */
+static CABX_FILE*
+cabx_fci_take_read_ahead(
+    read_ahead* ahead,
+    const char* file_path)
+{
+    CABX_FILE* result;
+    FILE* fs;
+    int fd;
+    void* data;
+    size_t data_size;
+    int state;
+    result = NULL;
+    fs = NULL;
+    data = NULL;
+    state = read_ahead_take(ahead, file_path, &fd, &data, &data_size);
+    if (state == 0) {
+        fs = file_i_fdopen(fd, "rb");
+        if (fs == NULL) {
+            close(fd);
+        }
     }
     if (fs) {
-        cabx_fci_close((intptr_t)fs, err, user_data);
+        result = (CABX_FILE*)cabx_i_mem_alloc(sizeof(CABX_FILE));
+    }
+    if (result) {
+        result->stream = fs;
+        result->writer = NULL;
+        result->temp = NULL;
+        result->ahead_data = (unsigned char*)data;
+        result->ahead_size = data_size;
+    } else {
+        if (fs) {
+            fclose(fs);
+        }
+        read_ahead_free_data(data);
     }
     return result;
 }
 
+#ifdef _WIN32
 /**
  * get file path from stream handle.
  * You have to free memory by calling cabx_i_mem_free.
@@ -3681,5 +7616,6 @@ cabx_fci_get_file_path_from_stream_handle(
     }
     return result;
 }
+#endif
 
 /* vi: se ts=4 sw=4 et: */
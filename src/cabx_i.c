@@ -1,6 +1,7 @@
 #include "cabx_i.h"
 #include <stdlib.h>
 #include <stddef.h>
+#include <string.h>
 
 
 /**
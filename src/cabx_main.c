@@ -1,13 +1,15 @@
+#ifdef _WIN32
 #include <windows.h>
-#include <fci.h>
+#endif
 #include <unistd.h>
-#include <iconv.h>
 #include <locale.h>
+#include <wchar.h>
 #include <time.h>
 #include <stdlib.h>
 #include "cabx.h"
 #include "str_conv.h"
 
+#ifdef _WIN32
 
 /**
  * convert utf16 argument to utf8
@@ -37,9 +39,18 @@ mem_alloc(
 static void
 mem_free(
     void* heap_obj);
+#endif
 
+/**
+ * run cabinet generator with utf8 arguments
+ */
+static int
+run_cabx(
+    int argc,
+    char** argv);
 
 
+#ifdef _WIN32
 /**
  * entry point
  */
@@ -50,37 +61,67 @@ wmain(
 {
     int result;
     char** argv_utf8;
-    CABX* cab;
     result = 0;
-    cab = NULL;
     setlocale(LC_ALL, "");
-    srand((unsigned int)time(NULL));
     argv_utf8 = argv_to_utf8(argc, argv);
 
     result = argv_utf8 ? 0 : -1;
 
     if (result == 0) {
-        cab = cabx_create();
-        result = cab ? 0 : -1;
+        result = run_cabx(argc, argv_utf8);
+    }
+
+    if (argv_utf8) {
+        free_utf8_argv(argc, argv_utf8);
     }
+
+    return result;
+}
+#else
+/**
+ * entry point
+ */
+int
+main(
+    int argc,
+    char** argv)
+{
+    setlocale(LC_ALL, "");
+    return run_cabx(argc, argv);
+}
+#endif
+
+/**
+ * run cabinet generator with utf8 arguments
+ */
+static int
+run_cabx(
+    int argc,
+    char** argv)
+{
+    int result;
+    CABX* cab;
+    result = 0;
+    cab = NULL;
+    srand((unsigned int)time(NULL));
+
+    cab = cabx_create();
+    result = cab ? 0 : -1;
     if (result == 0) {
-        result = cabx_parse_option(cab, argc, argv_utf8);
+        result = cabx_parse_option(cab, argc, argv);
     }
     if (result == 0) {
-        cabx_run(cab);
+        result = cabx_run(cab);
     }
 
     if (cab) {
         cabx_release(cab);
     }
-
-    if (argv_utf8) {
-        free_utf8_argv(argc, argv_utf8);
-    }
-
     return result;
 }
 
+#ifdef _WIN32
+
 
 /**
  * convert utf16 argument to utf8
@@ -154,6 +195,7 @@ mem_free(
 {
     free(heap_obj);
 }
+#endif
 
 
 /* vi: se ts=4 sw=4 et: */
@@ -0,0 +1,479 @@
+#include "csv_stream.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+/**
+ * size of buffer to read stream
+ */
+#define CSV_STREAM_BUFFER_SIZE 0x10000
+
+/**
+ * tokenizer state
+ */
+enum {
+    /**
+     * at the beginning of cell
+     */
+    CSV_STREAM_CELL_START,
+    /**
+     * in cell not enclosed in double quotes
+     */
+    CSV_STREAM_UNQUOTED,
+    /**
+     * in cell enclosed in double quotes
+     */
+    CSV_STREAM_QUOTED,
+    /**
+     * read double quote in enclosed cell
+     */
+    CSV_STREAM_QUOTE,
+    /**
+     * read carriage return
+     */
+    CSV_STREAM_CR
+};
+
+/**
+ * csv tokenizer
+ */
+struct _csv_stream {
+    /**
+     * input stream. NULL if the tokenizer reads memory.
+     */
+    FILE* stream;
+
+    /**
+     * buffer for stream
+     */
+    char* buffer;
+
+    /**
+     * data to be read
+     */
+    const char* data;
+
+    /**
+     * size of data
+     */
+    size_t size;
+
+    /**
+     * read position in data
+     */
+    size_t position;
+
+    /**
+     * characters of cells in current row. each cell is null terminated.
+     */
+    char* row;
+
+    /**
+     * size of characters in row
+     */
+    size_t row_size;
+
+    /**
+     * capacity of row
+     */
+    size_t row_capacity;
+
+    /**
+     * offsets of cells in row
+     */
+    size_t* offsets;
+
+    /**
+     * cells in current row
+     */
+    const char** cells;
+
+    /**
+     * count of cells in current row
+     */
+    size_t cell_count;
+
+    /**
+     * capacity of offsets and cells
+     */
+    size_t cell_capacity;
+};
+
+/**
+ * read next data from stream.
+ * You get 1 if data is read, 0 at the end of input or -1 if error.
+ */
+static int
+csv_stream_fill(
+    csv_stream* obj);
+
+/**
+ * append characters into current cell
+ */
+static int
+csv_stream_append(
+    csv_stream* obj,
+    const char* data,
+    size_t size);
+
+/**
+ * complete current cell
+ */
+static int
+csv_stream_end_cell(
+    csv_stream* obj,
+    size_t cell_start);
+
+/**
+ * allocate memory
+ */
+static void*
+csv_stream_mem_alloc(
+    size_t size);
+
+/**
+ * free memory
+ */
+static void
+csv_stream_mem_free(
+    void* heap_obj);
+
+/**
+ * create csv tokenizer reading the stream. The stream is not closed.
+ */
+csv_stream*
+csv_stream_create(
+    FILE* stream)
+{
+    csv_stream* result;
+    result = NULL;
+    if (stream) {
+        result = csv_stream_create_1(NULL, 0);
+    } else {
+        errno = EINVAL;
+    }
+    if (result) {
+        result->buffer = (char*)csv_stream_mem_alloc(CSV_STREAM_BUFFER_SIZE);
+        if (result->buffer) {
+            result->stream = stream;
+        } else {
+            csv_stream_free(result);
+            result = NULL;
+        }
+    }
+    return result;
+}
+
+/**
+ * create csv tokenizer reading the memory.
+ */
+csv_stream*
+csv_stream_create_1(
+    const char* data,
+    size_t size)
+{
+    csv_stream* result;
+    result = NULL;
+    if (data || !size) {
+        result = (csv_stream*)csv_stream_mem_alloc(sizeof(csv_stream));
+    } else {
+        errno = EINVAL;
+    }
+    if (result) {
+        memset(result, 0, sizeof(*result));
+        result->data = data;
+        result->size = size;
+    }
+    return result;
+}
+
+/**
+ * read next row.
+ */
+int
+csv_stream_read_row(
+    csv_stream* obj,
+    const char* const** cells,
+    size_t* cell_count)
+{
+    int result;
+    int state;
+    int started;
+    size_t cell_start;
+    result = obj && cells && cell_count ? 1 : -1;
+    if (result < 0) {
+        errno = EINVAL;
+    }
+    state = CSV_STREAM_CELL_START;
+    started = 0;
+    cell_start = 0;
+    if (result > 0) {
+        obj->row_size = 0;
+        obj->cell_count = 0;
+    }
+    while (result > 0) {
+        int end_of_row;
+        char chr;
+        if (obj->position == obj->size) {
+            result = csv_stream_fill(obj);
+            if (result <= 0) {
+                break;
+            }
+        }
+        if (state == CSV_STREAM_UNQUOTED || state == CSV_STREAM_QUOTED) {
+            size_t start;
+            start = obj->position;
+            if (state == CSV_STREAM_UNQUOTED) {
+                while (obj->position < obj->size) {
+                    chr = obj->data[obj->position];
+                    if (chr == ',' || chr == '\n' || chr == '\r') {
+                        break;
+                    }
+                    obj->position++;
+                }
+            } else {
+                const char* quote;
+                quote = (const char*)memchr(obj->data + start, '"',
+                    obj->size - start);
+                obj->position = quote ? (size_t)(quote - obj->data)
+                    : obj->size;
+            }
+            if (obj->position != start) {
+                if (csv_stream_append(obj,
+                    obj->data + start, obj->position - start)) {
+                    result = -1;
+                    break;
+                }
+            }
+            if (obj->position == obj->size) {
+                continue;
+            }
+        }
+        started = 1;
+        end_of_row = 0;
+        chr = obj->data[obj->position++];
+        switch (state) {
+        case CSV_STREAM_CR:
+            if (chr == '\n') {
+                end_of_row = 1;
+                break;
+            }
+            if (csv_stream_append(obj, "\r", 1)) {
+                result = -1;
+                break;
+            }
+            state = CSV_STREAM_UNQUOTED;
+            obj->position--;
+            break;
+        case CSV_STREAM_QUOTED:
+            state = CSV_STREAM_QUOTE;
+            break;
+        case CSV_STREAM_QUOTE:
+            if (chr == '"') {
+                if (csv_stream_append(obj, &chr, 1)) {
+                    result = -1;
+                }
+                state = CSV_STREAM_QUOTED;
+                break;
+            }
+            /* fall through */
+        case CSV_STREAM_CELL_START:
+        case CSV_STREAM_UNQUOTED:
+            if (chr == ',') {
+                if (csv_stream_end_cell(obj, cell_start)) {
+                    result = -1;
+                }
+                cell_start = obj->row_size;
+                state = CSV_STREAM_CELL_START;
+            } else if (chr == '\n') {
+                end_of_row = 1;
+            } else if (chr == '\r') {
+                state = CSV_STREAM_CR;
+            } else if (chr == '"' && state == CSV_STREAM_CELL_START) {
+                state = CSV_STREAM_QUOTED;
+            } else {
+                if (csv_stream_append(obj, &chr, 1)) {
+                    result = -1;
+                }
+                state = CSV_STREAM_UNQUOTED;
+            }
+            break;
+        }
+        if (end_of_row) {
+            break;
+        }
+    }
+    if (result == 0 && started) {
+        result = 1;
+    }
+    if (result > 0) {
+        if (csv_stream_end_cell(obj, cell_start)) {
+            result = -1;
+        }
+    }
+    if (result > 0) {
+        size_t idx;
+        for (idx = 0; idx < obj->cell_count; idx++) {
+            obj->cells[idx] = obj->row + obj->offsets[idx];
+        }
+        *cells = obj->cells;
+        *cell_count = obj->cell_count;
+    }
+    return result;
+}
+
+/**
+ * free csv tokenizer
+ */
+void
+csv_stream_free(
+    csv_stream* obj)
+{
+    if (obj) {
+        if (obj->buffer) {
+            csv_stream_mem_free(obj->buffer);
+        }
+        if (obj->row) {
+            csv_stream_mem_free(obj->row);
+        }
+        if (obj->offsets) {
+            csv_stream_mem_free(obj->offsets);
+        }
+        if (obj->cells) {
+            csv_stream_mem_free((void*)obj->cells);
+        }
+        csv_stream_mem_free(obj);
+    }
+}
+
+/**
+ * read next data from stream.
+ * You get 1 if data is read, 0 at the end of input or -1 if error.
+ */
+static int
+csv_stream_fill(
+    csv_stream* obj)
+{
+    int result;
+    result = 0;
+    if (obj->stream) {
+        /* read a line at most not to wait for the rows not written yet */
+        if (fgets(obj->buffer, CSV_STREAM_BUFFER_SIZE, obj->stream)) {
+            obj->data = obj->buffer;
+            obj->size = strlen(obj->buffer);
+            obj->position = 0;
+            result = 1;
+        } else if (ferror(obj->stream)) {
+            result = -1;
+        }
+    }
+    return result;
+}
+
+/**
+ * append characters into current cell
+ */
+static int
+csv_stream_append(
+    csv_stream* obj,
+    const char* data,
+    size_t size)
+{
+    int result;
+    result = 0;
+    if (obj->row_size + size > obj->row_capacity) {
+        size_t capacity;
+        char* row;
+        capacity = obj->row_capacity ? obj->row_capacity : 0x100;
+        while (capacity < obj->row_size + size) {
+            capacity *= 2;
+        }
+        row = (char*)csv_stream_mem_alloc(capacity);
+        result = row ? 0 : -1;
+        if (result == 0) {
+            if (obj->row_size) {
+                memcpy(row, obj->row, obj->row_size);
+            }
+            if (obj->row) {
+                csv_stream_mem_free(obj->row);
+            }
+            obj->row = row;
+            obj->row_capacity = capacity;
+        }
+    }
+    if (result == 0) {
+        memcpy(obj->row + obj->row_size, data, size);
+        obj->row_size += size;
+    }
+    return result;
+}
+
+/**
+ * complete current cell
+ */
+static int
+csv_stream_end_cell(
+    csv_stream* obj,
+    size_t cell_start)
+{
+    int result;
+    result = csv_stream_append(obj, "", 1);
+    if (result == 0 && obj->cell_count == obj->cell_capacity) {
+        size_t capacity;
+        size_t* offsets;
+        const char** cells;
+        capacity = obj->cell_capacity ? obj->cell_capacity * 2 : 8;
+        offsets = (size_t*)csv_stream_mem_alloc(sizeof(size_t) * capacity);
+        cells = (const char**)csv_stream_mem_alloc(
+            sizeof(const char*) * capacity);
+        result = offsets && cells ? 0 : -1;
+        if (result == 0) {
+            if (obj->cell_count) {
+                memcpy(offsets, obj->offsets,
+                    sizeof(size_t) * obj->cell_count);
+            }
+            if (obj->offsets) {
+                csv_stream_mem_free(obj->offsets);
+            }
+            if (obj->cells) {
+                csv_stream_mem_free((void*)obj->cells);
+            }
+            obj->offsets = offsets;
+            obj->cells = cells;
+            obj->cell_capacity = capacity;
+        } else {
+            if (offsets) {
+                csv_stream_mem_free(offsets);
+            }
+            if (cells) {
+                csv_stream_mem_free((void*)cells);
+            }
+        }
+    }
+    if (result == 0) {
+        obj->offsets[obj->cell_count++] = cell_start;
+    }
+    return result;
+}
+
+/**
+ * allocate memory
+ */
+static void*
+csv_stream_mem_alloc(
+    size_t size)
+{
+    return malloc(size);
+}
+
+/**
+ * free memory
+ */
+static void
+csv_stream_mem_free(
+    void* heap_obj)
+{
+    free(heap_obj);
+}
+
+/* vi: se ts=4 sw=4 et: */
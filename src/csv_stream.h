@@ -0,0 +1,63 @@
+#ifndef __CSV_STREAM_H__
+#define __CSV_STREAM_H__
+
+#include <stddef.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+#define _CSV_STREAM_ITFC_BEGIN extern "C" {
+#define _CSV_STREAM_ITFC_END }
+#else
+#define _CSV_STREAM_ITFC_BEGIN
+#define _CSV_STREAM_ITFC_END
+#endif
+
+_CSV_STREAM_ITFC_BEGIN
+
+/**
+ * csv tokenizer which reads rows one by one.
+ * Cells are separated by comma and rows are separated by "\n" or "\r\n".
+ * A cell can be enclosed in double quotes, and two double quotes in
+ * enclosed cell are read as a double quote. The memory is kept as small as
+ * the longest row.
+ */
+typedef struct _csv_stream csv_stream;
+
+/**
+ * create csv tokenizer reading the stream. The stream is not closed.
+ */
+csv_stream*
+csv_stream_create(
+    FILE* stream);
+
+/**
+ * create csv tokenizer reading the memory.
+ * The memory has to be kept until the tokenizer is freed.
+ */
+csv_stream*
+csv_stream_create_1(
+    const char* data,
+    size_t size);
+
+/**
+ * read next row.
+ * You get 1 if a row is read, 0 at the end of input or -1 if error.
+ * The cells are null terminated strings valid until the next call.
+ */
+int
+csv_stream_read_row(
+    csv_stream* obj,
+    const char* const** cells,
+    size_t* cell_count);
+
+/**
+ * free csv tokenizer
+ */
+void
+csv_stream_free(
+    csv_stream* obj);
+
+_CSV_STREAM_ITFC_END
+
+/* vi: se ts=4 sw=4 et: */
+#endif
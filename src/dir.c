@@ -1,5 +1,7 @@
-#include "path.h"
-
+#include "dir.h"
+#include <string.h>
+#include <errno.h>
+#include "path_i.h"
 #include "dir_i.h"
 
 /**
@@ -9,8 +11,43 @@ int
 dir_mkdir_p(
     const char* dir_path)
 {
-
-
+    int result;
+    if (dir_path) {
+        char* tmp_path;
+        size_t path_len;
+        path_len = strlen(dir_path);
+        tmp_path = (char*)dir_i_mem_alloc(path_len + 1);
+        result = tmp_path ? 0 : -1;
+        if (result == 0) {
+            const char* seps;
+            size_t seps_size;
+            size_t idx;
+            memcpy(tmp_path, dir_path, path_len + 1);
+            path_i_get_dir_separators(&seps, &seps_size);
+            for (idx = 1; idx <= path_len; idx++) {
+                if (idx == path_len
+                    || memchr(seps, tmp_path[idx], seps_size)) {
+                    char sep_char;
+                    sep_char = tmp_path[idx];
+                    tmp_path[idx] = '\0';
+                    if (!dir_i_is_exists(tmp_path)) {
+                        result = dir_i_mkdir(tmp_path);
+                    }
+                    tmp_path[idx] = sep_char;
+                }
+                if (result) {
+                    break;
+                }
+            }
+        }
+        if (tmp_path) {
+            dir_i_mem_free(tmp_path);
+        }
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result;
 }
 
 /**
@@ -33,4 +70,14 @@ dir_rmdir(
     return dir_i_rmdir(dir_path);
 }
 
+/**
+ * you get non zero if the directory exists
+ */
+int
+dir_is_exists(
+    const char* dir_path)
+{
+    return dir_i_is_exists(dir_path);
+}
+
 /* vi: se ts=4 sw=4 et: */
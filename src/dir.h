@@ -34,6 +34,13 @@ int
 dir_rmdir(
     const char* dir_path);
 
+/**
+ * you get non zero if the directory exists
+ */
+int
+dir_is_exists(
+    const char* dir_path);
+
 
 _DIR_ITFC_END
 /* vi: se ts=4 sw=4 et: */
@@ -1,6 +1,7 @@
 #ifndef __DIR_I_H__
 #define __DIR_I_H__
 
+#include <stddef.h>
 
 #ifdef __cplusplus
 #define _DIR_I_ITFC_BEGIN extern "C" {
@@ -12,6 +13,31 @@
 
 _DIR_I_ITFC_BEGIN 
 
+/**
+ * entry in directory
+ */
+typedef struct _dir_i_entry dir_i_entry;
+
+/**
+ * entry in directory
+ */
+struct _dir_i_entry {
+    /**
+     * entry name without directory path
+     */
+    char* name;
+
+    /**
+     * not zero if the entry is directory. a link to directory is not
+     * treated as directory.
+     */
+    int is_dir;
+
+    /**
+     * not zero if the entry is regular file or a link to regular file
+     */
+    int is_regular;
+};
 
 /**
  * remove dir
@@ -34,6 +60,25 @@ int
 dir_i_is_exists(
     const char* dir_path);
 
+/**
+ * list entries in the directory except for "." and "..".
+ * The entries are in the order of the file system. You have to free them
+ * with dir_i_free_entries.
+ */
+int
+dir_i_list(
+    const char* dir_path,
+    dir_i_entry** entries,
+    size_t* entry_count);
+
+/**
+ * free entries listed by dir_i_list
+ */
+void
+dir_i_free_entries(
+    dir_i_entry* entries,
+    size_t entry_count);
+
 /**
  * allocate memory
  */
@@ -0,0 +1,235 @@
+#include "dir_i.h"
+
+#include <stdlib.h> 
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+/**
+ * fill entry kind from the status of the entry
+ */
+static int
+dir_i_fill_entry_kind(
+    DIR* dir,
+    const struct dirent* dir_ent,
+    dir_i_entry* entry);
+
+/**
+ * remove dir
+ */
+int
+dir_i_rmdir(
+    const char* dir_path)
+{
+    int result;
+    if (dir_path) {
+        result = rmdir(dir_path);
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+
+/**
+ * create directory with
+ */
+int
+dir_i_mkdir(
+    const char* dir_path)
+{
+    int result;
+    if (dir_path) {
+        result = mkdir(dir_path, 0777);
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * query the directory existence
+ */
+int
+dir_i_is_exists(
+    const char* dir_path)
+{
+    int result;
+    result = 0;
+    if (dir_path) {
+        struct stat st;
+        memset(&st, 0, sizeof(st));
+        if (stat(dir_path, &st) == 0) {
+            result = S_ISDIR(st.st_mode) ? 1 : 0;
+        } 
+    } else {
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * list entries in the directory except for "." and ".."
+ */
+int
+dir_i_list(
+    const char* dir_path,
+    dir_i_entry** entries,
+    size_t* entry_count)
+{
+    int result;
+    DIR* dir;
+    dir_i_entry* list;
+    size_t list_count;
+    size_t list_size;
+    dir = NULL;
+    list = NULL;
+    list_count = 0;
+    list_size = 0;
+    if (dir_path && entries && entry_count) {
+        dir = opendir(dir_path);
+        result = dir ? 0 : -1;
+    } else {
+        errno = EINVAL;
+        result = -1;
+    }
+    while (result == 0) {
+        struct dirent* dir_ent;
+        errno = 0;
+        dir_ent = readdir(dir);
+        if (!dir_ent) {
+            result = errno ? -1 : 0;
+            break;
+        }
+        if (strcmp(dir_ent->d_name, ".") == 0
+            || strcmp(dir_ent->d_name, "..") == 0) {
+            continue;
+        }
+        if (list_count == list_size) {
+            dir_i_entry* new_list;
+            size_t new_size;
+            new_size = list_size ? list_size * 2 : 16;
+            new_list = (dir_i_entry*)realloc(list,
+                sizeof(dir_i_entry) * new_size);
+            result = new_list ? 0 : -1;
+            if (result == 0) {
+                list = new_list;
+                list_size = new_size;
+            }
+        }
+        if (result == 0) {
+            dir_i_entry* entry;
+            entry = &list[list_count];
+            entry->name = strdup(dir_ent->d_name);
+            result = entry->name ? 0 : -1;
+            if (result == 0) {
+                list_count++;
+                result = dir_i_fill_entry_kind(dir, dir_ent, entry);
+            }
+        }
+    }
+    if (result == 0) {
+        *entries = list;
+        *entry_count = list_count;
+    } else {
+        dir_i_free_entries(list, list_count);
+    }
+    if (dir) {
+        closedir(dir);
+    }
+    return result;
+}
+
+/**
+ * fill entry kind from the status of the entry
+ */
+static int
+dir_i_fill_entry_kind(
+    DIR* dir,
+    const struct dirent* dir_ent,
+    dir_i_entry* entry)
+{
+    int result;
+    int kind_known;
+    result = 0;
+    entry->is_dir = 0;
+    entry->is_regular = 0;
+    kind_known = 0;
+#ifdef DT_DIR
+    if (dir_ent->d_type == DT_DIR) {
+        entry->is_dir = 1;
+        kind_known = 1;
+    } else if (dir_ent->d_type == DT_REG) {
+        entry->is_regular = 1;
+        kind_known = 1;
+    } else if (dir_ent->d_type != DT_UNKNOWN
+        && dir_ent->d_type != DT_LNK) {
+        kind_known = 1;
+    }
+#endif
+    if (!kind_known) {
+        struct stat st;
+        memset(&st, 0, sizeof(st));
+        result = fstatat(dirfd(dir), dir_ent->d_name, &st,
+            AT_SYMLINK_NOFOLLOW);
+        if (result == 0) {
+            if (S_ISDIR(st.st_mode)) {
+                entry->is_dir = 1;
+            } else if (S_ISREG(st.st_mode)) {
+                entry->is_regular = 1;
+            } else if (S_ISLNK(st.st_mode)) {
+                /* a broken link is neither directory nor regular file */
+                if (fstatat(dirfd(dir), dir_ent->d_name, &st, 0) == 0) {
+                    entry->is_regular = S_ISREG(st.st_mode) ? 1 : 0;
+                }
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ * free entries listed by dir_i_list
+ */
+void
+dir_i_free_entries(
+    dir_i_entry* entries,
+    size_t entry_count)
+{
+    size_t idx;
+    if (entries) {
+        for (idx = 0; idx < entry_count; idx++) {
+            free(entries[idx].name);
+        }
+        free(entries);
+    }
+}
+
+/**
+ * allocate memory
+ */
+void*
+dir_i_mem_alloc(
+    size_t size)
+{
+    return malloc(size);
+}
+
+
+/**
+ * free memory
+ */
+void
+dir_i_mem_free(
+    void* heap_obj)
+{
+    free(heap_obj);
+}
+
+
+/* vi: se ts=4 sw=4 et: */
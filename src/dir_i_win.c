@@ -1,7 +1,12 @@
 #include "dir_i.h"
 
 #include <stdlib.h> 
+#include <string.h>
 #include <errno.h>
+#include <wchar.h>
+#include <direct.h>
+#include <sys/stat.h>
+#include <Windows.h>
 #include "str_conv.h"
 
 /**
@@ -18,7 +23,7 @@ dir_i_rmdir(
             dir_path, strlen(dir_path) + 1, dir_i_mem_alloc, dir_i_mem_free);
         result = dir_path_w ? 0 : -1;
         if (result == 0) {
-            resut = _wrmdir(dir_path_w);
+            result = _wrmdir(dir_path_w);
         }
 
         if (dir_path_w) {
@@ -46,7 +51,7 @@ dir_i_mkdir(
             dir_path, strlen(dir_path) + 1, dir_i_mem_alloc, dir_i_mem_free);
         result = dir_path_w ? 0 : -1;
         if (result == 0) {
-            resut = _wmkdir(dir_path_w);
+            result = _wmkdir(dir_path_w);
         }
 
         if (dir_path_w) {
@@ -67,6 +72,7 @@ dir_i_is_exists(
     const char* dir_path)
 {
     int result;
+    result = 0;
     if (dir_path) {
         wchar_t* dir_path_w;
         int state;
@@ -79,7 +85,7 @@ dir_i_is_exists(
             memset(&st, 0, sizeof(st));
             state = _wstat(dir_path_w, &st);
             if (state == 0) {
-                result = _S_IFDIR & st.st_mode == _S_IFDIR;
+                result = (_S_IFDIR & st.st_mode) == _S_IFDIR;
             } 
         }
 
@@ -93,6 +99,137 @@ dir_i_is_exists(
     return result;
 }
 
+/**
+ * list entries in the directory except for "." and ".."
+ */
+int
+dir_i_list(
+    const char* dir_path,
+    dir_i_entry** entries,
+    size_t* entry_count)
+{
+    int result;
+    wchar_t* pattern_w;
+    HANDLE find_hdl;
+    dir_i_entry* list;
+    size_t list_count;
+    size_t list_size;
+    pattern_w = NULL;
+    find_hdl = INVALID_HANDLE_VALUE;
+    list = NULL;
+    list_count = 0;
+    list_size = 0;
+    if (dir_path && entries && entry_count) {
+        wchar_t* dir_path_w;
+        dir_path_w = (wchar_t*)str_conv_utf8_to_utf16(
+            dir_path, strlen(dir_path) + 1,
+            dir_i_mem_alloc, dir_i_mem_free);
+        result = dir_path_w ? 0 : -1;
+        if (result == 0) {
+            size_t len;
+            len = wcslen(dir_path_w);
+            pattern_w = (wchar_t*)dir_i_mem_alloc(
+                sizeof(wchar_t) * (len + 3));
+            result = pattern_w ? 0 : -1;
+            if (result == 0) {
+                wcscpy(pattern_w, dir_path_w);
+                wcscat(pattern_w, L"\\*");
+            }
+        }
+        if (dir_path_w) {
+            dir_i_mem_free(dir_path_w);
+        }
+    } else {
+        errno = EINVAL;
+        result = -1;
+    }
+    if (result == 0) {
+        WIN32_FIND_DATAW find_data;
+        find_hdl = FindFirstFileW(pattern_w, &find_data);
+        if (find_hdl == INVALID_HANDLE_VALUE) {
+            if (GetLastError() != ERROR_FILE_NOT_FOUND) {
+                errno = ENOENT;
+                result = -1;
+            }
+        }
+        while (result == 0 && find_hdl != INVALID_HANDLE_VALUE) {
+            if (wcscmp(find_data.cFileName, L".")
+                && wcscmp(find_data.cFileName, L"..")) {
+                if (list_count == list_size) {
+                    dir_i_entry* new_list;
+                    size_t new_size;
+                    new_size = list_size ? list_size * 2 : 16;
+                    new_list = (dir_i_entry*)realloc(list,
+                        sizeof(dir_i_entry) * new_size);
+                    result = new_list ? 0 : -1;
+                    if (result == 0) {
+                        list = new_list;
+                        list_size = new_size;
+                    }
+                }
+                if (result == 0) {
+                    dir_i_entry* entry;
+                    DWORD attr;
+                    entry = &list[list_count];
+                    entry->name = str_conv_utf16_to_utf8(
+                        find_data.cFileName,
+                        wcslen(find_data.cFileName) + 1,
+                        dir_i_mem_alloc, dir_i_mem_free);
+                    result = entry->name ? 0 : -1;
+                    if (result == 0) {
+                        list_count++;
+                        attr = find_data.dwFileAttributes;
+                        /* do not follow a junction or a link to directory */
+                        entry->is_dir =
+                            (attr & FILE_ATTRIBUTE_DIRECTORY)
+                            && !(attr & FILE_ATTRIBUTE_REPARSE_POINT);
+                        entry->is_regular =
+                            !(attr & FILE_ATTRIBUTE_DIRECTORY)
+                            && !(attr & FILE_ATTRIBUTE_DEVICE);
+                    }
+                }
+            }
+            if (result == 0 && !FindNextFileW(find_hdl, &find_data)) {
+                if (GetLastError() != ERROR_NO_MORE_FILES) {
+                    errno = EIO;
+                    result = -1;
+                }
+                break;
+            }
+        }
+    }
+    if (result == 0) {
+        *entries = list;
+        *entry_count = list_count;
+    } else {
+        dir_i_free_entries(list, list_count);
+    }
+    if (find_hdl != INVALID_HANDLE_VALUE) {
+        FindClose(find_hdl);
+    }
+    if (pattern_w) {
+        dir_i_mem_free(pattern_w);
+    }
+    return result;
+}
+
+/**
+ * free entries listed by dir_i_list
+ */
+void
+dir_i_free_entries(
+    dir_i_entry* entries,
+    size_t entry_count)
+{
+    size_t idx;
+    if (entries) {
+        for (idx = 0; idx < entry_count; idx++) {
+            dir_i_mem_free(entries[idx].name);
+        }
+        free(entries);
+    }
+}
+
 /**
  * allocate memory
  */
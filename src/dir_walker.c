@@ -0,0 +1,751 @@
+#include "dir_walker.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "dir_i.h"
+#include "path.h"
+#include "thread_i.h"
+#include "worker_pool.h"
+
+/**
+ * the directory is waiting to be listed
+ */
+#define DIR_WALKER_DIR_PENDING 0
+
+/**
+ * the directory is being listed
+ */
+#define DIR_WALKER_DIR_LISTING 1
+
+/**
+ * the directory is listed
+ */
+#define DIR_WALKER_DIR_LISTED 2
+
+/**
+ * directory in the tree
+ */
+typedef struct _dir_walker_dir dir_walker_dir;
+
+/**
+ * directory in the tree
+ */
+struct _dir_walker_dir {
+    /**
+     * path joined to the root directory
+     */
+    char* path;
+
+    /**
+     * path from the root directory. empty for the root directory.
+     */
+    char* relative_path;
+
+    /**
+     * parent directory. NULL for the root directory.
+     */
+    dir_walker_dir* parent;
+
+    /**
+     * one of DIR_WALKER_DIR_XXX
+     */
+    int state;
+
+    /**
+     * error number if the directory could not be listed
+     */
+    int error;
+
+    /**
+     * entries sorted by name
+     */
+    dir_i_entry* entries;
+
+    /**
+     * count of entries
+     */
+    size_t entry_count;
+
+    /**
+     * sub directory for each entry. NULL for the entry which is not
+     * directory.
+     */
+    dir_walker_dir** sub_dirs;
+
+    /**
+     * index of the next entry to be taken
+     */
+    size_t entry_next;
+
+    /**
+     * next directory waiting to be listed
+     */
+    dir_walker_dir* queue_next;
+
+    /**
+     * next directory created by the walker
+     */
+    dir_walker_dir* all_next;
+};
+
+/**
+ * walker listing regular files in directory tree
+ */
+struct _dir_walker {
+    /**
+     * all directories created by the walker
+     */
+    dir_walker_dir* all_dirs;
+
+    /**
+     * first directory waiting to be listed
+     */
+    dir_walker_dir* queue_head;
+
+    /**
+     * last directory waiting to be listed
+     */
+    dir_walker_dir* queue_tail;
+
+    /**
+     * directory the files are taken from
+     */
+    dir_walker_dir* current;
+
+    /**
+     * path of the file taken last
+     */
+    char* file_path;
+
+    /**
+     * relative path of the file taken last
+     */
+    char* relative_path;
+
+    /**
+     * directory which could not be listed
+     */
+    const char* error_dir;
+
+    /**
+     * threads listing directories
+     */
+    worker_pool* pool;
+
+    /**
+     * lock for directory states and queue
+     */
+    thread_i_mutex* lock;
+
+    /**
+     * signaled when a directory is listed or queued
+     */
+    thread_i_cond* changed;
+
+    /**
+     * count of running tasks
+     */
+    unsigned int running_count;
+
+    /**
+     * not zero if listing is stopped
+     */
+    int stopped;
+};
+
+/**
+ * create directory. The directory takes the paths.
+ */
+static dir_walker_dir*
+dir_walker_dir_create(
+    dir_walker_dir* parent,
+    char* path,
+    char* relative_path);
+
+/**
+ * free directory
+ */
+static void
+dir_walker_dir_free(
+    dir_walker_dir* dir);
+
+/**
+ * free entries and sub directory table of the directory
+ */
+static void
+dir_walker_dir_free_entries(
+    dir_walker_dir* dir);
+
+/**
+ * list the directory and create its sub directories
+ */
+static void
+dir_walker_list(
+    dir_walker_dir* dir);
+
+/**
+ * mark the directory listed and queue its sub directories.
+ * You have to lock the walker.
+ */
+static void
+dir_walker_add_listed(
+    dir_walker* obj,
+    dir_walker_dir* dir);
+
+/**
+ * take the next directory waiting to be listed.
+ * You have to lock the walker.
+ */
+static dir_walker_dir*
+dir_walker_take_pending(
+    dir_walker* obj);
+
+/**
+ * wait the directory to be listed, or list it in calling thread if no
+ * thread has started listing it yet
+ */
+static void
+dir_walker_wait_listed(
+    dir_walker* obj,
+    dir_walker_dir* dir);
+
+/**
+ * list directories until listing is stopped
+ */
+static void
+dir_walker_run(
+    void* arg);
+
+/**
+ * set the file taken last
+ */
+static int
+dir_walker_set_file(
+    dir_walker* obj,
+    dir_walker_dir* dir,
+    const char* name);
+
+/**
+ * join the name to relative path of the directory
+ */
+static char*
+dir_walker_join_relative(
+    dir_walker_dir* dir,
+    const char* name);
+
+/**
+ * compare entries by name
+ */
+static int
+dir_walker_compare_entry(
+    const void* entry_1,
+    const void* entry_2);
+
+/**
+ * duplicate string
+ */
+static char*
+dir_walker_str_dup(
+    const char* str);
+
+/**
+ * allocate memory
+ */
+static void*
+dir_walker_mem_alloc(
+    size_t size);
+
+/**
+ * free memory
+ */
+static void
+dir_walker_mem_free(
+    void* heap_obj);
+
+/**
+ * create walker for the directory tree.
+ */
+dir_walker*
+dir_walker_create(
+    const char* root_dir,
+    unsigned int thread_count)
+{
+    dir_walker* result;
+    int state;
+    result = NULL;
+    if (root_dir) {
+        result = (dir_walker*)dir_walker_mem_alloc(sizeof(dir_walker));
+    } else {
+        errno = EINVAL;
+    }
+    state = result ? 0 : -1;
+    if (state == 0) {
+        char* path;
+        char* relative_path;
+        memset(result, 0, sizeof(*result));
+        result->lock = thread_i_mutex_create();
+        result->changed = thread_i_cond_create();
+        path = dir_walker_str_dup(root_dir);
+        relative_path = dir_walker_str_dup("");
+        if (path && relative_path) {
+            result->current = dir_walker_dir_create(NULL,
+                path, relative_path);
+        } else {
+            dir_walker_mem_free(path);
+            dir_walker_mem_free(relative_path);
+        }
+        result->all_dirs = result->current;
+        result->queue_head = result->current;
+        result->queue_tail = result->current;
+        state = result->lock && result->changed && result->current ?
+            0 : -1;
+    }
+    if (state == 0 && thread_count) {
+        unsigned int idx;
+        result->pool = worker_pool_create(thread_count);
+        state = result->pool ? 0 : -1;
+        for (idx = 0; state == 0 && idx < thread_count; idx++) {
+            thread_i_mutex_lock(result->lock);
+            result->running_count++;
+            thread_i_mutex_unlock(result->lock);
+            state = worker_pool_submit(result->pool, dir_walker_run, result);
+            if (state) {
+                thread_i_mutex_lock(result->lock);
+                result->running_count--;
+                thread_i_mutex_unlock(result->lock);
+            }
+        }
+    }
+    if (state && result) {
+        dir_walker_free(result);
+        result = NULL;
+    }
+    return result;
+}
+
+/**
+ * get the next regular file in the tree.
+ */
+int
+dir_walker_next(
+    dir_walker* obj,
+    const char** file_path,
+    const char** relative_path)
+{
+    int result;
+    int found;
+    found = 0;
+    if (obj && file_path && relative_path) {
+        result = 0;
+    } else {
+        errno = EINVAL;
+        result = -1;
+    }
+    while (result == 0 && !found && obj->current) {
+        dir_walker_dir* dir;
+        dir = obj->current;
+        dir_walker_wait_listed(obj, dir);
+        if (dir->error) {
+            obj->error_dir = dir->path;
+            errno = dir->error;
+            result = -1;
+        } else if (dir->entry_next < dir->entry_count) {
+            size_t idx;
+            idx = dir->entry_next++;
+            if (dir->sub_dirs[idx]) {
+                obj->current = dir->sub_dirs[idx];
+            } else if (dir->entries[idx].is_regular) {
+                result = dir_walker_set_file(obj, dir,
+                    dir->entries[idx].name);
+                found = result == 0;
+            }
+        } else {
+            /* no thread uses the directory listed and taken */
+            dir_walker_dir_free_entries(dir);
+            obj->current = dir->parent;
+        }
+    }
+    if (found) {
+        *file_path = obj->file_path;
+        *relative_path = obj->relative_path;
+        result = 1;
+    }
+    return result;
+}
+
+/**
+ * get the directory which could not be listed.
+ */
+const char*
+dir_walker_get_error_dir(
+    dir_walker* obj)
+{
+    const char* result;
+    result = NULL;
+    if (obj) {
+        result = obj->error_dir;
+    } else {
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * stop listing directories and free the walker
+ */
+void
+dir_walker_free(
+    dir_walker* obj)
+{
+    if (obj) {
+        if (obj->pool) {
+            thread_i_mutex_lock(obj->lock);
+            obj->stopped = 1;
+            thread_i_cond_broadcast(obj->changed);
+            while (obj->running_count) {
+                thread_i_cond_wait(obj->changed, obj->lock);
+            }
+            thread_i_mutex_unlock(obj->lock);
+            worker_pool_free(obj->pool);
+            obj->pool = NULL;
+        }
+        while (obj->all_dirs) {
+            dir_walker_dir* dir;
+            dir = obj->all_dirs;
+            obj->all_dirs = dir->all_next;
+            dir_walker_dir_free(dir);
+        }
+        dir_walker_mem_free(obj->file_path);
+        dir_walker_mem_free(obj->relative_path);
+        thread_i_cond_free(obj->changed);
+        thread_i_mutex_free(obj->lock);
+        dir_walker_mem_free(obj);
+    }
+}
+
+/**
+ * create directory. The directory takes the paths.
+ */
+static dir_walker_dir*
+dir_walker_dir_create(
+    dir_walker_dir* parent,
+    char* path,
+    char* relative_path)
+{
+    dir_walker_dir* result;
+    result = (dir_walker_dir*)dir_walker_mem_alloc(sizeof(dir_walker_dir));
+    if (result) {
+        memset(result, 0, sizeof(*result));
+        result->parent = parent;
+        result->path = path;
+        result->relative_path = relative_path;
+        result->state = DIR_WALKER_DIR_PENDING;
+    } else {
+        dir_walker_mem_free(path);
+        dir_walker_mem_free(relative_path);
+    }
+    return result;
+}
+
+/**
+ * free directory
+ */
+static void
+dir_walker_dir_free(
+    dir_walker_dir* dir)
+{
+    if (dir) {
+        dir_walker_dir_free_entries(dir);
+        dir_walker_mem_free(dir->path);
+        dir_walker_mem_free(dir->relative_path);
+        dir_walker_mem_free(dir);
+    }
+}
+
+/**
+ * free entries and sub directory table of the directory
+ */
+static void
+dir_walker_dir_free_entries(
+    dir_walker_dir* dir)
+{
+    if (dir->entries) {
+        dir_i_free_entries(dir->entries, dir->entry_count);
+        dir->entries = NULL;
+    }
+    if (dir->sub_dirs) {
+        dir_walker_mem_free(dir->sub_dirs);
+        dir->sub_dirs = NULL;
+    }
+    dir->entry_count = 0;
+    dir->entry_next = 0;
+}
+
+/**
+ * list the directory and create its sub directories
+ */
+static void
+dir_walker_list(
+    dir_walker_dir* dir)
+{
+    int state;
+    size_t idx;
+    state = dir_i_list(dir->path, &dir->entries, &dir->entry_count);
+    if (state == 0 && dir->entry_count) {
+        qsort(dir->entries, dir->entry_count, sizeof(dir_i_entry),
+            dir_walker_compare_entry);
+        dir->sub_dirs = (dir_walker_dir**)dir_walker_mem_alloc(
+            sizeof(dir_walker_dir*) * dir->entry_count);
+        state = dir->sub_dirs ? 0 : -1;
+        if (state == 0) {
+            memset(dir->sub_dirs, 0,
+                sizeof(dir_walker_dir*) * dir->entry_count);
+        }
+    }
+    for (idx = 0; state == 0 && idx < dir->entry_count; idx++) {
+        if (dir->entries[idx].is_dir) {
+            char* path;
+            char* relative_path;
+            path = NULL;
+            relative_path = NULL;
+            state = path_join(dir->path, dir->entries[idx].name, &path,
+                dir_walker_mem_alloc, dir_walker_mem_free);
+            if (state == 0) {
+                relative_path = dir_walker_join_relative(dir,
+                    dir->entries[idx].name);
+                state = relative_path ? 0 : -1;
+            }
+            if (state == 0) {
+                dir->sub_dirs[idx] = dir_walker_dir_create(dir,
+                    path, relative_path);
+                state = dir->sub_dirs[idx] ? 0 : -1;
+            } else {
+                dir_walker_mem_free(path);
+            }
+        }
+    }
+    if (state) {
+        dir->error = errno ? errno : EIO;
+        for (idx = 0; dir->sub_dirs && idx < dir->entry_count; idx++) {
+            dir_walker_dir_free(dir->sub_dirs[idx]);
+        }
+        if (dir->entries) {
+            dir_walker_dir_free_entries(dir);
+        } else {
+            /* dir_i_list does not set entries when it fails */
+            dir->entry_count = 0;
+        }
+    }
+}
+
+/**
+ * mark the directory listed and queue its sub directories.
+ */
+static void
+dir_walker_add_listed(
+    dir_walker* obj,
+    dir_walker_dir* dir)
+{
+    size_t idx;
+    for (idx = 0; idx < dir->entry_count; idx++) {
+        dir_walker_dir* sub_dir;
+        sub_dir = dir->sub_dirs[idx];
+        if (sub_dir) {
+            sub_dir->all_next = obj->all_dirs;
+            obj->all_dirs = sub_dir;
+            if (obj->queue_tail) {
+                obj->queue_tail->queue_next = sub_dir;
+            } else {
+                obj->queue_head = sub_dir;
+            }
+            obj->queue_tail = sub_dir;
+        }
+    }
+    dir->state = DIR_WALKER_DIR_LISTED;
+    thread_i_cond_broadcast(obj->changed);
+}
+
+/**
+ * take the next directory waiting to be listed.
+ */
+static dir_walker_dir*
+dir_walker_take_pending(
+    dir_walker* obj)
+{
+    dir_walker_dir* result;
+    result = NULL;
+    while (!result && obj->queue_head) {
+        dir_walker_dir* dir;
+        dir = obj->queue_head;
+        obj->queue_head = dir->queue_next;
+        if (!obj->queue_head) {
+            obj->queue_tail = NULL;
+        }
+        dir->queue_next = NULL;
+        /* the directory may be listed in calling thread already */
+        if (dir->state == DIR_WALKER_DIR_PENDING) {
+            result = dir;
+        }
+    }
+    return result;
+}
+
+/**
+ * wait the directory to be listed, or list it in calling thread
+ */
+static void
+dir_walker_wait_listed(
+    dir_walker* obj,
+    dir_walker_dir* dir)
+{
+    thread_i_mutex_lock(obj->lock);
+    while (dir->state != DIR_WALKER_DIR_LISTED) {
+        if (dir->state == DIR_WALKER_DIR_PENDING) {
+            dir->state = DIR_WALKER_DIR_LISTING;
+            thread_i_mutex_unlock(obj->lock);
+            dir_walker_list(dir);
+            thread_i_mutex_lock(obj->lock);
+            dir_walker_add_listed(obj, dir);
+        } else {
+            thread_i_cond_wait(obj->changed, obj->lock);
+        }
+    }
+    thread_i_mutex_unlock(obj->lock);
+}
+
+/**
+ * list directories until listing is stopped
+ */
+static void
+dir_walker_run(
+    void* arg)
+{
+    dir_walker* obj;
+    obj = (dir_walker*)arg;
+    thread_i_mutex_lock(obj->lock);
+    while (!obj->stopped) {
+        dir_walker_dir* dir;
+        dir = dir_walker_take_pending(obj);
+        if (dir) {
+            dir->state = DIR_WALKER_DIR_LISTING;
+            thread_i_mutex_unlock(obj->lock);
+            dir_walker_list(dir);
+            thread_i_mutex_lock(obj->lock);
+            dir_walker_add_listed(obj, dir);
+        } else {
+            thread_i_cond_wait(obj->changed, obj->lock);
+        }
+    }
+    obj->running_count--;
+    thread_i_cond_broadcast(obj->changed);
+    thread_i_mutex_unlock(obj->lock);
+}
+
+/**
+ * set the file taken last
+ */
+static int
+dir_walker_set_file(
+    dir_walker* obj,
+    dir_walker_dir* dir,
+    const char* name)
+{
+    int result;
+    char* file_path;
+    char* relative_path;
+    file_path = NULL;
+    relative_path = NULL;
+    result = path_join(dir->path, name, &file_path,
+        dir_walker_mem_alloc, dir_walker_mem_free);
+    if (result == 0) {
+        relative_path = dir_walker_join_relative(dir, name);
+        result = relative_path ? 0 : -1;
+    }
+    if (result == 0) {
+        dir_walker_mem_free(obj->file_path);
+        dir_walker_mem_free(obj->relative_path);
+        obj->file_path = file_path;
+        obj->relative_path = relative_path;
+    } else {
+        dir_walker_mem_free(file_path);
+    }
+    return result;
+}
+
+/**
+ * join the name to relative path of the directory
+ */
+static char*
+dir_walker_join_relative(
+    dir_walker_dir* dir,
+    const char* name)
+{
+    char* result;
+    size_t dir_len;
+    size_t name_len;
+    dir_len = strlen(dir->relative_path);
+    name_len = strlen(name);
+    result = (char*)dir_walker_mem_alloc(dir_len + name_len + 2);
+    if (result) {
+        char* ptr;
+        ptr = result;
+        if (dir_len) {
+            memcpy(ptr, dir->relative_path, dir_len);
+            ptr += dir_len;
+            *ptr++ = '/';
+        }
+        memcpy(ptr, name, name_len + 1);
+    }
+    return result;
+}
+
+/**
+ * compare entries by name
+ */
+static int
+dir_walker_compare_entry(
+    const void* entry_1,
+    const void* entry_2)
+{
+    return strcmp(((const dir_i_entry*)entry_1)->name,
+        ((const dir_i_entry*)entry_2)->name);
+}
+
+/**
+ * duplicate string
+ */
+static char*
+dir_walker_str_dup(
+    const char* str)
+{
+    char* result;
+    size_t size;
+    size = strlen(str) + 1;
+    result = (char*)dir_walker_mem_alloc(size);
+    if (result) {
+        memcpy(result, str, size);
+    }
+    return result;
+}
+
+/**
+ * allocate memory
+ */
+static void*
+dir_walker_mem_alloc(
+    size_t size)
+{
+    return malloc(size);
+}
+
+/**
+ * free memory
+ */
+static void
+dir_walker_mem_free(
+    void* heap_obj)
+{
+    free(heap_obj);
+}
+
+/* vi: se ts=4 sw=4 et: */
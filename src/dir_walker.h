@@ -0,0 +1,66 @@
+#ifndef __DIR_WALKER_H__
+#define __DIR_WALKER_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+#define _DIR_WALKER_ITFC_BEGIN extern "C" {
+#define _DIR_WALKER_ITFC_END }
+#else
+#define _DIR_WALKER_ITFC_BEGIN
+#define _DIR_WALKER_ITFC_END
+#endif
+
+_DIR_WALKER_ITFC_BEGIN
+
+/**
+ * walker listing regular files in directory tree
+ */
+typedef struct _dir_walker dir_walker;
+
+/**
+ * create walker for the directory tree.
+ * Sub directories are listed in thread_count background threads ahead of
+ * the directory the files are taken from. If thread_count is 0, each
+ * directory is listed when the files are taken from it.
+ */
+dir_walker*
+dir_walker_create(
+    const char* root_dir,
+    unsigned int thread_count);
+
+/**
+ * get the next regular file in the tree.
+ * Files are taken in depth first order, and entries in each directory are
+ * sorted by the byte order of their names, so you get the same order every
+ * time for the same tree regardless of thread timing. Links to directories
+ * are not followed. file_path gets the path joined to the root directory,
+ * and relative_path gets the path from the root directory separated by
+ * '/'. The paths are valid until the next call. You get 1 if you get a
+ * file, 0 if no file is left or -1 if a directory can not be listed.
+ */
+int
+dir_walker_next(
+    dir_walker* obj,
+    const char** file_path,
+    const char** relative_path);
+
+/**
+ * get the directory which could not be listed.
+ * You get NULL if all directories are listed.
+ */
+const char*
+dir_walker_get_error_dir(
+    dir_walker* obj);
+
+/**
+ * stop listing directories and free the walker
+ */
+void
+dir_walker_free(
+    dir_walker* obj);
+
+_DIR_WALKER_ITFC_END
+
+/* vi: se ts=4 sw=4 et: */
+#endif
@@ -0,0 +1,348 @@
+#include "dup_finder.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "file_i.h"
+#include "sha256.h"
+#include "worker_pool.h"
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+/**
+ * size of buffer to read file which can not be mapped
+ */
+#define DUP_FINDER_READ_SIZE 0x10000
+
+/**
+ * file to be compared
+ */
+typedef struct _dup_finder_file dup_finder_file;
+
+/**
+ * file to be compared
+ */
+struct _dup_finder_file {
+    /**
+     * index of file
+     */
+    size_t index;
+
+    /**
+     * file path
+     */
+    const char* path;
+
+    /**
+     * file size
+     */
+    unsigned long long size;
+
+    /**
+     * file which has the same path. NULL if the file is hashed by itself.
+     */
+    dup_finder_file* same_path;
+
+    /**
+     * not zero if digest is calculated
+     */
+    int hashed;
+
+    /**
+     * sha256 digest of contents
+     */
+    unsigned char digest[SHA256_DIGEST_SIZE];
+};
+
+/**
+ * hash a file in files to be hashed
+ */
+static void
+dup_finder_run(
+    void* context,
+    void* local,
+    size_t idx);
+
+/**
+ * calculate digest of file contents
+ */
+static int
+dup_finder_hash_file(
+    dup_finder_file* file);
+
+/**
+ * compare files by size and path
+ */
+static int
+dup_finder_compare_path(
+    const void* lhs,
+    const void* rhs);
+
+/**
+ * compare files by size and digest
+ */
+static int
+dup_finder_compare_digest(
+    const void* lhs,
+    const void* rhs);
+
+/**
+ * allocate memory
+ */
+static void*
+dup_finder_mem_alloc(
+    size_t size);
+
+/**
+ * free memory
+ */
+static void
+dup_finder_mem_free(
+    void* heap_obj);
+
+/**
+ * find files which have the same contents.
+ */
+int
+dup_finder_find(
+    const char* const* file_paths,
+    const unsigned long long* file_sizes,
+    size_t file_count,
+    unsigned int jobs,
+    size_t* groups)
+{
+    int result;
+    dup_finder_file* files;
+    dup_finder_file** sorted_files;
+    size_t sorted_count;
+    dup_finder_file** hash_files;
+    size_t hash_count;
+    size_t idx;
+    sorted_count = 0;
+    hash_count = 0;
+    files = (dup_finder_file*)dup_finder_mem_alloc(
+        sizeof(dup_finder_file) * (file_count + 1));
+    sorted_files = (dup_finder_file**)dup_finder_mem_alloc(
+        sizeof(dup_finder_file*) * (file_count + 1));
+    hash_files = (dup_finder_file**)dup_finder_mem_alloc(
+        sizeof(dup_finder_file*) * (file_count + 1));
+    result = files && sorted_files && hash_files ? 0 : -1;
+    if (result == 0) {
+        for (idx = 0; idx < file_count; idx++) {
+            groups[idx] = idx;
+            memset(&files[idx], 0, sizeof(files[idx]));
+            files[idx].index = idx;
+            files[idx].path = file_paths[idx];
+            files[idx].size = file_sizes[idx];
+            if (files[idx].size) {
+                sorted_files[sorted_count++] = &files[idx];
+            }
+        }
+        qsort(sorted_files, sorted_count, sizeof(sorted_files[0]),
+            dup_finder_compare_path);
+    }
+    if (result == 0) {
+        size_t start;
+        start = 0;
+        while (start < sorted_count) {
+            size_t end;
+            end = start + 1;
+            while (end < sorted_count
+                && sorted_files[end]->size == sorted_files[start]->size) {
+                end++;
+            }
+            for (idx = start; end - start > 1 && idx < end; idx++) {
+                if (idx > start && strcmp(sorted_files[idx - 1]->path,
+                    sorted_files[idx]->path) == 0) {
+                    sorted_files[idx]->same_path =
+                        sorted_files[idx - 1]->same_path ?
+                        sorted_files[idx - 1]->same_path
+                        : sorted_files[idx - 1];
+                } else {
+                    hash_files[hash_count++] = sorted_files[idx];
+                }
+            }
+            start = end;
+        }
+    }
+    if (result == 0) {
+        result = worker_pool_for_each(jobs, hash_count, dup_finder_run,
+            NULL, NULL, hash_files);
+    }
+    if (result == 0) {
+        size_t hashed_count;
+        hashed_count = 0;
+        for (idx = 0; idx < sorted_count; idx++) {
+            dup_finder_file* file;
+            file = sorted_files[idx];
+            if (file->same_path && file->same_path->hashed) {
+                memcpy(file->digest, file->same_path->digest,
+                    sizeof(file->digest));
+                file->hashed = 1;
+            }
+            if (file->hashed) {
+                sorted_files[hashed_count++] = file;
+            }
+        }
+        qsort(sorted_files, hashed_count, sizeof(sorted_files[0]),
+            dup_finder_compare_digest);
+        for (idx = 1; idx < hashed_count; idx++) {
+            if (sorted_files[idx - 1]->size == sorted_files[idx]->size
+                && memcmp(sorted_files[idx - 1]->digest,
+                    sorted_files[idx]->digest, SHA256_DIGEST_SIZE) == 0) {
+                groups[sorted_files[idx]->index] =
+                    groups[sorted_files[idx - 1]->index];
+            }
+        }
+    }
+    if (hash_files) {
+        dup_finder_mem_free(hash_files);
+    }
+    if (sorted_files) {
+        dup_finder_mem_free(sorted_files);
+    }
+    if (files) {
+        dup_finder_mem_free(files);
+    }
+    return result;
+}
+
+/**
+ * hash a file in files to be hashed
+ */
+static void
+dup_finder_run(
+    void* context,
+    void* local,
+    size_t idx)
+{
+    (void)local;
+    dup_finder_hash_file(((dup_finder_file**)context)[idx]);
+}
+
+/**
+ * calculate digest of file contents
+ */
+static int
+dup_finder_hash_file(
+    dup_finder_file* file)
+{
+    int result;
+    int fd;
+    sha256_context ctx;
+    const void* data;
+    fd = file_i_open(file->path, O_RDONLY | O_BINARY, 0);
+    result = fd != -1 ? 0 : -1;
+    data = NULL;
+    sha256_init(&ctx);
+    if (result == 0 && file->size <= (size_t)-1) {
+        data = file_i_map(fd, (size_t)file->size);
+    }
+    if (data) {
+        sha256_update(&ctx, data, (size_t)file->size);
+        file_i_unmap(data, (size_t)file->size);
+    } else if (result == 0) {
+        unsigned char* buffer;
+        unsigned long long remaining;
+        buffer = (unsigned char*)dup_finder_mem_alloc(DUP_FINDER_READ_SIZE);
+        result = buffer ? 0 : -1;
+        remaining = file->size;
+        while (result == 0 && remaining) {
+            ssize_t read_size;
+            read_size = read(fd, buffer, DUP_FINDER_READ_SIZE);
+            if (read_size > 0 && (unsigned long long)read_size <= remaining) {
+                sha256_update(&ctx, buffer, (size_t)read_size);
+                remaining -= (unsigned long long)read_size;
+            } else {
+                /* the file was changed while it was read */
+                result = -1;
+            }
+        }
+        if (buffer) {
+            dup_finder_mem_free(buffer);
+        }
+    }
+    if (result == 0) {
+        sha256_final(&ctx, file->digest);
+        file->hashed = 1;
+    }
+    if (fd != -1) {
+        close(fd);
+    }
+    return result;
+}
+
+/**
+ * compare files by size and path
+ */
+static int
+dup_finder_compare_path(
+    const void* lhs,
+    const void* rhs)
+{
+    const dup_finder_file* file_l;
+    const dup_finder_file* file_r;
+    int result;
+    file_l = *(const dup_finder_file* const*)lhs;
+    file_r = *(const dup_finder_file* const*)rhs;
+    if (file_l->size != file_r->size) {
+        result = file_l->size < file_r->size ? -1 : 1;
+    } else {
+        result = strcmp(file_l->path, file_r->path);
+    }
+    if (result == 0 && file_l->index != file_r->index) {
+        result = file_l->index < file_r->index ? -1 : 1;
+    }
+    return result;
+}
+
+/**
+ * compare files by size and digest. Files having the same contents are
+ * sorted by index.
+ */
+static int
+dup_finder_compare_digest(
+    const void* lhs,
+    const void* rhs)
+{
+    const dup_finder_file* file_l;
+    const dup_finder_file* file_r;
+    int result;
+    file_l = *(const dup_finder_file* const*)lhs;
+    file_r = *(const dup_finder_file* const*)rhs;
+    if (file_l->size != file_r->size) {
+        result = file_l->size < file_r->size ? -1 : 1;
+    } else {
+        result = memcmp(file_l->digest, file_r->digest,
+            sizeof(file_l->digest));
+    }
+    if (result == 0 && file_l->index != file_r->index) {
+        result = file_l->index < file_r->index ? -1 : 1;
+    }
+    return result;
+}
+
+/**
+ * allocate memory
+ */
+static void*
+dup_finder_mem_alloc(
+    size_t size)
+{
+    return malloc(size);
+}
+
+/**
+ * free memory
+ */
+static void
+dup_finder_mem_free(
+    void* heap_obj)
+{
+    free(heap_obj);
+}
+
+/* vi: se ts=4 sw=4 et: */
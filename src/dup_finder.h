@@ -0,0 +1,36 @@
+#ifndef __DUP_FINDER_H__
+#define __DUP_FINDER_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+#define _DUP_FINDER_ITFC_BEGIN extern "C" {
+#define _DUP_FINDER_ITFC_END }
+#else
+#define _DUP_FINDER_ITFC_BEGIN
+#define _DUP_FINDER_ITFC_END
+#endif
+
+_DUP_FINDER_ITFC_BEGIN
+
+/**
+ * find files which have the same contents.
+ * groups[idx] gets the index of the first file having the same contents
+ * with the file at idx, or idx itself if no file before it has the same
+ * contents. file_sizes[idx] is the size of the file at idx. Only the files
+ * sharing their size with another file are hashed and they are hashed in
+ * jobs threads. Files which can not be read and empty files are not
+ * grouped.
+ */
+int
+dup_finder_find(
+    const char* const* file_paths,
+    const unsigned long long* file_sizes,
+    size_t file_count,
+    unsigned int jobs,
+    size_t* groups);
+
+_DUP_FINDER_ITFC_END
+
+/* vi: se ts=4 sw=4 et: */
+#endif
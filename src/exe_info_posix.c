@@ -0,0 +1,115 @@
+#include "exe_info.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+
+/**
+ * allocate memory
+ */
+static void*
+exe_info_alloc(
+    size_t size);
+
+/**
+ * get module file path 
+ */
+static char*
+get_module_path();
+
+/**
+ * get executable name
+ */
+char*
+exe_info_get_exe_name()
+{
+    char* result;
+    char* mod_path;
+    result = NULL;
+    mod_path = get_module_path();
+
+    if (mod_path) {
+        const char* name_ptr;
+        size_t length;
+        name_ptr = strrchr(mod_path, '/');
+        if (name_ptr) {
+            name_ptr++;
+        } else {
+            name_ptr = mod_path;
+        }
+        length = strlen(name_ptr);
+        result = (char*)exe_info_alloc(length + 1);
+        if (result) {
+            memcpy(result, name_ptr, length + 1);
+        }
+    }
+    if (mod_path) {
+        exe_info_free(mod_path);
+    }
+    return result;
+}
+
+/**
+ * get executable directory
+ */
+char*
+exe_info_get_exe_dir()
+{
+    char* result;
+    result = get_module_path();
+    if (result) {
+        char* name_ptr;
+        name_ptr = strrchr(result, '/');
+        if (name_ptr) {
+            *name_ptr = '\0';
+        }
+    }
+    return result;
+}
+
+/**
+ * get module file path 
+ */
+static char*
+get_module_path()
+{
+    char* result;
+    char* path_buffer;
+    result = NULL;
+    path_buffer = (char*)exe_info_alloc(PATH_MAX + 1);
+    if (path_buffer) {
+        ssize_t length;
+        length = readlink("/proc/self/exe", path_buffer, PATH_MAX);
+        if (length > 0) {
+            path_buffer[length] = '\0';
+            result = path_buffer;
+            path_buffer = NULL;
+        }
+    }
+    if (path_buffer) {
+        exe_info_free(path_buffer);
+    }
+    return result;
+}
+
+/**
+ * free resource
+ */
+void
+exe_info_free(
+    void* obj)
+{
+    free(obj);
+}
+
+/**
+ * allocate memory
+ */
+static void*
+exe_info_alloc(
+    size_t size)
+{
+    return malloc(size);
+}
+
+/* vi: se ts=4 sw=4 et: */
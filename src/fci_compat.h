@@ -0,0 +1,324 @@
+#ifndef __FCI_COMPAT_H__
+#define __FCI_COMPAT_H__
+
+#ifdef _WIN32
+
+#include <windows.h>
+#include <fci.h>
+
+/**
+ * cabinet.dll fci interface is available
+ */
+#define FCI_COMPAT_HAVE_FCI 1
+
+#else
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * declarations compatible with fci.h for the hosts which do not have
+ * cabinet.dll. The native cabinet writer uses these to keep the same
+ * callback surface with fci.
+ */
+
+#define DIAMONDAPI
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+/**
+ * boolean
+ */
+typedef int BOOL;
+
+/**
+ * string
+ */
+typedef char* LPSTR;
+
+/**
+ * compression type
+ */
+typedef unsigned short TCOMP;
+
+/**
+ * fci handle
+ */
+typedef void* HFCI;
+
+/**
+ * maximum size of data block
+ */
+#define CB_MAX_CHUNK 32768U
+
+/**
+ * maximum size of disk
+ */
+#define CB_MAX_DISK 0x7fffffffL
+
+/**
+ * maximum size of file name
+ */
+#define CB_MAX_FILENAME 256
+
+/**
+ * maximum size of cabinet name
+ */
+#define CB_MAX_CABINET_NAME 256
+
+/**
+ * maximum size of cabinet path
+ */
+#define CB_MAX_CAB_PATH 256
+
+/**
+ * maximum size of disk name
+ */
+#define CB_MAX_DISK_NAME 256
+
+#define tcompMASK_TYPE 0x000F
+#define tcompTYPE_NONE 0x0000
+#define tcompTYPE_MSZIP 0x0001
+#define tcompTYPE_QUANTUM 0x0002
+#define tcompTYPE_LZX 0x0003
+#define tcompBAD 0x000F
+
+#define tcompMASK_LZX_WINDOW 0x1F00
+#define tcompLZX_WINDOW_LO 0x0F00
+#define tcompLZX_WINDOW_HI 0x1500
+#define tcompSHIFT_LZX_WINDOW 8
+
+#define tcompMASK_QUANTUM_LEVEL 0x00F0
+#define tcompQUANTUM_LEVEL_LO 0x0010
+#define tcompQUANTUM_LEVEL_HI 0x0070
+#define tcompSHIFT_QUANTUM_LEVEL 4
+
+#define tcompMASK_QUANTUM_MEM 0x1F00
+#define tcompQUANTUM_MEM_LO 0x0A00
+#define tcompQUANTUM_MEM_HI 0x1500
+#define tcompSHIFT_QUANTUM_MEM 8
+
+#define tcompMASK_RESERVED 0xE000
+
+#define CompressionTypeFromTCOMP(tc) ((tc) & tcompMASK_TYPE)
+#define CompressionLevelFromTCOMP(tc) \
+    (((tc) & tcompMASK_QUANTUM_LEVEL) >> tcompSHIFT_QUANTUM_LEVEL)
+#define CompressionMemoryFromTCOMP(tc) \
+    (((tc) & tcompMASK_QUANTUM_MEM) >> tcompSHIFT_QUANTUM_MEM)
+#define TCOMPfromTypeLevelMemory(t, l, m) \
+    (((m) << tcompSHIFT_QUANTUM_MEM) \
+    | ((l) << tcompSHIFT_QUANTUM_LEVEL) \
+    | (t))
+#define LZXCompressionWindowFromTCOMP(tc) \
+    (((tc) & tcompMASK_LZX_WINDOW) >> tcompSHIFT_LZX_WINDOW)
+#define TCOMPfromLZXWindow(w) \
+    (((w) << tcompSHIFT_LZX_WINDOW) | (tcompTYPE_LZX))
+
+#define _A_RDONLY 0x01
+#define _A_HIDDEN 0x02
+#define _A_SYSTEM 0x04
+#define _A_ARCH 0x20
+#define _A_EXEC 0x40
+#define _A_NAME_IS_UTF 0x80
+
+#define statusFile 0
+#define statusFolder 1
+#define statusCabinet 2
+
+/**
+ * fci error code
+ */
+typedef enum {
+    FCIERR_NONE,
+    FCIERR_OPEN_SRC,
+    FCIERR_READ_SRC,
+    FCIERR_ALLOC_FAIL,
+    FCIERR_TEMP_FILE,
+    FCIERR_BAD_COMPR_TYPE,
+    FCIERR_CAB_FILE,
+    FCIERR_USER_ABORT,
+    FCIERR_MCI_FAIL,
+    FCIERR_CAB_FORMAT_LIMIT
+} FCIERROR;
+
+/**
+ * error information
+ */
+typedef struct {
+    /**
+     * operation error code
+     */
+    int erfOper;
+    /**
+     * system error code
+     */
+    int erfType;
+    /**
+     * error flag
+     */
+    BOOL fError;
+} ERF;
+
+/**
+ * error information pointer
+ */
+typedef ERF* PERF;
+
+/**
+ * cabinet parameter
+ */
+typedef struct {
+    /**
+     * maximum cabinet size
+     */
+    unsigned long cb;
+
+    /**
+     * folder threshold size
+     */
+    unsigned long cbFolderThresh;
+
+    /**
+     * reserved size in cabinet header
+     */
+    unsigned int cbReserveCFHeader;
+
+    /**
+     * reserved size in folder entry
+     */
+    unsigned int cbReserveCFFolder;
+
+    /**
+     * reserved size in data block
+     */
+    unsigned int cbReserveCFData;
+
+    /**
+     * cabinet index
+     */
+    int iCab;
+
+    /**
+     * disk index
+     */
+    int iDisk;
+
+    /**
+     * fail if a block is incompressible
+     */
+    int fFailOnIncompressible;
+
+    /**
+     * cabinet set identifier
+     */
+    unsigned short setID;
+
+    /**
+     * disk name
+     */
+    char szDisk[CB_MAX_DISK_NAME];
+
+    /**
+     * cabinet name
+     */
+    char szCab[CB_MAX_CABINET_NAME];
+
+    /**
+     * cabinet path
+     */
+    char szCabPath[CB_MAX_CAB_PATH];
+} CCAB;
+
+/**
+ * cabinet parameter pointer
+ */
+typedef CCAB* PCCAB;
+
+typedef void* (*PFNFCIALLOC)(
+    unsigned long cb);
+
+typedef void (*PFNFCIFREE)(
+    void* memory);
+
+typedef intptr_t (*PFNFCIOPEN)(
+    LPSTR psz_file,
+    int oflag,
+    int pmode,
+    int* err,
+    void* pv);
+
+typedef unsigned int (*PFNFCIREAD)(
+    intptr_t hf,
+    void* memory,
+    unsigned int cb,
+    int* err,
+    void* pv);
+
+typedef unsigned int (*PFNFCIWRITE)(
+    intptr_t hf,
+    void* memory,
+    unsigned int cb,
+    int* err,
+    void* pv);
+
+typedef int (*PFNFCICLOSE)(
+    intptr_t hf,
+    int* err,
+    void* pv);
+
+typedef long (*PFNFCISEEK)(
+    intptr_t hf,
+    long dist,
+    int seektype,
+    int* err,
+    void* pv);
+
+typedef int (*PFNFCIDELETE)(
+    LPSTR psz_file,
+    int* err,
+    void* pv);
+
+typedef BOOL (*PFNFCIGETNEXTCABINET)(
+    PCCAB pccab,
+    unsigned long cb_prev_cab,
+    void* pv);
+
+typedef int (*PFNFCIFILEPLACED)(
+    PCCAB pccab,
+    char* psz_file,
+    long cb_file,
+    BOOL f_continuation,
+    void* pv);
+
+typedef intptr_t (*PFNFCIGETOPENINFO)(
+    char* psz_name,
+    unsigned short* pdate,
+    unsigned short* ptime,
+    unsigned short* pattribs,
+    int* err,
+    void* pv);
+
+typedef long (*PFNFCISTATUS)(
+    unsigned int type_status,
+    unsigned long cb1,
+    unsigned long cb2,
+    void* pv);
+
+typedef BOOL (*PFNFCIGETTEMPFILE)(
+    char* psz_temp_name,
+    int cb_temp_name,
+    void* pv);
+
+#endif
+
+#ifndef FCI_COMPAT_HAVE_FCI
+#define FCI_COMPAT_HAVE_FCI 0
+#endif
+
+/* vi: se ts=4 sw=4 et: */
+#endif
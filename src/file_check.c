@@ -0,0 +1,127 @@
+#include "file_check.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "worker_pool.h"
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+/**
+ * state shared by threads checking files
+ */
+typedef struct _file_check file_check;
+
+/**
+ * state shared by threads checking files
+ */
+struct _file_check {
+    /**
+     * files to be checked
+     */
+    const char* const* file_paths;
+
+    /**
+     * status of files
+     */
+    file_i_stat_info* infos;
+
+    /**
+     * error numbers of files
+     */
+    int* errors;
+};
+
+/**
+ * check a file in files to be checked
+ */
+static void
+file_check_run(
+    void* context,
+    void* local,
+    size_t idx);
+
+/**
+ * check a file
+ */
+static int
+file_check_file(
+    const char* file_path,
+    file_i_stat_info* info);
+
+/**
+ * check files can be read and get their status.
+ */
+int
+file_check_all(
+    const char* const* file_paths,
+    size_t file_count,
+    unsigned int thread_count,
+    file_i_stat_info* infos,
+    int* errors)
+{
+    int result;
+    file_check check;
+    memset(&check, 0, sizeof(check));
+    if ((file_paths && infos && errors) || !file_count) {
+        result = 0;
+    } else {
+        errno = EINVAL;
+        result = -1;
+    }
+    if (result == 0) {
+        check.file_paths = file_paths;
+        check.infos = infos;
+        check.errors = errors;
+    }
+    if (result == 0) {
+        result = worker_pool_for_each(thread_count, file_count,
+            file_check_run, NULL, NULL, &check);
+    }
+    return result;
+}
+
+/**
+ * check a file in files to be checked
+ */
+static void
+file_check_run(
+    void* context,
+    void* local,
+    size_t idx)
+{
+    file_check* obj;
+    (void)local;
+    obj = (file_check*)context;
+    obj->errors[idx] = file_check_file(obj->file_paths[idx],
+        &obj->infos[idx]);
+}
+
+/**
+ * check a file. You get 0 or the error number.
+ */
+static int
+file_check_file(
+    const char* file_path,
+    file_i_stat_info* info)
+{
+    int result;
+    int fd;
+    memset(info, 0, sizeof(*info));
+    fd = file_i_open(file_path, O_RDONLY | O_BINARY, 0);
+    result = fd != -1 ? 0 : (errno ? errno : EIO);
+    if (result == 0) {
+        if (file_i_fstat(fd, info)) {
+            result = errno ? errno : EIO;
+        } else if (info->is_dir) {
+            result = EISDIR;
+        }
+        close(fd);
+    }
+    return result;
+}
+
+/* vi: se ts=4 sw=4 et: */
@@ -0,0 +1,35 @@
+#ifndef __FILE_CHECK_H__
+#define __FILE_CHECK_H__
+
+#include <stddef.h>
+#include "file_i.h"
+
+#ifdef __cplusplus
+#define _FILE_CHECK_ITFC_BEGIN extern "C" {
+#define _FILE_CHECK_ITFC_END }
+#else
+#define _FILE_CHECK_ITFC_BEGIN
+#define _FILE_CHECK_ITFC_END
+#endif
+
+_FILE_CHECK_ITFC_BEGIN
+
+/**
+ * check files can be read and get their status.
+ * Each file is opened for reading and its status is taken from the opened
+ * file. errors[idx] gets 0 and infos[idx] gets the status if the file can
+ * be read, otherwise errors[idx] gets the error number. A directory fails
+ * with EISDIR. Files are checked in thread_count threads.
+ */
+int
+file_check_all(
+    const char* const* file_paths,
+    size_t file_count,
+    unsigned int thread_count,
+    file_i_stat_info* infos,
+    int* errors);
+
+_FILE_CHECK_ITFC_END
+
+/* vi: se ts=4 sw=4 et: */
+#endif
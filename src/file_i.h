@@ -0,0 +1,184 @@
+#ifndef __FILE_I_H__
+#define __FILE_I_H__
+
+#include <stddef.h>
+#include <stdio.h>
+#include <time.h>
+
+#ifdef __cplusplus
+#define _FILE_I_ITFC_BEGIN extern "C" {
+#define _FILE_I_ITFC_END }
+#else
+#define _FILE_I_ITFC_BEGIN 
+#define _FILE_I_ITFC_END 
+#endif
+
+_FILE_I_ITFC_BEGIN 
+
+/**
+ * file status
+ */
+typedef struct _file_i_stat_info file_i_stat_info;
+
+/**
+ * file status
+ */
+struct _file_i_stat_info {
+    /**
+     * file size
+     */
+    unsigned long long size;
+
+    /**
+     * modified time
+     */
+    time_t mtime;
+
+    /**
+     * not zero if the file is directory
+     */
+    int is_dir;
+
+    /**
+     * not zero if the file is regular file
+     */
+    int is_regular;
+};
+
+
+/**
+ * open file. file path is utf8 encoded string.
+ * You get file descriptor if it is succeeded.
+ */
+int
+file_i_open(
+    const char* file_path,
+    int open_flag,
+    int mode);
+
+/**
+ * associate stream with file descriptor
+ */
+FILE*
+file_i_fdopen(
+    int fd,
+    const char* mode);
+
+/**
+ * open stream. file path is utf8 encoded string.
+ */
+FILE*
+file_i_fopen(
+    const char* file_path,
+    const char* mode);
+
+/**
+ * remove file
+ */
+int
+file_i_remove(
+    const char* file_path);
+
+/**
+ * rename file. The file at new path is replaced if it exists.
+ */
+int
+file_i_rename(
+    const char* old_path,
+    const char* new_path);
+
+/**
+ * get file status
+ */
+int
+file_i_stat(
+    const char* file_path,
+    file_i_stat_info* info);
+
+/**
+ * get file status from file descriptor
+ */
+int
+file_i_fstat(
+    int fd,
+    file_i_stat_info* info);
+
+/**
+ * you get non zero if the stream is associated with terminal
+ */
+int
+file_i_isatty(
+    FILE* fs);
+
+/**
+ * write utf8 encoded string into stream
+ */
+int
+file_i_fputs(
+    const char* str,
+    FILE* fs);
+
+/**
+ * get temporary file path.
+ */
+int
+file_i_get_temporary_path(
+    char* file_path,
+    size_t file_path_size);
+
+/**
+ * map file from the beginning to the size as read only memory.
+ * You get NULL if the file can not be mapped like pipe.
+ * You have to unmap the memory by calling file_i_unmap.
+ */
+const void*
+file_i_map(
+    int fd,
+    size_t size);
+
+/**
+ * unmap the memory mapped by file_i_map
+ */
+int
+file_i_unmap(
+    const void* data,
+    size_t size);
+
+/**
+ * advise that the file will be read sequentially from the beginning to
+ * the size soon. The system may start reading the file in background.
+ * This does nothing if the system does not support the advice.
+ */
+int
+file_i_advise_will_need(
+    int fd,
+    size_t size);
+
+/**
+ * read data from the offset of file.
+ * You get the size read, 0 at the end of file or -1 if error. The file
+ * position is not used, but it may be changed on some systems.
+ */
+long long
+file_i_pread(
+    int fd,
+    void* buffer,
+    size_t size,
+    unsigned long long offset);
+
+/**
+ * write data at the offset of file.
+ * You get the size written or -1 if error. The file position is not used,
+ * but it may be changed on some systems.
+ */
+long long
+file_i_pwrite(
+    int fd,
+    const void* data,
+    size_t size,
+    unsigned long long offset);
+
+_FILE_I_ITFC_END 
+
+/* vi: se ts=4 sw=4 et: */
+#endif
@@ -0,0 +1,313 @@
+#include "file_i.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+/**
+ * copy stat into file status
+ */
+static void
+file_i_copy_stat(
+    const struct stat* st,
+    file_i_stat_info* info);
+
+/**
+ * open file. file path is utf8 encoded string.
+ * You get file descriptor if it is succeeded.
+ */
+int
+file_i_open(
+    const char* file_path,
+    int open_flag,
+    int mode)
+{
+    int result;
+    if (file_path) {
+        result = open(file_path, open_flag, mode);
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * associate stream with file descriptor
+ */
+FILE*
+file_i_fdopen(
+    int fd,
+    const char* mode)
+{
+    return fdopen(fd, mode);
+}
+
+/**
+ * open stream. file path is utf8 encoded string.
+ */
+FILE*
+file_i_fopen(
+    const char* file_path,
+    const char* mode)
+{
+    FILE* result;
+    if (file_path && mode) {
+        result = fopen(file_path, mode);
+    } else {
+        result = NULL;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * remove file
+ */
+int
+file_i_remove(
+    const char* file_path)
+{
+    int result;
+    if (file_path) {
+        result = remove(file_path);
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * rename file. The file at new path is replaced if it exists.
+ */
+int
+file_i_rename(
+    const char* old_path,
+    const char* new_path)
+{
+    int result;
+    if (old_path && new_path) {
+        result = rename(old_path, new_path);
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * get file status
+ */
+int
+file_i_stat(
+    const char* file_path,
+    file_i_stat_info* info)
+{
+    int result;
+    if (file_path && info) {
+        struct stat st;
+        memset(&st, 0, sizeof(st));
+        result = stat(file_path, &st);
+        if (result == 0) {
+            file_i_copy_stat(&st, info);
+        }
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * get file status from file descriptor
+ */
+int
+file_i_fstat(
+    int fd,
+    file_i_stat_info* info)
+{
+    int result;
+    if (info) {
+        struct stat st;
+        memset(&st, 0, sizeof(st));
+        result = fstat(fd, &st);
+        if (result == 0) {
+            file_i_copy_stat(&st, info);
+        }
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * you get non zero if the stream is associated with terminal
+ */
+int
+file_i_isatty(
+    FILE* fs)
+{
+    int result;
+    if (fs) {
+        result = isatty(fileno(fs));
+    } else {
+        result = 0;
+    }
+    return result;
+}
+
+/**
+ * write utf8 encoded string into stream
+ */
+int
+file_i_fputs(
+    const char* str,
+    FILE* fs)
+{
+    return fputs(str, fs);
+}
+
+/**
+ * get temporary file path.
+ */
+int
+file_i_get_temporary_path(
+    char* file_path,
+    size_t file_path_size)
+{
+    int result;
+    const char* tmp_dir;
+    const static char tmp_name[] = "cabxXXXXXX";
+    tmp_dir = getenv("TMPDIR");
+    if (!tmp_dir || !strlen(tmp_dir)) {
+        tmp_dir = "/tmp";
+    }
+    result = 0;
+    if (strlen(tmp_dir) + 1 + sizeof(tmp_name) <= file_path_size) {
+        int fd;
+        snprintf(file_path, file_path_size, "%s/%s", tmp_dir, tmp_name);
+        fd = mkstemp(file_path);
+        if (fd >= 0) {
+            close(fd);
+        } else {
+            result = -1;
+        }
+    } else {
+        result = -1;
+        errno = ENAMETOOLONG;
+    }
+    return result;
+}
+
+/**
+ * map file from the beginning to the size as read only memory.
+ */
+const void*
+file_i_map(
+    int fd,
+    size_t size)
+{
+    void* result;
+    if (size) {
+        result = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (result == MAP_FAILED) {
+            result = NULL;
+        }
+    } else {
+        result = NULL;
+        errno = EINVAL;
+    }
+    if (result) {
+        posix_madvise(result, size, POSIX_MADV_SEQUENTIAL);
+    }
+    return result;
+}
+
+/**
+ * unmap the memory mapped by file_i_map
+ */
+int
+file_i_unmap(
+    const void* data,
+    size_t size)
+{
+    int result;
+    if (data) {
+        result = munmap((void*)data, size);
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * advise that the file will be read sequentially from the beginning to
+ * the size soon.
+ */
+int
+file_i_advise_will_need(
+    int fd,
+    size_t size)
+{
+    int result;
+    result = 0;
+#if defined(POSIX_FADV_SEQUENTIAL) && defined(POSIX_FADV_WILLNEED)
+    result = posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    if (result == 0) {
+        result = posix_fadvise(fd, 0, (off_t)size, POSIX_FADV_WILLNEED);
+    }
+    if (result) {
+        errno = result;
+        result = -1;
+    }
+#endif
+    return result;
+}
+
+/**
+ * read data from the offset of file.
+ */
+long long
+file_i_pread(
+    int fd,
+    void* buffer,
+    size_t size,
+    unsigned long long offset)
+{
+    return (long long)pread(fd, buffer, size, (off_t)offset);
+}
+
+/**
+ * write data at the offset of file.
+ */
+long long
+file_i_pwrite(
+    int fd,
+    const void* data,
+    size_t size,
+    unsigned long long offset)
+{
+    return (long long)pwrite(fd, data, size, (off_t)offset);
+}
+
+/**
+ * copy stat into file status
+ */
+static void
+file_i_copy_stat(
+    const struct stat* st,
+    file_i_stat_info* info)
+{
+    info->size = (unsigned long long)st->st_size;
+    info->mtime = st->st_mtime;
+    info->is_dir = S_ISDIR(st->st_mode) ? 1 : 0;
+    info->is_regular = S_ISREG(st->st_mode) ? 1 : 0;
+}
+
+/* vi: se ts=4 sw=4 et: */
@@ -0,0 +1,468 @@
+#include "file_i.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <io.h>
+#include <wchar.h>
+#include <sys/stat.h>
+#include <Windows.h>
+#include "str_conv.h"
+
+/**
+ * allocate memory
+ */
+static void*
+file_i_mem_alloc(
+    size_t size);
+
+/**
+ * free memory
+ */
+static void
+file_i_mem_free(
+    void* heap_obj);
+
+/**
+ * convert utf8 string to utf16 string
+ */
+static wchar_t*
+file_i_to_utf16(
+    const char* str);
+
+/**
+ * copy stat into file status
+ */
+static void
+file_i_copy_stat(
+    const struct _stat* st,
+    file_i_stat_info* info);
+
+/**
+ * open file. file path is utf8 encoded string.
+ * You get file descriptor if it is succeeded.
+ */
+int
+file_i_open(
+    const char* file_path,
+    int open_flag,
+    int mode)
+{
+    int result;
+    wchar_t* file_path_w;
+    file_path_w = file_i_to_utf16(file_path);
+    result = file_path_w ? 0 : -1;
+    if (result == 0) {
+        result = _wopen(file_path_w, open_flag | _O_BINARY, mode);
+    }
+    if (file_path_w) {
+        file_i_mem_free(file_path_w);
+    }
+    return result;
+}
+
+/**
+ * associate stream with file descriptor
+ */
+FILE*
+file_i_fdopen(
+    int fd,
+    const char* mode)
+{
+    return _fdopen(fd, mode);
+}
+
+/**
+ * open stream. file path is utf8 encoded string.
+ */
+FILE*
+file_i_fopen(
+    const char* file_path,
+    const char* mode)
+{
+    FILE* result;
+    wchar_t* file_path_w;
+    wchar_t* mode_w;
+    result = NULL;
+    file_path_w = file_i_to_utf16(file_path);
+    mode_w = file_i_to_utf16(mode);
+    if (file_path_w && mode_w) {
+        result = _wfopen(file_path_w, mode_w);
+    }
+    if (mode_w) {
+        file_i_mem_free(mode_w);
+    }
+    if (file_path_w) {
+        file_i_mem_free(file_path_w);
+    }
+    return result;
+}
+
+/**
+ * remove file
+ */
+int
+file_i_remove(
+    const char* file_path)
+{
+    int result;
+    wchar_t* file_path_w;
+    file_path_w = file_i_to_utf16(file_path);
+    result = file_path_w ? 0 : -1;
+    if (result == 0) {
+        result = _wremove(file_path_w);
+    }
+    if (file_path_w) {
+        file_i_mem_free(file_path_w);
+    }
+    return result;
+}
+
+/**
+ * rename file. The file at new path is replaced if it exists.
+ */
+int
+file_i_rename(
+    const char* old_path,
+    const char* new_path)
+{
+    int result;
+    wchar_t* old_path_w;
+    wchar_t* new_path_w;
+    old_path_w = file_i_to_utf16(old_path);
+    new_path_w = file_i_to_utf16(new_path);
+    result = old_path_w && new_path_w ? 0 : -1;
+    if (result == 0) {
+        if (!MoveFileExW(old_path_w, new_path_w,
+            MOVEFILE_REPLACE_EXISTING)) {
+            errno = EACCES;
+            result = -1;
+        }
+    }
+    if (old_path_w) {
+        file_i_mem_free(old_path_w);
+    }
+    if (new_path_w) {
+        file_i_mem_free(new_path_w);
+    }
+    return result;
+}
+
+/**
+ * get file status
+ */
+int
+file_i_stat(
+    const char* file_path,
+    file_i_stat_info* info)
+{
+    int result;
+    wchar_t* file_path_w;
+    file_path_w = NULL;
+    if (info) {
+        file_path_w = file_i_to_utf16(file_path);
+        result = file_path_w ? 0 : -1;
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    if (result == 0) {
+        struct _stat st;
+        memset(&st, 0, sizeof(st));
+        result = _wstat(file_path_w, &st);
+        if (result == 0) {
+            file_i_copy_stat(&st, info);
+        }
+    }
+    if (file_path_w) {
+        file_i_mem_free(file_path_w);
+    }
+    return result;
+}
+
+/**
+ * get file status from file descriptor
+ */
+int
+file_i_fstat(
+    int fd,
+    file_i_stat_info* info)
+{
+    int result;
+    if (info) {
+        struct _stat st;
+        memset(&st, 0, sizeof(st));
+        result = _fstat(fd, &st);
+        if (result == 0) {
+            file_i_copy_stat(&st, info);
+        }
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * you get non zero if the stream is associated with terminal
+ */
+int
+file_i_isatty(
+    FILE* fs)
+{
+    int result;
+    if (fs) {
+        result = _isatty(_fileno(fs));
+    } else {
+        result = 0;
+    }
+    return result;
+}
+
+/**
+ * write utf8 encoded string into stream
+ */
+int
+file_i_fputs(
+    const char* str,
+    FILE* fs)
+{
+    int result;
+    wchar_t* str_w;
+    str_w = file_i_to_utf16(str);
+    result = str_w ? 0 : -1;
+    if (result == 0) {
+        result = fputws(str_w, fs);
+    }
+    if (str_w) {
+        file_i_mem_free(str_w);
+    }
+    return result;
+}
+
+/**
+ * get temporary file path.
+ */
+int
+file_i_get_temporary_path(
+    char* file_path,
+    size_t file_path_size)
+{
+    int result;
+    wchar_t tmp_file_w[L_tmpnam + 1];
+    char* tmp_file;
+    tmp_file = NULL;
+    result = _wtmpnam(tmp_file_w) ? 0 : -1;
+    if (result == 0) {
+        tmp_file = str_conv_utf16_to_utf8(
+            tmp_file_w, wcslen(tmp_file_w) + 1,
+            file_i_mem_alloc, file_i_mem_free);
+        result = tmp_file ? 0 : -1;
+    }
+    if (result == 0) {
+        size_t tmp_file_len;
+        tmp_file_len = strlen(tmp_file);
+        if (file_path_size > tmp_file_len + 1) {
+            memcpy(file_path, tmp_file, tmp_file_len + 1);
+        } else {
+            result = -1;
+            errno = ENAMETOOLONG;
+        }
+    }
+    if (tmp_file) {
+        file_i_mem_free(tmp_file);
+    }
+    return result;
+}
+
+/**
+ * map file from the beginning to the size as read only memory.
+ */
+const void*
+file_i_map(
+    int fd,
+    size_t size)
+{
+    const void* result;
+    HANDLE file_hdl;
+    HANDLE map_hdl;
+    result = NULL;
+    map_hdl = NULL;
+    file_hdl = (HANDLE)_get_osfhandle(fd);
+    if (size && file_hdl != INVALID_HANDLE_VALUE
+        && GetFileType(file_hdl) == FILE_TYPE_DISK) {
+        map_hdl = CreateFileMappingW(file_hdl, NULL, PAGE_READONLY,
+            0, 0, NULL);
+    } else {
+        errno = EINVAL;
+    }
+    if (map_hdl) {
+        result = MapViewOfFile(map_hdl, FILE_MAP_READ, 0, 0, size);
+        CloseHandle(map_hdl);
+    }
+    if (!result) {
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * unmap the memory mapped by file_i_map
+ */
+int
+file_i_unmap(
+    const void* data,
+    size_t size)
+{
+    int result;
+    if (data) {
+        result = UnmapViewOfFile(data) ? 0 : -1;
+        if (result) {
+            errno = EINVAL;
+        }
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * advise that the file will be read sequentially from the beginning to
+ * the size soon. The advice is not supported on windows.
+ */
+int
+file_i_advise_will_need(
+    int fd,
+    size_t size)
+{
+    return 0;
+}
+
+/**
+ * read data from the offset of file. The file pointer is moved after the
+ * data read.
+ */
+long long
+file_i_pread(
+    int fd,
+    void* buffer,
+    size_t size,
+    unsigned long long offset)
+{
+    long long result;
+    HANDLE file_hdl;
+    OVERLAPPED overlapped;
+    DWORD read_size;
+    result = -1;
+    file_hdl = (HANDLE)_get_osfhandle(fd);
+    if (file_hdl != INVALID_HANDLE_VALUE) {
+        memset(&overlapped, 0, sizeof(overlapped));
+        overlapped.Offset = (DWORD)offset;
+        overlapped.OffsetHigh = (DWORD)(offset >> 32);
+        if (size > MAXDWORD) {
+            size = MAXDWORD;
+        }
+        if (ReadFile(file_hdl, buffer, (DWORD)size, &read_size,
+            &overlapped)) {
+            result = (long long)read_size;
+        } else if (GetLastError() == ERROR_HANDLE_EOF) {
+            result = 0;
+        } else {
+            errno = EIO;
+        }
+    } else {
+        errno = EBADF;
+    }
+    return result;
+}
+
+/**
+ * write data at the offset of file. The file pointer is moved after the
+ * data written.
+ */
+long long
+file_i_pwrite(
+    int fd,
+    const void* data,
+    size_t size,
+    unsigned long long offset)
+{
+    long long result;
+    HANDLE file_hdl;
+    OVERLAPPED overlapped;
+    DWORD written_size;
+    result = -1;
+    file_hdl = (HANDLE)_get_osfhandle(fd);
+    if (file_hdl != INVALID_HANDLE_VALUE) {
+        memset(&overlapped, 0, sizeof(overlapped));
+        overlapped.Offset = (DWORD)offset;
+        overlapped.OffsetHigh = (DWORD)(offset >> 32);
+        if (size > MAXDWORD) {
+            size = MAXDWORD;
+        }
+        if (WriteFile(file_hdl, data, (DWORD)size, &written_size,
+            &overlapped)) {
+            result = (long long)written_size;
+        } else {
+            errno = EIO;
+        }
+    } else {
+        errno = EBADF;
+    }
+    return result;
+}
+
+/**
+ * convert utf8 string to utf16 string
+ */
+static wchar_t*
+file_i_to_utf16(
+    const char* str)
+{
+    wchar_t* result;
+    if (str) {
+        result = (wchar_t*)str_conv_utf8_to_utf16(
+            str, strlen(str) + 1, file_i_mem_alloc, file_i_mem_free);
+    } else {
+        result = NULL;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * copy stat into file status
+ */
+static void
+file_i_copy_stat(
+    const struct _stat* st,
+    file_i_stat_info* info)
+{
+    info->size = (unsigned long long)st->st_size;
+    info->mtime = st->st_mtime;
+    info->is_dir = (st->st_mode & _S_IFDIR) == _S_IFDIR ? 1 : 0;
+    info->is_regular = (st->st_mode & _S_IFMT) == _S_IFREG ? 1 : 0;
+}
+
+/**
+ * allocate memory
+ */
+static void*
+file_i_mem_alloc(
+    size_t size)
+{
+    return malloc(size);
+}
+
+/**
+ * free memory
+ */
+static void
+file_i_mem_free(
+    void* heap_obj)
+{
+    free(heap_obj);
+}
+
+/* vi: se ts=4 sw=4 et: */
@@ -0,0 +1,331 @@
+#include "folder_cache.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "file_i.h"
+#include "dir.h"
+#include "path.h"
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+/**
+ * maximum size of key in bytes
+ */
+#define FOLDER_CACHE_KEY_SIZE_MAX 64
+
+/**
+ * maximum trials to create unique file for new entry
+ */
+#define FOLDER_CACHE_CREATE_TRIALS 0x100
+
+/**
+ * folder cache
+ */
+struct _folder_cache {
+    /**
+     * directory keeping entries
+     */
+    char* dir_path;
+};
+
+/**
+ * entry being written into cache
+ */
+struct _folder_cache_entry {
+    /**
+     * stream to write entry
+     */
+    FILE* stream;
+
+    /**
+     * path of file being written
+     */
+    char* temp_path;
+
+    /**
+     * path of entry
+     */
+    char* entry_path;
+};
+
+/**
+ * get path of file in the cache directory.
+ * The file name is hexadecimal string of key followed by suffix.
+ */
+static char*
+folder_cache_get_path(
+    folder_cache* obj,
+    const unsigned char* key,
+    size_t key_size,
+    const char* suffix);
+
+/**
+ * allocate memory
+ */
+static void*
+folder_cache_mem_alloc(
+    size_t size);
+
+/**
+ * free memory
+ */
+static void
+folder_cache_mem_free(
+    void* heap_obj);
+
+/**
+ * create folder cache on the directory.
+ */
+folder_cache*
+folder_cache_create(
+    const char* dir_path)
+{
+    folder_cache* result;
+    int state;
+    result = NULL;
+    if (dir_path && dir_path[0]) {
+        state = 0;
+    } else {
+        state = -1;
+        errno = EINVAL;
+    }
+    if (state == 0 && !dir_is_exists(dir_path)) {
+        state = dir_mkdir_p(dir_path);
+    }
+    if (state == 0) {
+        result = (folder_cache*)folder_cache_mem_alloc(sizeof(folder_cache));
+    }
+    if (result) {
+        size_t path_size;
+        path_size = strlen(dir_path) + 1;
+        result->dir_path = (char*)folder_cache_mem_alloc(path_size);
+        if (result->dir_path) {
+            memcpy(result->dir_path, dir_path, path_size);
+        } else {
+            folder_cache_mem_free(result);
+            result = NULL;
+        }
+    }
+    return result;
+}
+
+/**
+ * free folder cache.
+ */
+void
+folder_cache_free(
+    folder_cache* obj)
+{
+    if (obj) {
+        folder_cache_mem_free(obj->dir_path);
+        folder_cache_mem_free(obj);
+    }
+}
+
+/**
+ * open the entry for the key to read.
+ */
+FILE*
+folder_cache_open(
+    folder_cache* obj,
+    const unsigned char* key,
+    size_t key_size)
+{
+    FILE* result;
+    char* entry_path;
+    result = NULL;
+    entry_path = NULL;
+    if (obj && key && key_size && key_size <= FOLDER_CACHE_KEY_SIZE_MAX) {
+        entry_path = folder_cache_get_path(obj, key, key_size, "");
+    } else {
+        errno = EINVAL;
+    }
+    if (entry_path) {
+        result = file_i_fopen(entry_path, "rb");
+        folder_cache_mem_free(entry_path);
+    }
+    return result;
+}
+
+/**
+ * start writing new entry for the key
+ */
+folder_cache_entry*
+folder_cache_entry_create(
+    folder_cache* obj,
+    const unsigned char* key,
+    size_t key_size)
+{
+    folder_cache_entry* result;
+    result = NULL;
+    if (obj && key && key_size && key_size <= FOLDER_CACHE_KEY_SIZE_MAX) {
+        result = (folder_cache_entry*)folder_cache_mem_alloc(
+            sizeof(folder_cache_entry));
+    } else {
+        errno = EINVAL;
+    }
+    if (result) {
+        memset(result, 0, sizeof(*result));
+        result->entry_path = folder_cache_get_path(obj, key, key_size, "");
+        if (!result->entry_path) {
+            folder_cache_entry_free(result);
+            result = NULL;
+        }
+    }
+    if (result) {
+        unsigned int trial;
+        int fd;
+        fd = -1;
+        for (trial = 0; trial < FOLDER_CACHE_CREATE_TRIALS; trial++) {
+            char suffix[16];
+            snprintf(suffix, sizeof(suffix), ".%u.tmp", trial);
+            result->temp_path = folder_cache_get_path(obj, key, key_size,
+                suffix);
+            if (!result->temp_path) {
+                break;
+            }
+            fd = file_i_open(result->temp_path,
+                O_WRONLY | O_CREAT | O_EXCL | O_BINARY, 0666);
+            if (fd != -1 || errno != EEXIST) {
+                break;
+            }
+            folder_cache_mem_free(result->temp_path);
+            result->temp_path = NULL;
+        }
+        if (fd != -1) {
+            result->stream = file_i_fdopen(fd, "wb");
+            if (!result->stream) {
+                int err;
+                err = errno;
+                close(fd);
+                errno = err;
+            }
+        }
+        if (!result->stream) {
+            folder_cache_entry_free(result);
+            result = NULL;
+        }
+    }
+    return result;
+}
+
+/**
+ * append data into the entry
+ */
+int
+folder_cache_entry_write(
+    folder_cache_entry* entry,
+    const void* data,
+    size_t size)
+{
+    int result;
+    if (entry && entry->stream && (data || !size)) {
+        result = fwrite(data, 1, size, entry->stream) == size ? 0 : -1;
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * complete the entry and replace the entry for the same key.
+ */
+int
+folder_cache_entry_commit(
+    folder_cache_entry* entry)
+{
+    int result;
+    if (entry && entry->stream) {
+        result = fclose(entry->stream);
+        entry->stream = NULL;
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    if (result == 0) {
+        result = file_i_rename(entry->temp_path, entry->entry_path);
+    }
+    if (result == 0) {
+        folder_cache_mem_free(entry->temp_path);
+        entry->temp_path = NULL;
+    }
+    folder_cache_entry_free(entry);
+    return result;
+}
+
+/**
+ * discard the entry not committed
+ */
+void
+folder_cache_entry_free(
+    folder_cache_entry* entry)
+{
+    if (entry) {
+        if (entry->stream) {
+            fclose(entry->stream);
+        }
+        if (entry->temp_path) {
+            file_i_remove(entry->temp_path);
+            folder_cache_mem_free(entry->temp_path);
+        }
+        if (entry->entry_path) {
+            folder_cache_mem_free(entry->entry_path);
+        }
+        folder_cache_mem_free(entry);
+    }
+}
+
+/**
+ * get path of file in the cache directory.
+ */
+static char*
+folder_cache_get_path(
+    folder_cache* obj,
+    const unsigned char* key,
+    size_t key_size,
+    const char* suffix)
+{
+    static const char hex_chars[] = "0123456789abcdef";
+    char file_name[FOLDER_CACHE_KEY_SIZE_MAX * 2 + 16];
+    char* result;
+    size_t idx;
+    result = NULL;
+    for (idx = 0; idx < key_size; idx++) {
+        file_name[idx * 2] = hex_chars[key[idx] >> 4];
+        file_name[idx * 2 + 1] = hex_chars[key[idx] & 0xf];
+    }
+    snprintf(file_name + key_size * 2, sizeof(file_name) - key_size * 2,
+        "%s", suffix);
+    if (path_join(obj->dir_path, file_name, &result,
+        folder_cache_mem_alloc, folder_cache_mem_free)) {
+        result = NULL;
+    }
+    return result;
+}
+
+/**
+ * allocate memory
+ */
+static void*
+folder_cache_mem_alloc(
+    size_t size)
+{
+    return malloc(size);
+}
+
+/**
+ * free memory
+ */
+static void
+folder_cache_mem_free(
+    void* heap_obj)
+{
+    free(heap_obj);
+}
+
+/* vi: se ts=4 sw=4 et: */
@@ -0,0 +1,92 @@
+#ifndef __FOLDER_CACHE_H__
+#define __FOLDER_CACHE_H__
+
+#include <stddef.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+#define _FOLDER_CACHE_ITFC_BEGIN extern "C" {
+#define _FOLDER_CACHE_ITFC_END }
+#else
+#define _FOLDER_CACHE_ITFC_BEGIN
+#define _FOLDER_CACHE_ITFC_END
+#endif
+
+_FOLDER_CACHE_ITFC_BEGIN
+
+/**
+ * compressed folders kept in a directory across runs.
+ * Each entry is a file named by hexadecimal string of its key. An entry is
+ * written into a file with unique name and renamed to the key at commit,
+ * so that readers never see incomplete entries. The functions can be called
+ * from different threads at the same time.
+ */
+typedef struct _folder_cache folder_cache;
+
+/**
+ * entry being written into cache
+ */
+typedef struct _folder_cache_entry folder_cache_entry;
+
+/**
+ * create folder cache on the directory. The directory is created if it
+ * does not exist.
+ */
+folder_cache*
+folder_cache_create(
+    const char* dir_path);
+
+/**
+ * free folder cache. The entries on disk are kept.
+ */
+void
+folder_cache_free(
+    folder_cache* obj);
+
+/**
+ * open the entry for the key to read.
+ * You get NULL and errno is ENOENT if the entry does not exist.
+ */
+FILE*
+folder_cache_open(
+    folder_cache* obj,
+    const unsigned char* key,
+    size_t key_size);
+
+/**
+ * start writing new entry for the key
+ */
+folder_cache_entry*
+folder_cache_entry_create(
+    folder_cache* obj,
+    const unsigned char* key,
+    size_t key_size);
+
+/**
+ * append data into the entry
+ */
+int
+folder_cache_entry_write(
+    folder_cache_entry* entry,
+    const void* data,
+    size_t size);
+
+/**
+ * complete the entry and replace the entry for the same key.
+ * The entry is freed even if this fails.
+ */
+int
+folder_cache_entry_commit(
+    folder_cache_entry* entry);
+
+/**
+ * discard the entry not committed
+ */
+void
+folder_cache_entry_free(
+    folder_cache_entry* entry);
+
+_FOLDER_CACHE_ITFC_END
+
+/* vi: se ts=4 sw=4 et: */
+#endif
@@ -0,0 +1,744 @@
+#include "io_ring.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include "file_i.h"
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+/* read and write at explicit offset were added with the current position */
+#if defined(IORING_FEAT_RW_CUR_POS) && defined(__NR_io_uring_setup)
+#define IO_RING_HAVE_URING 1
+#endif
+#endif
+
+#ifndef IO_RING_HAVE_URING
+#define IO_RING_HAVE_URING 0
+#endif
+
+/**
+ * maximum size of a request
+ */
+#define IO_RING_REQUEST_SIZE_MAX 0x7ffff000
+
+/**
+ * completion kept for the request done by pread or pwrite
+ */
+typedef struct _io_ring_completion io_ring_completion;
+
+/**
+ * completion kept for the request done by pread or pwrite
+ */
+struct _io_ring_completion {
+    /**
+     * user data of the request
+     */
+    void* user_data;
+
+    /**
+     * size read or written, or negative error number
+     */
+    long result_size;
+};
+
+/**
+ * queue of file reads and writes at explicit offsets
+ */
+struct _io_ring {
+    /**
+     * maximum count of requests in flight
+     */
+    unsigned int depth;
+
+    /**
+     * count of requests queued or submitted and not waited yet
+     */
+    unsigned int in_flight;
+
+    /**
+     * completions of requests done by pread or pwrite
+     */
+    io_ring_completion* completions;
+
+    /**
+     * index of the first completion to be waited
+     */
+    unsigned int completion_head;
+
+    /**
+     * count of completions to be waited
+     */
+    unsigned int completion_count;
+
+    /**
+     * io_uring file descriptor. -1 if requests are done by pread or pwrite.
+     */
+    int ring_fd;
+
+#if IO_RING_HAVE_URING
+    /**
+     * mapped submission queue ring
+     */
+    void* sq_map;
+
+    /**
+     * size of mapped submission queue ring
+     */
+    size_t sq_map_size;
+
+    /**
+     * mapped completion queue ring. It is the same as sq_map if the kernel
+     * maps both rings at once.
+     */
+    void* cq_map;
+
+    /**
+     * size of mapped completion queue ring
+     */
+    size_t cq_map_size;
+
+    /**
+     * mapped submission queue entries
+     */
+    struct io_uring_sqe* sqes;
+
+    /**
+     * size of mapped submission queue entries
+     */
+    size_t sqes_size;
+
+    /**
+     * tail of submission queue written by this process
+     */
+    unsigned int* sq_tail;
+
+    /**
+     * mask of submission queue index
+     */
+    unsigned int* sq_mask;
+
+    /**
+     * indexes of submission queue entries
+     */
+    unsigned int* sq_array;
+
+    /**
+     * head of completion queue written by this process
+     */
+    unsigned int* cq_head;
+
+    /**
+     * tail of completion queue written by the kernel
+     */
+    unsigned int* cq_tail;
+
+    /**
+     * mask of completion queue index
+     */
+    unsigned int* cq_mask;
+
+    /**
+     * completion queue entries
+     */
+    struct io_uring_cqe* cqes;
+
+    /**
+     * count of requests queued and not submitted yet
+     */
+    unsigned int queued_count;
+
+    /**
+     * not zero if buffers are registered
+     */
+    int registered;
+#endif
+};
+
+#if IO_RING_HAVE_URING
+/**
+ * set up io_uring. You get non zero if io_uring is not available.
+ */
+static int
+io_ring_setup_uring(
+    io_ring* obj);
+
+/**
+ * release io_uring
+ */
+static void
+io_ring_release_uring(
+    io_ring* obj);
+
+/**
+ * queue request into submission queue
+ */
+static void
+io_ring_queue_uring(
+    io_ring* obj,
+    int op_code,
+    int fd,
+    void* buffer,
+    size_t size,
+    unsigned long long offset,
+    int buffer_index,
+    void* user_data);
+
+/**
+ * submit queued requests and wait min_complete requests to be completed
+ */
+static int
+io_ring_enter(
+    io_ring* obj,
+    unsigned int min_complete);
+
+/**
+ * take a completion from completion queue. You get non zero if the queue is
+ * empty.
+ */
+static int
+io_ring_take_uring(
+    io_ring* obj,
+    void** user_data,
+    long* result_size);
+#endif
+
+/**
+ * do request by pread or pwrite and keep the completion
+ */
+static void
+io_ring_do_request(
+    io_ring* obj,
+    int writing,
+    int fd,
+    void* buffer,
+    size_t size,
+    unsigned long long offset,
+    void* user_data);
+
+/**
+ * allocate memory
+ */
+static void*
+io_ring_mem_alloc(
+    size_t size);
+
+/**
+ * free memory
+ */
+static void
+io_ring_mem_free(
+    void* heap_obj);
+
+/**
+ * create io ring which keeps up to depth requests in flight
+ */
+io_ring*
+io_ring_create(
+    unsigned int depth)
+{
+    io_ring* result;
+    result = NULL;
+    if (depth && depth <= IO_RING_DEPTH_MAX) {
+        result = (io_ring*)io_ring_mem_alloc(sizeof(io_ring));
+    } else {
+        errno = EINVAL;
+    }
+    if (result) {
+        memset(result, 0, sizeof(*result));
+        result->depth = depth;
+        result->ring_fd = -1;
+#if IO_RING_HAVE_URING
+        io_ring_setup_uring(result);
+#endif
+        if (result->ring_fd == -1) {
+            result->completions = (io_ring_completion*)io_ring_mem_alloc(
+                sizeof(io_ring_completion) * depth);
+            if (!result->completions) {
+                io_ring_mem_free(result);
+                result = NULL;
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ * you get not zero if requests are completed asynchronously by io_uring
+ */
+int
+io_ring_is_async(
+    io_ring* obj)
+{
+    return obj && obj->ring_fd != -1;
+}
+
+/**
+ * register buffers which are used by requests with buffer index.
+ */
+int
+io_ring_register_buffers(
+    io_ring* obj,
+    void* const* buffers,
+    size_t buffer_size,
+    unsigned int buffer_count)
+{
+    int result;
+    if (obj && (buffers || !buffer_count)) {
+        result = 0;
+    } else {
+        errno = EINVAL;
+        result = -1;
+    }
+#if IO_RING_HAVE_URING
+    if (result == 0 && obj->ring_fd != -1 && !obj->registered) {
+        struct iovec* iovecs;
+        unsigned int idx;
+        iovecs = (struct iovec*)io_ring_mem_alloc(
+            sizeof(struct iovec) * (buffer_count + 1));
+        result = iovecs ? 0 : -1;
+        if (result == 0) {
+            for (idx = 0; idx < buffer_count; idx++) {
+                iovecs[idx].iov_base = buffers[idx];
+                iovecs[idx].iov_len = buffer_size;
+            }
+            /* it may fail by the limit of locked memory */
+            result = (int)syscall(__NR_io_uring_register, obj->ring_fd,
+                IORING_REGISTER_BUFFERS, iovecs, buffer_count);
+            result = result == 0 ? 0 : -1;
+        }
+        if (result == 0) {
+            obj->registered = 1;
+        }
+        if (iovecs) {
+            io_ring_mem_free(iovecs);
+        }
+    }
+#endif
+    return result;
+}
+
+/**
+ * queue reading size bytes at the offset of file into buffer.
+ */
+int
+io_ring_read(
+    io_ring* obj,
+    int fd,
+    void* buffer,
+    size_t size,
+    unsigned long long offset,
+    int buffer_index,
+    void* user_data)
+{
+    int result;
+    if (obj && buffer) {
+        result = obj->in_flight < obj->depth ? 0 : -1;
+        if (result) {
+            errno = EBUSY;
+        }
+    } else {
+        errno = EINVAL;
+        result = -1;
+    }
+    if (result == 0) {
+        if (size > IO_RING_REQUEST_SIZE_MAX) {
+            size = IO_RING_REQUEST_SIZE_MAX;
+        }
+#if IO_RING_HAVE_URING
+        if (obj->ring_fd != -1) {
+            io_ring_queue_uring(obj,
+                obj->registered && buffer_index >= 0 ?
+                    IORING_OP_READ_FIXED : IORING_OP_READ,
+                fd, buffer, size, offset, buffer_index, user_data);
+        } else
+#endif
+        {
+            io_ring_do_request(obj, 0, fd, buffer, size, offset, user_data);
+        }
+        obj->in_flight++;
+    }
+    return result;
+}
+
+/**
+ * queue writing size bytes of data at the offset of file.
+ */
+int
+io_ring_write(
+    io_ring* obj,
+    int fd,
+    const void* data,
+    size_t size,
+    unsigned long long offset,
+    int buffer_index,
+    void* user_data)
+{
+    int result;
+    if (obj && data) {
+        result = obj->in_flight < obj->depth ? 0 : -1;
+        if (result) {
+            errno = EBUSY;
+        }
+    } else {
+        errno = EINVAL;
+        result = -1;
+    }
+    if (result == 0) {
+        if (size > IO_RING_REQUEST_SIZE_MAX) {
+            size = IO_RING_REQUEST_SIZE_MAX;
+        }
+#if IO_RING_HAVE_URING
+        if (obj->ring_fd != -1) {
+            io_ring_queue_uring(obj,
+                obj->registered && buffer_index >= 0 ?
+                    IORING_OP_WRITE_FIXED : IORING_OP_WRITE,
+                fd, (void*)data, size, offset, buffer_index, user_data);
+        } else
+#endif
+        {
+            io_ring_do_request(obj, 1, fd, (void*)data, size, offset,
+                user_data);
+        }
+        obj->in_flight++;
+    }
+    return result;
+}
+
+/**
+ * submit queued requests without waiting them
+ */
+int
+io_ring_submit(
+    io_ring* obj)
+{
+    int result;
+    if (obj) {
+        result = 0;
+#if IO_RING_HAVE_URING
+        if (obj->ring_fd != -1 && obj->queued_count) {
+            result = io_ring_enter(obj, 0);
+        }
+#endif
+    } else {
+        errno = EINVAL;
+        result = -1;
+    }
+    return result;
+}
+
+/**
+ * submit queued requests and wait a request to be completed.
+ */
+int
+io_ring_wait(
+    io_ring* obj,
+    void** user_data,
+    long* result_size)
+{
+    int result;
+    if (obj && user_data && result_size) {
+        result = obj->in_flight ? 0 : -1;
+        if (result) {
+            errno = ENOENT;
+        }
+    } else {
+        errno = EINVAL;
+        result = -1;
+    }
+#if IO_RING_HAVE_URING
+    if (result == 0 && obj->ring_fd != -1) {
+        while (result == 0
+            && io_ring_take_uring(obj, user_data, result_size)) {
+            result = io_ring_enter(obj, 1);
+        }
+    } else
+#endif
+    if (result == 0) {
+        io_ring_completion* completion;
+        completion = &obj->completions[obj->completion_head];
+        *user_data = completion->user_data;
+        *result_size = completion->result_size;
+        obj->completion_head = (obj->completion_head + 1) % obj->depth;
+        obj->completion_count--;
+    }
+    if (result == 0) {
+        obj->in_flight--;
+    }
+    return result;
+}
+
+/**
+ * count of requests in flight
+ */
+unsigned int
+io_ring_get_in_flight(
+    io_ring* obj)
+{
+    return obj ? obj->in_flight : 0;
+}
+
+/**
+ * wait all requests in flight and free io ring
+ */
+void
+io_ring_free(
+    io_ring* obj)
+{
+    if (obj) {
+        void* user_data;
+        long result_size;
+        while (obj->in_flight
+            && io_ring_wait(obj, &user_data, &result_size) == 0) {
+        }
+#if IO_RING_HAVE_URING
+        io_ring_release_uring(obj);
+#endif
+        if (obj->completions) {
+            io_ring_mem_free(obj->completions);
+        }
+        io_ring_mem_free(obj);
+    }
+}
+
+#if IO_RING_HAVE_URING
+/**
+ * set up io_uring. You get non zero if io_uring is not available.
+ */
+static int
+io_ring_setup_uring(
+    io_ring* obj)
+{
+    int result;
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    obj->ring_fd = (int)syscall(__NR_io_uring_setup, obj->depth, &params);
+    result = obj->ring_fd != -1 ? 0 : -1;
+    if (result == 0) {
+        result = params.features & IORING_FEAT_RW_CUR_POS ? 0 : -1;
+    }
+    if (result == 0) {
+        obj->sq_map_size = params.sq_off.array
+            + params.sq_entries * sizeof(unsigned int);
+        obj->cq_map_size = params.cq_off.cqes
+            + params.cq_entries * sizeof(struct io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP) {
+            if (obj->cq_map_size > obj->sq_map_size) {
+                obj->sq_map_size = obj->cq_map_size;
+            }
+            obj->cq_map_size = 0;
+        }
+        obj->sq_map = mmap(NULL, obj->sq_map_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, obj->ring_fd, IORING_OFF_SQ_RING);
+        if (obj->sq_map == MAP_FAILED) {
+            obj->sq_map = NULL;
+        }
+        result = obj->sq_map ? 0 : -1;
+    }
+    if (result == 0) {
+        if (obj->cq_map_size) {
+            obj->cq_map = mmap(NULL, obj->cq_map_size,
+                PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                obj->ring_fd, IORING_OFF_CQ_RING);
+            if (obj->cq_map == MAP_FAILED) {
+                obj->cq_map = NULL;
+            }
+        } else {
+            obj->cq_map = obj->sq_map;
+        }
+        obj->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+        obj->sqes = (struct io_uring_sqe*)mmap(NULL, obj->sqes_size,
+            PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            obj->ring_fd, IORING_OFF_SQES);
+        if (obj->sqes == MAP_FAILED) {
+            obj->sqes = NULL;
+        }
+        result = obj->cq_map && obj->sqes ? 0 : -1;
+    }
+    if (result == 0) {
+        unsigned char* sq_ptr;
+        unsigned char* cq_ptr;
+        sq_ptr = (unsigned char*)obj->sq_map;
+        cq_ptr = (unsigned char*)obj->cq_map;
+        obj->sq_tail = (unsigned int*)(sq_ptr + params.sq_off.tail);
+        obj->sq_mask = (unsigned int*)(sq_ptr + params.sq_off.ring_mask);
+        obj->sq_array = (unsigned int*)(sq_ptr + params.sq_off.array);
+        obj->cq_head = (unsigned int*)(cq_ptr + params.cq_off.head);
+        obj->cq_tail = (unsigned int*)(cq_ptr + params.cq_off.tail);
+        obj->cq_mask = (unsigned int*)(cq_ptr + params.cq_off.ring_mask);
+        obj->cqes = (struct io_uring_cqe*)(cq_ptr + params.cq_off.cqes);
+    }
+    if (result) {
+        /* requests are done by pread or pwrite */
+        io_ring_release_uring(obj);
+    }
+    return result;
+}
+
+/**
+ * release io_uring
+ */
+static void
+io_ring_release_uring(
+    io_ring* obj)
+{
+    if (obj->sqes) {
+        munmap(obj->sqes, obj->sqes_size);
+        obj->sqes = NULL;
+    }
+    if (obj->cq_map && obj->cq_map != obj->sq_map) {
+        munmap(obj->cq_map, obj->cq_map_size);
+    }
+    obj->cq_map = NULL;
+    if (obj->sq_map) {
+        munmap(obj->sq_map, obj->sq_map_size);
+        obj->sq_map = NULL;
+    }
+    if (obj->ring_fd != -1) {
+        close(obj->ring_fd);
+        obj->ring_fd = -1;
+    }
+    obj->registered = 0;
+}
+
+/**
+ * queue request into submission queue
+ */
+static void
+io_ring_queue_uring(
+    io_ring* obj,
+    int op_code,
+    int fd,
+    void* buffer,
+    size_t size,
+    unsigned long long offset,
+    int buffer_index,
+    void* user_data)
+{
+    unsigned int tail;
+    unsigned int index;
+    struct io_uring_sqe* sqe;
+    tail = *obj->sq_tail;
+    index = tail & *obj->sq_mask;
+    sqe = &obj->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = (unsigned char)op_code;
+    sqe->fd = fd;
+    sqe->off = offset;
+    sqe->addr = (unsigned long long)(uintptr_t)buffer;
+    sqe->len = (unsigned int)size;
+    sqe->user_data = (unsigned long long)(uintptr_t)user_data;
+    if (op_code == IORING_OP_READ_FIXED || op_code == IORING_OP_WRITE_FIXED) {
+        sqe->buf_index = (unsigned short)buffer_index;
+    }
+    obj->sq_array[index] = index;
+    /* the kernel reads the entry after it sees the new tail */
+    __atomic_store_n(obj->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    obj->queued_count++;
+}
+
+/**
+ * submit queued requests and wait min_complete requests to be completed
+ */
+static int
+io_ring_enter(
+    io_ring* obj,
+    unsigned int min_complete)
+{
+    int result;
+    result = 0;
+    do {
+        long submitted;
+        submitted = syscall(__NR_io_uring_enter, obj->ring_fd,
+            obj->queued_count, min_complete,
+            min_complete ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if (submitted >= 0) {
+            obj->queued_count -= (unsigned int)submitted;
+        } else if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            result = -1;
+        }
+    } while (result == 0 && obj->queued_count && !min_complete);
+    return result;
+}
+
+/**
+ * take a completion from completion queue.
+ */
+static int
+io_ring_take_uring(
+    io_ring* obj,
+    void** user_data,
+    long* result_size)
+{
+    int result;
+    unsigned int head;
+    head = *obj->cq_head;
+    /* the entry is written by the kernel before it moves the tail */
+    result = head != __atomic_load_n(obj->cq_tail, __ATOMIC_ACQUIRE) ?
+        0 : -1;
+    if (result == 0) {
+        struct io_uring_cqe* cqe;
+        cqe = &obj->cqes[head & *obj->cq_mask];
+        *user_data = (void*)(uintptr_t)cqe->user_data;
+        *result_size = cqe->res;
+        __atomic_store_n(obj->cq_head, head + 1, __ATOMIC_RELEASE);
+    }
+    return result;
+}
+#endif
+
+/**
+ * do request by pread or pwrite and keep the completion
+ */
+static void
+io_ring_do_request(
+    io_ring* obj,
+    int writing,
+    int fd,
+    void* buffer,
+    size_t size,
+    unsigned long long offset,
+    void* user_data)
+{
+    long long done_size;
+    io_ring_completion* completion;
+    do {
+        if (writing) {
+            done_size = file_i_pwrite(fd, buffer, size, offset);
+        } else {
+            done_size = file_i_pread(fd, buffer, size, offset);
+        }
+    } while (done_size < 0 && errno == EINTR);
+    completion = &obj->completions[
+        (obj->completion_head + obj->completion_count) % obj->depth];
+    completion->user_data = user_data;
+    completion->result_size = done_size >= 0 ?
+        (long)done_size : -(errno ? errno : EIO);
+    obj->completion_count++;
+}
+
+/**
+ * allocate memory
+ */
+static void*
+io_ring_mem_alloc(
+    size_t size)
+{
+    return malloc(size);
+}
+
+/**
+ * free memory
+ */
+static void
+io_ring_mem_free(
+    void* heap_obj)
+{
+    free(heap_obj);
+}
+
+/* vi: se ts=4 sw=4 et: */
@@ -0,0 +1,125 @@
+#ifndef __IO_RING_H__
+#define __IO_RING_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+#define _IO_RING_ITFC_BEGIN extern "C" {
+#define _IO_RING_ITFC_END }
+#else
+#define _IO_RING_ITFC_BEGIN
+#define _IO_RING_ITFC_END
+#endif
+
+_IO_RING_ITFC_BEGIN
+
+/**
+ * maximum count of requests in flight
+ */
+#define IO_RING_DEPTH_MAX 64
+
+/**
+ * queue of file reads and writes at explicit offsets.
+ * On linux the requests are submitted to io_uring in batches and completed
+ * asynchronously. Where io_uring is not available, each request is done by
+ * pread or pwrite when it is queued and its completion is kept until it is
+ * waited. A ring must not be used from different threads at the same time.
+ */
+typedef struct _io_ring io_ring;
+
+/**
+ * create io ring which keeps up to depth requests in flight
+ */
+io_ring*
+io_ring_create(
+    unsigned int depth);
+
+/**
+ * you get not zero if requests are completed asynchronously by io_uring
+ */
+int
+io_ring_is_async(
+    io_ring* obj);
+
+/**
+ * register buffers which are used by requests with buffer index.
+ * Registered buffers save mapping pages of the buffer for each request.
+ * You get non zero if the buffers can not be registered, but you can still
+ * use the buffers with buffer index.
+ */
+int
+io_ring_register_buffers(
+    io_ring* obj,
+    void* const* buffers,
+    size_t buffer_size,
+    unsigned int buffer_count);
+
+/**
+ * queue reading size bytes at the offset of file into buffer.
+ * buffer_index is the index of registered buffer containing the buffer or
+ * -1. The buffer has to be kept until the request is completed. You get
+ * non zero with errno EBUSY if depth requests are in flight.
+ */
+int
+io_ring_read(
+    io_ring* obj,
+    int fd,
+    void* buffer,
+    size_t size,
+    unsigned long long offset,
+    int buffer_index,
+    void* user_data);
+
+/**
+ * queue writing size bytes of data at the offset of file.
+ * buffer_index is the index of registered buffer containing the data or
+ * -1. The data has to be kept until the request is completed. You get
+ * non zero with errno EBUSY if depth requests are in flight.
+ */
+int
+io_ring_write(
+    io_ring* obj,
+    int fd,
+    const void* data,
+    size_t size,
+    unsigned long long offset,
+    int buffer_index,
+    void* user_data);
+
+/**
+ * submit queued requests without waiting them
+ */
+int
+io_ring_submit(
+    io_ring* obj);
+
+/**
+ * submit queued requests and wait a request to be completed.
+ * You get user data of the request and the size read or written, or
+ * negative error number as result size. You get non zero with errno ENOENT
+ * if no request is in flight.
+ */
+int
+io_ring_wait(
+    io_ring* obj,
+    void** user_data,
+    long* result_size);
+
+/**
+ * count of requests in flight
+ */
+unsigned int
+io_ring_get_in_flight(
+    io_ring* obj);
+
+/**
+ * wait all requests in flight and free io ring
+ */
+void
+io_ring_free(
+    io_ring* obj);
+
+_IO_RING_ITFC_END
+
+/* vi: se ts=4 sw=4 et: */
+#endif
@@ -12,6 +12,31 @@ path_is_dir_seps(
     const char* separators,
     size_t separators_size);
 
+/**
+ * you get non zero if the path matches the glob pattern from the start
+ */
+static int
+path_match_glob_0(
+    const char* pattern,
+    const char* path);
+
+/**
+ * you get non zero if the character matches the character set in glob
+ * pattern. set_end gets the position next to the set.
+ */
+static int
+path_match_glob_set(
+    const char* pattern,
+    int path_element,
+    const char** set_end);
+
+/**
+ * you get non zero if the character is directory separator in glob
+ */
+static int
+path_is_glob_dir_sep(
+    int path_element);
+
 /**
  * remove begining diectory separators
  */
@@ -405,4 +430,156 @@ path_is_dir_seps(
     return result;
 }
 
+/**
+ * you get non zero if the path matches the glob pattern.
+ */
+int
+path_match_glob(
+    const char* pattern,
+    const char* path)
+{
+    int result;
+    if (pattern && path) {
+        const char* name;
+        name = path;
+        if (!strchr(pattern, '/') && !strchr(pattern, '\\')) {
+            const char* ptr;
+            for (ptr = path; *ptr; ptr++) {
+                if (path_is_glob_dir_sep(*ptr)) {
+                    name = ptr + 1;
+                }
+            }
+        }
+        result = path_match_glob_0(pattern, name);
+    } else {
+        errno = EINVAL;
+        result = 0;
+    }
+    return result;
+}
+
+/**
+ * you get non zero if the path matches the glob pattern from the start
+ */
+static int
+path_match_glob_0(
+    const char* pattern,
+    const char* path)
+{
+    int result;
+    result = -1;
+    while (result < 0) {
+        if (pattern[0] == '*' && pattern[1] == '*') {
+            const char* rest;
+            const char* ptr;
+            rest = pattern + 2;
+            result = 0;
+            if (path_is_glob_dir_sep(*rest)) {
+                result = path_match_glob_0(rest + 1, path);
+            }
+            for (ptr = path; !result; ptr++) {
+                result = path_match_glob_0(rest, ptr);
+                if (!*ptr) {
+                    break;
+                }
+            }
+        } else if (pattern[0] == '*') {
+            const char* ptr;
+            result = 0;
+            for (ptr = path; !result; ptr++) {
+                result = path_match_glob_0(pattern + 1, ptr);
+                if (!*ptr || path_is_glob_dir_sep(*ptr)) {
+                    break;
+                }
+            }
+        } else if (!pattern[0] || !path[0]) {
+            result = !pattern[0] && !path[0];
+        } else if (pattern[0] == '?') {
+            if (path_is_glob_dir_sep(*path)) {
+                result = 0;
+            }
+            pattern++;
+            path++;
+        } else if (pattern[0] == '[') {
+            const char* set_end;
+            if (path_is_glob_dir_sep(*path)
+                || !path_match_glob_set(pattern, *path, &set_end)) {
+                result = 0;
+            }
+            pattern = set_end;
+            path++;
+        } else {
+            if (path_is_glob_dir_sep(pattern[0])) {
+                if (!path_is_glob_dir_sep(path[0])) {
+                    result = 0;
+                }
+            } else if (pattern[0] != path[0]) {
+                result = 0;
+            }
+            pattern++;
+            path++;
+        }
+    }
+    return result;
+}
+
+/**
+ * you get non zero if the character matches the character set in glob
+ * pattern. A '[' without closing ']' matches '[' itself.
+ */
+static int
+path_match_glob_set(
+    const char* pattern,
+    int path_element,
+    const char** set_end)
+{
+    int result;
+    int negate;
+    const char* ptr;
+    const char* end;
+    ptr = pattern + 1;
+    negate = *ptr == '!' || *ptr == '^';
+    if (negate) {
+        ptr++;
+    }
+    /* ']' just after '[' is a member of the set */
+    end = *ptr ? strchr(ptr + 1, ']') : NULL;
+    if (end) {
+        result = 0;
+        while (ptr < end) {
+            if (ptr + 2 < end && ptr[1] == '-') {
+                if ((unsigned char)ptr[0] <= (unsigned char)path_element
+                    && (unsigned char)path_element
+                        <= (unsigned char)ptr[2]) {
+                    result = 1;
+                }
+                ptr += 3;
+            } else {
+                if (*ptr == path_element) {
+                    result = 1;
+                }
+                ptr++;
+            }
+        }
+        if (negate) {
+            result = !result;
+        }
+        *set_end = end + 1;
+    } else {
+        result = path_element == '[';
+        *set_end = pattern + 1;
+    }
+    return result;
+}
+
+/**
+ * you get non zero if the character is directory separator in glob
+ */
+static int
+path_is_glob_dir_sep(
+    int path_element)
+{
+    return path_element == '/' || path_element == '\\';
+}
+
 /* vi: se ts=4 sw=4 et: */
@@ -76,6 +76,22 @@ path_join(
     void* (*mem_alloc)(size_t),
     void (*mem_free)(void*));
 
+/**
+ * you get non zero if the path matches the glob pattern.
+ * '*' matches characters except for directory separators, '**' matches
+ * any characters including directory separators, and '**' followed by a
+ * directory separator matches zero or more directories. '?' matches a
+ * character except for directory separators, and "[...]" or "[!...]"
+ * matches a character in or not in the set which may have ranges like
+ * "a-z". Both '/' and '\\' are directory separators on every platform.
+ * If the pattern does not have any directory separator, it is matched with
+ * the file name of the path. Characters are compared in case sensitive.
+ */
+int
+path_match_glob(
+    const char* pattern,
+    const char* path);
+
 _PATH_ITFC_END 
 
 /* vi: se ts=4 sw=4 et: */
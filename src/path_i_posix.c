@@ -0,0 +1,46 @@
+#include "path_i.h"
+#include <stddef.h>
+#include <errno.h>
+
+/**
+ * get directory separators
+ */
+int
+path_i_get_dir_separators(
+    const char** out_seps,
+    size_t* size)
+{
+    int result;
+    const static char separators[] = {
+        '/'
+    };
+    result = 0;
+    *out_seps = separators;
+    *size = sizeof(separators);
+    return result;
+}
+
+/**
+ * skip root path
+ */
+int
+path_i_skip_root(
+    const char* path,
+    const char** subpath)
+{
+    int result;
+    if (path) {
+        result = 0;
+        if (*path == '/') {
+            *subpath = path + 1;
+        } else {
+            *subpath = path;
+        }
+    } else {
+        errno = EINVAL;
+        result = -1;
+    }
+    return result;
+}
+
+/* vi: se ts=4 sw=4 et: */
@@ -0,0 +1,572 @@
+#include "read_ahead.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "file_i.h"
+#include "thread_i.h"
+#include "worker_pool.h"
+#include "io_ring.h"
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+/**
+ * size of file head advised to be read soon
+ */
+#define READ_AHEAD_ADVISE_SIZE 0x1000000
+
+/**
+ * size of a read request through io ring
+ */
+#define READ_AHEAD_CHUNK_SIZE 0x40000
+
+/**
+ * count of read requests in flight for a file through io ring
+ */
+#define READ_AHEAD_RING_DEPTH 4
+
+/**
+ * the slot is not used
+ */
+#define READ_AHEAD_SLOT_EMPTY 0
+
+/**
+ * the file of the slot is being read
+ */
+#define READ_AHEAD_SLOT_LOADING 1
+
+/**
+ * the file of the slot is ready to be taken
+ */
+#define READ_AHEAD_SLOT_READY 2
+
+/**
+ * file read ahead
+ */
+typedef struct _read_ahead_slot read_ahead_slot;
+
+/**
+ * file read ahead
+ */
+struct _read_ahead_slot {
+    /**
+     * one of READ_AHEAD_SLOT_XXX
+     */
+    int state;
+
+    /**
+     * file descriptor. -1 if the file can not be opened.
+     */
+    int fd;
+
+    /**
+     * data read from the beginning. NULL if no data is read.
+     */
+    unsigned char* data;
+
+    /**
+     * size of data
+     */
+    size_t data_size;
+};
+
+/**
+ * files read ahead in background
+ */
+struct _read_ahead {
+    /**
+     * files to be read
+     */
+    const char* const* file_paths;
+
+    /**
+     * count of files
+     */
+    size_t file_count;
+
+    /**
+     * slots of files read ahead. The file at an index is kept in the slot
+     * at the index modulo slot count.
+     */
+    read_ahead_slot* slots;
+
+    /**
+     * count of slots
+     */
+    unsigned int slot_count;
+
+    /**
+     * maximum size of data read from the beginning of file
+     */
+    size_t read_size;
+
+    /**
+     * not zero if files are read through io ring
+     */
+    int use_ring;
+
+    /**
+     * index of the next file to be read
+     */
+    size_t next_index;
+
+    /**
+     * index of the next file to be taken
+     */
+    size_t take_index;
+
+    /**
+     * not zero if threads have to stop reading
+     */
+    int stopped;
+
+    /**
+     * lock for indexes, slot states and running tasks
+     */
+    thread_i_mutex* lock;
+
+    /**
+     * signaled when a slot is ready or freed, or a task is completed
+     */
+    thread_i_cond* changed;
+
+    /**
+     * threads reading files
+     */
+    worker_pool* pool;
+
+    /**
+     * count of running tasks
+     */
+    unsigned int running_count;
+};
+
+/**
+ * read files ahead until reading is stopped or no file is left
+ */
+static void
+read_ahead_run(
+    void* arg);
+
+/**
+ * open a file and read its beginning into the slot
+ */
+static void
+read_ahead_load(
+    read_ahead* obj,
+    size_t file_index,
+    read_ahead_slot* slot,
+    io_ring* ring);
+
+/**
+ * read the beginning of file into the slot by chunks in flight
+ */
+static void
+read_ahead_load_by_ring(
+    read_ahead* obj,
+    read_ahead_slot* slot,
+    io_ring* ring);
+
+/**
+ * wait the slot to be loaded and discard the file in it
+ */
+static void
+read_ahead_discard(
+    read_ahead* obj,
+    read_ahead_slot* slot);
+
+/**
+ * allocate memory
+ */
+static void*
+read_ahead_mem_alloc(
+    size_t size);
+
+/**
+ * free memory
+ */
+static void
+read_ahead_mem_free(
+    void* heap_obj);
+
+/**
+ * start reading files ahead in background.
+ */
+read_ahead*
+read_ahead_create(
+    const char* const* file_paths,
+    size_t file_count,
+    unsigned int slot_count,
+    size_t read_size,
+    int use_ring)
+{
+    read_ahead* result;
+    int state;
+    result = NULL;
+    if ((file_paths || !file_count) && slot_count) {
+        result = (read_ahead*)read_ahead_mem_alloc(sizeof(read_ahead));
+    } else {
+        errno = EINVAL;
+    }
+    state = result ? 0 : -1;
+    if (state == 0) {
+        memset(result, 0, sizeof(*result));
+        result->file_paths = file_paths;
+        result->file_count = file_count;
+        result->slot_count = slot_count;
+        result->read_size = read_size;
+        result->use_ring = use_ring;
+        result->slots = (read_ahead_slot*)read_ahead_mem_alloc(
+            sizeof(read_ahead_slot) * slot_count);
+        result->lock = thread_i_mutex_create();
+        result->changed = thread_i_cond_create();
+        state = result->slots && result->lock && result->changed ? 0 : -1;
+    }
+    if (state == 0) {
+        unsigned int thread_count;
+        unsigned int idx;
+        memset(result->slots, 0, sizeof(read_ahead_slot) * slot_count);
+        thread_count = slot_count < READ_AHEAD_THREAD_MAX ?
+            slot_count : READ_AHEAD_THREAD_MAX;
+        if (file_count < thread_count) {
+            thread_count = (unsigned int)file_count;
+        }
+        if (thread_count) {
+            result->pool = worker_pool_create(thread_count);
+            state = result->pool ? 0 : -1;
+        }
+        for (idx = 0; state == 0 && idx < thread_count; idx++) {
+            thread_i_mutex_lock(result->lock);
+            result->running_count++;
+            thread_i_mutex_unlock(result->lock);
+            state = worker_pool_submit(result->pool, read_ahead_run, result);
+            if (state) {
+                thread_i_mutex_lock(result->lock);
+                result->running_count--;
+                thread_i_mutex_unlock(result->lock);
+            }
+        }
+    }
+    if (state && result) {
+        read_ahead_free(result);
+        result = NULL;
+    }
+    return result;
+}
+
+/**
+ * take the file read ahead.
+ */
+int
+read_ahead_take(
+    read_ahead* obj,
+    const char* file_path,
+    int* fd,
+    void** data,
+    size_t* data_size)
+{
+    int result;
+    result = -1;
+    if (obj && file_path && fd && data && data_size) {
+        size_t found_index;
+        size_t end_index;
+        size_t idx;
+        *fd = -1;
+        *data = NULL;
+        *data_size = 0;
+        thread_i_mutex_lock(obj->lock);
+        end_index = obj->take_index + obj->slot_count;
+        if (end_index > obj->file_count) {
+            end_index = obj->file_count;
+        }
+        for (found_index = obj->take_index; found_index < end_index;
+            found_index++) {
+            if (strcmp(obj->file_paths[found_index], file_path) == 0) {
+                break;
+            }
+        }
+        for (idx = obj->take_index;
+            found_index < end_index && idx < found_index
+                && idx < obj->next_index; idx++) {
+            read_ahead_discard(obj,
+                &obj->slots[idx % obj->slot_count]);
+        }
+        if (found_index < end_index && found_index < obj->next_index) {
+            read_ahead_slot* slot;
+            slot = &obj->slots[found_index % obj->slot_count];
+            while (slot->state == READ_AHEAD_SLOT_LOADING) {
+                thread_i_cond_wait(obj->changed, obj->lock);
+            }
+            if (slot->fd != -1) {
+                *fd = slot->fd;
+                *data = slot->data;
+                *data_size = slot->data_size;
+                result = 0;
+            }
+            slot->fd = -1;
+            slot->data = NULL;
+            slot->data_size = 0;
+            slot->state = READ_AHEAD_SLOT_EMPTY;
+        } else if (found_index < end_index) {
+            /* the files not read yet are skipped */
+            obj->next_index = found_index + 1;
+        }
+        if (found_index < end_index) {
+            obj->take_index = found_index + 1;
+            thread_i_cond_broadcast(obj->changed);
+        }
+        thread_i_mutex_unlock(obj->lock);
+    } else {
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * free data taken by read_ahead_take
+ */
+void
+read_ahead_free_data(
+    void* data)
+{
+    if (data) {
+        read_ahead_mem_free(data);
+    }
+}
+
+/**
+ * stop reading ahead and free the object.
+ */
+void
+read_ahead_free(
+    read_ahead* obj)
+{
+    if (obj) {
+        if (obj->pool) {
+            thread_i_mutex_lock(obj->lock);
+            obj->stopped = 1;
+            thread_i_cond_broadcast(obj->changed);
+            while (obj->running_count) {
+                thread_i_cond_wait(obj->changed, obj->lock);
+            }
+            thread_i_mutex_unlock(obj->lock);
+            worker_pool_free(obj->pool);
+            obj->pool = NULL;
+        }
+        if (obj->slots) {
+            unsigned int idx;
+            for (idx = 0; idx < obj->slot_count; idx++) {
+                read_ahead_discard(obj, &obj->slots[idx]);
+            }
+            read_ahead_mem_free(obj->slots);
+        }
+        thread_i_cond_free(obj->changed);
+        thread_i_mutex_free(obj->lock);
+        read_ahead_mem_free(obj);
+    }
+}
+
+/**
+ * read files ahead until reading is stopped or no file is left
+ */
+static void
+read_ahead_run(
+    void* arg)
+{
+    read_ahead* obj;
+    io_ring* ring;
+    obj = (read_ahead*)arg;
+    ring = NULL;
+    if (obj->use_ring && obj->read_size) {
+        /* files are read by plain reads if io ring can not be created */
+        ring = io_ring_create(READ_AHEAD_RING_DEPTH);
+    }
+    thread_i_mutex_lock(obj->lock);
+    while (1) {
+        size_t idx;
+        read_ahead_slot* slot;
+        while (!obj->stopped && obj->next_index < obj->file_count
+            && obj->next_index >= obj->take_index + obj->slot_count) {
+            thread_i_cond_wait(obj->changed, obj->lock);
+        }
+        if (obj->stopped || obj->next_index >= obj->file_count) {
+            break;
+        }
+        idx = obj->next_index++;
+        slot = &obj->slots[idx % obj->slot_count];
+        slot->state = READ_AHEAD_SLOT_LOADING;
+        thread_i_mutex_unlock(obj->lock);
+        read_ahead_load(obj, idx, slot, ring);
+        thread_i_mutex_lock(obj->lock);
+        slot->state = READ_AHEAD_SLOT_READY;
+        thread_i_cond_broadcast(obj->changed);
+    }
+    if (obj->running_count) {
+        obj->running_count--;
+    }
+    thread_i_cond_broadcast(obj->changed);
+    thread_i_mutex_unlock(obj->lock);
+    if (ring) {
+        io_ring_free(ring);
+    }
+}
+
+/**
+ * open a file and read its beginning into the slot
+ */
+static void
+read_ahead_load(
+    read_ahead* obj,
+    size_t file_index,
+    read_ahead_slot* slot,
+    io_ring* ring)
+{
+    slot->data = NULL;
+    slot->data_size = 0;
+    slot->fd = file_i_open(obj->file_paths[file_index],
+        O_RDONLY | O_BINARY, 0);
+    if (slot->fd != -1) {
+        file_i_advise_will_need(slot->fd, READ_AHEAD_ADVISE_SIZE);
+        if (obj->read_size) {
+            slot->data = (unsigned char*)read_ahead_mem_alloc(
+                obj->read_size);
+        }
+    }
+    if (slot->data && ring) {
+        read_ahead_load_by_ring(obj, slot, ring);
+    }
+    while (slot->data && !ring && slot->data_size < obj->read_size) {
+        ssize_t read_size;
+        read_size = read(slot->fd, slot->data + slot->data_size,
+            obj->read_size - slot->data_size);
+        if (read_size <= 0) {
+            break;
+        }
+        slot->data_size += (size_t)read_size;
+    }
+    if (slot->data && !slot->data_size) {
+        read_ahead_mem_free(slot->data);
+        slot->data = NULL;
+    }
+    if (slot->data && (!ring || !io_ring_is_async(ring))
+        && lseek(slot->fd, 0, SEEK_SET) != 0) {
+        /* the file is read from the beginning without the data */
+        read_ahead_mem_free(slot->data);
+        slot->data = NULL;
+        slot->data_size = 0;
+    }
+}
+
+/**
+ * read the beginning of file into the slot by chunks in flight.
+ * The data is valid up to the first chunk which is read short or fails.
+ */
+static void
+read_ahead_load_by_ring(
+    read_ahead* obj,
+    read_ahead_slot* slot,
+    io_ring* ring)
+{
+    size_t chunk_count;
+    size_t chunk_next;
+    size_t end_size;
+    chunk_count = (obj->read_size + READ_AHEAD_CHUNK_SIZE - 1)
+        / READ_AHEAD_CHUNK_SIZE;
+    chunk_next = 0;
+    end_size = obj->read_size;
+    while (1) {
+        void* user_data;
+        long result_size;
+        size_t chunk_offset;
+        size_t chunk_size;
+        while (chunk_next < chunk_count
+            && chunk_next * READ_AHEAD_CHUNK_SIZE < end_size) {
+            chunk_offset = chunk_next * READ_AHEAD_CHUNK_SIZE;
+            chunk_size = obj->read_size - chunk_offset;
+            if (chunk_size > READ_AHEAD_CHUNK_SIZE) {
+                chunk_size = READ_AHEAD_CHUNK_SIZE;
+            }
+            if (io_ring_read(ring, slot->fd, slot->data + chunk_offset,
+                chunk_size, chunk_offset, -1,
+                (void*)(uintptr_t)chunk_next)) {
+                break;
+            }
+            chunk_next++;
+        }
+        if (io_ring_wait(ring, &user_data, &result_size)) {
+            break;
+        }
+        chunk_offset = (size_t)(uintptr_t)user_data
+            * READ_AHEAD_CHUNK_SIZE;
+        chunk_size = obj->read_size - chunk_offset;
+        if (chunk_size > READ_AHEAD_CHUNK_SIZE) {
+            chunk_size = READ_AHEAD_CHUNK_SIZE;
+        }
+        if (result_size < (long)chunk_size) {
+            /* the end of file is reached or the chunk is not read */
+            size_t read_end;
+            read_end = chunk_offset;
+            if (result_size > 0) {
+                read_end += (size_t)result_size;
+            }
+            if (read_end < end_size) {
+                end_size = read_end;
+            }
+        }
+    }
+    slot->data_size = end_size;
+}
+
+/**
+ * wait the slot to be loaded and discard the file in it.
+ * The lock has to be held while threads are reading.
+ */
+static void
+read_ahead_discard(
+    read_ahead* obj,
+    read_ahead_slot* slot)
+{
+    if (obj->pool) {
+        while (slot->state == READ_AHEAD_SLOT_LOADING) {
+            thread_i_cond_wait(obj->changed, obj->lock);
+        }
+    }
+    if (slot->state == READ_AHEAD_SLOT_READY) {
+        if (slot->fd != -1) {
+            close(slot->fd);
+        }
+        if (slot->data) {
+            read_ahead_mem_free(slot->data);
+        }
+    }
+    slot->fd = -1;
+    slot->data = NULL;
+    slot->data_size = 0;
+    slot->state = READ_AHEAD_SLOT_EMPTY;
+}
+
+/**
+ * allocate memory
+ */
+static void*
+read_ahead_mem_alloc(
+    size_t size)
+{
+    return malloc(size);
+}
+
+/**
+ * free memory
+ */
+static void
+read_ahead_mem_free(
+    void* heap_obj)
+{
+    free(heap_obj);
+}
+
+/* vi: se ts=4 sw=4 et: */
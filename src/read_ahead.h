@@ -0,0 +1,77 @@
+#ifndef __READ_AHEAD_H__
+#define __READ_AHEAD_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+#define _READ_AHEAD_ITFC_BEGIN extern "C" {
+#define _READ_AHEAD_ITFC_END }
+#else
+#define _READ_AHEAD_ITFC_BEGIN
+#define _READ_AHEAD_ITFC_END
+#endif
+
+_READ_AHEAD_ITFC_BEGIN
+
+/**
+ * maximum count of threads reading files ahead
+ */
+#define READ_AHEAD_THREAD_MAX 4
+
+/**
+ * files read ahead in background
+ */
+typedef struct _read_ahead read_ahead;
+
+/**
+ * start reading files ahead in background.
+ * Up to slot_count files following the file taken last are opened, advised
+ * to be read soon and read from the beginning up to read_size bytes into
+ * buffers. Files are read in the order of file_paths by at most
+ * READ_AHEAD_THREAD_MAX threads. If use_ring is not zero, a few chunks of
+ * a file are read in flight through io ring. file_paths has to be kept
+ * until the object is freed.
+ */
+read_ahead*
+read_ahead_create(
+    const char* const* file_paths,
+    size_t file_count,
+    unsigned int slot_count,
+    size_t read_size,
+    int use_ring);
+
+/**
+ * take the file read ahead.
+ * The file is looked up from the next file of the file taken last within
+ * the slots, and the files skipped are discarded. You get 0 with the file
+ * descriptor positioned at the beginning and the data read from the
+ * beginning. You have to close the file descriptor and free the data by
+ * read_ahead_free_data. You get non zero if the file is not read ahead.
+ */
+int
+read_ahead_take(
+    read_ahead* obj,
+    const char* file_path,
+    int* fd,
+    void** data,
+    size_t* data_size);
+
+/**
+ * free data taken by read_ahead_take
+ */
+void
+read_ahead_free_data(
+    void* data);
+
+/**
+ * stop reading ahead and free the object. The files which are not taken
+ * are closed.
+ */
+void
+read_ahead_free(
+    read_ahead* obj);
+
+_READ_AHEAD_ITFC_END
+
+/* vi: se ts=4 sw=4 et: */
+#endif
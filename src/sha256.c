@@ -0,0 +1,190 @@
+#include "sha256.h"
+#include <string.h>
+
+/**
+ * rotate 32 bit value to right
+ */
+#define SHA256_ROTR(value, count) \
+    (((value) >> (count)) | ((value) << (32 - (count))))
+
+/**
+ * round constants
+ */
+static const uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/**
+ * process a message block
+ */
+static void
+sha256_process_block(
+    uint32_t* state,
+    const unsigned char* block);
+
+/**
+ * initialize context
+ */
+void
+sha256_init(
+    sha256_context* ctx)
+{
+    ctx->state[0] = 0x6a09e667;
+    ctx->state[1] = 0xbb67ae85;
+    ctx->state[2] = 0x3c6ef372;
+    ctx->state[3] = 0xa54ff53a;
+    ctx->state[4] = 0x510e527f;
+    ctx->state[5] = 0x9b05688c;
+    ctx->state[6] = 0x1f83d9ab;
+    ctx->state[7] = 0x5be0cd19;
+    ctx->size = 0;
+    ctx->block_fill = 0;
+}
+
+/**
+ * append data into message
+ */
+void
+sha256_update(
+    sha256_context* ctx,
+    const void* data,
+    size_t size)
+{
+    const unsigned char* ptr;
+    ptr = (const unsigned char*)data;
+    ctx->size += size;
+    if (ctx->block_fill) {
+        size_t copy_size;
+        copy_size = SHA256_BLOCK_SIZE - ctx->block_fill;
+        if (copy_size > size) {
+            copy_size = size;
+        }
+        memcpy(ctx->block + ctx->block_fill, ptr, copy_size);
+        ctx->block_fill += copy_size;
+        ptr += copy_size;
+        size -= copy_size;
+        if (ctx->block_fill == SHA256_BLOCK_SIZE) {
+            sha256_process_block(ctx->state, ctx->block);
+            ctx->block_fill = 0;
+        }
+    }
+    while (size >= SHA256_BLOCK_SIZE) {
+        sha256_process_block(ctx->state, ptr);
+        ptr += SHA256_BLOCK_SIZE;
+        size -= SHA256_BLOCK_SIZE;
+    }
+    if (size) {
+        memcpy(ctx->block, ptr, size);
+        ctx->block_fill = size;
+    }
+}
+
+/**
+ * complete message and get digest.
+ */
+void
+sha256_final(
+    sha256_context* ctx,
+    unsigned char* digest)
+{
+    uint64_t bit_size;
+    size_t idx;
+    bit_size = ctx->size * 8;
+    ctx->block[ctx->block_fill++] = 0x80;
+    if (ctx->block_fill > SHA256_BLOCK_SIZE - 8) {
+        memset(ctx->block + ctx->block_fill, 0,
+            SHA256_BLOCK_SIZE - ctx->block_fill);
+        sha256_process_block(ctx->state, ctx->block);
+        ctx->block_fill = 0;
+    }
+    memset(ctx->block + ctx->block_fill, 0,
+        SHA256_BLOCK_SIZE - 8 - ctx->block_fill);
+    for (idx = 0; idx < 8; idx++) {
+        ctx->block[SHA256_BLOCK_SIZE - 1 - idx] =
+            (unsigned char)(bit_size >> (idx * 8));
+    }
+    sha256_process_block(ctx->state, ctx->block);
+    for (idx = 0; idx < 8; idx++) {
+        digest[idx * 4] = (unsigned char)(ctx->state[idx] >> 24);
+        digest[idx * 4 + 1] = (unsigned char)(ctx->state[idx] >> 16);
+        digest[idx * 4 + 2] = (unsigned char)(ctx->state[idx] >> 8);
+        digest[idx * 4 + 3] = (unsigned char)ctx->state[idx];
+    }
+}
+
+/**
+ * process a message block
+ */
+static void
+sha256_process_block(
+    uint32_t* state,
+    const unsigned char* block)
+{
+    uint32_t w[64];
+    uint32_t a, b, c, d, e, f, g, h;
+    size_t idx;
+    for (idx = 0; idx < 16; idx++) {
+        w[idx] = ((uint32_t)block[idx * 4] << 24)
+            | ((uint32_t)block[idx * 4 + 1] << 16)
+            | ((uint32_t)block[idx * 4 + 2] << 8)
+            | (uint32_t)block[idx * 4 + 3];
+    }
+    for (idx = 16; idx < 64; idx++) {
+        uint32_t s0;
+        uint32_t s1;
+        s0 = SHA256_ROTR(w[idx - 15], 7) ^ SHA256_ROTR(w[idx - 15], 18)
+            ^ (w[idx - 15] >> 3);
+        s1 = SHA256_ROTR(w[idx - 2], 17) ^ SHA256_ROTR(w[idx - 2], 19)
+            ^ (w[idx - 2] >> 10);
+        w[idx] = w[idx - 16] + s0 + w[idx - 7] + s1;
+    }
+    a = state[0];
+    b = state[1];
+    c = state[2];
+    d = state[3];
+    e = state[4];
+    f = state[5];
+    g = state[6];
+    h = state[7];
+    for (idx = 0; idx < 64; idx++) {
+        uint32_t t1;
+        uint32_t t2;
+        t1 = h + (SHA256_ROTR(e, 6) ^ SHA256_ROTR(e, 11) ^ SHA256_ROTR(e, 25))
+            + ((e & f) ^ (~e & g)) + SHA256_K[idx] + w[idx];
+        t2 = (SHA256_ROTR(a, 2) ^ SHA256_ROTR(a, 13) ^ SHA256_ROTR(a, 22))
+            + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+/* vi: se ts=4 sw=4 et: */
@@ -0,0 +1,85 @@
+#ifndef __SHA256_H__
+#define __SHA256_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+#define _SHA256_ITFC_BEGIN extern "C" {
+#define _SHA256_ITFC_END }
+#else
+#define _SHA256_ITFC_BEGIN
+#define _SHA256_ITFC_END
+#endif
+
+_SHA256_ITFC_BEGIN
+
+/**
+ * size of sha256 digest in bytes
+ */
+#define SHA256_DIGEST_SIZE 32
+
+/**
+ * size of sha256 message block in bytes
+ */
+#define SHA256_BLOCK_SIZE 64
+
+/**
+ * sha256 calculation context
+ */
+typedef struct _sha256_context sha256_context;
+
+/**
+ * sha256 calculation context
+ */
+struct _sha256_context {
+    /**
+     * intermediate hash value
+     */
+    uint32_t state[8];
+
+    /**
+     * total size of message in bytes
+     */
+    uint64_t size;
+
+    /**
+     * message block not processed yet
+     */
+    unsigned char block[SHA256_BLOCK_SIZE];
+
+    /**
+     * size of data in block
+     */
+    size_t block_fill;
+};
+
+/**
+ * initialize context
+ */
+void
+sha256_init(
+    sha256_context* ctx);
+
+/**
+ * append data into message
+ */
+void
+sha256_update(
+    sha256_context* ctx,
+    const void* data,
+    size_t size);
+
+/**
+ * complete message and get digest.
+ * You have to initialize the context again to use it for another message.
+ */
+void
+sha256_final(
+    sha256_context* ctx,
+    unsigned char* digest);
+
+_SHA256_ITFC_END
+
+/* vi: se ts=4 sw=4 et: */
+#endif
@@ -0,0 +1,625 @@
+#include "similarity_order.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "file_i.h"
+#include "worker_pool.h"
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+/**
+ * count of minhash bins in a sketch
+ */
+#define SIMILARITY_ORDER_SKETCH_SIZE 64
+
+/**
+ * bytes of a shingle hashed into the sketch
+ */
+#define SIMILARITY_ORDER_SHINGLE_SIZE 8
+
+/**
+ * contents are sketched up to this size from the beginning of file
+ */
+#define SIMILARITY_ORDER_SCAN_SIZE 0x800000
+
+/**
+ * size of buffer to read file which can not be mapped
+ */
+#define SIMILARITY_ORDER_READ_SIZE 0x10000
+
+/**
+ * count of files searched for the most similar file of the previous one
+ */
+#define SIMILARITY_ORDER_SEARCH_SIZE 256
+
+/**
+ * value of minhash bin which has no shingle
+ */
+#define SIMILARITY_ORDER_EMPTY_BIN 0xffffffffu
+
+/**
+ * file to be ordered
+ */
+typedef struct _similarity_order_file similarity_order_file;
+
+/**
+ * file to be ordered
+ */
+struct _similarity_order_file {
+    /**
+     * index of file
+     */
+    size_t index;
+
+    /**
+     * file path
+     */
+    const char* path;
+
+    /**
+     * file size
+     */
+    unsigned long long size;
+
+    /**
+     * file name extension. empty string if the file has no extension.
+     */
+    const char* extension;
+
+    /**
+     * class of file
+     */
+    size_t class_id;
+
+    /**
+     * index of the first file in the class
+     */
+    size_t class_rank;
+
+    /**
+     * index of the first file having the same extension in the class
+     */
+    size_t extension_rank;
+
+    /**
+     * minhash of contents
+     */
+    uint32_t sketch[SIMILARITY_ORDER_SKETCH_SIZE];
+};
+
+/**
+ * sketch a file in files to be sketched
+ */
+static void
+similarity_order_run(
+    void* context,
+    void* local,
+    size_t idx);
+
+/**
+ * calculate minhash sketch of file contents
+ */
+static int
+similarity_order_sketch_file(
+    similarity_order_file* file);
+
+/**
+ * put shingles in data into sketch
+ */
+static void
+similarity_order_sketch_update(
+    uint32_t* sketch,
+    const uint8_t* data,
+    size_t size);
+
+/**
+ * estimate similarity of sketches. You get the count of matched bins.
+ */
+static unsigned int
+similarity_order_compare_sketch(
+    const uint32_t* sketch_l,
+    const uint32_t* sketch_r);
+
+/**
+ * order files in the range by similarity of contents
+ */
+static void
+similarity_order_sort_cluster(
+    similarity_order_file** files,
+    size_t file_count);
+
+/**
+ * get file name extension
+ */
+static const char*
+similarity_order_get_extension(
+    const char* path);
+
+/**
+ * compare extension ignoring ascii case
+ */
+static int
+similarity_order_compare_extension(
+    const char* lhs,
+    const char* rhs);
+
+/**
+ * compare files by class and index
+ */
+static int
+similarity_order_compare_class(
+    const void* lhs,
+    const void* rhs);
+
+/**
+ * compare files by class rank, extension and index
+ */
+static int
+similarity_order_compare_extension_in_class(
+    const void* lhs,
+    const void* rhs);
+
+/**
+ * compare files by class rank, extension rank and index
+ */
+static int
+similarity_order_compare_rank(
+    const void* lhs,
+    const void* rhs);
+
+/**
+ * allocate memory
+ */
+static void*
+similarity_order_mem_alloc(
+    size_t size);
+
+/**
+ * free memory
+ */
+static void
+similarity_order_mem_free(
+    void* heap_obj);
+
+/**
+ * order files so that similar files are placed next to each other.
+ */
+int
+similarity_order_sort(
+    const char* const* file_paths,
+    const unsigned long long* file_sizes,
+    const size_t* classes,
+    size_t file_count,
+    unsigned int jobs,
+    size_t* order)
+{
+    int result;
+    similarity_order_file* files;
+    similarity_order_file** sorted_files;
+    similarity_order_file** sketch_files;
+    size_t sketch_count;
+    size_t idx;
+    sketch_count = 0;
+    files = (similarity_order_file*)similarity_order_mem_alloc(
+        sizeof(similarity_order_file) * (file_count + 1));
+    sorted_files = (similarity_order_file**)similarity_order_mem_alloc(
+        sizeof(similarity_order_file*) * (file_count + 1));
+    sketch_files = (similarity_order_file**)similarity_order_mem_alloc(
+        sizeof(similarity_order_file*) * (file_count + 1));
+    result = files && sorted_files && sketch_files ? 0 : -1;
+    if (result == 0) {
+        for (idx = 0; idx < file_count; idx++) {
+            memset(&files[idx], 0, sizeof(files[idx]));
+            files[idx].index = idx;
+            files[idx].path = file_paths[idx];
+            files[idx].size = file_sizes[idx];
+            files[idx].extension = similarity_order_get_extension(
+                file_paths[idx]);
+            files[idx].class_id = classes[idx];
+            sorted_files[idx] = &files[idx];
+        }
+        /* classes are ordered by their first file */
+        qsort(sorted_files, file_count, sizeof(sorted_files[0]),
+            similarity_order_compare_class);
+        for (idx = 0; idx < file_count; idx++) {
+            if (idx > 0 && sorted_files[idx - 1]->class_id
+                == sorted_files[idx]->class_id) {
+                sorted_files[idx]->class_rank =
+                    sorted_files[idx - 1]->class_rank;
+            } else {
+                sorted_files[idx]->class_rank = sorted_files[idx]->index;
+            }
+        }
+        /* extensions in a class are ordered by their first file */
+        qsort(sorted_files, file_count, sizeof(sorted_files[0]),
+            similarity_order_compare_extension_in_class);
+        for (idx = 0; idx < file_count; idx++) {
+            if (idx > 0 && sorted_files[idx - 1]->class_rank
+                == sorted_files[idx]->class_rank
+                && similarity_order_compare_extension(
+                    sorted_files[idx - 1]->extension,
+                    sorted_files[idx]->extension) == 0) {
+                sorted_files[idx]->extension_rank =
+                    sorted_files[idx - 1]->extension_rank;
+            } else {
+                sorted_files[idx]->extension_rank = sorted_files[idx]->index;
+            }
+        }
+        qsort(sorted_files, file_count, sizeof(sorted_files[0]),
+            similarity_order_compare_rank);
+    }
+    if (result == 0) {
+        size_t start;
+        start = 0;
+        while (start < file_count) {
+            size_t end;
+            end = start + 1;
+            while (end < file_count
+                && sorted_files[end]->extension_rank
+                    == sorted_files[start]->extension_rank) {
+                end++;
+            }
+            /* two files are kept in the order whatever they are */
+            for (idx = start; end - start > 2 && idx < end; idx++) {
+                sketch_files[sketch_count++] = sorted_files[idx];
+            }
+            start = end;
+        }
+    }
+    if (result == 0) {
+        result = worker_pool_for_each(jobs, sketch_count,
+            similarity_order_run, NULL, NULL, sketch_files);
+    }
+    if (result == 0) {
+        size_t start;
+        start = 0;
+        while (start < file_count) {
+            size_t end;
+            end = start + 1;
+            while (end < file_count
+                && sorted_files[end]->extension_rank
+                    == sorted_files[start]->extension_rank) {
+                end++;
+            }
+            if (end - start > 2) {
+                similarity_order_sort_cluster(&sorted_files[start],
+                    end - start);
+            }
+            start = end;
+        }
+        for (idx = 0; idx < file_count; idx++) {
+            order[idx] = sorted_files[idx]->index;
+        }
+    }
+    if (sketch_files) {
+        similarity_order_mem_free(sketch_files);
+    }
+    if (sorted_files) {
+        similarity_order_mem_free(sorted_files);
+    }
+    if (files) {
+        similarity_order_mem_free(files);
+    }
+    return result;
+}
+
+/**
+ * sketch a file in files to be sketched
+ */
+static void
+similarity_order_run(
+    void* context,
+    void* local,
+    size_t idx)
+{
+    (void)local;
+    similarity_order_sketch_file(((similarity_order_file**)context)[idx]);
+}
+
+/**
+ * calculate minhash sketch of file contents. The sketch of the file which
+ * can not be read is left empty.
+ */
+static int
+similarity_order_sketch_file(
+    similarity_order_file* file)
+{
+    int result;
+    int fd;
+    size_t scan_size;
+    const void* data;
+    size_t idx;
+    for (idx = 0; idx < SIMILARITY_ORDER_SKETCH_SIZE; idx++) {
+        file->sketch[idx] = SIMILARITY_ORDER_EMPTY_BIN;
+    }
+    fd = -1;
+    data = NULL;
+    scan_size = 0;
+    scan_size = file->size < SIMILARITY_ORDER_SCAN_SIZE ?
+        (size_t)file->size : SIMILARITY_ORDER_SCAN_SIZE;
+    fd = file_i_open(file->path, O_RDONLY | O_BINARY, 0);
+    result = fd != -1 ? 0 : -1;
+    if (result == 0 && scan_size) {
+        data = file_i_map(fd, scan_size);
+    }
+    if (data) {
+        similarity_order_sketch_update(file->sketch,
+            (const uint8_t*)data, scan_size);
+        file_i_unmap(data, scan_size);
+    } else if (result == 0 && scan_size) {
+        uint8_t* buffer;
+        size_t buffer_size;
+        buffer = (uint8_t*)similarity_order_mem_alloc(
+            SIMILARITY_ORDER_READ_SIZE + SIMILARITY_ORDER_SHINGLE_SIZE);
+        result = buffer ? 0 : -1;
+        buffer_size = 0;
+        while (result == 0 && scan_size) {
+            ssize_t read_size;
+            read_size = read(fd, buffer + buffer_size,
+                scan_size < SIMILARITY_ORDER_READ_SIZE ?
+                    scan_size : SIMILARITY_ORDER_READ_SIZE);
+            if (read_size > 0) {
+                buffer_size += (size_t)read_size;
+                scan_size -= (size_t)read_size;
+                similarity_order_sketch_update(file->sketch,
+                    buffer, buffer_size);
+                /* keep the tail to make shingles over the boundary */
+                if (buffer_size >= SIMILARITY_ORDER_SHINGLE_SIZE) {
+                    memmove(buffer,
+                        buffer + buffer_size
+                            - (SIMILARITY_ORDER_SHINGLE_SIZE - 1),
+                        SIMILARITY_ORDER_SHINGLE_SIZE - 1);
+                    buffer_size = SIMILARITY_ORDER_SHINGLE_SIZE - 1;
+                }
+            } else {
+                result = -1;
+            }
+        }
+        if (buffer) {
+            similarity_order_mem_free(buffer);
+        }
+    }
+    if (fd != -1) {
+        close(fd);
+    }
+    return result;
+}
+
+/**
+ * put shingles in data into sketch. Each shingle is hashed once and the
+ * hash chooses the bin to keep its minimum.
+ */
+static void
+similarity_order_sketch_update(
+    uint32_t* sketch,
+    const uint8_t* data,
+    size_t size)
+{
+    size_t idx;
+    for (idx = 0; idx + SIMILARITY_ORDER_SHINGLE_SIZE <= size; idx++) {
+        uint64_t hash;
+        uint32_t value;
+        unsigned int bin;
+        memcpy(&hash, data + idx, sizeof(hash));
+        hash *= 0x9e3779b97f4a7c15ull;
+        hash ^= hash >> 29;
+        hash *= 0xbf58476d1ce4e5b9ull;
+        hash ^= hash >> 32;
+        bin = (unsigned int)(hash >> 58);
+        value = (uint32_t)hash;
+        if (value < sketch[bin]) {
+            sketch[bin] = value;
+        }
+    }
+}
+
+/**
+ * estimate similarity of sketches. You get the count of matched bins.
+ */
+static unsigned int
+similarity_order_compare_sketch(
+    const uint32_t* sketch_l,
+    const uint32_t* sketch_r)
+{
+    unsigned int result;
+    size_t idx;
+    result = 0;
+    for (idx = 0; idx < SIMILARITY_ORDER_SKETCH_SIZE; idx++) {
+        if (sketch_l[idx] == sketch_r[idx]
+            && sketch_l[idx] != SIMILARITY_ORDER_EMPTY_BIN) {
+            result++;
+        }
+    }
+    return result;
+}
+
+/**
+ * order files in the range by similarity of contents. The first file is
+ * kept and the most similar file of the previous one is chosen from the
+ * following files. Files keep their order if they are equally similar.
+ */
+static void
+similarity_order_sort_cluster(
+    similarity_order_file** files,
+    size_t file_count)
+{
+    size_t idx;
+    for (idx = 1; idx < file_count; idx++) {
+        size_t search_end;
+        size_t found;
+        unsigned int found_similarity;
+        size_t candidate;
+        search_end = file_count - idx < SIMILARITY_ORDER_SEARCH_SIZE ?
+            file_count : idx + SIMILARITY_ORDER_SEARCH_SIZE;
+        found = idx;
+        found_similarity = 0;
+        for (candidate = idx; candidate < search_end; candidate++) {
+            unsigned int similarity;
+            similarity = similarity_order_compare_sketch(
+                files[idx - 1]->sketch, files[candidate]->sketch);
+            if (similarity > found_similarity) {
+                found = candidate;
+                found_similarity = similarity;
+            }
+        }
+        if (found != idx) {
+            similarity_order_file* found_file;
+            found_file = files[found];
+            memmove(&files[idx + 1], &files[idx],
+                sizeof(files[0]) * (found - idx));
+            files[idx] = found_file;
+        }
+    }
+}
+
+/**
+ * get file name extension
+ */
+static const char*
+similarity_order_get_extension(
+    const char* path)
+{
+    const char* result;
+    const char* ptr;
+    result = NULL;
+    for (ptr = path; *ptr; ptr++) {
+        if (*ptr == '/' || *ptr == '\\') {
+            result = NULL;
+        } else if (*ptr == '.') {
+            result = ptr + 1;
+        }
+    }
+    if (!result) {
+        result = ptr;
+    }
+    return result;
+}
+
+/**
+ * compare extension ignoring ascii case
+ */
+static int
+similarity_order_compare_extension(
+    const char* lhs,
+    const char* rhs)
+{
+    int result;
+    result = 0;
+    while (result == 0) {
+        int chr_l;
+        int chr_r;
+        chr_l = (unsigned char)*lhs++;
+        chr_r = (unsigned char)*rhs++;
+        if ('A' <= chr_l && chr_l <= 'Z') {
+            chr_l += 'a' - 'A';
+        }
+        if ('A' <= chr_r && chr_r <= 'Z') {
+            chr_r += 'a' - 'A';
+        }
+        result = chr_l - chr_r;
+        if (!chr_l) {
+            break;
+        }
+    }
+    return result;
+}
+
+/**
+ * compare files by class and index
+ */
+static int
+similarity_order_compare_class(
+    const void* lhs,
+    const void* rhs)
+{
+    const similarity_order_file* file_l;
+    const similarity_order_file* file_r;
+    int result;
+    file_l = *(const similarity_order_file* const*)lhs;
+    file_r = *(const similarity_order_file* const*)rhs;
+    if (file_l->class_id != file_r->class_id) {
+        result = file_l->class_id < file_r->class_id ? -1 : 1;
+    } else if (file_l->index != file_r->index) {
+        result = file_l->index < file_r->index ? -1 : 1;
+    } else {
+        result = 0;
+    }
+    return result;
+}
+
+/**
+ * compare files by class rank, extension and index
+ */
+static int
+similarity_order_compare_extension_in_class(
+    const void* lhs,
+    const void* rhs)
+{
+    const similarity_order_file* file_l;
+    const similarity_order_file* file_r;
+    int result;
+    file_l = *(const similarity_order_file* const*)lhs;
+    file_r = *(const similarity_order_file* const*)rhs;
+    if (file_l->class_rank != file_r->class_rank) {
+        result = file_l->class_rank < file_r->class_rank ? -1 : 1;
+    } else {
+        result = similarity_order_compare_extension(
+            file_l->extension, file_r->extension);
+    }
+    if (result == 0 && file_l->index != file_r->index) {
+        result = file_l->index < file_r->index ? -1 : 1;
+    }
+    return result;
+}
+
+/**
+ * compare files by class rank, extension rank and index
+ */
+static int
+similarity_order_compare_rank(
+    const void* lhs,
+    const void* rhs)
+{
+    const similarity_order_file* file_l;
+    const similarity_order_file* file_r;
+    int result;
+    file_l = *(const similarity_order_file* const*)lhs;
+    file_r = *(const similarity_order_file* const*)rhs;
+    if (file_l->class_rank != file_r->class_rank) {
+        result = file_l->class_rank < file_r->class_rank ? -1 : 1;
+    } else if (file_l->extension_rank != file_r->extension_rank) {
+        result = file_l->extension_rank < file_r->extension_rank ? -1 : 1;
+    } else if (file_l->index != file_r->index) {
+        result = file_l->index < file_r->index ? -1 : 1;
+    } else {
+        result = 0;
+    }
+    return result;
+}
+
+/**
+ * allocate memory
+ */
+static void*
+similarity_order_mem_alloc(
+    size_t size)
+{
+    return malloc(size);
+}
+
+/**
+ * free memory
+ */
+static void
+similarity_order_mem_free(
+    void* heap_obj)
+{
+    free(heap_obj);
+}
+
+/* vi: se ts=4 sw=4 et: */
@@ -0,0 +1,37 @@
+#ifndef __SIMILARITY_ORDER_H__
+#define __SIMILARITY_ORDER_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+#define _SIMILARITY_ORDER_ITFC_BEGIN extern "C" {
+#define _SIMILARITY_ORDER_ITFC_END }
+#else
+#define _SIMILARITY_ORDER_ITFC_BEGIN
+#define _SIMILARITY_ORDER_ITFC_END
+#endif
+
+_SIMILARITY_ORDER_ITFC_BEGIN
+
+/**
+ * order files so that similar files are placed next to each other.
+ * Files having the same class are placed together and classes keep the order
+ * of their first file. In a class, files are clustered by file name
+ * extension and each cluster is ordered by similarity of minhash sketches
+ * of the contents. file_sizes[idx] is the size of the file at idx.
+ * Sketches are calculated in jobs threads.
+ * order gets indexes of files in the new order.
+ */
+int
+similarity_order_sort(
+    const char* const* file_paths,
+    const unsigned long long* file_sizes,
+    const size_t* classes,
+    size_t file_count,
+    unsigned int jobs,
+    size_t* order);
+
+_SIMILARITY_ORDER_ITFC_END
+
+/* vi: se ts=4 sw=4 et: */
+#endif
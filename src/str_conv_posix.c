@@ -0,0 +1,200 @@
+#include "str_conv.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+
+/**
+ * allocate heap memory
+ */
+void*
+str_conv_alloc(
+    size_t size);
+
+/**
+ * decode a code point from utf8 string
+ */
+static size_t
+str_conv_decode_utf8(
+    const unsigned char* utf8_str,
+    size_t size,
+    uint32_t* code_point);
+
+/**
+ * convert utf8 to utf16 string
+ */
+void*
+str_conv_utf8_to_utf16(
+    const char* utf8_str,
+    size_t size,
+    void* (*alloc_mem)(size_t),
+    void (*free_mem)(void*))
+{
+    void* result;
+    void* (*alloc_mem_0)(size_t);
+    uint16_t* buffer;
+    size_t idx;
+    size_t size_utf16;
+    const unsigned char* src;
+    result = NULL;
+    alloc_mem_0 = alloc_mem ? alloc_mem : str_conv_alloc;
+    src = (const unsigned char*)utf8_str;
+    size_utf16 = 0;
+    for (idx = 0; idx < size;) {
+        uint32_t code_point;
+        idx += str_conv_decode_utf8(&src[idx], size - idx, &code_point);
+        size_utf16 += code_point >= 0x10000 ? 2 : 1;
+    }
+    buffer = (uint16_t*)alloc_mem_0((size_utf16 ? size_utf16 : 1)
+        * sizeof(uint16_t));
+    if (buffer) {
+        size_t idx_utf16;
+        idx_utf16 = 0;
+        for (idx = 0; idx < size;) {
+            uint32_t code_point;
+            idx += str_conv_decode_utf8(&src[idx], size - idx, &code_point);
+            if (code_point >= 0x10000) {
+                code_point -= 0x10000;
+                buffer[idx_utf16++] = (uint16_t)(0xd800 | (code_point >> 10));
+                buffer[idx_utf16++] = (uint16_t)(0xdc00 | (code_point & 0x3ff));
+            } else {
+                buffer[idx_utf16++] = (uint16_t)code_point;
+            }
+        }
+        result = buffer;
+    }
+    return result;
+}
+
+/**
+ * convert utf16 to utf8 string
+ */
+char*
+str_conv_utf16_to_utf8(
+    const void* utf16_str,
+    size_t size,
+    void* (*alloc_mem)(size_t),
+    void (*free_mem)(void*))
+{
+    char* result;
+    void* (*alloc_mem_0)(size_t);
+    const uint16_t* src;
+    size_t idx;
+    size_t size_utf8;
+    unsigned char* buffer;
+    result = NULL;
+    alloc_mem_0 = alloc_mem ? alloc_mem : str_conv_alloc;
+    src = (const uint16_t*)utf16_str;
+    size_utf8 = 0;
+    for (idx = 0; idx < size; idx++) {
+        uint32_t code_point;
+        code_point = src[idx];
+        if ((code_point & 0xfc00) == 0xd800 && idx + 1 < size
+            && (src[idx + 1] & 0xfc00) == 0xdc00) {
+            size_utf8 += 4;
+            idx++;
+        } else if (code_point < 0x80) {
+            size_utf8 += 1;
+        } else if (code_point < 0x800) {
+            size_utf8 += 2;
+        } else {
+            size_utf8 += 3;
+        }
+    }
+    buffer = (unsigned char*)alloc_mem_0(size_utf8 ? size_utf8 : 1);
+    if (buffer) {
+        size_t idx_utf8;
+        idx_utf8 = 0;
+        for (idx = 0; idx < size; idx++) {
+            uint32_t code_point;
+            code_point = src[idx];
+            if ((code_point & 0xfc00) == 0xd800 && idx + 1 < size
+                && (src[idx + 1] & 0xfc00) == 0xdc00) {
+                code_point = 0x10000 + ((code_point & 0x3ff) << 10)
+                    + (src[idx + 1] & 0x3ff);
+                idx++;
+                buffer[idx_utf8++] = (unsigned char)(0xf0 | (code_point >> 18));
+                buffer[idx_utf8++] =
+                    (unsigned char)(0x80 | ((code_point >> 12) & 0x3f));
+                buffer[idx_utf8++] =
+                    (unsigned char)(0x80 | ((code_point >> 6) & 0x3f));
+                buffer[idx_utf8++] = (unsigned char)(0x80 | (code_point & 0x3f));
+            } else if (code_point < 0x80) {
+                buffer[idx_utf8++] = (unsigned char)code_point;
+            } else if (code_point < 0x800) {
+                buffer[idx_utf8++] = (unsigned char)(0xc0 | (code_point >> 6));
+                buffer[idx_utf8++] = (unsigned char)(0x80 | (code_point & 0x3f));
+            } else {
+                buffer[idx_utf8++] = (unsigned char)(0xe0 | (code_point >> 12));
+                buffer[idx_utf8++] =
+                    (unsigned char)(0x80 | ((code_point >> 6) & 0x3f));
+                buffer[idx_utf8++] = (unsigned char)(0x80 | (code_point & 0x3f));
+            }
+        }
+        result = (char*)buffer;
+    }
+    return result;
+}
+
+/**
+ * decode a code point from utf8 string
+ */
+static size_t
+str_conv_decode_utf8(
+    const unsigned char* utf8_str,
+    size_t size,
+    uint32_t* code_point)
+{
+    size_t result;
+    size_t length;
+    uint32_t value;
+    if ((utf8_str[0] & 0x80) == 0) {
+        length = 1;
+        value = utf8_str[0];
+    } else if ((utf8_str[0] & 0xe0) == 0xc0) {
+        length = 2;
+        value = utf8_str[0] & 0x1f;
+    } else if ((utf8_str[0] & 0xf0) == 0xe0) {
+        length = 3;
+        value = utf8_str[0] & 0x0f;
+    } else if ((utf8_str[0] & 0xf8) == 0xf0) {
+        length = 4;
+        value = utf8_str[0] & 0x07;
+    } else {
+        length = 1;
+        value = 0xfffd;
+    }
+    if (length <= size) {
+        size_t idx;
+        for (idx = 1; idx < length; idx++) {
+            value = (value << 6) | (utf8_str[idx] & 0x3f);
+        }
+        result = length;
+    } else {
+        value = 0xfffd;
+        result = size;
+    }
+    *code_point = value;
+    return result;
+}
+
+/**
+ * allocate heap memory
+ */
+void*
+str_conv_alloc(
+    size_t size)
+{
+    return malloc(size);
+}
+
+/**
+ * free heap object
+ */
+void
+str_conv_free(
+    void* heap_obj)
+{
+    free(heap_obj);
+}
+
+/* vi: se ts=4 sw=4 et: */
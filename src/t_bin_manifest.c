@@ -0,0 +1,226 @@
+#include "bin_manifest.h"
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * entries written into binary manifest
+ */
+static const struct {
+    /**
+     * source path
+     */
+    const char* source_path;
+
+    /**
+     * entry name
+     */
+    const char* entry_name;
+
+    /**
+     * compression code
+     */
+    int compression;
+
+    /**
+     * attribute
+     */
+    int attribute;
+
+    /**
+     * execute flag
+     */
+    int execute;
+
+    /**
+     * flush folder after the entry
+     */
+    int flush_folder;
+
+    /**
+     * flush cabinet after the entry
+     */
+    int flush_cabinet;
+} T_ENTRIES[] = {
+    { "/src/a.txt", "a.txt", 1, 0x20, 0, 0, 0 },
+    { "/src/dir/b.dll", "dir\\b.dll", 3 | (21 << 8), 0x01, 1, 1, 0 },
+    { "/src/a.txt", "dup\\a.txt", 1, 0, 0, 0, 1 },
+    { "/src/\xd0\x9f.txt", "\xd0\x9f\\\xf0\x9f\x98\x80.txt", 0, 0x80, 0, 1,
+        1 },
+    { "", "", -1, 0, 0, 0, 0 }
+};
+
+static int
+write_manifest(
+    size_t entry_count,
+    char** data,
+    size_t* size);
+
+static int
+check_records(
+    const bin_manifest* manifest,
+    size_t entry_count);
+
+/**
+ * write entries into binary manifest in temporary file and read it into
+ * memory
+ */
+static int
+write_manifest(
+    size_t entry_count,
+    char** data,
+    size_t* size)
+{
+    int result;
+    FILE* fs;
+    bin_manifest_writer* writer;
+    long file_size;
+    size_t idx;
+    *data = NULL;
+    *size = 0;
+    writer = NULL;
+    fs = tmpfile();
+    result = fs ? 0 : -1;
+    if (result == 0) {
+        writer = bin_manifest_writer_create(fs);
+        result = writer ? 0 : -1;
+    }
+    for (idx = 0; result == 0 && idx < entry_count; idx++) {
+        result = bin_manifest_writer_add(writer,
+            T_ENTRIES[idx].source_path, T_ENTRIES[idx].entry_name,
+            T_ENTRIES[idx].compression, T_ENTRIES[idx].attribute,
+            T_ENTRIES[idx].execute, T_ENTRIES[idx].flush_folder,
+            T_ENTRIES[idx].flush_cabinet);
+    }
+    if (result == 0) {
+        result = bin_manifest_writer_finish(writer);
+    }
+    file_size = -1;
+    if (result == 0 && fseek(fs, 0, SEEK_END) == 0) {
+        file_size = ftell(fs);
+    }
+    if (result == 0) {
+        result = file_size > 0 && fseek(fs, 0, SEEK_SET) == 0 ? 0 : -1;
+    }
+    if (result == 0) {
+        /* allocated memory is aligned like mapped memory */
+        *data = (char*)malloc((size_t)file_size);
+        result = *data ? 0 : -1;
+    }
+    if (result == 0) {
+        *size = fread(*data, 1, (size_t)file_size, fs);
+        result = *size == (size_t)file_size ? 0 : -1;
+    }
+    if (writer) {
+        bin_manifest_writer_free(writer);
+    }
+    if (fs) {
+        fclose(fs);
+    }
+    return result;
+}
+
+/**
+ * compare records in manifest with the entries
+ */
+static int
+check_records(
+    const bin_manifest* manifest,
+    size_t entry_count)
+{
+    int result;
+    size_t idx;
+    result = manifest->record_count == entry_count ? 0 : -1;
+    for (idx = 0; result == 0 && idx < entry_count; idx++) {
+        const bin_manifest_record* record;
+        const char* source_path;
+        const char* entry_name;
+        record = &manifest->records[idx];
+        source_path = bin_manifest_get_str(manifest, record->source_offset);
+        entry_name = bin_manifest_get_str(manifest, record->name_offset);
+        if (!source_path || !entry_name
+            || strcmp(source_path, T_ENTRIES[idx].source_path)
+            || strcmp(entry_name, T_ENTRIES[idx].entry_name)
+            || record->compression != T_ENTRIES[idx].compression
+            || record->attribute != T_ENTRIES[idx].attribute
+            || record->execute != T_ENTRIES[idx].execute
+            || record->flush_folder != T_ENTRIES[idx].flush_folder
+            || record->flush_cabinet != T_ENTRIES[idx].flush_cabinet) {
+            result = -1;
+        }
+    }
+    return result;
+}
+
+int
+main(
+    int argc,
+    char** argv)
+{
+    int result;
+    char* data;
+    size_t size;
+    char* empty_data;
+    size_t empty_size;
+    bin_manifest manifest;
+    size_t entry_count;
+    int state;
+    (void)argc;
+    (void)argv;
+    result = 0;
+    entry_count = sizeof(T_ENTRIES) / sizeof(T_ENTRIES[0]);
+    printf("1..7\n");
+
+    state = write_manifest(entry_count, &data, &size);
+    printf("%s 1 write\n", state == 0 ? "ok" : "not ok");
+    result |= state;
+
+    state = data && bin_manifest_is_manifest(data, size)
+        && bin_manifest_open(data, size, &manifest) == 0 ? 0 : -1;
+    printf("%s 2 open\n", state == 0 ? "ok" : "not ok");
+    result |= state;
+
+    if (state == 0) {
+        state = check_records(&manifest, entry_count);
+    }
+    printf("%s 3 records\n", state == 0 ? "ok" : "not ok");
+    result |= state;
+
+    if (state == 0) {
+        state = !bin_manifest_get_str(&manifest, manifest.strings_size)
+            && !bin_manifest_get_str(&manifest, (uint64_t)-1) ? 0 : -1;
+    }
+    printf("%s 4 string out of table\n", state == 0 ? "ok" : "not ok");
+    result |= state;
+
+    state = data && bin_manifest_open(data, size - 1, &manifest) != 0
+        && bin_manifest_open(data, sizeof(bin_manifest_header) - 1,
+            &manifest) != 0 ? 0 : -1;
+    printf("%s 5 truncated manifest\n", state == 0 ? "ok" : "not ok");
+    result |= state;
+
+    state = !bin_manifest_is_manifest("/src/a.txt,a.txt,MSZIP,0\n", 25)
+        && bin_manifest_open("CABXMN", 6, &manifest) != 0 ? 0 : -1;
+    printf("%s 6 csv is not manifest\n", state == 0 ? "ok" : "not ok");
+    result |= state;
+
+    state = write_manifest(0, &empty_data, &empty_size);
+    if (state == 0) {
+        state = bin_manifest_open(empty_data, empty_size, &manifest);
+    }
+    if (state == 0) {
+        state = check_records(&manifest, 0);
+    }
+    printf("%s 7 empty manifest\n", state == 0 ? "ok" : "not ok");
+    result |= state;
+
+    if (empty_data) {
+        free(empty_data);
+    }
+    if (data) {
+        free(data);
+    }
+    return result;
+}
+/* vi: se ts=4 sw=4 et: */
@@ -0,0 +1,231 @@
+#include "cab_checksum.h"
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+
+static int
+test_cross_check(
+    unsigned int kernel,
+    const uint8_t* data,
+    size_t data_size);
+
+static int
+run_cross_check(
+    void);
+
+static int
+run_benchmark(
+    size_t data_size);
+
+static uint32_t
+next_random(
+    uint32_t* state);
+
+static void
+fill_random(
+    uint8_t* data,
+    size_t data_size,
+    uint32_t seed);
+
+/**
+ * compare the kernel with scalar kernel on random blocks
+ */
+static int
+test_cross_check(
+    unsigned int kernel,
+    const uint8_t* data,
+    size_t data_size)
+{
+    int result;
+    uint32_t state;
+    unsigned int idx;
+    result = 0;
+    state = 0x12345678;
+    /* every small size and offset to exercise head and tail handling */
+    for (idx = 0; result == 0 && idx < 256 * 64; idx++) {
+        size_t offset;
+        size_t size;
+        uint32_t seed;
+        offset = idx % 64;
+        size = idx / 64;
+        seed = next_random(&state);
+        if (cab_checksum_compute_kernel(kernel, data + offset, size, seed)
+            != cab_checksum_compute_kernel(CAB_CHECKSUM_KERNEL_SCALAR,
+                data + offset, size, seed)) {
+            result = -1;
+        }
+    }
+    /* random blocks up to the size of CFDATA */
+    for (idx = 0; result == 0 && idx < 4096; idx++) {
+        size_t offset;
+        size_t size;
+        uint32_t seed;
+        offset = next_random(&state) % 64;
+        size = next_random(&state) % (32768 + 6144 + 1);
+        if (offset + size > data_size) {
+            size = data_size - offset;
+        }
+        seed = next_random(&state);
+        if (cab_checksum_compute_kernel(kernel, data + offset, size, seed)
+            != cab_checksum_compute_kernel(CAB_CHECKSUM_KERNEL_SCALAR,
+                data + offset, size, seed)) {
+            result = -1;
+        }
+    }
+    return result;
+}
+
+/**
+ * run cross check for all kernels
+ */
+static int
+run_cross_check(
+    void)
+{
+    int result;
+    uint8_t* data;
+    size_t data_size;
+    unsigned int kernel;
+    data_size = 32768 + 6144 + 64;
+    data = (uint8_t*)malloc(data_size);
+    result = data ? 0 : -1;
+    if (result == 0) {
+        fill_random(data, data_size, 1);
+        printf("1..%d\n", CAB_CHECKSUM_KERNEL_COUNT);
+        for (kernel = 0; kernel < CAB_CHECKSUM_KERNEL_COUNT; kernel++) {
+            if (cab_checksum_is_supported(kernel)) {
+                if (test_cross_check(kernel, data, data_size) == 0) {
+                    printf("ok %u %s\n", kernel + 1,
+                        cab_checksum_get_kernel_name(kernel));
+                } else {
+                    printf("not ok %u %s\n", kernel + 1,
+                        cab_checksum_get_kernel_name(kernel));
+                    result = -1;
+                }
+            } else {
+                printf("ok %u %s # SKIP not supported\n", kernel + 1,
+                    cab_checksum_get_kernel_name(kernel));
+            }
+        }
+    }
+    if (data) {
+        free(data);
+    }
+    return result;
+}
+
+/**
+ * measure throughput of kernels
+ */
+static int
+run_benchmark(
+    size_t data_size)
+{
+    int result;
+    uint8_t* data;
+    unsigned int kernel;
+    data = (uint8_t*)malloc(data_size);
+    result = data ? 0 : -1;
+    if (result == 0) {
+        fill_random(data, data_size, 2);
+    }
+    for (kernel = 0; result == 0 && kernel < CAB_CHECKSUM_KERNEL_COUNT;
+        kernel++) {
+        clock_t start;
+        clock_t elapsed;
+        size_t processed;
+        uint32_t checksum;
+        volatile uint32_t sink;
+        if (!cab_checksum_is_supported(kernel)) {
+            printf("%-8s not supported\n",
+                cab_checksum_get_kernel_name(kernel));
+            continue;
+        }
+        processed = 0;
+        sink = 0;
+        checksum = cab_checksum_compute_kernel(kernel, data, data_size, 0);
+        start = clock();
+        do {
+            size_t offset;
+            /* checksum is computed for each CFDATA block */
+            for (offset = 0; offset < data_size; offset += 32768) {
+                size_t size;
+                size = data_size - offset < 32768 ?
+                    data_size - offset : 32768;
+                sink = cab_checksum_compute_kernel(kernel,
+                    data + offset, size, 0);
+            }
+            processed += data_size;
+            elapsed = clock() - start;
+        } while (elapsed < CLOCKS_PER_SEC);
+        (void)sink;
+        printf("%-8s %8.2f GB/s (%08x)\n",
+            cab_checksum_get_kernel_name(kernel),
+            (double)processed / 1e9
+                / ((double)elapsed / CLOCKS_PER_SEC),
+            checksum);
+    }
+    if (data) {
+        free(data);
+    }
+    return result;
+}
+
+static uint32_t
+next_random(
+    uint32_t* state)
+{
+    uint32_t value;
+    value = *state;
+    value ^= value << 13;
+    value ^= value >> 17;
+    value ^= value << 5;
+    *state = value;
+    return value;
+}
+
+static void
+fill_random(
+    uint8_t* data,
+    size_t data_size,
+    uint32_t seed)
+{
+    size_t idx;
+    uint32_t state;
+    state = 0x9e3779b9 ^ seed;
+    for (idx = 0; idx < data_size; idx++) {
+        data[idx] = (uint8_t)next_random(&state);
+    }
+}
+
+int
+main(
+    int argc,
+    char** argv)
+{
+    int result;
+    int benchmark;
+    size_t data_size;
+    int idx;
+    benchmark = 0;
+    data_size = 16 * 1024 * 1024;
+    for (idx = 1; idx < argc; idx++) {
+        if (strcmp("-b", argv[idx]) == 0) {
+            benchmark = 1;
+            if (idx < argc - 1) {
+                idx++;
+                data_size = (size_t)strtoul(argv[idx], NULL, 10) * 1024;
+            }
+        }
+    }
+    if (benchmark) {
+        result = run_benchmark(data_size ? data_size : 1);
+    } else {
+        result = run_cross_check();
+    }
+    return result;
+}
+/* vi: se ts=4 sw=4 et: */
@@ -0,0 +1,278 @@
+#include "cab_compressor.h"
+#include "cab_decompressor.h"
+#include "cab_lzx.h"
+#include "fci_compat.h"
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * lzx compression type
+ */
+#define T_LZX(window, match_finder, verbatim) \
+    (tcompTYPE_LZX | ((window) << tcompSHIFT_LZX_WINDOW) \
+    | ((CAB_LZX_MATCH_FINDER_ ## match_finder) \
+        << CAB_COMPRESSOR_LZX_MATCH_FINDER_SHIFT) \
+    | ((verbatim) ? CAB_COMPRESSOR_LZX_VERBATIM : 0))
+
+/**
+ * mszip compression type
+ */
+#define T_MSZIP(preset) \
+    CAB_COMPRESSOR_TYPE_WITH_PRESET(tcompTYPE_MSZIP, \
+        CAB_COMPRESSOR_PRESET_ ## preset)
+
+/**
+ * size of the test input. It is more than 64 KB and is not multiple of
+ * the block size, so that matches cross blocks and the last block is
+ * short.
+ */
+#define T_INPUT_SIZE (5 * 32768 + 12345)
+
+/**
+ * compression types to be tested
+ */
+static const struct {
+    /**
+     * name shown in test result
+     */
+    const char* name;
+
+    /**
+     * compression type
+     */
+    unsigned int type;
+} T_TYPES[] = {
+    { "NONE", tcompTYPE_NONE },
+    { "MSZIP", T_MSZIP(DEFAULT) },
+    { "MSZIP:FAST", T_MSZIP(FAST) },
+    { "MSZIP:NORMAL", T_MSZIP(NORMAL) },
+    { "MSZIP:HIGH", T_MSZIP(HIGH) },
+    { "MSZIP:MAX", T_MSZIP(MAX) },
+    { "LZX:15:HC", T_LZX(15, HASH_CHAIN, 0) },
+    { "LZX:15:BT", T_LZX(15, BINARY_TREE, 0) },
+    { "LZX:15:HC:VERBATIM", T_LZX(15, HASH_CHAIN, 1) },
+    { "LZX:15:BT:VERBATIM", T_LZX(15, BINARY_TREE, 1) },
+    { "LZX:16:HC", T_LZX(16, HASH_CHAIN, 0) },
+    { "LZX:16:BT", T_LZX(16, BINARY_TREE, 0) },
+    { "LZX:16:HC:VERBATIM", T_LZX(16, HASH_CHAIN, 1) },
+    { "LZX:16:BT:VERBATIM", T_LZX(16, BINARY_TREE, 1) },
+    { "LZX:21:HC", T_LZX(21, HASH_CHAIN, 0) },
+    { "LZX:21:BT", T_LZX(21, BINARY_TREE, 0) },
+    { "LZX:21:HC:VERBATIM", T_LZX(21, HASH_CHAIN, 1) },
+    { "LZX:21:BT:VERBATIM", T_LZX(21, BINARY_TREE, 1) },
+    { "LZX:21:FAST",
+        CAB_COMPRESSOR_TYPE_WITH_PRESET(T_LZX(21, DEFAULT, 0),
+            CAB_COMPRESSOR_PRESET_FAST) },
+    { "LZX:21:HIGH",
+        CAB_COMPRESSOR_TYPE_WITH_PRESET(T_LZX(21, DEFAULT, 0),
+            CAB_COMPRESSOR_PRESET_HIGH) },
+    { "LZX:21:MAX",
+        CAB_COMPRESSOR_TYPE_WITH_PRESET(T_LZX(21, DEFAULT, 0),
+            CAB_COMPRESSOR_PRESET_MAX) }
+};
+
+static int
+test_round_trip(
+    unsigned int type,
+    const uint8_t* data,
+    size_t data_size,
+    size_t* compressed_size);
+
+static void
+fill_input(
+    uint8_t* data,
+    size_t data_size);
+
+static uint32_t
+next_random(
+    uint32_t* state);
+
+/**
+ * compress the data in blocks as a folder, decompress the blocks and
+ * compare them with the data.
+ */
+static int
+test_round_trip(
+    unsigned int type,
+    const uint8_t* data,
+    size_t data_size,
+    size_t* compressed_size)
+{
+    int result;
+    cab_compressor* compressor;
+    cab_decompressor* decompressor;
+    uint8_t* compressed;
+    uint8_t* decompressed;
+    compressor = cab_compressor_create(type);
+    decompressor = cab_decompressor_create(
+        cab_compressor_get_folder_type(type));
+    compressed = (uint8_t*)malloc(CAB_COMPRESSOR_MAX_COMPRESSED_SIZE);
+    decompressed = (uint8_t*)malloc(CAB_COMPRESSOR_BLOCK_SIZE);
+    result = compressor && decompressor && compressed && decompressed ?
+        0 : -1;
+    *compressed_size = 0;
+    if (result == 0) {
+        size_t offset;
+        for (offset = 0; offset < data_size;
+            offset += CAB_COMPRESSOR_BLOCK_SIZE) {
+            unsigned int block_size;
+            unsigned int size;
+            block_size = data_size - offset < CAB_COMPRESSOR_BLOCK_SIZE ?
+                (unsigned int)(data_size - offset)
+                : CAB_COMPRESSOR_BLOCK_SIZE;
+            size = 0;
+            result = cab_compressor_compress(compressor, data + offset,
+                block_size, compressed, &size);
+            if (result == 0 && size > CAB_COMPRESSOR_MAX_COMPRESSED_SIZE) {
+                result = -1;
+            }
+            if (result == 0) {
+                result = cab_decompressor_decompress(decompressor,
+                    compressed, size, decompressed, block_size);
+            }
+            if (result == 0
+                && memcmp(decompressed, data + offset, block_size)) {
+                result = -1;
+            }
+            if (result) {
+                fprintf(stderr, "block at %lu is broken\n",
+                    (unsigned long)offset);
+                break;
+            }
+            *compressed_size += size;
+        }
+    }
+    if (decompressed) {
+        free(decompressed);
+    }
+    if (compressed) {
+        free(compressed);
+    }
+    if (decompressor) {
+        cab_decompressor_free(decompressor);
+    }
+    if (compressor) {
+        cab_compressor_free(compressor);
+    }
+    return result;
+}
+
+/**
+ * fill the input with text like words, runs longer than any match,
+ * random bytes and slightly changed copies of earlier parts at near and
+ * far distances.
+ */
+static void
+fill_input(
+    uint8_t* data,
+    size_t data_size)
+{
+    static const char* words[] = {
+        "cabinet ", "folder ", "file ", "data ", "block ", "window ",
+        "match ", "length ", "distance ", "tree ", "chain ", "huffman\n"
+    };
+    size_t idx;
+    uint32_t state;
+    state = 0x9e3779b9;
+    idx = 0;
+    while (idx < data_size) {
+        size_t size;
+        uint32_t kind;
+        kind = next_random(&state) % 8;
+        size = 1 + next_random(&state) % 4096;
+        if (size > data_size - idx) {
+            size = data_size - idx;
+        }
+        if (kind < 3) {
+            size_t end;
+            end = idx + size;
+            while (idx < end) {
+                const char* word;
+                size_t word_size;
+                word = words[next_random(&state)
+                    % (sizeof(words) / sizeof(words[0]))];
+                word_size = strlen(word);
+                if (word_size > end - idx) {
+                    word_size = end - idx;
+                }
+                memcpy(data + idx, word, word_size);
+                idx += word_size;
+            }
+        } else if (kind == 3) {
+            memset(data + idx, (int)(next_random(&state) & 0xff), size);
+            idx += size;
+        } else if (kind == 4) {
+            size_t end;
+            end = idx + size;
+            while (idx < end) {
+                data[idx++] = (uint8_t)next_random(&state);
+            }
+        } else if (idx > 0) {
+            size_t distance;
+            size_t end;
+            distance = 1 + next_random(&state) % idx;
+            end = idx + size;
+            while (idx < end) {
+                data[idx] = data[idx - distance];
+                /* near copies make long matches with different tails */
+                if (next_random(&state) % 64 == 0) {
+                    data[idx] ^= 1;
+                }
+                idx++;
+            }
+        }
+    }
+}
+
+static uint32_t
+next_random(
+    uint32_t* state)
+{
+    uint32_t value;
+    value = *state;
+    value ^= value << 13;
+    value ^= value >> 17;
+    value ^= value << 5;
+    *state = value;
+    return value;
+}
+
+int
+main(
+    int argc,
+    char** argv)
+{
+    int result;
+    uint8_t* data;
+    unsigned int idx;
+    unsigned int count;
+    (void)argc;
+    (void)argv;
+    count = sizeof(T_TYPES) / sizeof(T_TYPES[0]);
+    data = (uint8_t*)malloc(T_INPUT_SIZE);
+    result = data ? 0 : -1;
+    if (result == 0) {
+        fill_input(data, T_INPUT_SIZE);
+        printf("1..%u\n", count);
+        for (idx = 0; idx < count; idx++) {
+            size_t compressed_size;
+            if (test_round_trip(T_TYPES[idx].type, data, T_INPUT_SIZE,
+                &compressed_size) == 0) {
+                printf("ok %u %s %lu -> %lu\n", idx + 1, T_TYPES[idx].name,
+                    (unsigned long)T_INPUT_SIZE,
+                    (unsigned long)compressed_size);
+            } else {
+                printf("not ok %u %s\n", idx + 1, T_TYPES[idx].name);
+                result = -1;
+            }
+        }
+    }
+    if (data) {
+        free(data);
+    }
+    return result;
+}
+/* vi: se ts=4 sw=4 et: */
@@ -0,0 +1,198 @@
+#include "csv_stream.h"
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * size of buffer to join read rows
+ */
+#define T_ROWS_SIZE 1024
+
+/**
+ * csv inputs and rows to be read from them. In expected rows, cells are
+ * separated by '|' and each row ends with ';'.
+ */
+static const struct {
+    /**
+     * name shown in test result
+     */
+    const char* name;
+
+    /**
+     * csv input
+     */
+    const char* input;
+
+    /**
+     * expected rows
+     */
+    const char* rows;
+} T_CASES[] = {
+    { "empty input", "", "" },
+    { "plain cells", "a,b,c\nd,e,f\n", "a|b|c;d|e|f;" },
+    { "no final newline", "a,b\nc,d", "a|b;c|d;" },
+    { "empty cells", ",a,,\n", "|a||;" },
+    { "empty line", "a\n\nb\n", "a;;b;" },
+    { "crlf", "a,b\r\nc,d\r\n", "a|b;c|d;" },
+    { "crlf without final newline", "a\r\nb", "a;b;" },
+    { "cr in cell", "a\rb,c\n", "a\rb|c;" },
+    { "quoted cells", "\"a\",\"b,c\"\n", "a|b,c;" },
+    { "empty quoted cell", "\"\",a\n", "|a;" },
+    { "doubled quotes", "\"a\"\"b\",\"\"\"\"\n", "a\"b|\";" },
+    { "quote in unquoted cell", "a\"b,c\n", "a\"b|c;" },
+    { "embedded newline", "\"a\nb\",c\nd\n", "a\nb|c;d;" },
+    { "embedded crlf", "\"a\r\nb\"\r\nc\r\n", "a\r\nb;c;" },
+    { "quoted cell at end of input", "a,\"b\"", "a|b;" },
+    { "text after closing quote", "\"a\"b,c\n", "ab|c;" },
+    { "source and entry", "C:\\src\\a.txt,dir\\a.txt,MSZIP,0\n",
+        "C:\\src\\a.txt|dir\\a.txt|MSZIP|0;" }
+};
+
+static int
+read_rows(
+    csv_stream* stream,
+    char* rows,
+    size_t rows_size);
+
+static int
+test_memory(
+    const char* input,
+    const char* expected);
+
+static int
+test_stream(
+    const char* input,
+    const char* expected);
+
+/**
+ * read all rows and join them in expected rows format
+ */
+static int
+read_rows(
+    csv_stream* stream,
+    char* rows,
+    size_t rows_size)
+{
+    int result;
+    size_t rows_length;
+    result = stream ? 0 : -1;
+    rows_length = 0;
+    rows[0] = '\0';
+    while (result == 0) {
+        const char* const* cells;
+        size_t cell_count;
+        size_t idx;
+        int state;
+        state = csv_stream_read_row(stream, &cells, &cell_count);
+        if (state <= 0) {
+            result = state;
+            break;
+        }
+        for (idx = 0; result == 0 && idx < cell_count; idx++) {
+            size_t length;
+            length = strlen(cells[idx]);
+            if (rows_length + length + 2 < rows_size) {
+                memcpy(rows + rows_length, cells[idx], length);
+                rows_length += length;
+                rows[rows_length++] = idx + 1 < cell_count ? '|' : ';';
+                rows[rows_length] = '\0';
+            } else {
+                result = -1;
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ * read rows from the memory
+ */
+static int
+test_memory(
+    const char* input,
+    const char* expected)
+{
+    int result;
+    csv_stream* stream;
+    char rows[T_ROWS_SIZE];
+    stream = csv_stream_create_1(input, strlen(input));
+    result = read_rows(stream, rows, sizeof(rows));
+    if (result == 0 && strcmp(rows, expected)) {
+        result = -1;
+    }
+    if (stream) {
+        csv_stream_free(stream);
+    }
+    return result;
+}
+
+/**
+ * read rows from the stream. The stream is read line by line, so that
+ * quoted cells continue over the reads.
+ */
+static int
+test_stream(
+    const char* input,
+    const char* expected)
+{
+    int result;
+    FILE* fs;
+    csv_stream* stream;
+    char rows[T_ROWS_SIZE];
+    stream = NULL;
+    fs = tmpfile();
+    result = fs ? 0 : -1;
+    if (result == 0) {
+        size_t length;
+        length = strlen(input);
+        if (fwrite(input, 1, length, fs) != length || fseek(fs, 0, SEEK_SET)) {
+            result = -1;
+        }
+    }
+    if (result == 0) {
+        stream = csv_stream_create(fs);
+        result = read_rows(stream, rows, sizeof(rows));
+    }
+    if (result == 0 && strcmp(rows, expected)) {
+        result = -1;
+    }
+    if (stream) {
+        csv_stream_free(stream);
+    }
+    if (fs) {
+        fclose(fs);
+    }
+    return result;
+}
+
+int
+main(
+    int argc,
+    char** argv)
+{
+    int result;
+    unsigned int idx;
+    unsigned int count;
+    (void)argc;
+    (void)argv;
+    result = 0;
+    count = sizeof(T_CASES) / sizeof(T_CASES[0]);
+    printf("1..%u\n", count * 2);
+    for (idx = 0; idx < count; idx++) {
+        if (test_memory(T_CASES[idx].input, T_CASES[idx].rows) == 0) {
+            printf("ok %u memory: %s\n", idx * 2 + 1, T_CASES[idx].name);
+        } else {
+            printf("not ok %u memory: %s\n", idx * 2 + 1, T_CASES[idx].name);
+            result = -1;
+        }
+        if (test_stream(T_CASES[idx].input, T_CASES[idx].rows) == 0) {
+            printf("ok %u stream: %s\n", idx * 2 + 2, T_CASES[idx].name);
+        } else {
+            printf("not ok %u stream: %s\n", idx * 2 + 2, T_CASES[idx].name);
+            result = -1;
+        }
+    }
+    return result;
+}
+/* vi: se ts=4 sw=4 et: */
@@ -0,0 +1,170 @@
+#include "path.h"
+#include "dir_walker.h"
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * size of buffer to join walked paths
+ */
+#define T_PATHS_SIZE 1024
+
+/**
+ * glob patterns and paths
+ */
+static const struct {
+    /**
+     * glob pattern
+     */
+    const char* pattern;
+
+    /**
+     * path to be matched
+     */
+    const char* path;
+
+    /**
+     * expected result
+     */
+    int match;
+} T_GLOBS[] = {
+    { "*.txt", "a.txt", 1 },
+    { "*.txt", "dir/a.txt", 1 },
+    { "*.txt", "dir\\a.txt", 1 },
+    { "*.txt", "a.txt.bak", 0 },
+    { "*.TXT", "a.txt", 0 },
+    { "a*", "dir/b", 0 },
+    { "dir/*.txt", "dir/a.txt", 1 },
+    { "dir/*.txt", "dir/sub/a.txt", 0 },
+    { "dir/*.txt", "other/a.txt", 0 },
+    { "dir\\*.txt", "dir/a.txt", 1 },
+    { "dir/*.txt", "dir\\a.txt", 1 },
+    { "src/*/*.c", "src/lib/a.c", 1 },
+    { "src/*/*.c", "src/a.c", 0 },
+    { "dir/**/*.txt", "dir/a.txt", 1 },
+    { "dir/**/*.txt", "dir/sub/deep/a.txt", 1 },
+    { "dir/**/*.txt", "other/sub/a.txt", 0 },
+    { "dir/**", "dir/sub/a.txt", 1 },
+    { "**/a.txt", "a.txt", 1 },
+    { "**/a.txt", "x/y/a.txt", 1 },
+    { "dir/a?c", "dir/abc", 1 },
+    { "dir/a?c", "dir/ac", 0 },
+    { "dir/a?c", "dir/a/c", 0 },
+    { "[a-c]*.h", "b.h", 1 },
+    { "[a-c]*.h", "d.h", 0 },
+    { "[!a-c]*.h", "b.h", 0 },
+    { "[!a-c]*.h", "d.h", 1 },
+    { "[xyz].c", "y.c", 1 },
+    { "dir/[ab]/*", "dir/b/c", 1 }
+};
+
+/**
+ * files created by test script in the directory given to this test
+ */
+static const char* T_WALK_FILES =
+    "a.txt;b/c.txt;b/d/e.c;b/d/f.txt;b0.txt;g/h.c;";
+
+static int
+test_walk(
+    const char* root_dir,
+    unsigned int thread_count,
+    const char* pattern,
+    const char* expected);
+
+/**
+ * walk the directory tree and compare the relative paths matching the
+ * pattern with expected paths. Each expected path ends with ';'.
+ */
+static int
+test_walk(
+    const char* root_dir,
+    unsigned int thread_count,
+    const char* pattern,
+    const char* expected)
+{
+    int result;
+    dir_walker* walker;
+    char paths[T_PATHS_SIZE];
+    size_t paths_length;
+    walker = dir_walker_create(root_dir, thread_count);
+    result = walker ? 0 : -1;
+    paths_length = 0;
+    paths[0] = '\0';
+    while (result == 0) {
+        const char* file_path;
+        const char* relative_path;
+        int state;
+        state = dir_walker_next(walker, &file_path, &relative_path);
+        if (state <= 0) {
+            result = state;
+            break;
+        }
+        if (path_match_glob(pattern, relative_path)) {
+            size_t length;
+            length = strlen(relative_path);
+            if (paths_length + length + 2 < sizeof(paths)) {
+                memcpy(paths + paths_length, relative_path, length);
+                paths_length += length;
+                paths[paths_length++] = ';';
+                paths[paths_length] = '\0';
+            } else {
+                result = -1;
+            }
+        }
+    }
+    if (result == 0 && strcmp(paths, expected)) {
+        fprintf(stderr, "%s: %s\n", pattern, paths);
+        result = -1;
+    }
+    if (walker) {
+        dir_walker_free(walker);
+    }
+    return result;
+}
+
+int
+main(
+    int argc,
+    char** argv)
+{
+    int result;
+    unsigned int idx;
+    unsigned int count;
+    result = 0;
+    count = sizeof(T_GLOBS) / sizeof(T_GLOBS[0]);
+    printf("1..%u\n", count + (argc > 1 ? 3 : 0));
+    for (idx = 0; idx < count; idx++) {
+        if ((path_match_glob(T_GLOBS[idx].pattern, T_GLOBS[idx].path) != 0)
+            == T_GLOBS[idx].match) {
+            printf("ok %u %s %s\n", idx + 1,
+                T_GLOBS[idx].pattern, T_GLOBS[idx].path);
+        } else {
+            printf("not ok %u %s %s\n", idx + 1,
+                T_GLOBS[idx].pattern, T_GLOBS[idx].path);
+            result = -1;
+        }
+    }
+    if (argc > 1) {
+        if (test_walk(argv[1], 0, "*", T_WALK_FILES) == 0) {
+            printf("ok %u walk\n", count + 1);
+        } else {
+            printf("not ok %u walk\n", count + 1);
+            result = -1;
+        }
+        if (test_walk(argv[1], 2, "*", T_WALK_FILES) == 0) {
+            printf("ok %u walk in threads\n", count + 2);
+        } else {
+            printf("not ok %u walk in threads\n", count + 2);
+            result = -1;
+        }
+        if (test_walk(argv[1], 2, "b/**/*.txt", "b/c.txt;b/d/f.txt;") == 0) {
+            printf("ok %u walk with glob\n", count + 3);
+        } else {
+            printf("not ok %u walk with glob\n", count + 3);
+            result = -1;
+        }
+    }
+    return result;
+}
+/* vi: se ts=4 sw=4 et: */
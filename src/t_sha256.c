@@ -0,0 +1,152 @@
+#include "sha256.h"
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * known answer vectors. The message is the text repeated count times.
+ */
+static const struct {
+    /**
+     * name shown in test result
+     */
+    const char* name;
+
+    /**
+     * text of message
+     */
+    const char* text;
+
+    /**
+     * count of repeating the text
+     */
+    size_t count;
+
+    /**
+     * expected digest in hex
+     */
+    const char* digest;
+} T_VECTORS[] = {
+    { "empty", "", 1,
+        "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" },
+    { "abc", "abc", 1,
+        "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" },
+    { "448 bits",
+        "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 1,
+        "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" },
+    { "896 bits",
+        "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmn"
+        "hijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu", 1,
+        "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1" },
+    { "55 bytes", "a", 55,
+        "9f4390f8d30c2dd92ec9f095b65e2b9ae9b0a925a5258e241c9f1e910f734318" },
+    { "56 bytes", "a", 56,
+        "b35439a4ac6f0948b6d6f9e3c6af0f5f590ce20f1bde7090ef7970686ec6738a" },
+    { "64 bytes", "a", 64,
+        "ffe054fe7ae0cb6dc65c3af9b61d5209f439851db43d0ba5997337df154668eb" },
+    { "million a", "a", 1000000,
+        "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0" }
+};
+
+static int
+test_vector(
+    const char* text,
+    size_t count,
+    const char* expected,
+    int split);
+
+/**
+ * calculate digest of the text repeated count times and compare it with
+ * expected digest. If split is not zero, the message is appended in
+ * pieces of various sizes instead of the text.
+ */
+static int
+test_vector(
+    const char* text,
+    size_t count,
+    const char* expected,
+    int split)
+{
+    int result;
+    unsigned char* message;
+    size_t text_size;
+    size_t message_size;
+    sha256_context ctx;
+    unsigned char digest[SHA256_DIGEST_SIZE];
+    char digest_hex[SHA256_DIGEST_SIZE * 2 + 1];
+    size_t idx;
+    text_size = strlen(text);
+    message_size = text_size * count;
+    message = (unsigned char*)malloc(message_size + 1);
+    result = message ? 0 : -1;
+    if (result == 0) {
+        for (idx = 0; idx < count; idx++) {
+            memcpy(message + text_size * idx, text, text_size);
+        }
+        sha256_init(&ctx);
+        if (split) {
+            size_t offset;
+            size_t piece_size;
+            offset = 0;
+            piece_size = 0;
+            while (offset < message_size) {
+                /* pieces cross the block boundary at every position */
+                piece_size = piece_size % 97 + 1;
+                if (piece_size > message_size - offset) {
+                    piece_size = message_size - offset;
+                }
+                sha256_update(&ctx, message + offset, piece_size);
+                offset += piece_size;
+            }
+        } else {
+            for (idx = 0; idx < count; idx++) {
+                sha256_update(&ctx, message + text_size * idx, text_size);
+            }
+        }
+        sha256_final(&ctx, digest);
+        for (idx = 0; idx < SHA256_DIGEST_SIZE; idx++) {
+            sprintf(digest_hex + idx * 2, "%02x", digest[idx]);
+        }
+        if (strcmp(digest_hex, expected)) {
+            result = -1;
+        }
+    }
+    if (message) {
+        free(message);
+    }
+    return result;
+}
+
+int
+main(
+    int argc,
+    char** argv)
+{
+    int result;
+    unsigned int idx;
+    unsigned int count;
+    (void)argc;
+    (void)argv;
+    result = 0;
+    count = sizeof(T_VECTORS) / sizeof(T_VECTORS[0]);
+    printf("1..%u\n", count * 2);
+    for (idx = 0; idx < count; idx++) {
+        int split;
+        for (split = 0; split < 2; split++) {
+            unsigned int number;
+            number = idx * 2 + split + 1;
+            if (test_vector(T_VECTORS[idx].text, T_VECTORS[idx].count,
+                T_VECTORS[idx].digest, split) == 0) {
+                printf("ok %u %s%s\n", number, T_VECTORS[idx].name,
+                    split ? " in pieces" : "");
+            } else {
+                printf("not ok %u %s%s\n", number, T_VECTORS[idx].name,
+                    split ? " in pieces" : "");
+                result = -1;
+            }
+        }
+    }
+    return result;
+}
+/* vi: se ts=4 sw=4 et: */
@@ -0,0 +1,335 @@
+#include "temp_store.h"
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+/**
+ * size of segment in temporary file store
+ */
+#define T_SEGMENT_SIZE 0x10000
+
+/**
+ * max size of temporary file in test
+ */
+#define T_FILE_SIZE (T_SEGMENT_SIZE * 6)
+
+/**
+ * temporary file and the contents expected in it
+ */
+typedef struct _t_file t_file;
+
+/**
+ * temporary file and the contents expected in it
+ */
+struct _t_file {
+    /**
+     * path of the file on disk if the file is moved
+     */
+    const char* path;
+
+    /**
+     * opened file
+     */
+    temp_store_file* file;
+
+    /**
+     * expected contents
+     */
+    unsigned char* contents;
+
+    /**
+     * expected size
+     */
+    size_t size;
+};
+
+static int
+t_file_open(
+    t_file* obj,
+    temp_store* store,
+    const char* path);
+
+static void
+t_file_close(
+    t_file* obj,
+    temp_store* store);
+
+static int
+t_file_write(
+    t_file* obj,
+    size_t offset,
+    size_t size,
+    unsigned int seed);
+
+static int
+t_file_check(
+    t_file* obj);
+
+static int
+is_on_disk(
+    const char* path);
+
+/**
+ * register the path and open it
+ */
+static int
+t_file_open(
+    t_file* obj,
+    temp_store* store,
+    const char* path)
+{
+    int result;
+    remove(path);
+    obj->path = path;
+    obj->size = 0;
+    obj->file = NULL;
+    obj->contents = (unsigned char*)malloc(T_FILE_SIZE);
+    result = obj->contents ? 0 : -1;
+    if (result == 0) {
+        memset(obj->contents, 0, T_FILE_SIZE);
+        result = temp_store_register(store, path);
+    }
+    if (result == 0) {
+        obj->file = temp_store_open(store, path, 1);
+        result = obj->file ? 0 : -1;
+    }
+    return result;
+}
+
+/**
+ * close and unregister the file, and remove the file on disk
+ */
+static void
+t_file_close(
+    t_file* obj,
+    temp_store* store)
+{
+    if (obj->file) {
+        temp_store_close(obj->file);
+        obj->file = NULL;
+    }
+    if (obj->path) {
+        temp_store_remove(store, obj->path);
+        remove(obj->path);
+        obj->path = NULL;
+    }
+    if (obj->contents) {
+        free(obj->contents);
+        obj->contents = NULL;
+    }
+}
+
+/**
+ * write pattern at the offset in pieces of various sizes
+ */
+static int
+t_file_write(
+    t_file* obj,
+    size_t offset,
+    size_t size,
+    unsigned int seed)
+{
+    int result;
+    size_t idx;
+    size_t piece_size;
+    for (idx = 0; idx < size; idx++) {
+        obj->contents[offset + idx] = (unsigned char)(seed + idx * 7);
+    }
+    result = temp_store_seek(obj->file, (long)offset, SEEK_SET)
+        == (long)offset ? 0 : -1;
+    piece_size = 0;
+    for (idx = 0; result == 0 && idx < size; idx += piece_size) {
+        /* pieces cross the segment boundary at various positions */
+        piece_size = (idx * 13 + 4093) % 9973 + 1;
+        if (piece_size > size - idx) {
+            piece_size = size - idx;
+        }
+        result = temp_store_write(obj->file, obj->contents + offset + idx,
+            piece_size);
+    }
+    if (offset + size > obj->size) {
+        obj->size = offset + size;
+    }
+    return result;
+}
+
+/**
+ * read whole file and compare it with expected contents
+ */
+static int
+t_file_check(
+    t_file* obj)
+{
+    int result;
+    unsigned char* buffer;
+    size_t read_size;
+    buffer = (unsigned char*)malloc(T_FILE_SIZE + 1);
+    result = buffer ? 0 : -1;
+    read_size = 0;
+    if (result == 0) {
+        result = temp_store_seek(obj->file, 0, SEEK_SET) == 0 ? 0 : -1;
+    }
+    while (result == 0) {
+        size_t size;
+        size = 0;
+        result = temp_store_read(obj->file, buffer + read_size,
+            T_FILE_SIZE + 1 - read_size, &size);
+        if (result || !size) {
+            break;
+        }
+        read_size += size;
+    }
+    if (result == 0 && (read_size != obj->size
+        || memcmp(buffer, obj->contents, obj->size))) {
+        result = -1;
+    }
+    if (buffer) {
+        free(buffer);
+    }
+    return result;
+}
+
+/**
+ * you get non zero if the file exists on disk
+ */
+static int
+is_on_disk(
+    const char* path)
+{
+    FILE* fs;
+    fs = fopen(path, "rb");
+    if (fs) {
+        fclose(fs);
+    }
+    return fs != NULL;
+}
+
+int
+main(
+    int argc,
+    char** argv)
+{
+    int result;
+    temp_store* store;
+    temp_store* disk_store;
+    t_file file_a;
+    t_file file_b;
+    t_file file_c;
+    t_file file_d;
+    int state;
+    (void)argc;
+    (void)argv;
+    result = 0;
+    memset(&file_a, 0, sizeof(file_a));
+    memset(&file_b, 0, sizeof(file_b));
+    memset(&file_c, 0, sizeof(file_c));
+    memset(&file_d, 0, sizeof(file_d));
+    store = temp_store_create(T_SEGMENT_SIZE * 4);
+    disk_store = temp_store_create(0);
+    printf("1..7\n");
+
+    state = store ? t_file_open(&file_a, store, "t-temp-store.a") : -1;
+    if (state == 0) {
+        state = t_file_write(&file_a, 0, T_SEGMENT_SIZE * 3 - 100, 1);
+    }
+    if (state == 0) {
+        state = t_file_check(&file_a);
+    }
+    if (state == 0 && is_on_disk(file_a.path)) {
+        state = -1;
+    }
+    printf("%s 1 file in budget is kept in memory\n",
+        state == 0 ? "ok" : "not ok");
+    result |= state;
+
+    state = store ? t_file_open(&file_b, store, "t-temp-store.b") : -1;
+    if (state == 0) {
+        state = t_file_write(&file_b, 0, T_SEGMENT_SIZE + 10, 2);
+    }
+    if (state == 0) {
+        state = t_file_check(&file_b);
+    }
+    if (state == 0 && !is_on_disk(file_b.path)) {
+        state = -1;
+    }
+    printf("%s 2 file exceeding budget is moved to disk\n",
+        state == 0 ? "ok" : "not ok");
+    result |= state;
+
+    if (state == 0) {
+        state = t_file_write(&file_b, T_SEGMENT_SIZE * 2, 5000, 3);
+    }
+    if (state == 0) {
+        state = t_file_write(&file_b, 100, T_SEGMENT_SIZE, 4);
+    }
+    if (state == 0) {
+        state = t_file_check(&file_b);
+    }
+    printf("%s 3 moved file is written after gap and overwritten\n",
+        state == 0 ? "ok" : "not ok");
+    result |= state;
+
+    state = file_a.file ? t_file_write(&file_a, T_SEGMENT_SIZE * 2,
+        T_SEGMENT_SIZE, 5) : -1;
+    if (state == 0) {
+        state = t_file_check(&file_a);
+    }
+    if (state == 0 && is_on_disk(file_a.path)) {
+        state = -1;
+    }
+    printf("%s 4 file is rewritten in reserved segments\n",
+        state == 0 ? "ok" : "not ok");
+    result |= state;
+
+    t_file_close(&file_a, store);
+    state = store ? t_file_open(&file_c, store, "t-temp-store.c") : -1;
+    if (state == 0) {
+        state = t_file_write(&file_c, 1000, T_SEGMENT_SIZE * 3, 6);
+    }
+    if (state == 0) {
+        state = t_file_check(&file_c);
+    }
+    if (state == 0 && is_on_disk(file_c.path)) {
+        state = -1;
+    }
+    printf("%s 5 removed file releases budget\n",
+        state == 0 ? "ok" : "not ok");
+    result |= state;
+
+    state = disk_store ? t_file_open(&file_d, disk_store, "t-temp-store.d")
+        : -1;
+    if (state == 0) {
+        state = t_file_write(&file_d, 0, 10, 7);
+    }
+    if (state == 0) {
+        state = t_file_check(&file_d);
+    }
+    if (state == 0 && !is_on_disk(file_d.path)) {
+        state = -1;
+    }
+    printf("%s 6 zero budget keeps files on disk\n",
+        state == 0 ? "ok" : "not ok");
+    result |= state;
+
+    errno = 0;
+    state = store && !temp_store_open(store, "t-temp-store.x", 0)
+        && errno == ENOENT ? 0 : -1;
+    printf("%s 7 unregistered file is not opened\n",
+        state == 0 ? "ok" : "not ok");
+    result |= state;
+
+    t_file_close(&file_d, disk_store);
+    t_file_close(&file_c, store);
+    t_file_close(&file_b, store);
+    t_file_close(&file_a, store);
+    if (disk_store) {
+        temp_store_free(disk_store);
+    }
+    if (store) {
+        temp_store_free(store);
+    }
+    return result;
+}
+/* vi: se ts=4 sw=4 et: */
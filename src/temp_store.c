@@ -0,0 +1,776 @@
+#include "temp_store.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <limits.h>
+#include "thread_i.h"
+#include "file_i.h"
+
+/**
+ * size of segment holding file data
+ */
+#define TEMP_STORE_SEGMENT_SIZE 0x10000
+
+/**
+ * temporary file data
+ */
+typedef struct _temp_store_entry temp_store_entry;
+
+/**
+ * temporary file data
+ */
+struct _temp_store_entry {
+    /**
+     * file path
+     */
+    char* file_path;
+
+    /**
+     * count of opened files
+     */
+    unsigned int ref_count;
+
+    /**
+     * not zero if the entry was removed from store
+     */
+    int removed;
+
+    /**
+     * segments holding data
+     */
+    unsigned char** segments;
+
+    /**
+     * count of segments
+     */
+    size_t segment_count;
+
+    /**
+     * capacity of segments array
+     */
+    size_t segment_capacity;
+
+    /**
+     * file size
+     */
+    size_t size;
+
+    /**
+     * stream on disk. NULL while the data is held in memory.
+     */
+    FILE* stream;
+
+    /**
+     * next entry
+     */
+    temp_store_entry* next;
+};
+
+/**
+ * temporary file store
+ */
+struct _temp_store {
+    /**
+     * lock for entries and used size
+     */
+    thread_i_mutex* lock;
+
+    /**
+     * memory budget
+     */
+    size_t budget;
+
+    /**
+     * size of allocated segments
+     */
+    size_t used;
+
+    /**
+     * registered entries
+     */
+    temp_store_entry* entries;
+};
+
+/**
+ * opened temporary file
+ */
+struct _temp_store_file {
+    /**
+     * store
+     */
+    temp_store* store;
+
+    /**
+     * file data
+     */
+    temp_store_entry* entry;
+
+    /**
+     * current position
+     */
+    size_t position;
+};
+
+/**
+ * find entry by path. You have to lock the store.
+ */
+static temp_store_entry*
+temp_store_find(
+    temp_store* obj,
+    const char* file_path,
+    temp_store_entry*** link);
+
+/**
+ * allocate segments to hold data to the end.
+ * You get 1 if the segments exceed memory budget.
+ */
+static int
+temp_store_entry_reserve(
+    temp_store* obj,
+    temp_store_entry* entry,
+    size_t end);
+
+/**
+ * move data into the file on disk
+ */
+static int
+temp_store_entry_spill(
+    temp_store* obj,
+    temp_store_entry* entry);
+
+/**
+ * copy data into segments. The range is filled with zero if data is NULL.
+ */
+static void
+temp_store_entry_copy_in(
+    temp_store_entry* entry,
+    size_t offset,
+    const void* data,
+    size_t size);
+
+/**
+ * release data of entry
+ */
+static int
+temp_store_entry_clear(
+    temp_store* obj,
+    temp_store_entry* entry);
+
+/**
+ * free entry
+ */
+static void
+temp_store_entry_free(
+    temp_store* obj,
+    temp_store_entry* entry);
+
+/**
+ * allocate memory
+ */
+static void*
+temp_store_mem_alloc(
+    size_t size);
+
+/**
+ * free memory
+ */
+static void
+temp_store_mem_free(
+    void* heap_obj);
+
+/**
+ * create temporary file store with memory budget in bytes
+ */
+temp_store*
+temp_store_create(
+    size_t budget)
+{
+    temp_store* result;
+    result = (temp_store*)temp_store_mem_alloc(sizeof(temp_store));
+    if (result) {
+        memset(result, 0, sizeof(*result));
+        result->budget = budget;
+        result->lock = thread_i_mutex_create();
+        if (!result->lock) {
+            temp_store_mem_free(result);
+            result = NULL;
+        }
+    }
+    return result;
+}
+
+/**
+ * free temporary file store and all files in it.
+ */
+void
+temp_store_free(
+    temp_store* obj)
+{
+    if (obj) {
+        while (obj->entries) {
+            temp_store_entry* entry;
+            entry = obj->entries;
+            obj->entries = entry->next;
+            temp_store_entry_free(obj, entry);
+        }
+        thread_i_mutex_free(obj->lock);
+        temp_store_mem_free(obj);
+    }
+}
+
+/**
+ * register the path as temporary file held in memory.
+ */
+int
+temp_store_register(
+    temp_store* obj,
+    const char* file_path)
+{
+    int result;
+    temp_store_entry* entry;
+    entry = NULL;
+    if (obj && file_path) {
+        entry = (temp_store_entry*)temp_store_mem_alloc(
+            sizeof(temp_store_entry));
+        result = entry ? 0 : -1;
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    if (result == 0) {
+        size_t path_size;
+        memset(entry, 0, sizeof(*entry));
+        path_size = strlen(file_path) + 1;
+        entry->file_path = (char*)temp_store_mem_alloc(path_size);
+        result = entry->file_path ? 0 : -1;
+        if (result == 0) {
+            memcpy(entry->file_path, file_path, path_size);
+        }
+    }
+    if (result == 0) {
+        thread_i_mutex_lock(obj->lock);
+        result = temp_store_find(obj, file_path, NULL) ? -1 : 0;
+        if (result == 0) {
+            entry->next = obj->entries;
+            obj->entries = entry;
+            entry = NULL;
+        } else {
+            errno = EEXIST;
+        }
+        thread_i_mutex_unlock(obj->lock);
+    }
+    if (entry) {
+        temp_store_entry_free(obj, entry);
+    }
+    return result;
+}
+
+/**
+ * open temporary file registered in store.
+ */
+temp_store_file*
+temp_store_open(
+    temp_store* obj,
+    const char* file_path,
+    int truncate)
+{
+    temp_store_file* result;
+    temp_store_entry* entry;
+    result = NULL;
+    entry = NULL;
+    if (obj && file_path) {
+        result = (temp_store_file*)temp_store_mem_alloc(
+            sizeof(temp_store_file));
+    } else {
+        errno = EINVAL;
+    }
+    if (result) {
+        thread_i_mutex_lock(obj->lock);
+        entry = temp_store_find(obj, file_path, NULL);
+        if (entry) {
+            entry->ref_count++;
+        }
+        thread_i_mutex_unlock(obj->lock);
+        if (!entry) {
+            temp_store_mem_free(result);
+            result = NULL;
+            errno = ENOENT;
+        }
+    }
+    if (result) {
+        result->store = obj;
+        result->entry = entry;
+        result->position = 0;
+        if (truncate) {
+            temp_store_entry_clear(obj, entry);
+        }
+    }
+    return result;
+}
+
+/**
+ * read data from current position
+ */
+int
+temp_store_read(
+    temp_store_file* file,
+    void* buffer,
+    size_t buffer_size,
+    size_t* read_size)
+{
+    int result;
+    size_t size;
+    temp_store_entry* entry;
+    size = 0;
+    if (file && (buffer || !buffer_size)) {
+        entry = file->entry;
+        result = 0;
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    if (result == 0) {
+        if (file->position < entry->size) {
+            size = entry->size - file->position;
+            if (size > buffer_size) {
+                size = buffer_size;
+            }
+        }
+        if (entry->stream) {
+            if (size) {
+                result = fseek(entry->stream, (long)file->position, SEEK_SET);
+            }
+            if (result == 0 && size) {
+                size = fread(buffer, 1, size, entry->stream);
+                if (ferror(entry->stream)) {
+                    clearerr(entry->stream);
+                    result = -1;
+                }
+            }
+        } else {
+            size_t offset;
+            size_t copied;
+            offset = file->position;
+            copied = 0;
+            while (copied < size) {
+                size_t seg_offset;
+                size_t length;
+                seg_offset = offset % TEMP_STORE_SEGMENT_SIZE;
+                length = TEMP_STORE_SEGMENT_SIZE - seg_offset;
+                if (length > size - copied) {
+                    length = size - copied;
+                }
+                memcpy((unsigned char*)buffer + copied,
+                    entry->segments[offset / TEMP_STORE_SEGMENT_SIZE]
+                        + seg_offset,
+                    length);
+                copied += length;
+                offset += length;
+            }
+        }
+    }
+    if (result == 0) {
+        file->position += size;
+    } else {
+        size = 0;
+    }
+    if (read_size) {
+        *read_size = size;
+    }
+    return result;
+}
+
+/**
+ * write data at current position
+ */
+int
+temp_store_write(
+    temp_store_file* file,
+    const void* data,
+    size_t size)
+{
+    int result;
+    size_t end;
+    temp_store_entry* entry;
+    if (file && (data || !size)) {
+        entry = file->entry;
+        end = file->position + size;
+        result = end >= file->position ? 0 : -1;
+        if (result) {
+            errno = EFBIG;
+        }
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    if (result == 0 && !entry->stream) {
+        result = temp_store_entry_reserve(file->store, entry, end);
+        if (result > 0) {
+            result = temp_store_entry_spill(file->store, entry);
+        }
+    }
+    if (result == 0) {
+        if (entry->stream) {
+            result = fseek(entry->stream, (long)file->position, SEEK_SET);
+            if (result == 0) {
+                result = fwrite(data, 1, size, entry->stream) == size ?
+                    0 : -1;
+            }
+        } else {
+            if (file->position > entry->size) {
+                temp_store_entry_copy_in(entry, entry->size, NULL,
+                    file->position - entry->size);
+            }
+            temp_store_entry_copy_in(entry, file->position, data, size);
+        }
+    }
+    if (result == 0) {
+        file->position = end;
+        if (entry->size < end) {
+            entry->size = end;
+        }
+    }
+    return result;
+}
+
+/**
+ * move current position. You get new position or -1 if error.
+ */
+long
+temp_store_seek(
+    temp_store_file* file,
+    long dist,
+    int seek_type)
+{
+    long result;
+    long base;
+    result = -1;
+    base = -1;
+    if (file) {
+        switch (seek_type) {
+        case SEEK_SET:
+            base = 0;
+            break;
+        case SEEK_CUR:
+            base = (long)file->position;
+            break;
+        case SEEK_END:
+            base = (long)file->entry->size;
+            break;
+        default:
+            break;
+        }
+    }
+    if (base >= 0) {
+        if (dist < 0 ? base + dist >= 0 : dist <= LONG_MAX - base) {
+            result = base + dist;
+            file->position = (size_t)result;
+        }
+    }
+    if (result < 0) {
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * close temporary file
+ */
+int
+temp_store_close(
+    temp_store_file* file)
+{
+    int result;
+    if (file) {
+        temp_store_entry* entry;
+        entry = NULL;
+        thread_i_mutex_lock(file->store->lock);
+        file->entry->ref_count--;
+        if (file->entry->removed && !file->entry->ref_count) {
+            entry = file->entry;
+        }
+        thread_i_mutex_unlock(file->store->lock);
+        if (entry) {
+            temp_store_entry_free(file->store, entry);
+        }
+        temp_store_mem_free(file);
+        result = 0;
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * unregister temporary file.
+ */
+int
+temp_store_remove(
+    temp_store* obj,
+    const char* file_path)
+{
+    int result;
+    temp_store_entry* entry;
+    entry = NULL;
+    if (obj && file_path) {
+        temp_store_entry** link;
+        thread_i_mutex_lock(obj->lock);
+        entry = temp_store_find(obj, file_path, &link);
+        if (entry) {
+            *link = entry->next;
+            entry->next = NULL;
+            entry->removed = 1;
+            if (entry->ref_count) {
+                entry = NULL;
+            }
+            result = 0;
+        } else {
+            result = -1;
+            errno = ENOENT;
+        }
+        thread_i_mutex_unlock(obj->lock);
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    if (entry) {
+        temp_store_entry_free(obj, entry);
+    }
+    return result;
+}
+
+/**
+ * find entry by path. You have to lock the store.
+ */
+static temp_store_entry*
+temp_store_find(
+    temp_store* obj,
+    const char* file_path,
+    temp_store_entry*** link)
+{
+    temp_store_entry** entry_ref;
+    entry_ref = &obj->entries;
+    while (*entry_ref) {
+        if (strcmp((*entry_ref)->file_path, file_path) == 0) {
+            break;
+        }
+        entry_ref = &(*entry_ref)->next;
+    }
+    if (link) {
+        *link = entry_ref;
+    }
+    return *entry_ref;
+}
+
+/**
+ * allocate segments to hold data to the end.
+ * You get 1 if the segments exceed memory budget.
+ */
+static int
+temp_store_entry_reserve(
+    temp_store* obj,
+    temp_store_entry* entry,
+    size_t end)
+{
+    int result;
+    size_t segment_count;
+    size_t reserved;
+    segment_count = end / TEMP_STORE_SEGMENT_SIZE
+        + (end % TEMP_STORE_SEGMENT_SIZE ? 1 : 0);
+    result = 0;
+    reserved = 0;
+    if (segment_count > entry->segment_capacity) {
+        size_t capacity;
+        unsigned char** segments;
+        capacity = entry->segment_capacity ? entry->segment_capacity : 16;
+        while (capacity < segment_count) {
+            capacity *= 2;
+        }
+        segments = (unsigned char**)temp_store_mem_alloc(
+            sizeof(unsigned char*) * capacity);
+        result = segments ? 0 : -1;
+        if (result == 0) {
+            if (entry->segment_count) {
+                memcpy(segments, entry->segments,
+                    sizeof(unsigned char*) * entry->segment_count);
+            }
+            if (entry->segments) {
+                temp_store_mem_free(entry->segments);
+            }
+            entry->segments = segments;
+            entry->segment_capacity = capacity;
+        }
+    }
+    if (result == 0 && segment_count > entry->segment_count) {
+        reserved = (segment_count - entry->segment_count)
+            * TEMP_STORE_SEGMENT_SIZE;
+        thread_i_mutex_lock(obj->lock);
+        if (obj->budget - obj->used >= reserved) {
+            obj->used += reserved;
+        } else {
+            result = 1;
+        }
+        thread_i_mutex_unlock(obj->lock);
+    }
+    if (result == 0) {
+        while (entry->segment_count < segment_count) {
+            unsigned char* segment;
+            segment = (unsigned char*)temp_store_mem_alloc(
+                TEMP_STORE_SEGMENT_SIZE);
+            if (!segment) {
+                result = -1;
+                break;
+            }
+            entry->segments[entry->segment_count++] = segment;
+            reserved -= TEMP_STORE_SEGMENT_SIZE;
+        }
+        if (reserved) {
+            thread_i_mutex_lock(obj->lock);
+            obj->used -= reserved;
+            thread_i_mutex_unlock(obj->lock);
+        }
+    }
+    return result;
+}
+
+/**
+ * move data into the file on disk
+ */
+static int
+temp_store_entry_spill(
+    temp_store* obj,
+    temp_store_entry* entry)
+{
+    int result;
+    FILE* stream;
+    stream = file_i_fopen(entry->file_path, "w+b");
+    result = stream ? 0 : -1;
+    if (result == 0) {
+        size_t offset;
+        offset = 0;
+        while (result == 0 && offset < entry->size) {
+            size_t length;
+            length = entry->size - offset;
+            if (length > TEMP_STORE_SEGMENT_SIZE) {
+                length = TEMP_STORE_SEGMENT_SIZE;
+            }
+            if (fwrite(entry->segments[offset / TEMP_STORE_SEGMENT_SIZE],
+                1, length, stream) != length) {
+                result = -1;
+            }
+            offset += length;
+        }
+    }
+    if (result == 0) {
+        size_t size;
+        size = entry->size;
+        temp_store_entry_clear(obj, entry);
+        entry->size = size;
+        entry->stream = stream;
+    } else if (stream) {
+        fclose(stream);
+    }
+    return result;
+}
+
+/**
+ * copy data into segments. The range is filled with zero if data is NULL.
+ */
+static void
+temp_store_entry_copy_in(
+    temp_store_entry* entry,
+    size_t offset,
+    const void* data,
+    size_t size)
+{
+    size_t copied;
+    copied = 0;
+    while (copied < size) {
+        size_t seg_offset;
+        size_t length;
+        unsigned char* dst;
+        seg_offset = offset % TEMP_STORE_SEGMENT_SIZE;
+        length = TEMP_STORE_SEGMENT_SIZE - seg_offset;
+        if (length > size - copied) {
+            length = size - copied;
+        }
+        dst = entry->segments[offset / TEMP_STORE_SEGMENT_SIZE] + seg_offset;
+        if (data) {
+            memcpy(dst, (const unsigned char*)data + copied, length);
+        } else {
+            memset(dst, 0, length);
+        }
+        copied += length;
+        offset += length;
+    }
+}
+
+/**
+ * release data of entry
+ */
+static int
+temp_store_entry_clear(
+    temp_store* obj,
+    temp_store_entry* entry)
+{
+    int result;
+    size_t idx;
+    result = 0;
+    for (idx = 0; idx < entry->segment_count; idx++) {
+        temp_store_mem_free(entry->segments[idx]);
+    }
+    if (entry->segment_count) {
+        thread_i_mutex_lock(obj->lock);
+        obj->used -= entry->segment_count * TEMP_STORE_SEGMENT_SIZE;
+        thread_i_mutex_unlock(obj->lock);
+        entry->segment_count = 0;
+    }
+    if (entry->stream) {
+        result = fclose(entry->stream);
+        entry->stream = NULL;
+    }
+    entry->size = 0;
+    return result;
+}
+
+/**
+ * free entry
+ */
+static void
+temp_store_entry_free(
+    temp_store* obj,
+    temp_store_entry* entry)
+{
+    temp_store_entry_clear(obj, entry);
+    if (entry->segments) {
+        temp_store_mem_free(entry->segments);
+    }
+    if (entry->file_path) {
+        temp_store_mem_free(entry->file_path);
+    }
+    temp_store_mem_free(entry);
+}
+
+/**
+ * allocate memory
+ */
+static void*
+temp_store_mem_alloc(
+    size_t size)
+{
+    return malloc(size);
+}
+
+/**
+ * free memory
+ */
+static void
+temp_store_mem_free(
+    void* heap_obj)
+{
+    free(heap_obj);
+}
+
+/* vi: se ts=4 sw=4 et: */
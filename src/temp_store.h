@@ -0,0 +1,113 @@
+#ifndef __TEMP_STORE_H__
+#define __TEMP_STORE_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+#define _TEMP_STORE_ITFC_BEGIN extern "C" {
+#define _TEMP_STORE_ITFC_END }
+#else
+#define _TEMP_STORE_ITFC_BEGIN
+#define _TEMP_STORE_ITFC_END
+#endif
+
+_TEMP_STORE_ITFC_BEGIN
+
+/**
+ * temporary files kept in memory.
+ * The data of files are held in fixed size segments. When the total size
+ * of segments would exceed the memory budget, the file being written is
+ * moved into the file on disk at the same path.
+ */
+typedef struct _temp_store temp_store;
+
+/**
+ * opened temporary file in store
+ */
+typedef struct _temp_store_file temp_store_file;
+
+/**
+ * create temporary file store with memory budget in bytes
+ */
+temp_store*
+temp_store_create(
+    size_t budget);
+
+/**
+ * free temporary file store and all files in it.
+ * You have to close all opened files before calling this.
+ */
+void
+temp_store_free(
+    temp_store* obj);
+
+/**
+ * register the path as temporary file held in memory.
+ */
+int
+temp_store_register(
+    temp_store* obj,
+    const char* file_path);
+
+/**
+ * open temporary file registered in store.
+ * You get NULL and errno is ENOENT if the path is not registered.
+ * The file gets empty if truncate is not zero.
+ * Each opened file has its own position, and an opened file must not be
+ * used from different threads at the same time.
+ */
+temp_store_file*
+temp_store_open(
+    temp_store* obj,
+    const char* file_path,
+    int truncate);
+
+/**
+ * read data from current position
+ */
+int
+temp_store_read(
+    temp_store_file* file,
+    void* buffer,
+    size_t buffer_size,
+    size_t* read_size);
+
+/**
+ * write data at current position
+ */
+int
+temp_store_write(
+    temp_store_file* file,
+    const void* data,
+    size_t size);
+
+/**
+ * move current position. You get new position or -1 if error.
+ */
+long
+temp_store_seek(
+    temp_store_file* file,
+    long dist,
+    int seek_type);
+
+/**
+ * close temporary file
+ */
+int
+temp_store_close(
+    temp_store_file* file);
+
+/**
+ * unregister temporary file. The memory is released after the last opened
+ * file is closed. You get -1 and errno is ENOENT if the path is not
+ * registered. The file on disk is not removed.
+ */
+int
+temp_store_remove(
+    temp_store* obj,
+    const char* file_path);
+
+_TEMP_STORE_ITFC_END
+
+/* vi: se ts=4 sw=4 et: */
+#endif
@@ -0,0 +1,125 @@
+#ifndef __THREAD_I_H__
+#define __THREAD_I_H__
+
+#ifdef __cplusplus
+#define _THREAD_I_ITFC_BEGIN extern "C" {
+#define _THREAD_I_ITFC_END }
+#else
+#define _THREAD_I_ITFC_BEGIN
+#define _THREAD_I_ITFC_END
+#endif
+
+_THREAD_I_ITFC_BEGIN
+
+/**
+ * thread
+ */
+typedef struct _thread_i_thread thread_i_thread;
+
+/**
+ * mutual exclusion lock
+ */
+typedef struct _thread_i_mutex thread_i_mutex;
+
+/**
+ * condition variable
+ */
+typedef struct _thread_i_cond thread_i_cond;
+
+/**
+ * start new thread which runs the procedure with the argument
+ */
+thread_i_thread*
+thread_i_thread_create(
+    void (*run)(void*),
+    void* arg);
+
+/**
+ * wait for the thread to be finished and free the thread
+ */
+int
+thread_i_thread_join(
+    thread_i_thread* thread);
+
+/**
+ * create mutex
+ */
+thread_i_mutex*
+thread_i_mutex_create();
+
+/**
+ * free mutex
+ */
+void
+thread_i_mutex_free(
+    thread_i_mutex* mutex);
+
+/**
+ * lock mutex
+ */
+void
+thread_i_mutex_lock(
+    thread_i_mutex* mutex);
+
+/**
+ * unlock mutex
+ */
+void
+thread_i_mutex_unlock(
+    thread_i_mutex* mutex);
+
+/**
+ * create condition variable
+ */
+thread_i_cond*
+thread_i_cond_create();
+
+/**
+ * free condition variable
+ */
+void
+thread_i_cond_free(
+    thread_i_cond* cond);
+
+/**
+ * release locked mutex and wait for the condition to be signaled
+ */
+void
+thread_i_cond_wait(
+    thread_i_cond* cond,
+    thread_i_mutex* mutex);
+
+/**
+ * release locked mutex and wait for the condition to be signaled at most
+ * the milliseconds. You get -1 and errno is ETIMEDOUT if the time passed.
+ */
+int
+thread_i_cond_timed_wait(
+    thread_i_cond* cond,
+    thread_i_mutex* mutex,
+    unsigned int millisec);
+
+/**
+ * wake a thread waiting for the condition
+ */
+void
+thread_i_cond_signal(
+    thread_i_cond* cond);
+
+/**
+ * wake all threads waiting for the condition
+ */
+void
+thread_i_cond_broadcast(
+    thread_i_cond* cond);
+
+/**
+ * get count of processors available
+ */
+unsigned int
+thread_i_get_processor_count();
+
+_THREAD_I_ITFC_END
+
+/* vi: se ts=4 sw=4 et: */
+#endif
@@ -0,0 +1,275 @@
+#include "thread_i.h"
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+
+/**
+ * thread
+ */
+struct _thread_i_thread {
+    /**
+     * thread handle
+     */
+    pthread_t handle;
+
+    /**
+     * procedure run in the thread
+     */
+    void (*run)(void*);
+
+    /**
+     * argument for the procedure
+     */
+    void* arg;
+};
+
+/**
+ * mutual exclusion lock
+ */
+struct _thread_i_mutex {
+    /**
+     * mutex
+     */
+    pthread_mutex_t mutex;
+};
+
+/**
+ * condition variable
+ */
+struct _thread_i_cond {
+    /**
+     * condition variable
+     */
+    pthread_cond_t cond;
+};
+
+/**
+ * thread entry point
+ */
+static void*
+thread_i_thread_start(
+    void* arg);
+
+/**
+ * start new thread which runs the procedure with the argument
+ */
+thread_i_thread*
+thread_i_thread_create(
+    void (*run)(void*),
+    void* arg)
+{
+    thread_i_thread* result;
+    result = NULL;
+    if (run) {
+        result = (thread_i_thread*)malloc(sizeof(thread_i_thread));
+    } else {
+        errno = EINVAL;
+    }
+    if (result) {
+        int state;
+        result->run = run;
+        result->arg = arg;
+        state = pthread_create(&result->handle, NULL,
+            thread_i_thread_start, result);
+        if (state) {
+            free(result);
+            result = NULL;
+            errno = state;
+        }
+    }
+    return result;
+}
+
+/**
+ * wait for the thread to be finished and free the thread
+ */
+int
+thread_i_thread_join(
+    thread_i_thread* thread)
+{
+    int result;
+    if (thread) {
+        result = pthread_join(thread->handle, NULL);
+        if (result) {
+            errno = result;
+            result = -1;
+        }
+        free(thread);
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * create mutex
+ */
+thread_i_mutex*
+thread_i_mutex_create()
+{
+    thread_i_mutex* result;
+    result = (thread_i_mutex*)malloc(sizeof(thread_i_mutex));
+    if (result) {
+        int state;
+        state = pthread_mutex_init(&result->mutex, NULL);
+        if (state) {
+            free(result);
+            result = NULL;
+            errno = state;
+        }
+    }
+    return result;
+}
+
+/**
+ * free mutex
+ */
+void
+thread_i_mutex_free(
+    thread_i_mutex* mutex)
+{
+    if (mutex) {
+        pthread_mutex_destroy(&mutex->mutex);
+        free(mutex);
+    }
+}
+
+/**
+ * lock mutex
+ */
+void
+thread_i_mutex_lock(
+    thread_i_mutex* mutex)
+{
+    pthread_mutex_lock(&mutex->mutex);
+}
+
+/**
+ * unlock mutex
+ */
+void
+thread_i_mutex_unlock(
+    thread_i_mutex* mutex)
+{
+    pthread_mutex_unlock(&mutex->mutex);
+}
+
+/**
+ * create condition variable
+ */
+thread_i_cond*
+thread_i_cond_create()
+{
+    thread_i_cond* result;
+    result = (thread_i_cond*)malloc(sizeof(thread_i_cond));
+    if (result) {
+        int state;
+        state = pthread_cond_init(&result->cond, NULL);
+        if (state) {
+            free(result);
+            result = NULL;
+            errno = state;
+        }
+    }
+    return result;
+}
+
+/**
+ * free condition variable
+ */
+void
+thread_i_cond_free(
+    thread_i_cond* cond)
+{
+    if (cond) {
+        pthread_cond_destroy(&cond->cond);
+        free(cond);
+    }
+}
+
+/**
+ * release locked mutex and wait for the condition to be signaled
+ */
+void
+thread_i_cond_wait(
+    thread_i_cond* cond,
+    thread_i_mutex* mutex)
+{
+    pthread_cond_wait(&cond->cond, &mutex->mutex);
+}
+
+/**
+ * release locked mutex and wait for the condition to be signaled at most
+ * the milliseconds.
+ */
+int
+thread_i_cond_timed_wait(
+    thread_i_cond* cond,
+    thread_i_mutex* mutex,
+    unsigned int millisec)
+{
+    int result;
+    struct timespec abs_time;
+    clock_gettime(CLOCK_REALTIME, &abs_time);
+    abs_time.tv_sec += millisec / 1000;
+    abs_time.tv_nsec += (long)(millisec % 1000) * 1000000L;
+    if (abs_time.tv_nsec >= 1000000000L) {
+        abs_time.tv_sec++;
+        abs_time.tv_nsec -= 1000000000L;
+    }
+    result = pthread_cond_timedwait(&cond->cond, &mutex->mutex, &abs_time);
+    if (result) {
+        errno = result;
+        result = -1;
+    }
+    return result;
+}
+
+/**
+ * wake a thread waiting for the condition
+ */
+void
+thread_i_cond_signal(
+    thread_i_cond* cond)
+{
+    pthread_cond_signal(&cond->cond);
+}
+
+/**
+ * wake all threads waiting for the condition
+ */
+void
+thread_i_cond_broadcast(
+    thread_i_cond* cond)
+{
+    pthread_cond_broadcast(&cond->cond);
+}
+
+/**
+ * get count of processors available
+ */
+unsigned int
+thread_i_get_processor_count()
+{
+    long count;
+    count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (unsigned int)count : 1;
+}
+
+/**
+ * thread entry point
+ */
+static void*
+thread_i_thread_start(
+    void* arg)
+{
+    thread_i_thread* thread;
+    thread = (thread_i_thread*)arg;
+    thread->run(thread->arg);
+    return NULL;
+}
+
+/* vi: se ts=4 sw=4 et: */
@@ -0,0 +1,252 @@
+#include "thread_i.h"
+#include <stdlib.h>
+#include <errno.h>
+#include <Windows.h>
+
+/**
+ * thread
+ */
+struct _thread_i_thread {
+    /**
+     * thread handle
+     */
+    HANDLE handle;
+
+    /**
+     * procedure run in the thread
+     */
+    void (*run)(void*);
+
+    /**
+     * argument for the procedure
+     */
+    void* arg;
+};
+
+/**
+ * mutual exclusion lock
+ */
+struct _thread_i_mutex {
+    /**
+     * lock
+     */
+    SRWLOCK lock;
+};
+
+/**
+ * condition variable
+ */
+struct _thread_i_cond {
+    /**
+     * condition variable
+     */
+    CONDITION_VARIABLE cond;
+};
+
+/**
+ * thread entry point
+ */
+static DWORD WINAPI
+thread_i_thread_start(
+    LPVOID arg);
+
+/**
+ * start new thread which runs the procedure with the argument
+ */
+thread_i_thread*
+thread_i_thread_create(
+    void (*run)(void*),
+    void* arg)
+{
+    thread_i_thread* result;
+    result = NULL;
+    if (run) {
+        result = (thread_i_thread*)malloc(sizeof(thread_i_thread));
+    } else {
+        errno = EINVAL;
+    }
+    if (result) {
+        result->run = run;
+        result->arg = arg;
+        result->handle = CreateThread(NULL, 0, thread_i_thread_start,
+            result, 0, NULL);
+        if (!result->handle) {
+            free(result);
+            result = NULL;
+            errno = EAGAIN;
+        }
+    }
+    return result;
+}
+
+/**
+ * wait for the thread to be finished and free the thread
+ */
+int
+thread_i_thread_join(
+    thread_i_thread* thread)
+{
+    int result;
+    if (thread) {
+        result = WaitForSingleObject(thread->handle, INFINITE)
+            == WAIT_OBJECT_0 ? 0 : -1;
+        if (result) {
+            errno = EINVAL;
+        }
+        CloseHandle(thread->handle);
+        free(thread);
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * create mutex
+ */
+thread_i_mutex*
+thread_i_mutex_create()
+{
+    thread_i_mutex* result;
+    result = (thread_i_mutex*)malloc(sizeof(thread_i_mutex));
+    if (result) {
+        InitializeSRWLock(&result->lock);
+    }
+    return result;
+}
+
+/**
+ * free mutex
+ */
+void
+thread_i_mutex_free(
+    thread_i_mutex* mutex)
+{
+    if (mutex) {
+        free(mutex);
+    }
+}
+
+/**
+ * lock mutex
+ */
+void
+thread_i_mutex_lock(
+    thread_i_mutex* mutex)
+{
+    AcquireSRWLockExclusive(&mutex->lock);
+}
+
+/**
+ * unlock mutex
+ */
+void
+thread_i_mutex_unlock(
+    thread_i_mutex* mutex)
+{
+    ReleaseSRWLockExclusive(&mutex->lock);
+}
+
+/**
+ * create condition variable
+ */
+thread_i_cond*
+thread_i_cond_create()
+{
+    thread_i_cond* result;
+    result = (thread_i_cond*)malloc(sizeof(thread_i_cond));
+    if (result) {
+        InitializeConditionVariable(&result->cond);
+    }
+    return result;
+}
+
+/**
+ * free condition variable
+ */
+void
+thread_i_cond_free(
+    thread_i_cond* cond)
+{
+    if (cond) {
+        free(cond);
+    }
+}
+
+/**
+ * release locked mutex and wait for the condition to be signaled
+ */
+void
+thread_i_cond_wait(
+    thread_i_cond* cond,
+    thread_i_mutex* mutex)
+{
+    SleepConditionVariableSRW(&cond->cond, &mutex->lock, INFINITE, 0);
+}
+
+/**
+ * release locked mutex and wait for the condition to be signaled at most
+ * the milliseconds.
+ */
+int
+thread_i_cond_timed_wait(
+    thread_i_cond* cond,
+    thread_i_mutex* mutex,
+    unsigned int millisec)
+{
+    int result;
+    result = SleepConditionVariableSRW(&cond->cond, &mutex->lock,
+        (DWORD)millisec, 0) ? 0 : -1;
+    if (result) {
+        errno = GetLastError() == ERROR_TIMEOUT ? ETIMEDOUT : EINVAL;
+    }
+    return result;
+}
+
+/**
+ * wake a thread waiting for the condition
+ */
+void
+thread_i_cond_signal(
+    thread_i_cond* cond)
+{
+    WakeConditionVariable(&cond->cond);
+}
+
+/**
+ * wake all threads waiting for the condition
+ */
+void
+thread_i_cond_broadcast(
+    thread_i_cond* cond)
+{
+    WakeAllConditionVariable(&cond->cond);
+}
+
+/**
+ * get count of processors available
+ */
+unsigned int
+thread_i_get_processor_count()
+{
+    SYSTEM_INFO sys_info;
+    GetSystemInfo(&sys_info);
+    return sys_info.dwNumberOfProcessors ?
+        (unsigned int)sys_info.dwNumberOfProcessors : 1;
+}
+
+/**
+ * thread entry point
+ */
+static DWORD WINAPI
+thread_i_thread_start(
+    LPVOID arg)
+{
+    thread_i_thread* thread;
+    thread = (thread_i_thread*)arg;
+    thread->run(thread->arg);
+    return 0;
+}
+
+/* vi: se ts=4 sw=4 et: */
@@ -0,0 +1,416 @@
+#include "worker_pool.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "thread_i.h"
+
+/**
+ * task
+ */
+typedef struct _worker_pool_task worker_pool_task;
+
+/**
+ * task
+ */
+struct _worker_pool_task {
+    /**
+     * procedure
+     */
+    void (*run)(void*);
+
+    /**
+     * argument for the procedure
+     */
+    void* arg;
+
+    /**
+     * next task
+     */
+    worker_pool_task* next;
+};
+
+/**
+ * state shared by threads running tasks for indexes
+ */
+typedef struct _worker_pool_for_each_state worker_pool_for_each_state;
+
+/**
+ * state shared by threads running tasks for indexes
+ */
+struct _worker_pool_for_each_state {
+    /**
+     * task for an index
+     */
+    void (*run)(void*, void*, size_t);
+
+    /**
+     * make local state of thread
+     */
+    void* (*create_local)(void*);
+
+    /**
+     * free local state of thread
+     */
+    void (*free_local)(void*, void*);
+
+    /**
+     * argument for the procedures
+     */
+    void* context;
+
+    /**
+     * count of indexes
+     */
+    size_t count;
+
+    /**
+     * the next index
+     */
+    size_t next;
+
+    /**
+     * lock for the next index. NULL if tasks are run in a thread.
+     */
+    thread_i_mutex* lock;
+};
+
+/**
+ * fixed size thread pool
+ */
+struct _worker_pool {
+    /**
+     * lock for task queue
+     */
+    thread_i_mutex* lock;
+
+    /**
+     * signaled when a task is queued or the pool is closed
+     */
+    thread_i_cond* task_ready;
+
+    /**
+     * the first task in queue
+     */
+    worker_pool_task* task_head;
+
+    /**
+     * the last task in queue
+     */
+    worker_pool_task* task_tail;
+
+    /**
+     * not zero if the pool does not accept tasks anymore
+     */
+    int closed;
+
+    /**
+     * threads
+     */
+    thread_i_thread** threads;
+
+    /**
+     * count of threads
+     */
+    unsigned int thread_count;
+};
+
+/**
+ * run queued tasks until the pool is closed
+ */
+static void
+worker_pool_run(
+    void* arg);
+
+/**
+ * run tasks for indexes until no index is left
+ */
+static void
+worker_pool_for_each_run(
+    void* arg);
+
+/**
+ * allocate memory
+ */
+static void*
+worker_pool_mem_alloc(
+    size_t size);
+
+/**
+ * free memory
+ */
+static void
+worker_pool_mem_free(
+    void* heap_obj);
+
+/**
+ * create worker pool with the thread count
+ */
+worker_pool*
+worker_pool_create(
+    unsigned int thread_count)
+{
+    worker_pool* result;
+    result = NULL;
+    if (thread_count) {
+        result = (worker_pool*)worker_pool_mem_alloc(sizeof(worker_pool));
+    } else {
+        errno = EINVAL;
+    }
+    if (result) {
+        memset(result, 0, sizeof(*result));
+        result->lock = thread_i_mutex_create();
+        result->task_ready = thread_i_cond_create();
+        result->threads = (thread_i_thread**)worker_pool_mem_alloc(
+            sizeof(thread_i_thread*) * thread_count);
+        if (result->lock && result->task_ready && result->threads) {
+            while (result->thread_count < thread_count) {
+                thread_i_thread* thread;
+                thread = thread_i_thread_create(worker_pool_run, result);
+                if (!thread) {
+                    break;
+                }
+                result->threads[result->thread_count++] = thread;
+            }
+        }
+        if (result->thread_count != thread_count) {
+            worker_pool_free(result);
+            result = NULL;
+        }
+    }
+    return result;
+}
+
+/**
+ * free worker pool.
+ */
+void
+worker_pool_free(
+    worker_pool* obj)
+{
+    if (obj) {
+        unsigned int idx;
+        if (obj->lock && obj->task_ready) {
+            thread_i_mutex_lock(obj->lock);
+            obj->closed = 1;
+            thread_i_cond_broadcast(obj->task_ready);
+            thread_i_mutex_unlock(obj->lock);
+        }
+        for (idx = 0; idx < obj->thread_count; idx++) {
+            thread_i_thread_join(obj->threads[idx]);
+        }
+        while (obj->task_head) {
+            worker_pool_task* task;
+            task = obj->task_head;
+            obj->task_head = task->next;
+            worker_pool_mem_free(task);
+        }
+        if (obj->threads) {
+            worker_pool_mem_free(obj->threads);
+        }
+        thread_i_cond_free(obj->task_ready);
+        thread_i_mutex_free(obj->lock);
+        worker_pool_mem_free(obj);
+    }
+}
+
+/**
+ * submit a task to be run in a worker thread
+ */
+int
+worker_pool_submit(
+    worker_pool* obj,
+    void (*run)(void*),
+    void* arg)
+{
+    int result;
+    worker_pool_task* task;
+    task = NULL;
+    if (obj && run) {
+        task = (worker_pool_task*)worker_pool_mem_alloc(
+            sizeof(worker_pool_task));
+        result = task ? 0 : -1;
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    if (result == 0) {
+        task->run = run;
+        task->arg = arg;
+        task->next = NULL;
+        thread_i_mutex_lock(obj->lock);
+        if (obj->task_tail) {
+            obj->task_tail->next = task;
+        } else {
+            obj->task_head = task;
+        }
+        obj->task_tail = task;
+        thread_i_cond_signal(obj->task_ready);
+        thread_i_mutex_unlock(obj->lock);
+    }
+    return result;
+}
+
+/**
+ * get thread count
+ */
+unsigned int
+worker_pool_get_thread_count(
+    worker_pool* obj)
+{
+    unsigned int result;
+    if (obj) {
+        result = obj->thread_count;
+    } else {
+        result = 0;
+        errno = EINVAL;
+    }
+    return result;
+}
+
+/**
+ * run a task for each index below count in up to thread_count threads
+ */
+int
+worker_pool_for_each(
+    unsigned int thread_count,
+    size_t count,
+    void (*run)(void* context, void* local, size_t idx),
+    void* (*create_local)(void* context),
+    void (*free_local)(void* context, void* local),
+    void* context)
+{
+    int result;
+    worker_pool_for_each_state state;
+    worker_pool* pool;
+    memset(&state, 0, sizeof(state));
+    pool = NULL;
+    if (run) {
+        result = 0;
+    } else {
+        result = -1;
+        errno = EINVAL;
+    }
+    if (result == 0) {
+        state.run = run;
+        state.create_local = create_local;
+        state.free_local = free_local;
+        state.context = context;
+        state.count = count;
+    }
+    if (result == 0 && thread_count > 1 && count > 1) {
+        unsigned int task_count;
+        unsigned int idx;
+        task_count = count < thread_count ? (unsigned int)count
+            : thread_count;
+        state.lock = thread_i_mutex_create();
+        if (state.lock) {
+            /* the calling thread is one of the threads */
+            pool = worker_pool_create(task_count - 1);
+        }
+        for (idx = 1; pool && idx < task_count; idx++) {
+            if (worker_pool_submit(pool, worker_pool_for_each_run, &state)) {
+                break;
+            }
+        }
+    }
+    if (result == 0) {
+        worker_pool_for_each_run(&state);
+    }
+    if (pool) {
+        /* wait for the tasks in worker threads */
+        worker_pool_free(pool);
+    }
+    if (state.lock) {
+        thread_i_mutex_free(state.lock);
+    }
+    return result;
+}
+
+/**
+ * run queued tasks until the pool is closed
+ */
+static void
+worker_pool_run(
+    void* arg)
+{
+    worker_pool* obj;
+    obj = (worker_pool*)arg;
+    thread_i_mutex_lock(obj->lock);
+    while (1) {
+        worker_pool_task* task;
+        while (!obj->task_head && !obj->closed) {
+            thread_i_cond_wait(obj->task_ready, obj->lock);
+        }
+        task = obj->task_head;
+        if (!task) {
+            break;
+        }
+        obj->task_head = task->next;
+        if (!obj->task_head) {
+            obj->task_tail = NULL;
+        }
+        thread_i_mutex_unlock(obj->lock);
+        task->run(task->arg);
+        worker_pool_mem_free(task);
+        thread_i_mutex_lock(obj->lock);
+    }
+    thread_i_mutex_unlock(obj->lock);
+}
+
+/**
+ * run tasks for indexes until no index is left
+ */
+static void
+worker_pool_for_each_run(
+    void* arg)
+{
+    worker_pool_for_each_state* obj;
+    void* local;
+    obj = (worker_pool_for_each_state*)arg;
+    local = NULL;
+    if (obj->create_local) {
+        local = obj->create_local(obj->context);
+    }
+    while (1) {
+        size_t idx;
+        if (obj->lock) {
+            thread_i_mutex_lock(obj->lock);
+        }
+        idx = obj->next;
+        if (idx < obj->count) {
+            obj->next++;
+        }
+        if (obj->lock) {
+            thread_i_mutex_unlock(obj->lock);
+        }
+        if (idx >= obj->count) {
+            break;
+        }
+        obj->run(obj->context, local, idx);
+    }
+    if (obj->free_local) {
+        obj->free_local(obj->context, local);
+    }
+}
+
+/**
+ * allocate memory
+ */
+static void*
+worker_pool_mem_alloc(
+    size_t size)
+{
+    return malloc(size);
+}
+
+/**
+ * free memory
+ */
+static void
+worker_pool_mem_free(
+    void* heap_obj)
+{
+    free(heap_obj);
+}
+
+/* vi: se ts=4 sw=4 et: */
@@ -0,0 +1,72 @@
+#ifndef __WORKER_POOL_H__
+#define __WORKER_POOL_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+#define _WORKER_POOL_ITFC_BEGIN extern "C" {
+#define _WORKER_POOL_ITFC_END }
+#else
+#define _WORKER_POOL_ITFC_BEGIN
+#define _WORKER_POOL_ITFC_END
+#endif
+
+_WORKER_POOL_ITFC_BEGIN
+
+/**
+ * fixed size thread pool running submitted tasks in order
+ */
+typedef struct _worker_pool worker_pool;
+
+/**
+ * create worker pool with the thread count
+ */
+worker_pool*
+worker_pool_create(
+    unsigned int thread_count);
+
+/**
+ * free worker pool.
+ * The tasks submitted already are run before the threads exit.
+ */
+void
+worker_pool_free(
+    worker_pool* obj);
+
+/**
+ * submit a task to be run in a worker thread
+ */
+int
+worker_pool_submit(
+    worker_pool* obj,
+    void (*run)(void*),
+    void* arg);
+
+/**
+ * get thread count
+ */
+unsigned int
+worker_pool_get_thread_count(
+    worker_pool* obj);
+
+/**
+ * run a task for each index below count in up to thread_count threads
+ * including the calling thread, and return after all tasks are completed.
+ * Threads take indexes one by one. The calling thread runs the tasks left
+ * if worker threads can not be started. If create_local is not NULL, each
+ * thread passes the local state made by it to the tasks, and free_local
+ * frees the state after the last task of the thread.
+ */
+int
+worker_pool_for_each(
+    unsigned int thread_count,
+    size_t count,
+    void (*run)(void* context, void* local, size_t idx),
+    void* (*create_local)(void* context),
+    void (*free_local)(void* context, void* local),
+    void* context);
+
+_WORKER_POOL_ITFC_END
+
+/* vi: se ts=4 sw=4 et: */
+#endif